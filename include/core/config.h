@@ -61,6 +61,7 @@ typedef struct {
     char storage_path_hls[MAX_PATH_LENGTH]; // Path for HLS segments, overrides storage_path/hls when specified
     uint64_t max_storage_size; // in bytes
     int retention_days;
+    int detection_retention_days;    // Days to keep recordings without detections, 0 = same as retention_days
     bool auto_delete_oldest;
 
     // New recording format options
@@ -71,12 +72,19 @@ typedef struct {
     
     // Models settings
     char models_path[MAX_PATH_LENGTH]; // Path to detection models directory
+    int inference_batch_size;        // Frames per batched CNN forward pass, 1 disables batching
+    int inference_max_latency_ms;    // Longest a frame waits for its batch to fill
+    int inference_threads;           // CPU threads for CNN convolutions, shared by all models
     
     // API detection settings
     char api_detection_url[MAX_URL_LENGTH]; // URL for the detection API
 
     // Database settings
     char db_path[MAX_PATH_LENGTH];
+    int db_reader_connections;       // Read-only WAL connections for queries, 0 sends reads to the writer
+    int db_commit_interval_ms;       // Longest a write waits to share a commit with others, 0 commits when idle
+    int db_commit_batch_size;        // Maximum writes per commit
+    char db_synchronous[16];         // SQLite synchronous mode: off, normal, full or extra
     
     // Web server settings
     int web_port;
@@ -84,6 +92,9 @@ typedef struct {
     bool web_auth_enabled;
     char web_username[32];
     char web_password[32]; // Stored as hash in actual implementation
+    int web_thread_pool_size;        // Number of API worker threads
+    int web_request_queue_size;      // Maximum queued API requests before replying 503
+    int web_auth_cache_ttl;          // Seconds a validated session or password stays cached, 0 disables
     
     // Web optimization settings
     bool web_compression_enabled;    // Whether to enable gzip compression for text-based responses
@@ -102,6 +113,9 @@ typedef struct {
     
     // Stream settings
     int max_streams;
+    bool shared_ingest;              // Share one input connection per stream between HLS, MP4 and detection
+    bool ll_hls_enabled;             // Serve low-latency HLS (fMP4 parts, blocking playlist reload)
+    int ll_hls_part_duration_ms;     // Target LL-HLS part duration in milliseconds
     stream_config_t streams[MAX_STREAMS];
     
     // Memory optimization
@@ -110,6 +124,8 @@ typedef struct {
     char swap_file[MAX_PATH_LENGTH];
     uint64_t swap_size; // in bytes
     bool memory_constrained; // Flag for memory-constrained devices
+    bool hls_memory_store;   // Keep live HLS playlists and segments in RAM instead of on disk
+    int hls_memory_segments; // Number of segments kept in RAM per stream
     
     // Hardware acceleration
     bool hw_accel_enabled;
@@ -3,6 +3,7 @@
 
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdint.h>
 
 // Log levels
 // Change your logger.h enum to avoid conflicting with syslog.h
@@ -25,6 +26,15 @@ int init_logger(void);
  */
 void shutdown_logger(void);
 
+/**
+ * Restart the log writer thread in a child that keeps running after fork()
+ * 
+ * Only the forking thread survives fork(), so a daemonized child must call
+ * this before logging. Short-lived children that exec or exit soon after
+ * fork() must not use the logger at all.
+ */
+void logger_restart_after_fork(void);
+
 /**
  * Set the log level
  * 
@@ -109,6 +119,16 @@ void log_message_v(log_level_t level, const char *format, va_list args);
  */
 int log_rotate(size_t max_size, int max_files);
 
+/**
+ * Get the number of messages dropped because the log buffers were full
+ * 
+ * Logging never blocks the caller; when the writer thread falls behind,
+ * new messages are dropped and counted instead.
+ * 
+ * @return Total number of dropped messages
+ */
+uint64_t get_log_dropped_count(void);
+
 /**
  * Get the string representation of a log level
  * 
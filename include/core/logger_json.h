@@ -32,6 +32,18 @@ void shutdown_json_logger(void);
  */
 int write_json_log(log_level_t level, const char *timestamp, const char *message);
 
+/**
+ * @brief Write several log entries to the JSON log file with a single flush
+ * 
+ * @param levels Log levels
+ * @param timestamps Timestamp strings
+ * @param messages Log messages
+ * @param count Number of entries
+ * @return int 0 on success, non-zero on error
+ */
+int write_json_log_batch(const log_level_t *levels, const char *const *timestamps,
+                         const char *const *messages, int count);
+
 /**
  * @brief Get logs from the JSON log file with timestamp-based pagination
  * 
@@ -0,0 +1,168 @@
+#ifndef LIGHTNVR_METRICS_H
+#define LIGHTNVR_METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Metrics registry
+ *
+ * Counters, gauges and latency histograms exported in the Prometheus text
+ * format by GET /metrics.
+ *
+ * A series is registered once, typically when a stream or component starts,
+ * and the returned handle is kept by the caller. A zeroed handle, or one whose
+ * registration failed, is valid and ignores updates. Updating a counter or
+ * histogram is a single relaxed atomic add on a per-thread shard, so hot paths
+ * never contend on a lock or a shared cache line. Shards are only summed when
+ * the registry is rendered.
+ *
+ * Histograms record durations in microseconds into log-linear buckets (two
+ * per power of two, from 1 us to 134 s) and are exported in seconds.
+ */
+
+// Maximum number of metric families and series
+#define METRICS_MAX_FAMILIES 128
+#define METRICS_MAX_SERIES 2048
+
+// Buckets of a histogram, the last one counting values beyond the largest bound
+#define METRICS_HISTOGRAM_BUCKETS 55
+
+typedef struct {
+    int32_t slot;               // 0 when not registered, updates are then ignored
+} metrics_counter_t;
+
+typedef struct {
+    int32_t slot;
+} metrics_gauge_t;
+
+typedef struct {
+    int32_t slot;
+} metrics_histogram_t;
+
+/**
+ * Growable text buffer used to render metrics
+ */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} metrics_buffer_t;
+
+/**
+ * Register a counter, or return the existing one with the same name and labels
+ *
+ * @param name Metric name, e.g. "lightnvr_stream_packets_total"
+ * @param help Description shown in the HELP line
+ * @param labels Label pairs built with metrics_label(), or NULL for none
+ * @return Counter handle
+ */
+metrics_counter_t metrics_counter(const char *name, const char *help, const char *labels);
+
+/**
+ * Register a gauge, or return the existing one with the same name and labels
+ *
+ * @param name Metric name
+ * @param help Description shown in the HELP line
+ * @param labels Label pairs built with metrics_label(), or NULL for none
+ * @return Gauge handle
+ */
+metrics_gauge_t metrics_gauge(const char *name, const char *help, const char *labels);
+
+/**
+ * Register a histogram, or return the existing one with the same name and labels
+ *
+ * @param name Metric name, ending in "_seconds"
+ * @param help Description shown in the HELP line
+ * @param labels Label pairs built with metrics_label(), or NULL for none
+ * @return Histogram handle
+ */
+metrics_histogram_t metrics_histogram(const char *name, const char *help, const char *labels);
+
+/**
+ * Append a label pair to a label string, escaping the value
+ *
+ * @param labels Label string, empty or holding earlier pairs
+ * @param size Size of the label string buffer
+ * @param key Label name
+ * @param value Label value
+ */
+void metrics_label(char *labels, size_t size, const char *key, const char *value);
+
+/**
+ * Add to a counter
+ *
+ * @param counter Counter handle
+ * @param value Amount to add
+ */
+void metrics_counter_add(metrics_counter_t counter, uint64_t value);
+
+/**
+ * Set a gauge
+ *
+ * @param gauge Gauge handle
+ * @param value New value
+ */
+void metrics_gauge_set(metrics_gauge_t gauge, int64_t value);
+
+/**
+ * Add to a gauge
+ *
+ * @param gauge Gauge handle
+ * @param delta Amount to add, may be negative
+ */
+void metrics_gauge_add(metrics_gauge_t gauge, int64_t delta);
+
+/**
+ * Record a duration in a histogram
+ *
+ * @param histogram Histogram handle
+ * @param value_us Duration in microseconds
+ */
+void metrics_histogram_observe(metrics_histogram_t histogram, uint64_t value_us);
+
+/**
+ * Current monotonic time in microseconds, for timing observations
+ *
+ * @return Microseconds since an arbitrary point
+ */
+uint64_t metrics_now_us(void);
+
+/**
+ * Render every registered series in the Prometheus text format
+ *
+ * @param buf Buffer to append to
+ * @return 0 on success, -1 on allocation failure
+ */
+int metrics_render(metrics_buffer_t *buf);
+
+/**
+ * Append the HELP and TYPE lines of a metric family rendered by the caller
+ *
+ * @param buf Buffer to append to
+ * @param name Metric name
+ * @param help Description
+ * @param type "counter", "gauge" or "histogram"
+ * @return 0 on success, -1 on allocation failure
+ */
+int metrics_buffer_family(metrics_buffer_t *buf, const char *name, const char *help, const char *type);
+
+/**
+ * Append formatted text to a buffer
+ *
+ * @param buf Buffer to append to
+ * @param format printf-style format
+ * @return 0 on success, -1 on allocation failure
+ */
+int metrics_buffer_printf(metrics_buffer_t *buf, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * Release the memory of a buffer
+ *
+ * @param buf Buffer to free
+ */
+void metrics_buffer_free(metrics_buffer_t *buf);
+
+#endif // LIGHTNVR_METRICS_H
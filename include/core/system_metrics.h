@@ -0,0 +1,91 @@
+#ifndef LIGHTNVR_SYSTEM_METRICS_H
+#define LIGHTNVR_SYSTEM_METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "database/db_recordings.h"
+
+/**
+ * Background system metrics
+ *
+ * A collector thread samples CPU, memory, disk and recording storage usage at
+ * a fixed interval and publishes the result as a snapshot. Request handlers
+ * copy the latest snapshot instead of reading /proc, walking the storage
+ * directory or forking helper processes on every call.
+ *
+ * CPU usage is the share of time spent busy between two samples, not since
+ * boot. Recording storage comes from the running totals the database keeps as
+ * recordings are finalized and deleted; the collector re-reads them within a
+ * second of such a change rather than waiting for the next sample.
+ */
+
+// Seconds between two samples
+#define SYSTEM_METRICS_INTERVAL_SEC 5
+
+/**
+ * Recording storage of a stream
+ */
+typedef struct {
+    char name[64];
+    uint64_t size_bytes;
+    uint64_t recording_count;
+    uint64_t quota_bytes;           // 0 when the stream has no quota
+} system_metrics_stream_t;
+
+/**
+ * Metrics snapshot
+ */
+typedef struct {
+    time_t sample_time;             // 0 until the first sample is taken
+
+    int cpu_cores;
+    double cpu_usage;               // System-wide busy percentage over the last interval
+    double process_cpu_usage;       // LightNVR share of one core over the last interval, in percent
+
+    uint64_t memory_total;          // System memory in bytes
+    uint64_t memory_free;
+    uint64_t process_rss;           // LightNVR resident memory in bytes
+    uint64_t go2rtc_rss;            // go2rtc resident memory in bytes
+    bool go2rtc_running;
+
+    double process_uptime;          // Seconds since LightNVR started
+
+    bool storage_valid;             // Whether the storage path could be examined
+    uint64_t storage_total;         // Size of the filesystem holding the storage path
+    uint64_t storage_free;
+    uint64_t root_total;            // Size of the root filesystem
+    uint64_t root_free;
+
+    uint64_t recording_bytes;       // Bytes of all recordings
+    uint64_t recording_count;       // Number of recordings
+
+    int stream_count;
+    system_metrics_stream_t streams[RECORDING_USAGE_MAX_STREAMS];
+} system_metrics_snapshot_t;
+
+/**
+ * Start the collector thread
+ *
+ * @param storage_path Storage path whose filesystem is reported
+ * @return 0 on success, -1 on error
+ */
+int init_system_metrics(const char *storage_path);
+
+/**
+ * Stop the collector thread
+ */
+void shutdown_system_metrics(void);
+
+/**
+ * Copy the latest snapshot
+ *
+ * Does not take a lock: a copy racing with the collector is retried.
+ *
+ * @param snapshot Snapshot to fill
+ * @return 0 on success, -1 if no sample has been taken yet
+ */
+int system_metrics_get_snapshot(system_metrics_snapshot_t *snapshot);
+
+#endif // LIGHTNVR_SYSTEM_METRICS_H
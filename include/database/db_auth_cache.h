@@ -0,0 +1,97 @@
+#ifndef LIGHTNVR_DB_AUTH_CACHE_H
+#define LIGHTNVR_DB_AUTH_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * In-memory cache of validated credentials
+ *
+ * Session tokens and username/password pairs that passed validation against
+ * the database are remembered for web.auth_cache_ttl seconds, so requests
+ * arriving with the same credentials (HLS segment fetches, API polling) are
+ * accepted without a query or a PBKDF2 computation. Passwords are not stored:
+ * a credential entry holds a keyed SHA-256 digest of the pair, the key being
+ * random per process. The cache is split in shards, each with its own lock.
+ *
+ * db_auth.c invalidates entries whenever the underlying rows change. A
+ * validation that raced with an invalidation is not stored: callers take the
+ * generation before querying the database and pass it to the store function.
+ */
+
+/**
+ * Get the invalidation generation, to be passed to the store functions
+ *
+ * @return Current generation
+ */
+uint64_t auth_cache_generation(void);
+
+/**
+ * Look up a session token
+ *
+ * @param token Session token
+ * @param user_id Pointer to store the user ID of the session
+ * @return true if the token is cached as valid, false otherwise
+ */
+bool auth_cache_lookup_session(const char *token, int64_t *user_id);
+
+/**
+ * Remember a session token validated against the database
+ *
+ * @param token Session token
+ * @param user_id User ID of the session
+ * @param expires_at Expiration time of the session
+ * @param generation Generation taken before the database query
+ */
+void auth_cache_store_session(const char *token, int64_t user_id, time_t expires_at,
+                              uint64_t generation);
+
+/**
+ * Look up a username/password pair
+ *
+ * @param username Username
+ * @param password Password
+ * @param user_id Pointer to store the user ID
+ * @return true if the pair is cached as valid, false otherwise
+ */
+bool auth_cache_lookup_credentials(const char *username, const char *password, int64_t *user_id);
+
+/**
+ * Remember a username/password pair validated against the database
+ *
+ * @param username Username
+ * @param password Password
+ * @param user_id User ID
+ * @param generation Generation taken before the database query
+ */
+void auth_cache_store_credentials(const char *username, const char *password, int64_t user_id,
+                                  uint64_t generation);
+
+/**
+ * Forget a session token
+ *
+ * @param token Session token
+ */
+void auth_cache_invalidate_session(const char *token);
+
+/**
+ * Forget every session token of a user
+ *
+ * @param user_id User ID
+ */
+void auth_cache_invalidate_user_sessions(int64_t user_id);
+
+/**
+ * Forget every username/password pair of a user
+ *
+ * @param user_id User ID
+ */
+void auth_cache_invalidate_user_credentials(int64_t user_id);
+
+/**
+ * Forget everything
+ */
+void auth_cache_clear(void);
+
+#endif // LIGHTNVR_DB_AUTH_CACHE_H
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <time.h>
 #include "video/detection_result.h"
+#include "database/db_writer.h"
 
 /**
  * Store detection results in the database
@@ -15,6 +16,18 @@
  */
 int store_detections_in_db(const char *stream_name, const detection_result_t *result, time_t timestamp);
 
+/**
+ * Store detection results in the database without waiting for the commit
+ * 
+ * @param stream_name Stream name
+ * @param result Detection results
+ * @param timestamp Timestamp of the detection (0 for current time)
+ * @param future Pointer to store the completion future, NULL to not wait
+ * @return 0 if the detections were queued, non-zero on failure
+ */
+int store_detections_in_db_async(const char *stream_name, const detection_result_t *result, time_t timestamp,
+                                 db_write_future_t **future);
+
 /**
  * Get detection results from the database with time range filtering
  * 
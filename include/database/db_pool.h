@@ -0,0 +1,80 @@
+#ifndef LIGHTNVR_DB_POOL_H
+#define LIGHTNVR_DB_POOL_H
+
+#include <sqlite3.h>
+
+/**
+ * Reader connection pool and prepared statement cache
+ *
+ * The database is in WAL mode, so read-only connections can query it while the
+ * writer connection (get_db_handle(), serialized by get_db_mutex()) commits.
+ * Read-only APIs borrow one of these connections instead of taking the writer
+ * mutex, so listing recordings does not wait behind recorders and detection
+ * threads, and the reverse.
+ *
+ * Every connection, the writer included, keeps its prepared statements keyed by
+ * SQL text. A cached statement belongs to the connection: it may only be used
+ * by the thread holding that connection (the writer mutex or a borrowed reader)
+ * and must be handed back with db_release_statement() instead of finalized.
+ */
+
+/**
+ * Set the number of reader connections opened by the next init_database()
+ *
+ * @param count Number of reader connections, 0 sends reads to the writer connection
+ */
+void db_pool_set_reader_count(int count);
+
+/**
+ * Open the reader connections and attach a statement cache to the writer
+ * Called by init_database() once the schema is up to date
+ *
+ * @param db_path Path to the database file
+ * @param writer Writer connection
+ * @return 0 on success, non-zero on failure
+ */
+int db_pool_init(const char *db_path, sqlite3 *writer);
+
+/**
+ * Finalize all cached statements and close the reader connections
+ * Called by shutdown_database() before the writer connection is closed
+ */
+void db_pool_shutdown(void);
+
+/**
+ * Borrow a read-only connection
+ *
+ * Blocks until a reader is free. When the pool is disabled, returns the writer
+ * connection with the writer mutex held.
+ *
+ * @return Connection to be returned with db_release_reader(), NULL if the database is not initialized
+ */
+sqlite3 *db_acquire_reader(void);
+
+/**
+ * Return a connection borrowed with db_acquire_reader()
+ *
+ * @param conn Connection
+ */
+void db_release_reader(sqlite3 *conn);
+
+/**
+ * Get a prepared statement for SQL text from the cache of a connection,
+ * preparing it on first use
+ *
+ * @param conn Connection held by the caller
+ * @param sql SQL text
+ * @param stmt Pointer to store the statement
+ * @return SQLITE_OK on success, an SQLite error code otherwise
+ */
+int db_prepare_cached(sqlite3 *conn, const char *sql, sqlite3_stmt **stmt);
+
+/**
+ * Hand a statement from db_prepare_cached() back to its cache
+ * The statement is reset and its bindings cleared
+ *
+ * @param stmt Statement, may be NULL
+ */
+void db_release_statement(sqlite3_stmt *stmt);
+
+#endif // LIGHTNVR_DB_POOL_H
@@ -0,0 +1,73 @@
+#ifndef LIGHTNVR_DB_RECORDING_INDEX_H
+#define LIGHTNVR_DB_RECORDING_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "database/db_recordings.h"
+
+/**
+ * In-memory recording time index
+ *
+ * Keeps, per stream, the recordings of the recordings table sorted by start
+ * time so a timestamp can be resolved to a file with a binary search. A
+ * stream is loaded from the database on its first lookup and then kept
+ * current by db_recordings.c, which reports every insert, update and delete.
+ */
+
+// A recording starting this many seconds after a timestamp still matches it
+#define RECORDING_INDEX_MATCH_WINDOW 60
+
+/**
+ * Find the recording of a stream covering a timestamp
+ *
+ * Returns the recording whose interval contains the timestamp, an ongoing
+ * recording that started before it, or the first recording starting within
+ * RECORDING_INDEX_MATCH_WINDOW seconds after it.
+ *
+ * @param stream_name Name of the stream
+ * @param timestamp Time to look up
+ * @param path Buffer for the file path
+ * @param path_size Size of the buffer
+ * @return 1 if found, 0 if not found, -1 on error
+ */
+int recording_index_find(const char *stream_name, time_t timestamp, char *path, size_t path_size);
+
+/**
+ * Record a recording added to the database
+ *
+ * @param id Recording ID
+ * @param metadata Recording metadata
+ */
+void recording_index_add(uint64_t id, const recording_metadata_t *metadata);
+
+/**
+ * Record a new end time for a recording
+ *
+ * @param id Recording ID
+ * @param end_time New end time
+ */
+void recording_index_update(uint64_t id, time_t end_time);
+
+/**
+ * Record recordings removed from the database
+ *
+ * @param ids Recording IDs
+ * @param count Number of IDs
+ */
+void recording_index_remove(const uint64_t *ids, int count);
+
+/**
+ * Drop all loaded streams so they are reloaded on the next lookup
+ * Used after bulk deletes that do not report individual IDs
+ */
+void recording_index_invalidate(void);
+
+/**
+ * Free the index
+ * This function should be called during program shutdown
+ */
+void recording_index_cleanup(void);
+
+#endif /* LIGHTNVR_DB_RECORDING_INDEX_H */
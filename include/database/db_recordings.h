@@ -5,6 +5,11 @@
 #include <stdbool.h>
 #include <time.h>
 
+#include "database/db_writer.h"
+
+// Highest bit of the detection label mask; labels beyond the first ones share it
+#define RECORDING_DETECTION_MAX_BIT 62
+
 // Recording metadata structure
 typedef struct {
     uint64_t id;
@@ -18,6 +23,9 @@ typedef struct {
     int fps;
     char codec[16];
     bool is_complete;
+    int detection_count;            // Detections stored while the recording ran
+    uint64_t detection_labels;      // Bit per detected label, see detection_labels table
+    float max_confidence;           // Highest detection confidence, 0 without detections
 } recording_metadata_t;
 
 /**
@@ -28,6 +36,16 @@ typedef struct {
  */
 uint64_t add_recording_metadata(const recording_metadata_t *metadata);
 
+/**
+ * Add recording metadata without waiting for the commit
+ * The recording ID is the row ID of the future once the write is done.
+ * 
+ * @param metadata Recording metadata
+ * @param future Pointer to store the completion future, NULL to not wait
+ * @return 0 if the insert was queued, non-zero on failure
+ */
+int add_recording_metadata_async(const recording_metadata_t *metadata, db_write_future_t **future);
+
 /**
  * Update recording metadata in the database
  * 
@@ -40,6 +58,46 @@ uint64_t add_recording_metadata(const recording_metadata_t *metadata);
 int update_recording_metadata(uint64_t id, time_t end_time, 
                              uint64_t size_bytes, bool is_complete);
 
+/**
+ * Update recording metadata without waiting for the commit
+ * 
+ * @param id Recording ID
+ * @param end_time New end time
+ * @param size_bytes New size in bytes
+ * @param is_complete Whether the recording is complete
+ * @param future Pointer to store the completion future, NULL to not wait
+ * @return 0 if the update was queued, non-zero on failure
+ */
+int update_recording_metadata_async(uint64_t id, time_t end_time, uint64_t size_bytes,
+                                    bool is_complete, db_write_future_t **future);
+
+/**
+ * Add stored detections to the summary of the recordings they fall in
+ * Runs on the writer connection, as part of the write storing the detections.
+ *
+ * @param db Writer connection
+ * @param stream_name Stream name
+ * @param timestamp Timestamp of the detections
+ * @param count Number of detections
+ * @param labels Label mask of the detections
+ * @param max_confidence Highest confidence of the detections
+ * @return 0 on success, non-zero on failure
+ */
+int link_recording_detections(sqlite3 *db, const char *stream_name, time_t timestamp,
+                              int count, uint64_t labels, float max_confidence);
+
+/**
+ * Recompute the detection summary of a complete recording from the detections table
+ *
+ * Catches detections stored before the recording row existed (pre-detection
+ * buffer) and drops those counted while it was open but after its end time.
+ *
+ * @param db Writer connection
+ * @param id Recording ID, 0 for every complete recording
+ * @return 0 on success, non-zero on failure
+ */
+int refresh_recording_detections(sqlite3 *db, uint64_t id);
+
 /**
  * Get recording metadata from the database
  * 
@@ -111,4 +169,92 @@ int delete_recording_metadata(uint64_t id);
  */
 int delete_old_recording_metadata(uint64_t max_age);
 
+/**
+ * Get the oldest complete recordings eligible for deletion, ordered by start time
+ *
+ * Recordings that overlap a detection are only returned once they started
+ * before detection_before, which keeps them for a longer retention tier.
+ * Uses the start_time index, so the cost depends on max_count and on the
+ * number of kept detection recordings rather than on all recordings.
+ *
+ * @param stream_name Only return recordings of this stream (NULL for all streams)
+ * @param before Only return recordings that started before this time (0 for no limit)
+ * @param detection_before Cutoff for recordings with detections (0 for no limit)
+ * @param metadata Array to fill with recording metadata
+ * @param max_count Maximum number of recordings to return
+ * @return Number of recordings found, or -1 on error
+ */
+int get_recordings_for_retention(const char *stream_name, time_t before, time_t detection_before,
+                                 recording_metadata_t *metadata, int max_count);
+
+/**
+ * Delete several recordings' metadata in one transaction
+ *
+ * @param ids Recording IDs
+ * @param count Number of IDs
+ * @return Number of rows deleted, or -1 on error
+ */
+int delete_recording_metadata_batch(const uint64_t *ids, int count);
+
+/**
+ * Get the running totals of all recordings
+ *
+ * Read from the per-stream usage table maintained by triggers on the
+ * recordings table, so the cost is proportional to the number of streams.
+ *
+ * @param total_bytes Pointer to receive the total size in bytes
+ * @param total_count Pointer to receive the number of recordings (can be NULL)
+ * @return 0 on success, non-zero on failure
+ */
+int get_recording_usage_totals(uint64_t *total_bytes, uint64_t *total_count);
+
+// Maximum number of streams (including removed ones) with recordings that usage queries report
+#define RECORDING_USAGE_MAX_STREAMS 256
+
+// Running recording usage of one stream
+typedef struct {
+    char stream_name[64];
+    uint64_t total_bytes;
+    uint64_t recording_count;
+} stream_recording_usage_t;
+
+/**
+ * Get the running recording usage of every stream
+ *
+ * @param usage Array to fill
+ * @param max_count Maximum number of streams to return
+ * @return Number of streams found, or -1 on error
+ */
+int get_stream_recording_usage(stream_recording_usage_t *usage, int max_count);
+
+/**
+ * Get a counter that changes whenever recordings are added, finalized or deleted
+ *
+ * Lets callers caching the usage totals refresh them only when they moved.
+ *
+ * @return Current value of the counter
+ */
+uint64_t get_recording_usage_generation(void);
+
+/**
+ * Get a counter that changes whenever recordings of one stream are added,
+ * finalized or deleted
+ *
+ * Changes of other streams leave it alone, except when the database cannot
+ * tell which streams a deletion touched.
+ *
+ * @param stream_name Name of the stream
+ * @return Current value of the counter
+ */
+uint64_t get_stream_recording_generation(const char *stream_name);
+
+/**
+ * Get the start time of the oldest and newest recording
+ *
+ * @param oldest Pointer to receive the oldest start time (0 if none)
+ * @param newest Pointer to receive the newest start time (0 if none)
+ * @return 0 on success, non-zero on failure
+ */
+int get_recording_time_range(time_t *oldest, time_t *newest);
+
 #endif // LIGHTNVR_DB_RECORDINGS_H
@@ -78,4 +78,40 @@ int get_enabled_stream_count(void);
  */
 int is_stream_eligible_for_live_streaming(const char *stream_name);
 
+/**
+ * Per-stream storage policy
+ */
+typedef struct {
+    char stream_name[MAX_STREAM_NAME];
+    int retention_days;             // Days to keep recordings, 0 = global retention
+    int detection_retention_days;   // Days to keep recordings with detections, 0 = global setting
+    uint64_t max_storage_bytes;     // Byte quota for the stream's recordings, 0 = no quota
+} stream_storage_policy_t;
+
+/**
+ * Get the storage policy of a stream
+ *
+ * @param stream_name Name of the stream
+ * @param policy Policy to fill; zeroed (no overrides) if the stream has none
+ * @return 0 on success, non-zero on failure
+ */
+int get_stream_storage_policy(const char *stream_name, stream_storage_policy_t *policy);
+
+/**
+ * Create or replace the storage policy of a stream
+ *
+ * @param policy Policy to store
+ * @return 0 on success, non-zero on failure
+ */
+int set_stream_storage_policy(const stream_storage_policy_t *policy);
+
+/**
+ * Get all stream storage policies
+ *
+ * @param policies Array to fill
+ * @param max_count Maximum number of policies to return
+ * @return Number of policies found, or -1 on error
+ */
+int get_all_stream_storage_policies(stream_storage_policy_t *policies, int max_count);
+
 #endif // LIGHTNVR_DB_STREAMS_H
@@ -0,0 +1,154 @@
+#ifndef LIGHTNVR_DB_TIMELINE_ROLLUPS_H
+#define LIGHTNVR_DB_TIMELINE_ROLLUPS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sqlite3.h>
+
+#include "video/detection_result.h"
+
+/**
+ * Timeline activity rollups
+ *
+ * Per-stream aggregates over fixed time buckets of 1 minute, 15 minutes,
+ * 1 hour and 1 day: seconds recorded, motion events, and detections by
+ * label. The database writer updates them as recordings are finalized and
+ * detections are stored. Deleting a recording subtracts its coverage, and
+ * retention drops buckets older than the retained range. A heatmap at any
+ * zoom level then reads a bounded number of rows instead of every segment
+ * and detection.
+ *
+ * Buckets follow local wall time, so a day bucket runs from local midnight
+ * to local midnight. The zone the buckets were aligned in is stored with
+ * them, and the rollups are rebuilt when the local zone changes.
+ */
+
+// Number of bucket lengths kept
+#define TIMELINE_ROLLUP_RESOLUTIONS 4
+
+// Label stored by motion detection, counted separately from object detections
+#define TIMELINE_ROLLUP_MOTION_LABEL "motion"
+
+/**
+ * Activity of one bucket
+ */
+typedef struct {
+    time_t start;
+    int coverage;               // Seconds recorded, summed over streams when not filtered by stream
+    int motion_count;
+    int detection_count;        // Object detections, motion excluded
+} timeline_heatmap_bucket_t;
+
+/**
+ * Detections of one label in one bucket
+ */
+typedef struct {
+    time_t start;
+    char label[MAX_LABEL_LENGTH];
+    int count;
+} timeline_heatmap_label_t;
+
+/**
+ * Bucket length of a resolution index
+ *
+ * @param index Index from 0 (finest) to TIMELINE_ROLLUP_RESOLUTIONS - 1
+ * @return Bucket length in seconds
+ */
+int timeline_rollup_resolution(int index);
+
+/**
+ * Parse a resolution such as "1m", "15m", "1h", "1d" or a length in seconds
+ *
+ * @param value Resolution string
+ * @return Resolution index, or -1 if it is not a kept bucket length
+ */
+int timeline_rollup_parse_resolution(const char *value);
+
+/**
+ * Add or subtract the time range of a recording from the rollups
+ *
+ * Runs on the caller's connection, inside its transaction.
+ *
+ * @param db Database connection
+ * @param stream_name Stream name
+ * @param start_time Recording start time
+ * @param end_time Recording end time
+ * @param sign 1 to add the range, -1 to remove it
+ * @return 0 on success, -1 on error
+ */
+int timeline_rollup_add_coverage(sqlite3 *db, const char *stream_name, time_t start_time,
+                                 time_t end_time, int sign);
+
+/**
+ * Add detections stored at one timestamp to the rollups
+ *
+ * Runs on the caller's connection, inside its transaction.
+ *
+ * @param db Database connection
+ * @param stream_name Stream name
+ * @param timestamp Detection time
+ * @param detections Detections
+ * @param count Number of detections
+ * @return 0 on success, -1 on error
+ */
+int timeline_rollup_add_detections(sqlite3 *db, const char *stream_name, time_t timestamp,
+                                   const detection_t *detections, int count);
+
+/**
+ * Rebuild every rollup from the recordings and detections tables
+ *
+ * @param db Database connection
+ * @return 0 on success, -1 on error
+ */
+int timeline_rollup_rebuild(sqlite3 *db);
+
+/**
+ * Rebuild the rollups if they were aligned in another time zone
+ *
+ * Must be called before other threads use the connection.
+ *
+ * @param db Database connection
+ * @return 0 on success, -1 on error
+ */
+int timeline_rollup_check_zone(sqlite3 *db);
+
+/**
+ * Delete the buckets that end before a time
+ *
+ * @param stream_name Stream name, or NULL for all streams
+ * @param before Cutoff time
+ * @return 0 on success, -1 on error
+ */
+int prune_timeline_rollups(const char *stream_name, time_t before);
+
+/**
+ * Get the activity buckets of a time range
+ *
+ * Buckets without any activity are not returned.
+ *
+ * @param stream_name Stream name, or NULL for all streams
+ * @param start_time Start of the range
+ * @param end_time End of the range
+ * @param resolution Resolution index
+ * @param buckets Array to fill, ordered by start time
+ * @param max_buckets Size of the array
+ * @return Number of buckets, or -1 on error
+ */
+int get_timeline_heatmap(const char *stream_name, time_t start_time, time_t end_time, int resolution,
+                         timeline_heatmap_bucket_t *buckets, int max_buckets);
+
+/**
+ * Get the detections by label of a time range
+ *
+ * @param stream_name Stream name, or NULL for all streams
+ * @param start_time Start of the range
+ * @param end_time End of the range
+ * @param resolution Resolution index
+ * @param labels Array to fill, ordered by bucket start time
+ * @param max_labels Size of the array
+ * @return Number of entries, or -1 on error
+ */
+int get_timeline_heatmap_labels(const char *stream_name, time_t start_time, time_t end_time, int resolution,
+                                timeline_heatmap_label_t *labels, int max_labels);
+
+#endif // LIGHTNVR_DB_TIMELINE_ROLLUPS_H
@@ -0,0 +1,104 @@
+#ifndef LIGHTNVR_DB_WRITER_H
+#define LIGHTNVR_DB_WRITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sqlite3.h>
+
+/**
+ * Group commit writer
+ *
+ * Inserts and updates from all streams (detections, events, recording
+ * metadata) are queued to a single writer thread, which runs everything that
+ * arrived within the commit interval in one transaction. Each write runs in its
+ * own savepoint, so a failing write does not take the rest of the batch with
+ * it. A few commits per second replace one commit, and one fsync, per row.
+ *
+ * Submitters get a future completed once the transaction holding their write
+ * is committed, or can pass NULL and not wait at all. A submitter blocked in
+ * db_write_future_wait() cuts the commit interval short, a future that is only
+ * kept does not; writes arriving while a commit runs share the next.
+ */
+
+typedef struct db_write_future db_write_future_t;
+
+/**
+ * Operations of a queued write
+ */
+typedef struct {
+    // Run the write on the writer connection, inside the batch transaction and
+    // with the database mutex held. Returns 0 on success and may set *row_id.
+    int (*execute)(sqlite3 *db, void *arg, uint64_t *row_id);
+
+    // Optional, called once the write is committed, without the database mutex
+    void (*committed)(void *arg, uint64_t row_id);
+
+    // Optional, releases arg once the write is done
+    void (*free_arg)(void *arg);
+} db_write_ops_t;
+
+/**
+ * Set the batching and durability options used by the next db_writer_init()
+ *
+ * @param commit_interval_ms Longest a write waits for others to share its commit, 0 commits as soon as the writer is idle
+ * @param batch_size Maximum writes per transaction
+ * @param synchronous SQLite synchronous mode: "off", "normal", "full" or "extra"
+ */
+void db_writer_configure(int commit_interval_ms, int batch_size, const char *synchronous);
+
+/**
+ * Start the writer thread
+ * Called by init_database() once the database is open
+ *
+ * @param db Writer connection
+ * @return 0 on success, non-zero on failure
+ */
+int db_writer_init(sqlite3 *db);
+
+/**
+ * Commit the queued writes and stop the writer thread
+ * Called by shutdown_database() before the connection is closed
+ */
+void db_writer_shutdown(void);
+
+/**
+ * Queue a write
+ *
+ * Blocks while the queue is full. When the writer thread is not running the
+ * write is executed and committed immediately by the calling thread.
+ *
+ * @param ops Write operations
+ * @param arg Argument of the operations, owned by the writer from now on
+ * @param future Pointer to store the completion future, NULL to not wait
+ * @return 0 if the write was queued or executed, non-zero on failure (arg is released)
+ */
+int db_writer_submit(const db_write_ops_t *ops, void *arg, db_write_future_t **future);
+
+/**
+ * Wait for a queued write to be committed and release its future
+ *
+ * A write still queued is committed as soon as the writer is idle.
+ *
+ * @param future Future from db_writer_submit()
+ * @param row_id Pointer to store the row ID set by the write, may be NULL
+ * @return 0 if the write was committed, non-zero on failure
+ */
+int db_write_future_wait(db_write_future_t *future, uint64_t *row_id);
+
+/**
+ * Release a future without waiting for it
+ *
+ * @param future Future from db_writer_submit(), may be NULL
+ */
+void db_write_future_release(db_write_future_t *future);
+
+/**
+ * Get writer statistics
+ *
+ * @param commits Pointer to store the number of transactions committed, may be NULL
+ * @param writes Pointer to store the number of writes executed, may be NULL
+ * @param queued Pointer to store the number of writes waiting, may be NULL
+ */
+void db_writer_get_stats(uint64_t *commits, uint64_t *writes, int *queued);
+
+#endif // LIGHTNVR_DB_WRITER_H
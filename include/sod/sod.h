@@ -156,7 +156,8 @@ typedef enum {
 	SOD_RNN_CALLBACK,
 	SOD_RNN_TEXT_LENGTH,
 	SOD_RNN_DATA_LENGTH,
-	SOD_RNN_SEED
+	SOD_RNN_SEED,
+	SOD_CNN_NUM_THREADS /* int: CPU threads shared by all networks for convolutions, 1 disables threading */
 }SOD_CNN_CONFIG;
 /* 
  * RNN Consumer callback to be used in conjunction with the `SOD_RNN_CALLBACK` configuration verb.
@@ -239,6 +240,12 @@ SOD_APIEXPORT int  sod_cnn_predict(sod_cnn *pNet, float *pInput, sod_box **paBox
 SOD_APIEXPORT void sod_cnn_destroy(sod_cnn *pNet);
 SOD_APIEXPORT float *  sod_cnn_prepare_image(sod_cnn *pNet, sod_img in);
 SOD_APIEXPORT int sod_cnn_get_network_size(sod_cnn *pNet, int *pWidth, int *pHeight, int *pChannels);
+SOD_APIEXPORT int  sod_cnn_create_batch(sod_cnn **ppOut, const char *zArch, const char *zModelPath, int nBatch, const char **pzErr);
+SOD_APIEXPORT float *  sod_cnn_prepare_batch_image(sod_cnn *pNet, int iSlot, sod_img in);
+SOD_APIEXPORT int  sod_cnn_predict_batch(sod_cnn *pNet, int nImages, sod_box **paBox, int *anBox);
+SOD_APIEXPORT int  sod_cnn_calibrate(sod_cnn *pNet, float *pInput);
+SOD_APIEXPORT int  sod_cnn_save_quantized(sod_cnn *pNet, const char *zArch, const char *zPath);
+SOD_APIEXPORT int  sod_cnn_create_quantized(sod_cnn **ppOut, const char *zPath, int nBatch, const char **pzErr);
 #endif /* SOD_DISABLE_CNN */
 #ifndef SOD_DISABLE_REALNET
 /*
@@ -130,6 +130,14 @@ int set_max_storage_size(uint64_t max_size);
  */
 int set_retention_days(int days);
 
+/**
+ * Set retention days for recordings that overlap a detection
+ * 
+ * @param days Number of days to keep such recordings (0 to use the normal retention)
+ * @return 0 on success, non-zero on failure
+ */
+int set_detection_retention_days(int days);
+
 /**
  * Check if storage is available
  * 
@@ -0,0 +1,110 @@
+/**
+ * Detection Frame Tap
+ *
+ * Decodes frames for object detection straight from the live packet path
+ * (see packet_fanout.h). Only keyframes, or every Nth frame, are decoded,
+ * converted with a cached SwsContext and pushed into a small per-stream
+ * queue that the detection thread pops from.
+ */
+
+#ifndef DETECTION_FRAME_TAP_H
+#define DETECTION_FRAME_TAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Number of converted frames queued per stream; the oldest is dropped when full
+#define DETECTION_FRAME_TAP_QUEUE_SIZE 2
+
+// Decode only keyframes
+#define DETECTION_FRAME_TAP_KEYFRAMES_ONLY 0
+
+typedef struct detection_frame_tap detection_frame_tap_t;
+
+/**
+ * Frame ready for detection
+ */
+typedef struct {
+    uint8_t *data;          // Packed pixels, owned by the frame
+    int width;
+    int height;
+    int channels;           // 3 for RGB, 1 for grayscale
+    time_t timestamp;       // Wall-clock time the frame was decoded
+} detection_frame_t;
+
+/**
+ * Tap statistics
+ */
+typedef struct {
+    uint64_t frames_decoded;
+    uint64_t frames_queued;
+    uint64_t frames_dropped;    // Frames discarded because the queue was full
+    uint64_t decode_errors;
+} detection_frame_tap_stats_t;
+
+/**
+ * Start a frame tap for a stream
+ *
+ * @param stream_name Name of the stream
+ * @param decode_every_n Decode every Nth video frame, or DETECTION_FRAME_TAP_KEYFRAMES_ONLY
+ * @param min_interval_sec Minimum time between queued frames in seconds (0 for no limit)
+ * @param downscale_factor Factor by which to downscale frames (1 for full size)
+ * @param channels 3 to produce RGB24 frames, 1 for grayscale
+ * @return Tap handle, or NULL on failure or when shared ingest is disabled
+ */
+detection_frame_tap_t *detection_frame_tap_start(const char *stream_name, int decode_every_n,
+                                                 int min_interval_sec, int downscale_factor, int channels);
+
+/**
+ * Stop a frame tap and free any queued frames
+ *
+ * @param tap Tap handle
+ */
+void detection_frame_tap_stop(detection_frame_tap_t *tap);
+
+/**
+ * Pop the oldest queued frame
+ *
+ * On success the caller owns frame->data and must release it with
+ * detection_frame_release().
+ *
+ * @param tap Tap handle
+ * @param frame Frame to fill
+ * @param timeout_ms Maximum time to wait in milliseconds
+ * @return 0 on success, 1 on timeout, -1 if the tap stopped
+ */
+int detection_frame_tap_pop(detection_frame_tap_t *tap, detection_frame_t *frame, int timeout_ms);
+
+/**
+ * Change the minimum interval between queued frames
+ *
+ * @param tap Tap handle
+ * @param min_interval_sec Minimum interval in seconds
+ */
+void detection_frame_tap_set_interval(detection_frame_tap_t *tap, int min_interval_sec);
+
+/**
+ * Check whether the tap's decoder thread is still running
+ *
+ * @param tap Tap handle
+ * @return true if running
+ */
+bool detection_frame_tap_is_running(detection_frame_tap_t *tap);
+
+/**
+ * Get statistics for a tap
+ *
+ * @param tap Tap handle
+ * @param stats Statistics to fill
+ */
+void detection_frame_tap_get_stats(detection_frame_tap_t *tap, detection_frame_tap_stats_t *stats);
+
+/**
+ * Release the pixel data of a popped frame
+ *
+ * @param frame Frame returned by detection_frame_tap_pop()
+ */
+void detection_frame_release(detection_frame_t *frame);
+
+#endif /* DETECTION_FRAME_TAP_H */
@@ -30,6 +30,17 @@ bool is_model_supported(const char *model_path);
  */
 const char* get_model_type(const char *model_path);
 
+/**
+ * Check if a model file is an int8 quantized SOD CNN model (*.q8.sod)
+ *
+ * Quantized models are created from float models with the sod_quantize tool.
+ * They carry their network architecture, no architecture detection is needed.
+ *
+ * @param model_path Path to the model file
+ * @return true if the model is quantized, false otherwise
+ */
+bool is_quantized_model(const char *model_path);
+
 /**
  * Load a detection model
  *
@@ -7,6 +7,7 @@
 #define GO2RTC_PROCESS_H
 
 #include <stdbool.h>
+#include <sys/types.h>
 
 /**
  * @brief Initialize the go2rtc process manager
@@ -60,4 +61,14 @@ void go2rtc_process_cleanup(void);
  */
 int go2rtc_process_get_rtsp_port(void);
 
+/**
+ * @brief Get the process ID of go2rtc
+ * 
+ * Returns the tracked process, or one found by scanning /proc when go2rtc was
+ * started by someone else. Does not fork.
+ * 
+ * @return pid_t The process ID, or -1 if no go2rtc process was found
+ */
+pid_t go2rtc_process_get_pid(void);
+
 #endif /* GO2RTC_PROCESS_H */
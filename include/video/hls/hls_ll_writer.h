@@ -0,0 +1,82 @@
+#ifndef HLS_LL_WRITER_H
+#define HLS_LL_WRITER_H
+
+#include <stdint.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+
+/**
+ * Low-latency HLS writer
+ *
+ * Packages video as fragmented MP4 (CMAF) with an init segment, publishes
+ * each fragment as an EXT-X-PART as soon as it is complete and advertises
+ * the next part with EXT-X-PRELOAD-HINT. Files are written next to the
+ * regular HLS output (index.m3u8, init.mp4, segment_<msn>.m4s and
+ * segment_<msn>.<part>.m4s) and served by the direct HLS handler, which
+ * implements blocking playlist reload on top of hls_ll_writer_is_available().
+ */
+
+// Number of complete segments listed in the playlist
+#define HLS_LL_PLAYLIST_SEGMENTS 6
+
+// Number of most recent complete segments whose parts are still listed
+#define HLS_LL_PART_SEGMENTS 2
+
+// Upper bound on parts per segment; further fragments are merged into the last part
+#define HLS_LL_MAX_PARTS 128
+
+typedef struct hls_ll_writer hls_ll_writer_t;
+
+/**
+ * Create a low-latency HLS writer
+ *
+ * @param output_dir Directory for the playlist and media files
+ * @param stream_name Name of the stream
+ * @param segment_duration Target segment duration in seconds
+ * @param part_duration_ms Target part duration in milliseconds
+ * @return Writer or NULL on failure
+ */
+hls_ll_writer_t *hls_ll_writer_create(const char *output_dir, const char *stream_name,
+                                      int segment_duration, int part_duration_ms);
+
+/**
+ * Write the init segment for the given video stream
+ *
+ * @param writer Writer
+ * @param input_stream Input video stream
+ * @return 0 on success, negative on error
+ */
+int hls_ll_writer_initialize(hls_ll_writer_t *writer, const AVStream *input_stream);
+
+/**
+ * Write a video packet
+ *
+ * @param writer Writer
+ * @param pkt Packet to write (not modified)
+ * @param input_stream Input video stream
+ * @return 0 on success, negative on error
+ */
+int hls_ll_writer_write_packet(hls_ll_writer_t *writer, const AVPacket *pkt, const AVStream *input_stream);
+
+/**
+ * Close the writer and free its resources
+ *
+ * @param writer Writer
+ */
+void hls_ll_writer_close(hls_ll_writer_t *writer);
+
+// Result of hls_ll_writer_is_available() for a segment more than two past the last complete one
+#define HLS_LL_WRITER_TOO_FAR_AHEAD (-2)
+
+/**
+ * Check whether a part or segment of a stream has been published
+ *
+ * @param stream_name Name of the stream
+ * @param msn Media sequence number of the segment
+ * @param part Part index within the segment, or -1 for the whole segment
+ * @return 1 if published, 0 if not yet, -1 if the stream has no low-latency writer,
+ *         HLS_LL_WRITER_TOO_FAR_AHEAD if it is too far ahead to wait for
+ */
+int hls_ll_writer_is_available(const char *stream_name, int64_t msn, int part);
+
+#endif /* HLS_LL_WRITER_H */
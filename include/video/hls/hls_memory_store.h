@@ -0,0 +1,94 @@
+#ifndef HLS_MEMORY_STORE_H
+#define HLS_MEMORY_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <libavformat/avformat.h>
+
+/**
+ * In-memory HLS segment store
+ *
+ * Keeps the playlist and a bounded ring of the most recent segments of each
+ * stream in RAM so live HLS never touches the disk. The FFmpeg hls muxer
+ * writes into the store through custom io_open/io_close callbacks, and the
+ * web server answers from the published buffers instead of reading files.
+ * Published files are immutable and reference counted, so readers never
+ * copy under the lock and a segment evicted while it is being sent stays
+ * valid until released. Sending still copies the buffer into the
+ * connection's send buffer.
+ */
+
+// Default number of segments kept per stream
+#define HLS_MEMORY_DEFAULT_SEGMENTS 8
+
+// URL prefix given to the muxer for files that live in the store
+#define HLS_MEMORY_URL_PREFIX "mem://hls/"
+
+/**
+ * Published file
+ */
+typedef struct {
+    atomic_int refcount;
+    size_t size;
+    uint8_t data[];
+} hls_memory_file_t;
+
+/**
+ * Create the store of a stream, or reset it if it already exists
+ *
+ * @param stream_name Name of the stream
+ * @param max_segments Number of segments to keep
+ * @return 0 on success, -1 on error
+ */
+int hls_memory_store_open(const char *stream_name, int max_segments);
+
+/**
+ * Remove the store of a stream and release its files
+ *
+ * @param stream_name Name of the stream
+ */
+void hls_memory_store_close(const char *stream_name);
+
+/**
+ * Route all files written by a muxer into the store of a stream
+ *
+ * Sets io_open and io_close2 (io_close before libavformat 59) on the context; the hls muxer passes them on to
+ * the segment muxer it creates. The stream name must outlive the context.
+ *
+ * @param ctx Output format context
+ * @param stream_name Name of the stream
+ */
+void hls_memory_store_attach(AVFormatContext *ctx, const char *stream_name);
+
+/**
+ * Look up a published file
+ *
+ * @param stream_name Name of the stream
+ * @param file_name File name as referenced by the playlist
+ * @return Referenced file (release with hls_memory_store_release) or NULL
+ */
+hls_memory_file_t *hls_memory_store_get(const char *stream_name, const char *file_name);
+
+/**
+ * Release a file returned by hls_memory_store_get
+ *
+ * @param file File to release
+ */
+void hls_memory_store_release(hls_memory_file_t *file);
+
+/**
+ * Check whether a stream is served from memory
+ *
+ * @param stream_name Name of the stream
+ * @return 1 if the stream has a store, 0 otherwise
+ */
+int hls_memory_store_has_stream(const char *stream_name);
+
+/**
+ * Release all stores
+ * This function should be called during program shutdown
+ */
+void hls_memory_store_cleanup(void);
+
+#endif /* HLS_MEMORY_STORE_H */
@@ -11,6 +11,8 @@
 // Use a different name to avoid conflict with MAX_PATH_LENGTH in config.h
 #define HLS_MAX_PATH_LENGTH 1024
 
+struct hls_ll_writer;
+
 // Forward declaration for the DTS tracking structure
 typedef struct {
     int64_t first_dts;
@@ -42,6 +44,12 @@ typedef struct hls_writer_t {
     // Thread context for standalone operation
     void *thread_ctx;
 
+    // Low-latency fMP4 writer, used instead of output_ctx when LL-HLS is enabled
+    struct hls_ll_writer *ll_writer;
+
+    // Playlist and segments are written to the in-memory store instead of output_dir
+    int memory_store;
+
     // Mutex for thread safety
     pthread_mutex_t mutex;
 } hls_writer_t;
@@ -0,0 +1,75 @@
+#ifndef INFERENCE_SCHEDULER_H
+#define INFERENCE_SCHEDULER_H
+
+#include "video/detection_result.h"
+
+/**
+ * CNN model shared by every stream that loads it
+ *
+ * The weights are loaded once per model file. Frames submitted by the streams
+ * using the model are queued and run through the network together, in one
+ * batched forward pass.
+ */
+typedef struct inference_model inference_model_t;
+
+/**
+ * Initialize the inference scheduler
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int init_inference_scheduler(void);
+
+/**
+ * Shutdown the inference scheduler
+ *
+ * Pending frames fail and the worker threads of all models are stopped.
+ */
+void shutdown_inference_scheduler(void);
+
+/**
+ * Check if frames are batched across streams
+ *
+ * @return Non-zero if batching is enabled in the configuration
+ */
+int is_inference_batching_enabled(void);
+
+/**
+ * Get a reference to a shared CNN model, loading it on first use
+ *
+ * @param model_path Path to the model file
+ * @param arch SOD architecture of the model (":face", ":voc", ...), unused by quantized models
+ * @param threshold Detection confidence threshold of the caller (0.0-1.0)
+ * @return Model handle or NULL on failure
+ */
+inference_model_t *inference_scheduler_acquire(const char *model_path, const char *arch,
+                                               float threshold);
+
+/**
+ * Release a reference obtained with inference_scheduler_acquire()
+ *
+ * The model is unloaded when its last reference is released.
+ *
+ * @param model Model handle
+ */
+void inference_scheduler_release(inference_model_t *model);
+
+/**
+ * Run detection on a frame through the batch queue of a model
+ *
+ * Blocks until the batch holding the frame has been processed, at most the
+ * configured maximum latency plus the forward pass itself.
+ *
+ * @param model Model handle
+ * @param frame_data Frame data (packed, channels bytes per pixel)
+ * @param width Frame width
+ * @param height Frame height
+ * @param channels Number of color channels
+ * @param threshold Detection confidence threshold (0.0-1.0)
+ * @param result Pointer to detection result structure to fill
+ * @return 0 on success, non-zero on failure
+ */
+int inference_scheduler_detect(inference_model_t *model, const unsigned char *frame_data,
+                               int width, int height, int channels, float threshold,
+                               detection_result_t *result);
+
+#endif /* INFERENCE_SCHEDULER_H */
@@ -2,10 +2,19 @@
 #define MOTION_DETECTION_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 #include "../video/detection_result.h"
 
+/**
+ * Motion detection state of a stream
+ *
+ * Handles are created on first use and stay valid until
+ * shutdown_motion_detection_system() is called.
+ */
+typedef struct motion_stream motion_stream_t;
+
 /**
  * Initialize the motion detection system
  * 
@@ -46,6 +55,57 @@ int detect_motion(const char *stream_name, const unsigned char *frame_data,
                  int width, int height, int channels, time_t frame_time,
                  detection_result_t *result);
 
+/**
+ * Process the luma plane of a decoded frame for motion detection
+ *
+ * Takes the Y plane of a YUV frame as it comes from the decoder
+ * (frame->data[0] and frame->linesize[0]), so no RGB conversion or copy is
+ * needed. Working buffers are allocated when the frame size or the
+ * configuration changes, never per frame.
+ *
+ * @param stream_name The name of the stream
+ * @param luma First pixel of the luma plane
+ * @param stride Bytes between the starts of two luma rows
+ * @param width Frame width
+ * @param height Frame height
+ * @param frame_time Timestamp of the frame
+ * @param result Pointer to detection result structure to fill
+ * @return 0 on success, non-zero on failure
+ */
+int detect_motion_luma(const char *stream_name, const uint8_t *luma, int stride,
+                       int width, int height, time_t frame_time,
+                       detection_result_t *result);
+
+/**
+ * Get the motion detection handle of a stream, creating it if needed
+ *
+ * Resolving the handle once lets the thread feeding frames skip the
+ * name lookup on every frame.
+ *
+ * @param stream_name The name of the stream
+ * @return Stream handle, or NULL if no more streams can be created
+ */
+motion_stream_t *get_motion_stream_handle(const char *stream_name);
+
+/**
+ * Process the luma plane of a decoded frame through a stream handle
+ *
+ * Same as detect_motion_luma() without the stream lookup. Only one thread
+ * should feed frames to a stream at a time.
+ *
+ * @param stream Handle from get_motion_stream_handle()
+ * @param luma First pixel of the luma plane
+ * @param stride Bytes between the starts of two luma rows
+ * @param width Frame width
+ * @param height Frame height
+ * @param frame_time Timestamp of the frame
+ * @param result Pointer to detection result structure to fill
+ * @return 0 on success, non-zero on failure
+ */
+int detect_motion_luma_handle(motion_stream_t *stream, const uint8_t *luma, int stride,
+                              int width, int height, time_t frame_time,
+                              detection_result_t *result);
+
 /**
  * Configure advanced motion detection parameters
  * 
@@ -88,4 +148,36 @@ int set_motion_detection_enabled(const char *stream_name, bool enabled);
  */
 bool is_motion_detection_enabled(const char *stream_name);
 
+/**
+ * Get memory usage statistics for motion detection
+ *
+ * Statistics are read without blocking the thread processing frames.
+ *
+ * @param stream_name The name of the stream
+ * @param allocated_memory Filled with the memory currently allocated in bytes
+ * @param peak_memory Filled with the peak memory usage in bytes
+ * @return 0 on success, -1 if the stream has no motion detection state
+ */
+int get_motion_detection_memory_usage(const char *stream_name, size_t *allocated_memory, size_t *peak_memory);
+
+/**
+ * Get CPU usage statistics for motion detection
+ *
+ * @param stream_name The name of the stream
+ * @param avg_processing_time Filled with the average frame processing time in milliseconds
+ * @param peak_processing_time Filled with the peak frame processing time in milliseconds
+ * @return 0 on success, -1 if the stream has no motion detection state
+ */
+int get_motion_detection_cpu_usage(const char *stream_name, float *avg_processing_time, float *peak_processing_time);
+
+/**
+ * Reset performance statistics for motion detection
+ *
+ * The reset is applied by the detection thread when it processes the next frame.
+ *
+ * @param stream_name The name of the stream
+ * @return 0 on success, -1 if the stream has no motion detection state
+ */
+int reset_motion_detection_statistics(const char *stream_name);
+
 #endif /* MOTION_DETECTION_H */
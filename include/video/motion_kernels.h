@@ -0,0 +1,98 @@
+#ifndef MOTION_KERNELS_H
+#define MOTION_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Row kernels used by motion detection
+ *
+ * Each kernel set implements the same operations for one instruction set.
+ * The best set supported by the CPU is selected once at runtime, the scalar
+ * set is used when no vector unit is available.
+ */
+typedef struct {
+    const char *name;
+
+    // acc[i] += src[i]
+    void (*accumulate_row)(const uint8_t *src, uint16_t *acc, int n);
+
+    // dst[x] = sum of acc[x * factor .. x * factor + factor - 1] / (factor * factor)
+    void (*reduce_row)(const uint16_t *acc, uint8_t *dst, int out_width, int factor);
+
+    // Box blur of radius 0..5 along a row, the window shrinks at the row edges
+    void (*hblur_row)(const uint8_t *src, uint8_t *dst, int n, int radius);
+
+    // colsum[i] += add[i] - sub[i]
+    void (*column_update)(uint16_t *colsum, const uint8_t *add, const uint8_t *sub, int n);
+
+    // dst[i] = colsum[i] / count, count in 1..16
+    void (*column_average)(const uint16_t *colsum, uint8_t *dst, int n, int count);
+
+    // For each pixel, diff = max(|cur - prev|, |cur - bg|); pixels with diff > threshold
+    // are added to *changed and their diff to *total
+    void (*diff_row)(const uint8_t *cur, const uint8_t *prev, const uint8_t *bg, int n,
+                     int threshold, uint32_t *changed, uint32_t *total);
+
+    // bg[i] = ((256 - alpha) * bg[i] + alpha * cur[i]) >> 8
+    void (*background_row)(uint8_t *bg, const uint8_t *cur, int n, int alpha);
+} motion_kernels_t;
+
+/**
+ * Parameters of a fused motion pass
+ */
+typedef struct {
+    const uint8_t *src;         // Source frame, packed RGB or a luma plane
+    int src_stride;             // Bytes between the starts of two source rows
+    int src_width;
+    int src_height;
+    int channels;               // 1 or 3
+    int factor;                 // Downscale factor, width = src_width / factor
+    int width;                  // Processing width
+    int height;                 // Processing height
+    int blur_radius;            // Box blur radius (0-5)
+
+    uint8_t *out;               // Blurred processing frame (width * height)
+    const uint8_t *prev;        // Previous blurred frame, NULL on the first frame
+    uint8_t *background;        // Background model, updated in place
+    int alpha;                  // Background learning rate (8-bit fixed point)
+    int threshold;              // Differences above this count as motion
+
+    int grid_size;              // Cells per side, 1 for the whole frame
+    uint32_t *cell_changed;     // grid_size * grid_size changed pixel counts
+    uint32_t *cell_total;       // grid_size * grid_size summed differences
+
+    uint8_t *scratch;           // motion_scratch_size() bytes
+} motion_pass_t;
+
+/**
+ * Get the kernel set selected for this CPU
+ *
+ * @return Kernel set, never NULL
+ */
+const motion_kernels_t *motion_kernels_get(void);
+
+/**
+ * Get the scratch memory needed by motion_fused_pass
+ *
+ * @param src_width Source frame width
+ * @param width Processing width
+ * @param blur_radius Blur radius
+ * @return Size in bytes
+ */
+size_t motion_scratch_size(int src_width, int width, int blur_radius);
+
+/**
+ * Run luma conversion, downscale, blur, frame differencing and background
+ * update over a frame in a single pass of row bands
+ *
+ * Each processing row is built from its source rows, blurred through a ring of
+ * rows and compared against the previous frame and background while it is
+ * still in cache. Cell counters are accumulated, not reset.
+ *
+ * @param kernels Kernel set
+ * @param pass Pass parameters
+ */
+void motion_fused_pass(const motion_kernels_t *kernels, const motion_pass_t *pass);
+
+#endif /* MOTION_KERNELS_H */
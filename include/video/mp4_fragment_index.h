@@ -0,0 +1,53 @@
+/**
+ * MP4 Fragment Index Header
+ *
+ * Reads the layout of a fragmented MP4 recording: the byte range of its
+ * initialization section (ftyp and moov) and the byte range, start time and
+ * duration of every moof/mdat fragment. The segment recorder cuts a fragment
+ * at each video keyframe, so this is the keyframe index of the file and any
+ * fragment can be played on its own after the initialization section.
+ *
+ * Only box headers, moov and moof boxes are read, never the media data.
+ */
+
+#ifndef MP4_FRAGMENT_INDEX_H
+#define MP4_FRAGMENT_INDEX_H
+
+#include <stdint.h>
+
+/**
+ * One moof/mdat fragment
+ */
+typedef struct {
+    uint64_t offset;
+    uint64_t length;
+    double start;               // Seconds from the first fragment
+    double duration;            // Seconds
+} mp4_fragment_t;
+
+/**
+ * Fragments of a file
+ */
+typedef struct {
+    uint64_t init_length;       // Length of the initialization section, which starts at offset 0
+    int count;
+    mp4_fragment_t *fragments;
+} mp4_fragment_index_t;
+
+/**
+ * Read the fragment index of a file
+ *
+ * @param path Path of the MP4 file
+ * @param index Index to fill, release with mp4_fragment_index_free()
+ * @return 0 on success, -1 if the file cannot be read or is not fragmented
+ */
+int mp4_fragment_index_load(const char *path, mp4_fragment_index_t *index);
+
+/**
+ * Release the fragments of an index
+ *
+ * @param index Index to release
+ */
+void mp4_fragment_index_free(mp4_fragment_index_t *index);
+
+#endif /* MP4_FRAGMENT_INDEX_H */
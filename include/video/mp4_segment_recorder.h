@@ -1,51 +1,115 @@
 /**
  * MP4 Segment Recorder Header
  *
- * This module handles the recording of individual MP4 segments from RTSP streams.
+ * This module turns a continuous packet stream into a series of MP4 files.
  * It's responsible for:
- * - Opening RTSP streams
  * - Creating MP4 files
  * - Handling timestamps and packet processing
  * - Managing segment rotation
+ *
+ * A segmenter lives as long as the recording and never touches the input:
+ * the caller keeps the stream open and feeds every packet. A new file is
+ * started on the first video keyframe after the target duration, and that
+ * keyframe opens the next file, so consecutive files share their boundary
+ * and no GOP is lost.
  */
 
 #ifndef MP4_SEGMENT_RECORDER_H
 #define MP4_SEGMENT_RECORDER_H
 
 #include <stdbool.h>
+#include <time.h>
 #include <libavformat/avformat.h>
 
+typedef struct mp4_segmenter mp4_segmenter_t;
+
 /**
- * Structure to track segment information
+ * Notifications about segment files
+ *
+ * Times are wall-clock times derived from stream timestamps, so the end time
+ * of one file equals the start time of the next.
  */
 typedef struct {
-    int segment_index;
-    bool has_audio;
-    bool last_frame_was_key;  // Flag to indicate if the last frame of previous segment was a key frame
-} segment_info_t;
+    // Called after a new file has been opened and its header written
+    void (*on_segment_open)(const char *path, time_t start_time, void *user_data);
+    // Called after a file has been finalized
+    void (*on_segment_close)(const char *path, time_t start_time, time_t end_time, void *user_data);
+    void *user_data;
+} mp4_segmenter_callbacks_t;
+
+/**
+ * Create a segmenter for a stream
+ *
+ * @param stream_name Name of the stream (used for logging)
+ * @param output_dir Directory where MP4 files are created
+ * @param segment_duration Target duration of each file in seconds
+ * @param has_audio Whether to include audio in the recording
+ * @param callbacks Segment notifications (can be NULL)
+ * @return Segmenter or NULL on failure
+ */
+mp4_segmenter_t *mp4_segmenter_create(const char *stream_name, const char *output_dir,
+                                      int segment_duration, int has_audio,
+                                      const mp4_segmenter_callbacks_t *callbacks);
 
 /**
- * Record an RTSP stream to an MP4 file for a specified duration
+ * Set or replace the input streams packets will come from
  *
- * This function handles the actual recording of an RTSP stream to an MP4 file.
- * It maintains a single RTSP connection across multiple recording segments,
- * ensuring there are no gaps between segments.
+ * Call once after opening the input and again whenever it reconnects. If the
+ * codec parameters are unchanged the current file stays open and timestamps
+ * continue from the last written packet; otherwise the current file is
+ * finalized and the next keyframe starts a new one.
  *
- * Error handling:
- * - Network errors: The function will return an error code, but the input context
- *   will be preserved if possible so that the caller can retry.
- * - File system errors: The function will attempt to clean up resources and return
- *   an error code.
- * - Timestamp errors: The function uses a robust timestamp handling approach to
- *   prevent floating point errors and timestamp inflation.
+ * @param segmenter Segmenter
+ * @param video Input video stream
+ * @param audio Input audio stream or NULL
+ * @return 0 on success, negative on error
+ */
+int mp4_segmenter_set_input(mp4_segmenter_t *segmenter, const AVStream *video, const AVStream *audio);
+
+/**
+ * Write one input packet
+ *
+ * pkt->stream_index must match the index of the video or audio stream given
+ * to mp4_segmenter_set_input(); other packets are ignored. The packet may be
+ * consumed by the muxer, so the caller must not reuse its contents but still
+ * has to av_packet_unref() it.
+ *
+ * @param segmenter Segmenter
+ * @param pkt Packet to write
+ * @return 0 on success, negative on error
+ */
+int mp4_segmenter_write_packet(mp4_segmenter_t *segmenter, AVPacket *pkt);
+
+/**
+ * Change the target segment duration, effective from the next boundary
+ *
+ * @param segmenter Segmenter
+ * @param segment_duration Duration in seconds
+ */
+void mp4_segmenter_set_duration(mp4_segmenter_t *segmenter, int segment_duration);
+
+/**
+ * Enable or disable audio, effective from the next file
+ *
+ * @param segmenter Segmenter
+ * @param has_audio Whether to include audio
+ */
+void mp4_segmenter_set_audio(mp4_segmenter_t *segmenter, int has_audio);
+
+/**
+ * Finalize the current file, if any
+ *
+ * @param segmenter Segmenter
+ * @return 0 on success, negative on error
+ */
+int mp4_segmenter_finish(mp4_segmenter_t *segmenter);
+
+/**
+ * Finalize the current file and free the segmenter
  *
- * @param rtsp_url The URL of the RTSP stream to record
- * @param output_file The path to the output MP4 file
- * @param duration The duration to record in seconds
- * @param has_audio Flag indicating whether to include audio in the recording
- * @return 0 on success, negative value on error
+ * @param segmenter Segmenter
  */
-int record_segment(const char *rtsp_url, const char *output_file, int duration, int has_audio);
+void mp4_segmenter_destroy(mp4_segmenter_t *segmenter);
 
 /**
  * Initialize the MP4 segment recorder
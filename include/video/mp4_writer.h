@@ -43,6 +43,7 @@ struct mp4_writer {
     mp4_audio_state_t audio;  // Audio state - completely separate from video
     pthread_mutex_t mutex;    // Mutex to protect video state
     uint64_t current_recording_id; // ID of the current recording in the database
+    struct db_write_future *pending_recording; // Insert of the current recording until its ID is known
 
     // Segment-related fields
     int segment_duration;     // Duration of each segment in seconds
@@ -39,4 +39,14 @@ int apply_h264_annexb_filter(AVPacket *packet, enum AVCodecID codec_id);
  */
 int mp4_writer_write_packet(mp4_writer_t *writer, const AVPacket *in_pkt, const AVStream *input_stream);
 
+/**
+ * Get the database ID of the current recording
+ * The recording is inserted without waiting for the commit; its ID is taken
+ * from the insert here, waiting only if the insert has not committed yet.
+ *
+ * @param writer The MP4 writer instance
+ * @return Recording ID, or 0 if the insert failed
+ */
+uint64_t mp4_writer_get_recording_id(mp4_writer_t *writer);
+
 #endif /* MP4_WRITER_INTERNAL_H */
@@ -0,0 +1,172 @@
+/**
+ * Packet Fan-out
+ *
+ * A single demux session per stream, shared by every in-process consumer.
+ * The stream reader (see stream_reader.h) publishes each packet into a
+ * refcounted ring, and HLS, MP4 and detection consumers subscribe to that
+ * ring with their own read cursor and backpressure policy. Packet payloads
+ * are shared through AVPacket reference counting, so subscribing does not
+ * copy any media data.
+ */
+
+#ifndef PACKET_FANOUT_H
+#define PACKET_FANOUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+
+// Default number of packets kept in a stream's ring
+#define PACKET_FANOUT_DEFAULT_CAPACITY 512
+
+// Maximum number of subscribers per stream
+#define PACKET_FANOUT_MAX_READERS 8
+
+typedef struct packet_fanout packet_fanout_t;
+typedef struct packet_fanout_reader packet_fanout_reader_t;
+
+/**
+ * Backpressure policy for a subscriber
+ *
+ * The producer never waits for a consumer. A consumer that falls too far
+ * behind is moved forward according to its policy.
+ */
+typedef enum {
+    // Read every packet; if lapped by the producer, resync on the newest keyframe.
+    // Suited to recorders (HLS, MP4) that must stay decodable.
+    PACKET_FANOUT_POLICY_CATCH_UP = 0,
+
+    // Stay close to live; whenever more than one GOP behind, jump to the newest
+    // keyframe. Suited to consumers that only care about the current picture.
+    PACKET_FANOUT_POLICY_LATEST
+} packet_fanout_policy_t;
+
+/**
+ * Per-subscriber statistics
+ */
+typedef struct {
+    uint64_t packets_read;
+    uint64_t packets_dropped;   // Packets skipped due to backpressure
+    uint64_t resyncs;           // Times the reader was moved forward to a keyframe
+    uint64_t lag;               // Packets published but not yet read
+} packet_fanout_reader_stats_t;
+
+/**
+ * Acquire the shared fan-out for a stream, starting the ingest if needed
+ *
+ * The first caller starts a dedicated stream reader; later callers share it.
+ * The URL and transport come from the stream configuration (or the go2rtc
+ * restream when go2rtc serves the stream), so every consumer gets the same
+ * ingest whichever acquires it first. Every successful call must be balanced
+ * by packet_fanout_release().
+ *
+ * @param stream_name Name of the stream
+ * @return Fan-out handle or NULL on failure
+ */
+packet_fanout_t *packet_fanout_acquire(const char *stream_name);
+
+/**
+ * Release a reference obtained with packet_fanout_acquire()
+ * The ingest is stopped when the last reference is released.
+ *
+ * @param fanout Fan-out handle
+ */
+void packet_fanout_release(packet_fanout_t *fanout);
+
+/**
+ * Subscribe to a fan-out
+ *
+ * @param fanout Fan-out handle
+ * @param name Short consumer name for logging (e.g. "hls", "mp4")
+ * @param policy Backpressure policy
+ * @return Reader handle or NULL if no slot is available
+ */
+packet_fanout_reader_t *packet_fanout_subscribe(packet_fanout_t *fanout, const char *name,
+                                                packet_fanout_policy_t policy);
+
+/**
+ * Unsubscribe and free a reader
+ *
+ * @param reader Reader handle
+ */
+void packet_fanout_unsubscribe(packet_fanout_reader_t *reader);
+
+/**
+ * Wait until the ingest has published stream parameters
+ *
+ * @param reader Reader handle
+ * @param timeout_ms Maximum time to wait in milliseconds
+ * @return 0 when stream parameters are available, AVERROR(EAGAIN) on timeout,
+ *         AVERROR_EOF if the fan-out was closed
+ */
+int packet_fanout_wait_for_streams(packet_fanout_reader_t *reader, int timeout_ms);
+
+/**
+ * Read the next packet for this subscriber
+ *
+ * The returned packet holds its own reference and must be released with
+ * av_packet_unref(). Its stream_index refers to the streams returned by
+ * packet_fanout_get_stream() for this reader. The first packet returned
+ * after subscribing or after a resync is always a video keyframe.
+ *
+ * @param reader Reader handle
+ * @param pkt Packet to fill
+ * @param timeout_ms Maximum time to wait in milliseconds
+ * @return 0 on success, AVERROR(EAGAIN) on timeout, AVERROR_EOF if the fan-out was closed
+ */
+int packet_fanout_read(packet_fanout_reader_t *reader, AVPacket *pkt, int timeout_ms);
+
+/**
+ * Get the reader's view of an input stream
+ *
+ * Each reader owns a private copy of the codec parameters and time base of
+ * the ingest, refreshed whenever the ingest reconnects, so the returned
+ * stream can be passed wherever an input AVStream is expected.
+ *
+ * @param reader Reader handle
+ * @param type AVMEDIA_TYPE_VIDEO or AVMEDIA_TYPE_AUDIO
+ * @return Stream or NULL if the ingest has no stream of that type
+ */
+const AVStream *packet_fanout_get_stream(packet_fanout_reader_t *reader, enum AVMediaType type);
+
+/**
+ * Get the reader's private format context holding the streams above
+ * The context has no I/O attached and must not be closed by the caller.
+ *
+ * @param reader Reader handle
+ * @return Format context or NULL if no stream parameters are available yet
+ */
+AVFormatContext *packet_fanout_get_format_context(packet_fanout_reader_t *reader);
+
+/**
+ * Check and clear the "stream parameters changed" flag of a reader
+ * The flag is set when the ingest reconnected with new codec parameters.
+ *
+ * @param reader Reader handle
+ * @return true if the parameters changed since the last call
+ */
+bool packet_fanout_streams_changed(packet_fanout_reader_t *reader);
+
+/**
+ * Get statistics for a reader
+ *
+ * @param reader Reader handle
+ * @param stats Statistics to fill
+ */
+void packet_fanout_get_reader_stats(packet_fanout_reader_t *reader, packet_fanout_reader_stats_t *stats);
+
+/**
+ * Check whether shared ingest is enabled in the global configuration
+ *
+ * @return true if consumers should use the shared fan-out
+ */
+bool packet_fanout_is_enabled(void);
+
+/**
+ * Stop every shared ingest and wake all subscribers
+ * Must be called before cleanup_stream_reader_backend() during shutdown.
+ */
+void shutdown_packet_fanout_system(void);
+
+#endif /* PACKET_FANOUT_H */
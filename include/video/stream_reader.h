@@ -8,7 +8,10 @@
 #include "core/config.h"
 
 // Callback function type for packet processing
-typedef int (*packet_callback_t)(const AVPacket *pkt, const AVStream *stream, void *user_data);
+// generation changes every time the reader (re)opens its input, so a consumer can
+// tell a reconnect apart from a new AVStream that happens to reuse a freed address
+typedef int (*packet_callback_t)(const AVPacket *pkt, const AVStream *stream, unsigned int generation,
+                                 void *user_data);
 
 // Stream reader context
 typedef struct {
@@ -19,6 +22,7 @@ typedef struct {
     int video_stream_idx;
     int audio_stream_idx;   // Index of the audio stream (-1 if none)
     int dedicated;          // Flag to indicate if this is a dedicated stream reader
+    unsigned int input_generation;  // Bumped on every successful (re)open, unique across readers
     
     // Callback function for packet processing
     packet_callback_t packet_callback;
@@ -49,9 +53,23 @@ void cleanup_stream_reader_backend(void);
  * @param user_data User data to pass to the callback (can be NULL)
  * @return Stream reader context or NULL on failure
  */
-stream_reader_ctx_t *start_stream_reader(const char *stream_name, int dedicated, 
+stream_reader_ctx_t *start_stream_reader(const char *stream_name, int dedicated,
                                         packet_callback_t callback, void *user_data);
 
+/**
+ * Start a stream reader on an explicit URL instead of the configured one
+ *
+ * @param stream_name Name of the stream to read
+ * @param url URL to read from, or NULL to use the stream configuration
+ * @param protocol STREAM_PROTOCOL_TCP or STREAM_PROTOCOL_UDP, or -1 to use the stream configuration
+ * @param dedicated Whether this is a dedicated stream reader (not shared)
+ * @param callback Function to call for each packet (can be NULL)
+ * @param user_data User data to pass to the callback (can be NULL)
+ * @return Stream reader context or NULL on failure
+ */
+stream_reader_ctx_t *start_stream_reader_with_url(const char *stream_name, const char *url, int protocol,
+                                                 int dedicated, packet_callback_t callback, void *user_data);
+
 /**
  * Stop a stream reader
  * 
@@ -229,6 +229,26 @@ void mg_handle_post_system_backup(struct mg_connection *c, struct mg_http_messag
  */
 void mg_handle_get_system_status(struct mg_connection *c, struct mg_http_message *hm);
 
+/**
+ * @brief Direct handler for GET /api/system/workers
+ * 
+ * Reports API worker pool queue depths, rejections and latencies.
+ * 
+ * @param c Mongoose connection
+ * @param hm Mongoose HTTP message
+ */
+void mg_handle_get_system_workers(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * @brief Direct handler for GET /metrics
+ * 
+ * Exports counters, gauges and latency histograms in the Prometheus text format.
+ * 
+ * @param c Mongoose connection
+ * @param hm Mongoose HTTP message
+ */
+void mg_handle_get_metrics(struct mg_connection *c, struct mg_http_message *hm);
+
 /**
  * @brief Direct handler for POST /api/streaming/:stream/webrtc/offer
  * 
@@ -3,6 +3,7 @@
 
 #include "web/web_server.h"
 #include "database/database_manager.h"
+#include "web/timeline_manifest_cache.h"
 
 /**
  * Structure to hold timeline segment information
@@ -40,15 +41,18 @@ void handle_get_timeline_segments(const http_request_t *request, http_response_t
 /**
  * Create a playback manifest for a sequence of recordings
  * 
+ * Fragmented recordings are listed as byte ranges of whole fragments, so
+ * playback starts at the keyframe before start_time and the files are served
+ * as they are. Any other recording falls back to a single entry for the range.
+ * 
  * @param segments      Array of segments to include in the manifest
  * @param segment_count Number of segments in the array
  * @param start_time    Requested playback start time
- * @param manifest_path Output path where the manifest will be written
  * 
- * @return 0 on success, non-zero on failure
+ * @return Manifest with one reference (release with timeline_manifest_release), or NULL on failure
  */
-int create_timeline_manifest(const timeline_segment_t *segments, int segment_count,
-                            time_t start_time, char *manifest_path);
+timeline_manifest_t *create_timeline_manifest(const timeline_segment_t *segments, int segment_count,
+                                              time_t start_time);
 
 /**
  * Handle GET request for timeline playback
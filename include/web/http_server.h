@@ -36,6 +36,8 @@ typedef struct {
     char key_path[256];             // SSL/TLS key path
     int max_connections;            // Maximum number of connections
     int connection_timeout;         // Connection timeout in seconds
+    int thread_pool_size;           // Number of API worker threads
+    int request_queue_size;         // Maximum queued API requests
     bool daemon_mode;               // Daemon mode
     char pid_file[256];             // PID file path
 } http_server_config_t;
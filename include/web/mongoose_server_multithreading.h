@@ -6,8 +6,24 @@
 #ifndef MONGOOSE_SERVER_MULTITHREADING_H
 #define MONGOOSE_SERVER_MULTITHREADING_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #include "mongoose.h"
 
+/**
+ * @brief Priority class of an API request
+ *
+ * Workers always take queued requests of a higher class first, and a full
+ * queue turns away bulk work before live-view requests.
+ */
+typedef enum {
+  MG_PRIORITY_LIVE = 0,   // Live view, health and status polling
+  MG_PRIORITY_NORMAL,     // Regular API calls
+  MG_PRIORITY_BULK,       // Downloads, batch operations and other long-running work
+  MG_PRIORITY_COUNT
+} mg_request_priority_t;
+
 /**
  * @brief Thread data structure for worker threads
  */
@@ -15,9 +31,87 @@ struct mg_thread_data {
   struct mg_mgr *mgr;
   unsigned long conn_id;  // Parent connection ID
   struct mg_str message;  // Original HTTP request
+  struct mg_http_message hm;  // Parsed request, pointing into message
   void (*handler_func)(struct mg_connection *c, struct mg_http_message *hm);  // Handler function
+  mg_request_priority_t priority;  // Priority class
+  uint64_t queued_us;     // Monotonic time the request was queued
 };
 
+/**
+ * @brief Worker pool statistics
+ */
+typedef struct {
+  int workers;                                // Number of worker threads
+  int busy_workers;                           // Workers currently running a handler
+  int queue_capacity;                         // Maximum number of queued requests
+  int queue_depth[MG_PRIORITY_COUNT];         // Requests waiting per class
+  uint64_t submitted[MG_PRIORITY_COUNT];      // Requests accepted per class
+  uint64_t rejected[MG_PRIORITY_COUNT];       // Requests turned away with 503 per class
+  uint64_t completed[MG_PRIORITY_COUNT];      // Requests finished per class
+  uint64_t total_wait_us[MG_PRIORITY_COUNT];  // Sum of queue wait times of completed requests
+  uint64_t max_wait_us[MG_PRIORITY_COUNT];    // Longest queue wait time
+  uint64_t total_run_us[MG_PRIORITY_COUNT];   // Sum of handler run times
+} mg_worker_pool_stats_t;
+
+/**
+ * @brief Start the API worker pool
+ *
+ * @param num_workers Number of worker threads
+ * @param queue_capacity Maximum number of queued requests
+ * @return 0 on success, -1 on error
+ */
+int mg_worker_pool_init(int num_workers, int queue_capacity);
+
+/**
+ * @brief Stop the worker pool
+ *
+ * Waits for running handlers to finish and drops requests still queued.
+ * Must be called before the Mongoose manager is freed.
+ */
+void mg_worker_pool_shutdown(void);
+
+/**
+ * @brief Queue a request for a worker thread
+ *
+ * If the pool is not running the request gets a thread of its own.
+ * On success the pool owns the data; on failure the caller keeps it.
+ *
+ * @param data Thread data
+ * @param priority Priority class
+ * @return true if queued, false if the queue is full for this class
+ */
+bool mg_worker_pool_submit(struct mg_thread_data *data, mg_request_priority_t priority);
+
+/**
+ * @brief Copy a request and queue it for a worker thread
+ *
+ * Replies 503 (or 500 if the copy fails) when the request cannot be queued.
+ *
+ * @param c Mongoose connection
+ * @param hm HTTP message
+ * @param handler_func Handler to run in the worker
+ * @param priority Priority class
+ * @return true if queued, false if an error response was sent
+ */
+bool mg_submit_request(struct mg_connection *c, struct mg_http_message *hm,
+                       void (*handler_func)(struct mg_connection *c, struct mg_http_message *hm),
+                       mg_request_priority_t priority);
+
+/**
+ * @brief Get a snapshot of the worker pool statistics
+ *
+ * @param stats Statistics to fill
+ */
+void mg_worker_pool_get_stats(mg_worker_pool_stats_t *stats);
+
+/**
+ * @brief Get the name of a priority class
+ *
+ * @param priority Priority class
+ * @return Name of the class
+ */
+const char *mg_priority_name(mg_request_priority_t priority);
+
 /**
  * @brief Start a thread
  * 
@@ -0,0 +1,83 @@
+#ifndef TIMELINE_MANIFEST_CACHE_H
+#define TIMELINE_MANIFEST_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/**
+ * Timeline manifest cache
+ *
+ * Keeps the most recently used timeline playlists in memory, keyed by stream,
+ * requested range and the version of the stream's recordings. The version
+ * changes whenever recordings of the stream are added, finalized or deleted,
+ * so a cached playlist never outlives the recordings it lists; stale entries
+ * are simply never hit again and age out. Manifests are immutable and
+ * reference counted like the files of the HLS memory store, so one can be
+ * sent while it is evicted.
+ */
+
+// Number of manifests kept
+#define TIMELINE_MANIFEST_CACHE_SIZE 16
+
+// Larger manifests are served but not cached
+#define TIMELINE_MANIFEST_CACHE_MAX_SIZE (1024 * 1024)
+
+/**
+ * Cached manifest
+ */
+typedef struct {
+    atomic_int refcount;
+    size_t size;
+    char data[];
+} timeline_manifest_t;
+
+/**
+ * Allocate a manifest holding a copy of a playlist
+ *
+ * @param data Playlist text
+ * @param size Length of the playlist
+ * @return Manifest with one reference, or NULL on allocation failure
+ */
+timeline_manifest_t *timeline_manifest_create(const char *data, size_t size);
+
+/**
+ * Look up a manifest
+ *
+ * @param stream_name Stream name
+ * @param start_time Requested start time
+ * @param end_time Requested end time
+ * @param version Version of the stream's recordings
+ * @return Referenced manifest (release with timeline_manifest_release) or NULL
+ */
+timeline_manifest_t *timeline_manifest_cache_get(const char *stream_name, time_t start_time,
+                                                 time_t end_time, uint64_t version);
+
+/**
+ * Store a manifest, evicting the least recently used one when full
+ *
+ * The cache takes its own reference; the caller keeps the one it holds.
+ *
+ * @param stream_name Stream name
+ * @param start_time Requested start time
+ * @param end_time Requested end time
+ * @param version Version of the stream's recordings
+ * @param manifest Manifest to store
+ */
+void timeline_manifest_cache_put(const char *stream_name, time_t start_time, time_t end_time,
+                                 uint64_t version, timeline_manifest_t *manifest);
+
+/**
+ * Release a manifest reference
+ *
+ * @param manifest Manifest to release
+ */
+void timeline_manifest_release(timeline_manifest_t *manifest);
+
+/**
+ * Drop every cached manifest
+ */
+void timeline_manifest_cache_clear(void);
+
+#endif /* TIMELINE_MANIFEST_CACHE_H */
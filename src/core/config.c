@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <errno.h>
 #include <sys/stat.h>
@@ -33,16 +34,24 @@ void load_default_config(config_t *config) {
     config->storage_path_hls[0] = '\0'; // Empty by default, will use storage_path if not specified
     config->max_storage_size = 0; // 0 means unlimited
     config->retention_days = 30;
+    config->detection_retention_days = 0; // 0 means same as retention_days
     config->auto_delete_oldest = true;
     
     // Models settings
     snprintf(config->models_path, MAX_PATH_LENGTH, "/var/lib/lightnvr/models");
+    config->inference_batch_size = 4;
+    config->inference_max_latency_ms = 50;
+    config->inference_threads = 1;
     
     // API detection settings
     snprintf(config->api_detection_url, MAX_URL_LENGTH, "http://localhost:8000/detect");
     
     // Database settings
     snprintf(config->db_path, MAX_PATH_LENGTH, "/var/lib/lightnvr/lightnvr.db");
+    config->db_reader_connections = 4;
+    config->db_commit_interval_ms = 5;
+    config->db_commit_batch_size = 256;
+    snprintf(config->db_synchronous, sizeof(config->db_synchronous), "normal");
     
     // Web server settings
     config->web_port = 8080;
@@ -50,6 +59,9 @@ void load_default_config(config_t *config) {
     config->web_auth_enabled = true;
     snprintf(config->web_username, 32, "admin");
     snprintf(config->web_password, 32, "admin"); // Default password, should be changed
+    config->web_thread_pool_size = 8;
+    config->web_request_queue_size = 64;
+    config->web_auth_cache_ttl = 60;
     
     // Web optimization settings
     config->web_compression_enabled = true;
@@ -63,12 +75,17 @@ void load_default_config(config_t *config) {
     
     // Stream settings
     config->max_streams = 16;
+    config->shared_ingest = true;
+    config->ll_hls_enabled = false;
+    config->ll_hls_part_duration_ms = 333;
     
     // Memory optimization
     config->buffer_size = 1024; // 1MB buffer size
     config->use_swap = true;
     snprintf(config->swap_file, MAX_PATH_LENGTH, "/var/lib/lightnvr/swap");
     config->swap_size = 128 * 1024 * 1024; // 128MB swap
+    config->hls_memory_store = false;
+    config->hls_memory_segments = 8;
     
     // Hardware acceleration
     config->hw_accel_enabled = false;
@@ -272,6 +289,8 @@ static int config_ini_handler(void* user, const char* section, const char* name,
             config->max_storage_size = strtoull(value, NULL, 10);
         } else if (strcmp(name, "retention_days") == 0) {
             config->retention_days = atoi(value);
+        } else if (strcmp(name, "detection_retention_days") == 0) {
+            config->detection_retention_days = atoi(value);
         } else if (strcmp(name, "auto_delete_oldest") == 0) {
             config->auto_delete_oldest = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
         }
@@ -280,6 +299,27 @@ static int config_ini_handler(void* user, const char* section, const char* name,
     else if (strcmp(section, "models") == 0) {
         if (strcmp(name, "path") == 0) {
             strncpy(config->models_path, value, MAX_PATH_LENGTH - 1);
+        } else if (strcmp(name, "batch_size") == 0) {
+            config->inference_batch_size = atoi(value);
+            if (config->inference_batch_size < 1) {
+                config->inference_batch_size = 1;
+            } else if (config->inference_batch_size > 16) {
+                config->inference_batch_size = 16;
+            }
+        } else if (strcmp(name, "max_latency_ms") == 0) {
+            config->inference_max_latency_ms = atoi(value);
+            if (config->inference_max_latency_ms < 0) {
+                config->inference_max_latency_ms = 0;
+            } else if (config->inference_max_latency_ms > 1000) {
+                config->inference_max_latency_ms = 1000;
+            }
+        } else if (strcmp(name, "threads") == 0) {
+            config->inference_threads = atoi(value);
+            if (config->inference_threads < 1) {
+                config->inference_threads = 1;
+            } else if (config->inference_threads > 16) {
+                config->inference_threads = 16;
+            }
         }
     }
     // API detection settings
@@ -292,6 +332,35 @@ static int config_ini_handler(void* user, const char* section, const char* name,
     else if (strcmp(section, "database") == 0) {
         if (strcmp(name, "path") == 0) {
             strncpy(config->db_path, value, MAX_PATH_LENGTH - 1);
+        } else if (strcmp(name, "reader_connections") == 0) {
+            config->db_reader_connections = atoi(value);
+            if (config->db_reader_connections < 0) {
+                config->db_reader_connections = 0;
+            } else if (config->db_reader_connections > 16) {
+                config->db_reader_connections = 16;
+            }
+        } else if (strcmp(name, "commit_interval_ms") == 0) {
+            config->db_commit_interval_ms = atoi(value);
+            if (config->db_commit_interval_ms < 0) {
+                config->db_commit_interval_ms = 0;
+            } else if (config->db_commit_interval_ms > 1000) {
+                config->db_commit_interval_ms = 1000;
+            }
+        } else if (strcmp(name, "commit_batch_size") == 0) {
+            config->db_commit_batch_size = atoi(value);
+            if (config->db_commit_batch_size < 1) {
+                config->db_commit_batch_size = 1;
+            } else if (config->db_commit_batch_size > 4096) {
+                config->db_commit_batch_size = 4096;
+            }
+        } else if (strcmp(name, "synchronous") == 0) {
+            if (strcasecmp(value, "off") == 0 || strcasecmp(value, "normal") == 0 ||
+                strcasecmp(value, "full") == 0 || strcasecmp(value, "extra") == 0) {
+                strncpy(config->db_synchronous, value, sizeof(config->db_synchronous) - 1);
+                config->db_synchronous[sizeof(config->db_synchronous) - 1] = '\0';
+            } else {
+                log_warn("Invalid database synchronous mode '%s', using normal", value);
+            }
         }
     }
     // Web server settings
@@ -306,12 +375,42 @@ static int config_ini_handler(void* user, const char* section, const char* name,
             strncpy(config->web_username, value, 31);
         } else if (strcmp(name, "password") == 0) {
             strncpy(config->web_password, value, 31);
+        } else if (strcmp(name, "web_thread_pool_size") == 0) {
+            config->web_thread_pool_size = atoi(value);
+            if (config->web_thread_pool_size < 1) {
+                config->web_thread_pool_size = 1;
+            } else if (config->web_thread_pool_size > 64) {
+                config->web_thread_pool_size = 64;
+            }
+        } else if (strcmp(name, "web_request_queue_size") == 0) {
+            config->web_request_queue_size = atoi(value);
+            if (config->web_request_queue_size < 4) {
+                config->web_request_queue_size = 4;
+            }
+        } else if (strcmp(name, "auth_cache_ttl") == 0) {
+            config->web_auth_cache_ttl = atoi(value);
+            if (config->web_auth_cache_ttl < 0) {
+                config->web_auth_cache_ttl = 0;
+            } else if (config->web_auth_cache_ttl > 3600) {
+                config->web_auth_cache_ttl = 3600;
+            }
         }
     }
     // Stream settings
     else if (strcmp(section, "streams") == 0) {
         if (strcmp(name, "max_streams") == 0) {
             config->max_streams = atoi(value);
+        } else if (strcmp(name, "shared_ingest") == 0) {
+            config->shared_ingest = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        } else if (strcmp(name, "ll_hls") == 0) {
+            config->ll_hls_enabled = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        } else if (strcmp(name, "ll_hls_part_ms") == 0) {
+            config->ll_hls_part_duration_ms = atoi(value);
+            if (config->ll_hls_part_duration_ms < 100) {
+                config->ll_hls_part_duration_ms = 100;
+            } else if (config->ll_hls_part_duration_ms > 2000) {
+                config->ll_hls_part_duration_ms = 2000;
+            }
         }
     }
     // Stream-specific settings (format: stream_name.setting)
@@ -363,6 +462,13 @@ static int config_ini_handler(void* user, const char* section, const char* name,
             strncpy(config->swap_file, value, MAX_PATH_LENGTH - 1);
         } else if (strcmp(name, "swap_size") == 0) {
             config->swap_size = strtoull(value, NULL, 10);
+        } else if (strcmp(name, "hls_memory_store") == 0) {
+            config->hls_memory_store = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        } else if (strcmp(name, "hls_memory_segments") == 0) {
+            config->hls_memory_segments = atoi(value);
+            if (config->hls_memory_segments < 4) {
+                config->hls_memory_segments = 4;
+            }
         }
     }
     // Hardware acceleration
@@ -746,6 +852,11 @@ int reload_config(config_t *config) {
         log_info("Retention days changed: %d -> %d", old_config.retention_days, config->retention_days);
     }
     
+    if (old_config.detection_retention_days != config->detection_retention_days) {
+        log_info("Detection retention days changed: %d -> %d",
+                old_config.detection_retention_days, config->detection_retention_days);
+    }
+    
     // Update global config
     memcpy(&g_config, config, sizeof(config_t));
     
@@ -829,11 +940,16 @@ int save_config(const config_t *config, const char *path) {
     
     fprintf(file, "max_size = %llu  ; 0 means unlimited, otherwise bytes\n", (unsigned long long)config->max_storage_size);
     fprintf(file, "retention_days = %d\n", config->retention_days);
+    fprintf(file, "detection_retention_days = %d  ; Days to keep recordings without detections, 0 = same as retention_days\n",
+            config->detection_retention_days);
     fprintf(file, "auto_delete_oldest = %s\n\n", config->auto_delete_oldest ? "true" : "false");
     
     // Write models settings
     fprintf(file, "[models]\n");
-    fprintf(file, "path = %s\n\n", config->models_path);
+    fprintf(file, "path = %s\n", config->models_path);
+    fprintf(file, "batch_size = %d  ; Frames per batched CNN forward pass, 1 disables batching\n", config->inference_batch_size);
+    fprintf(file, "max_latency_ms = %d  ; Longest a frame waits for its batch to fill\n", config->inference_max_latency_ms);
+    fprintf(file, "threads = %d  ; CPU threads for CNN convolutions, shared by all models\n\n", config->inference_threads);
     
     // Write API detection settings
     fprintf(file, "[api_detection]\n");
@@ -841,7 +957,11 @@ int save_config(const config_t *config, const char *path) {
     
     // Write database settings
     fprintf(file, "[database]\n");
-    fprintf(file, "path = %s\n\n", config->db_path);
+    fprintf(file, "path = %s\n", config->db_path);
+    fprintf(file, "reader_connections = %d\n", config->db_reader_connections);
+    fprintf(file, "commit_interval_ms = %d\n", config->db_commit_interval_ms);
+    fprintf(file, "commit_batch_size = %d\n", config->db_commit_batch_size);
+    fprintf(file, "synchronous = %s\n\n", config->db_synchronous);
     
     // Write web server settings
     fprintf(file, "[web]\n");
@@ -850,18 +970,30 @@ int save_config(const config_t *config, const char *path) {
     fprintf(file, "auth_enabled = %s\n", config->web_auth_enabled ? "true" : "false");
     fprintf(file, "username = %s\n", config->web_username);
     fprintf(file, "password = %s  ; IMPORTANT: Change this default password!\n", config->web_password);
+    fprintf(file, "web_thread_pool_size = %d  ; API worker threads\n", config->web_thread_pool_size);
+    fprintf(file, "web_request_queue_size = %d  ; Queued API requests before replying 503\n",
+            config->web_request_queue_size);
+    fprintf(file, "auth_cache_ttl = %d  ; Seconds a validated session or password stays cached, 0 disables\n",
+            config->web_auth_cache_ttl);
     fprintf(file, "\n");
     
     // Write stream settings
     fprintf(file, "[streams]\n");
-    fprintf(file, "max_streams = %d\n\n", config->max_streams);
+    fprintf(file, "max_streams = %d\n", config->max_streams);
+    fprintf(file, "shared_ingest = %s  ; Share one camera connection between HLS, recording and detection\n",
+            config->shared_ingest ? "true" : "false");
+    fprintf(file, "ll_hls = %s  ; Low-latency HLS with fMP4 parts\n", config->ll_hls_enabled ? "true" : "false");
+    fprintf(file, "ll_hls_part_ms = %d  ; LL-HLS part duration in milliseconds\n\n", config->ll_hls_part_duration_ms);
     
     // Write memory optimization settings
     fprintf(file, "[memory]\n");
     fprintf(file, "buffer_size = %d  ; Buffer size in KB\n", config->buffer_size);
     fprintf(file, "use_swap = %s\n", config->use_swap ? "true" : "false");
     fprintf(file, "swap_file = %s\n", config->swap_file);
-    fprintf(file, "swap_size = %llu  ; Size in bytes\n\n", (unsigned long long)config->swap_size);
+    fprintf(file, "swap_size = %llu  ; Size in bytes\n", (unsigned long long)config->swap_size);
+    fprintf(file, "hls_memory_store = %s  ; Serve live HLS from RAM instead of writing segments to disk\n",
+            config->hls_memory_store ? "true" : "false");
+    fprintf(file, "hls_memory_segments = %d  ; Segments kept in RAM per stream\n\n", config->hls_memory_segments);
     
     // Write hardware acceleration settings
     fprintf(file, "[hardware]\n");
@@ -929,16 +1061,24 @@ void print_config(const config_t *config) {
     }
     printf("    Max Storage Size: %llu bytes\n", (unsigned long long)config->max_storage_size);
     printf("    Retention Days: %d\n", config->retention_days);
+    printf("    Detection Retention Days: %d\n", config->detection_retention_days);
     printf("    Auto Delete Oldest: %s\n", config->auto_delete_oldest ? "true" : "false");
     
     printf("  Models Settings:\n");
     printf("    Models Path: %s\n", config->models_path);
+    printf("    Inference Batch Size: %d\n", config->inference_batch_size);
+    printf("    Inference Max Latency: %d ms\n", config->inference_max_latency_ms);
+    printf("    Inference Threads: %d\n", config->inference_threads);
     
     printf("  API Detection Settings:\n");
     printf("    API URL: %s\n", config->api_detection_url);
     
     printf("  Database Settings:\n");
     printf("    Database Path: %s\n", config->db_path);
+    printf("    Database Reader Connections: %d\n", config->db_reader_connections);
+    printf("    Database Commit Interval: %d ms\n", config->db_commit_interval_ms);
+    printf("    Database Commit Batch Size: %d\n", config->db_commit_batch_size);
+    printf("    Database Synchronous Mode: %s\n", config->db_synchronous);
     
     printf("  Web Server Settings:\n");
     printf("    Web Port: %d\n", config->web_port);
@@ -946,15 +1086,23 @@ void print_config(const config_t *config) {
     printf("    Web Auth Enabled: %s\n", config->web_auth_enabled ? "true" : "false");
     printf("    Web Username: %s\n", config->web_username);
     printf("    Web Password: %s\n", "********");
+    printf("    Web Worker Threads: %d (queue %d)\n", config->web_thread_pool_size,
+           config->web_request_queue_size);
+    printf("    Web Auth Cache TTL: %d s\n", config->web_auth_cache_ttl);
     
     printf("  Stream Settings:\n");
     printf("    Max Streams: %d\n", config->max_streams);
+    printf("    Shared Ingest: %s\n", config->shared_ingest ? "enabled" : "disabled");
+    printf("    Low-Latency HLS: %s (part %d ms)\n", config->ll_hls_enabled ? "enabled" : "disabled",
+           config->ll_hls_part_duration_ms);
     
     printf("  Memory Optimization:\n");
     printf("    Buffer Size: %d KB\n", config->buffer_size);
     printf("    Use Swap: %s\n", config->use_swap ? "true" : "false");
     printf("    Swap File: %s\n", config->swap_file);
     printf("    Swap Size: %llu bytes\n", (unsigned long long)config->swap_size);
+    printf("    HLS Memory Store: %s (%d segments)\n", config->hls_memory_store ? "enabled" : "disabled",
+           config->hls_memory_segments);
     
     printf("  Hardware Acceleration:\n");
     printf("    HW Accel Enabled: %s\n", config->hw_accel_enabled ? "true" : "false");
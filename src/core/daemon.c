@@ -58,7 +58,8 @@ int init_daemon(const char *pid_file) {
         exit(EXIT_SUCCESS);
     }
 
-    // Child process continues
+    // Child process continues, the log writer thread stayed behind in the parent
+    logger_restart_after_fork();
 
     // Create a new session
     pid_t sid = setsid();
@@ -2,8 +2,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
 #include <time.h>
 #include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -14,20 +19,79 @@
 #include "core/logger_json.h"
 #include "web/logger_websocket.h"
 
+/*
+ * Logging is asynchronous: each thread formats its messages into a ring
+ * buffer of its own, and a single writer thread drains all rings, orders
+ * the entries and writes them to the log file, the console and the JSON log
+ * in batches. Producers never take a lock or touch a file; when a ring is
+ * full the message is dropped and counted. Before the writer is started
+ * (and after it is stopped) messages are written synchronously.
+ */
+
+// Entries per thread ring, must be a power of two
+#define LOG_RING_SLOTS 64
+
+// Longest message kept, longer messages are truncated
+#define LOG_MESSAGE_MAX 4096
+
+// Message bytes stored inline in a ring slot, longer messages spill to the heap
+#define LOG_SLOT_MESSAGE_MAX 1024
+
+// How often the writer drains the rings when nobody wakes it
+#define LOG_WRITER_INTERVAL_MS 20
+
+// Most entries written in one batch
+#define LOG_BATCH_MAX 1024
+
+typedef struct {
+    uint64_t seq;               // Global order of the entry
+    time_t time;
+    log_level_t level;
+    char *spill;                // Heap copy of a message too long for the slot, or NULL
+    char message[LOG_SLOT_MESSAGE_MAX];
+} log_entry_t;
+
+typedef struct log_ring {
+    atomic_uint head;           // Next slot written by the owner thread
+    atomic_uint tail;           // Next slot read by the writer
+    atomic_int in_use;          // Owned by a live thread
+    atomic_uint_fast64_t dropped;
+    unsigned int drain_to;      // Writer-only: tail after the current batch
+    struct log_ring *next;      // Immutable once published
+    log_entry_t slots[LOG_RING_SLOTS];
+} log_ring_t;
+
 // Logger state
 static struct {
     FILE *log_file;
     log_level_t log_level;
     int console_logging;
     char log_filename[256];
-    pthread_mutex_t mutex;
+    pthread_mutex_t mutex;      // Protects the files, taken by the writer only
+    pthread_t writer_thread;
+    atomic_bool writer_running;
+    atomic_int publishing;      // Producers that saw the writer running and have not published yet
+    sem_t writer_wakeup;
+    _Atomic(log_ring_t *) rings;
+    atomic_uint_fast64_t sequence;
+    uint64_t total_dropped;
 } logger = {
     .log_file = NULL,
     .log_level = LOG_LEVEL_INFO,
     .console_logging = 1,
     .log_filename = "",
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
 };
 
+static __thread log_ring_t *thread_ring = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+// Timestamps formatted for the last second seen by the writer
+static time_t cached_time = (time_t)-1;
+static char cached_timestamp[32];
+static char cached_iso_timestamp[32];
+
 // Log level strings
 static const char *log_level_strings[] = {
     "ERROR",
@@ -36,12 +100,257 @@ static const char *log_level_strings[] = {
     "DEBUG"
 };
 
+static void *log_writer_thread(void *arg);
+
+// Give a ring back for reuse when its thread exits
+static void release_thread_ring(void *ring) {
+    atomic_store(&((log_ring_t *)ring)->in_use, 0);
+}
+
+static void create_ring_key(void) {
+    pthread_key_create(&ring_key, release_thread_ring);
+}
+
+// Get the ring of the calling thread, reusing one left by an exited thread
+static log_ring_t *get_thread_ring(void) {
+    if (thread_ring) {
+        return thread_ring;
+    }
+
+    pthread_once(&ring_key_once, create_ring_key);
+
+    log_ring_t *ring;
+    for (ring = atomic_load(&logger.rings); ring; ring = ring->next) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&ring->in_use, &expected, 1)) {
+            break;
+        }
+    }
+
+    if (!ring) {
+        ring = calloc(1, sizeof(log_ring_t));
+        if (!ring) {
+            return NULL;
+        }
+        atomic_init(&ring->in_use, 1);
+
+        // Publish the ring; rings are never unlinked
+        ring->next = atomic_load(&logger.rings);
+        while (!atomic_compare_exchange_weak(&logger.rings, &ring->next, ring)) {
+        }
+    }
+
+    thread_ring = ring;
+    pthread_setspecific(ring_key, ring);
+    return ring;
+}
+
+// Refresh the cached timestamps if the second changed
+static void update_cached_timestamps(time_t now) {
+    if (now == cached_time) {
+        return;
+    }
+
+    struct tm tm_info;
+    localtime_r(&now, &tm_info);
+    strftime(cached_timestamp, sizeof(cached_timestamp), "%Y-%m-%d %H:%M:%S", &tm_info);
+    strftime(cached_iso_timestamp, sizeof(cached_iso_timestamp), "%Y-%m-%dT%H:%M:%S", &tm_info);
+    cached_time = now;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const log_entry_t *ea = *(const log_entry_t *const *)a;
+    const log_entry_t *eb = *(const log_entry_t *const *)b;
+    return (ea->seq > eb->seq) - (ea->seq < eb->seq);
+}
+
+// Append to a batch buffer, flushing it to the file when full
+static void batch_append(FILE *file, char *buf, size_t *len, size_t size, const char *data, size_t data_len) {
+    if (*len + data_len > size) {
+        fwrite(buf, 1, *len, file);
+        *len = 0;
+        if (data_len > size) {
+            fwrite(data, 1, data_len, file);
+            return;
+        }
+    }
+    memcpy(buf + *len, data, data_len);
+    *len += data_len;
+}
+
+/**
+ * Write one batch of queued entries
+ * Only the writer thread (or shutdown after joining it) may call this
+ *
+ * @return Number of entries written
+ */
+static int drain_rings(void) {
+    static log_entry_t *batch[LOG_BATCH_MAX];
+    static log_level_t levels[LOG_BATCH_MAX + 1];
+    static const char *timestamps[LOG_BATCH_MAX + 1];
+    static const char *messages[LOG_BATCH_MAX + 1];
+    static char iso_copies[LOG_BATCH_MAX + 1][32];
+    static char file_buf[65536];
+    static char out_buf[65536];
+    static char err_buf[16384];
+    char line[LOG_MESSAGE_MAX + 64];
+    char dropped_message[96];
+    int count = 0;
+    uint64_t dropped = 0;
+
+    // Collect the entries published so far
+    for (log_ring_t *ring = atomic_load(&logger.rings); ring; ring = ring->next) {
+        unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        while (tail != head && count < LOG_BATCH_MAX) {
+            batch[count++] = &ring->slots[tail & (LOG_RING_SLOTS - 1)];
+            tail++;
+        }
+        ring->drain_to = tail;
+        dropped += atomic_exchange(&ring->dropped, 0);
+    }
+
+    if (count == 0 && dropped == 0) {
+        return 0;
+    }
+
+    // Rings are drained one after another, restore the order the messages were logged in
+    qsort(batch, count, sizeof(batch[0]), compare_entries);
+
+    size_t file_len = 0, out_len = 0, err_len = 0;
+    int json_count = 0;
+
+    pthread_mutex_lock(&logger.mutex);
+
+    bool to_file = logger.log_file && logger.log_file != stdout && logger.log_file != stderr;
+
+    for (int i = 0; i < count; i++) {
+        log_entry_t *e = batch[i];
+        update_cached_timestamps(e->time);
+
+        const char *message = e->spill ? e->spill : e->message;
+
+        int n = snprintf(line, sizeof(line), "[%s] [%s] %s\n",
+                         cached_timestamp, log_level_strings[e->level], message);
+        size_t line_len = n < (int)sizeof(line) ? (size_t)n : sizeof(line) - 1;
+
+        if (to_file) {
+            batch_append(logger.log_file, file_buf, &file_len, sizeof(file_buf), line, line_len);
+        }
+
+        // Always write to console (tee behavior)
+        // Use stderr for errors, stdout for other levels
+        if (e->level == LOG_LEVEL_ERROR) {
+            batch_append(stderr, err_buf, &err_len, sizeof(err_buf), line, line_len);
+        } else {
+            batch_append(stdout, out_buf, &out_len, sizeof(out_buf), line, line_len);
+        }
+
+        memcpy(iso_copies[json_count], cached_iso_timestamp, sizeof(iso_copies[0]));
+        levels[json_count] = e->level;
+        timestamps[json_count] = iso_copies[json_count];
+        messages[json_count] = message;
+        json_count++;
+    }
+
+    if (dropped > 0) {
+        logger.total_dropped += dropped;
+        update_cached_timestamps(time(NULL));
+        snprintf(dropped_message, sizeof(dropped_message),
+                 "Dropped %llu log messages, log buffers were full", (unsigned long long)dropped);
+        int n = snprintf(line, sizeof(line), "[%s] [%s] %s\n",
+                         cached_timestamp, log_level_strings[LOG_LEVEL_WARN], dropped_message);
+        if (to_file) {
+            batch_append(logger.log_file, file_buf, &file_len, sizeof(file_buf), line, (size_t)n);
+        }
+        batch_append(stdout, out_buf, &out_len, sizeof(out_buf), line, (size_t)n);
+
+        memcpy(iso_copies[json_count], cached_iso_timestamp, sizeof(iso_copies[0]));
+        levels[json_count] = LOG_LEVEL_WARN;
+        timestamps[json_count] = iso_copies[json_count];
+        messages[json_count] = dropped_message;
+        json_count++;
+    }
+
+    if (to_file) {
+        fwrite(file_buf, 1, file_len, logger.log_file);
+        fflush(logger.log_file);
+    }
+    fwrite(out_buf, 1, out_len, stdout);
+    fflush(stdout);
+    fwrite(err_buf, 1, err_len, stderr);
+    fflush(stderr);
+
+    pthread_mutex_unlock(&logger.mutex);
+
+    // Write to JSON log file if the function is available
+    // This is a weak symbol that can be overridden by the actual implementation
+    // If the JSON logger is not linked, this will be a no-op
+    extern __attribute__((weak)) int write_json_log_batch(const log_level_t *levels, const char *const *timestamps,
+                                                          const char *const *messages, int count);
+    if (write_json_log_batch && json_count > 0) {
+        write_json_log_batch(levels, timestamps, messages, json_count);
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(batch[i]->spill);
+        batch[i]->spill = NULL;
+    }
+
+    // Hand the slots back to the producers
+    for (log_ring_t *ring = atomic_load(&logger.rings); ring; ring = ring->next) {
+        atomic_store_explicit(&ring->tail, ring->drain_to, memory_order_release);
+    }
+
+    return count;
+}
+
+// Writer thread: drain the rings until stopped
+static void *log_writer_thread(void *arg) {
+    (void)arg;
+
+    while (atomic_load(&logger.writer_running)) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOG_WRITER_INTERVAL_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        sem_timedwait(&logger.writer_wakeup, &deadline);
+
+        // Keep going while there is a backlog
+        while (drain_rings() == LOG_BATCH_MAX) {
+        }
+    }
+
+    return NULL;
+}
+
+static int start_writer_thread(void) {
+    atomic_store(&logger.writer_running, true);
+    if (pthread_create(&logger.writer_thread, NULL, log_writer_thread, NULL) != 0) {
+        atomic_store(&logger.writer_running, false);
+        fprintf(stderr, "Failed to start log writer thread, logging synchronously\n");
+        return -1;
+    }
+    return 0;
+}
+
 // Initialize the logging system
 int init_logger(void) {
-    // Initialize mutex
-    if (pthread_mutex_init(&logger.mutex, NULL) != 0) {
-        fprintf(stderr, "Failed to initialize logger mutex\n");
-        return -1;
+    static bool initialized = false;
+
+    if (!initialized) {
+        if (sem_init(&logger.writer_wakeup, 0, 0) != 0) {
+            fprintf(stderr, "Failed to initialize logger semaphore\n");
+            return -1;
+        }
+        initialized = true;
+    }
+
+    if (!atomic_load(&logger.writer_running)) {
+        start_writer_thread();
     }
 
     // Default to stderr if no log file is set
@@ -63,8 +372,46 @@ int init_logger(void) {
     return 0;
 }
 
+// Restart the writer in a long-lived child, threads do not survive fork()
+void logger_restart_after_fork(void) {
+    pthread_mutex_init(&logger.mutex, NULL);
+
+    // The parent still writes the queued entries, and only this thread survived
+    for (log_ring_t *ring = atomic_load(&logger.rings); ring; ring = ring->next) {
+        unsigned int head = atomic_load(&ring->head);
+        for (unsigned int tail = atomic_load(&ring->tail); tail != head; tail++) {
+            log_entry_t *e = &ring->slots[tail & (LOG_RING_SLOTS - 1)];
+            free(e->spill);
+            e->spill = NULL;
+        }
+        atomic_store(&ring->tail, head);
+        atomic_store(&ring->dropped, 0);
+        if (ring != thread_ring) {
+            atomic_store(&ring->in_use, 0);
+        }
+    }
+
+    if (atomic_load(&logger.writer_running)) {
+        sem_init(&logger.writer_wakeup, 0, 0);
+        start_writer_thread();
+    }
+}
+
 // Shutdown the logging system
 void shutdown_logger(void) {
+    // Stop the writer and write whatever is still queued
+    if (atomic_exchange(&logger.writer_running, false)) {
+        sem_post(&logger.writer_wakeup);
+        pthread_join(logger.writer_thread, NULL);
+    }
+
+    // Messages started before the flag changed still land in the rings, wait for them
+    while (atomic_load(&logger.publishing) > 0) {
+        sched_yield();
+    }
+    while (drain_rings() > 0) {
+    }
+
     pthread_mutex_lock(&logger.mutex);
 
     if (logger.log_file != NULL && logger.log_file != stdout && logger.log_file != stderr) {
@@ -73,7 +420,6 @@ void shutdown_logger(void) {
     }
 
     pthread_mutex_unlock(&logger.mutex);
-    pthread_mutex_destroy(&logger.mutex);
 
     // Shutdown JSON logger if the function is available
     extern __attribute__((weak)) void shutdown_json_logger(void);
@@ -275,32 +621,16 @@ const char *sanitize_for_logging(const char *str, size_t max_len) {
     return sanitized;
 }
 
-// Log a message at the specified level with va_list
-void log_message_v(log_level_t level, const char *format, va_list args) {
-    // Only log messages at or below the configured log level
-    // For example, if log_level is INFO (2), we log ERROR (0), WARN (1), and INFO (2), but not DEBUG (3)
-    if (level > logger.log_level) {
-        return;
-    }
-
-    time_t now;
-    struct tm *tm_info;
+// Write a message directly, used while the writer thread is not running
+static void write_message_sync(log_level_t level, const char *message) {
+    time_t now = time(NULL);
+    struct tm tm_info;
     char timestamp[32];
     char iso_timestamp[32];
 
-    // Get current time
-    time(&now);
-    tm_info = localtime(&now);
-
-    // Format timestamp for text log
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
-
-    // Format ISO timestamp for JSON log
-    strftime(iso_timestamp, sizeof(iso_timestamp), "%Y-%m-%dT%H:%M:%S", tm_info);
-
-    // Format the log message
-    char message[4096];
-    vsnprintf(message, sizeof(message), format, args);
+    localtime_r(&now, &tm_info);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &tm_info);
+    strftime(iso_timestamp, sizeof(iso_timestamp), "%Y-%m-%dT%H:%M:%S", &tm_info);
 
     pthread_mutex_lock(&logger.mutex);
 
@@ -318,15 +648,83 @@ void log_message_v(log_level_t level, const char *format, va_list args) {
 
     pthread_mutex_unlock(&logger.mutex);
 
-    // Write to JSON log file if the function is available
-    // This is a weak symbol that can be overridden by the actual implementation
-    // If the JSON logger is not linked, this will be a no-op
     extern __attribute__((weak)) int write_json_log(log_level_t level, const char *timestamp, const char *message);
     if (write_json_log) {
         write_json_log(level, iso_timestamp, message);
     }
 }
 
+// Log a message at the specified level with va_list
+void log_message_v(log_level_t level, const char *format, va_list args) {
+    // Only log messages at or below the configured log level
+    // For example, if log_level is INFO (2), we log ERROR (0), WARN (1), and INFO (2), but not DEBUG (3)
+    if ((int)level > (int)logger.log_level || (int)level < LOG_LEVEL_ERROR) {
+        return;
+    }
+
+    // Announced before checking the writer so shutdown_logger() cannot miss the message
+    atomic_fetch_add(&logger.publishing, 1);
+    log_ring_t *ring = atomic_load(&logger.writer_running) ? get_thread_ring() : NULL;
+    if (!ring) {
+        atomic_fetch_sub(&logger.publishing, 1);
+        char message[LOG_MESSAGE_MAX];
+        vsnprintf(message, sizeof(message), format, args);
+        write_message_sync(level, message);
+        return;
+    }
+
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail >= LOG_RING_SLOTS) {
+        // Never block the caller, count the loss instead
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        atomic_fetch_sub(&logger.publishing, 1);
+        return;
+    }
+
+    // Format straight into the slot
+    log_entry_t *entry = &ring->slots[head & (LOG_RING_SLOTS - 1)];
+    entry->seq = atomic_fetch_add_explicit(&logger.sequence, 1, memory_order_relaxed);
+    entry->time = time(NULL);
+    entry->level = level;
+    entry->spill = NULL;
+
+    va_list spill_args;
+    va_copy(spill_args, args);
+    int len = vsnprintf(entry->message, sizeof(entry->message), format, args);
+    if (len >= (int)sizeof(entry->message)) {
+        size_t size = len < LOG_MESSAGE_MAX ? (size_t)len + 1 : LOG_MESSAGE_MAX;
+        entry->spill = malloc(size);
+        if (entry->spill) {
+            vsnprintf(entry->spill, size, format, spill_args);
+        }
+    }
+    va_end(spill_args);
+
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    atomic_fetch_sub(&logger.publishing, 1);
+
+    // Errors and filling rings are written without waiting for the next interval
+    if (level == LOG_LEVEL_ERROR || head - tail + 1 == LOG_RING_SLOTS / 2) {
+        sem_post(&logger.writer_wakeup);
+    }
+}
+
+// Get the number of messages dropped because log buffers were full
+uint64_t get_log_dropped_count(void) {
+    uint64_t dropped = 0;
+
+    pthread_mutex_lock(&logger.mutex);
+    dropped = logger.total_dropped;
+    pthread_mutex_unlock(&logger.mutex);
+
+    for (log_ring_t *ring = atomic_load(&logger.rings); ring; ring = ring->next) {
+        dropped += atomic_load(&ring->dropped);
+    }
+
+    return dropped;
+}
+
 // Get the string representation of a log level
 const char *get_log_level_string(log_level_t level) {
     if (level >= LOG_LEVEL_ERROR && level <= LOG_LEVEL_DEBUG) {
@@ -154,26 +154,19 @@ void shutdown_json_logger(void) {
 }
 
 /**
- * @brief Write a log entry to the JSON log file
+ * @brief Format a log entry as a JSON line
  * 
- * @param level Log level
- * @param timestamp Timestamp string
- * @param message Log message
- * @return int 0 on success, non-zero on error
+ * @return Allocated JSON string (free with free) or NULL on error
  */
-int write_json_log(log_level_t level, const char *timestamp, const char *message) {
-    if (!json_logger.initialized || !json_logger.log_file) {
-        return -1;
-    }
-    
+static char *format_json_entry(log_level_t level, const char *timestamp, const char *message) {
     if (level < LOG_LEVEL_ERROR || level > LOG_LEVEL_DEBUG) {
-        return -1;
+        return NULL;
     }
     
     // Create JSON object for log entry
     cJSON *log_entry = cJSON_CreateObject();
     if (!log_entry) {
-        return -1;
+        return NULL;
     }
     
     // Add timestamp, level, and message
@@ -185,24 +178,57 @@ int write_json_log(log_level_t level, const char *timestamp, const char *message
     char *json_str = cJSON_PrintUnformatted(log_entry);
     cJSON_Delete(log_entry);
     
-    if (!json_str) {
+    return json_str;
+}
+
+/**
+ * @brief Write a log entry to the JSON log file
+ * 
+ * @param level Log level
+ * @param timestamp Timestamp string
+ * @param message Log message
+ * @return int 0 on success, non-zero on error
+ */
+int write_json_log(log_level_t level, const char *timestamp, const char *message) {
+    return write_json_log_batch(&level, &timestamp, &message, 1);
+}
+
+/**
+ * @brief Write several log entries to the JSON log file with a single flush
+ * 
+ * @param levels Log levels
+ * @param timestamps Timestamp strings
+ * @param messages Log messages
+ * @param count Number of entries
+ * @return int 0 on success, non-zero on error
+ */
+int write_json_log_batch(const log_level_t *levels, const char *const *timestamps,
+                         const char *const *messages, int count) {
+    if (!json_logger.initialized || !json_logger.log_file) {
         return -1;
     }
     
-    // Write to log file
+    int result = 0;
+    
     pthread_mutex_lock(&json_logger.mutex);
     
-    int result = 0;
-    if (fprintf(json_logger.log_file, "%s\n", json_str) < 0) {
-        result = -1;
+    for (int i = 0; i < count; i++) {
+        char *json_str = format_json_entry(levels[i], timestamps[i], messages[i]);
+        if (!json_str) {
+            result = -1;
+            continue;
+        }
+        
+        if (fprintf(json_logger.log_file, "%s\n", json_str) < 0) {
+            result = -1;
+        }
+        free(json_str);
     }
     
     fflush(json_logger.log_file);
     
     pthread_mutex_unlock(&json_logger.mutex);
     
-    free(json_str);
-    
     return result;
 }
 
@@ -19,14 +19,17 @@
 #include "core/logger.h"
 #include "core/daemon.h"
 #include "core/shutdown_coordinator.h"
+#include "core/system_metrics.h"
 #include "video/stream_manager.h"
 #include "video/stream_state.h"
 #include "video/stream_state_adapter.h"
 #include "storage/storage_manager.h"
 #include "video/streams.h"
 #include "video/hls_streaming.h"
+#include "video/hls/hls_memory_store.h"
 #include "video/mp4_recording.h"
 #include "video/stream_transcoding.h"
+#include "video/packet_fanout.h"
 #include "video/detection_stream.h"
 #include "video/detection.h"
 #include "video/detection_integration.h"
@@ -46,11 +49,15 @@ void init_recordings_system(void);
 #include "database/database_manager.h"
 #include "database/db_schema_cache.h"
 #include "database/db_core.h"
+#include "database/db_pool.h"
+#include "database/db_writer.h"
+#include "database/db_recording_index.h"
 #include <sqlite3.h>
 #include "web/http_server.h"
 #include "web/mongoose_server.h"
 #include "web/api_handlers.h"
 #include "web/websocket_manager.h"
+#include "web/timeline_manifest_cache.h"
 #include "mongoose.h"
 
 // Include necessary headers for signal handling
@@ -559,6 +566,8 @@ int main(int argc, char *argv[]) {
     log_info("LightNVR v%s starting up", LIGHTNVR_VERSION_STRING);
 
     // Initialize database
+    db_pool_set_reader_count(config.db_reader_connections);
+    db_writer_configure(config.db_commit_interval_ms, config.db_commit_batch_size, config.db_synchronous);
     if (init_database(config.db_path) != 0) {
         log_error("Failed to initialize database");
         goto cleanup;
@@ -574,8 +583,15 @@ int main(int argc, char *argv[]) {
         log_error("Failed to initialize storage manager");
         goto cleanup;
     }
+    set_retention_days(config.retention_days);
+    set_detection_retention_days(config.detection_retention_days);
     log_info("Storage manager initialized");
 
+    // Start sampling system metrics for the system info API
+    if (init_system_metrics(config.storage_path) != 0) {
+        log_warn("Failed to start system metrics collector, system info will be incomplete");
+    }
+
     // Load stream configurations from database
     if (load_stream_configs(&config) < 0) {
         log_error("Failed to load stream configurations from database");
@@ -937,6 +953,8 @@ int main(int argc, char *argv[]) {
         .ssl_enabled = false,
         .max_connections = 100,
         .connection_timeout = 30,
+        .thread_pool_size = config.web_thread_pool_size,
+        .request_queue_size = config.web_request_queue_size,
         .daemon_mode = daemon_mode,
     };
 
@@ -1026,15 +1044,16 @@ cleanup:
 
     if (cleanup_pid == 0) {
         // Child process - watchdog timer
+        // The log writer thread is not forked, write to stderr directly
         sleep(30);  // 30 seconds for first phase timeout
-        log_error("Cleanup process phase 1 timed out after 30 seconds");
+        fprintf(stderr, "Cleanup process phase 1 timed out after 30 seconds\n");
         kill(getppid(), SIGUSR1);  // Send USR1 to parent to trigger emergency cleanup
 
         // Wait another 30 seconds for emergency cleanup
         sleep(30);
-        log_error("Cleanup process phase 2 timed out after 30 seconds, forcing exit");
+        fprintf(stderr, "Cleanup process phase 2 timed out after 30 seconds, forcing exit\n");
         kill(getppid(), SIGKILL);  // Force kill the parent process
-        exit(EXIT_FAILURE);
+        _exit(EXIT_FAILURE);
     } else if (cleanup_pid > 0) {
         // Parent process - continue with cleanup
 
@@ -1162,6 +1181,7 @@ cleanup:
         // This is important because HLS streaming is used by MP4 recording
         log_info("Cleaning up HLS streaming backend...");
         cleanup_hls_streaming_backend();
+        hls_memory_store_cleanup();
 
         // Wait for HLS streaming to clean up
         usleep(1000000);  // 1000ms
@@ -1173,6 +1193,9 @@ cleanup:
         // Wait for MP4 recording to clean up
         usleep(1000000);  // 1000ms
 
+        // Stop shared ingests before the stream readers feeding them are torn down
+        shutdown_packet_fanout_system();
+
         // Clean up stream reader backend last to ensure all consumers are stopped
         log_info("Cleaning up stream reader backend...");
         cleanup_stream_reader_backend();
@@ -1198,6 +1221,7 @@ cleanup:
         log_info("Shutting down web server...");
         http_server_stop(http_server);
         http_server_destroy(http_server);
+        timeline_manifest_cache_clear();
 
         log_info("Shutting down stream manager...");
         shutdown_stream_manager();
@@ -1208,6 +1232,9 @@ cleanup:
         log_info("Shutting down stream state manager...");
         shutdown_stream_state_manager();
 
+        log_info("Shutting down system metrics...");
+        shutdown_system_metrics();
+
         log_info("Shutting down storage manager...");
         shutdown_storage_manager();
 
@@ -1227,6 +1254,7 @@ cleanup:
 
         log_info("Shutting down database...");
         shutdown_database();
+        recording_index_cleanup();
 
         // Add another small delay after database shutdown
         usleep(100000);  // 100ms
@@ -1298,16 +1326,20 @@ cleanup:
         shutdown_detection_stream_system();
         cleanup_mp4_recording_backend();
         cleanup_hls_streaming_backend();
+        hls_memory_store_cleanup();
+        shutdown_packet_fanout_system();
         cleanup_stream_reader_backend();
         cleanup_transcoding_backend();
 
         // Shut down remaining components
         http_server_stop(http_server);
         http_server_destroy(http_server);
+        timeline_manifest_cache_clear();
 
         shutdown_stream_manager();
         shutdown_stream_state_adapter();
         shutdown_stream_state_manager();
+        shutdown_system_metrics();
         shutdown_storage_manager();
 
         // Ensure all database operations are complete before cleanup
@@ -1324,6 +1356,7 @@ cleanup:
         // Shutdown database
         log_info("Shutting down database...");
         shutdown_database();
+        recording_index_cleanup();
 
         // Add another small delay after database shutdown
         usleep(100000);  // 100ms
@@ -0,0 +1,391 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "core/metrics.h"
+#include "core/logger.h"
+
+// Per-thread copies of every value; threads are spread over the shards round-robin
+#define METRICS_SHARDS 8
+
+// Values are allocated in blocks of slots, each block holding all shards
+#define METRICS_BLOCK_SLOTS 512
+#define METRICS_MAX_BLOCKS 64
+
+// Histogram slots: the buckets followed by the sum of observations
+#define METRICS_HISTOGRAM_SLOTS (METRICS_HISTOGRAM_BUCKETS + 1)
+
+typedef enum {
+    METRICS_COUNTER = 0,
+    METRICS_GAUGE,
+    METRICS_HISTOGRAM
+} metrics_type_t;
+
+static const char *type_names[] = {"counter", "gauge", "histogram"};
+
+typedef struct {
+    char name[96];
+    char help[160];
+    metrics_type_t type;
+    int first_series;
+    int last_series;
+} metrics_family_t;
+
+typedef struct {
+    int family;
+    int next;                   // Next series of the same family, -1 at the end
+    int32_t slot;
+    char labels[128];
+} metrics_series_t;
+
+typedef _Atomic uint64_t metrics_value_t;
+
+// Block b holds METRICS_SHARDS runs of METRICS_BLOCK_SLOTS values, one run per shard,
+// so threads of different shards never write to the same cache line
+static metrics_value_t *_Atomic blocks[METRICS_MAX_BLOCKS];
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static metrics_family_t families[METRICS_MAX_FAMILIES];
+static int family_count = 0;
+static metrics_series_t series[METRICS_MAX_SERIES];
+static int series_count = 0;
+static int32_t next_slot = 1;     // Slot 0 is the value of a handle that was never registered
+
+static atomic_uint next_shard = 0;
+static _Thread_local int thread_shard = -1;
+
+static inline metrics_value_t *value_ptr(int32_t slot, int shard) {
+    metrics_value_t *block = atomic_load_explicit(&blocks[slot / METRICS_BLOCK_SLOTS], memory_order_acquire);
+    return &block[shard * METRICS_BLOCK_SLOTS + slot % METRICS_BLOCK_SLOTS];
+}
+
+static inline int current_shard(void) {
+    if (thread_shard < 0) {
+        thread_shard = (int)(atomic_fetch_add(&next_shard, 1) % METRICS_SHARDS);
+    }
+    return thread_shard;
+}
+
+static uint64_t sum_shards(int32_t slot) {
+    uint64_t total = 0;
+    for (int shard = 0; shard < METRICS_SHARDS; shard++) {
+        total += atomic_load_explicit(value_ptr(slot, shard), memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * Upper bound in microseconds of a histogram bucket: 1, 2, 3, 4, 6, 8, 12, 16, ...
+ */
+static uint64_t bucket_bound(int bucket) {
+    if (bucket == 0) {
+        return 1;
+    }
+    if (bucket & 1) {
+        return 1ULL << ((bucket + 1) / 2);
+    }
+    return 3ULL << (bucket / 2 - 1);
+}
+
+static int bucket_index(uint64_t value) {
+    if (value <= 1) {
+        return 0;
+    }
+
+    // 2^p < value <= 2^(p+1), split at 3 * 2^(p-1)
+    int p = 63 - __builtin_clzll(value - 1);
+    int bucket = (p >= 1 && value <= (3ULL << (p - 1))) ? 2 * p : 2 * p + 1;
+    return bucket < METRICS_HISTOGRAM_BUCKETS - 1 ? bucket : METRICS_HISTOGRAM_BUCKETS - 1;
+}
+
+/**
+ * Reserve contiguous value slots, allocating a block when needed
+ * Must be called with registry_mutex held.
+ */
+static int32_t reserve_slots(int count) {
+    int32_t slot = next_slot;
+
+    // A series never straddles two blocks
+    if (slot % METRICS_BLOCK_SLOTS + count > METRICS_BLOCK_SLOTS) {
+        slot += METRICS_BLOCK_SLOTS - slot % METRICS_BLOCK_SLOTS;
+    }
+
+    int block = slot / METRICS_BLOCK_SLOTS;
+    if (block >= METRICS_MAX_BLOCKS) {
+        return 0;
+    }
+
+    if (!atomic_load_explicit(&blocks[block], memory_order_relaxed)) {
+        metrics_value_t *values = calloc((size_t)METRICS_SHARDS * METRICS_BLOCK_SLOTS, sizeof(metrics_value_t));
+        if (!values) {
+            return 0;
+        }
+        atomic_store_explicit(&blocks[block], values, memory_order_release);
+    }
+
+    next_slot = slot + count;
+    return slot;
+}
+
+static int32_t register_series(const char *name, const char *help, const char *labels, metrics_type_t type) {
+    if (!name || !name[0]) {
+        return 0;
+    }
+    if (!labels) {
+        labels = "";
+    }
+
+    pthread_mutex_lock(&registry_mutex);
+
+    int family = -1;
+    for (int i = 0; i < family_count; i++) {
+        if (strcmp(families[i].name, name) == 0) {
+            family = i;
+            break;
+        }
+    }
+
+    if (family >= 0) {
+        if (families[family].type != type) {
+            pthread_mutex_unlock(&registry_mutex);
+            log_error("Metric %s is already registered as a %s", name, type_names[families[family].type]);
+            return 0;
+        }
+
+        for (int i = families[family].first_series; i >= 0; i = series[i].next) {
+            if (strcmp(series[i].labels, labels) == 0) {
+                int32_t slot = series[i].slot;
+                pthread_mutex_unlock(&registry_mutex);
+                return slot;
+            }
+        }
+    } else if (family_count >= METRICS_MAX_FAMILIES) {
+        pthread_mutex_unlock(&registry_mutex);
+        log_error("Too many metric families, not registering %s", name);
+        return 0;
+    }
+
+    int32_t slot = 0;
+    if (series_count < METRICS_MAX_SERIES) {
+        slot = reserve_slots(type == METRICS_HISTOGRAM ? METRICS_HISTOGRAM_SLOTS : 1);
+    }
+    if (slot == 0) {
+        pthread_mutex_unlock(&registry_mutex);
+        log_error("Metrics registry is full, not registering %s{%s}", name, labels);
+        return 0;
+    }
+
+    if (family < 0) {
+        family = family_count++;
+        metrics_family_t *f = &families[family];
+        strncpy(f->name, name, sizeof(f->name) - 1);
+        strncpy(f->help, help ? help : "", sizeof(f->help) - 1);
+        f->type = type;
+        f->first_series = -1;
+        f->last_series = -1;
+    }
+
+    int index = series_count++;
+    metrics_series_t *s = &series[index];
+    s->family = family;
+    s->next = -1;
+    s->slot = slot;
+    strncpy(s->labels, labels, sizeof(s->labels) - 1);
+
+    if (families[family].last_series >= 0) {
+        series[families[family].last_series].next = index;
+    } else {
+        families[family].first_series = index;
+    }
+    families[family].last_series = index;
+
+    pthread_mutex_unlock(&registry_mutex);
+    return slot;
+}
+
+metrics_counter_t metrics_counter(const char *name, const char *help, const char *labels) {
+    metrics_counter_t counter = {register_series(name, help, labels, METRICS_COUNTER)};
+    return counter;
+}
+
+metrics_gauge_t metrics_gauge(const char *name, const char *help, const char *labels) {
+    metrics_gauge_t gauge = {register_series(name, help, labels, METRICS_GAUGE)};
+    return gauge;
+}
+
+metrics_histogram_t metrics_histogram(const char *name, const char *help, const char *labels) {
+    metrics_histogram_t histogram = {register_series(name, help, labels, METRICS_HISTOGRAM)};
+    return histogram;
+}
+
+void metrics_label(char *labels, size_t size, const char *key, const char *value) {
+    if (!labels || size == 0 || !key) {
+        return;
+    }
+
+    size_t len = strnlen(labels, size);
+    int n = snprintf(labels + len, size - len, "%s%s=\"", len > 0 ? "," : "", key);
+    if (n < 0 || (size_t)n >= size - len) {
+        labels[len] = '\0';
+        return;
+    }
+    len += (size_t)n;
+
+    for (const char *p = value ? value : ""; *p && len + 3 < size; p++) {
+        if (*p == '\\' || *p == '"') {
+            labels[len++] = '\\';
+            labels[len++] = *p;
+        } else if (*p == '\n') {
+            labels[len++] = '\\';
+            labels[len++] = 'n';
+        } else {
+            labels[len++] = *p;
+        }
+    }
+    labels[len++] = '"';
+    labels[len] = '\0';
+}
+
+void metrics_counter_add(metrics_counter_t counter, uint64_t value) {
+    if (counter.slot == 0) {
+        return;
+    }
+    atomic_fetch_add_explicit(value_ptr(counter.slot, current_shard()), value, memory_order_relaxed);
+}
+
+void metrics_gauge_set(metrics_gauge_t gauge, int64_t value) {
+    if (gauge.slot == 0) {
+        return;
+    }
+    atomic_store_explicit(value_ptr(gauge.slot, 0), (uint64_t)value, memory_order_relaxed);
+}
+
+void metrics_gauge_add(metrics_gauge_t gauge, int64_t delta) {
+    if (gauge.slot == 0) {
+        return;
+    }
+    atomic_fetch_add_explicit(value_ptr(gauge.slot, 0), (uint64_t)delta, memory_order_relaxed);
+}
+
+void metrics_histogram_observe(metrics_histogram_t histogram, uint64_t value_us) {
+    if (histogram.slot == 0) {
+        return;
+    }
+    int shard = current_shard();
+    atomic_fetch_add_explicit(value_ptr(histogram.slot + bucket_index(value_us), shard), 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(value_ptr(histogram.slot + METRICS_HISTOGRAM_BUCKETS, shard), value_us,
+                              memory_order_relaxed);
+}
+
+uint64_t metrics_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+int metrics_buffer_printf(metrics_buffer_t *buf, const char *format, ...) {
+    for (;;) {
+        size_t room = buf->cap - buf->len;
+        if (buf->data && room > 0) {
+            va_list args;
+            va_start(args, format);
+            int n = vsnprintf(buf->data + buf->len, room, format, args);
+            va_end(args);
+            if (n < 0) {
+                return -1;
+            }
+            if ((size_t)n < room) {
+                buf->len += (size_t)n;
+                return 0;
+            }
+        }
+
+        size_t cap = buf->cap ? buf->cap * 2 : 16384;
+        char *data = realloc(buf->data, cap);
+        if (!data) {
+            return -1;
+        }
+        buf->data = data;
+        buf->cap = cap;
+    }
+}
+
+int metrics_buffer_family(metrics_buffer_t *buf, const char *name, const char *help, const char *type) {
+    return metrics_buffer_printf(buf, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void metrics_buffer_free(metrics_buffer_t *buf) {
+    if (buf) {
+        free(buf->data);
+        buf->data = NULL;
+        buf->len = 0;
+        buf->cap = 0;
+    }
+}
+
+static int render_histogram(metrics_buffer_t *buf, const metrics_family_t *f, const metrics_series_t *s) {
+    const char *sep = s->labels[0] ? "," : "";
+    uint64_t cumulative = 0;
+    int rc = 0;
+
+    for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS - 1 && rc == 0; i++) {
+        cumulative += sum_shards(s->slot + i);
+        rc = metrics_buffer_printf(buf, "%s_bucket{%s%sle=\"%.6f\"} %llu\n", f->name, s->labels, sep,
+                                   (double)bucket_bound(i) / 1e6, (unsigned long long)cumulative);
+    }
+    cumulative += sum_shards(s->slot + METRICS_HISTOGRAM_BUCKETS - 1);
+
+    double sum = (double)sum_shards(s->slot + METRICS_HISTOGRAM_BUCKETS) / 1e6;
+    if (rc == 0) {
+        rc = metrics_buffer_printf(buf, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", f->name, s->labels, sep,
+                                   (unsigned long long)cumulative);
+    }
+    if (rc == 0) {
+        rc = metrics_buffer_printf(buf, s->labels[0] ? "%s_sum{%s} %.6f\n%s_count{%s} %llu\n"
+                                                     : "%s_sum%s %.6f\n%s_count%s %llu\n",
+                                   f->name, s->labels, sum, f->name, s->labels, (unsigned long long)cumulative);
+    }
+    return rc;
+}
+
+int metrics_render(metrics_buffer_t *buf) {
+    int rc = 0;
+
+    pthread_mutex_lock(&registry_mutex);
+    for (int i = 0; i < family_count && rc == 0; i++) {
+        const metrics_family_t *f = &families[i];
+        rc = metrics_buffer_family(buf, f->name, f->help, type_names[f->type]);
+
+        for (int j = f->first_series; j >= 0 && rc == 0; j = series[j].next) {
+            const metrics_series_t *s = &series[j];
+            const char *open = s->labels[0] ? "{" : "";
+            const char *close = s->labels[0] ? "}" : "";
+
+            switch (f->type) {
+                case METRICS_COUNTER:
+                    rc = metrics_buffer_printf(buf, "%s%s%s%s %llu\n", f->name, open, s->labels, close,
+                                               (unsigned long long)sum_shards(s->slot));
+                    break;
+                case METRICS_GAUGE:
+                    rc = metrics_buffer_printf(buf, "%s%s%s%s %lld\n", f->name, open, s->labels, close,
+                                               (long long)(int64_t)atomic_load_explicit(value_ptr(s->slot, 0),
+                                                                                       memory_order_relaxed));
+                    break;
+                case METRICS_HISTOGRAM:
+                    rc = render_histogram(buf, f, s);
+                    break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+
+    return rc;
+}
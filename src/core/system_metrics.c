@@ -0,0 +1,372 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/sysinfo.h>
+#include <sys/statvfs.h>
+
+#include "core/system_metrics.h"
+#include "core/logger.h"
+#include "database/db_recordings.h"
+#include "database/db_streams.h"
+
+#ifdef USE_GO2RTC
+#include "video/go2rtc/go2rtc_process.h"
+#endif
+
+// CPU time counters of one sample, in clock ticks
+typedef struct {
+    unsigned long long busy;
+    unsigned long long total;
+    unsigned long long process;
+    bool valid;
+} cpu_sample_t;
+
+static char storage_path[256];
+
+static pthread_t collector_thread;
+static bool collector_running = false;
+static pthread_mutex_t collector_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t collector_cond = PTHREAD_COND_INITIALIZER;
+static bool stop_requested = false;
+
+// Published snapshot, guarded by a sequence counter: odd while the collector
+// writes it, readers retry when the counter moved during their copy
+static system_metrics_snapshot_t published;
+static atomic_uint published_seq = 0;
+
+/**
+ * Read the first value following a key in a /proc status file
+ */
+static bool read_status_value(const char *path, const char *key, unsigned long long *value) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return false;
+    }
+
+    char line[256];
+    size_t key_len = strlen(key);
+    bool found = false;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, key, key_len) == 0) {
+            found = sscanf(line + key_len, "%llu", value) == 1;
+            break;
+        }
+    }
+
+    fclose(fp);
+    return found;
+}
+
+/**
+ * Read the system-wide and process CPU counters
+ */
+static void read_cpu_sample(cpu_sample_t *sample) {
+    memset(sample, 0, sizeof(*sample));
+
+    FILE *fp = fopen("/proc/stat", "r");
+    if (!fp) {
+        return;
+    }
+    unsigned long long user, nice, system, idle, iowait, irq, softirq, steal = 0;
+    int fields = fscanf(fp, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+                        &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
+    fclose(fp);
+    if (fields < 7) {
+        return;
+    }
+    sample->busy = user + nice + system + irq + softirq + steal;
+    sample->total = sample->busy + idle + iowait;
+    sample->valid = true;
+
+    // utime and stime are the 14th and 15th fields, the first 13 after the command name
+    fp = fopen("/proc/self/stat", "r");
+    if (!fp) {
+        return;
+    }
+    char buf[1024];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[len] = '\0';
+
+    char *p = strrchr(buf, ')');
+    unsigned long long utime, stime;
+    if (p && sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+                    &utime, &stime) == 2) {
+        sample->process = utime + stime;
+    }
+}
+
+/**
+ * Seconds the process has been running
+ */
+static double read_process_uptime(void) {
+    static unsigned long long start_ticks = 0;
+
+    if (start_ticks == 0) {
+        // starttime is the 22nd field, in clock ticks since boot
+        FILE *fp = fopen("/proc/self/stat", "r");
+        if (fp) {
+            char buf[1024];
+            size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+            fclose(fp);
+            buf[len] = '\0';
+
+            char *p = strrchr(buf, ')');
+            if (p) {
+                sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu",
+                       &start_ticks);
+            }
+        }
+    }
+
+    double system_uptime = 0;
+    FILE *fp = fopen("/proc/uptime", "r");
+    if (fp) {
+        if (fscanf(fp, "%lf", &system_uptime) != 1) {
+            system_uptime = 0;
+        }
+        fclose(fp);
+    }
+
+    if (start_ticks == 0 || system_uptime == 0) {
+        struct sysinfo info;
+        return sysinfo(&info) == 0 ? (double)info.uptime : 0;
+    }
+
+    double uptime = system_uptime - (double)start_ticks / (double)sysconf(_SC_CLK_TCK);
+    return uptime > 0 ? uptime : 0;
+}
+
+/**
+ * Refresh filesystem and recording storage figures
+ */
+static void sample_storage(system_metrics_snapshot_t *snap) {
+    struct statvfs fs;
+    snap->storage_valid = statvfs(storage_path, &fs) == 0;
+    if (snap->storage_valid) {
+        snap->storage_total = (uint64_t)fs.f_blocks * fs.f_frsize;
+        snap->storage_free = (uint64_t)fs.f_bfree * fs.f_frsize;
+    }
+    if (statvfs("/", &fs) == 0) {
+        snap->root_total = (uint64_t)fs.f_blocks * fs.f_frsize;
+        snap->root_free = (uint64_t)fs.f_bfree * fs.f_frsize;
+    }
+
+    uint64_t total_bytes = 0;
+    uint64_t total_count = 0;
+    if (get_recording_usage_totals(&total_bytes, &total_count) == 0) {
+        snap->recording_bytes = total_bytes;
+        snap->recording_count = total_count;
+    }
+
+    stream_recording_usage_t *usage = calloc(RECORDING_USAGE_MAX_STREAMS, sizeof(stream_recording_usage_t));
+    if (!usage) {
+        return;
+    }
+
+    int count = get_stream_recording_usage(usage, RECORDING_USAGE_MAX_STREAMS);
+    if (count >= 0) {
+        for (int i = 0; i < count; i++) {
+            system_metrics_stream_t *stream = &snap->streams[i];
+            strncpy(stream->name, usage[i].stream_name, sizeof(stream->name) - 1);
+            stream->name[sizeof(stream->name) - 1] = '\0';
+            stream->size_bytes = usage[i].total_bytes;
+            stream->recording_count = usage[i].recording_count;
+
+            stream_storage_policy_t policy;
+            stream->quota_bytes = 0;
+            if (get_stream_storage_policy(usage[i].stream_name, &policy) == 0) {
+                stream->quota_bytes = policy.max_storage_bytes;
+            }
+        }
+        snap->stream_count = count;
+    }
+
+    free(usage);
+}
+
+/**
+ * Refresh CPU, memory and process figures
+ */
+static void sample_system(system_metrics_snapshot_t *snap, cpu_sample_t *previous) {
+    cpu_sample_t current;
+    read_cpu_sample(&current);
+
+    snap->cpu_cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (current.valid && previous->valid && current.total > previous->total) {
+        double elapsed = (double)(current.total - previous->total);
+        snap->cpu_usage = (double)(current.busy - previous->busy) / elapsed * 100.0;
+
+        // /proc/stat counts ticks of all cores, the process share is of one core
+        int cores = snap->cpu_cores > 0 ? snap->cpu_cores : 1;
+        snap->process_cpu_usage = (double)(current.process - previous->process) / (elapsed / cores) * 100.0;
+    }
+    *previous = current;
+
+    struct sysinfo info;
+    if (sysinfo(&info) == 0) {
+        snap->memory_total = (uint64_t)info.totalram * info.mem_unit;
+        snap->memory_free = (uint64_t)info.freeram * info.mem_unit;
+    }
+
+    // VmRSS is in kB
+    unsigned long long rss_kb = 0;
+    snap->process_rss = read_status_value("/proc/self/status", "VmRSS:", &rss_kb) ? rss_kb * 1024 : 0;
+
+    snap->go2rtc_running = false;
+    snap->go2rtc_rss = 0;
+#ifdef USE_GO2RTC
+    pid_t pid = go2rtc_process_get_pid();
+    if (pid > 0) {
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+        snap->go2rtc_running = true;
+        if (read_status_value(path, "VmRSS:", &rss_kb)) {
+            snap->go2rtc_rss = rss_kb * 1024;
+        }
+    }
+#endif
+
+    snap->process_uptime = read_process_uptime();
+}
+
+/**
+ * Publish a snapshot
+ */
+static void publish(const system_metrics_snapshot_t *snap) {
+    unsigned seq = atomic_load_explicit(&published_seq, memory_order_relaxed);
+    atomic_store_explicit(&published_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&published, snap, sizeof(published));
+    atomic_store_explicit(&published_seq, seq + 2, memory_order_release);
+}
+
+static void *collector_thread_func(void *arg) {
+    (void)arg;
+
+    system_metrics_snapshot_t *snap = calloc(1, sizeof(system_metrics_snapshot_t));
+    if (!snap) {
+        log_error("Failed to allocate memory for system metrics");
+        return NULL;
+    }
+
+    cpu_sample_t cpu;
+    read_cpu_sample(&cpu);
+    time_t next_sample = 0;
+    uint64_t storage_generation = 0;
+
+    pthread_mutex_lock(&collector_mutex);
+    while (!stop_requested) {
+        time_t now = time(NULL);
+        bool sample_due = now >= next_sample;
+
+        // Recordings finalized or deleted since the last refresh
+        uint64_t generation = get_recording_usage_generation();
+        bool storage_due = sample_due || generation != storage_generation;
+
+        if (storage_due) {
+            pthread_mutex_unlock(&collector_mutex);
+
+            if (sample_due) {
+                sample_system(snap, &cpu);
+                next_sample = now + SYSTEM_METRICS_INTERVAL_SEC;
+            }
+            sample_storage(snap);
+            storage_generation = generation;
+            snap->sample_time = now;
+            publish(snap);
+
+            pthread_mutex_lock(&collector_mutex);
+            if (stop_requested) {
+                break;
+            }
+        }
+
+        // Check for storage changes once per second
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += 1;
+        pthread_cond_timedwait(&collector_cond, &collector_mutex, &deadline);
+    }
+    pthread_mutex_unlock(&collector_mutex);
+
+    free(snap);
+    return NULL;
+}
+
+int init_system_metrics(const char *path) {
+    pthread_mutex_lock(&collector_mutex);
+    if (collector_running) {
+        pthread_mutex_unlock(&collector_mutex);
+        return 0;
+    }
+
+    strncpy(storage_path, path ? path : "/", sizeof(storage_path) - 1);
+    storage_path[sizeof(storage_path) - 1] = '\0';
+    stop_requested = false;
+
+    if (pthread_create(&collector_thread, NULL, collector_thread_func, NULL) != 0) {
+        log_error("Failed to start system metrics thread: %s", strerror(errno));
+        pthread_mutex_unlock(&collector_mutex);
+        return -1;
+    }
+    collector_running = true;
+    pthread_mutex_unlock(&collector_mutex);
+
+    log_info("System metrics collector started (interval %d seconds)", SYSTEM_METRICS_INTERVAL_SEC);
+    return 0;
+}
+
+void shutdown_system_metrics(void) {
+    pthread_mutex_lock(&collector_mutex);
+    if (!collector_running) {
+        pthread_mutex_unlock(&collector_mutex);
+        return;
+    }
+    stop_requested = true;
+    pthread_cond_signal(&collector_cond);
+    pthread_mutex_unlock(&collector_mutex);
+
+    pthread_join(collector_thread, NULL);
+
+    pthread_mutex_lock(&collector_mutex);
+    collector_running = false;
+    pthread_mutex_unlock(&collector_mutex);
+
+    log_info("System metrics collector stopped");
+}
+
+int system_metrics_get_snapshot(system_metrics_snapshot_t *snapshot) {
+    if (!snapshot) {
+        return -1;
+    }
+
+    for (;;) {
+        unsigned seq = atomic_load_explicit(&published_seq, memory_order_acquire);
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+
+        memcpy(snapshot, &published, sizeof(*snapshot));
+        atomic_thread_fence(memory_order_acquire);
+
+        if (atomic_load_explicit(&published_seq, memory_order_relaxed) == seq) {
+            break;
+        }
+    }
+
+    return snapshot->sample_time != 0 ? 0 : -1;
+}
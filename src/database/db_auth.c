@@ -15,6 +15,7 @@
 
 #include "database/db_auth.h"
 #include "database/db_core.h"
+#include "database/db_auth_cache.h"
 #include "core/logger.h"
 #include "core/config.h"
 
@@ -429,6 +430,10 @@ int db_auth_update_user(int64_t user_id, const char *email, int role, int is_act
     
     sqlite3_finalize(stmt);
     
+    // The user may have been deactivated
+    auth_cache_invalidate_user_sessions(user_id);
+    auth_cache_invalidate_user_credentials(user_id);
+    
     log_info("User updated successfully: %lld", (long long)user_id);
     return 0;
 }
@@ -543,6 +548,8 @@ int db_auth_change_password(int64_t user_id, const char *new_password) {
     
     sqlite3_finalize(stmt);
     
+    auth_cache_invalidate_user_credentials(user_id);
+    
     log_info("Password changed successfully for user: %lld", (long long)user_id);
     return 0;
 }
@@ -593,6 +600,9 @@ int db_auth_delete_user(int64_t user_id) {
     
     sqlite3_finalize(stmt);
     
+    auth_cache_invalidate_user_sessions(user_id);
+    auth_cache_invalidate_user_credentials(user_id);
+    
     log_info("User deleted successfully: %lld", (long long)user_id);
     return 0;
 }
@@ -876,6 +886,12 @@ int db_auth_authenticate(const char *username, const char *password, int64_t *us
         return -1;
     }
     
+    // Pairs verified recently skip the query and the PBKDF2 computation
+    if (auth_cache_lookup_credentials(username, password, user_id)) {
+        return 0;
+    }
+    uint64_t cache_generation = auth_cache_generation();
+    
     sqlite3 *db = get_db_handle();
     if (!db) {
         log_error("Database not initialized");
@@ -954,6 +970,7 @@ int db_auth_authenticate(const char *username, const char *password, int64_t *us
     if (user_id) {
         *user_id = id;
     }
+    auth_cache_store_credentials(username, password, id, cache_generation);
     
     // Update last login time
     sqlite3_finalize(stmt);
@@ -1068,6 +1085,11 @@ int db_auth_validate_session(const char *token, int64_t *user_id) {
         return -1;
     }
     
+    if (auth_cache_lookup_session(token, user_id)) {
+        return 0;
+    }
+    uint64_t cache_generation = auth_cache_generation();
+    
     sqlite3 *db = get_db_handle();
     if (!db) {
         log_error("Database not initialized");
@@ -1121,6 +1143,8 @@ int db_auth_validate_session(const char *token, int64_t *user_id) {
     
     sqlite3_finalize(stmt);
     
+    auth_cache_store_session(token, id, expires_at, cache_generation);
+    
     return 0;
 }
 
@@ -1158,6 +1182,8 @@ int db_auth_delete_session(const char *token) {
     
     sqlite3_finalize(stmt);
     
+    auth_cache_invalidate_session(token);
+    
     log_info("Session deleted successfully");
     return 0;
 }
@@ -1191,6 +1217,8 @@ int db_auth_delete_user_sessions(int64_t user_id) {
     
     sqlite3_finalize(stmt);
     
+    auth_cache_invalidate_user_sessions(user_id);
+    
     log_info("Sessions deleted successfully for user: %lld", (long long)user_id);
     return 0;
 }
@@ -0,0 +1,352 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "database/db_auth_cache.h"
+#include "core/logger.h"
+#include "core/config.h"
+
+#include <mbedtls/md.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+
+#define AUTH_CACHE_SHARDS 16
+#define AUTH_CACHE_SLOTS 64     // Entries of each kind per shard
+#define AUTH_CACHE_PROBE 8      // Slots searched from the home slot of a key
+#define AUTH_CACHE_DIGEST 32
+
+typedef struct {
+    uint64_t hash;              // 0 when the slot is free
+    char token[128];
+    int64_t user_id;
+    time_t valid_until;         // Earliest of session expiry and cache TTL
+} session_entry_t;
+
+typedef struct {
+    uint64_t hash;              // 0 when the slot is free
+    char username[64];
+    unsigned char digest[AUTH_CACHE_DIGEST];
+    int64_t user_id;
+    time_t valid_until;
+} credential_entry_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    session_entry_t sessions[AUTH_CACHE_SLOTS];
+    credential_entry_t credentials[AUTH_CACHE_SLOTS];
+} auth_cache_shard_t;
+
+static auth_cache_shard_t shards[AUTH_CACHE_SHARDS];
+static unsigned char digest_key[32];
+static bool cache_ready = false;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static atomic_uint_fast64_t generation_counter = 0;
+
+static void auth_cache_init(void) {
+    for (int i = 0; i < AUTH_CACHE_SHARDS; i++) {
+        pthread_mutex_init(&shards[i].lock, NULL);
+    }
+
+    // Key of the credential digests, never leaves the process
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    if (mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
+                              (const unsigned char *)"lightnvr-auth-cache", 19) == 0 &&
+        mbedtls_ctr_drbg_random(&ctr_drbg, digest_key, sizeof(digest_key)) == 0) {
+        cache_ready = true;
+    } else {
+        log_error("Failed to seed the authentication cache, caching disabled");
+    }
+    mbedtls_ctr_drbg_free(&ctr_drbg);
+    mbedtls_entropy_free(&entropy);
+}
+
+/**
+ * Check that the cache can be used and return the TTL, 0 if disabled
+ */
+static int cache_ttl(void) {
+    pthread_once(&cache_once, auth_cache_init);
+    return cache_ready ? g_config.web_auth_cache_ttl : 0;
+}
+
+static uint64_t hash_bytes(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    // 0 marks a free slot
+    return hash ? hash : 1;
+}
+
+static auth_cache_shard_t *shard_for(uint64_t hash) {
+    return &shards[hash % AUTH_CACHE_SHARDS];
+}
+
+static int home_slot(uint64_t hash) {
+    return (int)((hash / AUTH_CACHE_SHARDS) % AUTH_CACHE_SLOTS);
+}
+
+/**
+ * Keyed digest of a username/password pair
+ */
+static int credential_digest(const char *username, const char *password,
+                             unsigned char digest[AUTH_CACHE_DIGEST]) {
+    const mbedtls_md_info_t *md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    mbedtls_md_context_t ctx;
+    int rc;
+
+    mbedtls_md_init(&ctx);
+    rc = mbedtls_md_setup(&ctx, md, 1);
+    if (rc == 0) rc = mbedtls_md_hmac_starts(&ctx, digest_key, sizeof(digest_key));
+    // The terminator of the username separates the fields, "ab"+"c" and "a"+"bc" differ
+    if (rc == 0) rc = mbedtls_md_hmac_update(&ctx, (const unsigned char *)username, strlen(username) + 1);
+    if (rc == 0) rc = mbedtls_md_hmac_update(&ctx, (const unsigned char *)password, strlen(password));
+    if (rc == 0) rc = mbedtls_md_hmac_finish(&ctx, digest);
+    mbedtls_md_free(&ctx);
+    return rc == 0 ? 0 : -1;
+}
+
+static bool digest_equal(const unsigned char *a, const unsigned char *b) {
+    unsigned char diff = 0;
+    for (int i = 0; i < AUTH_CACHE_DIGEST; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+uint64_t auth_cache_generation(void) {
+    return atomic_load(&generation_counter);
+}
+
+/**
+ * Start an invalidation: stores of validations begun before it are dropped
+ */
+static void bump_generation(void) {
+    pthread_once(&cache_once, auth_cache_init);
+    atomic_fetch_add(&generation_counter, 1);
+}
+
+bool auth_cache_lookup_session(const char *token, int64_t *user_id) {
+    if (!token || cache_ttl() <= 0) {
+        return false;
+    }
+
+    uint64_t hash = hash_bytes(token, strlen(token));
+    auth_cache_shard_t *shard = shard_for(hash);
+    int home = home_slot(hash);
+    time_t now = time(NULL);
+    bool found = false;
+
+    pthread_mutex_lock(&shard->lock);
+    for (int i = 0; i < AUTH_CACHE_PROBE; i++) {
+        session_entry_t *e = &shard->sessions[(home + i) % AUTH_CACHE_SLOTS];
+        if (e->hash == hash && strcmp(e->token, token) == 0) {
+            if (now <= e->valid_until) {
+                if (user_id) {
+                    *user_id = e->user_id;
+                }
+                found = true;
+            } else {
+                e->hash = 0;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return found;
+}
+
+void auth_cache_store_session(const char *token, int64_t user_id, time_t expires_at,
+                              uint64_t generation) {
+    int ttl = cache_ttl();
+    if (!token || ttl <= 0 || strlen(token) >= sizeof(((session_entry_t *)0)->token)) {
+        return;
+    }
+
+    uint64_t hash = hash_bytes(token, strlen(token));
+    auth_cache_shard_t *shard = shard_for(hash);
+    int home = home_slot(hash);
+    time_t now = time(NULL);
+    time_t valid_until = now + ttl < expires_at ? now + ttl : expires_at;
+
+    pthread_mutex_lock(&shard->lock);
+    // Reuse the entry of the token, else a free or expired slot, else the one expiring first
+    session_entry_t *target = NULL;
+    for (int i = 0; i < AUTH_CACHE_PROBE && !target; i++) {
+        session_entry_t *e = &shard->sessions[(home + i) % AUTH_CACHE_SLOTS];
+        if (e->hash == hash && strcmp(e->token, token) == 0) {
+            target = e;
+        }
+    }
+    bool reuse = target != NULL;
+    time_t target_rank = 0;
+    for (int i = 0; i < AUTH_CACHE_PROBE && !reuse; i++) {
+        session_entry_t *e = &shard->sessions[(home + i) % AUTH_CACHE_SLOTS];
+        time_t rank = (e->hash == 0 || e->valid_until < now) ? 0 : e->valid_until;
+        if (!target || rank < target_rank) {
+            target = e;
+            target_rank = rank;
+        }
+    }
+    if (atomic_load(&generation_counter) != generation) {
+        // Invalidated while the caller was querying the database
+        pthread_mutex_unlock(&shard->lock);
+        return;
+    }
+    target->hash = hash;
+    strcpy(target->token, token);
+    target->user_id = user_id;
+    target->valid_until = valid_until;
+    pthread_mutex_unlock(&shard->lock);
+}
+
+bool auth_cache_lookup_credentials(const char *username, const char *password, int64_t *user_id) {
+    unsigned char digest[AUTH_CACHE_DIGEST];
+    if (!username || !password || cache_ttl() <= 0 || credential_digest(username, password, digest) != 0) {
+        return false;
+    }
+
+    uint64_t hash = hash_bytes(username, strlen(username));
+    auth_cache_shard_t *shard = shard_for(hash);
+    int home = home_slot(hash);
+    time_t now = time(NULL);
+    bool found = false;
+
+    pthread_mutex_lock(&shard->lock);
+    for (int i = 0; i < AUTH_CACHE_PROBE; i++) {
+        credential_entry_t *e = &shard->credentials[(home + i) % AUTH_CACHE_SLOTS];
+        if (e->hash == hash && strcmp(e->username, username) == 0) {
+            if (now <= e->valid_until && digest_equal(e->digest, digest)) {
+                if (user_id) {
+                    *user_id = e->user_id;
+                }
+                found = true;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return found;
+}
+
+void auth_cache_store_credentials(const char *username, const char *password, int64_t user_id,
+                                  uint64_t generation) {
+    unsigned char digest[AUTH_CACHE_DIGEST];
+    int ttl = cache_ttl();
+    if (!username || !password || ttl <= 0 ||
+        strlen(username) >= sizeof(((credential_entry_t *)0)->username) ||
+        credential_digest(username, password, digest) != 0) {
+        return;
+    }
+
+    uint64_t hash = hash_bytes(username, strlen(username));
+    auth_cache_shard_t *shard = shard_for(hash);
+    int home = home_slot(hash);
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&shard->lock);
+    // One entry per username: a new password replaces the previous one
+    credential_entry_t *target = NULL;
+    for (int i = 0; i < AUTH_CACHE_PROBE && !target; i++) {
+        credential_entry_t *e = &shard->credentials[(home + i) % AUTH_CACHE_SLOTS];
+        if (e->hash == hash && strcmp(e->username, username) == 0) {
+            target = e;
+        }
+    }
+    bool reuse = target != NULL;
+    time_t target_rank = 0;
+    for (int i = 0; i < AUTH_CACHE_PROBE && !reuse; i++) {
+        credential_entry_t *e = &shard->credentials[(home + i) % AUTH_CACHE_SLOTS];
+        time_t rank = (e->hash == 0 || e->valid_until < now) ? 0 : e->valid_until;
+        if (!target || rank < target_rank) {
+            target = e;
+            target_rank = rank;
+        }
+    }
+    if (atomic_load(&generation_counter) != generation) {
+        pthread_mutex_unlock(&shard->lock);
+        return;
+    }
+    target->hash = hash;
+    strcpy(target->username, username);
+    memcpy(target->digest, digest, sizeof(digest));
+    target->user_id = user_id;
+    target->valid_until = now + ttl;
+    pthread_mutex_unlock(&shard->lock);
+}
+
+void auth_cache_invalidate_session(const char *token) {
+    if (!token) {
+        return;
+    }
+    bump_generation();
+
+    uint64_t hash = hash_bytes(token, strlen(token));
+    auth_cache_shard_t *shard = shard_for(hash);
+    int home = home_slot(hash);
+
+    pthread_mutex_lock(&shard->lock);
+    for (int i = 0; i < AUTH_CACHE_PROBE; i++) {
+        session_entry_t *e = &shard->sessions[(home + i) % AUTH_CACHE_SLOTS];
+        if (e->hash == hash && strcmp(e->token, token) == 0) {
+            e->hash = 0;
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+}
+
+void auth_cache_invalidate_user_sessions(int64_t user_id) {
+    bump_generation();
+
+    for (int s = 0; s < AUTH_CACHE_SHARDS; s++) {
+        pthread_mutex_lock(&shards[s].lock);
+        for (int i = 0; i < AUTH_CACHE_SLOTS; i++) {
+            if (shards[s].sessions[i].user_id == user_id) {
+                shards[s].sessions[i].hash = 0;
+            }
+        }
+        pthread_mutex_unlock(&shards[s].lock);
+    }
+}
+
+void auth_cache_invalidate_user_credentials(int64_t user_id) {
+    bump_generation();
+
+    for (int s = 0; s < AUTH_CACHE_SHARDS; s++) {
+        pthread_mutex_lock(&shards[s].lock);
+        for (int i = 0; i < AUTH_CACHE_SLOTS; i++) {
+            if (shards[s].credentials[i].user_id == user_id) {
+                shards[s].credentials[i].hash = 0;
+            }
+        }
+        pthread_mutex_unlock(&shards[s].lock);
+    }
+}
+
+void auth_cache_clear(void) {
+    bump_generation();
+
+    for (int s = 0; s < AUTH_CACHE_SHARDS; s++) {
+        pthread_mutex_lock(&shards[s].lock);
+        for (int i = 0; i < AUTH_CACHE_SLOTS; i++) {
+            shards[s].sessions[i].hash = 0;
+            shards[s].credentials[i].hash = 0;
+        }
+        pthread_mutex_unlock(&shards[s].lock);
+    }
+}
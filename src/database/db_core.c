@@ -21,6 +21,9 @@
 #include "database/db_core.h"
 #include "database/db_schema.h"
 #include "database/db_backup.h"
+#include "database/db_pool.h"
+#include "database/db_writer.h"
+#include "database/db_timeline_rollups.h"
 #include "core/logger.h"
 
 // Database handle
@@ -47,7 +50,7 @@ static bool wal_mode_enabled = false;
 // Flag to indicate if a backup is in progress
 static bool backup_in_progress = false;
 
-// No longer tracking prepared statements - each function is responsible for finalizing its own statements
+// Statements from db_prepare_cached() are owned by db_pool.c, all others are finalized by the function that prepared them
 
 // Create directory if it doesn't exist
 static int create_directory(const char *path) {
@@ -574,6 +577,21 @@ int init_database(const char *db_path) {
         return -1;
     }
 
+    // Realign the timeline rollups if the local time zone changed
+    if (timeline_rollup_check_zone(db) != 0) {
+        log_warn("Failed to realign timeline rollups with the local time zone");
+    }
+
+    // Open the reader connections now that the schema is up to date
+    if (db_pool_init(db_path, db) != 0) {
+        log_warn("Failed to initialize database reader pool");
+    }
+
+    // Start the group commit writer
+    if (db_writer_init(db) != 0) {
+        log_warn("Failed to start database writer");
+    }
+
     log_info("Database initialized successfully");
 
     // Create an initial backup if this is a new database
@@ -611,6 +629,9 @@ static void reset_sqlite_internal_state(void) {
 void shutdown_database(void) {
     log_info("Starting database shutdown process");
 
+    // Commit the queued writes while the database is still open
+    db_writer_shutdown();
+
     // Create a final backup before shutting down
     if (db != NULL && db_file_path[0] != '\0') {
         log_info("Creating final backup before shutdown");
@@ -658,6 +679,9 @@ void shutdown_database(void) {
         // Store the database handle locally but DO NOT set the global to NULL yet
         sqlite3 *db_to_close = db;
 
+        // Close the reader connections and drop the cached statements
+        db_pool_shutdown();
+
         // If WAL mode is enabled, checkpoint the database to ensure all changes are written to the main database file
         if (wal_mode_enabled) {
             log_info("Checkpointing WAL before closing database");
@@ -12,191 +12,191 @@
 
 #include "database/db_detections.h"
 #include "database/db_core.h"
+#include "database/db_pool.h"
+#include "database/db_writer.h"
+#include "database/db_recordings.h"
+#include "database/db_timeline_rollups.h"
 #include "core/logger.h"
 #include "video/detection_result.h"
 
 /**
- * Store detection results in the database
- * 
- * @param stream_name Stream name
- * @param result Detection results
- * @param timestamp Timestamp of the detection (0 for current time)
- * @return 0 on success, non-zero on failure
+ * Detections queued for the database writer
  */
-int store_detections_in_db(const char *stream_name, const detection_result_t *result, time_t timestamp) {
-    int rc;
+typedef struct {
+    char stream_name[64];
+    time_t timestamp;
+    int count;
+    detection_t detections[MAX_DETECTIONS];
+} detections_write_t;
+
+/**
+ * Bit of a label in the recording detection mask, assigning the next free one
+ * to a label seen for the first time
+ */
+static int get_label_bit(sqlite3 *db, const char *label) {
     sqlite3_stmt *stmt;
-    
-    sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
-    
-    if (!db) {
-        log_error("Database not initialized when trying to store detections");
-        return -1;
-    }
-    
-    if (!stream_name || !result) {
-        log_error("Invalid parameters for store_detections_in_db: stream_name=%p, result=%p", 
-                 stream_name, result);
-        return -1;
-    }
-    
-    // Use current time if timestamp is 0
-    if (timestamp == 0) {
-        timestamp = time(NULL);
-    }
-    
-    log_info("Storing %d detections in database for stream %s", result->count, stream_name);
-    
-    // Log the first detection for debugging
-    if (result->count > 0) {
-        log_info("First detection: %s (%.2f%%) at [%.2f, %.2f, %.2f, %.2f]",
-                result->detections[0].label,
-                result->detections[0].confidence * 100.0f,
-                result->detections[0].x,
-                result->detections[0].y,
-                result->detections[0].width,
-                result->detections[0].height);
-    }
-    
-    pthread_mutex_lock(db_mutex);
-    
-    // Check if detections table exists
-    char *err_msg = NULL;
-    char **query_result;
-    int rows, cols;
-    rc = sqlite3_get_table(db, 
-                          "SELECT name FROM sqlite_master WHERE type='table' AND name='detections';", 
-                          &query_result, &rows, &cols, &err_msg);
-    
-    if (rc != SQLITE_OK) {
-        log_error("Failed to check if detections table exists: %s", err_msg);
-        sqlite3_free(err_msg);
-        pthread_mutex_unlock(db_mutex);
-        return -1;
-    }
-    
-    if (rows == 0) {
-        log_error("Detections table does not exist, recreating it");
-        sqlite3_free_table(query_result);
-        
-        // Create detections table
-        const char *create_detections_table = 
-            "CREATE TABLE IF NOT EXISTS detections ("
-            "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-            "stream_name TEXT NOT NULL,"
-            "timestamp INTEGER NOT NULL,"
-            "label TEXT NOT NULL,"
-            "confidence REAL NOT NULL,"
-            "x REAL NOT NULL,"
-            "y REAL NOT NULL,"
-            "width REAL NOT NULL,"
-            "height REAL NOT NULL"
-            ");";
-        
-        rc = sqlite3_exec(db, create_detections_table, NULL, NULL, &err_msg);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to create detections table: %s", err_msg);
-            sqlite3_free(err_msg);
-            pthread_mutex_unlock(db_mutex);
+    int bit = -1;
+
+    for (int attempt = 0; attempt < 2 && bit < 0; attempt++) {
+        if (db_prepare_cached(db, "SELECT bit FROM detection_labels WHERE label = ?;", &stmt) != SQLITE_OK) {
             return -1;
         }
-        
-        // Create indexes
-        const char *create_indexes = 
-            "CREATE INDEX IF NOT EXISTS idx_detections_stream_timestamp ON detections (stream_name, timestamp);"
-            "CREATE INDEX IF NOT EXISTS idx_detections_timestamp ON detections (timestamp);";
-        
-        rc = sqlite3_exec(db, create_indexes, NULL, NULL, &err_msg);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to create indexes: %s", err_msg);
-            sqlite3_free(err_msg);
-            pthread_mutex_unlock(db_mutex);
-            return -1;
+        sqlite3_bind_text(stmt, 1, label, -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            bit = sqlite3_column_int(stmt, 0);
+        }
+        db_release_statement(stmt);
+
+        if (bit < 0 && attempt == 0) {
+            if (db_prepare_cached(db, "INSERT OR IGNORE INTO detection_labels (label, bit) "
+                                      "SELECT ?1, MIN(COUNT(*), ?2) FROM detection_labels;", &stmt) != SQLITE_OK) {
+                return -1;
+            }
+            sqlite3_bind_text(stmt, 1, label, -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 2, RECORDING_DETECTION_MAX_BIT);
+            sqlite3_step(stmt);
+            db_release_statement(stmt);
         }
-    } else {
-        sqlite3_free_table(query_result);
-    }
-    
-    // Begin transaction for better performance when inserting multiple detections
-    rc = sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, &err_msg);
-    if (rc != SQLITE_OK) {
-        log_error("Failed to begin transaction: %s", err_msg);
-        sqlite3_free(err_msg);
-        pthread_mutex_unlock(db_mutex);
-        return -1;
     }
-    
+
+    return bit;
+}
+
+static int execute_detections_write(sqlite3 *db, void *arg, uint64_t *row_id) {
+    detections_write_t *write = arg;
+    sqlite3_stmt *stmt;
+    (void)row_id;
+
     const char *sql = "INSERT INTO detections (stream_name, timestamp, label, confidence, x, y, width, height) "
                       "VALUES (?, ?, ?, ?, ?, ?, ?, ?);";
-    
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+
+    int rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
-        pthread_mutex_unlock(db_mutex);
         return -1;
     }
-    
+
     // Insert each detection
-    for (int i = 0; i < result->count; i++) {
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)timestamp);
-        sqlite3_bind_text(stmt, 3, result->detections[i].label, -1, SQLITE_STATIC);
-        sqlite3_bind_double(stmt, 4, result->detections[i].confidence);
-        sqlite3_bind_double(stmt, 5, result->detections[i].x);
-        sqlite3_bind_double(stmt, 6, result->detections[i].y);
-        sqlite3_bind_double(stmt, 7, result->detections[i].width);
-        sqlite3_bind_double(stmt, 8, result->detections[i].height);
-        
-        // Execute statement
+    for (int i = 0; i < write->count; i++) {
+        sqlite3_bind_text(stmt, 1, write->stream_name, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)write->timestamp);
+        sqlite3_bind_text(stmt, 3, write->detections[i].label, -1, SQLITE_STATIC);
+        sqlite3_bind_double(stmt, 4, write->detections[i].confidence);
+        sqlite3_bind_double(stmt, 5, write->detections[i].x);
+        sqlite3_bind_double(stmt, 6, write->detections[i].y);
+        sqlite3_bind_double(stmt, 7, write->detections[i].width);
+        sqlite3_bind_double(stmt, 8, write->detections[i].height);
+
         rc = sqlite3_step(stmt);
         if (rc != SQLITE_DONE) {
-            log_error("Failed to insert detection %d: %s", i, sqlite3_errmsg(db));
-            sqlite3_finalize(stmt);
-            sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
-            pthread_mutex_unlock(db_mutex);
+            log_error("Failed to insert detection %d for stream %s: %s", i, write->stream_name,
+                     sqlite3_errmsg(db));
+            db_release_statement(stmt);
             return -1;
         }
-        
-        // Reset statement and clear bindings for next detection
+
+        // Reset statement for next detection
         sqlite3_reset(stmt);
-        sqlite3_clear_bindings(stmt);
     }
-    
-    // Untrack and finalize the prepared statement
-    sqlite3_finalize(stmt);
-    
-    // Commit transaction
-    rc = sqlite3_exec(db, "COMMIT;", NULL, NULL, &err_msg);
-    if (rc != SQLITE_OK) {
-        log_error("Failed to commit transaction: %s", err_msg);
-        sqlite3_free(err_msg);
-        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
-        pthread_mutex_unlock(db_mutex);
+
+    db_release_statement(stmt);
+
+    // Keep the summary of the recordings covering these detections current
+    uint64_t labels = 0;
+    float max_confidence = 0.0f;
+    for (int i = 0; i < write->count; i++) {
+        int bit = get_label_bit(db, write->detections[i].label);
+        if (bit >= 0 && bit <= RECORDING_DETECTION_MAX_BIT) {
+            labels |= 1ULL << bit;
+        }
+        if (write->detections[i].confidence > max_confidence) {
+            max_confidence = write->detections[i].confidence;
+        }
+    }
+
+    if (link_recording_detections(db, write->stream_name, write->timestamp, write->count,
+                                  labels, max_confidence) != 0) {
         return -1;
     }
-    
-    // Verify the detections were stored
-    char verify_sql[256];
-    snprintf(verify_sql, sizeof(verify_sql), 
-            "SELECT COUNT(*) FROM detections WHERE stream_name = '%s' AND timestamp = %lld;",
-            stream_name, (long long)timestamp);
-    
-    rc = sqlite3_get_table(db, verify_sql, &query_result, &rows, &cols, &err_msg);
-    if (rc != SQLITE_OK) {
-        log_error("Failed to verify detections were stored: %s", err_msg);
-        sqlite3_free(err_msg);
-    } else if (rows > 0 && cols > 0) {
-        int count = atoi(query_result[1]); // First row, first column
-        log_info("Verified %d detections were stored in database for stream %s", count, stream_name);
-        sqlite3_free_table(query_result);
+
+    return timeline_rollup_add_detections(db, write->stream_name, write->timestamp,
+                                          write->detections, write->count);
+}
+
+static const db_write_ops_t detections_write_ops = {
+    .execute = execute_detections_write,
+    .committed = NULL,
+    .free_arg = free,
+};
+
+/**
+ * Store detection results in the database without waiting for the commit
+ *
+ * @param stream_name Stream name
+ * @param result Detection results
+ * @param timestamp Timestamp of the detection (0 for current time)
+ * @param future Pointer to store the completion future, NULL to not wait
+ * @return 0 if the detections were queued, non-zero on failure
+ */
+int store_detections_in_db_async(const char *stream_name, const detection_result_t *result, time_t timestamp,
+                                 db_write_future_t **future) {
+    if (future) {
+        *future = NULL;
     }
-    
-    pthread_mutex_unlock(db_mutex);
-    
-    log_info("Successfully stored %d detections in database for stream %s", result->count, stream_name);
+
+    if (!stream_name || !result) {
+        log_error("Invalid parameters for store_detections_in_db: stream_name=%p, result=%p",
+                 stream_name, result);
+        return -1;
+    }
+
+    if (!get_db_handle()) {
+        log_error("Database not initialized when trying to store detections");
+        return -1;
+    }
+
+    detections_write_t *write = malloc(sizeof(detections_write_t));
+    if (!write) {
+        log_error("Failed to allocate memory for detections");
+        return -1;
+    }
+
+    strncpy(write->stream_name, stream_name, sizeof(write->stream_name) - 1);
+    write->stream_name[sizeof(write->stream_name) - 1] = '\0';
+    // Use current time if timestamp is 0
+    write->timestamp = timestamp != 0 ? timestamp : time(NULL);
+    write->count = result->count < MAX_DETECTIONS ? result->count : MAX_DETECTIONS;
+    if (write->count < 0) {
+        write->count = 0;
+    }
+    memcpy(write->detections, result->detections, write->count * sizeof(detection_t));
+
+    log_debug("Queueing %d detections for stream %s", write->count, stream_name);
+
+    return db_writer_submit(&detections_write_ops, write, future);
+}
+
+/**
+ * Store detection results in the database
+ * 
+ * @param stream_name Stream name
+ * @param result Detection results
+ * @param timestamp Timestamp of the detection (0 for current time)
+ * @return 0 on success, non-zero on failure
+ */
+int store_detections_in_db(const char *stream_name, const detection_result_t *result, time_t timestamp) {
+    db_write_future_t *future;
+
+    if (store_detections_in_db_async(stream_name, result, timestamp, &future) != 0) {
+        return -1;
+    }
+
+    if (db_write_future_wait(future, NULL) != 0) {
+        log_error("Failed to store detections in database for stream %s", stream_name);
+        return -1;
+    }
+
+    log_debug("Stored %d detections in database for stream %s", result->count, stream_name);
     return 0;
 }
 
@@ -216,7 +216,6 @@ int get_detections_from_db_time_range(const char *stream_name, detection_result_
     sqlite3_stmt *stmt;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -231,7 +230,11 @@ int get_detections_from_db_time_range(const char *stream_name, detection_result_
     // Initialize result
     memset(result, 0, sizeof(detection_result_t));
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
     
     // Build query based on filters
     char sql[512];
@@ -248,10 +251,10 @@ int get_detections_from_db_time_range(const char *stream_name, detection_result_
                 "ORDER BY timestamp DESC "
                 "LIMIT ?;");
         
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        rc = db_prepare_cached(db, sql, &stmt);
         if (rc != SQLITE_OK) {
             log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             return -1;
         }
         
@@ -272,10 +275,10 @@ int get_detections_from_db_time_range(const char *stream_name, detection_result_
                 "ORDER BY timestamp DESC "
                 "LIMIT ?;");
         
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        rc = db_prepare_cached(db, sql, &stmt);
         if (rc != SQLITE_OK) {
             log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             return -1;
         }
         
@@ -295,10 +298,10 @@ int get_detections_from_db_time_range(const char *stream_name, detection_result_
                 "ORDER BY timestamp DESC "
                 "LIMIT ?;");
         
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        rc = db_prepare_cached(db, sql, &stmt);
         if (rc != SQLITE_OK) {
             log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             return -1;
         }
         
@@ -320,10 +323,10 @@ int get_detections_from_db_time_range(const char *stream_name, detection_result_
                 "FROM detections "
                 "WHERE stream_name = ? AND timestamp >= ?;");
         
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        rc = db_prepare_cached(db, sql, &stmt);
         if (rc != SQLITE_OK) {
             log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             return -1;
         }
         
@@ -337,11 +340,11 @@ int get_detections_from_db_time_range(const char *stream_name, detection_result_
             latest_timestamp = (time_t)sqlite3_column_int64(stmt, 0);
         }
 
-        sqlite3_finalize(stmt);
+        db_release_statement(stmt);
         
         // If no timestamp found, return empty result
         if (latest_timestamp == 0) {
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             log_info("No recent detections found for stream %s", stream_name);
             return 0;
         }
@@ -353,10 +356,10 @@ int get_detections_from_db_time_range(const char *stream_name, detection_result_
                 "WHERE stream_name = ? AND timestamp = ? "
                 "LIMIT ?;");
         
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        rc = db_prepare_cached(db, sql, &stmt);
         if (rc != SQLITE_OK) {
             log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             return -1;
         }
         
@@ -375,10 +378,10 @@ int get_detections_from_db_time_range(const char *stream_name, detection_result_
                 "ORDER BY timestamp DESC "
                 "LIMIT ?;");
         
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        rc = db_prepare_cached(db, sql, &stmt);
         if (rc != SQLITE_OK) {
             log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             return -1;
         }
         
@@ -417,8 +420,8 @@ int get_detections_from_db_time_range(const char *stream_name, detection_result_
     
     result->count = count;
 
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_release_statement(stmt);
+    db_release_reader(db);
     
     log_info("Found %d detections in database for stream %s", count, stream_name);
     return count;
@@ -441,7 +444,6 @@ int get_detection_timestamps(const char *stream_name, detection_result_t *result
     sqlite3_stmt *stmt;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -453,7 +455,11 @@ int get_detection_timestamps(const char *stream_name, detection_result_t *result
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
     
     // Build query based on filters
     char sql[512];
@@ -467,10 +473,10 @@ int get_detection_timestamps(const char *stream_name, detection_result_t *result
                 "ORDER BY timestamp DESC "
                 "LIMIT ?;");
         
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        rc = db_prepare_cached(db, sql, &stmt);
         if (rc != SQLITE_OK) {
             log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             return -1;
         }
 
@@ -488,10 +494,10 @@ int get_detection_timestamps(const char *stream_name, detection_result_t *result
                 "ORDER BY timestamp DESC "
                 "LIMIT ?;");
         
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        rc = db_prepare_cached(db, sql, &stmt);
         if (rc != SQLITE_OK) {
             log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             return -1;
         }
         
@@ -508,10 +514,10 @@ int get_detection_timestamps(const char *stream_name, detection_result_t *result
                 "ORDER BY timestamp DESC "
                 "LIMIT ?;");
         
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        rc = db_prepare_cached(db, sql, &stmt);
         if (rc != SQLITE_OK) {
             log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             return -1;
         }
         
@@ -532,10 +538,10 @@ int get_detection_timestamps(const char *stream_name, detection_result_t *result
                 "ORDER BY timestamp DESC "
                 "LIMIT ?;");
         
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        rc = db_prepare_cached(db, sql, &stmt);
         if (rc != SQLITE_OK) {
             log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             return -1;
         }
         
@@ -552,10 +558,10 @@ int get_detection_timestamps(const char *stream_name, detection_result_t *result
                 "ORDER BY timestamp DESC "
                 "LIMIT ?;");
         
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        rc = db_prepare_cached(db, sql, &stmt);
         if (rc != SQLITE_OK) {
             log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             return -1;
         }
         
@@ -595,8 +601,8 @@ int get_detection_timestamps(const char *stream_name, detection_result_t *result
         count++;
     }
     
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_release_statement(stmt);
+    db_release_reader(db);
     
     return 0;
 }
@@ -637,7 +643,7 @@ int delete_old_detections(uint64_t max_age) {
     
     const char *sql = "DELETE FROM detections WHERE timestamp < ?;";
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
         pthread_mutex_unlock(db_mutex);
@@ -654,15 +660,15 @@ int delete_old_detections(uint64_t max_age) {
     rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
         log_error("Failed to delete old detections: %s", sqlite3_errmsg(db));
-        sqlite3_finalize(stmt);
+        db_release_statement(stmt);
         pthread_mutex_unlock(db_mutex);
         return -1;
     }
     
     deleted_count = sqlite3_changes(db);
     
-    // finalize the prepared statement
-    sqlite3_finalize(stmt);
+    // Return the prepared statement to the cache
+    db_release_statement(stmt);
     pthread_mutex_unlock(db_mutex);
     
     log_info("Deleted %d old detections from database", deleted_count);
@@ -11,71 +11,117 @@
 
 #include "database/db_events.h"
 #include "database/db_core.h"
+#include "database/db_pool.h"
+#include "database/db_writer.h"
 #include "core/logger.h"
 
-// Add an event to the database
-uint64_t add_event(event_type_t type, const char *stream_name, 
-                  const char *description, const char *details) {
-    int rc;
+// Event queued for the database writer
+typedef struct {
+    event_type_t type;
+    time_t timestamp;
+    char *stream_name;
+    char *description;
+    char *details;
+} event_write_t;
+
+static void free_event_write(void *arg) {
+    event_write_t *write = arg;
+    free(write->stream_name);
+    free(write->description);
+    free(write->details);
+    free(write);
+}
+
+static int execute_event_write(sqlite3 *db, void *arg, uint64_t *row_id) {
+    event_write_t *write = arg;
     sqlite3_stmt *stmt;
-    uint64_t event_id = 0;
-    
-    sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
-    
-    if (!db) {
-        log_error("Database not initialized");
-        return 0;
-    }
-    
-    if (!description) {
-        log_error("Event description is required");
-        return 0;
-    }
-    
-    pthread_mutex_lock(db_mutex);
-    
+    int result = -1;
+
     const char *sql = "INSERT INTO events (type, timestamp, stream_name, description, details) "
                       "VALUES (?, ?, ?, ?, ?);";
-    
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+
+    int rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
-        return 0;
+        return -1;
     }
-    
+
     // Bind parameters
-    sqlite3_bind_int(stmt, 1, (int)type);
-    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)time(NULL));
-    
-    if (stream_name) {
-        sqlite3_bind_text(stmt, 3, stream_name, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 1, (int)write->type);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)write->timestamp);
+
+    if (write->stream_name) {
+        sqlite3_bind_text(stmt, 3, write->stream_name, -1, SQLITE_STATIC);
     } else {
         sqlite3_bind_null(stmt, 3);
     }
-    
-    sqlite3_bind_text(stmt, 4, description, -1, SQLITE_STATIC);
-    
-    if (details) {
-        sqlite3_bind_text(stmt, 5, details, -1, SQLITE_STATIC);
+
+    sqlite3_bind_text(stmt, 4, write->description, -1, SQLITE_STATIC);
+
+    if (write->details) {
+        sqlite3_bind_text(stmt, 5, write->details, -1, SQLITE_STATIC);
     } else {
         sqlite3_bind_null(stmt, 5);
     }
-    
+
     // Execute statement
     rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
         log_error("Failed to add event: %s", sqlite3_errmsg(db));
     } else {
-        event_id = (uint64_t)sqlite3_last_insert_rowid(db);
-        log_debug("Added event with ID %llu", (unsigned long long)event_id);
+        *row_id = (uint64_t)sqlite3_last_insert_rowid(db);
+        result = 0;
     }
+
+    db_release_statement(stmt);
+    return result;
+}
+
+static const db_write_ops_t event_write_ops = {
+    .execute = execute_event_write,
+    .committed = NULL,
+    .free_arg = free_event_write,
+};
+
+// Add an event to the database
+uint64_t add_event(event_type_t type, const char *stream_name, 
+                  const char *description, const char *details) {
+    uint64_t event_id = 0;
+    db_write_future_t *future;
     
-    // finalize the prepared statement
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    if (!get_db_handle()) {
+        log_error("Database not initialized");
+        return 0;
+    }
     
+    if (!description) {
+        log_error("Event description is required");
+        return 0;
+    }
+    
+    event_write_t *write = calloc(1, sizeof(event_write_t));
+    if (!write) {
+        log_error("Failed to allocate memory for event");
+        return 0;
+    }
+    
+    write->type = type;
+    write->timestamp = time(NULL);
+    write->stream_name = stream_name ? strdup(stream_name) : NULL;
+    write->description = strdup(description);
+    write->details = details ? strdup(details) : NULL;
+    if (!write->description || (stream_name && !write->stream_name) || (details && !write->details)) {
+        log_error("Failed to allocate memory for event");
+        free_event_write(write);
+        return 0;
+    }
+    
+    if (db_writer_submit(&event_write_ops, write, &future) != 0 ||
+        db_write_future_wait(future, &event_id) != 0) {
+        return 0;
+    }
+    
+    log_debug("Added event with ID %llu", (unsigned long long)event_id);
     return event_id;
 }
 
@@ -87,7 +133,6 @@ int get_events(time_t start_time, time_t end_time, int type,
     int count = 0;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -99,7 +144,11 @@ int get_events(time_t start_time, time_t end_time, int type,
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
     
     // Build query based on filters
     char sql[1024];
@@ -123,10 +172,10 @@ int get_events(time_t start_time, time_t end_time, int type,
     
     strcat(sql, " ORDER BY timestamp DESC LIMIT ?;");
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
@@ -184,9 +233,9 @@ int get_events(time_t start_time, time_t end_time, int type,
         count++;
     }
     
-    // finalize the prepared statement
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    // Return the prepared statement to the cache
+    db_release_statement(stmt);
+    db_release_reader(db);
     
     log_info("Found %d events in database matching criteria", count);
     return count;
@@ -210,7 +259,7 @@ int delete_old_events(uint64_t max_age) {
     
     const char *sql = "DELETE FROM events WHERE timestamp < ?;";
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
         pthread_mutex_unlock(db_mutex);
@@ -227,15 +276,15 @@ int delete_old_events(uint64_t max_age) {
     rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
         log_error("Failed to delete old events: %s", sqlite3_errmsg(db));
-        sqlite3_finalize(stmt);
+        db_release_statement(stmt);
         pthread_mutex_unlock(db_mutex);
         return -1;
     }
     
     deleted_count = sqlite3_changes(db);
     
-    // finalize the prepared statement
-    sqlite3_finalize(stmt);
+    // Return the prepared statement to the cache
+    db_release_statement(stmt);
     pthread_mutex_unlock(db_mutex);
     
     return deleted_count;
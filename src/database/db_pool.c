@@ -0,0 +1,324 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sqlite3.h>
+
+#include "database/db_pool.h"
+#include "database/db_core.h"
+#include "core/logger.h"
+#include "core/metrics.h"
+
+#define DB_POOL_MAX_READERS 16
+#define DB_STMT_CACHE_SIZE 32       // Statements kept per connection
+#define DB_POOL_SHUTDOWN_WAIT 10    // Seconds shutdown waits for borrowed readers
+
+typedef struct {
+    uint64_t hash;
+    char *sql;                      // NULL when the entry is free
+    sqlite3_stmt *stmt;
+    bool in_use;
+    uint64_t last_used;
+    uint64_t acquired_us;           // When the statement was handed out, for the latency metric
+} cached_stmt_t;
+
+typedef struct {
+    sqlite3 *conn;
+    bool borrowed;                  // Readers only, the writer is guarded by the db mutex
+    uint64_t clock;
+    cached_stmt_t stmts[DB_STMT_CACHE_SIZE];
+} pool_conn_t;
+
+// Slot 0 is the writer, slots 1..reader_count are the readers
+static pool_conn_t conns[DB_POOL_MAX_READERS + 1];
+static int reader_count = 0;
+static int configured_reader_count = 4;
+static bool pool_ready = false;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+
+// Time from preparing a cached statement to releasing it, by connection
+static metrics_histogram_t writer_statement_time;
+static metrics_histogram_t reader_statement_time;
+
+static uint64_t hash_sql(const char *sql) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *)sql; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Find the pool entry of a connection
+ * Slots only change in db_pool_init() and db_pool_shutdown(), when no
+ * connection is in use
+ */
+static pool_conn_t *find_conn(sqlite3 *conn) {
+    if (!conn) {
+        return NULL;
+    }
+    for (int i = 0; i <= reader_count; i++) {
+        if (conns[i].conn == conn) {
+            return &conns[i];
+        }
+    }
+    return NULL;
+}
+
+static void clear_cache(pool_conn_t *pc) {
+    for (int i = 0; i < DB_STMT_CACHE_SIZE; i++) {
+        cached_stmt_t *e = &pc->stmts[i];
+        if (e->sql) {
+            sqlite3_finalize(e->stmt);
+            free(e->sql);
+        }
+        memset(e, 0, sizeof(*e));
+    }
+    pc->clock = 0;
+}
+
+void db_pool_set_reader_count(int count) {
+    if (count < 0) {
+        count = 0;
+    } else if (count > DB_POOL_MAX_READERS) {
+        count = DB_POOL_MAX_READERS;
+    }
+    configured_reader_count = count;
+}
+
+int db_pool_init(const char *db_path, sqlite3 *writer) {
+    if (!db_path || !writer) {
+        return -1;
+    }
+
+    char labels[64] = "";
+    metrics_label(labels, sizeof(labels), "connection", "writer");
+    writer_statement_time = metrics_histogram("lightnvr_db_statement_seconds",
+                                              "Time from preparing a statement to releasing it", labels);
+    labels[0] = '\0';
+    metrics_label(labels, sizeof(labels), "connection", "reader");
+    reader_statement_time = metrics_histogram("lightnvr_db_statement_seconds",
+                                              "Time from preparing a statement to releasing it", labels);
+
+    pthread_mutex_lock(&pool_mutex);
+
+    memset(conns, 0, sizeof(conns));
+    conns[0].conn = writer;
+    reader_count = 0;
+
+    for (int i = 1; i <= configured_reader_count; i++) {
+        sqlite3 *reader = NULL;
+        // Private cache: a shared cache would put the readers behind the writer's table locks
+        int rc = sqlite3_open_v2(db_path, &reader,
+                                 SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_PRIVATECACHE,
+                                 NULL);
+        if (rc != SQLITE_OK) {
+            log_warn("Failed to open database reader connection %d: %s", i,
+                     reader ? sqlite3_errmsg(reader) : "unknown error");
+            if (reader) {
+                sqlite3_close_v2(reader);
+            }
+            break;
+        }
+
+        sqlite3_busy_timeout(reader, 10000);
+        sqlite3_exec(reader, "PRAGMA query_only = ON;", NULL, NULL, NULL);
+
+        conns[i].conn = reader;
+        reader_count = i;
+    }
+
+    pool_ready = true;
+    pthread_mutex_unlock(&pool_mutex);
+
+    if (reader_count > 0) {
+        log_info("Opened %d database reader connections", reader_count);
+    } else {
+        log_info("Database reader pool disabled, reads use the writer connection");
+    }
+    return 0;
+}
+
+void db_pool_shutdown(void) {
+    pthread_mutex_lock(&pool_mutex);
+
+    if (!pool_ready) {
+        pthread_mutex_unlock(&pool_mutex);
+        return;
+    }
+    // New borrowers fall back to the writer path, which fails once the database is closed
+    pool_ready = false;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += DB_POOL_SHUTDOWN_WAIT;
+
+    for (int i = 1; i <= reader_count; i++) {
+        while (conns[i].borrowed) {
+            if (pthread_cond_timedwait(&pool_cond, &pool_mutex, &deadline) == ETIMEDOUT) {
+                log_warn("Database reader connection %d still in use at shutdown", i);
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i <= reader_count; i++) {
+        clear_cache(&conns[i]);
+        if (i > 0 && conns[i].conn) {
+            sqlite3_close_v2(conns[i].conn);
+        }
+        conns[i].conn = NULL;
+        conns[i].borrowed = false;
+    }
+    reader_count = 0;
+
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+sqlite3 *db_acquire_reader(void) {
+    pthread_mutex_lock(&pool_mutex);
+
+    if (pool_ready && reader_count > 0) {
+        for (;;) {
+            for (int i = 1; i <= reader_count; i++) {
+                if (!conns[i].borrowed) {
+                    conns[i].borrowed = true;
+                    pthread_mutex_unlock(&pool_mutex);
+                    return conns[i].conn;
+                }
+            }
+            pthread_cond_wait(&pool_cond, &pool_mutex);
+            if (!pool_ready) {
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&pool_mutex);
+
+    // No reader pool: behave like the writer-only code path
+    sqlite3 *db = get_db_handle();
+    if (!db) {
+        return NULL;
+    }
+    pthread_mutex_lock(get_db_mutex());
+    return db;
+}
+
+void db_release_reader(sqlite3 *conn) {
+    if (!conn) {
+        return;
+    }
+
+    if (conn == get_db_handle()) {
+        pthread_mutex_unlock(get_db_mutex());
+        return;
+    }
+
+    pthread_mutex_lock(&pool_mutex);
+    for (int i = 1; i <= reader_count; i++) {
+        if (conns[i].conn == conn) {
+            conns[i].borrowed = false;
+            break;
+        }
+    }
+    pthread_cond_broadcast(&pool_cond);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+int db_prepare_cached(sqlite3 *conn, const char *sql, sqlite3_stmt **stmt) {
+    if (!conn || !sql || !stmt) {
+        return SQLITE_MISUSE;
+    }
+    *stmt = NULL;
+
+    pool_conn_t *pc = find_conn(conn);
+    if (!pc) {
+        // Connection without a cache, e.g. used before db_pool_init()
+        return sqlite3_prepare_v2(conn, sql, -1, stmt, NULL);
+    }
+
+    uint64_t hash = hash_sql(sql);
+    cached_stmt_t *free_entry = NULL;
+    cached_stmt_t *lru_entry = NULL;
+
+    for (int i = 0; i < DB_STMT_CACHE_SIZE; i++) {
+        cached_stmt_t *e = &pc->stmts[i];
+        if (!e->sql) {
+            if (!free_entry) {
+                free_entry = e;
+            }
+            continue;
+        }
+        if (e->in_use) {
+            continue;
+        }
+        if (e->hash == hash && strcmp(e->sql, sql) == 0) {
+            e->in_use = true;
+            e->last_used = ++pc->clock;
+            e->acquired_us = metrics_now_us();
+            *stmt = e->stmt;
+            return SQLITE_OK;
+        }
+        if (!lru_entry || e->last_used < lru_entry->last_used) {
+            lru_entry = e;
+        }
+    }
+
+    cached_stmt_t *victim = free_entry ? free_entry : lru_entry;
+    int rc = sqlite3_prepare_v3(conn, sql, -1, SQLITE_PREPARE_PERSISTENT, stmt, NULL);
+    if (rc != SQLITE_OK || !victim) {
+        // Not cached when every entry is in use, db_release_statement() finalizes it
+        return rc;
+    }
+
+    char *sql_copy = strdup(sql);
+    if (!sql_copy) {
+        return SQLITE_OK;
+    }
+
+    if (victim->sql) {
+        sqlite3_finalize(victim->stmt);
+        free(victim->sql);
+    }
+    victim->hash = hash;
+    victim->sql = sql_copy;
+    victim->stmt = *stmt;
+    victim->in_use = true;
+    victim->last_used = ++pc->clock;
+    victim->acquired_us = metrics_now_us();
+    return SQLITE_OK;
+}
+
+void db_release_statement(sqlite3_stmt *stmt) {
+    if (!stmt) {
+        return;
+    }
+
+    pool_conn_t *pc = find_conn(sqlite3_db_handle(stmt));
+    if (pc) {
+        for (int i = 0; i < DB_STMT_CACHE_SIZE; i++) {
+            if (pc->stmts[i].stmt == stmt && pc->stmts[i].sql) {
+                sqlite3_reset(stmt);
+                sqlite3_clear_bindings(stmt);
+                pc->stmts[i].in_use = false;
+                metrics_histogram_observe(pc == &conns[0] ? writer_statement_time : reader_statement_time,
+                                          metrics_now_us() - pc->stmts[i].acquired_us);
+                return;
+            }
+        }
+    }
+
+    sqlite3_finalize(stmt);
+}
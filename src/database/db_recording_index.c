@@ -0,0 +1,321 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sqlite3.h>
+
+#include "database/db_recording_index.h"
+#include "database/db_core.h"
+#include "core/logger.h"
+
+typedef struct {
+    uint64_t id;
+    time_t start_time;
+    time_t end_time;        // 0 while the recording is in progress
+    char *file_path;
+} index_entry_t;
+
+typedef struct {
+    char stream_name[64];
+    index_entry_t *entries; // Sorted by start_time, then id
+    int count;
+    int capacity;
+} index_stream_t;
+
+static index_stream_t *streams = NULL;
+static int stream_count = 0;
+static int stream_capacity = 0;
+static pthread_rwlock_t index_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/**
+ * Find a loaded stream
+ * Must be called with index_lock held
+ */
+static index_stream_t *find_stream(const char *stream_name) {
+    for (int i = 0; i < stream_count; i++) {
+        if (strcmp(streams[i].stream_name, stream_name) == 0) {
+            return &streams[i];
+        }
+    }
+    return NULL;
+}
+
+static void free_stream_entries(index_stream_t *stream) {
+    for (int i = 0; i < stream->count; i++) {
+        free(stream->entries[i].file_path);
+    }
+    free(stream->entries);
+    stream->entries = NULL;
+    stream->count = 0;
+    stream->capacity = 0;
+}
+
+/**
+ * Index of the first entry ordered after (start_time, id)
+ */
+static int upper_bound(const index_stream_t *stream, time_t start_time, uint64_t id) {
+    int lo = 0, hi = stream->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        const index_entry_t *e = &stream->entries[mid];
+        if (e->start_time < start_time || (e->start_time == start_time && e->id <= id)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Insert an entry keeping the order, replacing an entry with the same ID
+ * Must be called with index_lock held for writing
+ */
+static int insert_entry(index_stream_t *stream, uint64_t id, time_t start_time,
+                        time_t end_time, const char *file_path) {
+    // Recordings are almost always appended, so look for a duplicate from the end
+    for (int i = stream->count - 1; i >= 0; i--) {
+        if (stream->entries[i].id == id) {
+            stream->entries[i].end_time = end_time;
+            return 0;
+        }
+    }
+
+    if (stream->count == stream->capacity) {
+        int new_capacity = stream->capacity ? stream->capacity * 2 : 64;
+        index_entry_t *entries = realloc(stream->entries, new_capacity * sizeof(index_entry_t));
+        if (!entries) {
+            return -1;
+        }
+        stream->entries = entries;
+        stream->capacity = new_capacity;
+    }
+
+    char *path_copy = strdup(file_path ? file_path : "");
+    if (!path_copy) {
+        return -1;
+    }
+
+    int pos = upper_bound(stream, start_time, id);
+    memmove(&stream->entries[pos + 1], &stream->entries[pos],
+            (stream->count - pos) * sizeof(index_entry_t));
+    stream->entries[pos].id = id;
+    stream->entries[pos].start_time = start_time;
+    stream->entries[pos].end_time = end_time;
+    stream->entries[pos].file_path = path_copy;
+    stream->count++;
+
+    return 0;
+}
+
+/**
+ * Load the recordings of a stream from the database
+ * Must be called with index_lock held for writing
+ */
+static index_stream_t *load_stream(const char *stream_name) {
+    sqlite3 *db = get_db_handle();
+    pthread_mutex_t *db_mutex = get_db_mutex();
+    sqlite3_stmt *stmt;
+
+    if (!db) {
+        log_error("Database not initialized");
+        return NULL;
+    }
+
+    if (stream_count == stream_capacity) {
+        int new_capacity = stream_capacity ? stream_capacity * 2 : 16;
+        index_stream_t *new_streams = realloc(streams, new_capacity * sizeof(index_stream_t));
+        if (!new_streams) {
+            log_error("Failed to allocate recording index");
+            return NULL;
+        }
+        streams = new_streams;
+        stream_capacity = new_capacity;
+    }
+
+    index_stream_t *stream = &streams[stream_count];
+    memset(stream, 0, sizeof(*stream));
+    strncpy(stream->stream_name, stream_name, sizeof(stream->stream_name) - 1);
+
+    pthread_mutex_lock(db_mutex);
+
+    const char *sql = "SELECT id, file_path, start_time, end_time FROM recordings "
+                      "WHERE stream_name = ? ORDER BY start_time, id;";
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        pthread_mutex_unlock(db_mutex);
+        return NULL;
+    }
+
+    sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *file_path = (const char *)sqlite3_column_text(stmt, 1);
+        time_t end_time = sqlite3_column_type(stmt, 3) == SQLITE_NULL ?
+                          0 : (time_t)sqlite3_column_int64(stmt, 3);
+
+        if (insert_entry(stream, (uint64_t)sqlite3_column_int64(stmt, 0),
+                         (time_t)sqlite3_column_int64(stmt, 2), end_time, file_path) != 0) {
+            log_error("Failed to allocate recording index for stream %s", stream_name);
+            sqlite3_finalize(stmt);
+            pthread_mutex_unlock(db_mutex);
+            free_stream_entries(stream);
+            return NULL;
+        }
+    }
+
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(db_mutex);
+
+    stream_count++;
+    log_debug("Loaded %d recordings into the index for stream %s", stream->count, stream_name);
+    return stream;
+}
+
+/**
+ * Look up a timestamp in a loaded stream
+ * Must be called with index_lock held
+ */
+static const index_entry_t *lookup(const index_stream_t *stream, time_t timestamp) {
+    // Last entry starting at or before the timestamp
+    int pos = upper_bound(stream, timestamp, UINT64_MAX) - 1;
+
+    if (pos >= 0) {
+        const index_entry_t *e = &stream->entries[pos];
+        if (e->end_time == 0 || e->end_time >= timestamp) {
+            return e;
+        }
+    }
+
+    if (pos + 1 < stream->count) {
+        const index_entry_t *e = &stream->entries[pos + 1];
+        if (e->start_time - timestamp <= RECORDING_INDEX_MATCH_WINDOW) {
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+int recording_index_find(const char *stream_name, time_t timestamp, char *path, size_t path_size) {
+    if (!stream_name || !path || path_size == 0) {
+        log_error("Invalid parameters for recording_index_find");
+        return -1;
+    }
+
+    int result = 0;
+
+    pthread_rwlock_rdlock(&index_lock);
+    index_stream_t *stream = find_stream(stream_name);
+    if (!stream) {
+        // Upgrade to a write lock to load the stream; recheck since another thread may have won
+        pthread_rwlock_unlock(&index_lock);
+        pthread_rwlock_wrlock(&index_lock);
+        stream = find_stream(stream_name);
+        if (!stream) {
+            stream = load_stream(stream_name);
+        }
+        if (!stream) {
+            pthread_rwlock_unlock(&index_lock);
+            return -1;
+        }
+    }
+
+    const index_entry_t *e = lookup(stream, timestamp);
+    if (e) {
+        strncpy(path, e->file_path, path_size - 1);
+        path[path_size - 1] = '\0';
+        result = 1;
+    }
+    pthread_rwlock_unlock(&index_lock);
+
+    return result;
+}
+
+void recording_index_add(uint64_t id, const recording_metadata_t *metadata) {
+    if (id == 0 || !metadata) {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&index_lock);
+    // Streams that have not been looked up yet pick the recording up when loaded
+    index_stream_t *stream = find_stream(metadata->stream_name);
+    if (stream && insert_entry(stream, id, metadata->start_time, metadata->end_time,
+                               metadata->file_path) != 0) {
+        // Drop the stream rather than keep an index that misses a recording
+        log_warn("Failed to index recording %llu, reloading stream %s later",
+                 (unsigned long long)id, metadata->stream_name);
+        free_stream_entries(stream);
+        *stream = streams[--stream_count];
+    }
+    pthread_rwlock_unlock(&index_lock);
+}
+
+void recording_index_update(uint64_t id, time_t end_time) {
+    pthread_rwlock_wrlock(&index_lock);
+    for (int s = 0; s < stream_count; s++) {
+        // Updated recordings are usually the most recent ones
+        for (int i = streams[s].count - 1; i >= 0; i--) {
+            if (streams[s].entries[i].id == id) {
+                streams[s].entries[i].end_time = end_time;
+                pthread_rwlock_unlock(&index_lock);
+                return;
+            }
+        }
+    }
+    pthread_rwlock_unlock(&index_lock);
+}
+
+void recording_index_remove(const uint64_t *ids, int count) {
+    if (!ids || count <= 0) {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&index_lock);
+    for (int n = 0; n < count; n++) {
+        bool removed = false;
+        for (int s = 0; s < stream_count && !removed; s++) {
+            index_stream_t *stream = &streams[s];
+            // Deleted recordings are usually the oldest ones
+            for (int i = 0; i < stream->count; i++) {
+                if (stream->entries[i].id == ids[n]) {
+                    free(stream->entries[i].file_path);
+                    memmove(&stream->entries[i], &stream->entries[i + 1],
+                            (stream->count - i - 1) * sizeof(index_entry_t));
+                    stream->count--;
+                    removed = true;
+                    break;
+                }
+            }
+        }
+    }
+    pthread_rwlock_unlock(&index_lock);
+}
+
+void recording_index_invalidate(void) {
+    pthread_rwlock_wrlock(&index_lock);
+    for (int i = 0; i < stream_count; i++) {
+        free_stream_entries(&streams[i]);
+    }
+    stream_count = 0;
+    pthread_rwlock_unlock(&index_lock);
+}
+
+void recording_index_cleanup(void) {
+    pthread_rwlock_wrlock(&index_lock);
+    for (int i = 0; i < stream_count; i++) {
+        free_stream_entries(&streams[i]);
+    }
+    free(streams);
+    streams = NULL;
+    stream_count = 0;
+    stream_capacity = 0;
+    pthread_rwlock_unlock(&index_lock);
+}
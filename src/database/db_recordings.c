@@ -8,45 +8,89 @@
 #include <time.h>
 #include <sqlite3.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 #include "database/db_recordings.h"
+#include "database/db_recording_index.h"
 #include "database/db_core.h"
+#include "database/db_pool.h"
+#include "database/db_writer.h"
+#include "database/db_timeline_rollups.h"
 #include "core/logger.h"
 
-// Add recording metadata to the database
-uint64_t add_recording_metadata(const recording_metadata_t *metadata) {
-    int rc;
-    sqlite3_stmt *stmt;
-    uint64_t recording_id = 0;
-    
-    sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
-    
-    if (!db) {
-        log_error("Database not initialized");
-        return 0;
+// Bumped whenever recordings are added, finalized or deleted
+static atomic_ullong usage_generation = 0;
+
+// Per-stream counterpart of usage_generation. all_streams_generation is part of
+// every stream's value and changes when the affected streams are not known.
+typedef struct {
+    char stream_name[64];
+    uint64_t generation;
+} stream_generation_t;
+
+static stream_generation_t stream_generations[RECORDING_USAGE_MAX_STREAMS];
+static int stream_generation_count = 0;
+static uint64_t all_streams_generation = 0;
+static pthread_mutex_t stream_generations_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static stream_generation_t *find_stream_generation(const char *stream_name) {
+    for (int i = 0; i < stream_generation_count; i++) {
+        if (strcmp(stream_generations[i].stream_name, stream_name) == 0) {
+            return &stream_generations[i];
+        }
     }
-    
-    if (!metadata) {
-        log_error("Recording metadata is required");
-        return 0;
+    return NULL;
+}
+
+/**
+ * Record that the recordings of a stream changed after a commit
+ *
+ * @param stream_name Name of the stream, or NULL when any stream may have changed
+ */
+static void recordings_changed(const char *stream_name) {
+    pthread_mutex_lock(&stream_generations_mutex);
+    stream_generation_t *entry = stream_name ? find_stream_generation(stream_name) : NULL;
+    if (!entry && stream_name && stream_generation_count < RECORDING_USAGE_MAX_STREAMS) {
+        entry = &stream_generations[stream_generation_count++];
+        strncpy(entry->stream_name, stream_name, sizeof(entry->stream_name) - 1);
     }
-    
-    pthread_mutex_lock(db_mutex);
+    if (entry) {
+        entry->generation++;
+    } else {
+        all_streams_generation++;
+    }
+    pthread_mutex_unlock(&stream_generations_mutex);
+
+    atomic_fetch_add(&usage_generation, 1);
+}
+
+// Detection summary of a recording computed from the detections table. Bits
+// are at most RECORDING_DETECTION_MAX_BIT, so the sum of distinct bits is their OR.
+#define RECORDING_DETECTION_RANGE \
+    "WHERE d.stream_name = recordings.stream_name " \
+    "AND d.timestamp BETWEEN recordings.start_time AND recordings.end_time"
+#define RECORDING_DETECTION_SUMMARY \
+    "detection_count = (SELECT COUNT(*) FROM detections d " RECORDING_DETECTION_RANGE "), " \
+    "detection_labels = (SELECT COALESCE(SUM(DISTINCT 1 << l.bit), 0) FROM detections d " \
+    "JOIN detection_labels l ON l.label = d.label " RECORDING_DETECTION_RANGE "), " \
+    "max_confidence = (SELECT COALESCE(MAX(d.confidence), 0) FROM detections d " RECORDING_DETECTION_RANGE ")"
+
+static int execute_add_recording(sqlite3 *db, void *arg, uint64_t *row_id) {
+    const recording_metadata_t *metadata = arg;
+    sqlite3_stmt *stmt;
+    int result = -1;
     
     const char *sql = "INSERT INTO recordings (stream_name, file_path, start_time, end_time, "
                       "size_bytes, width, height, fps, codec, is_complete) "
                       "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    int rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
-        return 0;
+        return -1;
     }
     
-    // No longer tracking statements - each function is responsible for finalizing its own statements
-    
     // Bind parameters
     sqlite3_bind_text(stmt, 1, metadata->stream_name, -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 2, metadata->file_path, -1, SQLITE_STATIC);
@@ -70,67 +114,278 @@ uint64_t add_recording_metadata(const recording_metadata_t *metadata) {
     if (rc != SQLITE_DONE) {
         log_error("Failed to add recording metadata: %s", sqlite3_errmsg(db));
     } else {
-        recording_id = (uint64_t)sqlite3_last_insert_rowid(db);
-        log_debug("Added recording metadata with ID %llu", (unsigned long long)recording_id);
+        *row_id = (uint64_t)sqlite3_last_insert_rowid(db);
+        result = 0;
     }
     
-    // Finalize the prepared statement
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_release_statement(stmt);
+    return result;
+}
+
+static void add_recording_committed(void *arg, uint64_t row_id) {
+    const recording_metadata_t *metadata = arg;
+    recording_index_add(row_id, metadata);
+    recordings_changed(metadata->stream_name);
+}
+
+static const db_write_ops_t add_recording_ops = {
+    .execute = execute_add_recording,
+    .committed = add_recording_committed,
+    .free_arg = free,
+};
+
+// Add recording metadata without waiting for the commit
+int add_recording_metadata_async(const recording_metadata_t *metadata, db_write_future_t **future) {
+    if (future) {
+        *future = NULL;
+    }
     
-    return recording_id;
+    if (!get_db_handle()) {
+        log_error("Database not initialized");
+        return -1;
+    }
+    
+    if (!metadata) {
+        log_error("Recording metadata is required");
+        return -1;
+    }
+    
+    recording_metadata_t *copy = malloc(sizeof(recording_metadata_t));
+    if (!copy) {
+        log_error("Failed to allocate memory for recording metadata");
+        return -1;
+    }
+    memcpy(copy, metadata, sizeof(recording_metadata_t));
+    
+    return db_writer_submit(&add_recording_ops, copy, future);
 }
 
-// Update recording metadata in the database
-int update_recording_metadata(uint64_t id, time_t end_time, 
-                             uint64_t size_bytes, bool is_complete) {
-    int rc;
-    sqlite3_stmt *stmt;
+// Add recording metadata to the database
+uint64_t add_recording_metadata(const recording_metadata_t *metadata) {
+    uint64_t recording_id = 0;
+    db_write_future_t *future;
     
-    sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
+    if (add_recording_metadata_async(metadata, &future) != 0 ||
+        db_write_future_wait(future, &recording_id) != 0) {
+        return 0;
+    }
     
+    log_debug("Added recording metadata with ID %llu", (unsigned long long)recording_id);
+    return recording_id;
+}
+
+// Add stored detections to the summary of the recordings they fall in
+int link_recording_detections(sqlite3 *db, const char *stream_name, time_t timestamp,
+                              int count, uint64_t labels, float max_confidence) {
+    sqlite3_stmt *stmt;
+
+    if (!db || !stream_name || count <= 0) {
+        return 0;
+    }
+
+    // Continuous and detection-triggered recordings of a stream may overlap,
+    // so look at the few latest recordings started before the detections
+    const char *sql = "UPDATE recordings SET detection_count = detection_count + ?1, "
+                      "detection_labels = detection_labels | ?2, "
+                      "max_confidence = MAX(max_confidence, ?3) "
+                      "WHERE id IN (SELECT id FROM recordings WHERE stream_name = ?4 AND start_time <= ?5 "
+                      "ORDER BY start_time DESC LIMIT 4) "
+                      "AND (end_time IS NULL OR end_time >= ?5);";
+
+    int rc = db_prepare_cached(db, sql, &stmt);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sqlite3_bind_int(stmt, 1, count);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)labels);
+    sqlite3_bind_double(stmt, 3, max_confidence);
+    sqlite3_bind_text(stmt, 4, stream_name, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 5, (sqlite3_int64)timestamp);
+
+    rc = sqlite3_step(stmt);
+    db_release_statement(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to link detections to recordings of stream %s: %s", stream_name, sqlite3_errmsg(db));
+        return -1;
+    }
+
+    return 0;
+}
+
+// Recompute the detection summary of a complete recording from the detections table
+int refresh_recording_detections(sqlite3 *db, uint64_t id) {
+    sqlite3_stmt *stmt;
+
     if (!db) {
-        log_error("Database not initialized");
         return -1;
     }
+
+    const char *sql = id != 0
+        ? "UPDATE recordings SET " RECORDING_DETECTION_SUMMARY " WHERE id = ?1 AND end_time IS NOT NULL;"
+        : "UPDATE recordings SET " RECORDING_DETECTION_SUMMARY " WHERE end_time IS NOT NULL;";
+
+    int rc = db_prepare_cached(db, sql, &stmt);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    if (id != 0) {
+        sqlite3_bind_int64(stmt, 1, (sqlite3_int64)id);
+    }
+
+    rc = sqlite3_step(stmt);
+    db_release_statement(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to refresh detection summary of recording %llu: %s",
+                  (unsigned long long)id, sqlite3_errmsg(db));
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Add or remove the time range of a complete recording from the timeline rollups
+ *
+ * @param stream_name_out Receives the stream of the recording (64 bytes), left
+ *                        untouched if it is not complete; can be NULL
+ */
+static int apply_recording_coverage(sqlite3 *db, uint64_t id, int sign, char *stream_name_out) {
+    sqlite3_stmt *stmt;
+
+    const char *sql = "SELECT stream_name, start_time, end_time FROM recordings "
+                      "WHERE id = ? AND is_complete = 1 AND end_time IS NOT NULL;";
+
+    int rc = db_prepare_cached(db, sql, &stmt);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)id);
+
+    int result = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *stream_name = (const char *)sqlite3_column_text(stmt, 0);
+        result = timeline_rollup_add_coverage(db, stream_name ? stream_name : "",
+                                              (time_t)sqlite3_column_int64(stmt, 1),
+                                              (time_t)sqlite3_column_int64(stmt, 2), sign);
+        if (stream_name_out) {
+            snprintf(stream_name_out, 64, "%s", stream_name ? stream_name : "");
+        }
+    }
+
+    db_release_statement(stmt);
+    return result;
+}
+
+// Recording update queued for the database writer
+typedef struct {
+    uint64_t id;
+    time_t end_time;
+    uint64_t size_bytes;
+    bool is_complete;
+    char stream_name[64];       // Filled in by the writer once the recording is complete
+} recording_update_t;
+
+static int execute_update_recording(sqlite3 *db, void *arg, uint64_t *row_id) {
+    recording_update_t *update = arg;
+    sqlite3_stmt *stmt;
+    (void)row_id;
     
-    pthread_mutex_lock(db_mutex);
+    // A recording finalized again replaces its earlier time range in the rollups
+    if (apply_recording_coverage(db, update->id, -1, NULL) != 0) {
+        return -1;
+    }
     
     const char *sql = "UPDATE recordings SET end_time = ?, size_bytes = ?, is_complete = ? "
                       "WHERE id = ?;";
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    int rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
         return -1;
     }
     
-    // No longer tracking statements - each function is responsible for finalizing its own statements
-    
     // Bind parameters
-    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)end_time);
-    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)size_bytes);
-    sqlite3_bind_int(stmt, 3, is_complete ? 1 : 0);
-    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)id);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)update->end_time);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)update->size_bytes);
+    sqlite3_bind_int(stmt, 3, update->is_complete ? 1 : 0);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)update->id);
     
     // Execute statement
     rc = sqlite3_step(stmt);
+    db_release_statement(stmt);
     if (rc != SQLITE_DONE) {
         log_error("Failed to update recording metadata: %s", sqlite3_errmsg(db));
-        sqlite3_finalize(stmt);
-        pthread_mutex_unlock(db_mutex);
         return -1;
     }
     
-    // Finalize the prepared statement
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    // The recording now has its final time range
+    if (update->is_complete) {
+        refresh_recording_detections(db, update->id);
+        if (apply_recording_coverage(db, update->id, 1, update->stream_name) != 0) {
+            return -1;
+        }
+    }
     
     return 0;
 }
 
+static void update_recording_committed(void *arg, uint64_t row_id) {
+    const recording_update_t *update = arg;
+    (void)row_id;
+    recording_index_update(update->id, update->end_time);
+    if (update->is_complete) {
+        recordings_changed(update->stream_name[0] ? update->stream_name : NULL);
+    }
+}
+
+static const db_write_ops_t update_recording_ops = {
+    .execute = execute_update_recording,
+    .committed = update_recording_committed,
+    .free_arg = free,
+};
+
+// Update recording metadata without waiting for the commit
+int update_recording_metadata_async(uint64_t id, time_t end_time, uint64_t size_bytes,
+                                    bool is_complete, db_write_future_t **future) {
+    if (future) {
+        *future = NULL;
+    }
+    
+    if (!get_db_handle()) {
+        log_error("Database not initialized");
+        return -1;
+    }
+    
+    recording_update_t *update = calloc(1, sizeof(recording_update_t));
+    if (!update) {
+        log_error("Failed to allocate memory for recording update");
+        return -1;
+    }
+    update->id = id;
+    update->end_time = end_time;
+    update->size_bytes = size_bytes;
+    update->is_complete = is_complete;
+    
+    return db_writer_submit(&update_recording_ops, update, future);
+}
+
+// Update recording metadata in the database
+int update_recording_metadata(uint64_t id, time_t end_time, 
+                             uint64_t size_bytes, bool is_complete) {
+    db_write_future_t *future;
+    
+    if (update_recording_metadata_async(id, end_time, size_bytes, is_complete, &future) != 0) {
+        return -1;
+    }
+    
+    return db_write_future_wait(future, NULL) == 0 ? 0 : -1;
+}
+
 // Get recording metadata by ID
 int get_recording_metadata_by_id(uint64_t id, recording_metadata_t *metadata) {
     int rc;
@@ -138,7 +393,6 @@ int get_recording_metadata_by_id(uint64_t id, recording_metadata_t *metadata) {
     int result = -1;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -150,21 +404,24 @@ int get_recording_metadata_by_id(uint64_t id, recording_metadata_t *metadata) {
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
     
     const char *sql = "SELECT id, stream_name, file_path, start_time, end_time, "
-                      "size_bytes, width, height, fps, codec, is_complete "
+                      "size_bytes, width, height, fps, codec, is_complete, "
+                      "detection_count, detection_labels, max_confidence "
                       "FROM recordings WHERE id = ?;";
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
-    // No longer tracking statements - each function is responsible for finalizing its own statements
-    
     // Bind parameters
     sqlite3_bind_int64(stmt, 1, (sqlite3_int64)id);
     
@@ -210,13 +467,16 @@ int get_recording_metadata_by_id(uint64_t id, recording_metadata_t *metadata) {
         }
         
         metadata->is_complete = sqlite3_column_int(stmt, 10) != 0;
+        metadata->detection_count = sqlite3_column_int(stmt, 11);
+        metadata->detection_labels = (uint64_t)sqlite3_column_int64(stmt, 12);
+        metadata->max_confidence = (float)sqlite3_column_double(stmt, 13);
         
         result = 0; // Success
     }
     
-    // Finalize the prepared statement
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    // Return the prepared statement to the cache
+    db_release_statement(stmt);
+    db_release_reader(db);
     
     return result;
 }
@@ -230,7 +490,6 @@ int get_recording_metadata(time_t start_time, time_t end_time,
     int count = 0;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -242,12 +501,17 @@ int get_recording_metadata(time_t start_time, time_t end_time,
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
     
     // Build query based on filters
     char sql[1024];
     strcpy(sql, "SELECT id, stream_name, file_path, start_time, end_time, "
-                 "size_bytes, width, height, fps, codec, is_complete "
+                 "size_bytes, width, height, fps, codec, is_complete, "
+                 "detection_count, detection_labels, max_confidence "
                  "FROM recordings WHERE is_complete = 1 AND end_time IS NOT NULL"); // Only complete recordings with end_time set
     
     if (start_time > 0) {
@@ -264,15 +528,13 @@ int get_recording_metadata(time_t start_time, time_t end_time,
     
     strcat(sql, " ORDER BY start_time DESC LIMIT ?;");
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
-    // No longer tracking statements - each function is responsible for finalizing its own statements
-    
     // Bind parameters
     int param_index = 1;
     
@@ -335,6 +597,9 @@ int get_recording_metadata(time_t start_time, time_t end_time,
             }
             
             metadata[count].is_complete = sqlite3_column_int(stmt, 10) != 0;
+            metadata[count].detection_count = sqlite3_column_int(stmt, 11);
+            metadata[count].detection_labels = (uint64_t)sqlite3_column_int64(stmt, 12);
+            metadata[count].max_confidence = (float)sqlite3_column_double(stmt, 13);
             
             count++;
         }
@@ -344,9 +609,9 @@ int get_recording_metadata(time_t start_time, time_t end_time,
         log_error("Error while fetching recordings: %s", sqlite3_errmsg(db));
     }
     
-    // Finalize the prepared statement
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    // Return the prepared statement to the cache
+    db_release_statement(stmt);
+    db_release_reader(db);
     
     log_info("Found %d recordings in database matching criteria", count);
     return count;
@@ -360,27 +625,26 @@ int get_recording_count(time_t start_time, time_t end_time,
     int count = 0;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
     
     // Build query based on filters
     char sql[1024];
     
+    strcpy(sql, "SELECT COUNT(*) FROM recordings WHERE is_complete = 1 AND end_time IS NOT NULL");
+    
     if (has_detection) {
-        // Use a JOIN with the detections table to filter recordings with detections
-        strcpy(sql, "SELECT COUNT(DISTINCT r.id) FROM recordings r "
-                    "INNER JOIN detections d ON r.stream_name = d.stream_name "
-                    "WHERE d.timestamp BETWEEN r.start_time AND COALESCE(r.end_time, strftime('%s', 'now')) "
-                    "AND r.is_complete = 1 AND r.end_time IS NOT NULL");
-    } else {
-        // Simple query without detection filter
-        strcpy(sql, "SELECT COUNT(*) FROM recordings WHERE is_complete = 1 AND end_time IS NOT NULL");
+        // Summary maintained as detections are stored, see link_recording_detections()
+        strcat(sql, " AND detection_count > 0");
     }
     
     if (start_time > 0) {
@@ -394,24 +658,18 @@ int get_recording_count(time_t start_time, time_t end_time,
     }
     
     if (stream_name) {
-        if (has_detection) {
-            strcat(sql, " AND r.stream_name = ?");
-        } else {
-            strcat(sql, " AND stream_name = ?");
-        }
+        strcat(sql, " AND stream_name = ?");
     }
     
     log_info("SQL query for get_recording_count: %s", sql);
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
-    // No longer tracking statements - each function is responsible for finalizing its own statements
-    
     // Bind parameters
     int param_index = 1;
     
@@ -435,9 +693,9 @@ int get_recording_count(time_t start_time, time_t end_time,
         count = -1;
     }
     
-    // Finalize the prepared statement
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    // Return the prepared statement to the cache
+    db_release_statement(stmt);
+    db_release_reader(db);
     
     log_info("Total count of recordings matching criteria: %d", count);
     return count;
@@ -454,7 +712,6 @@ int get_recording_metadata_paginated(time_t start_time, time_t end_time,
     int count = 0;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -466,7 +723,11 @@ int get_recording_metadata_paginated(time_t start_time, time_t end_time,
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
     
     // Validate and sanitize sort field to prevent SQL injection
     char safe_sort_field[32] = "start_time"; // Default sort field
@@ -498,56 +759,34 @@ int get_recording_metadata_paginated(time_t start_time, time_t end_time,
     // Build query based on filters
     char sql[1024];
     
+    snprintf(sql, sizeof(sql), 
+            "SELECT id, stream_name, file_path, start_time, end_time, "
+            "size_bytes, width, height, fps, codec, is_complete, "
+            "detection_count, detection_labels, max_confidence "
+            "FROM recordings WHERE is_complete = 1 AND end_time IS NOT NULL");
+    
     if (has_detection) {
-        // Use a JOIN with the detections table to filter recordings with detections
-        snprintf(sql, sizeof(sql), 
-                "SELECT DISTINCT r.id, r.stream_name, r.file_path, r.start_time, r.end_time, "
-                "r.size_bytes, r.width, r.height, r.fps, r.codec, r.is_complete "
-                "FROM recordings r "
-                "INNER JOIN detections d ON r.stream_name = d.stream_name "
-                "WHERE d.timestamp BETWEEN r.start_time AND COALESCE(r.end_time, strftime('%%s', 'now')) "
-                "AND r.is_complete = 1 AND r.end_time IS NOT NULL");
-    } else {
-        // Simple query without detection filter
-        snprintf(sql, sizeof(sql), 
-                "SELECT id, stream_name, file_path, start_time, end_time, "
-                "size_bytes, width, height, fps, codec, is_complete "
-                "FROM recordings WHERE is_complete = 1 AND end_time IS NOT NULL");
+        // Summary maintained as detections are stored, see link_recording_detections()
+        strcat(sql, " AND detection_count > 0");
     }
     
     if (start_time > 0) {
-        if (has_detection) {
-            strcat(sql, " AND r.start_time >= ?");
-        } else {
-            strcat(sql, " AND start_time >= ?");
-        }
+        strcat(sql, " AND start_time >= ?");
         log_info("Adding start_time filter to paginated query: %ld", (long)start_time);
     }
     
     if (end_time > 0) {
-        if (has_detection) {
-            strcat(sql, " AND r.start_time <= ?");
-        } else {
-            strcat(sql, " AND start_time <= ?");
-        }
+        strcat(sql, " AND start_time <= ?");
         log_info("Adding end_time filter to paginated query: %ld", (long)end_time);
     }
     
     if (stream_name) {
-        if (has_detection) {
-            strcat(sql, " AND r.stream_name = ?");
-        } else {
-            strcat(sql, " AND stream_name = ?");
-        }
+        strcat(sql, " AND stream_name = ?");
     }
     
     // Add ORDER BY clause with sanitized field and order
     char order_clause[64];
-    if (has_detection) {
-        snprintf(order_clause, sizeof(order_clause), " ORDER BY r.%s %s", safe_sort_field, safe_sort_order);
-    } else {
-        snprintf(order_clause, sizeof(order_clause), " ORDER BY %s %s", safe_sort_field, safe_sort_order);
-    }
+    snprintf(order_clause, sizeof(order_clause), " ORDER BY %s %s", safe_sort_field, safe_sort_order);
     strcat(sql, order_clause);
     
     // Add LIMIT and OFFSET for pagination
@@ -557,15 +796,13 @@ int get_recording_metadata_paginated(time_t start_time, time_t end_time,
     
     log_info("SQL query for get_recording_metadata_paginated: %s", sql);
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
-    // No longer tracking statements - each function is responsible for finalizing its own statements
-    
     // Bind parameters
     int param_index = 1;
     
@@ -630,6 +867,9 @@ int get_recording_metadata_paginated(time_t start_time, time_t end_time,
             }
             
             metadata[count].is_complete = sqlite3_column_int(stmt, 10) != 0;
+            metadata[count].detection_count = sqlite3_column_int(stmt, 11);
+            metadata[count].detection_labels = (uint64_t)sqlite3_column_int64(stmt, 12);
+            metadata[count].max_confidence = (float)sqlite3_column_double(stmt, 13);
             
             count++;
         }
@@ -639,9 +879,9 @@ int get_recording_metadata_paginated(time_t start_time, time_t end_time,
         log_error("Error while fetching recordings: %s", sqlite3_errmsg(db));
     }
     
-    // Finalize the prepared statement
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    // Return the prepared statement to the cache
+    db_release_statement(stmt);
+    db_release_reader(db);
     
     log_info("Found %d recordings in database matching criteria (page %d, limit %d)", 
              count, (offset / limit) + 1, limit);
@@ -650,8 +890,14 @@ int get_recording_metadata_paginated(time_t start_time, time_t end_time,
 
 // Delete recording metadata from the database
 int delete_recording_metadata(uint64_t id) {
+    return delete_recording_metadata_batch(&id, 1) < 0 ? -1 : 0;
+}
+
+// Delete old recording metadata from the database
+int delete_old_recording_metadata(uint64_t max_age) {
     int rc;
     sqlite3_stmt *stmt;
+    int deleted_count = 0;
     
     sqlite3 *db = get_db_handle();
     pthread_mutex_t *db_mutex = get_db_mutex();
@@ -663,80 +909,401 @@ int delete_recording_metadata(uint64_t id) {
     
     pthread_mutex_lock(db_mutex);
     
-    const char *sql = "DELETE FROM recordings WHERE id = ?;";
+    rc = sqlite3_exec(db, "BEGIN IMMEDIATE;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to begin transaction: %s", sqlite3_errmsg(db));
+        pthread_mutex_unlock(db_mutex);
+        return -1;
+    }
+    
+    // Calculate cutoff time
+    time_t cutoff_time = time(NULL) - max_age;
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    // Remove the recordings from the timeline rollups first
+    rc = db_prepare_cached(db, "SELECT stream_name, start_time, end_time FROM recordings "
+                               "WHERE end_time < ? AND is_complete = 1;", &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
         pthread_mutex_unlock(db_mutex);
         return -1;
     }
     
-    // No longer tracking statements - each function is responsible for finalizing its own statements
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)cutoff_time);
     
-    // Bind parameters
-    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)id);
+    int result = 0;
+    while (result == 0 && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const char *stream_name = (const char *)sqlite3_column_text(stmt, 0);
+        result = timeline_rollup_add_coverage(db, stream_name ? stream_name : "",
+                                              (time_t)sqlite3_column_int64(stmt, 1),
+                                              (time_t)sqlite3_column_int64(stmt, 2), -1);
+    }
+    db_release_statement(stmt);
+    
+    if (result == 0) {
+        rc = db_prepare_cached(db, "DELETE FROM recordings WHERE end_time < ?;", &stmt);
+        if (rc == SQLITE_OK) {
+            sqlite3_bind_int64(stmt, 1, (sqlite3_int64)cutoff_time);
+            rc = sqlite3_step(stmt);
+            deleted_count = sqlite3_changes(db);
+            db_release_statement(stmt);
+        }
+        result = rc == SQLITE_DONE ? 0 : -1;
+    }
     
-    // Execute statement
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        log_error("Failed to delete recording metadata: %s", sqlite3_errmsg(db));
-        sqlite3_finalize(stmt);
+    if (result != 0 || sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL) != SQLITE_OK) {
+        log_error("Failed to delete old recording metadata: %s", sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
         pthread_mutex_unlock(db_mutex);
         return -1;
     }
     
-    // Finalize the prepared statement
-    sqlite3_finalize(stmt);
     pthread_mutex_unlock(db_mutex);
     
-    return 0;
+    if (deleted_count > 0) {
+        recording_index_invalidate();
+        recordings_changed(NULL);
+    }
+    
+    return deleted_count;
 }
 
-// Delete old recording metadata from the database
-int delete_old_recording_metadata(uint64_t max_age) {
+// Get the oldest complete recordings eligible for deletion, ordered by start time
+int get_recordings_for_retention(const char *stream_name, time_t before, time_t detection_before,
+                                 recording_metadata_t *metadata, int max_count) {
+    int rc;
+    sqlite3_stmt *stmt;
+    int count = 0;
+
+    sqlite3 *db = get_db_handle();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    if (!metadata || max_count <= 0) {
+        log_error("Invalid parameters for get_recordings_for_retention");
+        return -1;
+    }
+
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    const char *sql = "SELECT r.id, r.stream_name, r.file_path, r.start_time, r.end_time, r.size_bytes "
+                      "FROM recordings r WHERE r.is_complete = 1 AND r.start_time < ?1 "
+                      "AND (?2 IS NULL OR r.stream_name = ?2) "
+                      "AND (r.start_time < ?3 OR r.detection_count = 0) "
+                      "ORDER BY r.start_time ASC LIMIT ?4;";
+
+    rc = db_prepare_cached(db, sql, &stmt);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        db_release_reader(db);
+        return -1;
+    }
+
+    sqlite3_int64 cutoff = before > 0 ? (sqlite3_int64)before : INT64_MAX;
+    sqlite3_int64 detection_cutoff = detection_before > 0 ? (sqlite3_int64)detection_before : INT64_MAX;
+    if (detection_cutoff > cutoff) {
+        detection_cutoff = cutoff;
+    }
+
+    sqlite3_bind_int64(stmt, 1, cutoff);
+    if (stream_name) {
+        sqlite3_bind_text(stmt, 2, stream_name, -1, SQLITE_STATIC);
+    } else {
+        sqlite3_bind_null(stmt, 2);
+    }
+    sqlite3_bind_int64(stmt, 3, detection_cutoff);
+    sqlite3_bind_int(stmt, 4, max_count);
+
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW && count < max_count) {
+        recording_metadata_t *m = &metadata[count];
+        memset(m, 0, sizeof(*m));
+
+        m->id = (uint64_t)sqlite3_column_int64(stmt, 0);
+
+        const char *stream = (const char *)sqlite3_column_text(stmt, 1);
+        if (stream) {
+            strncpy(m->stream_name, stream, sizeof(m->stream_name) - 1);
+        }
+
+        const char *path = (const char *)sqlite3_column_text(stmt, 2);
+        if (path) {
+            strncpy(m->file_path, path, sizeof(m->file_path) - 1);
+        }
+
+        m->start_time = (time_t)sqlite3_column_int64(stmt, 3);
+        m->end_time = sqlite3_column_type(stmt, 4) != SQLITE_NULL ? (time_t)sqlite3_column_int64(stmt, 4) : 0;
+        m->size_bytes = (uint64_t)sqlite3_column_int64(stmt, 5);
+        m->is_complete = true;
+
+        count++;
+    }
+
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        log_error("Failed to query recordings for retention: %s", sqlite3_errmsg(db));
+    }
+
+    db_release_statement(stmt);
+    db_release_reader(db);
+
+    return count;
+}
+
+// Delete several recordings' metadata in one transaction
+int delete_recording_metadata_batch(const uint64_t *ids, int count) {
     int rc;
     sqlite3_stmt *stmt;
     int deleted_count = 0;
-    
+
     sqlite3 *db = get_db_handle();
     pthread_mutex_t *db_mutex = get_db_mutex();
-    
+
     if (!db) {
         log_error("Database not initialized");
         return -1;
     }
-    
+
+    if (!ids || count <= 0) {
+        return 0;
+    }
+
     pthread_mutex_lock(db_mutex);
-    
-    const char *sql = "DELETE FROM recordings WHERE end_time < ?;";
-    
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+
+    rc = sqlite3_exec(db, "BEGIN IMMEDIATE;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to begin transaction: %s", sqlite3_errmsg(db));
+        pthread_mutex_unlock(db_mutex);
+        return -1;
+    }
+
+    rc = db_prepare_cached(db, "DELETE FROM recordings WHERE id = ?;", &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
         pthread_mutex_unlock(db_mutex);
         return -1;
     }
-    
-    // Calculate cutoff time
-    time_t cutoff_time = time(NULL) - max_age;
-    
-    // Bind parameters
-    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)cutoff_time);
-    
-    // Execute statement
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        log_error("Failed to delete old recording metadata: %s", sqlite3_errmsg(db));
-        sqlite3_finalize(stmt);
+
+    // Stream of the deleted recordings, empty once they span several or one is unknown
+    char changed_stream[64] = {0};
+    bool one_stream = true;
+
+    for (int i = 0; i < count; i++) {
+        char stream_name[64] = {0};
+        if (apply_recording_coverage(db, ids[i], -1, stream_name) != 0) {
+            db_release_statement(stmt);
+            sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+            pthread_mutex_unlock(db_mutex);
+            return -1;
+        }
+        
+        sqlite3_bind_int64(stmt, 1, (sqlite3_int64)ids[i]);
+        rc = sqlite3_step(stmt);
+        if (rc != SQLITE_DONE) {
+            log_error("Failed to delete recording metadata %llu: %s",
+                     (unsigned long long)ids[i], sqlite3_errmsg(db));
+            db_release_statement(stmt);
+            sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+            pthread_mutex_unlock(db_mutex);
+            return -1;
+        }
+        deleted_count += sqlite3_changes(db);
+        sqlite3_reset(stmt);
+
+        if (i == 0) {
+            memcpy(changed_stream, stream_name, sizeof(changed_stream));
+        }
+        if (stream_name[0] == '\0' || strcmp(stream_name, changed_stream) != 0) {
+            one_stream = false;
+        }
+    }
+
+    db_release_statement(stmt);
+
+    rc = sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to commit transaction: %s", sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
         pthread_mutex_unlock(db_mutex);
         return -1;
     }
-    
-    deleted_count = sqlite3_changes(db);
-    
-    sqlite3_finalize(stmt);
+
     pthread_mutex_unlock(db_mutex);
-    
+
+    recording_index_remove(ids, count);
+    recordings_changed(one_stream ? changed_stream : NULL);
+
     return deleted_count;
 }
+
+// Get the recording usage change counter
+uint64_t get_recording_usage_generation(void) {
+    return atomic_load(&usage_generation);
+}
+
+// Get the change counter of one stream's recordings
+uint64_t get_stream_recording_generation(const char *stream_name) {
+    pthread_mutex_lock(&stream_generations_mutex);
+    const stream_generation_t *entry = stream_name ? find_stream_generation(stream_name) : NULL;
+    uint64_t generation = all_streams_generation + (entry ? entry->generation : 0);
+    pthread_mutex_unlock(&stream_generations_mutex);
+    return generation;
+}
+
+// Get the running totals of all recordings
+int get_recording_usage_totals(uint64_t *total_bytes, uint64_t *total_count) {
+    int rc;
+    sqlite3_stmt *stmt;
+
+    sqlite3 *db = get_db_handle();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    if (!total_bytes) {
+        return -1;
+    }
+
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    const char *sql = "SELECT COALESCE(SUM(total_bytes), 0), COALESCE(SUM(recording_count), 0) "
+                      "FROM recording_usage;";
+
+    rc = db_prepare_cached(db, sql, &stmt);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        db_release_reader(db);
+        return -1;
+    }
+
+    int result = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        sqlite3_int64 bytes = sqlite3_column_int64(stmt, 0);
+        sqlite3_int64 count = sqlite3_column_int64(stmt, 1);
+        *total_bytes = bytes > 0 ? (uint64_t)bytes : 0;
+        if (total_count) {
+            *total_count = count > 0 ? (uint64_t)count : 0;
+        }
+        result = 0;
+    } else {
+        log_error("Failed to read recording usage: %s", sqlite3_errmsg(db));
+    }
+
+    db_release_statement(stmt);
+    db_release_reader(db);
+
+    return result;
+}
+
+// Get the running recording usage of every stream
+int get_stream_recording_usage(stream_recording_usage_t *usage, int max_count) {
+    int rc;
+    sqlite3_stmt *stmt;
+    int count = 0;
+
+    sqlite3 *db = get_db_handle();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    if (!usage || max_count <= 0) {
+        log_error("Invalid parameters for get_stream_recording_usage");
+        return -1;
+    }
+
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    const char *sql = "SELECT stream_name, total_bytes, recording_count FROM recording_usage "
+                      "WHERE recording_count > 0 ORDER BY stream_name;";
+
+    rc = db_prepare_cached(db, sql, &stmt);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        db_release_reader(db);
+        return -1;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW && count < max_count) {
+        stream_recording_usage_t *u = &usage[count];
+        memset(u, 0, sizeof(*u));
+
+        const char *name = (const char *)sqlite3_column_text(stmt, 0);
+        if (name) {
+            strncpy(u->stream_name, name, sizeof(u->stream_name) - 1);
+        }
+        sqlite3_int64 bytes = sqlite3_column_int64(stmt, 1);
+        u->total_bytes = bytes > 0 ? (uint64_t)bytes : 0;
+        u->recording_count = (uint64_t)sqlite3_column_int64(stmt, 2);
+
+        count++;
+    }
+
+    db_release_statement(stmt);
+    db_release_reader(db);
+
+    return count;
+}
+
+// Get the start time of the oldest and newest recording
+int get_recording_time_range(time_t *oldest, time_t *newest) {
+    int rc;
+    sqlite3_stmt *stmt;
+
+    sqlite3 *db = get_db_handle();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    // MIN/MAX on an indexed column are single index lookups
+    const char *sql = "SELECT (SELECT MIN(start_time) FROM recordings), "
+                      "(SELECT MAX(start_time) FROM recordings);";
+
+    rc = db_prepare_cached(db, sql, &stmt);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        db_release_reader(db);
+        return -1;
+    }
+
+    int result = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (oldest) {
+            *oldest = (time_t)sqlite3_column_int64(stmt, 0);
+        }
+        if (newest) {
+            *newest = (time_t)sqlite3_column_int64(stmt, 1);
+        }
+        result = 0;
+    }
+
+    db_release_statement(stmt);
+    db_release_reader(db);
+
+    return result;
+}
@@ -11,10 +11,12 @@
 #include "database/db_schema.h"
 #include "database/db_core.h"
 #include "database/db_schema_utils.h"
+#include "database/db_recordings.h"
+#include "database/db_timeline_rollups.h"
 #include "core/logger.h"
 
 // Current schema version - increment this when adding new migrations
-#define CURRENT_SCHEMA_VERSION 6
+#define CURRENT_SCHEMA_VERSION 10
 
 // Migration function type
 typedef int (*migration_func_t)(void);
@@ -25,6 +27,10 @@ static int migration_v2_to_v3(void);
 static int migration_v3_to_v4(void);
 static int migration_v4_to_v5(void);
 static int migration_v5_to_v6(void);
+static int migration_v6_to_v7(void);
+static int migration_v7_to_v8(void);
+static int migration_v8_to_v9(void);
+static int migration_v9_to_v10(void);
 
 // Array of migration functions
 static migration_func_t migrations[] = {
@@ -33,7 +39,11 @@ static migration_func_t migrations[] = {
     migration_v2_to_v3, // v2->v3
     migration_v3_to_v4, // v3->v4
     migration_v4_to_v5, // v4->v5
-    migration_v5_to_v6  // v5->v6
+    migration_v5_to_v6, // v5->v6
+    migration_v6_to_v7, // v6->v7
+    migration_v7_to_v8, // v7->v8
+    migration_v8_to_v9, // v8->v9
+    migration_v9_to_v10 // v9->v10
 };
 
 /**
@@ -754,3 +764,223 @@ static int migration_v5_to_v6(void) {
     log_info("Completed migration v5 to v6 with result: %d", rc);
     return rc;
 }
+
+/**
+ * Migration from version 6 to 7
+ * - Add recording_usage table with running per-stream recording sizes,
+ *   kept up to date by triggers on the recordings table
+ */
+static int migration_v6_to_v7(void) {
+    log_info("Running migration from v6 to v7: Adding per-stream recording usage");
+
+    int rc;
+    char *err_msg = NULL;
+
+    sqlite3 *db = get_db_handle();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    const char *create_usage =
+        "CREATE TABLE IF NOT EXISTS recording_usage ("
+        "stream_name TEXT PRIMARY KEY,"
+        "total_bytes INTEGER NOT NULL DEFAULT 0,"
+        "recording_count INTEGER NOT NULL DEFAULT 0"
+        ");"
+        "DELETE FROM recording_usage;"
+        "INSERT INTO recording_usage (stream_name, total_bytes, recording_count) "
+        "SELECT stream_name, COALESCE(SUM(size_bytes), 0), COUNT(*) FROM recordings GROUP BY stream_name;"
+        "CREATE TRIGGER IF NOT EXISTS trg_recording_usage_insert AFTER INSERT ON recordings "
+        "BEGIN "
+        "INSERT OR IGNORE INTO recording_usage (stream_name) VALUES (NEW.stream_name); "
+        "UPDATE recording_usage SET total_bytes = total_bytes + COALESCE(NEW.size_bytes, 0), "
+        "recording_count = recording_count + 1 WHERE stream_name = NEW.stream_name; "
+        "END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_recording_usage_update AFTER UPDATE OF size_bytes ON recordings "
+        "BEGIN "
+        "UPDATE recording_usage SET total_bytes = total_bytes - COALESCE(OLD.size_bytes, 0) "
+        "+ COALESCE(NEW.size_bytes, 0) WHERE stream_name = NEW.stream_name; "
+        "END;"
+        "CREATE TRIGGER IF NOT EXISTS trg_recording_usage_delete AFTER DELETE ON recordings "
+        "BEGIN "
+        "UPDATE recording_usage SET total_bytes = total_bytes - COALESCE(OLD.size_bytes, 0), "
+        "recording_count = recording_count - 1 WHERE stream_name = OLD.stream_name; "
+        "END;";
+
+    rc = sqlite3_exec(db, create_usage, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to create recording usage table: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+
+    log_info("Completed migration v6 to v7 with result: %d", rc);
+    return 0;
+}
+
+/**
+ * Migration from version 7 to 8
+ * - Add stream_storage_policy table for per-stream quotas and retention tiers
+ */
+static int migration_v7_to_v8(void) {
+    log_info("Running migration from v7 to v8: Adding per-stream storage policies");
+
+    int rc;
+    char *err_msg = NULL;
+
+    sqlite3 *db = get_db_handle();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    const char *create_policy_table =
+        "CREATE TABLE IF NOT EXISTS stream_storage_policy ("
+        "stream_name TEXT PRIMARY KEY,"
+        "retention_days INTEGER NOT NULL DEFAULT 0,"            // 0 = global retention
+        "detection_retention_days INTEGER NOT NULL DEFAULT 0,"  // 0 = global detection tier
+        "max_storage_bytes INTEGER NOT NULL DEFAULT 0"          // 0 = no quota
+        ");";
+
+    rc = sqlite3_exec(db, create_policy_table, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to create stream storage policy table: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+
+    log_info("Completed migration v7 to v8 with result: %d", rc);
+    return 0;
+}
+
+/**
+ * Migration from version 8 to 9
+ * - Add detection summary columns to recordings, maintained as detections are
+ *   stored, so filtering on detections no longer joins the detections table
+ * - Add detection_labels table assigning each label a bit of the summary mask
+ */
+static int migration_v8_to_v9(void) {
+    log_info("Running migration from v8 to v9: Adding recording detection summaries");
+
+    int rc = 0;
+    char *err_msg = NULL;
+
+    sqlite3 *db = get_db_handle();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    rc |= add_column_if_not_exists("recordings", "detection_count", "INTEGER NOT NULL DEFAULT 0");
+    rc |= add_column_if_not_exists("recordings", "detection_labels", "INTEGER NOT NULL DEFAULT 0");
+    rc |= add_column_if_not_exists("recordings", "max_confidence", "REAL NOT NULL DEFAULT 0");
+    if (rc != 0) {
+        return rc;
+    }
+
+    const char *create_labels =
+        "CREATE TABLE IF NOT EXISTS detection_labels ("
+        "label TEXT PRIMARY KEY,"
+        "bit INTEGER NOT NULL"
+        ");"
+        "CREATE INDEX IF NOT EXISTS idx_recordings_stream_start ON recordings (stream_name, start_time);"
+        "CREATE INDEX IF NOT EXISTS idx_recordings_detection_start ON recordings (start_time) "
+        "WHERE detection_count > 0;"
+        "CREATE INDEX IF NOT EXISTS idx_recordings_detection_stream_start ON recordings (stream_name, start_time) "
+        "WHERE detection_count > 0;";
+
+    rc = sqlite3_exec(db, create_labels, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to create detection summary tables: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+
+    // Labels already stored get bits in alphabetical order, the last bit is shared by the overflow
+    const char *assign_bits =
+        "INSERT OR IGNORE INTO detection_labels (label, bit) "
+        "SELECT l.label, MIN((SELECT COUNT(*) FROM (SELECT DISTINCT label FROM detections) o "
+        "WHERE o.label < l.label), ?) "
+        "FROM (SELECT DISTINCT label FROM detections) l;";
+
+    sqlite3_stmt *stmt = NULL;
+    rc = sqlite3_prepare_v2(db, assign_bits, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare detection label assignment: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, RECORDING_DETECTION_MAX_BIT);
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to assign detection label bits: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    // Summarize the detections already stored for complete recordings
+    if (refresh_recording_detections(db, 0) != 0) {
+        return -1;
+    }
+
+    log_info("Completed migration v8 to v9");
+    return 0;
+}
+
+static int migration_v9_to_v10(void) {
+    log_info("Running migration from v9 to v10: Adding timeline activity rollups");
+
+    int rc = 0;
+    char *err_msg = NULL;
+
+    sqlite3 *db = get_db_handle();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    const char *create_rollups =
+        "CREATE TABLE IF NOT EXISTS timeline_rollups ("
+        "stream_name TEXT NOT NULL,"
+        "resolution INTEGER NOT NULL,"
+        "bucket INTEGER NOT NULL,"
+        "coverage INTEGER NOT NULL DEFAULT 0,"
+        "motion_count INTEGER NOT NULL DEFAULT 0,"
+        "detection_count INTEGER NOT NULL DEFAULT 0,"
+        "PRIMARY KEY (stream_name, resolution, bucket)"
+        ");"
+        "CREATE INDEX IF NOT EXISTS idx_timeline_rollups_resolution_bucket ON timeline_rollups (resolution, bucket);"
+        "CREATE TABLE IF NOT EXISTS timeline_rollup_labels ("
+        "stream_name TEXT NOT NULL,"
+        "resolution INTEGER NOT NULL,"
+        "bucket INTEGER NOT NULL,"
+        "label TEXT NOT NULL,"
+        "count INTEGER NOT NULL DEFAULT 0,"
+        "PRIMARY KEY (stream_name, resolution, bucket, label)"
+        ");"
+        "CREATE INDEX IF NOT EXISTS idx_timeline_rollup_labels_resolution_bucket "
+        "ON timeline_rollup_labels (resolution, bucket);"
+        "CREATE TABLE IF NOT EXISTS timeline_rollup_state ("
+        "id INTEGER PRIMARY KEY CHECK (id = 1),"
+        "zone TEXT NOT NULL"
+        ");";
+
+    rc = sqlite3_exec(db, create_rollups, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to create timeline rollup tables: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+
+    // Roll up the recordings and detections already stored
+    if (timeline_rollup_rebuild(db) != 0) {
+        return -1;
+    }
+
+    log_info("Completed migration v9 to v10");
+    return 0;
+}
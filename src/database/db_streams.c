@@ -11,6 +11,7 @@
 
 #include "database/db_streams.h"
 #include "database/db_core.h"
+#include "database/db_pool.h"
 #include "database/db_schema.h"
 #include "database/db_schema_cache.h"
 #include "core/logger.h"
@@ -46,7 +47,7 @@ uint64_t add_stream_config(const stream_config_t *stream) {
     const char *check_sql = "SELECT id FROM streams WHERE name = ? AND enabled = 0;";
     sqlite3_stmt *check_stmt;
 
-    rc = sqlite3_prepare_v2(db, check_sql, -1, &check_stmt, NULL);
+    rc = db_prepare_cached(db, check_sql, &check_stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement to check for disabled stream: %s", sqlite3_errmsg(db));
         pthread_mutex_unlock(db_mutex);
@@ -59,9 +60,9 @@ uint64_t add_stream_config(const stream_config_t *stream) {
         // Stream exists but is disabled, enable it by updating
         uint64_t existing_id = (uint64_t)sqlite3_column_int64(check_stmt, 0);
 
-        // Finalize the prepared statement
+        // Return the prepared statement to the cache
         if (check_stmt) {
-            sqlite3_finalize(check_stmt);
+            db_release_statement(check_stmt);
             check_stmt = NULL;
         }
 
@@ -73,7 +74,7 @@ uint64_t add_stream_config(const stream_config_t *stream) {
                                 "protocol = ?, is_onvif = ?, record_audio = ? "
                                 "WHERE id = ?;";
 
-        rc = sqlite3_prepare_v2(db, update_sql, -1, &stmt, NULL);
+        rc = db_prepare_cached(db, update_sql, &stmt);
         if (rc != SQLITE_OK) {
             log_error("Failed to prepare statement to update disabled stream: %s", sqlite3_errmsg(db));
             pthread_mutex_unlock(db_mutex);
@@ -117,18 +118,18 @@ uint64_t add_stream_config(const stream_config_t *stream) {
         if (rc != SQLITE_DONE) {
             log_error("Failed to update disabled stream configuration: %s", sqlite3_errmsg(db));
 
-            // Finalize the prepared statement
+            // Return the prepared statement to the cache
             if (stmt) {
-                sqlite3_finalize(stmt);
+                db_release_statement(stmt);
                 stmt = NULL;
             }
             pthread_mutex_unlock(db_mutex);
             return 0;
         }
 
-        // Finalize the prepared statement
+        // Return the prepared statement to the cache
         if (stmt) {
-            sqlite3_finalize(stmt);
+            db_release_statement(stmt);
             stmt = NULL;
         }
 
@@ -142,9 +143,9 @@ uint64_t add_stream_config(const stream_config_t *stream) {
         return existing_id;
     }
 
-    // Finalize the prepared statement
+    // Return the prepared statement to the cache
     if (check_stmt) {
-        sqlite3_finalize(check_stmt);
+        db_release_statement(check_stmt);
         check_stmt = NULL;
     }
 
@@ -154,7 +155,7 @@ uint64_t add_stream_config(const stream_config_t *stream) {
           "pre_detection_buffer, post_detection_buffer, protocol, is_onvif, record_audio) "
           "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
 
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
         pthread_mutex_unlock(db_mutex);
@@ -208,9 +209,9 @@ uint64_t add_stream_config(const stream_config_t *stream) {
                 stream->detection_model);
     }
 
-    // Finalize the prepared statement
+    // Return the prepared statement to the cache
     if (stmt) {
-        sqlite3_finalize(stmt);
+        db_release_statement(stmt);
         stmt = NULL;
     }
     pthread_mutex_unlock(db_mutex);
@@ -256,7 +257,7 @@ int update_stream_config(const char *name, const stream_config_t *stream) {
                       "protocol = ?, is_onvif = ?, record_audio = ? "
                       "WHERE name = ?;";
 
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
         pthread_mutex_unlock(db_mutex);
@@ -301,18 +302,18 @@ int update_stream_config(const char *name, const stream_config_t *stream) {
     if (rc != SQLITE_DONE) {
         log_error("Failed to update stream configuration: %s", sqlite3_errmsg(db));
 
-        // Finalize the prepared statement
+        // Return the prepared statement to the cache
         if (stmt) {
-            sqlite3_finalize(stmt);
+            db_release_statement(stmt);
             stmt = NULL;
         }
         pthread_mutex_unlock(db_mutex);
         return -1;
     }
 
-    // Finalize the prepared statement
+    // Return the prepared statement to the cache
     if (stmt) {
-        sqlite3_finalize(stmt);
+        db_release_statement(stmt);
         stmt = NULL;
     }
 
@@ -375,7 +376,7 @@ int delete_stream_config_internal(const char *name, bool permanent) {
         log_info("Preparing to disable stream: %s", name);
     }
 
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
         pthread_mutex_unlock(db_mutex);
@@ -392,18 +393,18 @@ int delete_stream_config_internal(const char *name, bool permanent) {
                 permanent ? "permanently delete" : "disable",
                 sqlite3_errmsg(db));
 
-        // Finalize the prepared statement
+        // Return the prepared statement to the cache
         if (stmt) {
-            sqlite3_finalize(stmt);
+            db_release_statement(stmt);
             stmt = NULL;
         }
         pthread_mutex_unlock(db_mutex);
         return -1;
     }
 
-    // Finalize the prepared statement
+    // Return the prepared statement to the cache
     if (stmt) {
-        sqlite3_finalize(stmt);
+        db_release_statement(stmt);
         stmt = NULL;
     }
 
@@ -431,7 +432,6 @@ int get_stream_config_by_name(const char *name, stream_config_t *stream) {
     int result = -1;
 
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
 
     if (!db) {
         log_error("Database not initialized");
@@ -443,7 +443,11 @@ int get_stream_config_by_name(const char *name, stream_config_t *stream) {
         return -1;
     }
 
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
 
     // Use our cached schema management functions to check for columns
     bool has_detection_columns = cached_column_exists("streams", "detection_based_recording");
@@ -473,10 +477,10 @@ int get_stream_config_by_name(const char *name, stream_config_t *stream) {
               "FROM streams WHERE name = ?;";
     }
 
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
 
@@ -574,12 +578,12 @@ int get_stream_config_by_name(const char *name, stream_config_t *stream) {
         result = 0; // Success
     }
 
-    // Finalize the prepared statement
+    // Return the prepared statement to the cache
     if (stmt) {
-        sqlite3_finalize(stmt);
+        db_release_statement(stmt);
         stmt = NULL;
     }
-    pthread_mutex_unlock(db_mutex);
+    db_release_reader(db);
 
     return result;
 }
@@ -597,7 +601,6 @@ int get_all_stream_configs(stream_config_t *streams, int max_count) {
     int count = 0;
 
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
 
     if (!db) {
         log_error("Database not initialized");
@@ -609,7 +612,11 @@ int get_all_stream_configs(stream_config_t *streams, int max_count) {
         return -1;
     }
 
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
 
     // Use our cached schema management functions to check for columns
     bool has_detection_columns = cached_column_exists("streams", "detection_based_recording");
@@ -639,10 +646,10 @@ int get_all_stream_configs(stream_config_t *streams, int max_count) {
               "FROM streams ORDER BY name;";
     }
 
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
 
@@ -737,12 +744,12 @@ int get_all_stream_configs(stream_config_t *streams, int max_count) {
         count++;
     }
 
-    // Finalize the prepared statement
+    // Return the prepared statement to the cache
     if (stmt) {
-        sqlite3_finalize(stmt);
+        db_release_statement(stmt);
         stmt = NULL;
     }
-    pthread_mutex_unlock(db_mutex);
+    db_release_reader(db);
 
     return count;
 }
@@ -759,7 +766,6 @@ int is_stream_eligible_for_live_streaming(const char *stream_name) {
     int result = -1;
 
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
 
     if (!db) {
         log_error("Database not initialized");
@@ -771,14 +777,18 @@ int is_stream_eligible_for_live_streaming(const char *stream_name) {
         return -1;
     }
 
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
 
     const char *sql = "SELECT enabled, streaming_enabled FROM streams WHERE name = ?;";
 
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
 
@@ -802,12 +812,12 @@ int is_stream_eligible_for_live_streaming(const char *stream_name) {
         result = 0; // Not eligible if not found
     }
 
-    // Finalize the prepared statement
+    // Return the prepared statement to the cache
     if (stmt) {
-        sqlite3_finalize(stmt);
+        db_release_statement(stmt);
         stmt = NULL;
     }
-    pthread_mutex_unlock(db_mutex);
+    db_release_reader(db);
 
     return result;
 }
@@ -823,21 +833,24 @@ int get_enabled_stream_count(void) {
     int count = -1;
 
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
 
     if (!db) {
         log_error("Database not initialized");
         return -1;
     }
 
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
 
     const char *sql = "SELECT COUNT(*) FROM streams WHERE enabled = 1;";
 
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
 
@@ -845,9 +858,9 @@ int get_enabled_stream_count(void) {
         count = sqlite3_column_int(stmt, 0);
     }
 
-    // finalize the prepared statement
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    // Return the prepared statement to the cache
+    db_release_statement(stmt);
+    db_release_reader(db);
 
     return count;
 }
@@ -863,21 +876,24 @@ int count_stream_configs(void) {
     int count = -1;
 
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
 
     if (!db) {
         log_error("Database not initialized");
         return -1;
     }
 
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
 
     const char *sql = "SELECT COUNT(*) FROM streams;";
 
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    rc = db_prepare_cached(db, sql, &stmt);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
 
@@ -885,9 +901,171 @@ int count_stream_configs(void) {
         count = sqlite3_column_int(stmt, 0);
     }
 
-    // finalize the prepared statement
-    sqlite3_finalize(stmt);
+    // Return the prepared statement to the cache
+    db_release_statement(stmt);
+    db_release_reader(db);
+
+    return count;
+}
+
+/**
+ * Get the storage policy of a stream
+ */
+int get_stream_storage_policy(const char *stream_name, stream_storage_policy_t *policy) {
+    int rc;
+    sqlite3_stmt *stmt;
+
+    sqlite3 *db = get_db_handle();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    if (!stream_name || !policy) {
+        log_error("Invalid parameters for get_stream_storage_policy");
+        return -1;
+    }
+
+    memset(policy, 0, sizeof(*policy));
+    strncpy(policy->stream_name, stream_name, MAX_STREAM_NAME - 1);
+
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    const char *sql = "SELECT retention_days, detection_retention_days, max_storage_bytes "
+                      "FROM stream_storage_policy WHERE stream_name = ?;";
+
+    rc = db_prepare_cached(db, sql, &stmt);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        db_release_reader(db);
+        return -1;
+    }
+
+    sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        policy->retention_days = sqlite3_column_int(stmt, 0);
+        policy->detection_retention_days = sqlite3_column_int(stmt, 1);
+        policy->max_storage_bytes = (uint64_t)sqlite3_column_int64(stmt, 2);
+    }
+
+    db_release_statement(stmt);
+    db_release_reader(db);
+
+    return 0;
+}
+
+/**
+ * Create or replace the storage policy of a stream
+ */
+int set_stream_storage_policy(const stream_storage_policy_t *policy) {
+    int rc;
+    sqlite3_stmt *stmt;
+
+    sqlite3 *db = get_db_handle();
+    pthread_mutex_t *db_mutex = get_db_mutex();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    if (!policy || policy->stream_name[0] == '\0') {
+        log_error("Invalid parameters for set_stream_storage_policy");
+        return -1;
+    }
+
+    pthread_mutex_lock(db_mutex);
+
+    const char *sql = "INSERT OR REPLACE INTO stream_storage_policy "
+                      "(stream_name, retention_days, detection_retention_days, max_storage_bytes) "
+                      "VALUES (?, ?, ?, ?);";
+
+    rc = db_prepare_cached(db, sql, &stmt);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        pthread_mutex_unlock(db_mutex);
+        return -1;
+    }
+
+    sqlite3_bind_text(stmt, 1, policy->stream_name, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, policy->retention_days);
+    sqlite3_bind_int(stmt, 3, policy->detection_retention_days);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)policy->max_storage_bytes);
+
+    rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to store storage policy for stream %s: %s",
+                 policy->stream_name, sqlite3_errmsg(db));
+        db_release_statement(stmt);
+        pthread_mutex_unlock(db_mutex);
+        return -1;
+    }
+
+    db_release_statement(stmt);
     pthread_mutex_unlock(db_mutex);
 
+    return 0;
+}
+
+/**
+ * Get all stream storage policies
+ */
+int get_all_stream_storage_policies(stream_storage_policy_t *policies, int max_count) {
+    int rc;
+    sqlite3_stmt *stmt;
+    int count = 0;
+
+    sqlite3 *db = get_db_handle();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    if (!policies || max_count <= 0) {
+        log_error("Invalid parameters for get_all_stream_storage_policies");
+        return -1;
+    }
+
+    db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    const char *sql = "SELECT stream_name, retention_days, detection_retention_days, max_storage_bytes "
+                      "FROM stream_storage_policy ORDER BY stream_name;";
+
+    rc = db_prepare_cached(db, sql, &stmt);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        db_release_reader(db);
+        return -1;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW && count < max_count) {
+        stream_storage_policy_t *policy = &policies[count];
+        memset(policy, 0, sizeof(*policy));
+
+        const char *name = (const char *)sqlite3_column_text(stmt, 0);
+        if (name) {
+            strncpy(policy->stream_name, name, MAX_STREAM_NAME - 1);
+        }
+        policy->retention_days = sqlite3_column_int(stmt, 1);
+        policy->detection_retention_days = sqlite3_column_int(stmt, 2);
+        policy->max_storage_bytes = (uint64_t)sqlite3_column_int64(stmt, 3);
+
+        count++;
+    }
+
+    db_release_statement(stmt);
+    db_release_reader(db);
+
     return count;
 }
@@ -0,0 +1,656 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <sqlite3.h>
+#include <pthread.h>
+
+#include "database/db_timeline_rollups.h"
+#include "database/db_core.h"
+#include "database/db_pool.h"
+#include "core/logger.h"
+
+// Bucket lengths in seconds, finest first
+static const int resolutions[TIMELINE_ROLLUP_RESOLUTIONS] = {60, 900, 3600, 86400};
+
+// Longer recordings are assumed to have a corrupt time range and are not rolled up
+#define TIMELINE_ROLLUP_MAX_RANGE (31 * 86400)
+
+/**
+ * Start of the bucket holding a time
+ *
+ * Buckets follow local wall time: shorter buckets are aligned with the local
+ * UTC offset in effect and days start at local midnight, so they may be 23 or
+ * 25 hours long across a DST change.
+ */
+static time_t rollup_bucket(time_t t, int resolution) {
+    struct tm tm;
+    localtime_r(&t, &tm);
+
+    if (resolution < 86400) {
+        long into = (long)((t + tm.tm_gmtoff) % resolution);
+        if (into < 0) {
+            into += resolution;
+        }
+        return t - into;
+    }
+
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    return mktime(&tm);
+}
+
+/**
+ * Start of the bucket following one, allowing for buckets stretched or
+ * shortened by an offset change
+ */
+static time_t rollup_next_bucket(time_t bucket, int resolution) {
+    return rollup_bucket(bucket + resolution + resolution / 2, resolution);
+}
+
+/**
+ * rollup_bucket(time, resolution) for the rebuild queries
+ */
+static void sql_rollup_bucket(sqlite3_context *context, int argc, sqlite3_value **argv) {
+    (void)argc;
+    sqlite3_result_int64(context, (sqlite3_int64)rollup_bucket((time_t)sqlite3_value_int64(argv[0]),
+                                                               sqlite3_value_int(argv[1])));
+}
+
+/**
+ * Describe the local time zone, so rollups built under another one are detected
+ */
+static void get_zone_signature(char *signature, size_t size) {
+    tzset();
+
+    // UTC offsets in winter and summer of this year, plus the zone names
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    tm.tm_mon = 0;
+    tm.tm_mday = 1;
+    tm.tm_hour = 12;
+    tm.tm_isdst = -1;
+    time_t january = mktime(&tm);
+    tm.tm_mon = 6;
+    tm.tm_mday = 1;
+    tm.tm_hour = 12;
+    tm.tm_isdst = -1;
+    time_t july = mktime(&tm);
+
+    struct tm jan_tm, jul_tm;
+    localtime_r(&january, &jan_tm);
+    localtime_r(&july, &jul_tm);
+
+    snprintf(signature, size, "%s/%s/%ld/%ld", tzname[0], tzname[1],
+             (long)jan_tm.tm_gmtoff, (long)jul_tm.tm_gmtoff);
+}
+
+int timeline_rollup_resolution(int index) {
+    if (index < 0 || index >= TIMELINE_ROLLUP_RESOLUTIONS) {
+        return 0;
+    }
+    return resolutions[index];
+}
+
+int timeline_rollup_parse_resolution(const char *value) {
+    if (!value || value[0] == '\0') {
+        return -1;
+    }
+
+    char *end = NULL;
+    long length = strtol(value, &end, 10);
+    if (end == value || length <= 0) {
+        return -1;
+    }
+
+    if (strcmp(end, "m") == 0) {
+        length *= 60;
+    } else if (strcmp(end, "h") == 0) {
+        length *= 3600;
+    } else if (strcmp(end, "d") == 0) {
+        length *= 86400;
+    } else if (strcmp(end, "") != 0 && strcmp(end, "s") != 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < TIMELINE_ROLLUP_RESOLUTIONS; i++) {
+        if (resolutions[i] == length) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Add to the totals of a bucket, creating it on first use and dropping it once empty
+ */
+static int add_to_bucket(sqlite3 *db, const char *stream_name, int resolution, sqlite3_int64 bucket,
+                         int coverage, int motion_count, int detection_count) {
+    sqlite3_stmt *stmt;
+
+    const char *update_sql = "UPDATE timeline_rollups SET coverage = coverage + ?1, "
+                             "motion_count = motion_count + ?2, detection_count = detection_count + ?3 "
+                             "WHERE stream_name = ?4 AND resolution = ?5 AND bucket = ?6;";
+
+    if (db_prepare_cached(db, update_sql, &stmt) != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, coverage);
+    sqlite3_bind_int(stmt, 2, motion_count);
+    sqlite3_bind_int(stmt, 3, detection_count);
+    sqlite3_bind_text(stmt, 4, stream_name, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 5, resolution);
+    sqlite3_bind_int64(stmt, 6, bucket);
+    int rc = sqlite3_step(stmt);
+    db_release_statement(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to update timeline rollup: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    if (sqlite3_changes(db) > 0) {
+        if (coverage >= 0) {
+            return 0;
+        }
+
+        // Coverage removed, the bucket may have nothing left
+        const char *delete_sql = "DELETE FROM timeline_rollups WHERE stream_name = ?1 AND resolution = ?2 "
+                                 "AND bucket = ?3 AND coverage <= 0 AND motion_count = 0 AND detection_count = 0;";
+        if (db_prepare_cached(db, delete_sql, &stmt) != SQLITE_OK) {
+            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+            return -1;
+        }
+        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, resolution);
+        sqlite3_bind_int64(stmt, 3, bucket);
+        rc = sqlite3_step(stmt);
+        db_release_statement(stmt);
+        return rc == SQLITE_DONE ? 0 : -1;
+    }
+
+    // Nothing to remove from a bucket that does not exist
+    if (coverage < 0) {
+        return 0;
+    }
+
+    const char *insert_sql = "INSERT INTO timeline_rollups (stream_name, resolution, bucket, coverage, "
+                             "motion_count, detection_count) VALUES (?, ?, ?, ?, ?, ?);";
+    if (db_prepare_cached(db, insert_sql, &stmt) != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, resolution);
+    sqlite3_bind_int64(stmt, 3, bucket);
+    sqlite3_bind_int(stmt, 4, coverage);
+    sqlite3_bind_int(stmt, 5, motion_count);
+    sqlite3_bind_int(stmt, 6, detection_count);
+    rc = sqlite3_step(stmt);
+    db_release_statement(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to insert timeline rollup: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Add to the count of a label in a bucket
+ */
+static int add_to_label(sqlite3 *db, const char *stream_name, int resolution, sqlite3_int64 bucket,
+                        const char *label, int count) {
+    sqlite3_stmt *stmt;
+
+    const char *update_sql = "UPDATE timeline_rollup_labels SET count = count + ?1 "
+                             "WHERE stream_name = ?2 AND resolution = ?3 AND bucket = ?4 AND label = ?5;";
+
+    if (db_prepare_cached(db, update_sql, &stmt) != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, count);
+    sqlite3_bind_text(stmt, 2, stream_name, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, resolution);
+    sqlite3_bind_int64(stmt, 4, bucket);
+    sqlite3_bind_text(stmt, 5, label, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    db_release_statement(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to update timeline label rollup: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    if (sqlite3_changes(db) > 0) {
+        return 0;
+    }
+
+    const char *insert_sql = "INSERT INTO timeline_rollup_labels (stream_name, resolution, bucket, label, count) "
+                             "VALUES (?, ?, ?, ?, ?);";
+    if (db_prepare_cached(db, insert_sql, &stmt) != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, resolution);
+    sqlite3_bind_int64(stmt, 3, bucket);
+    sqlite3_bind_text(stmt, 4, label, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 5, count);
+    rc = sqlite3_step(stmt);
+    db_release_statement(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to insert timeline label rollup: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    return 0;
+}
+
+int timeline_rollup_add_coverage(sqlite3 *db, const char *stream_name, time_t start_time,
+                                 time_t end_time, int sign) {
+    if (!db || !stream_name || end_time <= start_time) {
+        return 0;
+    }
+
+    if (end_time - start_time > TIMELINE_ROLLUP_MAX_RANGE) {
+        log_warn("Not adding recording of stream %s from %ld to %ld to the timeline rollups",
+                 stream_name, (long)start_time, (long)end_time);
+        return 0;
+    }
+
+    for (int i = 0; i < TIMELINE_ROLLUP_RESOLUTIONS; i++) {
+        int resolution = resolutions[i];
+        time_t next;
+
+        for (time_t bucket = rollup_bucket(start_time, resolution); bucket < end_time; bucket = next) {
+            next = rollup_next_bucket(bucket, resolution);
+            time_t from = bucket > start_time ? bucket : start_time;
+            time_t to = next < end_time ? next : end_time;
+
+            if (add_to_bucket(db, stream_name, resolution, bucket, sign * (int)(to - from), 0, 0) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int timeline_rollup_add_detections(sqlite3 *db, const char *stream_name, time_t timestamp,
+                                   const detection_t *detections, int count) {
+    if (!db || !stream_name || !detections || count <= 0) {
+        return 0;
+    }
+
+    // Count each label of the batch once
+    const char *labels[MAX_DETECTIONS];
+    int label_counts[MAX_DETECTIONS];
+    int label_count = 0;
+    int motion_count = 0;
+    int detection_count = 0;
+
+    for (int i = 0; i < count && i < MAX_DETECTIONS; i++) {
+        const char *label = detections[i].label;
+        if (strcmp(label, TIMELINE_ROLLUP_MOTION_LABEL) == 0) {
+            motion_count++;
+            continue;
+        }
+
+        detection_count++;
+        int j = 0;
+        while (j < label_count && strcmp(labels[j], label) != 0) {
+            j++;
+        }
+        if (j == label_count) {
+            labels[label_count] = label;
+            label_counts[label_count++] = 0;
+        }
+        label_counts[j]++;
+    }
+
+    for (int i = 0; i < TIMELINE_ROLLUP_RESOLUTIONS; i++) {
+        int resolution = resolutions[i];
+        time_t bucket = rollup_bucket(timestamp, resolution);
+
+        if (add_to_bucket(db, stream_name, resolution, bucket, 0, motion_count, detection_count) != 0) {
+            return -1;
+        }
+        for (int j = 0; j < label_count; j++) {
+            if (add_to_label(db, stream_name, resolution, bucket, labels[j], label_counts[j]) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int timeline_rollup_rebuild(sqlite3 *db) {
+    sqlite3_stmt *stmt;
+    char *err_msg = NULL;
+
+    if (!db) {
+        return -1;
+    }
+
+    int rc = sqlite3_exec(db, "DELETE FROM timeline_rollups; DELETE FROM timeline_rollup_labels;",
+                          NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to clear timeline rollups: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+
+    // Bucket detections the same way as timeline_rollup_add_detections
+    rc = sqlite3_create_function(db, "rollup_bucket", 2, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL,
+                                 sql_rollup_bucket, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to register rollup_bucket: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    // Detections first, the tables are empty so they need no upsert
+    const char *detections_sql =
+        "INSERT INTO timeline_rollups (stream_name, resolution, bucket, coverage, motion_count, detection_count) "
+        "SELECT stream_name, ?1, rollup_bucket(timestamp, ?1), 0, "
+        "SUM(label = '" TIMELINE_ROLLUP_MOTION_LABEL "'), SUM(label != '" TIMELINE_ROLLUP_MOTION_LABEL "') "
+        "FROM detections GROUP BY stream_name, rollup_bucket(timestamp, ?1);";
+    const char *labels_sql =
+        "INSERT INTO timeline_rollup_labels (stream_name, resolution, bucket, label, count) "
+        "SELECT stream_name, ?1, rollup_bucket(timestamp, ?1), label, COUNT(*) "
+        "FROM detections WHERE label != '" TIMELINE_ROLLUP_MOTION_LABEL "' "
+        "GROUP BY stream_name, rollup_bucket(timestamp, ?1), label;";
+    const char *rebuild_sql[] = {detections_sql, labels_sql};
+
+    for (int i = 0; i < TIMELINE_ROLLUP_RESOLUTIONS; i++) {
+        for (int j = 0; j < 2; j++) {
+            rc = db_prepare_cached(db, rebuild_sql[j], &stmt);
+            if (rc != SQLITE_OK) {
+                log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+                return -1;
+            }
+            sqlite3_bind_int(stmt, 1, resolutions[i]);
+            rc = sqlite3_step(stmt);
+            db_release_statement(stmt);
+            if (rc != SQLITE_DONE) {
+                log_error("Failed to roll up detections: %s", sqlite3_errmsg(db));
+                return -1;
+            }
+        }
+    }
+
+    // Then the time range of every complete recording
+    rc = sqlite3_prepare_v2(db, "SELECT stream_name, start_time, end_time FROM recordings "
+                                "WHERE is_complete = 1 AND end_time IS NOT NULL;", -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    int result = 0;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const char *stream_name = (const char *)sqlite3_column_text(stmt, 0);
+        if (timeline_rollup_add_coverage(db, stream_name,
+                                         (time_t)sqlite3_column_int64(stmt, 1),
+                                         (time_t)sqlite3_column_int64(stmt, 2), 1) != 0) {
+            result = -1;
+            break;
+        }
+    }
+    if (result == 0 && rc != SQLITE_DONE) {
+        log_error("Failed to roll up recordings: %s", sqlite3_errmsg(db));
+        result = -1;
+    }
+    sqlite3_finalize(stmt);
+
+    if (result != 0) {
+        return result;
+    }
+
+    // Remember the zone the buckets were aligned in
+    char zone[128];
+    get_zone_signature(zone, sizeof(zone));
+    if (sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO timeline_rollup_state (id, zone) VALUES (1, ?);",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, zone, -1, SQLITE_STATIC);
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to store timeline rollup zone: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    return 0;
+}
+
+int timeline_rollup_check_zone(sqlite3 *db) {
+    sqlite3_stmt *stmt;
+
+    if (!db) {
+        return -1;
+    }
+
+    char zone[128];
+    get_zone_signature(zone, sizeof(zone));
+
+    if (sqlite3_prepare_v2(db, "SELECT zone FROM timeline_rollup_state WHERE id = 1;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    bool same_zone = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *stored = (const char *)sqlite3_column_text(stmt, 0);
+        same_zone = stored && strcmp(stored, zone) == 0;
+    }
+    sqlite3_finalize(stmt);
+
+    if (same_zone) {
+        return 0;
+    }
+
+    log_info("Local time zone is now %s, rebuilding timeline rollups", zone);
+
+    char *err_msg = NULL;
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE;", NULL, NULL, &err_msg) != SQLITE_OK) {
+        log_error("Failed to begin transaction: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    if (timeline_rollup_rebuild(db) != 0) {
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+        return -1;
+    }
+    if (sqlite3_exec(db, "COMMIT;", NULL, NULL, &err_msg) != SQLITE_OK) {
+        log_error("Failed to commit timeline rollups: %s", err_msg);
+        sqlite3_free(err_msg);
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+        return -1;
+    }
+
+    return 0;
+}
+
+int prune_timeline_rollups(const char *stream_name, time_t before) {
+    sqlite3_stmt *stmt;
+
+    sqlite3 *db = get_db_handle();
+    pthread_mutex_t *db_mutex = get_db_mutex();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    const char *sql[] = {
+        "DELETE FROM timeline_rollups WHERE resolution = ?1 AND bucket <= ?2 - ?1 "
+        "AND (?3 IS NULL OR stream_name = ?3);",
+        "DELETE FROM timeline_rollup_labels WHERE resolution = ?1 AND bucket <= ?2 - ?1 "
+        "AND (?3 IS NULL OR stream_name = ?3);",
+    };
+
+    int deleted = 0;
+    int result = 0;
+
+    pthread_mutex_lock(db_mutex);
+
+    for (int i = 0; i < TIMELINE_ROLLUP_RESOLUTIONS && result == 0; i++) {
+        for (int j = 0; j < 2; j++) {
+            if (db_prepare_cached(db, sql[j], &stmt) != SQLITE_OK) {
+                log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+                result = -1;
+                break;
+            }
+            sqlite3_bind_int(stmt, 1, resolutions[i]);
+            sqlite3_bind_int64(stmt, 2, (sqlite3_int64)before);
+            if (stream_name) {
+                sqlite3_bind_text(stmt, 3, stream_name, -1, SQLITE_STATIC);
+            }
+
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                log_error("Failed to prune timeline rollups: %s", sqlite3_errmsg(db));
+                result = -1;
+            } else {
+                deleted += sqlite3_changes(db);
+            }
+            db_release_statement(stmt);
+            if (result != 0) {
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(db_mutex);
+
+    if (deleted > 0) {
+        log_debug("Pruned %d timeline rollup rows of %s before %ld",
+                  deleted, stream_name ? stream_name : "all streams", (long)before);
+    }
+    return result;
+}
+
+int get_timeline_heatmap(const char *stream_name, time_t start_time, time_t end_time, int resolution,
+                         timeline_heatmap_bucket_t *buckets, int max_buckets) {
+    sqlite3_stmt *stmt;
+    int count = 0;
+
+    int length = timeline_rollup_resolution(resolution);
+    if (length == 0 || !buckets || max_buckets <= 0) {
+        return -1;
+    }
+
+    sqlite3 *db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    // Overlapping recordings of a stream cannot cover more than the whole bucket
+    const char *sql = stream_name
+        ? "SELECT bucket, MIN(coverage, ?1), motion_count, detection_count FROM timeline_rollups "
+          "WHERE stream_name = ?4 AND resolution = ?1 AND bucket >= ?2 AND bucket < ?3 "
+          "ORDER BY bucket LIMIT ?5;"
+        : "SELECT bucket, SUM(MIN(coverage, ?1)), SUM(motion_count), SUM(detection_count) FROM timeline_rollups "
+          "WHERE resolution = ?1 AND bucket >= ?2 AND bucket < ?3 "
+          "GROUP BY bucket ORDER BY bucket LIMIT ?5;";
+
+    if (db_prepare_cached(db, sql, &stmt) != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        db_release_reader(db);
+        return -1;
+    }
+
+    sqlite3_bind_int(stmt, 1, length);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)rollup_bucket(start_time, length));
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)end_time);
+    if (stream_name) {
+        sqlite3_bind_text(stmt, 4, stream_name, -1, SQLITE_STATIC);
+    }
+    sqlite3_bind_int(stmt, 5, max_buckets);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        buckets[count].start = (time_t)sqlite3_column_int64(stmt, 0);
+        buckets[count].coverage = sqlite3_column_int(stmt, 1);
+        buckets[count].motion_count = sqlite3_column_int(stmt, 2);
+        buckets[count].detection_count = sqlite3_column_int(stmt, 3);
+        count++;
+    }
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to read timeline heatmap: %s", sqlite3_errmsg(db));
+        count = -1;
+    }
+
+    db_release_statement(stmt);
+    db_release_reader(db);
+    return count;
+}
+
+int get_timeline_heatmap_labels(const char *stream_name, time_t start_time, time_t end_time, int resolution,
+                                timeline_heatmap_label_t *labels, int max_labels) {
+    sqlite3_stmt *stmt;
+    int count = 0;
+
+    int length = timeline_rollup_resolution(resolution);
+    if (length == 0 || !labels || max_labels <= 0) {
+        return -1;
+    }
+
+    sqlite3 *db = db_acquire_reader();
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    const char *sql = stream_name
+        ? "SELECT bucket, label, count FROM timeline_rollup_labels "
+          "WHERE stream_name = ?4 AND resolution = ?1 AND bucket >= ?2 AND bucket < ?3 "
+          "ORDER BY bucket, label LIMIT ?5;"
+        : "SELECT bucket, label, SUM(count) FROM timeline_rollup_labels "
+          "WHERE resolution = ?1 AND bucket >= ?2 AND bucket < ?3 "
+          "GROUP BY bucket, label ORDER BY bucket, label LIMIT ?5;";
+
+    if (db_prepare_cached(db, sql, &stmt) != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        db_release_reader(db);
+        return -1;
+    }
+
+    sqlite3_bind_int(stmt, 1, length);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)rollup_bucket(start_time, length));
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)end_time);
+    if (stream_name) {
+        sqlite3_bind_text(stmt, 4, stream_name, -1, SQLITE_STATIC);
+    }
+    sqlite3_bind_int(stmt, 5, max_labels);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const char *label = (const char *)sqlite3_column_text(stmt, 1);
+        labels[count].start = (time_t)sqlite3_column_int64(stmt, 0);
+        strncpy(labels[count].label, label ? label : "", sizeof(labels[count].label) - 1);
+        labels[count].label[sizeof(labels[count].label) - 1] = '\0';
+        labels[count].count = sqlite3_column_int(stmt, 2);
+        count++;
+    }
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to read timeline heatmap labels: %s", sqlite3_errmsg(db));
+        count = -1;
+    }
+
+    db_release_statement(stmt);
+    db_release_reader(db);
+    return count;
+}
@@ -0,0 +1,427 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sqlite3.h>
+
+#include "database/db_writer.h"
+#include "database/db_core.h"
+#include "database/db_pool.h"
+#include "core/logger.h"
+#include "core/metrics.h"
+
+#define DB_WRITER_QUEUE_LIMIT 4096  // Submitters block beyond this many queued writes
+
+struct db_write_future {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int refs;                       // Submitter and writer
+    bool queued;                    // Still in the queue, guarded by queue_mutex
+    bool waited;                    // Counted in queue_waiters, guarded by queue_mutex
+    bool done;
+    int result;
+    uint64_t row_id;
+};
+
+typedef struct db_write_op {
+    db_write_ops_t ops;
+    void *arg;
+    db_write_future_t *future;
+    int result;
+    uint64_t row_id;
+    struct db_write_op *next;
+} db_write_op_t;
+
+static int commit_interval_ms = 5;
+static int batch_size = 256;
+static char synchronous_mode[16] = "normal";
+
+static pthread_t writer_thread;
+static bool writer_running = false;
+
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;     // Writes queued or stop requested
+static pthread_cond_t space_cond = PTHREAD_COND_INITIALIZER;     // Queue drained below the limit
+static db_write_op_t *queue_head = NULL;
+static db_write_op_t *queue_tail = NULL;
+static int queue_length = 0;
+static int queue_waiters = 0;       // Queued writes whose submitter is blocked on the future
+static bool stop_requested = false;
+
+static uint64_t stat_commits = 0;
+static uint64_t stat_writes = 0;
+
+static metrics_histogram_t write_time;      // Execution of one write
+static metrics_histogram_t commit_time;     // COMMIT of a batch, including the fsync
+
+static void future_put(db_write_future_t *future) {
+    pthread_mutex_lock(&future->lock);
+    bool last = --future->refs == 0;
+    pthread_mutex_unlock(&future->lock);
+
+    if (last) {
+        pthread_cond_destroy(&future->cond);
+        pthread_mutex_destroy(&future->lock);
+        free(future);
+    }
+}
+
+static void future_complete(db_write_future_t *future, int result, uint64_t row_id) {
+    pthread_mutex_lock(&future->lock);
+    future->result = result;
+    future->row_id = row_id;
+    future->done = true;
+    pthread_cond_broadcast(&future->cond);
+    pthread_mutex_unlock(&future->lock);
+    future_put(future);
+}
+
+/**
+ * Run a statement without parameters on the writer connection
+ */
+static int exec_cached(sqlite3 *db, const char *sql) {
+    sqlite3_stmt *stmt;
+    int rc = db_prepare_cached(db, sql, &stmt);
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+    rc = sqlite3_step(stmt);
+    db_release_statement(stmt);
+    return rc == SQLITE_DONE || rc == SQLITE_ROW ? SQLITE_OK : rc;
+}
+
+/**
+ * Execute and commit a list of writes in one transaction
+ */
+static void run_batch(db_write_op_t *batch) {
+    pthread_mutex_t *db_mutex = get_db_mutex();
+    sqlite3 *db = get_db_handle();
+    int count = 0;
+    bool committed = false;
+
+    pthread_mutex_lock(db_mutex);
+
+    bool in_transaction = db && exec_cached(db, "BEGIN IMMEDIATE;") == SQLITE_OK;
+    if (db && !in_transaction) {
+        log_error("Failed to begin write transaction: %s", sqlite3_errmsg(db));
+    }
+
+    for (db_write_op_t *op = batch; op; op = op->next) {
+        op->row_id = 0;
+        if (!in_transaction) {
+            op->result = -1;
+            continue;
+        }
+
+        // One savepoint per write: a failed write is rolled back alone
+        if (exec_cached(db, "SAVEPOINT db_write;") != SQLITE_OK) {
+            op->result = -1;
+            continue;
+        }
+        uint64_t start_us = metrics_now_us();
+        op->result = op->ops.execute(db, op->arg, &op->row_id);
+        metrics_histogram_observe(write_time, metrics_now_us() - start_us);
+        if (op->result != 0) {
+            exec_cached(db, "ROLLBACK TO db_write;");
+        }
+        exec_cached(db, "RELEASE db_write;");
+        count++;
+    }
+
+    uint64_t commit_start_us = metrics_now_us();
+    if (in_transaction && exec_cached(db, "COMMIT;") != SQLITE_OK) {
+        log_error("Failed to commit %d writes: %s", count, sqlite3_errmsg(db));
+        exec_cached(db, "ROLLBACK;");
+        for (db_write_op_t *op = batch; op; op = op->next) {
+            op->result = -1;
+        }
+    } else if (in_transaction) {
+        committed = true;
+        metrics_histogram_observe(commit_time, metrics_now_us() - commit_start_us);
+    }
+
+    pthread_mutex_unlock(db_mutex);
+
+    if (committed) {
+        pthread_mutex_lock(&queue_mutex);
+        stat_commits++;
+        stat_writes += count;
+        pthread_mutex_unlock(&queue_mutex);
+    }
+
+    while (batch) {
+        db_write_op_t *op = batch;
+        batch = op->next;
+
+        if (op->result == 0 && op->ops.committed) {
+            op->ops.committed(op->arg, op->row_id);
+        }
+        if (op->future) {
+            future_complete(op->future, op->result, op->row_id);
+        }
+        if (op->ops.free_arg) {
+            op->ops.free_arg(op->arg);
+        }
+        free(op);
+    }
+}
+
+static void *writer_thread_func(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&queue_mutex);
+    for (;;) {
+        while (!queue_head && !stop_requested) {
+            pthread_cond_wait(&queue_cond, &queue_mutex);
+        }
+        if (!queue_head) {
+            break;
+        }
+
+        // Give writes from other streams a chance to share the commit, unless a
+        // submitter is blocked on it: those commit as soon as the writer is idle
+        if (commit_interval_ms > 0 && !stop_requested && queue_length < batch_size && queue_waiters == 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)commit_interval_ms * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            while (!stop_requested && queue_length < batch_size && queue_waiters == 0) {
+                if (pthread_cond_timedwait(&queue_cond, &queue_mutex, &deadline) == ETIMEDOUT) {
+                    break;
+                }
+            }
+        }
+
+        // Detach up to batch_size writes
+        db_write_op_t *batch = queue_head;
+        db_write_op_t *last = queue_head;
+        int taken = 1;
+        while (last->next && taken < batch_size) {
+            last = last->next;
+            taken++;
+        }
+        queue_head = last->next;
+        if (!queue_head) {
+            queue_tail = NULL;
+        }
+        last->next = NULL;
+
+        // Waits starting from now find the write already taken
+        int waiters = 0;
+        for (db_write_op_t *op = batch; op; op = op->next) {
+            if (op->future) {
+                op->future->queued = false;
+                waiters += op->future->waited ? 1 : 0;
+            }
+        }
+        queue_length -= taken;
+        queue_waiters -= waiters;
+        pthread_cond_broadcast(&space_cond);
+
+        pthread_mutex_unlock(&queue_mutex);
+        run_batch(batch);
+        pthread_mutex_lock(&queue_mutex);
+    }
+    pthread_mutex_unlock(&queue_mutex);
+
+    return NULL;
+}
+
+void db_writer_configure(int interval_ms, int max_batch, const char *synchronous) {
+    commit_interval_ms = interval_ms < 0 ? 0 : interval_ms;
+    batch_size = max_batch < 1 ? 1 : max_batch;
+    if (synchronous && synchronous[0]) {
+        strncpy(synchronous_mode, synchronous, sizeof(synchronous_mode) - 1);
+        synchronous_mode[sizeof(synchronous_mode) - 1] = '\0';
+    }
+}
+
+int db_writer_init(sqlite3 *db) {
+    if (!db) {
+        return -1;
+    }
+
+    // Durability of each commit; NORMAL in WAL mode only risks the last commits on power loss
+    const char *modes[] = {"off", "normal", "full", "extra"};
+    const char *mode = NULL;
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (strcasecmp(synchronous_mode, modes[i]) == 0) {
+            mode = modes[i];
+        }
+    }
+    if (mode) {
+        char sql[64];
+        snprintf(sql, sizeof(sql), "PRAGMA synchronous=%s;", mode);
+        if (sqlite3_exec(db, sql, NULL, NULL, NULL) != SQLITE_OK) {
+            log_warn("Failed to set synchronous mode %s: %s", mode, sqlite3_errmsg(db));
+        }
+    } else {
+        log_warn("Unknown synchronous mode '%s', keeping the default", synchronous_mode);
+    }
+
+    write_time = metrics_histogram("lightnvr_db_write_seconds",
+                                   "Time to execute one queued write", NULL);
+    commit_time = metrics_histogram("lightnvr_db_commit_seconds",
+                                    "Time to commit a batch of writes", NULL);
+
+    pthread_mutex_lock(&queue_mutex);
+    if (writer_running) {
+        pthread_mutex_unlock(&queue_mutex);
+        return 0;
+    }
+    stop_requested = false;
+    if (pthread_create(&writer_thread, NULL, writer_thread_func, NULL) != 0) {
+        log_error("Failed to start database writer thread, writes will commit one by one");
+        pthread_mutex_unlock(&queue_mutex);
+        return -1;
+    }
+    writer_running = true;
+    pthread_mutex_unlock(&queue_mutex);
+
+    log_info("Database writer started (commit interval %d ms, up to %d writes per commit, synchronous=%s)",
+             commit_interval_ms, batch_size, mode ? mode : "default");
+    return 0;
+}
+
+void db_writer_shutdown(void) {
+    pthread_mutex_lock(&queue_mutex);
+    if (!writer_running) {
+        pthread_mutex_unlock(&queue_mutex);
+        return;
+    }
+    stop_requested = true;
+    pthread_cond_broadcast(&queue_cond);
+    pthread_cond_broadcast(&space_cond);
+    pthread_mutex_unlock(&queue_mutex);
+
+    // The thread commits what is still queued before exiting
+    pthread_join(writer_thread, NULL);
+
+    pthread_mutex_lock(&queue_mutex);
+    writer_running = false;
+    pthread_cond_broadcast(&space_cond);
+    pthread_mutex_unlock(&queue_mutex);
+
+    log_info("Database writer stopped after %llu commits of %llu writes",
+             (unsigned long long)stat_commits, (unsigned long long)stat_writes);
+}
+
+int db_writer_submit(const db_write_ops_t *ops, void *arg, db_write_future_t **future) {
+    if (future) {
+        *future = NULL;
+    }
+    if (!ops || !ops->execute) {
+        return -1;
+    }
+
+    db_write_op_t *op = calloc(1, sizeof(db_write_op_t));
+    db_write_future_t *f = NULL;
+    if (op && future) {
+        f = calloc(1, sizeof(db_write_future_t));
+        if (f) {
+            pthread_mutex_init(&f->lock, NULL);
+            pthread_cond_init(&f->cond, NULL);
+            f->refs = 2;
+        }
+    }
+    if (!op || (future && !f)) {
+        log_error("Failed to allocate memory for database write");
+        free(op);
+        free(f);
+        if (ops->free_arg) {
+            ops->free_arg(arg);
+        }
+        return -1;
+    }
+
+    op->ops = *ops;
+    op->arg = arg;
+    op->future = f;
+
+    pthread_mutex_lock(&queue_mutex);
+    while (writer_running && !stop_requested && queue_length >= DB_WRITER_QUEUE_LIMIT) {
+        pthread_cond_wait(&space_cond, &queue_mutex);
+    }
+
+    if (writer_running && !stop_requested) {
+        if (queue_tail) {
+            queue_tail->next = op;
+        } else {
+            queue_head = op;
+        }
+        queue_tail = op;
+        queue_length++;
+        if (f) {
+            f->queued = true;
+        }
+        pthread_cond_signal(&queue_cond);
+        pthread_mutex_unlock(&queue_mutex);
+    } else {
+        // No writer thread (not started yet or shutting down): commit right away
+        pthread_mutex_unlock(&queue_mutex);
+        run_batch(op);
+    }
+
+    if (future) {
+        *future = f;
+    }
+    return 0;
+}
+
+int db_write_future_wait(db_write_future_t *future, uint64_t *row_id) {
+    if (!future) {
+        return -1;
+    }
+
+    // A blocked submitter cuts the commit interval short
+    pthread_mutex_lock(&queue_mutex);
+    if (future->queued && !future->waited) {
+        future->waited = true;
+        queue_waiters++;
+        pthread_cond_signal(&queue_cond);
+    }
+    pthread_mutex_unlock(&queue_mutex);
+
+    pthread_mutex_lock(&future->lock);
+    while (!future->done) {
+        pthread_cond_wait(&future->cond, &future->lock);
+    }
+    int result = future->result;
+    if (row_id) {
+        *row_id = future->row_id;
+    }
+    pthread_mutex_unlock(&future->lock);
+
+    future_put(future);
+    return result;
+}
+
+void db_write_future_release(db_write_future_t *future) {
+    if (future) {
+        future_put(future);
+    }
+}
+
+void db_writer_get_stats(uint64_t *commits, uint64_t *writes, int *queued) {
+    pthread_mutex_lock(&queue_mutex);
+    if (commits) {
+        *commits = stat_commits;
+    }
+    if (writes) {
+        *writes = stat_writes;
+    }
+    if (queued) {
+        *queued = queue_length;
+    }
+    pthread_mutex_unlock(&queue_mutex);
+}
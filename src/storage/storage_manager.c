@@ -11,13 +11,20 @@
 #include <pthread.h>
 
 #include "storage/storage_manager.h"
+#include "database/db_recordings.h"
+#include "database/db_streams.h"
+#include "database/db_timeline_rollups.h"
 #include "core/logger.h"
 
+// Number of recordings deleted per database round trip by the retention policy
+#define RETENTION_BATCH_SIZE 100
+
 // Storage manager state
 static struct {
     char storage_path[256];
     uint64_t max_size;
     int retention_days;
+    int detection_retention_days;
     bool auto_delete_oldest;
     uint64_t total_space;
     uint64_t used_space;
@@ -26,6 +33,7 @@ static struct {
     .storage_path = "",
     .max_size = 0,
     .retention_days = 30,
+    .detection_retention_days = 0,
     .auto_delete_oldest = true,
     .total_space = 0,
     .used_space = 0,
@@ -121,69 +129,19 @@ int get_storage_stats(storage_stats_t *stats) {
     stats->used_space = stats->total_space - stats->free_space;
     stats->reserved_space = storage_manager.reserved_space;
     
-    // Scan the storage directory to get recording statistics
-    DIR *dir = opendir(storage_manager.storage_path);
-    if (dir) {
-        struct dirent *entry;
-        stats->total_recordings = 0;
-        stats->total_recording_bytes = 0;
-        stats->oldest_recording_time = UINT64_MAX;
-        stats->newest_recording_time = 0;
-        
-        while ((entry = readdir(dir)) != NULL) {
-            // Skip . and ..
-            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-                continue;
-            }
-            
-            // Check if it's a directory (stream directory)
-            char path[512];
-            snprintf(path, sizeof(path), "%s/%s", storage_manager.storage_path, entry->d_name);
-            
-            struct stat st;
-            if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
-                // Scan stream directory for recordings
-                DIR *stream_dir = opendir(path);
-                if (stream_dir) {
-                    struct dirent *rec_entry;
-                    
-                    while ((rec_entry = readdir(stream_dir)) != NULL) {
-                        // Skip . and ..
-                        if (strcmp(rec_entry->d_name, ".") == 0 || strcmp(rec_entry->d_name, "..") == 0) {
-                            continue;
-                        }
-                        
-                        // Check if it's a file
-                        char rec_path[768];
-                        snprintf(rec_path, sizeof(rec_path), "%s/%s", path, rec_entry->d_name);
-                        
-                        struct stat rec_st;
-                        if (stat(rec_path, &rec_st) == 0 && S_ISREG(rec_st.st_mode)) {
-                            // Count recording and add size
-                            stats->total_recordings++;
-                            stats->total_recording_bytes += rec_st.st_size;
-                            
-                            // Update oldest/newest recording time
-                            if (rec_st.st_mtime < stats->oldest_recording_time) {
-                                stats->oldest_recording_time = rec_st.st_mtime;
-                            }
-                            if (rec_st.st_mtime > stats->newest_recording_time) {
-                                stats->newest_recording_time = rec_st.st_mtime;
-                            }
-                        }
-                    }
-                    
-                    closedir(stream_dir);
-                }
-            }
-        }
-        
-        closedir(dir);
-        
-        // If no recordings found, reset timestamps
-        if (stats->oldest_recording_time == UINT64_MAX) {
-            stats->oldest_recording_time = 0;
-        }
+    // Recording statistics come from the running totals in the database
+    uint64_t total_bytes = 0;
+    uint64_t total_count = 0;
+    if (get_recording_usage_totals(&total_bytes, &total_count) == 0) {
+        stats->total_recordings = total_count;
+        stats->total_recording_bytes = total_bytes;
+    }
+
+    time_t oldest = 0;
+    time_t newest = 0;
+    if (get_recording_time_range(&oldest, &newest) == 0) {
+        stats->oldest_recording_time = (uint64_t)oldest;
+        stats->newest_recording_time = (uint64_t)newest;
     }
     
     return 0;
@@ -222,165 +180,215 @@ int delete_recording(const char *path) {
     return 0;
 }
 
+/**
+ * Delete a batch of recordings: files first, then their metadata rows
+ *
+ * @return Number of recordings deleted, or -1 on error
+ */
+static int delete_recording_batch(const recording_metadata_t *recordings, int count, uint64_t *freed_space) {
+    uint64_t ids[RETENTION_BATCH_SIZE];
+    int id_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (unlink(recordings[i].file_path) != 0 && errno != ENOENT) {
+            log_error("Failed to delete recording: %s (error: %s)",
+                     recordings[i].file_path, strerror(errno));
+            continue;
+        }
+
+        log_debug("Deleted recording: %s", recordings[i].file_path);
+        ids[id_count++] = recordings[i].id;
+        *freed_space += recordings[i].size_bytes;
+    }
+
+    if (id_count > 0 && delete_recording_metadata_batch(ids, id_count) < 0) {
+        return -1;
+    }
+
+    return id_count;
+}
+
+/**
+ * Delete the oldest eligible recordings of a stream (or of all streams)
+ *
+ * @param stream_name Stream to purge, or NULL for all streams
+ * @param before Only recordings that started before this time (0 for no limit)
+ * @param detection_before Cutoff for recordings with detections (0 for no limit)
+ * @param bytes_needed Stop once this many bytes were freed (0 to delete everything eligible)
+ * @param batch Scratch array of RETENTION_BATCH_SIZE entries
+ * @param freed_space Incremented by the bytes freed
+ * @return Number of recordings deleted
+ */
+static int purge_recordings(const char *stream_name, time_t before, time_t detection_before,
+                            uint64_t bytes_needed, recording_metadata_t *batch, uint64_t *freed_space) {
+    int deleted_count = 0;
+    uint64_t freed = 0;
+
+    for (;;) {
+        int count = get_recordings_for_retention(stream_name, before, detection_before,
+                                                 batch, RETENTION_BATCH_SIZE);
+        if (count <= 0) {
+            break;
+        }
+
+        // Only take as many recordings as needed
+        if (bytes_needed > 0) {
+            uint64_t batch_bytes = 0;
+            int needed = 0;
+            while (needed < count && freed + batch_bytes < bytes_needed) {
+                batch_bytes += batch[needed++].size_bytes;
+            }
+            count = needed;
+        }
+
+        uint64_t batch_freed = 0;
+        int deleted = delete_recording_batch(batch, count, &batch_freed);
+        if (deleted <= 0) {
+            break;
+        }
+
+        deleted_count += deleted;
+        freed += batch_freed;
+
+        if (bytes_needed > 0 && freed >= bytes_needed) {
+            break;
+        }
+    }
+
+    *freed_space += freed;
+    return deleted_count;
+}
+
+/**
+ * Find the storage policy of a stream in a list
+ */
+static const stream_storage_policy_t *find_policy(const stream_storage_policy_t *policies, int count,
+                                                  const char *stream_name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(policies[i].stream_name, stream_name) == 0) {
+            return &policies[i];
+        }
+    }
+    return NULL;
+}
+
 // Apply retention policy
 int apply_retention_policy(void) {
-    log_info("Applying retention policy (max size: %lu bytes, retention days: %d)", 
-             storage_manager.max_size, storage_manager.retention_days);
-    
-    // Get current storage stats
-    storage_stats_t stats;
-    if (get_storage_stats(&stats) != 0) {
-        log_error("Failed to get storage statistics");
+    log_info("Applying retention policy (max size: %lu bytes, retention days: %d, detection retention days: %d)",
+             storage_manager.max_size, storage_manager.retention_days,
+             storage_manager.detection_retention_days);
+
+    recording_metadata_t *batch = calloc(RETENTION_BATCH_SIZE, sizeof(recording_metadata_t));
+    stream_storage_policy_t *policies = calloc(MAX_STREAMS, sizeof(stream_storage_policy_t));
+    stream_recording_usage_t *usage = calloc(RECORDING_USAGE_MAX_STREAMS, sizeof(stream_recording_usage_t));
+    if (!batch || !policies || !usage) {
+        log_error("Memory allocation failed for retention policy");
+        free(batch);
+        free(policies);
+        free(usage);
         return -1;
     }
-    
-    // Check if we need to apply retention policy
-    bool need_cleanup_size = (storage_manager.max_size > 0 && stats.used_space > storage_manager.max_size);
-    bool need_cleanup_days = (storage_manager.retention_days > 0);
-    
-    if (!need_cleanup_size && !need_cleanup_days) {
-        log_debug("No retention policy to apply");
-        return 0;
-    }
-    
-    // Calculate cutoff time for retention days
-    time_t now = time(NULL);
-    time_t cutoff_time = now - (storage_manager.retention_days * 86400); // 86400 seconds in a day
-    
+
     // Track deleted files
     int deleted_count = 0;
     uint64_t freed_space = 0;
-    
-    // Scan the storage directory
-    DIR *dir = opendir(storage_manager.storage_path);
-    if (!dir) {
-        log_error("Failed to open storage directory: %s", strerror(errno));
-        return -1;
+    time_t now = time(NULL);
+
+    int policy_count = get_all_stream_storage_policies(policies, MAX_STREAMS);
+    if (policy_count < 0) {
+        policy_count = 0;
     }
-    
-    // First pass: collect all recording files with their timestamps and sizes
-    typedef struct {
-        char path[768];
-        time_t mtime;
-        off_t size;
-    } recording_file_t;
-    
-    recording_file_t *files = NULL;
-    int file_count = 0;
-    int file_capacity = 0;
-    
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip . and ..
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
+
+    // Age limits and quotas per stream, using the running usage instead of the filesystem
+    int usage_count = get_stream_recording_usage(usage, RECORDING_USAGE_MAX_STREAMS);
+    for (int i = 0; i < usage_count; i++) {
+        const stream_storage_policy_t *policy = find_policy(policies, policy_count, usage[i].stream_name);
+
+        int days = storage_manager.retention_days;
+        int detection_days = storage_manager.detection_retention_days;
+        if (policy && policy->retention_days > 0) {
+            days = policy->retention_days;
         }
-        
-        // Check if it's a directory (stream directory)
-        char stream_path[512];
-        snprintf(stream_path, sizeof(stream_path), "%s/%s", storage_manager.storage_path, entry->d_name);
-        
-        struct stat st;
-        if (stat(stream_path, &st) == 0 && S_ISDIR(st.st_mode)) {
-            // Scan stream directory for recordings
-            DIR *stream_dir = opendir(stream_path);
-            if (stream_dir) {
-                struct dirent *rec_entry;
-                
-                while ((rec_entry = readdir(stream_dir)) != NULL) {
-                    // Skip . and ..
-                    if (strcmp(rec_entry->d_name, ".") == 0 || strcmp(rec_entry->d_name, "..") == 0) {
-                        continue;
-                    }
-                    
-                    // Check if it's a file
-                    char rec_path[768];
-                    snprintf(rec_path, sizeof(rec_path), "%s/%s", stream_path, rec_entry->d_name);
-                    
-                    struct stat rec_st;
-                    if (stat(rec_path, &rec_st) == 0 && S_ISREG(rec_st.st_mode)) {
-                        // Check if file is older than retention days
-                        if (need_cleanup_days && rec_st.st_mtime < cutoff_time) {
-                            // Delete file directly if it's older than retention days
-                            if (unlink(rec_path) == 0) {
-                                log_debug("Deleted old recording: %s (age: %ld days)", 
-                                         rec_path, (now - rec_st.st_mtime) / 86400);
-                                deleted_count++;
-                                freed_space += rec_st.st_size;
-                            } else {
-                                log_error("Failed to delete old recording: %s (error: %s)", 
-                                         rec_path, strerror(errno));
-                            }
-                        } else if (need_cleanup_size) {
-                            // Add to files array for size-based cleanup
-                            if (file_count >= file_capacity) {
-                                file_capacity = file_capacity == 0 ? 1000 : file_capacity * 2;
-                                recording_file_t *new_files = realloc(files, file_capacity * sizeof(recording_file_t));
-                                if (!new_files) {
-                                    log_error("Memory allocation failed for recording files array");
-                                    free(files);
-                                    closedir(stream_dir);
-                                    closedir(dir);
-                                    return -1;
-                                }
-                                files = new_files;
-                            }
-                            
-                            strncpy(files[file_count].path, rec_path, sizeof(files[file_count].path) - 1);
-                            files[file_count].path[sizeof(files[file_count].path) - 1] = '\0';
-                            files[file_count].mtime = rec_st.st_mtime;
-                            files[file_count].size = rec_st.st_size;
-                            file_count++;
-                        }
-                    }
-                }
-                
-                closedir(stream_dir);
+        if (policy && policy->detection_retention_days > 0) {
+            detection_days = policy->detection_retention_days;
+        }
+
+        if (days > 0) {
+            time_t cutoff_time = now - (days * 86400); // 86400 seconds in a day
+            time_t detection_cutoff = cutoff_time;
+            if (detection_days > days) {
+                detection_cutoff = now - (detection_days * 86400);
             }
+
+            uint64_t stream_freed = 0;
+            deleted_count += purge_recordings(usage[i].stream_name, cutoff_time, detection_cutoff,
+                                              0, batch, &stream_freed);
+            freed_space += stream_freed;
+            usage[i].total_bytes = usage[i].total_bytes > stream_freed ? usage[i].total_bytes - stream_freed : 0;
+
+            // Nothing is kept before the longer of the two limits
+            prune_timeline_rollups(usage[i].stream_name, detection_cutoff);
+        }
+
+        if (policy && policy->max_storage_bytes > 0 && usage[i].total_bytes > policy->max_storage_bytes) {
+            uint64_t excess = usage[i].total_bytes - policy->max_storage_bytes;
+            log_info("Stream %s is %lu bytes over its storage quota", usage[i].stream_name, excess);
+            deleted_count += purge_recordings(usage[i].stream_name, 0, 0, excess, batch, &freed_space);
         }
     }
-    
-    closedir(dir);
-    
-    // If we need to clean up by size and we still have too much used space
-    if (need_cleanup_size && stats.used_space - freed_space > storage_manager.max_size && file_count > 0) {
-        log_info("Need to free more space: %lu bytes over limit", 
-                (stats.used_space - freed_space) - storage_manager.max_size);
-        
-        // Sort files by modification time (oldest first)
-        for (int i = 0; i < file_count - 1; i++) {
-            for (int j = 0; j < file_count - i - 1; j++) {
-                if (files[j].mtime > files[j + 1].mtime) {
-                    recording_file_t temp = files[j];
-                    files[j] = files[j + 1];
-                    files[j + 1] = temp;
+
+    // Global size limit: take from the stream using the most space first, so
+    // every stream keeps a fair share
+    if (storage_manager.max_size > 0) {
+        for (;;) {
+            usage_count = get_stream_recording_usage(usage, RECORDING_USAGE_MAX_STREAMS);
+            if (usage_count <= 0) {
+                break;
+            }
+
+            uint64_t used = 0;
+            int largest = 0;
+            for (int i = 0; i < usage_count; i++) {
+                used += usage[i].total_bytes;
+                if (usage[i].total_bytes > usage[largest].total_bytes) {
+                    largest = i;
                 }
             }
-        }
-        
-        // Delete oldest files until we're under the limit
-        for (int i = 0; i < file_count; i++) {
-            if (stats.used_space - freed_space <= storage_manager.max_size) {
+
+            if (used <= storage_manager.max_size) {
                 break;
             }
-            
-            if (unlink(files[i].path) == 0) {
-                log_debug("Deleted recording to free space: %s", files[i].path);
-                deleted_count++;
-                freed_space += files[i].size;
-            } else {
-                log_error("Failed to delete recording: %s (error: %s)", 
-                         files[i].path, strerror(errno));
+
+            uint64_t excess = used - storage_manager.max_size;
+            log_info("Need to free more space: %lu bytes over limit", excess);
+
+            // Free the excess, but at most enough to bring the largest stream level with the next one
+            uint64_t second = 0;
+            for (int i = 0; i < usage_count; i++) {
+                if (i != largest && usage[i].total_bytes > second) {
+                    second = usage[i].total_bytes;
+                }
+            }
+            uint64_t to_free = usage[largest].total_bytes - second;
+            if (to_free == 0 || to_free > excess) {
+                to_free = excess;
+            }
+
+            int deleted = purge_recordings(usage[largest].stream_name, 0, 0, to_free, batch, &freed_space);
+            if (deleted <= 0) {
+                break;
             }
+            deleted_count += deleted;
         }
     }
-    
-    // Free memory
-    free(files);
-    
+
+    free(batch);
+    free(policies);
+    free(usage);
+
     log_info("Retention policy applied: deleted %d files, freed %lu bytes", 
              deleted_count, freed_space);
-    
+
     return deleted_count;
 }
 
@@ -400,6 +408,16 @@ int set_retention_days(int days) {
     return 0;
 }
 
+// Set retention days for recordings with detections
+int set_detection_retention_days(int days) {
+    if (days < 0) {
+        return -1;
+    }
+    
+    storage_manager.detection_retention_days = days;
+    return 0;
+}
+
 // Check if storage is available
 bool is_storage_available(void) {
     struct stat st;
@@ -6,13 +6,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#include <unistd.h>
-#include <errno.h>
 
 #include "storage/storage_manager.h"
+#include "database/db_recordings.h"
+#include "database/db_streams.h"
 #include "core/logger.h"
 #include "core/config.h"
 #include "../../external/cjson/cJSON.h"
@@ -24,91 +21,46 @@ typedef struct {
     char name[64];
     uint64_t size_bytes;
     int recording_count;
+    uint64_t quota_bytes;
 } stream_storage_info_t;
 
 /**
  * Get storage usage per stream
  * 
- * @param storage_path Base storage path
+ * Reads the running per-stream totals that the database keeps up to date as
+ * recordings are finalized and deleted, so no files are examined.
+ * 
  * @param stream_info Array to fill with stream storage information
  * @param max_streams Maximum number of streams to return
  * @return Number of streams found, or -1 on error
  */
-int get_stream_storage_usage(const char *storage_path, stream_storage_info_t *stream_info, int max_streams) {
-    if (!storage_path || !stream_info || max_streams <= 0) {
+int get_stream_storage_usage(stream_storage_info_t *stream_info, int max_streams) {
+    if (!stream_info || max_streams <= 0) {
         log_error("Invalid parameters for get_stream_storage_usage");
         return -1;
     }
     
-    // Based on user feedback, the recordings are in /var/lib/lightnvr/recordings/mp4/[stream_name]/
-    // Construct the mp4 directory path
-    char mp4_path[512];
-    snprintf(mp4_path, sizeof(mp4_path), "%s/mp4", storage_path);
-    
-    // Open the mp4 directory
-    DIR *dir = opendir(mp4_path);
-    if (!dir) {
-        log_error("Failed to open mp4 directory: %s (error: %s)", mp4_path, strerror(errno));
+    stream_recording_usage_t *usage = calloc(max_streams, sizeof(stream_recording_usage_t));
+    if (!usage) {
+        log_error("Failed to allocate memory for stream storage usage");
         return -1;
     }
     
-    // Initialize stream count
-    int stream_count = 0;
-    
-    // Iterate through directory entries (stream directories)
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL && stream_count < max_streams) {
-        // Skip . and ..
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-        
-        // Check if it's a directory (stream directory)
-        char stream_path[512];
-        snprintf(stream_path, sizeof(stream_path), "%s/%s", mp4_path, entry->d_name);
+    int stream_count = get_stream_recording_usage(usage, max_streams);
+    for (int i = 0; i < stream_count; i++) {
+        strncpy(stream_info[i].name, usage[i].stream_name, sizeof(stream_info[i].name) - 1);
+        stream_info[i].name[sizeof(stream_info[i].name) - 1] = '\0';
+        stream_info[i].size_bytes = usage[i].total_bytes;
+        stream_info[i].recording_count = (int)usage[i].recording_count;
         
-        struct stat st;
-        if (stat(stream_path, &st) == 0 && S_ISDIR(st.st_mode)) {
-            // Initialize stream info
-            strncpy(stream_info[stream_count].name, entry->d_name, sizeof(stream_info[stream_count].name) - 1);
-            stream_info[stream_count].name[sizeof(stream_info[stream_count].name) - 1] = '\0';
-            stream_info[stream_count].size_bytes = 0;
-            stream_info[stream_count].recording_count = 0;
-            
-            // Get size of all files in the stream directory
-            DIR *stream_dir = opendir(stream_path);
-            if (stream_dir) {
-                struct dirent *file_entry;
-                
-                while ((file_entry = readdir(stream_dir)) != NULL) {
-                    // Skip . and ..
-                    if (strcmp(file_entry->d_name, ".") == 0 || strcmp(file_entry->d_name, "..") == 0) {
-                        continue;
-                    }
-                    
-                    // Check if it's a file
-                    char file_path[768];
-                    snprintf(file_path, sizeof(file_path), "%s/%s", stream_path, file_entry->d_name);
-                    
-                    struct stat file_st;
-                    if (stat(file_path, &file_st) == 0 && S_ISREG(file_st.st_mode)) {
-                        // Add file size to stream size
-                        stream_info[stream_count].size_bytes += file_st.st_size;
-                        stream_info[stream_count].recording_count++;
-                    }
-                }
-                
-                closedir(stream_dir);
-            }
-            
-            // Only include streams that have recordings
-            if (stream_info[stream_count].recording_count > 0) {
-                stream_count++;
-            }
+        stream_storage_policy_t policy;
+        stream_info[i].quota_bytes = 0;
+        if (get_stream_storage_policy(usage[i].stream_name, &policy) == 0) {
+            stream_info[i].quota_bytes = policy.max_storage_bytes;
         }
     }
     
-    closedir(dir);
+    free(usage);
     return stream_count;
 }
 
@@ -124,53 +76,15 @@ int get_all_stream_storage_usage(stream_storage_info_t **stream_info) {
         return -1;
     }
     
-    // Get storage path from config
-    const char *storage_path = g_config.storage_path;
-    if (!storage_path || storage_path[0] == '\0') {
-        log_error("Storage path not configured");
-        return -1;
-    }
-    
-    // Construct the mp4 directory path
-    char mp4_path[512];
-    snprintf(mp4_path, sizeof(mp4_path), "%s/mp4", storage_path);
-    
-    // First, count the number of stream directories in the mp4 directory
-    DIR *dir = opendir(mp4_path);
-    if (!dir) {
-        log_error("Failed to open mp4 directory: %s (error: %s)", mp4_path, strerror(errno));
-        return -1;
-    }
-    
-    int stream_count = 0;
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip . and ..
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-        
-        // Check if it's a directory (stream directory)
-        char stream_path[512];
-        snprintf(stream_path, sizeof(stream_path), "%s/%s", mp4_path, entry->d_name);
-        
-        struct stat st;
-        if (stat(stream_path, &st) == 0 && S_ISDIR(st.st_mode)) {
-            stream_count++;
-        }
-    }
-    
-    closedir(dir);
-    
     // Allocate memory for stream info array
-    *stream_info = (stream_storage_info_t *)malloc(stream_count * sizeof(stream_storage_info_t));
+    *stream_info = (stream_storage_info_t *)calloc(RECORDING_USAGE_MAX_STREAMS, sizeof(stream_storage_info_t));
     if (!*stream_info) {
         log_error("Failed to allocate memory for stream storage info");
         return -1;
     }
     
     // Get stream storage usage
-    int actual_count = get_stream_storage_usage(storage_path, *stream_info, stream_count);
+    int actual_count = get_stream_storage_usage(*stream_info, RECORDING_USAGE_MAX_STREAMS);
     
     // If no streams found, free memory
     if (actual_count <= 0) {
@@ -218,6 +132,7 @@ int add_stream_storage_usage_to_json(cJSON *json_obj) {
             cJSON_AddStringToObject(stream_obj, "name", stream_info[i].name);
             cJSON_AddNumberToObject(stream_obj, "size", stream_info[i].size_bytes);
             cJSON_AddNumberToObject(stream_obj, "count", stream_info[i].recording_count);
+            cJSON_AddNumberToObject(stream_obj, "quota", stream_info[i].quota_bytes);
             
             cJSON_AddItemToArray(stream_storage_array, stream_obj);
         }
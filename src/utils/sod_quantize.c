@@ -0,0 +1,244 @@
+/**
+ * @file sod_quantize.c
+ * @brief Utility to convert a SOD CNN detection model to int8
+ *
+ * The float model is run over a set of representative images to calibrate the
+ * input range of every convolutional layer, then written as an int8 quantized
+ * model (*.q8.sod). The quantized model is loaded back and compared with the
+ * float model on the same images: detection agreement, score drift and
+ * forward pass latency are reported.
+ *
+ * Usage: sod_quantize <arch> <weights.sod> <output.q8.sod> <image> [image...]
+ *
+ * <arch> is a SOD architecture keyword (":face", ":voc", ...) or the path of a
+ * network configuration file, as given to sod_cnn_create().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sod/sod.h"
+
+// Detection threshold used for the comparison, the lightNVR default
+#define REPORT_THRESHOLD 0.3f
+
+// Minimum overlap of a float and an int8 box to count as the same detection
+#define MATCH_IOU 0.5f
+
+typedef struct {
+    int images;
+    int float_boxes;
+    int int8_boxes;
+    int matched;
+    double score_delta;
+    double float_ms;
+    double int8_ms;
+} quantize_report_t;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static float box_iou(const sod_box *a, const sod_box *b) {
+    int x1 = a->x > b->x ? a->x : b->x;
+    int y1 = a->y > b->y ? a->y : b->y;
+    int x2 = (a->x + a->w) < (b->x + b->w) ? (a->x + a->w) : (b->x + b->w);
+    int y2 = (a->y + a->h) < (b->y + b->h) ? (a->y + a->h) : (b->y + b->h);
+
+    if (x2 <= x1 || y2 <= y1) {
+        return 0.0f;
+    }
+    float inter = (float)(x2 - x1) * (y2 - y1);
+    float uni = (float)a->w * a->h + (float)b->w * b->h - inter;
+    return uni > 0 ? inter / uni : 0.0f;
+}
+
+/**
+ * Run one image through a network
+ *
+ * @param net Network
+ * @param img Image
+ * @param boxes Receives a copy of the detections, to be freed by the caller
+ * @param count Receives the number of detections
+ * @param elapsed_ms Accumulates the forward pass time
+ * @return 0 on success, -1 on failure
+ */
+static int run_image(sod_cnn *net, sod_img img, sod_box **boxes, int *count, double *elapsed_ms) {
+    sod_box *found = NULL;
+    int n = 0;
+
+    float *input = sod_cnn_prepare_image(net, img);
+    if (!input) {
+        return -1;
+    }
+
+    double start = now_ms();
+    if (sod_cnn_predict(net, input, &found, &n) != SOD_OK) {
+        return -1;
+    }
+    *elapsed_ms += now_ms() - start;
+
+    *boxes = NULL;
+    *count = n;
+    if (n > 0) {
+        *boxes = malloc(n * sizeof(sod_box));
+        if (!*boxes) {
+            return -1;
+        }
+        memcpy(*boxes, found, n * sizeof(sod_box));
+    }
+    return 0;
+}
+
+/**
+ * Match the int8 detections of an image against the float ones
+ */
+static void compare_boxes(const sod_box *ref, int ref_count, const sod_box *test, int test_count,
+                          quantize_report_t *report) {
+    char *used = calloc(test_count > 0 ? test_count : 1, 1);
+    if (!used) {
+        return;
+    }
+
+    for (int i = 0; i < ref_count; i++) {
+        int best = -1;
+        float best_iou = MATCH_IOU;
+        for (int j = 0; j < test_count; j++) {
+            if (used[j] || strcmp(ref[i].zName ? ref[i].zName : "", test[j].zName ? test[j].zName : "") != 0) {
+                continue;
+            }
+            float iou = box_iou(&ref[i], &test[j]);
+            if (iou >= best_iou) {
+                best_iou = iou;
+                best = j;
+            }
+        }
+        if (best >= 0) {
+            used[best] = 1;
+            report->matched++;
+            report->score_delta += test[best].score > ref[i].score ?
+                                   test[best].score - ref[i].score : ref[i].score - test[best].score;
+        }
+    }
+
+    report->float_boxes += ref_count;
+    report->int8_boxes += test_count;
+    free(used);
+}
+
+int main(int argc, char *argv[]) {
+    const char *err_msg = NULL;
+    sod_cnn *float_net = NULL;
+    sod_cnn *int8_net = NULL;
+    quantize_report_t report;
+    int rc = 1;
+
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <arch> <weights.sod> <output.q8.sod> <image> [image...]\n", argv[0]);
+        fprintf(stderr, "  arch: SOD architecture keyword (:face, :voc, ...) or network config file\n");
+        return 1;
+    }
+
+    const char *arch = argv[1];
+    const char *weights = argv[2];
+    const char *output = argv[3];
+    int image_count = argc - 4;
+    char **images = &argv[4];
+
+    if (sod_cnn_create(&float_net, arch, weights, &err_msg) != SOD_OK) {
+        fprintf(stderr, "Failed to load model %s: %s\n", weights, err_msg ? err_msg : "Unknown error");
+        return 1;
+    }
+    sod_cnn_config(float_net, SOD_CNN_DETECTION_THRESHOLD, REPORT_THRESHOLD);
+
+    // Calibration: record the input range of every convolutional layer
+    int calibrated = 0;
+    for (int i = 0; i < image_count; i++) {
+        sod_img img = sod_img_load_from_file(images[i], SOD_IMG_COLOR);
+        if (!img.data) {
+            fprintf(stderr, "Skipping unreadable image %s\n", images[i]);
+            continue;
+        }
+        float *input = sod_cnn_prepare_image(float_net, img);
+        if (input && sod_cnn_calibrate(float_net, input) == SOD_OK) {
+            calibrated++;
+        }
+        sod_free_image(img);
+    }
+    if (calibrated == 0) {
+        fprintf(stderr, "No image could be used for calibration\n");
+        goto cleanup;
+    }
+    printf("Calibrated on %d of %d images\n", calibrated, image_count);
+
+    int save_rc = sod_cnn_save_quantized(float_net, arch, output);
+    if (save_rc != SOD_OK) {
+        fprintf(stderr, "Failed to write quantized model %s (%s)\n", output,
+                save_rc == SOD_UNSUPPORTED ? "network has layers that cannot be quantized" : "I/O error");
+        goto cleanup;
+    }
+    printf("Wrote quantized model %s\n", output);
+
+    if (sod_cnn_create_quantized(&int8_net, output, 0, &err_msg) != SOD_OK) {
+        fprintf(stderr, "Failed to load quantized model %s: %s\n", output, err_msg ? err_msg : "Unknown error");
+        goto cleanup;
+    }
+    sod_cnn_config(int8_net, SOD_CNN_DETECTION_THRESHOLD, REPORT_THRESHOLD);
+
+    // Accuracy and latency report
+    memset(&report, 0, sizeof(report));
+    printf("\n%-40s %8s %8s %10s %10s\n", "image", "float", "int8", "float ms", "int8 ms");
+    for (int i = 0; i < image_count; i++) {
+        sod_img img = sod_img_load_from_file(images[i], SOD_IMG_COLOR);
+        if (!img.data) {
+            continue;
+        }
+
+        sod_box *float_boxes = NULL, *int8_boxes = NULL;
+        int float_count = 0, int8_count = 0;
+        double float_ms = 0, int8_ms = 0;
+        if (run_image(float_net, img, &float_boxes, &float_count, &float_ms) == 0 &&
+            run_image(int8_net, img, &int8_boxes, &int8_count, &int8_ms) == 0) {
+            compare_boxes(float_boxes, float_count, int8_boxes, int8_count, &report);
+            report.images++;
+            report.float_ms += float_ms;
+            report.int8_ms += int8_ms;
+            printf("%-40.40s %8d %8d %10.1f %10.1f\n", images[i], float_count, int8_count, float_ms, int8_ms);
+        } else {
+            fprintf(stderr, "Detection failed on %s\n", images[i]);
+        }
+
+        free(float_boxes);
+        free(int8_boxes);
+        sod_free_image(img);
+    }
+
+    if (report.images == 0) {
+        fprintf(stderr, "No image could be compared\n");
+        goto cleanup;
+    }
+
+    printf("\nImages compared:      %d\n", report.images);
+    printf("Detections:           %d float, %d int8, %d matched (IoU >= %.2f)\n",
+           report.float_boxes, report.int8_boxes, report.matched, MATCH_IOU);
+    printf("Recall vs float:      %.1f%%\n",
+           report.float_boxes ? 100.0 * report.matched / report.float_boxes : 100.0);
+    printf("Precision vs float:   %.1f%%\n",
+           report.int8_boxes ? 100.0 * report.matched / report.int8_boxes : 100.0);
+    printf("Mean score change:    %.4f\n", report.matched ? report.score_delta / report.matched : 0.0);
+    printf("Mean latency:         %.1f ms float, %.1f ms int8 (%.2fx)\n",
+           report.float_ms / report.images, report.int8_ms / report.images,
+           report.int8_ms > 0 ? report.float_ms / report.int8_ms : 0.0);
+    rc = 0;
+
+cleanup:
+    if (int8_net) {
+        sod_cnn_destroy(int8_net);
+    }
+    sod_cnn_destroy(float_net);
+    return rc;
+}
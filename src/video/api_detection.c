@@ -4,11 +4,15 @@
 #include <stdbool.h>
 #include <errno.h>
 #include <unistd.h>
-#include <sys/stat.h>
 #include <curl/curl.h>
 #include <cJSON.h>
 #include <pthread.h>
 
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+
 #include "core/logger.h"
 #include "core/config.h"
 #include "core/shutdown_coordinator.h"
@@ -18,10 +22,13 @@
 #include "video/stream_state.h"
 #include "database/db_detections.h"
 
-// Global variables
-static bool initialized = false;
-static CURL *curl_handle = NULL;
-static pthread_mutex_t curl_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define API_DETECTION_MAX_INFLIGHT_PER_STREAM 2  // Requests a stream may have outstanding
+#ifndef API_DETECTION_TIMEOUT_MS
+#define API_DETECTION_TIMEOUT_MS 10000           // Whole request, including the upload
+#endif
+#define API_DETECTION_CONNECT_TIMEOUT_MS 3000
+#define API_DETECTION_JPEG_QSCALE 4              // MJPEG quantizer, 2 (best) - 31 (worst)
+#define API_DETECTION_STREAM_SLOTS (MAX_STREAMS + 1) // Slot 0 is shared by unnamed callers
 
 // Structure to hold memory for curl response
 typedef struct {
@@ -29,6 +36,53 @@ typedef struct {
     size_t size;
 } memory_struct_t;
 
+// Per-stream request accounting and JPEG encoder
+typedef struct {
+    char stream_name[MAX_STREAM_NAME];
+    bool in_use;
+    int in_flight;                      // Requests submitted and not yet completed
+
+    pthread_mutex_t encoder_mutex;      // Guards the encoder state below
+    AVCodecContext *encoder;
+    struct SwsContext *sws;
+    AVFrame *frame;
+    AVPacket *packet;
+    int width;
+    int height;
+    enum AVPixelFormat src_format;
+} api_stream_t;
+
+// A request handed to the dispatcher thread
+typedef struct api_request {
+    struct api_request *next;
+    CURL *easy;
+    curl_mime *mime;
+    struct curl_slist *headers;
+    memory_struct_t response;
+    char url[1024];
+    char error[CURL_ERROR_SIZE];
+    CURLcode curl_result;
+    long http_code;
+    bool done;
+    pthread_cond_t done_cond;
+} api_request_t;
+
+// Global variables
+static bool initialized = false;
+static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Dispatcher state; pending requests and completion flags are guarded by queue_mutex
+static CURLM *multi_handle = NULL;
+static pthread_t dispatch_thread;
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static api_request_t *pending_head = NULL;
+static api_request_t *pending_tail = NULL;
+static bool dispatch_running = false;
+
+static api_stream_t api_streams[API_DETECTION_STREAM_SLOTS];
+static pthread_mutex_t streams_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t streams_once = PTHREAD_ONCE_INIT;
+
 // Callback function for curl to write data
 static size_t write_memory_callback(void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
@@ -48,476 +102,504 @@ static size_t write_memory_callback(void *contents, size_t size, size_t nmemb, v
     return realsize;
 }
 
+static void init_stream_slots(void) {
+    for (int i = 0; i < API_DETECTION_STREAM_SLOTS; i++) {
+        pthread_mutex_init(&api_streams[i].encoder_mutex, NULL);
+    }
+}
+
 /**
- * Initialize the API detection system
+ * Free the JPEG encoder of a stream slot
+ * Must be called with slot->encoder_mutex held
  */
-int init_api_detection_system(void) {
-    if (initialized && curl_handle) {
-        log_info("API detection system already initialized");
-        return 0;  // Already initialized and curl handle is valid
+static void free_stream_encoder(api_stream_t *slot) {
+    if (slot->encoder) {
+        avcodec_free_context(&slot->encoder);
     }
-
-    // If we have a curl handle but initialized is false, clean it up first
-    if (curl_handle) {
-        log_warn("API detection system has a curl handle but is marked as uninitialized, cleaning up");
-        curl_easy_cleanup(curl_handle);
-        curl_handle = NULL;
+    if (slot->sws) {
+        sws_freeContext(slot->sws);
+        slot->sws = NULL;
     }
-
-    // Initialize curl
-    CURLcode global_init_result = curl_global_init(CURL_GLOBAL_ALL);
-    if (global_init_result != CURLE_OK) {
-        log_error("Failed to initialize curl global: %s", curl_easy_strerror(global_init_result));
-        return -1;
+    if (slot->frame) {
+        av_frame_free(&slot->frame);
     }
-
-    curl_handle = curl_easy_init();
-    if (!curl_handle) {
-        log_error("Failed to initialize curl handle");
-        curl_global_cleanup();
-        return -1;
+    if (slot->packet) {
+        av_packet_free(&slot->packet);
     }
-
-    initialized = true;
-    log_info("API detection system initialized successfully");
-    return 0;
+    slot->width = 0;
+    slot->height = 0;
 }
 
 /**
- * Shutdown the API detection system
+ * Reserve an in-flight request on the slot of a stream
+ *
+ * @param stream_name Stream name, NULL for the shared slot
+ * @return Slot, or NULL if the stream already has the maximum number of requests in flight
  */
-void shutdown_api_detection_system(void) {
-    // CRITICAL FIX: Always attempt to clean up resources, even if not marked as initialized
-    log_info("Shutting down API detection system (initialized: %s, curl_handle: %p)",
-             initialized ? "yes" : "no", (void*)curl_handle);
+static api_stream_t *acquire_stream_slot(const char *stream_name) {
+    pthread_once(&streams_once, init_stream_slots);
+    pthread_mutex_lock(&streams_mutex);
+
+    api_stream_t *slot = &api_streams[0];
+    if (stream_name && stream_name[0] != '\0') {
+        api_stream_t *free_slot = NULL;
+        slot = NULL;
+        for (int i = 1; i < API_DETECTION_STREAM_SLOTS; i++) {
+            if (api_streams[i].in_use) {
+                if (strcmp(api_streams[i].stream_name, stream_name) == 0) {
+                    slot = &api_streams[i];
+                    break;
+                }
+            } else if (!free_slot) {
+                free_slot = &api_streams[i];
+            }
+        }
 
-    // Cleanup curl handle if it exists
-    if (curl_handle) {
-        log_info("Cleaning up curl handle");
-        curl_easy_cleanup(curl_handle);
-        curl_handle = NULL;
+        if (!slot && free_slot) {
+            slot = free_slot;
+            strncpy(slot->stream_name, stream_name, MAX_STREAM_NAME - 1);
+            slot->stream_name[MAX_STREAM_NAME - 1] = '\0';
+            slot->in_use = true;
+        } else if (!slot) {
+            // More streams than slots, share the unnamed slot
+            slot = &api_streams[0];
+        }
     }
 
-    // Only call global cleanup if we were initialized
-    if (initialized) {
-        log_info("Cleaning up curl global resources");
-        curl_global_cleanup();
+    if (slot->in_flight >= API_DETECTION_MAX_INFLIGHT_PER_STREAM) {
+        pthread_mutex_unlock(&streams_mutex);
+        return NULL;
     }
+    slot->in_flight++;
 
-    initialized = false;
-    log_info("API detection system shutdown complete");
+    pthread_mutex_unlock(&streams_mutex);
+    return slot;
+}
+
+static void release_stream_slot(api_stream_t *slot) {
+    pthread_mutex_lock(&streams_mutex);
+    slot->in_flight--;
+    pthread_mutex_unlock(&streams_mutex);
 }
 
 /**
- * Detect objects using the API
+ * Encode a raw frame to JPEG with the slot's MJPEG encoder
+ *
+ * The encoder and the color conversion are kept open between frames and only
+ * recreated when the frame size or pixel format changes.
+ * Must be called with slot->encoder_mutex held. On success slot->packet holds
+ * the JPEG until the next call.
+ *
+ * @return 0 on success, -1 on failure
  */
-int detect_objects_api(const char *api_url, const unsigned char *frame_data,
-                      int width, int height, int channels, detection_result_t *result,
-                      const char *stream_name) {
-    // CRITICAL FIX: Check if we're in shutdown mode or if the stream has been stopped
-    if (is_shutdown_initiated()) {
-        log_info("API Detection: System shutdown in progress, skipping detection");
-        return -1;
-    }
+static int encode_jpeg(api_stream_t *slot, const unsigned char *frame_data,
+                       int width, int height, int channels) {
+    enum AVPixelFormat src_format = channels == 1 ? AV_PIX_FMT_GRAY8 :
+                                    channels == 3 ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_RGBA;
 
-    // CRITICAL FIX: Add thread safety for curl operations
-    pthread_mutex_lock(&curl_mutex);
-    
-    // Initialize result to empty at the beginning to prevent segmentation fault
-    if (result) {
-        memset(result, 0, sizeof(detection_result_t));
-    } else {
-        log_error("API Detection: NULL result pointer provided");
-        pthread_mutex_unlock(&curl_mutex);
-        return -1;
-    }
-    
-    // CRITICAL FIX: Check if api_url is the special "api-detection" string
-    // If so, get the actual URL from the global config
-    const char *actual_api_url = api_url;
-    if (api_url && strcmp(api_url, "api-detection") == 0) {
-        // Get the API URL from the global config
-        extern config_t g_config;
-        actual_api_url = g_config.api_detection_url;
-        log_info("API Detection: Using API URL from config: %s", actual_api_url ? actual_api_url : "NULL");
-    }
+    if (!slot->encoder || slot->width != width || slot->height != height) {
+        free_stream_encoder(slot);
 
-    log_info("API Detection: Starting detection with API URL: %s", actual_api_url);
-    log_info("API Detection: Frame dimensions: %dx%d, channels: %d", width, height, channels);
-    log_info("API Detection: Stream name: %s", stream_name ? stream_name : "NULL");
+        const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+        if (!codec) {
+            log_error("API Detection: MJPEG encoder not available");
+            return -1;
+        }
 
-    if (!initialized || !curl_handle) {
-        log_error("API detection system not initialized");
-        pthread_mutex_unlock(&curl_mutex);
-        return -1;
+        slot->encoder = avcodec_alloc_context3(codec);
+        slot->frame = av_frame_alloc();
+        slot->packet = av_packet_alloc();
+        if (!slot->encoder || !slot->frame || !slot->packet) {
+            log_error("API Detection: Failed to allocate JPEG encoder");
+            free_stream_encoder(slot);
+            return -1;
+        }
+
+        slot->encoder->width = width;
+        slot->encoder->height = height;
+        slot->encoder->pix_fmt = AV_PIX_FMT_YUVJ420P;
+        slot->encoder->time_base = (AVRational){1, 25};
+        slot->encoder->flags |= AV_CODEC_FLAG_QSCALE;
+        slot->encoder->global_quality = FF_QP2LAMBDA * API_DETECTION_JPEG_QSCALE;
+        slot->encoder->thread_count = 1;
+
+        if (avcodec_open2(slot->encoder, codec, NULL) < 0) {
+            log_error("API Detection: Failed to open MJPEG encoder for %dx%d", width, height);
+            free_stream_encoder(slot);
+            return -1;
+        }
+
+        slot->frame->format = AV_PIX_FMT_YUVJ420P;
+        slot->frame->width = width;
+        slot->frame->height = height;
+        if (av_frame_get_buffer(slot->frame, 0) < 0) {
+            log_error("API Detection: Failed to allocate JPEG encoder frame");
+            free_stream_encoder(slot);
+            return -1;
+        }
+
+        slot->frame->pts = 0;
+        slot->width = width;
+        slot->height = height;
+        slot->src_format = AV_PIX_FMT_NONE;
     }
 
-    if (!actual_api_url || !frame_data || !result) {
-        log_error("Invalid parameters for detect_objects_api");
-        pthread_mutex_unlock(&curl_mutex);
-        return -1;
+    if (slot->src_format != src_format || !slot->sws) {
+        slot->sws = sws_getCachedContext(slot->sws, width, height, src_format,
+                                         width, height, AV_PIX_FMT_YUVJ420P,
+                                         SWS_BILINEAR, NULL, NULL, NULL);
+        if (!slot->sws) {
+            log_error("API Detection: Failed to create color conversion context");
+            return -1;
+        }
+        slot->src_format = src_format;
     }
 
-    // Check if the URL is valid (must start with http:// or https://)
-    if (strncmp(actual_api_url, "http://", 7) != 0 && strncmp(actual_api_url, "https://", 8) != 0) {
-        log_error("API Detection: Invalid URL format: %s (must start with http:// or https://)", actual_api_url);
-        pthread_mutex_unlock(&curl_mutex);
+    if (av_frame_make_writable(slot->frame) < 0) {
+        log_error("API Detection: JPEG encoder frame is not writable");
         return -1;
     }
 
-    // Set up curl for multipart/form-data
-    struct curl_httppost *formpost = NULL;
-    struct curl_httppost *lastptr = NULL;
+    const uint8_t *src_data[4] = {frame_data, NULL, NULL, NULL};
+    const int src_linesize[4] = {width * channels, 0, 0, 0};
+    sws_scale(slot->sws, src_data, src_linesize, 0, height, slot->frame->data, slot->frame->linesize);
+
+    slot->frame->quality = slot->encoder->global_quality;
+    slot->frame->pts++;
 
-    // Create a temporary file for the image data using mkstemp (safer than tmpnam)
-    char temp_filename[] = "/tmp/lightnvr_api_detection_XXXXXX";
-    int temp_fd = mkstemp(temp_filename);
-    if (temp_fd < 0) {
-        log_error("Failed to create temporary file: %s", strerror(errno));
-        pthread_mutex_unlock(&curl_mutex);
+    av_packet_unref(slot->packet);
+    if (avcodec_send_frame(slot->encoder, slot->frame) < 0 ||
+        avcodec_receive_packet(slot->encoder, slot->packet) < 0) {
+        log_error("API Detection: Failed to encode frame as JPEG");
         return -1;
     }
 
-    char image_filename[256];
-    snprintf(image_filename, sizeof(image_filename), "%s.jpg", temp_filename);
+    return 0;
+}
+
+static void free_request(api_request_t *req) {
+    if (!req) return;
 
-    // Convert file descriptor to FILE pointer
-    FILE *temp_file = fdopen(temp_fd, "wb");
-    if (!temp_file) {
-        log_error("Failed to open temporary file for writing: %s", strerror(errno));
-        close(temp_fd);
-        unlink(temp_filename);
-        pthread_mutex_unlock(&curl_mutex);
-        return -1;
+    if (req->easy) {
+        curl_easy_cleanup(req->easy);
     }
+    curl_mime_free(req->mime);
+    curl_slist_free_all(req->headers);
+    free(req->response.memory);
+    pthread_cond_destroy(&req->done_cond);
+    free(req);
+}
 
-    // Write the raw image data to the file
-    size_t bytes_written = fwrite(frame_data, 1, width * height * channels, temp_file);
-    fclose(temp_file);
-
-    if (bytes_written != width * height * channels) {
-        log_error("Failed to write image data to temporary file");
-        remove(temp_filename);
-        pthread_mutex_unlock(&curl_mutex);
-        return -1;
+/**
+ * Mark a request as finished and wake up its caller
+ * Must be called with queue_mutex held
+ */
+static void complete_request(api_request_t *req, CURLcode res) {
+    req->curl_result = res;
+    if (res == CURLE_OK) {
+        curl_easy_getinfo(req->easy, CURLINFO_RESPONSE_CODE, &req->http_code);
     }
+    req->done = true;
+    pthread_cond_signal(&req->done_cond);
+}
 
-    // CRITICAL FIX: Modify the request to match the API server's expected format
-    // Based on working curl examples:
-    // curl -X 'POST' 'http://127.0.0.1:9001/api/v1/detect?backend=tflite&confidence_threshold=.5&return_image=false'
-    //   -H 'accept: application/json' -H 'Content-Type: multipart/form-data'
-    //   -F 'file=@image.jpg;type=image/jpeg'
+/**
+ * Dispatcher thread
+ *
+ * Drives every outstanding request through one curl multi handle, so requests
+ * from all streams run concurrently and reuse the kept-alive connections of
+ * the multi handle's connection cache.
+ */
+static void *api_dispatch_thread_func(void *arg) {
+    (void)arg;
+    api_request_t *active = NULL;   // Requests added to the multi handle, owned by this thread
+
+    pthread_mutex_lock(&queue_mutex);
+    while (dispatch_running) {
+        // Hand new requests to the multi handle
+        while (pending_head) {
+            api_request_t *req = pending_head;
+            pending_head = req->next;
+            req->next = NULL;
+
+            CURLMcode mc = curl_multi_add_handle(multi_handle, req->easy);
+            if (mc != CURLM_OK) {
+                log_error("API Detection: Failed to add request: %s", curl_multi_strerror(mc));
+                complete_request(req, CURLE_FAILED_INIT);
+                continue;
+            }
+            req->next = active;
+            active = req;
+        }
+        pending_tail = NULL;
+        pthread_mutex_unlock(&queue_mutex);
+
+        int running_handles = 0;
+        curl_multi_perform(multi_handle, &running_handles);
+
+        CURLMsg *msg;
+        int msgs_left;
+        while ((msg = curl_multi_info_read(multi_handle, &msgs_left))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            api_request_t *req = NULL;
+            CURL *easy = msg->easy_handle;
+            CURLcode res = msg->data.result;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **)&req);
+            curl_multi_remove_handle(multi_handle, easy);
+            for (api_request_t **p = &active; *p; p = &(*p)->next) {
+                if (*p == req) {
+                    *p = req->next;
+                    break;
+                }
+            }
 
-    // CRITICAL FIX: Determine the correct ImageMagick parameters based on channels with safety checks
-    const char *pixel_format = NULL;
+            pthread_mutex_lock(&queue_mutex);
+            complete_request(req, res);
+            pthread_mutex_unlock(&queue_mutex);
+        }
 
-    // Validate channels to prevent segmentation faults
-    if (channels <= 0 || channels > 4) {
-        log_error("API Detection: Invalid number of channels: %d (must be 1, 3, or 4)", channels);
-        remove(temp_filename);
-        pthread_mutex_unlock(&curl_mutex);
-        return -1;
-    }
+        // Sleep until there is socket activity, a timeout or a new request
+        curl_multi_poll(multi_handle, NULL, 0, 1000, NULL);
 
-    // Set pixel format based on validated channels
-    if (channels == 1) {
-        pixel_format = "gray";
-        log_info("API Detection: Using grayscale pixel format for %d channel", channels);
-    } else if (channels == 3) {
-        pixel_format = "rgb";
-        log_info("API Detection: Using RGB pixel format for %d channels", channels);
-    } else if (channels == 4) {
-        pixel_format = "rgba";
-        log_info("API Detection: Using RGBA pixel format for %d channels", channels);
+        pthread_mutex_lock(&queue_mutex);
     }
 
-    // Double-check that pixel_format is set
-    if (!pixel_format) {
-        log_error("API Detection: Failed to determine pixel format for %d channels", channels);
-        remove(temp_filename);
-        pthread_mutex_unlock(&curl_mutex);
-        return -1;
+    // Fail everything that is still outstanding
+    while (pending_head) {
+        api_request_t *req = pending_head;
+        pending_head = req->next;
+        complete_request(req, CURLE_ABORTED_BY_CALLBACK);
     }
+    pending_tail = NULL;
 
-    // Validate width and height to prevent buffer overflows
-    if (width <= 0 || width > 10000 || height <= 0 || height > 10000) {
-        log_error("API Detection: Invalid image dimensions: %dx%d", width, height);
-        remove(temp_filename);
-        pthread_mutex_unlock(&curl_mutex);
-        return -1;
+    while (active) {
+        api_request_t *req = active;
+        active = req->next;
+        curl_multi_remove_handle(multi_handle, req->easy);
+        complete_request(req, CURLE_ABORTED_BY_CALLBACK);
     }
+    pthread_mutex_unlock(&queue_mutex);
 
+    return NULL;
+}
+
+/**
+ * Initialize the API detection system
+ */
+int init_api_detection_system(void) {
+    pthread_mutex_lock(&init_mutex);
 
-    // Try an alternative approach using ffmpeg with safety checks
-    log_info("API Detection: Trying alternative conversion with ffmpeg");
-    char ffmpeg_cmd[1024] = {0}; // Initialize to zeros
+    if (initialized) {
+        pthread_mutex_unlock(&init_mutex);
+        log_info("API detection system already initialized");
+        return 0;
+    }
 
-    // Determine the correct ffmpeg pixel format with safety checks
-    const char *ffmpeg_pixel_format = NULL;
-    if (channels == 1) {
-        ffmpeg_pixel_format = "gray";
-    } else if (channels == 3) {
-        ffmpeg_pixel_format = "rgb24";
-    } else if (channels == 4) {
-        ffmpeg_pixel_format = "rgba";
-    } else {
-        log_error("API Detection: Invalid number of channels for ffmpeg: %d", channels);
-        remove(temp_filename);
-        pthread_mutex_unlock(&curl_mutex);
+    // Initialize curl
+    CURLcode global_init_result = curl_global_init(CURL_GLOBAL_ALL);
+    if (global_init_result != CURLE_OK) {
+        log_error("Failed to initialize curl global: %s", curl_easy_strerror(global_init_result));
+        pthread_mutex_unlock(&init_mutex);
         return -1;
     }
 
-    // Format the command with safety checks
-    int cmd_result = snprintf(ffmpeg_cmd, sizeof(ffmpeg_cmd),
-            "ffmpeg -f rawvideo -pixel_format %s -video_size %dx%d -i %s -y %s",
-            ffmpeg_pixel_format, width, height, temp_filename, image_filename);
+    multi_handle = curl_multi_init();
+    if (!multi_handle) {
+        log_error("Failed to initialize curl multi handle");
+        curl_global_cleanup();
+        pthread_mutex_unlock(&init_mutex);
+        return -1;
+    }
 
-    // Check for buffer overflow
-    if (cmd_result < 0 || cmd_result >= (int)sizeof(ffmpeg_cmd)) {
-        log_error("API Detection: Command buffer overflow when formatting ffmpeg command");
-        remove(temp_filename);
-        pthread_mutex_unlock(&curl_mutex);
+    // Every stream can keep a connection open to the detection server; HTTP/2
+    // servers get the requests multiplexed over a single connection instead
+    curl_multi_setopt(multi_handle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi_handle, CURLMOPT_MAX_HOST_CONNECTIONS, (long)MAX_STREAMS);
+    curl_multi_setopt(multi_handle, CURLMOPT_MAXCONNECTS, (long)MAX_STREAMS);
+
+    pthread_mutex_lock(&queue_mutex);
+    dispatch_running = true;
+    pthread_mutex_unlock(&queue_mutex);
+
+    if (pthread_create(&dispatch_thread, NULL, api_dispatch_thread_func, NULL) != 0) {
+        log_error("Failed to start API detection dispatcher thread");
+        dispatch_running = false;
+        curl_multi_cleanup(multi_handle);
+        multi_handle = NULL;
+        curl_global_cleanup();
+        pthread_mutex_unlock(&init_mutex);
         return -1;
     }
 
-    log_info("API Detection: Running ffmpeg command: %s", ffmpeg_cmd);
+    initialized = true;
+    pthread_mutex_unlock(&init_mutex);
 
-    int ffmpeg_result = system(ffmpeg_cmd);
-    if (ffmpeg_result != 0) {
-        log_error("API Detection: Failed to convert with ffmpeg (error code: %d)", ffmpeg_result);
-        log_info("API Detection: Falling back to raw data with application/octet-stream MIME type");
+    log_info("API detection system initialized successfully");
+    return 0;
+}
 
-        // CRITICAL FIX: Verify that temp_filename exists before adding it to the form
-        struct stat temp_stat;
-        if (stat(temp_filename, &temp_stat) != 0 || temp_stat.st_size == 0) {
-            log_error("API Detection: Temporary file is missing or empty: %s", temp_filename);
-            remove(temp_filename);
-            pthread_mutex_unlock(&curl_mutex);
-            return -1;
-        }
+/**
+ * Shutdown the API detection system
+ */
+void shutdown_api_detection_system(void) {
+    pthread_mutex_lock(&init_mutex);
 
-        // Add the file to the form with the correct field name 'file' (not 'image')
-        CURLFORMcode form_result = curl_formadd(&formpost, &lastptr,
-                    CURLFORM_COPYNAME, "file",
-                    CURLFORM_FILE, temp_filename,
-                    CURLFORM_CONTENTTYPE, "application/octet-stream",
-                    CURLFORM_END);
-
-        // Check for curl form errors
-        if (form_result != CURL_FORMADD_OK) {
-            log_error("API Detection: Failed to add file to form (error code: %d)", form_result);
-            remove(temp_filename);
-            pthread_mutex_unlock(&curl_mutex);
-            return -1;
-        }
-    } else {
-        log_info("API Detection: Successfully converted raw data to JPEG with ffmpeg: %s", image_filename);
-
-        // CRITICAL FIX: Verify that image_filename exists before using it
-        struct stat image_stat;
-        if (stat(image_filename, &image_stat) != 0 || image_stat.st_size == 0) {
-            log_error("API Detection: Converted image file is missing or empty: %s", image_filename);
-            remove(temp_filename);
-            pthread_mutex_unlock(&curl_mutex);
-            return -1;
-        }
-    }
+    log_info("Shutting down API detection system (initialized: %s)", initialized ? "yes" : "no");
 
-    // Add the JPEG file to the form
-    // CRITICAL FIX: Check if image_filename exists before adding to form
-    struct stat image_stat;
-    memory_struct_t chunk = {0};
-    chunk.memory = NULL;
-    struct curl_slist *headers = NULL;
-    if (stat(image_filename, &image_stat) == 0 && image_stat.st_size > 0) {
-        CURLFORMcode form_result = curl_formadd(&formpost, &lastptr,
-                    CURLFORM_COPYNAME, "file",
-                    CURLFORM_FILE, image_filename,
-                    CURLFORM_CONTENTTYPE, "image/jpeg",
-                    CURLFORM_END);
-                    
-        if (form_result != CURL_FORMADD_OK) {
-            log_error("API Detection: Failed to add JPEG file to form (error code: %d)", form_result);
-            free(chunk.memory);
-            curl_formfree(formpost);
-            curl_slist_free_all(headers);
-            remove(temp_filename);
-            remove(image_filename);
-            result->count = 0;
-            pthread_mutex_unlock(&curl_mutex);
-            return -1;
-        }
-        
-        log_info("API Detection: Successfully added JPEG file to form: %s", image_filename);
-    } else {
-        log_error("API Detection: JPEG file missing or empty: %s", image_filename);
-        // Now we can safely free them
-        if (chunk.memory) free(chunk.memory);
-        if (formpost) curl_formfree(formpost);
-        if (headers) curl_slist_free_all(headers);
-        
-        remove(temp_filename);
-        if (stat(image_filename, &image_stat) == 0) {
-            remove(image_filename);
-        }
-        result->count = 0;
-        pthread_mutex_unlock(&curl_mutex);
-        return -1;
+    if (!initialized) {
+        pthread_mutex_unlock(&init_mutex);
+        return;
     }
 
-    // Construct the URL with query parameters
-    char url_with_params[1024];
-    snprintf(url_with_params, sizeof(url_with_params),
-             "%s?backend=tflite&confidence_threshold=0.5&return_image=false",
-             actual_api_url);
-    log_info("API Detection: Using URL with parameters: %s", url_with_params);
-
-    // Set up the request with the URL including query parameters
-    curl_easy_setopt(curl_handle, CURLOPT_URL, url_with_params);
-    curl_easy_setopt(curl_handle, CURLOPT_HTTPPOST, formpost);
-
-    // Add the accept header
-    headers = curl_slist_append(headers, "accept: application/json");
-    curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
-
-    // Set up the response buffer
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_memory_callback);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
-
-    // Set a timeout
-    curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, 10);
-
-    // Perform the request
-    log_info("API Detection: Sending request to %s", url_with_params);
-
-    // CRITICAL FIX: Check if curl handle is still valid before performing the request
-    if (!curl_handle || !initialized) {
-        log_error("API Detection: curl handle is invalid or API detection system not initialized");
-        free(chunk.memory);
-        curl_formfree(formpost);
-        curl_slist_free_all(headers);
-
-        // Clean up the temporary files
-        remove(temp_filename);
-        // Remove the JPEG file if it was created by either ImageMagick or ffmpeg
-        struct stat st;
-        if (stat(image_filename, &st) == 0) {
-            log_info("API Detection: Removing temporary JPEG file: %s", image_filename);
-            remove(image_filename);
-        }
+    // Stop the dispatcher, outstanding requests complete with an error
+    pthread_mutex_lock(&queue_mutex);
+    dispatch_running = false;
+    pthread_mutex_unlock(&queue_mutex);
+    curl_multi_wakeup(multi_handle);
+    pthread_join(dispatch_thread, NULL);
 
-        // Initialize result to empty to prevent segmentation fault
-        result->count = 0;
-        pthread_mutex_unlock(&curl_mutex);
-        return -1;
+    curl_multi_cleanup(multi_handle);
+    multi_handle = NULL;
+
+    pthread_once(&streams_once, init_stream_slots);
+    for (int i = 0; i < API_DETECTION_STREAM_SLOTS; i++) {
+        pthread_mutex_lock(&api_streams[i].encoder_mutex);
+        free_stream_encoder(&api_streams[i]);
+        pthread_mutex_unlock(&api_streams[i].encoder_mutex);
     }
 
-    CURLcode res = curl_easy_perform(curl_handle);
+    log_info("Cleaning up curl global resources");
+    curl_global_cleanup();
+
+    initialized = false;
+    pthread_mutex_unlock(&init_mutex);
+    log_info("API detection system shutdown complete");
+}
 
-    // Clean up the temporary files
-    remove(temp_filename);
-    // Remove the JPEG file if it was created by either ImageMagick or ffmpeg
-    struct stat st;
-    if (stat(image_filename, &st) == 0) {
-        log_info("API Detection: Removing temporary JPEG file: %s", image_filename);
-        remove(image_filename);
+/**
+ * Build the curl request for a frame
+ *
+ * @return Request, or NULL on failure
+ */
+static api_request_t *create_request(const char *api_url, api_stream_t *slot,
+                                     const unsigned char *frame_data,
+                                     int width, int height, int channels) {
+    api_request_t *req = calloc(1, sizeof(api_request_t));
+    if (!req) {
+        log_error("API Detection: Failed to allocate request");
+        return NULL;
     }
+    pthread_cond_init(&req->done_cond, NULL);
 
-    // Check for errors
-    if (res != CURLE_OK) {
-        log_error("API Detection: curl_easy_perform() failed: %s", curl_easy_strerror(res));
+    req->easy = curl_easy_init();
+    if (!req->easy) {
+        log_error("API Detection: Failed to initialize curl handle");
+        free_request(req);
+        return NULL;
+    }
 
-        // Check if it's a connection error
-        if (res == CURLE_COULDNT_CONNECT) {
-            log_error("API Detection: Could not connect to server at %s. Is the API server running?", url_with_params);
-        } else if (res == CURLE_OPERATION_TIMEDOUT) {
-            log_error("API Detection: Connection to %s timed out. Server might be slow or unreachable.", url_with_params);
-        } else if (res == CURLE_COULDNT_RESOLVE_HOST) {
-            log_error("API Detection: Could not resolve host %s. Check your network connection and DNS settings.", url_with_params);
-        } else if (res == CURLE_FAILED_INIT) {
-            log_error("API Detection: Curl initialization failed. Reinitializing curl handle...");
-
-            // Attempt to reinitialize curl
-            if (curl_handle) {
-                curl_easy_cleanup(curl_handle);
-                curl_handle = NULL;
-            }
+    // Encode the frame straight into the multipart body, no temporary files
+    req->mime = curl_mime_init(req->easy);
+    curl_mimepart *part = curl_mime_addpart(req->mime);
 
-            curl_handle = curl_easy_init();
-            if (!curl_handle) {
-                log_error("API Detection: Failed to reinitialize curl handle");
-                initialized = false; // Mark as uninitialized to force reinitialization next time
-            } else {
-                log_info("API Detection: Successfully reinitialized curl handle");
-            }
-        }
+    pthread_mutex_lock(&slot->encoder_mutex);
+    int ret = encode_jpeg(slot, frame_data, width, height, channels);
+    if (ret == 0) {
+        // Field name 'file' is what the detection server expects
+        curl_mime_name(part, "file");
+        curl_mime_filename(part, "frame.jpg");
+        curl_mime_type(part, "image/jpeg");
+        curl_mime_data(part, (const char *)slot->packet->data, slot->packet->size);
+        av_packet_unref(slot->packet);
+    }
+    pthread_mutex_unlock(&slot->encoder_mutex);
 
-        free(chunk.memory);
-        curl_formfree(formpost);
-        curl_slist_free_all(headers);
+    if (ret != 0) {
+        free_request(req);
+        return NULL;
+    }
 
-        // Initialize result to empty to prevent segmentation fault
-        result->count = 0;
-        pthread_mutex_unlock(&curl_mutex);
+    // Construct the URL with query parameters
+    snprintf(req->url, sizeof(req->url),
+             "%s?backend=tflite&confidence_threshold=0.5&return_image=false", api_url);
+
+    req->headers = curl_slist_append(NULL, "accept: application/json");
+
+    curl_easy_setopt(req->easy, CURLOPT_URL, req->url);
+    curl_easy_setopt(req->easy, CURLOPT_MIMEPOST, req->mime);
+    curl_easy_setopt(req->easy, CURLOPT_HTTPHEADER, req->headers);
+    curl_easy_setopt(req->easy, CURLOPT_WRITEFUNCTION, write_memory_callback);
+    curl_easy_setopt(req->easy, CURLOPT_WRITEDATA, (void *)&req->response);
+    curl_easy_setopt(req->easy, CURLOPT_ERRORBUFFER, req->error);
+    curl_easy_setopt(req->easy, CURLOPT_PRIVATE, (void *)req);
+    curl_easy_setopt(req->easy, CURLOPT_TIMEOUT_MS, (long)API_DETECTION_TIMEOUT_MS);
+    curl_easy_setopt(req->easy, CURLOPT_CONNECTTIMEOUT_MS, (long)API_DETECTION_CONNECT_TIMEOUT_MS);
+    curl_easy_setopt(req->easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(req->easy, CURLOPT_NOSIGNAL, 1L);
+
+    return req;
+}
+
+/**
+ * Queue a request on the dispatcher and wait for it to finish
+ *
+ * @return 0 if the request ran, -1 if it could not be queued
+ */
+static int run_request(api_request_t *req) {
+    pthread_mutex_lock(&queue_mutex);
+    if (!dispatch_running) {
+        pthread_mutex_unlock(&queue_mutex);
+        log_error("API detection dispatcher is not running");
         return -1;
     }
 
-    // Get the HTTP response code
-    long http_code = 0;
-    curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &http_code);
+    if (pending_tail) {
+        pending_tail->next = req;
+    } else {
+        pending_head = req;
+    }
+    pending_tail = req;
+    curl_multi_wakeup(multi_handle);
 
-    if (http_code != 200) {
-        log_error("API request failed with HTTP code %ld", http_code);
-        free(chunk.memory);
-        curl_formfree(formpost);
-        curl_slist_free_all(headers);
-        pthread_mutex_unlock(&curl_mutex);
-        return -1;
+    // The dispatcher completes every request, on timeout and shutdown too
+    while (!req->done) {
+        pthread_cond_wait(&req->done_cond, &queue_mutex);
     }
+    pthread_mutex_unlock(&queue_mutex);
 
-    // Parse the JSON response
-    // CRITICAL FIX: Add additional logging and validation for JSON parsing
-    if (!chunk.memory || chunk.size == 0) {
+    return 0;
+}
+
+/**
+ * Parse the detections of a JSON response into a result
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int parse_detection_response(const memory_struct_t *response, detection_result_t *result) {
+    if (!response->memory || response->size == 0) {
         log_error("API Detection: Empty response from server");
-        free(chunk.memory);
-        curl_formfree(formpost);
-        curl_slist_free_all(headers);
-        // Initialize result to empty to prevent segmentation fault
-        result->count = 0;
-        pthread_mutex_unlock(&curl_mutex);
         return -1;
     }
 
-    // Log the first few bytes of the response for debugging
-    char preview[64] = {0};
-    int preview_len = chunk.size < 63 ? chunk.size : 63;
-    memcpy(preview, chunk.memory, preview_len);
-    preview[preview_len] = '\0';
-    // Replace non-printable characters with dots
-    for (int i = 0; i < preview_len; i++) {
-        if (preview[i] < 32 || preview[i] > 126) {
-            preview[i] = '.';
-        }
-    }
-    log_info("API Detection: Response preview: %s", preview);
-
-    cJSON *root = cJSON_Parse(chunk.memory);
+    cJSON *root = cJSON_Parse(response->memory);
 
     if (!root) {
         const char *error_ptr = cJSON_GetErrorPtr();
         log_error("Failed to parse JSON response: %s", error_ptr ? error_ptr : "Unknown error");
-        // Log more details about the response
-        log_error("API Detection: Response size: %zu bytes", chunk.size);
+
+        // Log the first few bytes of the response for debugging
+        char preview[64] = {0};
+        int preview_len = response->size < 63 ? response->size : 63;
+        memcpy(preview, response->memory, preview_len);
+        // Replace non-printable characters with dots
+        for (int i = 0; i < preview_len; i++) {
+            if (preview[i] < 32 || preview[i] > 126) {
+                preview[i] = '.';
+            }
+        }
+        log_error("API Detection: Response size: %zu bytes", response->size);
         log_error("API Detection: Response preview: %s", preview);
-        free(chunk.memory);
-        curl_formfree(formpost);
-        curl_slist_free_all(headers);
-        // Initialize result to empty to prevent segmentation fault
-        result->count = 0;
-        pthread_mutex_unlock(&curl_mutex);
         return -1;
     }
 
@@ -532,12 +614,6 @@ int detect_objects_api(const char *api_url, const unsigned char *frame_data,
             free(json_str);
         }
         cJSON_Delete(root);
-        free(chunk.memory);
-        curl_formfree(formpost);
-        curl_slist_free_all(headers);
-        // Initialize result to empty to prevent segmentation fault
-        result->count = 0;
-        pthread_mutex_unlock(&curl_mutex);
         return -1;
     }
 
@@ -558,26 +634,11 @@ int detect_objects_api(const char *api_url, const unsigned char *frame_data,
 
         // The bounding box coordinates might be in a nested object
         cJSON *bounding_box = cJSON_GetObjectItem(detection, "bounding_box");
-        cJSON *x_min = NULL;
-        cJSON *y_min = NULL;
-        cJSON *x_max = NULL;
-        cJSON *y_max = NULL;
-
-        if (bounding_box) {
-            // Get coordinates from the nested bounding_box object
-            x_min = cJSON_GetObjectItem(bounding_box, "x_min");
-            y_min = cJSON_GetObjectItem(bounding_box, "y_min");
-            x_max = cJSON_GetObjectItem(bounding_box, "x_max");
-            y_max = cJSON_GetObjectItem(bounding_box, "y_max");
-            log_info("API Detection: Found bounding_box object in JSON response");
-        } else {
-            // Try to get coordinates directly from the detection object (old format)
-            x_min = cJSON_GetObjectItem(detection, "x_min");
-            y_min = cJSON_GetObjectItem(detection, "y_min");
-            x_max = cJSON_GetObjectItem(detection, "x_max");
-            y_max = cJSON_GetObjectItem(detection, "y_max");
-            log_info("API Detection: Using direct coordinates from JSON response");
-        }
+        cJSON *coords = bounding_box ? bounding_box : detection;
+        cJSON *x_min = cJSON_GetObjectItem(coords, "x_min");
+        cJSON *y_min = cJSON_GetObjectItem(coords, "y_min");
+        cJSON *x_max = cJSON_GetObjectItem(coords, "x_max");
+        cJSON *y_max = cJSON_GetObjectItem(coords, "y_max");
 
         if (!label || !cJSON_IsString(label) ||
             !confidence || !cJSON_IsNumber(confidence) ||
@@ -607,19 +668,134 @@ int detect_objects_api(const char *api_url, const unsigned char *frame_data,
         result->count++;
     }
 
+    cJSON_Delete(root);
+    return 0;
+}
+
+/**
+ * Detect objects using the API
+ */
+int detect_objects_api(const char *api_url, const unsigned char *frame_data,
+                      int width, int height, int channels, detection_result_t *result,
+                      const char *stream_name) {
+    // CRITICAL FIX: Check if we're in shutdown mode or if the stream has been stopped
+    if (is_shutdown_initiated()) {
+        log_info("API Detection: System shutdown in progress, skipping detection");
+        return -1;
+    }
+
+    // Initialize result to empty at the beginning to prevent segmentation fault
+    if (result) {
+        memset(result, 0, sizeof(detection_result_t));
+    } else {
+        log_error("API Detection: NULL result pointer provided");
+        return -1;
+    }
+
+    // CRITICAL FIX: Check if api_url is the special "api-detection" string
+    // If so, get the actual URL from the global config
+    const char *actual_api_url = api_url;
+    if (api_url && strcmp(api_url, "api-detection") == 0) {
+        // Get the API URL from the global config
+        extern config_t g_config;
+        actual_api_url = g_config.api_detection_url;
+    }
+
+    if (!actual_api_url || !frame_data) {
+        log_error("Invalid parameters for detect_objects_api");
+        return -1;
+    }
+
+    // Check if the URL is valid (must start with http:// or https://)
+    if (strncmp(actual_api_url, "http://", 7) != 0 && strncmp(actual_api_url, "https://", 8) != 0) {
+        log_error("API Detection: Invalid URL format: %s (must start with http:// or https://)", actual_api_url);
+        return -1;
+    }
+
+    // Validate channels to prevent segmentation faults
+    if (channels != 1 && channels != 3 && channels != 4) {
+        log_error("API Detection: Invalid number of channels: %d (must be 1, 3, or 4)", channels);
+        return -1;
+    }
+
+    // Validate width and height to prevent buffer overflows
+    if (width <= 0 || width > 10000 || height <= 0 || height > 10000) {
+        log_error("API Detection: Invalid image dimensions: %dx%d", width, height);
+        return -1;
+    }
+
+    pthread_mutex_lock(&init_mutex);
+    bool ready = initialized;
+    pthread_mutex_unlock(&init_mutex);
+    if (!ready) {
+        log_error("API detection system not initialized");
+        return -1;
+    }
+
+    // Bound the requests of each stream so a slow server cannot pile up frames
+    api_stream_t *slot = acquire_stream_slot(stream_name);
+    if (!slot) {
+        log_debug("API Detection: Stream %s has %d requests in flight, skipping frame",
+                  stream_name ? stream_name : "NULL", API_DETECTION_MAX_INFLIGHT_PER_STREAM);
+        return -1;
+    }
+
+    log_debug("API Detection: Sending %dx%d frame (%d channels) for stream %s to %s",
+              width, height, channels, stream_name ? stream_name : "NULL", actual_api_url);
+
+    api_request_t *req = create_request(actual_api_url, slot, frame_data, width, height, channels);
+    if (!req) {
+        release_stream_slot(slot);
+        return -1;
+    }
+
+    int ret = run_request(req);
+    release_stream_slot(slot);
+
+    if (ret != 0) {
+        free_request(req);
+        return -1;
+    }
+
+    // Check for errors
+    if (req->curl_result != CURLE_OK) {
+        log_error("API Detection: Request to %s failed: %s", req->url,
+                  req->error[0] ? req->error : curl_easy_strerror(req->curl_result));
+
+        // Check if it's a connection error
+        if (req->curl_result == CURLE_COULDNT_CONNECT) {
+            log_error("API Detection: Could not connect to server at %s. Is the API server running?", req->url);
+        } else if (req->curl_result == CURLE_OPERATION_TIMEDOUT) {
+            log_error("API Detection: Connection to %s timed out. Server might be slow or unreachable.", req->url);
+        } else if (req->curl_result == CURLE_COULDNT_RESOLVE_HOST) {
+            log_error("API Detection: Could not resolve host %s. Check your network connection and DNS settings.", req->url);
+        }
+
+        free_request(req);
+        return -1;
+    }
+
+    if (req->http_code != 200) {
+        log_error("API request failed with HTTP code %ld", req->http_code);
+        free_request(req);
+        return -1;
+    }
+
+    // Parse the JSON response
+    if (parse_detection_response(&req->response, result) != 0) {
+        result->count = 0;
+        free_request(req);
+        return -1;
+    }
+    free_request(req);
+
     // Store the detections in the database if we have a valid stream name
     if (stream_name && stream_name[0] != '\0') {
-        store_detections_in_db(stream_name, result, 0); // 0 means use current time
+        // Queued for the next group commit, detection does not wait for the disk
+        store_detections_in_db_async(stream_name, result, 0, NULL); // 0 means use current time
     } else {
         log_warn("No stream name provided, skipping database storage");
     }
 
-    // Clean up
-    cJSON_Delete(root);
-    free(chunk.memory);
-    curl_formfree(formpost);
-    curl_slist_free_all(headers);
-
-    pthread_mutex_unlock(&curl_mutex);
     return 0;
 }
@@ -27,6 +27,7 @@
 #include "../../include/video/ffmpeg_utils.h"  // For comprehensive_ffmpeg_cleanup
 #include "../../include/core/logger.h"
 #include "../../include/core/config.h"  // For MAX_PATH_LENGTH
+#include "../../include/core/metrics.h"
 
 // Global variables for timeout handling in video detection
 static jmp_buf video_timeout_jmp_buf;
@@ -172,6 +173,32 @@ int handle_hls_timeout(const char *url, AVFormatContext **input_ctx) {
     return AVERROR(ETIMEDOUT);
 }
 
+// Inference latency by model type, registered once
+static const char *inference_metric_types[] = {
+    MODEL_TYPE_SOD, MODEL_TYPE_SOD_REALNET, MODEL_TYPE_TFLITE, MODEL_TYPE_API
+};
+#define INFERENCE_METRIC_TYPES (sizeof(inference_metric_types) / sizeof(inference_metric_types[0]))
+static metrics_histogram_t inference_latency[INFERENCE_METRIC_TYPES];
+static pthread_once_t inference_metrics_once = PTHREAD_ONCE_INIT;
+
+static void register_inference_metrics(void) {
+    for (size_t i = 0; i < INFERENCE_METRIC_TYPES; i++) {
+        char labels[64] = "";
+        metrics_label(labels, sizeof(labels), "model_type", inference_metric_types[i]);
+        inference_latency[i] = metrics_histogram("lightnvr_inference_seconds",
+                                                 "Time to run detection on a frame", labels);
+    }
+}
+
+static void observe_inference(const char *model_type, uint64_t start_us) {
+    for (size_t i = 0; i < INFERENCE_METRIC_TYPES; i++) {
+        if (strcmp(model_type, inference_metric_types[i]) == 0) {
+            metrics_histogram_observe(inference_latency[i], metrics_now_us() - start_us);
+            return;
+        }
+    }
+}
+
 /**
  * Run detection on a frame
  */
@@ -190,6 +217,8 @@ int detect_objects(detection_model_t model, const unsigned char *frame_data,
     log_info("Detecting objects using model type: %s (dimensions: %dx%d, channels: %d)",
              model_type, width, height, channels);
 
+    pthread_once(&inference_metrics_once, register_inference_metrics);
+    uint64_t start_us = metrics_now_us();
     int ret = -1;
 
     // Delegate to the appropriate detection function based on model type
@@ -227,5 +256,8 @@ int detect_objects(detection_model_t model, const unsigned char *frame_data,
         ret = -1;
     }
 
+    if (ret == 0) {
+        observe_inference(model_type, start_us);
+    }
     return ret;
 }
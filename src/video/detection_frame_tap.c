@@ -0,0 +1,487 @@
+/**
+ * Detection Frame Tap Implementation
+ *
+ * Each tap runs one decoder thread subscribed to the stream's packet fan-out
+ * with the "latest" policy, so a slow detector never makes the decoder fall
+ * behind live. In keyframe mode each keyframe is decoded on its own (send,
+ * drain, flush), which needs no reference frames and keeps decoder latency
+ * at zero.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <errno.h>
+
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libavutil/time.h>
+#include <libswscale/swscale.h>
+
+#include "core/logger.h"
+#include "core/config.h"
+#include "video/thread_utils.h"
+#include "video/packet_fanout.h"
+#include "video/detection_frame_tap.h"
+
+// How long a single read from the fan-out may block, in milliseconds
+#define TAP_READ_TIMEOUT_MS 500
+
+// How long to wait before retrying to attach to the stream, in microseconds
+#define TAP_RETRY_DELAY_US 2000000
+
+struct detection_frame_tap {
+    char stream_name[MAX_STREAM_NAME];
+    int decode_every_n;
+    atomic_int min_interval_sec;
+    int downscale_factor;
+    int channels;
+
+    pthread_t thread;
+    atomic_int running;
+
+    // Queue of converted frames
+    pthread_mutex_t queue_mutex;
+    pthread_cond_t queue_cond;
+    detection_frame_t queue[DETECTION_FRAME_TAP_QUEUE_SIZE];
+    int queue_head;
+    int queue_count;
+
+    // Decoder state, only touched by the tap thread
+    AVCodecContext *codec_ctx;
+    struct SwsContext *sws_ctx;
+    AVFrame *frame;
+    int64_t last_queued_us;
+    uint64_t frame_counter;
+
+    // Statistics
+    atomic_uint_fast64_t frames_decoded;
+    atomic_uint_fast64_t frames_queued;
+    atomic_uint_fast64_t frames_dropped;
+    atomic_uint_fast64_t decode_errors;
+};
+
+static void tap_close_decoder(detection_frame_tap_t *tap) {
+    if (tap->codec_ctx) {
+        avcodec_free_context(&tap->codec_ctx);
+    }
+}
+
+static int tap_open_decoder(detection_frame_tap_t *tap, const AVStream *stream) {
+    tap_close_decoder(tap);
+
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec) {
+        log_error("[Stream %s] Unsupported codec for detection: %s",
+                 tap->stream_name, avcodec_get_name(stream->codecpar->codec_id));
+        return -1;
+    }
+
+    tap->codec_ctx = avcodec_alloc_context3(codec);
+    if (!tap->codec_ctx) {
+        log_error("[Stream %s] Could not allocate decoder for detection", tap->stream_name);
+        return -1;
+    }
+
+    int ret = avcodec_parameters_to_context(tap->codec_ctx, stream->codecpar);
+    if (ret >= 0) {
+        // A single decoder thread adds no frame delay, so every keyframe comes straight out
+        tap->codec_ctx->thread_count = 1;
+        if (tap->decode_every_n == DETECTION_FRAME_TAP_KEYFRAMES_ONLY) {
+            tap->codec_ctx->skip_frame = AVDISCARD_NONKEY;
+        }
+        ret = avcodec_open2(tap->codec_ctx, codec, NULL);
+    }
+
+    if (ret < 0) {
+        char err_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+        av_strerror(ret, err_buf, sizeof(err_buf));
+        log_error("[Stream %s] Could not open decoder for detection: %s", tap->stream_name, err_buf);
+        tap_close_decoder(tap);
+        return -1;
+    }
+
+    log_info("[Stream %s] Detection decoder opened (codec: %s, mode: %s)",
+             tap->stream_name, codec->name,
+             tap->decode_every_n == DETECTION_FRAME_TAP_KEYFRAMES_ONLY ? "keyframes only" : "every Nth frame");
+    return 0;
+}
+
+/**
+ * Queue a frame, dropping the oldest one if the queue is full
+ */
+static void tap_push(detection_frame_tap_t *tap, detection_frame_t *frame) {
+    pthread_mutex_lock(&tap->queue_mutex);
+
+    if (tap->queue_count == DETECTION_FRAME_TAP_QUEUE_SIZE) {
+        detection_frame_release(&tap->queue[tap->queue_head]);
+        tap->queue_head = (tap->queue_head + 1) % DETECTION_FRAME_TAP_QUEUE_SIZE;
+        tap->queue_count--;
+        atomic_fetch_add(&tap->frames_dropped, 1);
+    }
+
+    int tail = (tap->queue_head + tap->queue_count) % DETECTION_FRAME_TAP_QUEUE_SIZE;
+    tap->queue[tail] = *frame;
+    tap->queue_count++;
+    atomic_fetch_add(&tap->frames_queued, 1);
+
+    pthread_cond_signal(&tap->queue_cond);
+    pthread_mutex_unlock(&tap->queue_mutex);
+}
+
+/**
+ * Convert a decoded frame and queue it for detection
+ */
+static void tap_convert_and_push(detection_frame_tap_t *tap, const AVFrame *frame) {
+    int target_width = frame->width / tap->downscale_factor;
+    int target_height = frame->height / tap->downscale_factor;
+
+    // Ensure dimensions are even (required by some models)
+    target_width = (target_width / 2) * 2;
+    target_height = (target_height / 2) * 2;
+    if (target_width <= 0 || target_height <= 0) {
+        return;
+    }
+
+    enum AVPixelFormat out_fmt = tap->channels == 1 ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_RGB24;
+    tap->sws_ctx = sws_getCachedContext(tap->sws_ctx,
+                                        frame->width, frame->height, frame->format,
+                                        target_width, target_height, out_fmt,
+                                        SWS_BILINEAR, NULL, NULL, NULL);
+    if (!tap->sws_ctx) {
+        log_error("[Stream %s] Failed to create SwsContext for detection", tap->stream_name);
+        return;
+    }
+
+    detection_frame_t out;
+    out.width = target_width;
+    out.height = target_height;
+    out.channels = tap->channels;
+    out.timestamp = time(NULL);
+    out.data = malloc((size_t)target_width * target_height * tap->channels);
+    if (!out.data) {
+        log_error("[Stream %s] Failed to allocate detection frame", tap->stream_name);
+        return;
+    }
+
+    uint8_t *dst_data[4] = {out.data, NULL, NULL, NULL};
+    int dst_linesize[4] = {target_width * tap->channels, 0, 0, 0};
+    sws_scale(tap->sws_ctx, (const uint8_t * const *)frame->data, frame->linesize, 0,
+              frame->height, dst_data, dst_linesize);
+
+    tap_push(tap, &out);
+}
+
+static bool tap_interval_elapsed(detection_frame_tap_t *tap) {
+    int interval = atomic_load(&tap->min_interval_sec);
+    return interval <= 0 || tap->last_queued_us == 0 ||
+           av_gettime_relative() - tap->last_queued_us >= (int64_t)interval * 1000000;
+}
+
+/**
+ * Receive every frame the decoder has ready and queue the ones that are due
+ */
+static void tap_receive_frames(detection_frame_tap_t *tap) {
+    while (1) {
+        int ret = avcodec_receive_frame(tap->codec_ctx, tap->frame);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return;
+        }
+        if (ret < 0) {
+            atomic_fetch_add(&tap->decode_errors, 1);
+            return;
+        }
+
+        atomic_fetch_add(&tap->frames_decoded, 1);
+        tap->frame_counter++;
+
+        bool due = tap->decode_every_n == DETECTION_FRAME_TAP_KEYFRAMES_ONLY ||
+                   tap->frame_counter % (uint64_t)tap->decode_every_n == 0;
+        if (due && tap_interval_elapsed(tap)) {
+            tap_convert_and_push(tap, tap->frame);
+            tap->last_queued_us = av_gettime_relative();
+        }
+
+        av_frame_unref(tap->frame);
+    }
+}
+
+/**
+ * Feed one video packet to the decoder
+ */
+static void tap_decode_packet(detection_frame_tap_t *tap, const AVPacket *pkt) {
+    if (tap->decode_every_n == DETECTION_FRAME_TAP_KEYFRAMES_ONLY) {
+        // Skip everything but keyframes, and keyframes too until a frame is due
+        if (!(pkt->flags & AV_PKT_FLAG_KEY) || !tap_interval_elapsed(tap)) {
+            return;
+        }
+
+        // Decode the keyframe on its own: send, drain, then reset for the next one
+        if (avcodec_send_packet(tap->codec_ctx, pkt) < 0) {
+            atomic_fetch_add(&tap->decode_errors, 1);
+            avcodec_flush_buffers(tap->codec_ctx);
+            return;
+        }
+        avcodec_send_packet(tap->codec_ctx, NULL);
+        tap_receive_frames(tap);
+        avcodec_flush_buffers(tap->codec_ctx);
+        return;
+    }
+
+    if (avcodec_send_packet(tap->codec_ctx, pkt) < 0) {
+        atomic_fetch_add(&tap->decode_errors, 1);
+        return;
+    }
+    tap_receive_frames(tap);
+}
+
+/**
+ * Tap thread: read packets from the fan-out and decode the ones we need
+ */
+static void *detection_frame_tap_thread(void *arg) {
+    detection_frame_tap_t *tap = (detection_frame_tap_t *)arg;
+    packet_fanout_t *fanout = NULL;
+    packet_fanout_reader_t *reader = NULL;
+    AVPacket *pkt = av_packet_alloc();
+
+    tap->frame = av_frame_alloc();
+    if (!pkt || !tap->frame) {
+        log_error("[Stream %s] Failed to allocate detection frame tap buffers", tap->stream_name);
+        atomic_store(&tap->running, 0);
+    }
+
+    log_info("[Stream %s] Detection frame tap started", tap->stream_name);
+
+    while (atomic_load(&tap->running)) {
+        // Attach to the stream's shared ingest
+        if (!reader) {
+            // Never open a camera session of our own if shared ingest was turned off
+            if (!packet_fanout_is_enabled()) {
+                log_warn("[Stream %s] Shared ingest disabled, detection frame tap stopping", tap->stream_name);
+                break;
+            }
+            fanout = packet_fanout_acquire(tap->stream_name);
+            if (fanout) {
+                reader = packet_fanout_subscribe(fanout, "detection", PACKET_FANOUT_POLICY_LATEST);
+                if (!reader) {
+                    packet_fanout_release(fanout);
+                    fanout = NULL;
+                }
+            }
+            if (!reader) {
+                av_usleep(TAP_RETRY_DELAY_US);
+                continue;
+            }
+        }
+
+        int ret = packet_fanout_read(reader, pkt, TAP_READ_TIMEOUT_MS);
+        if (ret == AVERROR(EAGAIN)) {
+            continue;
+        }
+        if (ret < 0) {
+            if (ret == AVERROR_EOF) {
+                log_info("[Stream %s] Shared ingest closed, detection frame tap stopping", tap->stream_name);
+            }
+            break;
+        }
+
+        const AVStream *video = packet_fanout_get_stream(reader, AVMEDIA_TYPE_VIDEO);
+        if (!video || pkt->stream_index != video->index) {
+            av_packet_unref(pkt);
+            continue;
+        }
+
+        if (!tap->codec_ctx || packet_fanout_streams_changed(reader)) {
+            if (tap_open_decoder(tap, video) != 0) {
+                av_packet_unref(pkt);
+                av_usleep(TAP_RETRY_DELAY_US);
+                continue;
+            }
+        }
+
+        tap_decode_packet(tap, pkt);
+        av_packet_unref(pkt);
+    }
+
+    if (reader) {
+        packet_fanout_unsubscribe(reader);
+    }
+    if (fanout) {
+        packet_fanout_release(fanout);
+    }
+
+    tap_close_decoder(tap);
+    if (tap->sws_ctx) {
+        sws_freeContext(tap->sws_ctx);
+        tap->sws_ctx = NULL;
+    }
+    av_frame_free(&tap->frame);
+    av_packet_free(&pkt);
+
+    // Wake a detection thread waiting on an empty queue
+    atomic_store(&tap->running, 0);
+    pthread_mutex_lock(&tap->queue_mutex);
+    pthread_cond_broadcast(&tap->queue_cond);
+    pthread_mutex_unlock(&tap->queue_mutex);
+
+    log_info("[Stream %s] Detection frame tap exited (decoded: %llu, queued: %llu, dropped: %llu)",
+             tap->stream_name,
+             (unsigned long long)atomic_load(&tap->frames_decoded),
+             (unsigned long long)atomic_load(&tap->frames_queued),
+             (unsigned long long)atomic_load(&tap->frames_dropped));
+    return NULL;
+}
+
+/**
+ * Start a frame tap for a stream
+ */
+detection_frame_tap_t *detection_frame_tap_start(const char *stream_name, int decode_every_n,
+                                                 int min_interval_sec, int downscale_factor, int channels) {
+    if (!stream_name || decode_every_n < 0) {
+        return NULL;
+    }
+
+    // The tap only reads packets that are already flowing, it does not connect to cameras
+    if (!packet_fanout_is_enabled()) {
+        log_warn("[Stream %s] Not starting detection frame tap: shared_ingest is disabled", stream_name);
+        return NULL;
+    }
+
+    detection_frame_tap_t *tap = calloc(1, sizeof(detection_frame_tap_t));
+    if (!tap) {
+        log_error("Memory allocation failed for detection frame tap");
+        return NULL;
+    }
+
+    strncpy(tap->stream_name, stream_name, MAX_STREAM_NAME - 1);
+    tap->decode_every_n = decode_every_n;
+    atomic_store(&tap->min_interval_sec, min_interval_sec);
+    tap->downscale_factor = downscale_factor > 0 ? downscale_factor : 1;
+    tap->channels = channels == 1 ? 1 : 3;
+    atomic_store(&tap->running, 1);
+    pthread_mutex_init(&tap->queue_mutex, NULL);
+    pthread_cond_init(&tap->queue_cond, NULL);
+
+    if (pthread_create(&tap->thread, NULL, detection_frame_tap_thread, tap) != 0) {
+        log_error("Failed to create detection frame tap thread for %s", stream_name);
+        pthread_mutex_destroy(&tap->queue_mutex);
+        pthread_cond_destroy(&tap->queue_cond);
+        free(tap);
+        return NULL;
+    }
+
+    return tap;
+}
+
+/**
+ * Stop a frame tap and free any queued frames
+ */
+void detection_frame_tap_stop(detection_frame_tap_t *tap) {
+    if (!tap) {
+        return;
+    }
+
+    atomic_store(&tap->running, 0);
+    int join_result = pthread_join_with_timeout(tap->thread, NULL, 5);
+    if (join_result != 0) {
+        // The thread still references the tap, so leak it rather than free it under its feet
+        log_warn("Could not join detection frame tap thread for %s: %s",
+                tap->stream_name, strerror(join_result));
+        return;
+    }
+
+    pthread_mutex_lock(&tap->queue_mutex);
+    while (tap->queue_count > 0) {
+        detection_frame_release(&tap->queue[tap->queue_head]);
+        tap->queue_head = (tap->queue_head + 1) % DETECTION_FRAME_TAP_QUEUE_SIZE;
+        tap->queue_count--;
+    }
+    pthread_mutex_unlock(&tap->queue_mutex);
+
+    pthread_mutex_destroy(&tap->queue_mutex);
+    pthread_cond_destroy(&tap->queue_cond);
+    free(tap);
+}
+
+/**
+ * Pop the oldest queued frame
+ */
+int detection_frame_tap_pop(detection_frame_tap_t *tap, detection_frame_t *frame, int timeout_ms) {
+    if (!tap || !frame) {
+        return -1;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&tap->queue_mutex);
+    while (tap->queue_count == 0 && atomic_load(&tap->running)) {
+        if (pthread_cond_timedwait(&tap->queue_cond, &tap->queue_mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+
+    if (tap->queue_count == 0) {
+        int stopped = !atomic_load(&tap->running);
+        pthread_mutex_unlock(&tap->queue_mutex);
+        return stopped ? -1 : 1;
+    }
+
+    *frame = tap->queue[tap->queue_head];
+    memset(&tap->queue[tap->queue_head], 0, sizeof(detection_frame_t));
+    tap->queue_head = (tap->queue_head + 1) % DETECTION_FRAME_TAP_QUEUE_SIZE;
+    tap->queue_count--;
+    pthread_mutex_unlock(&tap->queue_mutex);
+
+    return 0;
+}
+
+/**
+ * Change the minimum interval between queued frames
+ */
+void detection_frame_tap_set_interval(detection_frame_tap_t *tap, int min_interval_sec) {
+    if (tap) {
+        atomic_store(&tap->min_interval_sec, min_interval_sec);
+    }
+}
+
+/**
+ * Check whether the tap's decoder thread is still running
+ */
+bool detection_frame_tap_is_running(detection_frame_tap_t *tap) {
+    return tap && atomic_load(&tap->running);
+}
+
+/**
+ * Get statistics for a tap
+ */
+void detection_frame_tap_get_stats(detection_frame_tap_t *tap, detection_frame_tap_stats_t *stats) {
+    if (!tap || !stats) {
+        return;
+    }
+
+    stats->frames_decoded = atomic_load(&tap->frames_decoded);
+    stats->frames_queued = atomic_load(&tap->frames_queued);
+    stats->frames_dropped = atomic_load(&tap->frames_dropped);
+    stats->decode_errors = atomic_load(&tap->decode_errors);
+}
+
+/**
+ * Release the pixel data of a popped frame
+ */
+void detection_frame_release(detection_frame_t *frame) {
+    if (frame && frame->data) {
+        free(frame->data);
+        frame->data = NULL;
+    }
+}
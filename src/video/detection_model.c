@@ -139,6 +139,13 @@ bool is_model_supported(const char *model_path) {
     return false;
 }
 
+/**
+ * Check if a model file is an int8 quantized SOD CNN model
+ */
+bool is_quantized_model(const char *model_path) {
+    return model_path && strstr(model_path, ".q8.sod") != NULL;
+}
+
 /**
  * Get the type of a model file
  */
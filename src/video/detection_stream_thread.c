@@ -34,6 +34,8 @@
 #include "video/hls/hls_unified_thread.h"
 #include "video/api_detection.h"
 #include "video/go2rtc/go2rtc_stream.h"
+#include "video/detection_frame_tap.h"
+#include "video/packet_fanout.h"
 
 // Add signal handler to catch floating point exceptions
 #include <fenv.h>
@@ -191,625 +193,83 @@ int process_frame_for_stream_detection(const char *stream_name, const uint8_t *f
 }
 
 
-// Forward declarations for functions from other modules
-
 /**
- * Process an HLS segment file for detection
+ * Run the thread's model on a frame from the frame tap and record any detections
  */
-int process_segment_for_detection(stream_detection_thread_t *thread, const char *segment_path) {
-    // CRITICAL FIX: Add safety checks to prevent memory corruption
-    if (!thread || !segment_path || segment_path[0] == '\0') {
-        log_error("Invalid parameters for process_segment_for_detection");
-        return -1;
-    }
-
-    // CRITICAL FIX: Initialize all pointers to NULL to prevent use-after-free and double-free issues
-    AVFormatContext *format_ctx = NULL;
-    AVCodecContext *codec_ctx = NULL;
-    AVFrame *frame = NULL;
-    AVPacket *pkt = NULL;
-    struct SwsContext *sws_ctx = NULL;
-    int video_stream_idx = -1;
-    int ret = -1;
-
-    // CRITICAL FIX: Use a try/catch block to handle potential segfaults
-    __attribute__((unused)) volatile int segment_check_result = 0;
-
-    log_info("[Stream %s] Processing HLS segment for detection: %s",
-             thread->stream_name, segment_path);
-
-    // CRITICAL FIX: Double-check that the segment still exists and is valid before trying to open it
-    // This prevents segmentation faults when trying to open deleted or corrupt segments
-    if (access(segment_path, F_OK) != 0) {
-        log_warn("[Stream %s] Segment no longer exists before processing: %s",
-                thread->stream_name, segment_path);
-        // Don't return error, just indicate no detections were found
-        log_info("[Stream %s] Continuing detection thread despite missing segment", thread->stream_name);
-        return 0;
-    }
-
-    // Check if the segment file is valid (non-zero size)
-    struct stat st;
-    if (stat(segment_path, &st) != 0 || st.st_size == 0) {
-        log_warn("[Stream %s] Segment file is empty or cannot be accessed: %s (size: %ld bytes)",
-                thread->stream_name, segment_path, (long)(stat(segment_path, &st) == 0 ? st.st_size : 0));
-        log_info("[Stream %s] Continuing detection thread despite invalid segment", thread->stream_name);
-        return 0;
-    }
-
-    // CRITICAL FIX: Initialize format_ctx to NULL before calling avformat_open_input
-    // This prevents potential double-free issues if avformat_open_input fails
-    format_ctx = NULL;
-
-    // Open input file with safety checks
-    int open_result = avformat_open_input(&format_ctx, segment_path, NULL, NULL);
-    if (open_result != 0) {
-        char err_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
-        av_strerror(open_result, err_buf, sizeof(err_buf));
-        log_error("[Stream %s] Could not open segment file: %s (error: %s)",
-                 thread->stream_name, segment_path, err_buf);
-
-        // CRITICAL FIX: Ensure format_ctx is properly cleaned up if avformat_open_input fails
-        // This prevents memory leaks and segmentation faults
-        if (format_ctx) {
-            avformat_close_input(&format_ctx);
-            format_ctx = NULL;
-        }
-
-        log_info("[Stream %s] Continuing detection thread despite failure to open segment", thread->stream_name);
-        // No cleanup handler to pop
-        return 0;
-    }
-
-    // Format context is now allocated
+static int run_detection_on_frame(stream_detection_thread_t *thread, const detection_frame_t *frame) {
+    detection_result_t result;
+    memset(&result, 0, sizeof(detection_result_t));
+    int detect_ret;
 
-    // CRITICAL FIX: Verify that format_ctx is valid
-    if (!format_ctx) {
-        log_error("[Stream %s] Format context is NULL after opening segment: %s",
-                thread->stream_name, segment_path);
-        log_info("[Stream %s] Continuing detection thread despite invalid format context", thread->stream_name);
-        return 0;
-    }
+    // Ensure only one detection is running at a time on this model
+    pthread_mutex_lock(&thread->mutex);
 
-    // Find stream info with safety checks
-    int find_stream_result = avformat_find_stream_info(format_ctx, NULL);
-    if (find_stream_result < 0) {
-        char err_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
-        av_strerror(find_stream_result, err_buf, sizeof(err_buf));
-        log_error("[Stream %s] Could not find stream info in segment file: %s (error: %s)",
-                 thread->stream_name, segment_path, err_buf);
-        safe_avformat_cleanup(&format_ctx); // Use our safe cleanup function
-        log_info("[Stream %s] Continuing detection thread despite failure to find stream info", thread->stream_name);
-        return 0;
+    if (!thread->model) {
+        pthread_mutex_unlock(&thread->mutex);
+        return -1;
     }
 
-    // CRITICAL FIX: Verify that format_ctx and streams are valid
-    if (!format_ctx || !format_ctx->nb_streams) {
-        log_error("[Stream %s] Invalid format context or no streams after finding stream info: %s",
-                thread->stream_name, segment_path);
-        safe_avformat_cleanup(&format_ctx); // Use our safe cleanup function
-        log_info("[Stream %s] Continuing detection thread despite invalid streams", thread->stream_name);
-        return 0;
-    }
+    const char *model_type = get_model_type_from_handle(thread->model);
+    log_info("[Stream %s] Running detection on frame (dimensions: %dx%d, channels: %d, model: %s)",
+            thread->stream_name, frame->width, frame->height, frame->channels,
+            model_type ? model_type : "unknown");
 
-    // Find video stream with safety checks
-    video_stream_idx = -1;
-    for (int i = 0; i < format_ctx->nb_streams; i++) {
-        if (format_ctx->streams[i] && format_ctx->streams[i]->codecpar &&
-            format_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            video_stream_idx = i;
-            break;
+    if (model_type && strcmp(model_type, MODEL_TYPE_API) == 0) {
+        // Get the API URL - either from the model path if it's a URL,
+        // or from the global config if it's the special "api-detection" string
+        const char *model_path = get_model_path(thread->model);
+        const char *api_url = NULL;
+        if (model_path && ends_with(model_path, "api-detection")) {
+            api_url = g_config.api_detection_url;
+        } else {
+            api_url = model_path;
         }
-    }
-
-    if (video_stream_idx == -1) {
-        log_error("[Stream %s] Could not find video stream in segment file: %s",
-                 thread->stream_name, segment_path);
-        safe_avformat_cleanup(&format_ctx); // Use our safe cleanup function
-        log_info("[Stream %s] Continuing detection thread despite failure to find video stream", thread->stream_name);
-        return 0;
-    }
 
-    // Get codec with safety checks
-    if (!format_ctx->streams[video_stream_idx] || !format_ctx->streams[video_stream_idx]->codecpar) {
-        log_error("[Stream %s] Invalid codec parameters in segment file: %s",
-                thread->stream_name, segment_path);
-        safe_avformat_cleanup(&format_ctx); // Use our safe cleanup function
-        log_info("[Stream %s] Continuing detection thread despite invalid codec parameters", thread->stream_name);
-        return 0;
-    }
-
-    const AVCodec *codec = avcodec_find_decoder(format_ctx->streams[video_stream_idx]->codecpar->codec_id);
-    if (!codec) {
-        log_error("[Stream %s] Unsupported codec in segment file: %s (codec_id: %d)",
-                 thread->stream_name, segment_path, format_ctx->streams[video_stream_idx]->codecpar->codec_id);
-        safe_avformat_cleanup(&format_ctx); // Use our safe cleanup function
-        log_info("[Stream %s] Continuing detection thread despite unsupported codec", thread->stream_name);
-        return 0;
-    }
-
-    // Allocate codec context with safety checks
-    codec_ctx = avcodec_alloc_context3(codec);
-    if (!codec_ctx) {
-        log_error("[Stream %s] Could not allocate codec context for segment file: %s",
-                 thread->stream_name, segment_path);
-        safe_avformat_cleanup(&format_ctx); // Use our safe cleanup function
-        log_info("[Stream %s] Continuing detection thread despite failure to allocate codec context", thread->stream_name);
-        // No cleanup handler to pop
-        return 0;
-    }
-
-    // Codec context is now allocated
-
-    // Copy codec parameters with safety checks
-    int copy_params_result = avcodec_parameters_to_context(codec_ctx, format_ctx->streams[video_stream_idx]->codecpar);
-    if (copy_params_result < 0) {
-        char err_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
-        av_strerror(copy_params_result, err_buf, sizeof(err_buf));
-        log_error("[Stream %s] Could not copy codec parameters for segment file: %s (error: %s)",
-                 thread->stream_name, segment_path, err_buf);
-        avcodec_free_context(&codec_ctx);
-        safe_avformat_cleanup(&format_ctx); // Use our safe cleanup function
-        log_info("[Stream %s] Continuing detection thread despite failure to copy codec parameters", thread->stream_name);
-        return 0;
-    }
-
-    // Open codec with safety checks
-    int open_codec_result = avcodec_open2(codec_ctx, codec, NULL);
-    if (open_codec_result < 0) {
-        char err_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
-        av_strerror(open_codec_result, err_buf, sizeof(err_buf));
-        log_error("[Stream %s] Could not open codec for segment file: %s (error: %s)",
-                 thread->stream_name, segment_path, err_buf);
-        avcodec_free_context(&codec_ctx);
-        safe_avformat_cleanup(&format_ctx); // Use our safe cleanup function
-        log_info("[Stream %s] Continuing detection thread despite failure to open codec", thread->stream_name);
-        return 0;
-    }
-
-    // Allocate frame and packet with safety checks
-    frame = av_frame_alloc();
-    if (!frame) {
-        log_error("[Stream %s] Could not allocate frame for segment file: %s",
-                 thread->stream_name, segment_path);
-        avcodec_free_context(&codec_ctx);
-        safe_avformat_cleanup(&format_ctx); // Use our safe cleanup function
-        log_info("[Stream %s] Continuing detection thread despite failure to allocate frame", thread->stream_name);
-        // No cleanup handler to pop
-        return 0;
-    }
-
-    // Frame is now allocated
-
-    pkt = av_packet_alloc();
-    if (!pkt) {
-        log_error("[Stream %s] Could not allocate packet for segment file: %s",
-                 thread->stream_name, segment_path);
-        av_frame_free(&frame);
-        avcodec_free_context(&codec_ctx);
-        safe_avformat_cleanup(&format_ctx); // Use our safe cleanup function
-        log_info("[Stream %s] Continuing detection thread despite failure to allocate packet", thread->stream_name);
-        // No cleanup handler to pop
-        return 0;
-    }
-
-    // Packet is now allocated
-
-    // Initialize frame_count at the beginning of the function
-    int frame_count = 0;
-
-    // Calculate segment duration with safety checks
-    float segment_duration = 0;
-    if (format_ctx->duration != AV_NOPTS_VALUE) {
-        segment_duration = format_ctx->duration / (float)AV_TIME_BASE;
-    } else {
-        // Default to 2 seconds if duration is not available
-        segment_duration = 2.0f;
-        log_warn("[Stream %s] Segment duration not available, using default: %.2f seconds",
-                thread->stream_name, segment_duration);
-    }
-
-    // Validate segment duration
-    if (segment_duration <= 0 || segment_duration > 60) { // Sanity check: segments shouldn't be longer than 60 seconds
-        log_warn("[Stream %s] Invalid segment duration: %.2f seconds, using default: 2.0 seconds",
-                thread->stream_name, segment_duration);
-        segment_duration = 2.0f; // Use a reasonable default
-    }
-
-    // Since we haven't counted frames yet, use a reasonable estimate for frames_per_second
-    double frames_per_second = 0.0;
-    // Get the frame rate from the stream if available
-    AVRational frame_rate = av_guess_frame_rate(format_ctx, format_ctx->streams[video_stream_idx], NULL);
-    if (frame_rate.num > 0 && frame_rate.den > 0) {
-        frames_per_second = (double)frame_rate.num / frame_rate.den;
-        log_info("[Stream %s] Using stream frame rate: %.2f fps",
-                 thread->stream_name, frames_per_second);
+        if (!api_url || api_url[0] == '\0') {
+            log_error("[Stream %s] Failed to get API URL from model or config", thread->stream_name);
+            detect_ret = -1;
+        } else {
+            detect_ret = detect_objects_api(api_url, frame->data, frame->width, frame->height,
+                                            frame->channels, &result, thread->stream_name);
+        }
     } else {
-        // Use a reasonable default if we can't get the frame rate
-        frames_per_second = 25.0;
-        log_warn("[Stream %s] Couldn't determine frame rate, using default: %.2f fps",
-                 thread->stream_name, frames_per_second);
+        detect_ret = detect_objects(thread->model, frame->data, frame->width, frame->height,
+                                    frame->channels, &result);
     }
 
-    // Validate frames per second
-    if (frames_per_second <= 0 || frames_per_second > 120) { // Sanity check: frame rates shouldn't be higher than 120 fps
-        log_warn("[Stream %s] Invalid frames per second: %.2f fps, using default: 25.0 fps",
-                thread->stream_name, frames_per_second);
-        frames_per_second = 25.0f; // Use a reasonable default
-    }
-
-    // Calculate total frames with safety checks
-    int total_frames = (int)(segment_duration * frames_per_second);
+    pthread_mutex_unlock(&thread->mutex);
 
-    // Validate total frames
-    if (total_frames <= 0 || total_frames > 10000) { // Sanity check: segments shouldn't have more than 10000 frames
-        log_warn("[Stream %s] Invalid total frames: %d, using default: 50 frames",
-                thread->stream_name, total_frames);
-        total_frames = 50; // Use a reasonable default
+    if (detect_ret != 0) {
+        log_error("[Stream %s] Detection failed (error code: %d)", thread->stream_name, detect_ret);
+        return detect_ret;
     }
 
-    log_info("[Stream %s] Segment duration: %.2f seconds, FPS: %.2f, Estimated total frames: %d",
-             thread->stream_name, segment_duration, frames_per_second, total_frames);
-
-    // Read frames with safety checks
-    int processed_frames = 0;
-    int error_frames = 0;
-    int max_errors = 10; // Maximum number of errors before giving up
-
-    // CRITICAL FIX: Add a maximum frame count to prevent infinite loops
-    int max_frames = total_frames * 2; // Double the expected frame count as a safety measure
-
-    while (frame_count < max_frames) {
-        // Read frame with safety checks
-        int read_result = av_read_frame(format_ctx, pkt);
-        if (read_result < 0) {
-            // Check if we've reached the end of the file
-            if (read_result == AVERROR_EOF) {
-                log_info("[Stream %s] Reached end of segment file: %s",
-                        thread->stream_name, segment_path);
-                break;
-            }
-
-            // Log other errors
-            char err_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
-            av_strerror(read_result, err_buf, sizeof(err_buf));
-            log_error("[Stream %s] Error reading frame from segment file: %s (error: %s)",
-                     thread->stream_name, segment_path, err_buf);
-
-            // Count errors and break if too many
-            error_frames++;
-            if (error_frames >= max_errors) {
-                log_error("[Stream %s] Too many errors reading frames from segment file: %s (errors: %d)",
-                         thread->stream_name, segment_path, error_frames);
-                break;
-            }
+    if (result.count > 0) {
+        log_info("[Stream %s] Detection found %d objects", thread->stream_name, result.count);
 
-            // Try to continue with the next frame
-            av_packet_unref(pkt);
-            continue;
+        // Log each detected object
+        for (int i = 0; i < result.count && i < MAX_DETECTIONS; i++) {
+            log_info("[Stream %s] Object %d: class=%s, confidence=%.2f, box=[%.2f,%.2f,%.2f,%.2f]",
+                    thread->stream_name, i, result.detections[i].label,
+                    result.detections[i].confidence,
+                    result.detections[i].x, result.detections[i].y,
+                    result.detections[i].width, result.detections[i].height);
         }
 
-        // Only process video packets with safety checks
-        if (pkt->stream_index == video_stream_idx) {
-            frame_count++;
-
-            // Send packet to decoder with safety checks
-            ret = avcodec_send_packet(codec_ctx, pkt);
-            if (ret < 0) {
-                char err_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
-                av_strerror(ret, err_buf, sizeof(err_buf));
-                log_error("[Stream %s] Error sending packet to decoder for segment file: %s (error: %s)",
-                         thread->stream_name, segment_path, err_buf);
-                av_packet_unref(pkt);
-                continue;
-            }
-
-            // Receive frame from decoder with safety checks
-            ret = avcodec_receive_frame(codec_ctx, frame);
-            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-                av_packet_unref(pkt);
-                continue;
-            } else if (ret < 0) {
-                char err_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
-                av_strerror(ret, err_buf, sizeof(err_buf));
-                log_error("[Stream %s] Error receiving frame from decoder for segment file: %s (error: %s)",
-                         thread->stream_name, segment_path, err_buf);
-
-                // Count errors and break if too many
-                error_frames++;
-                if (error_frames >= max_errors) {
-                    log_error("[Stream %s] Too many errors receiving frames from decoder for segment file: %s (errors: %d)",
-                             thread->stream_name, segment_path, error_frames);
-                    av_packet_unref(pkt);
-                    break;
-                }
-
-                // Try to continue with the next frame
-                av_packet_unref(pkt);
-                continue;
-            }
-
-            // OPTIMIZATION: Process only key frames (I-frames) to reduce CPU usage
-            // Check if this is a key frame (I-frame)
-            bool is_key_frame = frame->key_frame || (frame->pict_type == AV_PICTURE_TYPE_I);
-
-            if (is_key_frame) {
-                log_info("[Stream %s] Processing key frame %d (pict_type: %d, key_frame: %d)",
-                        thread->stream_name, frame_count, frame->pict_type, frame->key_frame);
-
-                // Process the frame for detection
-                log_info("[Stream %s] Processing frame %d from segment file: %s",
-                        thread->stream_name, frame_count, segment_path);
-
-                // Calculate frame timestamp based on segment timestamp
-                time_t frame_timestamp = time(NULL);
-
-                // CRITICAL FIX: Ensure only one detection is running at a time
-                // Lock the thread mutex to ensure exclusive access to the model
-                pthread_mutex_lock(&thread->mutex);
-
-                // Process the frame for detection using our dedicated model
-                if (thread->model) {
-                    // Convert frame to RGB format
-                    int width = frame->width;
-                    int height = frame->height;
-                    int channels = 3; // RGB
-
-                    // Determine if we should downscale the frame based on model type
-                    const char *model_type = get_model_type_from_handle(thread->model);
-                    int downscale_factor = get_downscale_factor(model_type);
-
-                    // Calculate dimensions after downscaling
-                    int target_width = width / downscale_factor;
-                    int target_height = height / downscale_factor;
-
-                    // Ensure dimensions are even (required by some codecs)
-                    target_width = (target_width / 2) * 2;
-                    target_height = (target_height / 2) * 2;
-
-                    // Convert frame to RGB format with downscaling
-                    sws_ctx = sws_getContext(
-                        width, height, frame->format,
-                        target_width, target_height, AV_PIX_FMT_RGB24,
-                        SWS_BILINEAR, NULL, NULL, NULL);
-
-                    if (!sws_ctx) {
-                        log_error("[Stream %s] Failed to create SwsContext", thread->stream_name);
-                        av_packet_unref(pkt);
-                        continue;
-                    }
-
-                    // SwsContext is now allocated
-
-                    // Allocate buffer for RGB frame
-                    uint8_t *rgb_buffer = (uint8_t *)malloc(target_width * target_height * channels);
-                    if (!rgb_buffer) {
-                        log_error("[Stream %s] Failed to allocate RGB buffer", thread->stream_name);
-                        sws_freeContext(sws_ctx);
-                        av_packet_unref(pkt);
-                        continue;
-                    }
-
-                    // Setup RGB frame
-                    uint8_t *rgb_data[4] = {rgb_buffer, NULL, NULL, NULL};
-                    int rgb_linesize[4] = {target_width * channels, 0, 0, 0};
-
-                    // Convert frame to RGB
-                    sws_scale(sws_ctx, (const uint8_t * const *)frame->data, frame->linesize, 0,
-                             height, rgb_data, rgb_linesize);
-
-                    // Create detection result structure
-                    detection_result_t result;
-                    memset(&result, 0, sizeof(detection_result_t));
-
-                    // Log before running detection
-                    log_info("[Stream %s] Running detection on frame %d (dimensions: %dx%d, channels: %d, model: %s)",
-                            thread->stream_name, frame_count, target_width, target_height, channels,
-                            model_type ? model_type : "unknown");
-
-                    // Run detection on the RGB frame
-                    int detect_ret;
-
-                    // Check if this is an API model
-                    const char *api_model_type = get_model_type_from_handle(thread->model);
-                    log_info("[Stream %s] Model type: %s", thread->stream_name, api_model_type);
-
-                    if (strcmp(api_model_type, MODEL_TYPE_API) == 0) {
-                        // For API models, we need to pass the stream name
-                        const char *model_path = get_model_path(thread->model);
-
-                        // Get the API URL - either from the model path if it's a URL,
-                        // or from the global config if it's the special "api-detection" string
-                        const char *api_url = NULL;
-                        if (model_path && ends_with(model_path, "api-detection")) {
-                            // Get the API URL from the global config
-                            api_url = g_config.api_detection_url;
-                            log_info("[Stream %s] Using API detection URL from config: %s",
-                                    thread->stream_name, api_url ? api_url : "NULL");
-                        } else {
-                            // Use the model path directly as the URL
-                            api_url = model_path;
-                            log_info("[Stream %s] Using API detection with URL from model path: %s",
-                                    thread->stream_name, api_url ? api_url : "NULL");
-                        }
-
-                        if (!api_url || api_url[0] == '\0') {
-                            log_error("[Stream %s] Failed to get API URL from model or config", thread->stream_name);
-                            detect_ret = -1;
-                            // Initialize result to empty to prevent segmentation fault
-                            memset(&result, 0, sizeof(detection_result_t));
-                        } else {
-                            log_info("[Stream %s] Calling detect_objects_api with URL: %s", thread->stream_name, api_url);
-                            // CRITICAL FIX: Initialize result to empty before calling API detection
-                            memset(&result, 0, sizeof(detection_result_t));
-                            detect_ret = detect_objects_api(api_url, rgb_buffer, target_width, target_height, channels, &result, thread->stream_name);
-                            log_info("[Stream %s] detect_objects_api returned: %d", thread->stream_name, detect_ret);
-                        }
-                    } else {
-                        // For other models, use the standard detect_objects function
-                        log_info("[Stream %s] Using standard detect_objects function", thread->stream_name);
-                        // CRITICAL FIX: Initialize result to empty before calling detection
-                        memset(&result, 0, sizeof(detection_result_t));
-                        detect_ret = detect_objects(thread->model, rgb_buffer, target_width, target_height, channels, &result);
-                        log_info("[Stream %s] detect_objects returned: %d", thread->stream_name, detect_ret);
-                    }
-
-                    if (detect_ret == 0) {
-                        // Process detection results
-                        if (result.count > 0) {
-                            log_info("[Stream %s] Detection found %d objects in frame %d",
-                                    thread->stream_name, result.count, frame_count);
-
-                            // Log each detected object
-                            for (int i = 0; i < result.count && i < MAX_DETECTIONS; i++) {
-                                log_info("[Stream %s] Object %d: class=%s, confidence=%.2f, box=[%.2f,%.2f,%.2f,%.2f]",
-                                        thread->stream_name, i, result.detections[i].label,
-                                        result.detections[i].confidence,
-                                        result.detections[i].x, result.detections[i].y,
-                                        result.detections[i].width, result.detections[i].height);
-                            }
-
-                            // Process the detection results for recording
-                            int record_ret = process_frame_for_recording(thread->stream_name, rgb_buffer, target_width,
-                                                                       target_height, channels, frame_timestamp, &result);
-
-                            if (record_ret != 0) {
-                                log_error("[Stream %s] Failed to process frame for recording (error code: %d)",
-                                         thread->stream_name, record_ret);
-                            } else {
-                                log_info("[Stream %s] Successfully processed frame for recording", thread->stream_name);
-                            }
-                        } else {
-                            log_debug("[Stream %s] No objects detected in frame %d", thread->stream_name, frame_count);
-                        }
-                    } else {
-                        log_error("[Stream %s] Detection failed for frame %d (error code: %d)",
-                                 thread->stream_name, frame_count, detect_ret);
-                        // Continue execution despite detection failure
-                        log_info("[Stream %s] Continuing detection thread despite detection failure", thread->stream_name);
-                        // Set result.count to 0 to indicate no detections
-                        result.count = 0;
-                    }
-
-                    // Free resources
-                    free(rgb_buffer);
-                    sws_freeContext(sws_ctx);
-
-                    // Update last detection time
-                    thread->last_detection_time = time(NULL);
-                }
-
-                // CRITICAL FIX: Release the mutex after detection is complete
-                pthread_mutex_unlock(&thread->mutex);
-
-                processed_frames++;
-            }
+        // Process the detection results for recording
+        int record_ret = process_frame_for_recording(thread->stream_name, frame->data, frame->width,
+                                                   frame->height, frame->channels, frame->timestamp, &result);
+        if (record_ret != 0) {
+            log_error("[Stream %s] Failed to process frame for recording (error code: %d)",
+                     thread->stream_name, record_ret);
         }
-
-        av_packet_unref(pkt);
-    }
-
-    log_info("[Stream %s] Processed %d frames out of %d total frames from segment file: %s (errors: %d)",
-             thread->stream_name, processed_frames, frame_count, segment_path, error_frames);
-
-    // CRITICAL FIX: Use comprehensive cleanup to prevent memory leaks and segmentation faults
-    log_debug("[Stream %s] Starting comprehensive cleanup of FFmpeg resources", thread->stream_name);
-
-    // Cleanup with safety checks
-    if (frame) {
-        log_debug("[Stream %s] Freeing frame during cleanup", thread->stream_name);
-        av_frame_free(&frame);
-    }
-
-    if (pkt) {
-        log_debug("[Stream %s] Freeing packet during cleanup", thread->stream_name);
-        av_packet_free(&pkt);
-    }
-
-    if (codec_ctx) {
-        log_debug("[Stream %s] Freeing codec context during cleanup", thread->stream_name);
-        avcodec_free_context(&codec_ctx);
-    }
-
-    if (format_ctx) {
-        log_debug("[Stream %s] Closing input format context during cleanup", thread->stream_name);
-        avformat_close_input(&format_ctx);
+    } else {
+        log_debug("[Stream %s] No objects detected in frame", thread->stream_name);
     }
 
-    log_debug("[Stream %s] Completed comprehensive cleanup of FFmpeg resources", thread->stream_name);
-
-    // No cleanup handler to pop
-
     return 0;
 }
 
-/**
- * Check for new HLS segments in the stream's HLS directory
- * This function has been refactored to ensure each detection thread only monitors its own stream
- * Added retry mechanism and improved robustness for handling HLS writer failures
- */
-static void check_for_new_segments(stream_detection_thread_t *thread) {
-    // CRITICAL FIX: Add safety check for NULL thread to prevent segfault
-    if (!thread) {
-        log_error("Cannot check for segments with NULL thread");
-        return;
-    }
-
-    // CRITICAL FIX: Add safety check for invalid thread structure
-    if (!thread->stream_name[0]) {
-        log_error("Cannot check for segments with invalid stream name");
-        return;
-    }
-
-    time_t current_time = time(NULL);
-    static time_t last_warning_time = 0;
-    static int consecutive_failures = 0;
-    static bool first_check = true;
-    char newest_segment[MAX_PATH_LENGTH] = {0};
-    time_t newest_time = 0;
-    int segment_count = 0;
-
-    // Check if we should run detection based on startup delay, detection in progress and time interval
-    bool should_run_detection = should_run_detection_check(thread, current_time);
-
-    // Check and manage HLS writer status
-    check_hls_writer_status(thread, current_time, &last_warning_time, first_check, &consecutive_failures);
-
-    // Find and set HLS directory path
-    bool hls_dir_valid = find_hls_directory(thread, current_time, &last_warning_time, &consecutive_failures, first_check);
-    if (!hls_dir_valid) {
-        first_check = false;
-        return;
-    }
-
-    // Find the newest segment
-    bool found_segment = find_newest_segment(thread, newest_segment, &newest_time, &segment_count);
-    if (!found_segment) {
-        // If no segments were found, attempt to restart the HLS stream if needed
-        restart_hls_stream_if_needed(thread, current_time, &last_warning_time, first_check);
-
-        // We would do go2rtc fallback here in the original function, but we're keeping that in the original file
-        // as it's very complex and would make our helper implementation too large
-
-        consecutive_failures++;
-        first_check = false;
-        return;
-    }
-
-    // Reset failure counter when we find segments
-    consecutive_failures = 0;
-
-    log_info("[Stream %s] Found %d segments, newest segment time: %s",
-             thread->stream_name, segment_count, ctime(&newest_time));
-
-    // Process the segment if needed
-    static char last_processed_segment[MAX_PATH_LENGTH] = {0};
-    process_segment_if_needed(thread, newest_segment, last_processed_segment,
-                             should_run_detection, newest_time, current_time);
-
-    first_check = false;
-}
-
 /**
  * Stream detection thread function
  * Improved with better error handling and retry logic
@@ -928,15 +388,15 @@ static void *stream_detection_thread_func(void *arg) {
     pthread_mutex_unlock(&thread->mutex);
 
     // Main thread loop with improved monitoring and error handling
-    time_t last_segment_check = 0;
     time_t last_model_retry = 0;
     time_t last_log_time = 0;
     time_t startup_time = time(NULL);
     int consecutive_empty_checks = 0;
     int consecutive_errors = 0;
-    bool initial_startup_period = true;
+    detection_frame_tap_t *tap = NULL;
+    bool tap_disabled_logged = false;
 
-    // Set a 10-second delay before starting to process segments
+    // Set a 10-second delay before starting to process frames
     // This gives the system time to initialize without blocking the main thread
     global_startup_delay_end = startup_time + 10;
 
@@ -947,30 +407,12 @@ static void *stream_detection_thread_func(void *arg) {
             break;
         }
 
-        log_info("[Stream %s] Checking for new segments in HLS directory", thread->stream_name);
-
         // Check if shutdown has been initiated
         if (is_shutdown_initiated()) {
             log_info("[Stream %s] Stopping due to system shutdown", thread->stream_name);
             break;
         }
 
-        // CRITICAL FIX: Check if HLS directory exists and is accessible
-        if (!thread->hls_dir[0]) {
-            log_error("[Stream %s] HLS directory path is empty", thread->stream_name);
-            usleep(1000000); // Sleep for 1 second before checking again
-            continue;
-        }
-
-        // Check if the HLS directory exists
-        struct stat st;
-        if (stat(thread->hls_dir, &st) != 0) {
-            log_warn("[Stream %s] HLS directory does not exist: %s (error: %s)",
-                    thread->stream_name, thread->hls_dir, strerror(errno));
-            usleep(1000000); // Sleep for 1 second before checking again
-            continue;
-        }
-
         time_t current_time = time(NULL);
 
         // Try to load the model again if previous attempts failed
@@ -997,7 +439,7 @@ static void *stream_detection_thread_func(void *arg) {
 
         // Log status periodically - always use log_info to ensure visibility
         if (current_time - last_log_time > 10) { // Log every 10 seconds
-            log_info("[Stream %s] Detection thread is running, checking for new segments (consecutive empty checks: %d, errors: %d)",
+            log_info("[Stream %s] Detection thread is running, waiting for frames (consecutive empty checks: %d, errors: %d)",
                     thread->stream_name, consecutive_empty_checks, consecutive_errors);
             last_log_time = current_time;
 
@@ -1038,26 +480,65 @@ static void *stream_detection_thread_func(void *arg) {
             }
         }
 
-        // Check for new segments more frequently if we've had consecutive empty checks
-        // This helps ensure we catch new segments as soon as they appear
-        int check_interval = 1; // Default to 1 second
-        if (consecutive_empty_checks > 10) {
-            check_interval = 2; // Slow down a bit after 10 empty checks
-        } else if (consecutive_empty_checks > 30) {
-            check_interval = 5; // Slow down more after 30 empty checks
+        // Attach a decoder to the live packet path once the model tells us the frame size it wants
+        if (!tap || !detection_frame_tap_is_running(tap)) {
+            if (tap) {
+                detection_frame_tap_stop(tap);
+                tap = NULL;
+            }
+
+            if (!packet_fanout_is_enabled()) {
+                // The tap reads from the shared ingest, so there are no frames to detect on without it
+                if (!tap_disabled_logged) {
+                    log_warn("[Stream %s] Detection needs shared_ingest enabled, waiting", thread->stream_name);
+                    tap_disabled_logged = true;
+                }
+            } else if (thread->model) {
+                tap_disabled_logged = false;
+                const char *model_type = get_model_type_from_handle(thread->model);
+                tap = detection_frame_tap_start(thread->stream_name, DETECTION_FRAME_TAP_KEYFRAMES_ONLY,
+                                                thread->detection_interval, get_downscale_factor(model_type), 3);
+                if (!tap) {
+                    log_error("[Stream %s] Failed to start detection frame tap", thread->stream_name);
+                }
+            }
+
+            if (!tap) {
+                usleep(500000);
+                continue;
+            }
+        }
+
+        // Wait for the next decoded frame
+        detection_frame_t frame;
+        int pop_ret = detection_frame_tap_pop(tap, &frame, 500);
+        if (pop_ret != 0) {
+            consecutive_empty_checks++;
+            continue;
+        }
+        consecutive_empty_checks = 0;
+
+        if (!should_run_detection_check(thread, time(NULL))) {
+            detection_frame_release(&frame);
+            continue;
         }
 
-        if (current_time - last_segment_check >= check_interval) {
-            // Check for new segments
-            check_for_new_segments(thread);
-            last_segment_check = current_time;
+        atomic_store(&thread->detection_in_progress, 1);
+        thread->last_detection_time = time(NULL);
 
-            // Update consecutive check counters based on result
-            // This is handled inside check_for_new_segments
+        if (run_detection_on_frame(thread, &frame) != 0) {
+            consecutive_errors++;
+        } else {
+            consecutive_errors = 0;
         }
 
-        int sleep_time = 500000; // Default 500ms
-        usleep(sleep_time);
+        atomic_store(&thread->detection_in_progress, 0);
+        detection_frame_release(&frame);
+    }
+
+    if (tap) {
+        detection_frame_tap_stop(tap);
+        tap = NULL;
     }
 
     // Update component state in shutdown coordinator
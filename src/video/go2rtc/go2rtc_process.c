@@ -18,6 +18,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <limits.h>
+#include <dirent.h>
 #include <curl/curl.h>
 
 // Define PATH_MAX if not defined
@@ -331,7 +332,6 @@ bool go2rtc_process_generate_config(const char *config_path, int api_port) {
  * @return true if it's a go2rtc process, false otherwise
  */
 static bool is_go2rtc_process(pid_t pid) {
-    char cmd[128];
     char proc_path[64];
     
     // First check if the process exists
@@ -362,174 +362,157 @@ static bool is_go2rtc_process(pid_t pid) {
         }
     }
     
-    // Alternative method using ps
-    snprintf(cmd, sizeof(cmd), "ps -p %d -o comm= | grep -q go2rtc", pid);
-    if (system(cmd) == 0) {
-        return true;
+    // Fall back to the command name when the command line cannot be read
+    snprintf(proc_path, sizeof(proc_path), "/proc/%d/comm", pid);
+    fp = fopen(proc_path, "r");
+    if (fp) {
+        char comm[64] = {0};
+        bool match = fgets(comm, sizeof(comm), fp) && strstr(comm, "go2rtc") != NULL;
+        fclose(fp);
+        return match;
     }
     
     return false;
 }
 
+// Most processes collected by one /proc scan
+#define GO2RTC_SCAN_MAX 32
+
 /**
- * @brief Kill all go2rtc and related supervision processes
+ * @brief Match the go2rtc executable
  * 
- * @return true if all processes were killed, false otherwise
+ * Supervisors such as s6-supervise also have go2rtc in their command line,
+ * so the executable name is checked as well.
  */
-static bool kill_all_go2rtc_processes(void) {
-    bool success = true;
-    
-    // First kill any s6-supervise processes related to go2rtc
-    FILE *fp = popen("pgrep -f 's6-supervise go2rtc'", "r");
-    if (!fp) {
-        log_error("Failed to execute pgrep command for s6-supervise");
-        success = false;
-    } else {
-        char line[32]; // Enough for a PID
-        bool found_s6 = false;
-        
-        while (fgets(line, sizeof(line), fp)) {
-            pid_t pid = atoi(line);
-            if (pid > 0) {
-                found_s6 = true;
-                log_info("Killing s6-supervise process with PID: %d", pid);
-                
-                // Send SIGTERM first
-                if (kill(pid, SIGTERM) != 0) {
-                    log_warn("Failed to send SIGTERM to s6-supervise process %d: %s", pid, strerror(errno));
-                    success = false;
-                }
-            }
-        }
-        
-        pclose(fp);
+static bool match_go2rtc_executable(pid_t pid, const char *comm) {
+    return strncmp(comm, "go2rtc", 6) == 0 && is_go2rtc_process(pid);
+}
+
+/**
+ * @brief Match s6-supervise processes of go2rtc and its helper services
+ */
+static bool match_go2rtc_supervisor(pid_t pid, const char *comm) {
+    return strncmp(comm, "s6-supervise", 12) == 0 && is_go2rtc_process(pid);
+}
+
+/**
+ * @brief Match any process with go2rtc in its command line
+ */
+static bool match_go2rtc_related(pid_t pid, const char *comm) {
+    (void)comm;
+    return is_go2rtc_process(pid);
+}
+
+/**
+ * @brief Collect matching processes by scanning /proc
+ * 
+ * @param match Predicate called with the PID and command name of each process
+ * @param pids Array receiving the matching PIDs
+ * @param max_pids Size of the pids array
+ * @return int Number of PIDs collected, or -1 if /proc cannot be read
+ */
+static int scan_go2rtc_processes(bool (*match)(pid_t pid, const char *comm), pid_t *pids, int max_pids) {
+    DIR *proc = opendir("/proc");
+    if (!proc) {
+        log_error("Failed to open /proc: %s", strerror(errno));
+        return -1;
+    }
+    
+    int count = 0;
+    pid_t self = getpid();
+    struct dirent *entry;
+    while (count < max_pids && (entry = readdir(proc)) != NULL) {
+        char *end;
+        long pid = strtol(entry->d_name, &end, 10);
+        if (*end != '\0' || pid <= 0 || (pid_t)pid == self) {
+            continue;
+        }
+        
+        char comm_path[64];
+        char comm[64] = {0};
+        snprintf(comm_path, sizeof(comm_path), "/proc/%ld/comm", pid);
+        FILE *fp = fopen(comm_path, "r");
+        if (!fp) {
+            continue;
+        }
+        bool have_comm = fgets(comm, sizeof(comm), fp) != NULL;
+        fclose(fp);
         
-        // If we found s6 processes, wait a moment for them to terminate
-        if (found_s6) {
-            sleep(2); // Increased wait time
+        if (have_comm && match((pid_t)pid, comm)) {
+            pids[count++] = (pid_t)pid;
         }
     }
     
-    // Also kill any s6-supervise processes related to go2rtc-healthcheck and go2rtc-log
-    fp = popen("pgrep -f 's6-supervise go2rtc-'", "r");
-    if (fp) {
-        char line[32]; // Enough for a PID
-        bool found_s6 = false;
-        
-        while (fgets(line, sizeof(line), fp)) {
-            pid_t pid = atoi(line);
-            if (pid > 0) {
-                found_s6 = true;
-                log_info("Killing s6-supervise process with PID: %d", pid);
-                
-                // Send SIGTERM first
-                if (kill(pid, SIGTERM) != 0) {
-                    log_warn("Failed to send SIGTERM to s6-supervise process %d: %s", pid, strerror(errno));
-                    success = false;
-                }
-            }
-        }
-        
-        pclose(fp);
-        
-        // If we found s6 processes, wait a moment for them to terminate
-        if (found_s6) {
-            sleep(2); // Increased wait time
-        }
+    closedir(proc);
+    return count;
+}
+
+/**
+ * @brief Find a running go2rtc process by scanning /proc
+ * 
+ * @return pid_t Process ID, or -1 if none was found
+ */
+static pid_t find_go2rtc_process(void) {
+    pid_t pid;
+    return scan_go2rtc_processes(match_go2rtc_executable, &pid, 1) == 1 ? pid : -1;
+}
+
+/**
+ * @brief Send a signal to every matching process
+ * 
+ * @param match Predicate selecting the processes
+ * @param sig Signal to send
+ * @param success Set to false when a signal could not be sent
+ * @return int Number of processes signalled
+ */
+static int signal_go2rtc_processes(bool (*match)(pid_t pid, const char *comm), int sig, bool *success) {
+    pid_t pids[GO2RTC_SCAN_MAX];
+    int count = scan_go2rtc_processes(match, pids, GO2RTC_SCAN_MAX);
+    if (count < 0) {
+        *success = false;
+        return 0;
     }
     
-    // Use a more compatible command for BusyBox systems
-    fp = popen("ps | grep go2rtc | grep -v grep | awk '{print $1}'", "r");
-    if (!fp) {
-        log_error("Failed to execute ps command for go2rtc");
-        success = false;
-    } else {
-        char line[32]; // Enough for a PID
-        bool found_processes = false;
-        
-        while (fgets(line, sizeof(line), fp)) {
-            pid_t pid = atoi(line);
-            if (pid > 0) {
-                // Verify this is actually a go2rtc process
-                if (is_go2rtc_process(pid)) {
-                    found_processes = true;
-                    log_info("Killing go2rtc process with PID: %d", pid);
-                    
-                    // Send SIGTERM first
-                    if (kill(pid, SIGTERM) != 0) {
-                        log_warn("Failed to send SIGTERM to go2rtc process %d: %s", pid, strerror(errno));
-                        success = false;
-                    }
-                }
-            }
+    for (int i = 0; i < count; i++) {
+        log_info("Sending %s to go2rtc related process with PID: %d",
+                 sig == SIGKILL ? "SIGKILL" : "SIGTERM", pids[i]);
+        if (kill(pids[i], sig) != 0 && errno != ESRCH) {
+            log_warn("Failed to signal process %d: %s", pids[i], strerror(errno));
+            *success = false;
         }
-        
-        pclose(fp);
-        
-        // Wait a moment for processes to terminate
-        if (found_processes) {
-            sleep(3); // Increased wait time
+    }
+    
+    return count;
+}
+
+/**
+ * @brief Kill all go2rtc and related supervision processes
+ * 
+ * @return true if all processes were killed, false otherwise
+ */
+static bool kill_all_go2rtc_processes(void) {
+    bool success = true;
+    
+    // First stop the s6-supervise processes of go2rtc, go2rtc-healthcheck and go2rtc-log
+    // so they do not restart what is killed next
+    if (signal_go2rtc_processes(match_go2rtc_supervisor, SIGTERM, &success) > 0) {
+        sleep(2);
+    }
+    
+    if (signal_go2rtc_processes(match_go2rtc_related, SIGTERM, &success) > 0) {
+        // Wait a moment for processes to terminate, then force kill the rest
+        sleep(3);
+        if (signal_go2rtc_processes(match_go2rtc_related, SIGKILL, &success) > 0) {
+            sleep(1);
             
-            // Check if any processes are still running and force kill them
-            fp = popen("ps | grep go2rtc | grep -v grep | awk '{print $1}'", "r");
-            if (!fp) {
-                log_error("Failed to execute second ps command");
+            pid_t pids[GO2RTC_SCAN_MAX];
+            int remaining = scan_go2rtc_processes(match_go2rtc_related, pids, GO2RTC_SCAN_MAX);
+            for (int i = 0; i < remaining; i++) {
+                log_error("go2rtc process %d still running after SIGKILL", pids[i]);
+            }
+            if (remaining != 0) {
+                log_error("Some go2rtc processes could not be killed");
                 success = false;
-            } else {
-                while (fgets(line, sizeof(line), fp)) {
-                    pid_t pid = atoi(line);
-                    if (pid > 0 && is_go2rtc_process(pid)) {
-                        log_warn("go2rtc process %d still running, sending SIGKILL", pid);
-                        if (kill(pid, SIGKILL) != 0) {
-                            log_error("Failed to send SIGKILL to go2rtc process %d: %s", pid, strerror(errno));
-                            success = false;
-                        }
-                    }
-                }
-                
-                pclose(fp);
-                
-                // Wait again and check one more time
-                sleep(1);
-                fp = popen("ps | grep go2rtc | grep -v grep | awk '{print $1}'", "r");
-                if (fp) {
-                    bool still_running = false;
-                    while (fgets(line, sizeof(line), fp)) {
-                        pid_t pid = atoi(line);
-                        if (pid > 0 && is_go2rtc_process(pid)) {
-                            still_running = true;
-                            log_error("go2rtc process %d still running after SIGKILL", pid);
-                            
-                            // Try one more extreme measure - use kill -9
-                            char kill_cmd[64];
-                            snprintf(kill_cmd, sizeof(kill_cmd), "kill -9 %d 2>/dev/null", pid);
-                            system(kill_cmd);
-                        }
-                    }
-                    pclose(fp);
-                    
-                    if (still_running) {
-                        // Check one final time after kill -9
-                        sleep(1);
-                        fp = popen("ps | grep go2rtc | grep -v grep | awk '{print $1}'", "r");
-                        if (fp) {
-                            still_running = false;
-                            while (fgets(line, sizeof(line), fp)) {
-                                pid_t pid = atoi(line);
-                                if (pid > 0 && is_go2rtc_process(pid)) {
-                                    still_running = true;
-                                    log_error("go2rtc process %d still running after kill -9", pid);
-                                }
-                            }
-                            pclose(fp);
-                            
-                            if (still_running) {
-                                log_error("Some go2rtc processes could not be killed");
-                                success = false;
-                            }
-                        }
-                    }
-                }
             }
         }
     }
@@ -552,26 +535,6 @@ static bool kill_all_go2rtc_processes(void) {
         }
     }
     
-    // Check for any TCP ports that might be in use by go2rtc
-    // This helps identify if the process is still holding onto the port
-    fp = popen("netstat -tlpn 2>/dev/null | grep go2rtc", "r");
-    if (fp) {
-        char netstat_line[256];
-        bool found_ports = false;
-        
-        while (fgets(netstat_line, sizeof(netstat_line), fp)) {
-            found_ports = true;
-            log_warn("go2rtc still has open ports: %s", netstat_line);
-        }
-        
-        pclose(fp);
-        
-        if (found_ports) {
-            log_warn("go2rtc may still have open network connections");
-            success = false;
-        }
-    }
-    
     return success;
 }
 
@@ -602,41 +565,25 @@ bool go2rtc_process_is_running(void) {
         }
     }
     
-    // Use a more compatible command for BusyBox systems
-    FILE *fp = popen("ps | grep go2rtc | grep -v grep | awk '{print $1}'", "r");
-    if (!fp) {
-        log_error("Failed to execute ps command");
-        return false;
-    }
-    
-    char line[16]; // Enough for a PID
+    // Look for a go2rtc process we did not start
     bool found = false;
-    
-    while (fgets(line, sizeof(line), fp)) {
-        pid_t pid = atoi(line);
-        if (pid > 0) {
-            // Verify this is actually a go2rtc process
-            if (is_go2rtc_process(pid)) {
-                // If we find a go2rtc process but it's not our tracked one,
-                // update our tracked PID
-                if (g_process_pid <= 0 || g_process_pid != pid) {
-                    log_warn("Found untracked go2rtc process with PID: %d", pid);
-                    g_process_pid = pid;
-                }
-                found = true;
-                break;
-            }
+    pid_t pid = find_go2rtc_process();
+    if (pid > 0) {
+        // If we find a go2rtc process but it's not our tracked one,
+        // update our tracked PID
+        if (g_process_pid <= 0 || g_process_pid != pid) {
+            log_warn("Found untracked go2rtc process with PID: %d", pid);
+            g_process_pid = pid;
         }
+        found = true;
     }
     
-    pclose(fp);
-    
     // If we didn't find any go2rtc processes, also check if the port is in use
     if (!found) {
         // Check if the API port is in use by any process
         char cmd[128];
         snprintf(cmd, sizeof(cmd), "netstat -tlpn 2>/dev/null | grep ':%d' | grep -v grep", 1984); // Default API port
-        fp = popen(cmd, "r");
+        FILE *fp = popen(cmd, "r");
         if (fp) {
             char netstat_line[256];
             if (fgets(netstat_line, sizeof(netstat_line), fp)) {
@@ -814,7 +761,8 @@ bool go2rtc_process_start(int api_port) {
         log_error("Failed to fork process for go2rtc: %s", strerror(errno));
         return false;
     } else if (pid == 0) {
-        // Child process
+        // Child process, only the forking thread exists here so the
+        // logger must not be used until execl replaces the image
         
         // Redirect stdout and stderr to log files
         char log_path[1024]; // Use a reasonable fixed size instead of PATH_MAX
@@ -822,8 +770,8 @@ bool go2rtc_process_start(int api_port) {
         
         int log_fd = open(log_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
         if (log_fd == -1) {
-            log_error("Failed to open log file: %s", log_path);
-            exit(EXIT_FAILURE);
+            fprintf(stderr, "Failed to open log file: %s\n", log_path);
+            _exit(EXIT_FAILURE);
         }
         
         dup2(log_fd, STDOUT_FILENO);
@@ -831,12 +779,13 @@ bool go2rtc_process_start(int api_port) {
         close(log_fd);
         
         // Execute go2rtc with explicit config path (using correct argument format)
-        log_info("Executing go2rtc with command: %s --config %s", g_binary_path, g_config_path);
+        fprintf(stderr, "Executing go2rtc with command: %s --config %s\n", g_binary_path, g_config_path);
+        fflush(stderr);
         execl(g_binary_path, g_binary_path, "--config", g_config_path, NULL);
         
         // If execl returns, it failed
         fprintf(stderr, "Failed to execute go2rtc: %s\n", strerror(errno));
-        exit(EXIT_FAILURE);
+        _exit(EXIT_FAILURE);
     } else {
         // Parent process
         g_process_pid = pid;
@@ -941,6 +890,15 @@ bool go2rtc_process_start(int api_port) {
     }
 }
 
+pid_t go2rtc_process_get_pid(void) {
+    pid_t pid = g_process_pid;
+    if (pid > 0 && is_go2rtc_process(pid)) {
+        return pid;
+    }
+    
+    return find_go2rtc_process();
+}
+
 /**
  * @brief Get the RTSP port used by go2rtc
  * 
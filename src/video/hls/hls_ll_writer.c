@@ -0,0 +1,677 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <math.h>
+#include <errno.h>
+
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libavutil/mathematics.h>
+
+#include "core/logger.h"
+#include "core/config.h"
+#include "core/metrics.h"
+#include "video/hls/hls_ll_writer.h"
+
+// Size of the AVIO buffer between the muxer and the fragment buffer
+#define HLS_LL_AVIO_BUFFER_SIZE 65536
+
+typedef struct {
+    int64_t duration;           // In the input time base
+    bool independent;           // Starts with a keyframe
+} hls_ll_part_t;
+
+typedef struct {
+    int64_t msn;
+    int64_t start_dts;
+    int64_t duration;           // In the input time base
+    int part_count;
+    hls_ll_part_t parts[HLS_LL_MAX_PARTS];
+} hls_ll_segment_t;
+
+struct hls_ll_writer {
+    char output_dir[MAX_PATH_LENGTH];
+    char stream_name[MAX_STREAM_NAME];
+    int segment_duration;
+    int part_duration_ms;
+
+    AVFormatContext *output_ctx;
+    AVRational in_tb;
+    int64_t part_target;        // Part target duration in the input time base
+    int64_t segment_target;     // Segment target duration in the input time base
+    int64_t frame_duration;     // Fallback packet duration in the input time base
+    int64_t first_dts;
+    int64_t last_dts;
+    bool have_first_dts;
+
+    // Bytes produced by the muxer since the last fragment was taken
+    uint8_t *buf;
+    size_t buf_len;
+    size_t buf_size;
+
+    // Complete segments, oldest first, plus the one being written
+    hls_ll_segment_t complete[HLS_LL_PLAYLIST_SEGMENTS];
+    int complete_count;
+    hls_ll_segment_t current;
+    bool segment_open;
+    FILE *segment_file;
+    int64_t next_msn;
+    int64_t max_segment_duration;
+
+    // Part being written
+    bool part_open;
+    int64_t part_start_dts;
+    bool part_independent;
+    int part_packets;
+
+    // Published position, read by the HTTP side without the writer lock
+    atomic_llong published_msn;     // Segment currently being written
+    atomic_int published_parts;     // Parts of that segment already published
+
+    metrics_histogram_t write_latency;
+    metrics_counter_t bytes_written;
+};
+
+// Writers by stream name, for blocking playlist reload
+static struct {
+    char stream_name[MAX_STREAM_NAME];
+    hls_ll_writer_t *writer;
+} ll_writers[MAX_STREAMS];
+static pthread_mutex_t ll_writers_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * AVIO write callback: append muxer output to the fragment buffer
+ */
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+static int buffer_write(void *opaque, const uint8_t *data, int size) {
+#else
+static int buffer_write(void *opaque, uint8_t *data, int size) {
+#endif
+    hls_ll_writer_t *writer = (hls_ll_writer_t *)opaque;
+
+    if (writer->buf_len + size > writer->buf_size) {
+        size_t new_size = writer->buf_size ? writer->buf_size : HLS_LL_AVIO_BUFFER_SIZE;
+        while (new_size < writer->buf_len + size) {
+            new_size *= 2;
+        }
+        uint8_t *new_buf = realloc(writer->buf, new_size);
+        if (!new_buf) {
+            return AVERROR(ENOMEM);
+        }
+        writer->buf = new_buf;
+        writer->buf_size = new_size;
+    }
+
+    memcpy(writer->buf + writer->buf_len, data, size);
+    writer->buf_len += size;
+    return size;
+}
+
+/**
+ * Write a file so that readers never see it half-written
+ */
+static int write_file_atomic(const char *path, const uint8_t *data, size_t len) {
+    char tmp_path[MAX_PATH_LENGTH + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        log_error("Failed to open %s: %s", tmp_path, strerror(errno));
+        return -1;
+    }
+
+    if (len > 0 && fwrite(data, 1, len, fp) != len) {
+        log_error("Failed to write %s: %s", tmp_path, strerror(errno));
+        fclose(fp);
+        unlink(tmp_path);
+        return -1;
+    }
+    fclose(fp);
+
+    if (rename(tmp_path, path) != 0) {
+        log_error("Failed to rename %s: %s", tmp_path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+static double to_seconds(const hls_ll_writer_t *writer, int64_t duration) {
+    return duration * av_q2d(writer->in_tb);
+}
+
+/**
+ * Rewrite the playlist
+ */
+static void write_playlist(hls_ll_writer_t *writer) {
+    char path[MAX_PATH_LENGTH];
+    char tmp_path[MAX_PATH_LENGTH + 8];
+    snprintf(path, sizeof(path), "%s/index.m3u8", writer->output_dir);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp_path, "w");
+    if (!fp) {
+        log_error("Failed to open LL-HLS playlist %s: %s", tmp_path, strerror(errno));
+        return;
+    }
+
+    double part_target = writer->part_duration_ms / 1000.0;
+    int target_duration = writer->segment_duration;
+    double max_seen = to_seconds(writer, writer->max_segment_duration);
+    if ((int)ceil(max_seen) > target_duration) {
+        target_duration = (int)ceil(max_seen);
+    }
+
+    int64_t first_msn = writer->complete_count > 0 ? writer->complete[0].msn : writer->current.msn;
+
+    fprintf(fp, "#EXTM3U\n");
+    fprintf(fp, "#EXT-X-VERSION:9\n");
+    fprintf(fp, "#EXT-X-TARGETDURATION:%d\n", target_duration);
+    fprintf(fp, "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=%.3f\n", part_target * 3);
+    fprintf(fp, "#EXT-X-PART-INF:PART-TARGET=%.3f\n", part_target);
+    fprintf(fp, "#EXT-X-MEDIA-SEQUENCE:%lld\n", (long long)first_msn);
+    fprintf(fp, "#EXT-X-MAP:URI=\"init.mp4\"\n");
+
+    for (int i = 0; i < writer->complete_count; i++) {
+        const hls_ll_segment_t *seg = &writer->complete[i];
+
+        // Only the most recent segments keep their parts
+        if (i >= writer->complete_count - HLS_LL_PART_SEGMENTS) {
+            for (int p = 0; p < seg->part_count; p++) {
+                fprintf(fp, "#EXT-X-PART:DURATION=%.5f,URI=\"segment_%lld.%d.m4s\"%s\n",
+                        to_seconds(writer, seg->parts[p].duration), (long long)seg->msn, p,
+                        seg->parts[p].independent ? ",INDEPENDENT=YES" : "");
+            }
+        }
+        fprintf(fp, "#EXTINF:%.5f,\nsegment_%lld.m4s\n", to_seconds(writer, seg->duration), (long long)seg->msn);
+    }
+
+    const hls_ll_segment_t *cur = &writer->current;
+    for (int p = 0; p < cur->part_count; p++) {
+        fprintf(fp, "#EXT-X-PART:DURATION=%.5f,URI=\"segment_%lld.%d.m4s\"%s\n",
+                to_seconds(writer, cur->parts[p].duration), (long long)cur->msn, p,
+                cur->parts[p].independent ? ",INDEPENDENT=YES" : "");
+    }
+    fprintf(fp, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"segment_%lld.%d.m4s\"\n",
+            (long long)cur->msn, cur->part_count);
+
+    fclose(fp);
+
+    if (rename(tmp_path, path) != 0) {
+        log_error("Failed to rename LL-HLS playlist %s: %s", tmp_path, strerror(errno));
+        unlink(tmp_path);
+    }
+}
+
+/**
+ * Remove the part files of a segment
+ */
+static void remove_parts(hls_ll_writer_t *writer, const hls_ll_segment_t *seg) {
+    char path[MAX_PATH_LENGTH];
+    for (int p = 0; p < seg->part_count; p++) {
+        snprintf(path, sizeof(path), "%s/segment_%lld.%d.m4s", writer->output_dir, (long long)seg->msn, p);
+        unlink(path);
+    }
+}
+
+/**
+ * Start a new segment at the given keyframe
+ */
+static int start_segment(hls_ll_writer_t *writer, int64_t dts) {
+    memset(&writer->current, 0, sizeof(writer->current));
+    writer->current.msn = writer->next_msn++;
+    writer->current.start_dts = dts;
+
+    char path[MAX_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/segment_%lld.m4s.tmp", writer->output_dir, (long long)writer->current.msn);
+    writer->segment_file = fopen(path, "wb");
+    if (!writer->segment_file) {
+        log_error("Failed to open LL-HLS segment %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    writer->segment_open = true;
+    return 0;
+}
+
+/**
+ * Flush the fragment being built and publish it as a part
+ */
+static int finish_part(hls_ll_writer_t *writer, int64_t end_dts) {
+    // Ask the muxer to emit the pending moof/mdat
+    int ret = av_write_frame(writer->output_ctx, NULL);
+    if (ret < 0) {
+        return ret;
+    }
+    avio_flush(writer->output_ctx->pb);
+
+    hls_ll_segment_t *seg = &writer->current;
+    int index = seg->part_count;
+
+    char path[MAX_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/segment_%lld.%d.m4s", writer->output_dir, (long long)seg->msn, index);
+    if (write_file_atomic(path, writer->buf, writer->buf_len) != 0) {
+        writer->buf_len = 0;
+        return -1;
+    }
+    metrics_counter_add(writer->bytes_written, writer->buf_len);
+
+    if (writer->segment_file && fwrite(writer->buf, 1, writer->buf_len, writer->segment_file) != writer->buf_len) {
+        log_error("Failed to append part to LL-HLS segment %lld for stream %s",
+                  (long long)seg->msn, writer->stream_name);
+    }
+    writer->buf_len = 0;
+
+    seg->parts[index].duration = end_dts - writer->part_start_dts;
+    seg->parts[index].independent = writer->part_independent;
+    seg->duration += seg->parts[index].duration;
+    seg->part_count++;
+    writer->part_open = false;
+
+    write_playlist(writer);
+    atomic_store(&writer->published_parts, seg->part_count);
+
+    return 0;
+}
+
+/**
+ * Close the current segment and move it to the playlist window
+ */
+static void finish_segment(hls_ll_writer_t *writer) {
+    hls_ll_segment_t *seg = &writer->current;
+    char path[MAX_PATH_LENGTH];
+    char tmp_path[MAX_PATH_LENGTH + 8];
+
+    if (writer->segment_file) {
+        fclose(writer->segment_file);
+        writer->segment_file = NULL;
+
+        snprintf(path, sizeof(path), "%s/segment_%lld.m4s", writer->output_dir, (long long)seg->msn);
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+        if (rename(tmp_path, path) != 0) {
+            log_error("Failed to rename LL-HLS segment %s: %s", tmp_path, strerror(errno));
+        }
+    }
+
+    if (seg->duration > writer->max_segment_duration) {
+        writer->max_segment_duration = seg->duration;
+    }
+
+    // Drop the oldest segment when the window is full
+    if (writer->complete_count == HLS_LL_PLAYLIST_SEGMENTS) {
+        snprintf(path, sizeof(path), "%s/segment_%lld.m4s", writer->output_dir, (long long)writer->complete[0].msn);
+        unlink(path);
+        memmove(&writer->complete[0], &writer->complete[1],
+                (HLS_LL_PLAYLIST_SEGMENTS - 1) * sizeof(hls_ll_segment_t));
+        writer->complete_count--;
+    }
+    writer->complete[writer->complete_count++] = *seg;
+
+    // Parts are only listed for the most recent segments
+    int stale = writer->complete_count - 1 - HLS_LL_PART_SEGMENTS;
+    if (stale >= 0) {
+        remove_parts(writer, &writer->complete[stale]);
+    }
+
+    writer->segment_open = false;
+}
+
+/**
+ * Register a writer for availability lookups
+ */
+static void register_writer(hls_ll_writer_t *writer) {
+    pthread_mutex_lock(&ll_writers_mutex);
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (!ll_writers[i].writer) {
+            strncpy(ll_writers[i].stream_name, writer->stream_name, MAX_STREAM_NAME - 1);
+            ll_writers[i].stream_name[MAX_STREAM_NAME - 1] = '\0';
+            ll_writers[i].writer = writer;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ll_writers_mutex);
+}
+
+static void unregister_writer(hls_ll_writer_t *writer) {
+    pthread_mutex_lock(&ll_writers_mutex);
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (ll_writers[i].writer == writer) {
+            ll_writers[i].writer = NULL;
+            ll_writers[i].stream_name[0] = '\0';
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ll_writers_mutex);
+}
+
+/**
+ * Create a low-latency HLS writer
+ */
+hls_ll_writer_t *hls_ll_writer_create(const char *output_dir, const char *stream_name,
+                                      int segment_duration, int part_duration_ms) {
+    if (!output_dir || !stream_name) {
+        return NULL;
+    }
+
+    hls_ll_writer_t *writer = calloc(1, sizeof(hls_ll_writer_t));
+    if (!writer) {
+        log_error("Failed to allocate LL-HLS writer for stream %s", stream_name);
+        return NULL;
+    }
+
+    strncpy(writer->output_dir, output_dir, MAX_PATH_LENGTH - 1);
+    strncpy(writer->stream_name, stream_name, MAX_STREAM_NAME - 1);
+    writer->segment_duration = segment_duration > 0 ? segment_duration : 2;
+
+    // Keep parts within the range players handle well
+    if (part_duration_ms < 100) {
+        part_duration_ms = 100;
+    } else if (part_duration_ms > 2000) {
+        part_duration_ms = 2000;
+    }
+    if (part_duration_ms > writer->segment_duration * 1000) {
+        part_duration_ms = writer->segment_duration * 1000;
+    }
+    writer->part_duration_ms = part_duration_ms;
+
+    atomic_store(&writer->published_msn, -1);
+    atomic_store(&writer->published_parts, 0);
+
+    char labels[128] = "";
+    metrics_label(labels, sizeof(labels), "stream", stream_name);
+    writer->write_latency = metrics_histogram("lightnvr_hls_segment_write_seconds",
+                                              "Time to flush and publish an HLS part or segment", labels);
+    metrics_label(labels, sizeof(labels), "writer", "hls");
+    writer->bytes_written = metrics_counter("lightnvr_bytes_written_total",
+                                            "Bytes of media written to storage", labels);
+
+    register_writer(writer);
+
+    log_info("Created LL-HLS writer for stream %s at %s (segment %d s, part %d ms)",
+             stream_name, output_dir, writer->segment_duration, writer->part_duration_ms);
+    return writer;
+}
+
+/**
+ * Write the init segment for the given video stream
+ */
+int hls_ll_writer_initialize(hls_ll_writer_t *writer, const AVStream *input_stream) {
+    if (!writer || !input_stream) {
+        return -1;
+    }
+
+    AVFormatContext *ctx = NULL;
+    AVDictionary *opts = NULL;
+    unsigned char *avio_buffer = NULL;
+
+    int ret = avformat_alloc_output_context2(&ctx, NULL, "mp4", NULL);
+    if (ret < 0 || !ctx) {
+        log_error("Failed to allocate LL-HLS output context for stream %s", writer->stream_name);
+        return ret < 0 ? ret : -1;
+    }
+
+    AVStream *out_stream = avformat_new_stream(ctx, NULL);
+    if (!out_stream) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    ret = avcodec_parameters_copy(out_stream->codecpar, input_stream->codecpar);
+    if (ret < 0) {
+        goto fail;
+    }
+    out_stream->codecpar->codec_tag = 0;
+    out_stream->time_base = input_stream->time_base;
+
+    avio_buffer = av_malloc(HLS_LL_AVIO_BUFFER_SIZE);
+    if (!avio_buffer) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    ctx->pb = avio_alloc_context(avio_buffer, HLS_LL_AVIO_BUFFER_SIZE, 1, writer, NULL, buffer_write, NULL);
+    if (!ctx->pb) {
+        av_free(avio_buffer);
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    // Fragments are cut explicitly at part boundaries
+    av_dict_set(&opts, "movflags", "frag_custom+empty_moov+default_base_moof", 0);
+
+    writer->buf_len = 0;
+    ret = avformat_write_header(ctx, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        char error_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+        av_strerror(ret, error_buf, AV_ERROR_MAX_STRING_SIZE);
+        log_error("Failed to write LL-HLS init segment for stream %s: %s", writer->stream_name, error_buf);
+        goto fail;
+    }
+    avio_flush(ctx->pb);
+
+    char path[MAX_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/init.mp4", writer->output_dir);
+    if (write_file_atomic(path, writer->buf, writer->buf_len) != 0) {
+        ret = -1;
+        goto fail;
+    }
+    writer->buf_len = 0;
+
+    writer->output_ctx = ctx;
+    writer->in_tb = input_stream->time_base;
+    writer->part_target = av_rescale_q(writer->part_duration_ms, (AVRational){1, 1000}, writer->in_tb);
+    writer->segment_target = av_rescale_q(writer->segment_duration, (AVRational){1, 1}, writer->in_tb);
+
+    AVRational frame_rate = input_stream->avg_frame_rate.num > 0 ? input_stream->avg_frame_rate
+                                                                 : input_stream->r_frame_rate;
+    if (frame_rate.num <= 0 || frame_rate.den <= 0) {
+        frame_rate = (AVRational){25, 1};
+    }
+    writer->frame_duration = av_rescale_q(1, av_inv_q(frame_rate), writer->in_tb);
+    if (writer->frame_duration < 1) {
+        writer->frame_duration = 1;
+    }
+
+    log_info("Initialized LL-HLS writer for stream %s", writer->stream_name);
+    return 0;
+
+fail:
+    av_dict_free(&opts);
+    if (ctx->pb) {
+        av_freep(&ctx->pb->buffer);
+        avio_context_free(&ctx->pb);
+    }
+    avformat_free_context(ctx);
+    writer->buf_len = 0;
+    return ret;
+}
+
+/**
+ * Write a video packet
+ */
+int hls_ll_writer_write_packet(hls_ll_writer_t *writer, const AVPacket *pkt, const AVStream *input_stream) {
+    if (!writer || !pkt || !input_stream || !writer->output_ctx) {
+        return -1;
+    }
+
+    // Normalize timestamps onto a zero-based, strictly increasing DTS line
+    int64_t dts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+    int64_t pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : dts;
+    if (dts == AV_NOPTS_VALUE) {
+        if (!writer->have_first_dts) {
+            return 0;
+        }
+        dts = writer->last_dts + writer->frame_duration;
+        pts = dts;
+    } else {
+        if (!writer->have_first_dts) {
+            writer->first_dts = dts;
+            writer->have_first_dts = true;
+        }
+        dts -= writer->first_dts;
+        pts -= writer->first_dts;
+    }
+
+    if (writer->segment_open && dts <= writer->last_dts) {
+        int64_t shift = writer->last_dts + 1 - dts;
+        dts += shift;
+        pts += shift;
+    } else if (writer->segment_open && dts > writer->last_dts + 10 * writer->segment_target) {
+        // Large forward jump (camera clock reset); continue from the previous frame
+        int64_t shift = writer->last_dts + writer->frame_duration - dts;
+        writer->first_dts -= shift;
+        dts += shift;
+        pts += shift;
+    }
+    if (pts < dts) {
+        pts = dts;
+    }
+
+    int64_t duration = pkt->duration > 0 ? pkt->duration : writer->frame_duration;
+    bool is_keyframe = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+    int ret;
+
+    // Close the current part, and the segment if this keyframe starts a new one
+    if (writer->part_open) {
+        bool new_segment = is_keyframe && dts - writer->current.start_dts >= writer->segment_target;
+        bool part_full = dts + duration - writer->part_start_dts > writer->part_target &&
+                         writer->part_packets > 0 &&
+                         writer->current.part_count < HLS_LL_MAX_PARTS - 1;
+
+        uint64_t start_us = metrics_now_us();
+        if (new_segment || part_full) {
+            ret = finish_part(writer, dts);
+            if (ret < 0) {
+                return ret;
+            }
+        }
+        if (new_segment) {
+            finish_segment(writer);
+        }
+        if (new_segment || part_full) {
+            metrics_histogram_observe(writer->write_latency, metrics_now_us() - start_us);
+        }
+    }
+
+    if (!writer->part_open) {
+        if (!writer->segment_open) {
+            // Every segment starts on a keyframe
+            if (!is_keyframe) {
+                return 0;
+            }
+            if (start_segment(writer, dts) != 0) {
+                return -1;
+            }
+            atomic_store(&writer->published_parts, 0);
+            atomic_store(&writer->published_msn, writer->current.msn);
+        }
+
+        writer->part_open = true;
+        writer->part_start_dts = dts;
+        writer->part_independent = is_keyframe;
+        writer->part_packets = 0;
+    }
+
+    AVPacket *out_pkt = av_packet_alloc();
+    if (!out_pkt) {
+        return AVERROR(ENOMEM);
+    }
+    ret = av_packet_ref(out_pkt, pkt);
+    if (ret < 0) {
+        av_packet_free(&out_pkt);
+        return ret;
+    }
+
+    AVRational out_tb = writer->output_ctx->streams[0]->time_base;
+    out_pkt->dts = av_rescale_q(dts, writer->in_tb, out_tb);
+    out_pkt->pts = av_rescale_q(pts, writer->in_tb, out_tb);
+    out_pkt->duration = av_rescale_q(duration, writer->in_tb, out_tb);
+    out_pkt->stream_index = 0;
+    out_pkt->pos = -1;
+
+    ret = av_write_frame(writer->output_ctx, out_pkt);
+    av_packet_free(&out_pkt);
+    if (ret < 0) {
+        char error_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+        av_strerror(ret, error_buf, AV_ERROR_MAX_STRING_SIZE);
+        log_error("Error writing LL-HLS packet for stream %s: %s", writer->stream_name, error_buf);
+        return ret;
+    }
+
+    writer->part_packets++;
+    writer->last_dts = dts;
+    return 0;
+}
+
+/**
+ * Close the writer and free its resources
+ */
+void hls_ll_writer_close(hls_ll_writer_t *writer) {
+    if (!writer) {
+        return;
+    }
+
+    unregister_writer(writer);
+
+    if (writer->output_ctx) {
+        // Trailer bytes are not published
+        av_write_trailer(writer->output_ctx);
+        if (writer->output_ctx->pb) {
+            av_freep(&writer->output_ctx->pb->buffer);
+            avio_context_free(&writer->output_ctx->pb);
+        }
+        avformat_free_context(writer->output_ctx);
+        writer->output_ctx = NULL;
+    }
+
+    if (writer->segment_file) {
+        char path[MAX_PATH_LENGTH];
+        fclose(writer->segment_file);
+        writer->segment_file = NULL;
+        snprintf(path, sizeof(path), "%s/segment_%lld.m4s.tmp", writer->output_dir, (long long)writer->current.msn);
+        unlink(path);
+    }
+
+    log_info("Closed LL-HLS writer for stream %s", writer->stream_name);
+
+    free(writer->buf);
+    free(writer);
+}
+
+/**
+ * Check whether a part or segment of a stream has been published
+ */
+int hls_ll_writer_is_available(const char *stream_name, int64_t msn, int part) {
+    if (!stream_name) {
+        return -1;
+    }
+
+    int result = -1;
+    pthread_mutex_lock(&ll_writers_mutex);
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (ll_writers[i].writer && strcmp(ll_writers[i].stream_name, stream_name) == 0) {
+            hls_ll_writer_t *writer = ll_writers[i].writer;
+            int64_t published_msn = atomic_load(&writer->published_msn);
+            int published_parts = atomic_load(&writer->published_parts);
+
+            if (msn < published_msn) {
+                result = 1;
+            } else if (msn == published_msn && part >= 0 && part < published_parts) {
+                result = 1;
+            } else if (published_msn >= 0 && msn > published_msn + 1) {
+                // The last complete segment is published_msn - 1
+                result = HLS_LL_WRITER_TOO_FAR_AHEAD;
+            } else {
+                result = 0;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ll_writers_mutex);
+
+    return result;
+}
@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <errno.h>
+
+#include <libavformat/avformat.h>
+#include <libavutil/mem.h>
+
+#include "core/logger.h"
+#include "core/config.h"
+#include "video/hls/hls_memory_store.h"
+
+// Size of the AVIO buffer between the muxer and a pending file
+#define HLS_MEMORY_AVIO_BUFFER_SIZE 32768
+
+// Maximum length of a file name inside a store
+#define HLS_MEMORY_MAX_FILE_NAME 64
+
+typedef struct {
+    char name[HLS_MEMORY_MAX_FILE_NAME];
+    hls_memory_file_t *file;
+} hls_memory_slot_t;
+
+typedef struct {
+    bool in_use;
+    char stream_name[MAX_STREAM_NAME];
+    hls_memory_slot_t playlist;
+    hls_memory_slot_t *segments;    // Ring of max_segments slots
+    int max_segments;
+    int next_segment;               // Slot overwritten by the next new segment
+} hls_memory_stream_t;
+
+// File being written by the muxer; the buffer is published as is when closed
+typedef struct {
+    char stream_name[MAX_STREAM_NAME];
+    char name[HLS_MEMORY_MAX_FILE_NAME];
+    hls_memory_file_t *file;
+    size_t capacity;
+} hls_memory_pending_t;
+
+static hls_memory_stream_t stores[MAX_STREAMS];
+static pthread_mutex_t stores_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Find the store of a stream
+ * Must be called with stores_mutex held
+ */
+static hls_memory_stream_t *find_store(const char *stream_name) {
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (stores[i].in_use && strcmp(stores[i].stream_name, stream_name) == 0) {
+            return &stores[i];
+        }
+    }
+    return NULL;
+}
+
+static void release_slot(hls_memory_slot_t *slot) {
+    if (slot->file) {
+        hls_memory_store_release(slot->file);
+        slot->file = NULL;
+    }
+    slot->name[0] = '\0';
+}
+
+/**
+ * Release all files of a store and mark it unused
+ * Must be called with stores_mutex held
+ */
+static void clear_store(hls_memory_stream_t *store) {
+    release_slot(&store->playlist);
+    for (int i = 0; i < store->max_segments; i++) {
+        release_slot(&store->segments[i]);
+    }
+    free(store->segments);
+    memset(store, 0, sizeof(*store));
+}
+
+static bool is_playlist(const char *name) {
+    size_t len = strlen(name);
+    return len >= 5 && strcmp(name + len - 5, ".m3u8") == 0;
+}
+
+/**
+ * Publish a finished file, replacing any previous version
+ */
+static void publish_file(const char *stream_name, const char *name, hls_memory_file_t *file) {
+    hls_memory_file_t *old = NULL;
+
+    pthread_mutex_lock(&stores_mutex);
+    hls_memory_stream_t *store = find_store(stream_name);
+    if (!store) {
+        pthread_mutex_unlock(&stores_mutex);
+        hls_memory_store_release(file);
+        return;
+    }
+
+    hls_memory_slot_t *slot = NULL;
+    if (is_playlist(name)) {
+        slot = &store->playlist;
+    } else {
+        for (int i = 0; i < store->max_segments; i++) {
+            if (store->segments[i].file && strcmp(store->segments[i].name, name) == 0) {
+                slot = &store->segments[i];
+                break;
+            }
+        }
+        if (!slot) {
+            // Evict the oldest segment
+            slot = &store->segments[store->next_segment];
+            store->next_segment = (store->next_segment + 1) % store->max_segments;
+        }
+    }
+
+    old = slot->file;
+    strncpy(slot->name, name, HLS_MEMORY_MAX_FILE_NAME - 1);
+    slot->name[HLS_MEMORY_MAX_FILE_NAME - 1] = '\0';
+    slot->file = file;
+    pthread_mutex_unlock(&stores_mutex);
+
+    if (old) {
+        hls_memory_store_release(old);
+    }
+}
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+static int pending_write(void *opaque, const uint8_t *data, int size) {
+#else
+static int pending_write(void *opaque, uint8_t *data, int size) {
+#endif
+    hls_memory_pending_t *pending = (hls_memory_pending_t *)opaque;
+
+    size_t len = pending->file ? pending->file->size : 0;
+
+    if (len + size > pending->capacity) {
+        size_t new_capacity = pending->capacity ? pending->capacity : HLS_MEMORY_AVIO_BUFFER_SIZE;
+        while (new_capacity < len + size) {
+            new_capacity *= 2;
+        }
+        hls_memory_file_t *new_file = realloc(pending->file, sizeof(hls_memory_file_t) + new_capacity);
+        if (!new_file) {
+            return AVERROR(ENOMEM);
+        }
+        new_file->size = len;
+        pending->file = new_file;
+        pending->capacity = new_capacity;
+    }
+
+    memcpy(pending->file->data + len, data, size);
+    pending->file->size = len + size;
+    return size;
+}
+
+/**
+ * io_open callback: start a new file in the store
+ */
+static int store_io_open(struct AVFormatContext *s, AVIOContext **pb, const char *url,
+                         int flags, AVDictionary **options) {
+    (void)options;
+
+    if (!s->opaque || (flags & AVIO_FLAG_READ)) {
+        return AVERROR(ENOSYS);
+    }
+
+    const char *name = strrchr(url, '/');
+    name = name ? name + 1 : url;
+
+    hls_memory_pending_t *pending = calloc(1, sizeof(hls_memory_pending_t));
+    if (!pending) {
+        return AVERROR(ENOMEM);
+    }
+    strncpy(pending->stream_name, (const char *)s->opaque, MAX_STREAM_NAME - 1);
+    strncpy(pending->name, name, HLS_MEMORY_MAX_FILE_NAME - 1);
+
+    unsigned char *buffer = av_malloc(HLS_MEMORY_AVIO_BUFFER_SIZE);
+    if (!buffer) {
+        free(pending);
+        return AVERROR(ENOMEM);
+    }
+
+    *pb = avio_alloc_context(buffer, HLS_MEMORY_AVIO_BUFFER_SIZE, 1, pending, NULL, pending_write, NULL);
+    if (!*pb) {
+        av_free(buffer);
+        free(pending);
+        return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
+/**
+ * io_close2 callback: publish the finished file
+ */
+static int store_io_close(struct AVFormatContext *s, AVIOContext *pb) {
+    (void)s;
+
+    if (!pb) {
+        return 0;
+    }
+
+    avio_flush(pb);
+    hls_memory_pending_t *pending = (hls_memory_pending_t *)pb->opaque;
+    int ret = pb->error;
+
+    av_freep(&pb->buffer);
+    avio_context_free(&pb);
+
+    if (!pending) {
+        return ret;
+    }
+
+    if (ret >= 0 && pending->file) {
+        atomic_init(&pending->file->refcount, 1);
+        publish_file(pending->stream_name, pending->name, pending->file);
+    } else {
+        free(pending->file);
+    }
+
+    free(pending);
+    return ret;
+}
+
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(59, 0, 0)
+/**
+ * io_close callback for libavformat versions without io_close2
+ */
+static void store_io_close_legacy(struct AVFormatContext *s, AVIOContext *pb) {
+    store_io_close(s, pb);
+}
+#endif
+
+int hls_memory_store_open(const char *stream_name, int max_segments) {
+    if (!stream_name || stream_name[0] == '\0') {
+        return -1;
+    }
+
+    if (max_segments < 2) {
+        max_segments = HLS_MEMORY_DEFAULT_SEGMENTS;
+    }
+
+    hls_memory_slot_t *segments = calloc(max_segments, sizeof(hls_memory_slot_t));
+    if (!segments) {
+        log_error("Failed to allocate HLS memory store for stream %s", stream_name);
+        return -1;
+    }
+
+    pthread_mutex_lock(&stores_mutex);
+
+    hls_memory_stream_t *store = find_store(stream_name);
+    if (store) {
+        clear_store(store);
+    } else {
+        for (int i = 0; i < MAX_STREAMS; i++) {
+            if (!stores[i].in_use) {
+                store = &stores[i];
+                break;
+            }
+        }
+    }
+
+    if (!store) {
+        pthread_mutex_unlock(&stores_mutex);
+        free(segments);
+        log_error("No free HLS memory store slot for stream %s", stream_name);
+        return -1;
+    }
+
+    store->in_use = true;
+    strncpy(store->stream_name, stream_name, MAX_STREAM_NAME - 1);
+    store->segments = segments;
+    store->max_segments = max_segments;
+    store->next_segment = 0;
+
+    pthread_mutex_unlock(&stores_mutex);
+
+    log_info("Opened HLS memory store for stream %s (%d segments)", stream_name, max_segments);
+    return 0;
+}
+
+void hls_memory_store_close(const char *stream_name) {
+    if (!stream_name) {
+        return;
+    }
+
+    pthread_mutex_lock(&stores_mutex);
+    hls_memory_stream_t *store = find_store(stream_name);
+    if (store) {
+        clear_store(store);
+    }
+    pthread_mutex_unlock(&stores_mutex);
+
+    if (store) {
+        log_info("Closed HLS memory store for stream %s", stream_name);
+    }
+}
+
+void hls_memory_store_attach(AVFormatContext *ctx, const char *stream_name) {
+    if (!ctx || !stream_name) {
+        return;
+    }
+
+    ctx->opaque = (void *)stream_name;
+    ctx->io_open = store_io_open;
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(59, 0, 0)
+    ctx->io_close2 = store_io_close;
+#else
+    ctx->io_close = store_io_close_legacy;
+#endif
+}
+
+hls_memory_file_t *hls_memory_store_get(const char *stream_name, const char *file_name) {
+    if (!stream_name || !file_name) {
+        return NULL;
+    }
+
+    hls_memory_file_t *file = NULL;
+
+    pthread_mutex_lock(&stores_mutex);
+    hls_memory_stream_t *store = find_store(stream_name);
+    if (store) {
+        if (is_playlist(file_name)) {
+            if (store->playlist.file && strcmp(store->playlist.name, file_name) == 0) {
+                file = store->playlist.file;
+            }
+        } else {
+            for (int i = 0; i < store->max_segments; i++) {
+                if (store->segments[i].file && strcmp(store->segments[i].name, file_name) == 0) {
+                    file = store->segments[i].file;
+                    break;
+                }
+            }
+        }
+        if (file) {
+            atomic_fetch_add(&file->refcount, 1);
+        }
+    }
+    pthread_mutex_unlock(&stores_mutex);
+
+    return file;
+}
+
+void hls_memory_store_release(hls_memory_file_t *file) {
+    if (file && atomic_fetch_sub(&file->refcount, 1) == 1) {
+        free(file);
+    }
+}
+
+int hls_memory_store_has_stream(const char *stream_name) {
+    if (!stream_name) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&stores_mutex);
+    int found = find_store(stream_name) != NULL;
+    pthread_mutex_unlock(&stores_mutex);
+
+    return found;
+}
+
+void hls_memory_store_cleanup(void) {
+    pthread_mutex_lock(&stores_mutex);
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (stores[i].in_use) {
+            clear_store(&stores[i]);
+        }
+    }
+    pthread_mutex_unlock(&stores_mutex);
+}
@@ -42,6 +42,7 @@
 #include "video/hls/hls_context.h"
 #include "video/hls/hls_directory.h"
 #include "video/hls/hls_unified_thread.h"
+#include "video/packet_fanout.h"
 
 // Maximum time (in seconds) without receiving a packet before considering the connection dead
 #define MAX_PACKET_TIMEOUT 5
@@ -52,6 +53,9 @@
 // Maximum reconnection delay in milliseconds (30 seconds)
 #define MAX_RECONNECT_DELAY_MS 30000
 
+// How long a single read from the shared ingest may block, in milliseconds
+#define FANOUT_READ_TIMEOUT_MS 1000
+
 // Forward declaration for go2rtc integration
 extern bool go2rtc_integration_is_using_go2rtc_for_hls(const char *stream_name);
 extern bool go2rtc_get_rtsp_url(const char *stream_name, char *url, size_t url_size);
@@ -493,6 +497,8 @@ void *hls_unified_thread_func(void *arg) {
     int reconnect_attempt = 0;
     int reconnect_delay_ms = BASE_RECONNECT_DELAY_MS;
     time_t last_packet_time = 0;
+    packet_fanout_t *fanout = NULL;
+    packet_fanout_reader_t *fanout_reader = NULL;
 
     // Validate context
     if (!ctx) {
@@ -596,6 +602,66 @@ void *hls_unified_thread_func(void *arg) {
                 // Close any existing connection first
                 safe_cleanup_resources(&input_ctx, NULL, NULL);
 
+                // Subscribe to the shared ingest instead of opening a connection of our own
+                if (fanout_reader || packet_fanout_is_enabled()) {
+                    if (!fanout_reader) {
+                        fanout = packet_fanout_acquire(stream_name);
+                        fanout_reader = fanout ? packet_fanout_subscribe(fanout, "hls", PACKET_FANOUT_POLICY_CATCH_UP) : NULL;
+                        if (!fanout_reader) {
+                            log_error("Failed to subscribe to shared ingest for stream %s", stream_name);
+                            if (fanout) {
+                                packet_fanout_release(fanout);
+                                fanout = NULL;
+                            }
+
+                            atomic_store(&ctx->connection_valid, 0);
+                            reconnect_attempt++;
+                            if (reconnect_attempt > 1000) {
+                                reconnect_attempt = 1000;
+                            }
+                            reconnect_delay_ms = calculate_reconnect_delay(reconnect_attempt);
+                            av_usleep(reconnect_delay_ms * 1000);
+                            break;
+                        }
+                    }
+
+                    ret = packet_fanout_wait_for_streams(fanout_reader, FANOUT_READ_TIMEOUT_MS);
+                    if (ret == AVERROR_EOF) {
+                        thread_state = HLS_THREAD_STOPPING;
+                        break;
+                    }
+                    if (ret < 0) {
+                        // The ingest handles its own reconnection; keep waiting for it
+                        atomic_store(&ctx->connection_valid, 0);
+                        break;
+                    }
+
+                    const AVStream *video_stream = packet_fanout_get_stream(fanout_reader, AVMEDIA_TYPE_VIDEO);
+                    video_stream_idx = video_stream->index;
+
+                    ret = hls_writer_initialize(ctx->writer, video_stream);
+                    if (ret < 0) {
+                        log_error("Failed to initialize HLS writer for stream %s", stream_name);
+                        atomic_store(&ctx->connection_valid, 0);
+                        reconnect_attempt++;
+                        if (reconnect_attempt > 1000) {
+                            reconnect_attempt = 1000;
+                        }
+                        reconnect_delay_ms = calculate_reconnect_delay(reconnect_attempt);
+                        av_usleep(reconnect_delay_ms * 1000);
+                        break;
+                    }
+
+                    log_info("Stream %s is reading from the shared ingest", stream_name);
+                    thread_state = HLS_THREAD_RUNNING;
+                    reconnect_attempt = 0;
+                    atomic_store(&ctx->connection_valid, 1);
+                    atomic_store(&ctx->consecutive_failures, 0);
+                    last_packet_time = time(NULL);
+                    atomic_store(&ctx->last_packet_time, (int_fast64_t)last_packet_time);
+                    break;
+                }
+
                 // Check if the RTSP URL exists before trying to connect
                 if (strncmp(ctx->rtsp_url, "rtsp://", 7) == 0) {
                     char host[256] = {0};
@@ -763,7 +829,30 @@ void *hls_unified_thread_func(void *arg) {
                 }
 
                 // Read packet
-                ret = av_read_frame(input_ctx, pkt);
+                AVFormatContext *read_ctx = input_ctx;
+                if (fanout_reader) {
+                    read_ctx = packet_fanout_get_format_context(fanout_reader);
+                    ret = packet_fanout_read(fanout_reader, pkt, FANOUT_READ_TIMEOUT_MS);
+
+                    if (ret == AVERROR(EAGAIN)) {
+                        // Nothing from the shared ingest yet, which restarts itself if needed
+                        time_t now = time(NULL);
+                        if (now - last_packet_time > MAX_PACKET_TIMEOUT) {
+                            log_error("No packets received from stream %s for %ld seconds",
+                                     stream_name, now - last_packet_time);
+                            atomic_store(&ctx->connection_valid, 0);
+                            atomic_fetch_add(&ctx->consecutive_failures, 1);
+                            last_packet_time = now;
+                        }
+                        break;
+                    }
+                    if (ret == AVERROR_EOF) {
+                        thread_state = HLS_THREAD_STOPPING;
+                        break;
+                    }
+                } else {
+                    ret = av_read_frame(input_ctx, pkt);
+                }
 
                 if (ret < 0) {
                     // Handle read errors
@@ -786,8 +875,8 @@ void *hls_unified_thread_func(void *arg) {
 
                 // Get the stream for this packet
                 AVStream *input_stream = NULL;
-                if (pkt->stream_index >= 0 && pkt->stream_index < input_ctx->nb_streams) {
-                    input_stream = input_ctx->streams[pkt->stream_index];
+                if (pkt->stream_index >= 0 && pkt->stream_index < read_ctx->nb_streams) {
+                    input_stream = read_ctx->streams[pkt->stream_index];
                 } else {
                     log_warn("Invalid stream index %d for stream %s", pkt->stream_index, stream_name);
                     av_packet_unref(pkt);
@@ -834,8 +923,8 @@ void *hls_unified_thread_func(void *arg) {
                     // This is a non-video packet (likely audio)
                     // For now, we'll just log it and skip processing
                     // This prevents the "Invalid packet stream index" errors
-                    if (pkt->stream_index >= 0 && pkt->stream_index < input_ctx->nb_streams) {
-                        AVStream *stream = input_ctx->streams[pkt->stream_index];
+                    if (pkt->stream_index >= 0 && pkt->stream_index < read_ctx->nb_streams) {
+                        AVStream *stream = read_ctx->streams[pkt->stream_index];
                         AVCodecParameters *codecpar = stream->codecpar;
 
                         if (codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
@@ -869,6 +958,12 @@ void *hls_unified_thread_func(void *arg) {
             case HLS_THREAD_RECONNECTING:
                 log_info("Reconnecting to stream %s (attempt %d)", stream_name, reconnect_attempt);
 
+                // Subscribers of the shared ingest only need to wait for it to come back
+                if (fanout_reader) {
+                    thread_state = HLS_THREAD_CONNECTING;
+                    break;
+                }
+
                 // Close existing connection
                 safe_cleanup_resources(&input_ctx, NULL, NULL);
 
@@ -1015,6 +1110,16 @@ void *hls_unified_thread_func(void *arg) {
         atomic_store(&ctx->connection_valid, 0);
     }
 
+    // Leave the shared ingest before the writer goes away
+    if (fanout_reader) {
+        packet_fanout_unsubscribe(fanout_reader);
+        fanout_reader = NULL;
+    }
+    if (fanout) {
+        packet_fanout_release(fanout);
+        fanout = NULL;
+    }
+
     // Clear the reference in the stream state
     // CRITICAL FIX: Add additional safety checks to prevent segfault
     if (state && ctx && ctx->writer && state->hls_ctx == ctx->writer) {
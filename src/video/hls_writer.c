@@ -17,9 +17,12 @@
 #include <libavcodec/avcodec.h>
 #include <libavutil/avutil.h>
 #include <libavutil/time.h>
+#include <libavutil/opt.h>
 
 #include "core/logger.h"
 #include "video/hls_writer.h"
+#include "video/hls/hls_ll_writer.h"
+#include "video/hls/hls_memory_store.h"
 #include "video/detection_integration.h"
 #include "video/detection_frame_processing.h"
 #include "video/streams.h"
@@ -178,9 +181,35 @@ hls_writer_t *hls_writer_create(const char *output_dir, const char *stream_name,
         return NULL;
     }
 
+    // Low-latency mode packages fMP4 parts itself instead of using the hls muxer
+    config_t *global_config = get_streaming_config();
+    if (global_config && global_config->ll_hls_enabled) {
+        writer->ll_writer = hls_ll_writer_create(writer->output_dir, writer->stream_name,
+                                                 segment_duration, global_config->ll_hls_part_duration_ms);
+        if (writer->ll_writer) {
+            log_info("Created LL-HLS writer for stream %s at %s with segment duration %d seconds",
+                    stream_name, writer->output_dir, segment_duration);
+            return writer;
+        }
+        log_warn("Failed to create LL-HLS writer for stream %s, falling back to MPEG-TS segments", stream_name);
+    }
+
+    // Keep the playlist and segments in RAM instead of writing them to disk
+    if (global_config && global_config->hls_memory_store) {
+        if (hls_memory_store_open(writer->stream_name, global_config->hls_memory_segments) == 0) {
+            writer->memory_store = 1;
+        } else {
+            log_warn("Failed to open HLS memory store for stream %s, writing segments to disk", stream_name);
+        }
+    }
+
     // Initialize output format context for HLS
     char output_path[MAX_PATH_LENGTH];
-    snprintf(output_path, MAX_PATH_LENGTH, "%s/index.m3u8", writer->output_dir);
+    if (writer->memory_store) {
+        snprintf(output_path, MAX_PATH_LENGTH, "%sindex.m3u8", HLS_MEMORY_URL_PREFIX);
+    } else {
+        snprintf(output_path, MAX_PATH_LENGTH, "%s/index.m3u8", writer->output_dir);
+    }
 
     // Allocate output format context
     int ret = avformat_alloc_output_context2(
@@ -190,6 +219,9 @@ hls_writer_t *hls_writer_create(const char *output_dir, const char *stream_name,
         char error_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
         av_strerror(ret, error_buf, AV_ERROR_MAX_STRING_SIZE);
         log_error("Failed to allocate output context for HLS: %s", error_buf);
+        if (writer->memory_store) {
+            hls_memory_store_close(writer->stream_name);
+        }
         free(writer);
         return NULL;
     }
@@ -208,7 +240,9 @@ hls_writer_t *hls_writer_create(const char *output_dir, const char *stream_name,
     av_dict_set(&options, "hls_segment_type", "mpegts", 0);
 
     // Enable aggressive segment deletion to prevent accumulation
-    av_dict_set(&options, "hls_flags", "delete_segments+discont_start+program_date_time", 0);
+    // (the memory store evicts old segments itself)
+    av_dict_set(&options, "hls_flags", writer->memory_store ? "discont_start+program_date_time"
+                                                            : "delete_segments+discont_start+program_date_time", 0);
 
     // Set start number
     av_dict_set(&options, "start_number", "0", 0);
@@ -221,7 +255,11 @@ hls_writer_t *hls_writer_create(const char *output_dir, const char *stream_name,
 
     // Set segment filename format for MPEG-TS
     char segment_format[MAX_PATH_LENGTH + 32];
-    snprintf(segment_format, sizeof(segment_format), "%s/segment_%%d.ts", writer->output_dir);
+    if (writer->memory_store) {
+        snprintf(segment_format, sizeof(segment_format), "%ssegment_%%d.ts", HLS_MEMORY_URL_PREFIX);
+    } else {
+        snprintf(segment_format, sizeof(segment_format), "%s/segment_%%d.ts", writer->output_dir);
+    }
     av_dict_set(&options, "hls_segment_filename", segment_format, 0);
 
     // Log simplified options for debugging
@@ -233,6 +271,24 @@ hls_writer_t *hls_writer_create(const char *output_dir, const char *stream_name,
     log_info("  start_number: 0");
     log_info("  hls_segment_filename: %s", segment_format);
 
+    if (writer->memory_store) {
+        // The muxer opens every playlist and segment through the store
+        hls_memory_store_attach(writer->output_ctx, writer->stream_name);
+        ret = av_opt_set_dict(writer->output_ctx->priv_data, &options);
+        av_dict_free(&options);
+        if (ret < 0) {
+            log_error("Failed to set HLS options for stream %s", writer->stream_name);
+            avformat_free_context(writer->output_ctx);
+            hls_memory_store_close(writer->stream_name);
+            free(writer);
+            return NULL;
+        }
+
+        log_info("Created in-memory HLS writer for stream %s with segment duration %d seconds",
+                stream_name, segment_duration);
+        return writer;
+    }
+
     // Open output file
     ret = avio_open2(&writer->output_ctx->pb, output_path,
                     AVIO_FLAG_WRITE, NULL, &options);
@@ -260,6 +316,15 @@ int hls_writer_initialize(hls_writer_t *writer, const AVStream *input_stream) {
         return -1;
     }
 
+    if (writer->ll_writer) {
+        int ret = hls_ll_writer_initialize(writer->ll_writer, input_stream);
+        if (ret < 0) {
+            return ret;
+        }
+        writer->initialized = 1;
+        return 0;
+    }
+
     if (!writer->output_ctx) {
         log_error("Output context is NULL in hls_writer_initialize");
         return -1;
@@ -446,6 +511,16 @@ int hls_writer_write_packet(hls_writer_t *writer, const AVPacket *pkt, const AVS
         return -1;
     }
 
+    if (writer->ll_writer) {
+        if (!writer->initialized) {
+            int ret = hls_writer_initialize(writer, input_stream);
+            if (ret < 0) {
+                return ret;
+            }
+        }
+        return hls_ll_writer_write_packet(writer->ll_writer, pkt, input_stream);
+    }
+
     // Check if writer has been closed
     if (!writer->output_ctx) {
         log_warn("hls_writer_write_packet: Writer for stream %s has been closed", writer->stream_name);
@@ -889,7 +964,7 @@ void hls_writer_close(hls_writer_t *writer) {
 
     // Check if already closed - with additional safety check
     // CRITICAL FIX: Add additional NULL check before accessing output_ctx
-    if (!writer || !writer->output_ctx) {
+    if (!writer || (!writer->output_ctx && !writer->ll_writer)) {
         log_warn("Attempted to close already closed HLS writer for stream %s", stream_name);
         if (writer && mutex_result == 0) {
             // CRITICAL FIX: Add memory barrier before unlocking mutex
@@ -899,6 +974,10 @@ void hls_writer_close(hls_writer_t *writer) {
         return;
     }
 
+    // Take the low-latency writer, if any
+    struct hls_ll_writer *local_ll_writer = writer->ll_writer;
+    writer->ll_writer = NULL;
+
     // Create a local copy of the output context with additional safety checks
     AVFormatContext *local_output_ctx = NULL;
     if (writer->output_ctx) {
@@ -907,9 +986,10 @@ void hls_writer_close(hls_writer_t *writer) {
         // Mark as closed immediately to prevent other threads from using it
         writer->output_ctx = NULL;
         writer->initialized = 0;
-    } else {
+    } else if (!local_ll_writer) {
         log_warn("Output context became NULL during close for stream %s", stream_name);
     }
+    writer->initialized = 0;
 
     // Unlock the mutex if we acquired it
     if (mutex_result == 0) {
@@ -921,6 +1001,11 @@ void hls_writer_close(hls_writer_t *writer) {
     // Increased for better reliability with go2rtc integration
     usleep(500000); // 500ms - increased for more safety with go2rtc
 
+    if (local_ll_writer) {
+        hls_ll_writer_close(local_ll_writer);
+        local_ll_writer = NULL;
+    }
+
     // Write trailer if the context is valid with enhanced safety checks
     if (local_output_ctx) {
         log_info("Writing trailer for HLS writer for stream %s", stream_name);
@@ -934,7 +1019,7 @@ void hls_writer_close(hls_writer_t *writer) {
         // Check if the context is valid and has streams
         if (local_output_ctx->nb_streams > 0) {
             // Verify all critical pointers are valid
-            if (local_output_ctx->oformat && local_output_ctx->pb) {
+            if (local_output_ctx->oformat && (local_output_ctx->pb || writer->memory_store)) {
                 // Additional validation of each stream
                 bool all_streams_valid = true;
                 for (unsigned int i = 0; i < local_output_ctx->nb_streams; i++) {
@@ -1019,6 +1104,12 @@ void hls_writer_close(hls_writer_t *writer) {
         log_info("Successfully freed format context for HLS writer for stream %s", stream_name);
     }
 
+    // Drop the in-memory playlist and segments once the muxer is gone
+    if (writer->memory_store) {
+        hls_memory_store_close(stream_name);
+        writer->memory_store = 0;
+    }
+
     // Free bitstream filter context if it exists
     if (writer->bsf_ctx) {
         log_info("Freeing bitstream filter context for HLS writer for stream %s", stream_name);
@@ -0,0 +1,497 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "core/logger.h"
+#include "core/config.h"
+#include "core/metrics.h"
+#include "video/detection_result.h"
+#include "video/detection_model.h"
+#include "video/inference_scheduler.h"
+#include "sod/sod.h"
+
+#define INFERENCE_MAX_MODELS MAX_STREAMS
+#define INFERENCE_MAX_BATCH 16
+
+// A frame waiting for its batch
+typedef struct inference_job {
+    struct inference_job *next;
+    sod_img image;                      // Frame converted to planar 0-1 floats
+    float threshold;
+    detection_result_t *result;
+    struct timespec deadline;           // Run the batch by this time even if not full
+    int rc;
+    bool done;
+} inference_job_t;
+
+struct inference_model {
+    char path[MAX_PATH_LENGTH];
+    char arch[MAX_PATH_LENGTH];         // Architecture keyword or network config path
+    int refs;                           // Guarded by models_mutex
+
+    sod_cnn *cnn;                       // Used by the worker thread only
+    int batch_size;
+    int max_latency_ms;
+    pthread_t worker;
+
+    pthread_mutex_t mutex;              // Guards the fields below
+    pthread_cond_t queue_cond;          // Signaled when a job is queued or on stop
+    pthread_cond_t done_cond;           // Broadcast when a batch completes
+    inference_job_t *queue_head;
+    inference_job_t *queue_tail;
+    int queue_count;
+    float net_threshold;                // Lowest threshold among the users of the model
+    bool running;
+
+    // Statistics, guarded by mutex
+    unsigned long batches;
+    unsigned long frames;
+
+    metrics_gauge_t queue_depth;
+    metrics_histogram_t batch_time;
+};
+
+static inference_model_t *models[INFERENCE_MAX_MODELS];
+static pthread_mutex_t models_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool initialized = false;
+
+/**
+ * Convert a packed frame to a planar SOD image in the 0-1 range
+ */
+static int frame_to_sod_image(const unsigned char *frame_data, int width, int height,
+                              int channels, sod_img *out) {
+    *out = sod_make_image(width, height, channels);
+    if (!out->data) {
+        return -1;
+    }
+
+    size_t plane = (size_t)width * (size_t)height;
+    for (int c = 0; c < channels; c++) {
+        float *dst = out->data + (size_t)c * plane;
+        const unsigned char *src = frame_data + c;
+        for (size_t i = 0; i < plane; i++) {
+            dst[i] = src[i * channels] / 255.0f;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Fill a detection result from the boxes of one image
+ */
+static void boxes_to_result(const sod_box *boxes, int count, int width, int height,
+                            float threshold, detection_result_t *result) {
+    int valid_count = 0;
+
+    for (int i = 0; i < count && valid_count < MAX_DETECTIONS; i++) {
+        const sod_box *box = &boxes[i];
+
+        if (box->x < 0 || box->y < 0 || box->w <= 0 || box->h <= 0 ||
+            box->x + box->w > width || box->y + box->h > height) {
+            continue;
+        }
+
+        float confidence = box->score;
+        if (confidence > 1.0f) confidence = 1.0f;
+        if (confidence < 0.0f) confidence = 0.0f;
+        if (confidence < threshold) {
+            continue;
+        }
+
+        detection_t *det = &result->detections[valid_count];
+        const char *name = (box->zName && box->zName[0]) ? box->zName : "object";
+        strncpy(det->label, name, MAX_LABEL_LENGTH - 1);
+        det->label[MAX_LABEL_LENGTH - 1] = '\0';
+        det->confidence = confidence;
+        det->x = (float)box->x / width;
+        det->y = (float)box->y / height;
+        det->width = (float)box->w / width;
+        det->height = (float)box->h / height;
+        valid_count++;
+    }
+
+    result->count = valid_count;
+}
+
+/**
+ * Run a batch of jobs through the network and fill their results
+ */
+static void run_batch(inference_model_t *model, inference_job_t **jobs, int count, float net_threshold) {
+    int box_counts[INFERENCE_MAX_BATCH] = {0};
+    sod_box *boxes = NULL;
+
+    for (int i = 0; i < count; i++) {
+        if (!sod_cnn_prepare_batch_image(model->cnn, i, jobs[i]->image)) {
+            log_error("Failed to prepare frame %d of batch for model %s", i, model->path);
+            for (int j = 0; j < count; j++) {
+                jobs[j]->rc = -1;
+            }
+            return;
+        }
+    }
+
+    sod_cnn_config(model->cnn, SOD_CNN_DETECTION_THRESHOLD, net_threshold);
+    if (sod_cnn_predict_batch(model->cnn, count, &boxes, box_counts) != SOD_OK) {
+        log_error("Batched inference failed for model %s", model->path);
+        for (int j = 0; j < count; j++) {
+            jobs[j]->rc = -1;
+        }
+        return;
+    }
+
+    // Boxes of image i follow those of the images before it
+    int offset = 0;
+    for (int i = 0; i < count; i++) {
+        boxes_to_result(boxes ? boxes + offset : NULL, box_counts[i],
+                        jobs[i]->image.w, jobs[i]->image.h, jobs[i]->threshold, jobs[i]->result);
+        jobs[i]->rc = 0;
+        offset += box_counts[i];
+    }
+}
+
+/**
+ * Worker thread of a model
+ *
+ * Waits until the queue holds a full batch or the oldest frame reaches its
+ * deadline, then runs up to batch_size frames in one forward pass.
+ */
+static void *inference_worker(void *arg) {
+    inference_model_t *model = (inference_model_t *)arg;
+    inference_job_t *jobs[INFERENCE_MAX_BATCH];
+
+    pthread_mutex_lock(&model->mutex);
+    while (model->running) {
+        if (model->queue_count == 0) {
+            pthread_cond_wait(&model->queue_cond, &model->mutex);
+            continue;
+        }
+
+        if (model->queue_count < model->batch_size) {
+            // Give other streams until the oldest frame's deadline to join the batch
+            if (pthread_cond_timedwait(&model->queue_cond, &model->mutex,
+                                       &model->queue_head->deadline) != ETIMEDOUT) {
+                continue;
+            }
+        }
+
+        int count = 0;
+        while (model->queue_head && count < model->batch_size) {
+            jobs[count++] = model->queue_head;
+            model->queue_head = model->queue_head->next;
+        }
+        if (!model->queue_head) {
+            model->queue_tail = NULL;
+        }
+        model->queue_count -= count;
+        metrics_gauge_set(model->queue_depth, model->queue_count);
+        float net_threshold = model->net_threshold;
+        pthread_mutex_unlock(&model->mutex);
+
+        uint64_t start_us = metrics_now_us();
+        run_batch(model, jobs, count, net_threshold);
+        metrics_histogram_observe(model->batch_time, metrics_now_us() - start_us);
+
+        pthread_mutex_lock(&model->mutex);
+        for (int i = 0; i < count; i++) {
+            jobs[i]->done = true;
+        }
+        model->batches++;
+        model->frames += count;
+        pthread_cond_broadcast(&model->done_cond);
+    }
+
+    // Fail whatever is still queued
+    while (model->queue_head) {
+        inference_job_t *job = model->queue_head;
+        model->queue_head = job->next;
+        job->rc = -1;
+        job->done = true;
+    }
+    model->queue_tail = NULL;
+    model->queue_count = 0;
+    metrics_gauge_set(model->queue_depth, 0);
+    pthread_cond_broadcast(&model->done_cond);
+    pthread_mutex_unlock(&model->mutex);
+
+    return NULL;
+}
+
+/**
+ * Stop the worker of a model, failing the frames still queued
+ */
+static void stop_model_worker(inference_model_t *model) {
+    pthread_mutex_lock(&model->mutex);
+    bool was_running = model->running;
+    model->running = false;
+    pthread_cond_signal(&model->queue_cond);
+    pthread_mutex_unlock(&model->mutex);
+
+    if (was_running) {
+        pthread_join(model->worker, NULL);
+    }
+}
+
+/**
+ * Stop the worker of a model and free it
+ */
+static void destroy_model(inference_model_t *model) {
+    stop_model_worker(model);
+
+    log_info("Unloading shared model %s after %lu batches (%lu frames)",
+             model->path, model->batches, model->frames);
+
+    sod_cnn_destroy(model->cnn);
+    pthread_mutex_destroy(&model->mutex);
+    pthread_cond_destroy(&model->queue_cond);
+    pthread_cond_destroy(&model->done_cond);
+    free(model);
+}
+
+/**
+ * Initialize the inference scheduler
+ */
+int init_inference_scheduler(void) {
+    pthread_mutex_lock(&models_mutex);
+    if (!initialized) {
+        initialized = true;
+        log_info("Inference scheduler initialized (batch size %d, max latency %d ms)",
+                 g_config.inference_batch_size, g_config.inference_max_latency_ms);
+    }
+    pthread_mutex_unlock(&models_mutex);
+    return 0;
+}
+
+/**
+ * Shutdown the inference scheduler
+ *
+ * Models still referenced by a stream are stopped here and freed by their
+ * last inference_scheduler_release().
+ */
+void shutdown_inference_scheduler(void) {
+    pthread_mutex_lock(&models_mutex);
+    initialized = false;
+    for (int i = 0; i < INFERENCE_MAX_MODELS; i++) {
+        if (!models[i]) {
+            continue;
+        }
+        if (models[i]->refs > 0) {
+            stop_model_worker(models[i]);
+        } else {
+            destroy_model(models[i]);
+            models[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&models_mutex);
+
+    log_info("Inference scheduler shutdown");
+}
+
+/**
+ * Check if frames are batched across streams
+ */
+int is_inference_batching_enabled(void) {
+    return g_config.inference_batch_size > 1;
+}
+
+/**
+ * Get a reference to a shared CNN model, loading it on first use
+ */
+inference_model_t *inference_scheduler_acquire(const char *model_path, const char *arch,
+                                               float threshold) {
+    if (!model_path || !arch) {
+        log_error("Invalid parameters for inference_scheduler_acquire");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&models_mutex);
+    if (!initialized) {
+        pthread_mutex_unlock(&models_mutex);
+        log_error("Inference scheduler not initialized");
+        return NULL;
+    }
+
+    int free_slot = -1;
+    for (int i = 0; i < INFERENCE_MAX_MODELS; i++) {
+        inference_model_t *model = models[i];
+        if (!model) {
+            if (free_slot < 0) {
+                free_slot = i;
+            }
+            continue;
+        }
+        if (strcmp(model->path, model_path) == 0 && strcmp(model->arch, arch) == 0) {
+            model->refs++;
+            pthread_mutex_lock(&model->mutex);
+            if (threshold < model->net_threshold) {
+                model->net_threshold = threshold;
+            }
+            pthread_mutex_unlock(&model->mutex);
+            pthread_mutex_unlock(&models_mutex);
+            log_info("Sharing loaded model %s (%d users)", model_path, model->refs);
+            return model;
+        }
+    }
+
+    if (free_slot < 0) {
+        pthread_mutex_unlock(&models_mutex);
+        log_error("Too many shared models loaded, cannot load %s", model_path);
+        return NULL;
+    }
+
+    inference_model_t *model = calloc(1, sizeof(inference_model_t));
+    if (!model) {
+        pthread_mutex_unlock(&models_mutex);
+        log_error("Failed to allocate shared model structure");
+        return NULL;
+    }
+
+    strncpy(model->path, model_path, MAX_PATH_LENGTH - 1);
+    strncpy(model->arch, arch, sizeof(model->arch) - 1);
+    model->refs = 1;
+    model->net_threshold = threshold;
+    model->batch_size = g_config.inference_batch_size;
+    if (model->batch_size < 1) {
+        model->batch_size = 1;
+    } else if (model->batch_size > INFERENCE_MAX_BATCH) {
+        model->batch_size = INFERENCE_MAX_BATCH;
+    }
+    model->max_latency_ms = g_config.inference_max_latency_ms;
+
+    const char *model_name = strrchr(model_path, '/');
+    char labels[128] = "";
+    metrics_label(labels, sizeof(labels), "model", model_name ? model_name + 1 : model_path);
+    model->queue_depth = metrics_gauge("lightnvr_detection_queue_depth",
+                                       "Frames waiting for a batched forward pass", labels);
+    model->batch_time = metrics_histogram("lightnvr_inference_batch_seconds",
+                                          "Time of one batched forward pass", labels);
+
+    // Loaded under models_mutex so concurrent streams do not load the same file twice
+    const char *err_msg = NULL;
+    int rc;
+    if (is_quantized_model(model_path)) {
+        rc = sod_cnn_create_quantized(&model->cnn, model_path, model->batch_size, &err_msg);
+    } else {
+        rc = sod_cnn_create_batch(&model->cnn, arch, model_path, model->batch_size, &err_msg);
+    }
+    if (rc != SOD_OK || !model->cnn) {
+        pthread_mutex_unlock(&models_mutex);
+        log_error("Failed to load shared model %s: %s", model_path, err_msg ? err_msg : "Unknown error");
+        free(model);
+        return NULL;
+    }
+
+    // The convolution thread pool is process wide, every model sets the same size
+    sod_cnn_config(model->cnn, SOD_CNN_NUM_THREADS, g_config.inference_threads);
+
+    pthread_mutex_init(&model->mutex, NULL);
+    pthread_cond_init(&model->queue_cond, NULL);
+    pthread_cond_init(&model->done_cond, NULL);
+    model->running = true;
+
+    if (pthread_create(&model->worker, NULL, inference_worker, model) != 0) {
+        pthread_mutex_unlock(&models_mutex);
+        log_error("Failed to create inference worker for %s", model_path);
+        sod_cnn_destroy(model->cnn);
+        pthread_mutex_destroy(&model->mutex);
+        pthread_cond_destroy(&model->queue_cond);
+        pthread_cond_destroy(&model->done_cond);
+        free(model);
+        return NULL;
+    }
+
+    models[free_slot] = model;
+    pthread_mutex_unlock(&models_mutex);
+
+    log_info("Loaded shared model %s (%s, batch size %d, max latency %d ms)",
+             model_path, arch, model->batch_size, model->max_latency_ms);
+    return model;
+}
+
+/**
+ * Release a reference obtained with inference_scheduler_acquire()
+ */
+void inference_scheduler_release(inference_model_t *model) {
+    if (!model) {
+        return;
+    }
+
+    bool last = false;
+    pthread_mutex_lock(&models_mutex);
+    for (int i = 0; i < INFERENCE_MAX_MODELS; i++) {
+        if (models[i] == model) {
+            if (--model->refs == 0) {
+                models[i] = NULL;
+                last = true;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&models_mutex);
+
+    if (last) {
+        destroy_model(model);
+    }
+}
+
+/**
+ * Run detection on a frame through the batch queue of a model
+ */
+int inference_scheduler_detect(inference_model_t *model, const unsigned char *frame_data,
+                               int width, int height, int channels, float threshold,
+                               detection_result_t *result) {
+    if (!model || !frame_data || !result || width <= 0 || height <= 0 ||
+        channels <= 0 || channels > 4) {
+        log_error("Invalid parameters for inference_scheduler_detect");
+        return -1;
+    }
+
+    inference_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.threshold = threshold;
+    job.result = result;
+    job.rc = -1;
+    result->count = 0;
+
+    // Converted here so the streams share the conversion work, not the worker
+    if (frame_to_sod_image(frame_data, width, height, channels, &job.image) != 0) {
+        log_error("Failed to create SOD image for batched inference");
+        return -1;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &job.deadline);
+    job.deadline.tv_sec += model->max_latency_ms / 1000;
+    job.deadline.tv_nsec += (long)(model->max_latency_ms % 1000) * 1000000L;
+    if (job.deadline.tv_nsec >= 1000000000L) {
+        job.deadline.tv_sec++;
+        job.deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&model->mutex);
+    if (!model->running) {
+        pthread_mutex_unlock(&model->mutex);
+        sod_free_image(job.image);
+        return -1;
+    }
+
+    if (model->queue_tail) {
+        model->queue_tail->next = &job;
+    } else {
+        model->queue_head = &job;
+    }
+    model->queue_tail = &job;
+    model->queue_count++;
+    metrics_gauge_set(model->queue_depth, model->queue_count);
+    pthread_cond_signal(&model->queue_cond);
+
+    while (!job.done) {
+        pthread_cond_wait(&model->done_cond, &model->mutex);
+    }
+    pthread_mutex_unlock(&model->mutex);
+
+    sod_free_image(job.image);
+    return job.rc;
+}
@@ -0,0 +1,764 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MOTION_KERNELS_X86 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MOTION_KERNELS_NEON 1
+#endif
+
+#include "core/logger.h"
+#include "video/motion_kernels.h"
+
+#define SCRATCH_ALIGN 32
+#define ALIGN_UP(x) (((x) + SCRATCH_ALIGN - 1) & ~(size_t)(SCRATCH_ALIGN - 1))
+
+/**
+ * Reciprocal for dividing sums of at most 255 * count by count
+ * (x * reciprocal(count)) >> 16 is exact for count in 2..16
+ */
+static inline uint32_t reciprocal(int count) {
+    return (65536u + (uint32_t)count - 1) / (uint32_t)count;
+}
+
+/* ---------------------------------------------------------------------------
+ * Scalar kernels
+ * ------------------------------------------------------------------------ */
+
+static void accumulate_row_scalar(const uint8_t *src, uint16_t *acc, int n) {
+    for (int i = 0; i < n; i++) {
+        acc[i] += src[i];
+    }
+}
+
+static void reduce_row_scalar(const uint16_t *acc, uint8_t *dst, int out_width, int factor) {
+    const int area = factor * factor;
+    for (int x = 0; x < out_width; x++) {
+        const uint16_t *block = acc + x * factor;
+        int sum = 0;
+        for (int i = 0; i < factor; i++) {
+            sum += block[i];
+        }
+        dst[x] = (uint8_t)(sum / area);
+    }
+}
+
+static void column_update_scalar(uint16_t *colsum, const uint8_t *add, const uint8_t *sub, int n) {
+    for (int i = 0; i < n; i++) {
+        colsum[i] = (uint16_t)(colsum[i] + add[i] - sub[i]);
+    }
+}
+
+static void column_average_scalar(const uint16_t *colsum, uint8_t *dst, int n, int count) {
+    if (count == 1) {
+        for (int i = 0; i < n; i++) {
+            dst[i] = (uint8_t)colsum[i];
+        }
+        return;
+    }
+    const uint32_t recip = reciprocal(count);
+    for (int i = 0; i < n; i++) {
+        dst[i] = (uint8_t)((colsum[i] * recip) >> 16);
+    }
+}
+
+static void diff_row_scalar(const uint8_t *cur, const uint8_t *prev, const uint8_t *bg, int n,
+                            int threshold, uint32_t *changed, uint32_t *total) {
+    uint32_t c = 0, t = 0;
+    for (int i = 0; i < n; i++) {
+        int frame_diff = abs((int)cur[i] - (int)prev[i]);
+        int bg_diff = abs((int)cur[i] - (int)bg[i]);
+        int diff = (frame_diff > bg_diff) ? frame_diff : bg_diff;
+        if (diff > threshold) {
+            c++;
+            t += diff;
+        }
+    }
+    *changed += c;
+    *total += t;
+}
+
+static void background_row_scalar(uint8_t *bg, const uint8_t *cur, int n, int alpha) {
+    const int inv_alpha = 256 - alpha;
+    for (int i = 0; i < n; i++) {
+        bg[i] = (uint8_t)((inv_alpha * bg[i] + alpha * cur[i]) >> 8);
+    }
+}
+
+/**
+ * Blur the left and right edges of a row, where the window is cut off
+ * and shrinks to the pixels inside the row
+ */
+static void hblur_edges(const uint8_t *src, uint8_t *dst, int n, int radius) {
+    for (int x = 0; x < radius && x < n; x++) {
+        int sum = 0, count = 0;
+        for (int i = x - radius; i <= x + radius; i++) {
+            if (i >= 0 && i < n) {
+                sum += src[i];
+                count++;
+            }
+        }
+        dst[x] = (uint8_t)(sum / count);
+    }
+    for (int x = (n - radius > radius) ? n - radius : radius; x < n; x++) {
+        int sum = 0, count = 0;
+        for (int i = x - radius; i <= x + radius; i++) {
+            if (i >= 0 && i < n) {
+                sum += src[i];
+                count++;
+            }
+        }
+        dst[x] = (uint8_t)(sum / count);
+    }
+}
+
+static void hblur_row_scalar(const uint8_t *src, uint8_t *dst, int n, int radius) {
+    if (radius <= 0) {
+        memcpy(dst, src, n);
+        return;
+    }
+
+    hblur_edges(src, dst, n, radius);
+    if (n <= 2 * radius) {
+        return;
+    }
+
+    // Sliding window over the pixels with a full window
+    const uint32_t recip = reciprocal(2 * radius + 1);
+    uint32_t sum = 0;
+    for (int i = 0; i <= 2 * radius; i++) {
+        sum += src[i];
+    }
+    dst[radius] = (uint8_t)((sum * recip) >> 16);
+    for (int x = radius + 1; x < n - radius; x++) {
+        sum += src[x + radius] - src[x - radius - 1];
+        dst[x] = (uint8_t)((sum * recip) >> 16);
+    }
+}
+
+/**
+ * Blur pixels [from, to) of a row that all have a full window
+ */
+static void hblur_interior_scalar(const uint8_t *src, uint8_t *dst, int from, int to, int radius) {
+    const uint32_t recip = reciprocal(2 * radius + 1);
+    for (int x = from; x < to; x++) {
+        uint32_t sum = 0;
+        for (int i = x - radius; i <= x + radius; i++) {
+            sum += src[i];
+        }
+        dst[x] = (uint8_t)((sum * recip) >> 16);
+    }
+}
+
+static const motion_kernels_t scalar_kernels = {
+    .name = "scalar",
+    .accumulate_row = accumulate_row_scalar,
+    .reduce_row = reduce_row_scalar,
+    .hblur_row = hblur_row_scalar,
+    .column_update = column_update_scalar,
+    .column_average = column_average_scalar,
+    .diff_row = diff_row_scalar,
+    .background_row = background_row_scalar,
+};
+
+/* ---------------------------------------------------------------------------
+ * SSE2 / AVX2 kernels
+ * ------------------------------------------------------------------------ */
+
+#ifdef MOTION_KERNELS_X86
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+TARGET_SSE2 static void accumulate_row_sse2(const uint8_t *src, uint16_t *acc, int n) {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i a0 = _mm_loadu_si128((const __m128i *)(acc + i));
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(acc + i + 8));
+        _mm_storeu_si128((__m128i *)(acc + i), _mm_add_epi16(a0, _mm_unpacklo_epi8(v, zero)));
+        _mm_storeu_si128((__m128i *)(acc + i + 8), _mm_add_epi16(a1, _mm_unpackhi_epi8(v, zero)));
+    }
+    accumulate_row_scalar(src + i, acc + i, n - i);
+}
+
+TARGET_SSE2 static void reduce_row_sse2(const uint16_t *acc, uint8_t *dst, int out_width, int factor) {
+    if (factor != 2) {
+        reduce_row_scalar(acc, dst, out_width, factor);
+        return;
+    }
+
+    // Sums of 2x2 blocks: add neighbouring 16-bit lanes as 32-bit pairs, then divide by 4
+    const __m128i low_mask = _mm_set1_epi32(0xFFFF);
+    int x = 0;
+    for (; x + 8 <= out_width; x += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(acc + 2 * x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(acc + 2 * x + 8));
+        __m128i sa = _mm_add_epi32(_mm_and_si128(a, low_mask), _mm_srli_epi32(a, 16));
+        __m128i sb = _mm_add_epi32(_mm_and_si128(b, low_mask), _mm_srli_epi32(b, 16));
+        __m128i s = _mm_srli_epi16(_mm_packs_epi32(sa, sb), 2);
+        _mm_storel_epi64((__m128i *)(dst + x), _mm_packus_epi16(s, s));
+    }
+    reduce_row_scalar(acc + 2 * x, dst + x, out_width - x, factor);
+}
+
+TARGET_SSE2 static void hblur_row_sse2(const uint8_t *src, uint8_t *dst, int n, int radius) {
+    if (radius <= 0 || n <= 2 * radius) {
+        hblur_row_scalar(src, dst, n, radius);
+        return;
+    }
+
+    // Sum the 2 * radius + 1 shifted rows for 16 pixels at a time
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i recip = _mm_set1_epi16((short)reciprocal(2 * radius + 1));
+    int x = radius;
+    for (; x + 16 <= n - radius; x += 16) {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        for (int d = -radius; d <= radius; d++) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + x + d));
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+        }
+        lo = _mm_mulhi_epu16(lo, recip);
+        hi = _mm_mulhi_epu16(hi, recip);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    hblur_interior_scalar(src, dst, x, n - radius, radius);
+    hblur_edges(src, dst, n, radius);
+}
+
+TARGET_SSE2 static void column_update_sse2(uint16_t *colsum, const uint8_t *add, const uint8_t *sub, int n) {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(add + i));
+        __m128i vs = _mm_loadu_si128((const __m128i *)(sub + i));
+        __m128i c0 = _mm_loadu_si128((const __m128i *)(colsum + i));
+        __m128i c1 = _mm_loadu_si128((const __m128i *)(colsum + i + 8));
+        c0 = _mm_sub_epi16(_mm_add_epi16(c0, _mm_unpacklo_epi8(va, zero)), _mm_unpacklo_epi8(vs, zero));
+        c1 = _mm_sub_epi16(_mm_add_epi16(c1, _mm_unpackhi_epi8(va, zero)), _mm_unpackhi_epi8(vs, zero));
+        _mm_storeu_si128((__m128i *)(colsum + i), c0);
+        _mm_storeu_si128((__m128i *)(colsum + i + 8), c1);
+    }
+    column_update_scalar(colsum + i, add + i, sub + i, n - i);
+}
+
+TARGET_SSE2 static void column_average_sse2(const uint16_t *colsum, uint8_t *dst, int n, int count) {
+    int i = 0;
+    if (count == 1) {
+        for (; i + 16 <= n; i += 16) {
+            __m128i c0 = _mm_loadu_si128((const __m128i *)(colsum + i));
+            __m128i c1 = _mm_loadu_si128((const __m128i *)(colsum + i + 8));
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(c0, c1));
+        }
+    } else {
+        const __m128i recip = _mm_set1_epi16((short)reciprocal(count));
+        for (; i + 16 <= n; i += 16) {
+            __m128i c0 = _mm_mulhi_epu16(_mm_loadu_si128((const __m128i *)(colsum + i)), recip);
+            __m128i c1 = _mm_mulhi_epu16(_mm_loadu_si128((const __m128i *)(colsum + i + 8)), recip);
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(c0, c1));
+        }
+    }
+    column_average_scalar(colsum + i, dst + i, n - i, count);
+}
+
+TARGET_SSE2 static void diff_row_sse2(const uint8_t *cur, const uint8_t *prev, const uint8_t *bg, int n,
+                                      int threshold, uint32_t *changed, uint32_t *total) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i limit = _mm_set1_epi8((char)(threshold + 1));
+    __m128i count_acc = _mm_setzero_si128();
+    __m128i total_acc = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(cur + i));
+        __m128i p = _mm_loadu_si128((const __m128i *)(prev + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(bg + i));
+        __m128i dp = _mm_or_si128(_mm_subs_epu8(c, p), _mm_subs_epu8(p, c));
+        __m128i db = _mm_or_si128(_mm_subs_epu8(c, b), _mm_subs_epu8(b, c));
+        __m128i d = _mm_max_epu8(dp, db);
+        // d > threshold  <=>  max(d, threshold + 1) == d
+        __m128i mask = _mm_cmpeq_epi8(_mm_max_epu8(d, limit), d);
+        count_acc = _mm_add_epi64(count_acc, _mm_sad_epu8(_mm_and_si128(mask, ones), zero));
+        total_acc = _mm_add_epi64(total_acc, _mm_sad_epu8(_mm_and_si128(mask, d), zero));
+    }
+
+    *changed += (uint32_t)(_mm_cvtsi128_si32(count_acc) + _mm_cvtsi128_si32(_mm_srli_si128(count_acc, 8)));
+    *total += (uint32_t)(_mm_cvtsi128_si32(total_acc) + _mm_cvtsi128_si32(_mm_srli_si128(total_acc, 8)));
+    diff_row_scalar(cur + i, prev + i, bg + i, n - i, threshold, changed, total);
+}
+
+TARGET_SSE2 static void background_row_sse2(uint8_t *bg, const uint8_t *cur, int n, int alpha) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i va = _mm_set1_epi16((short)alpha);
+    const __m128i vi = _mm_set1_epi16((short)(256 - alpha));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *)(bg + i));
+        __m128i c = _mm_loadu_si128((const __m128i *)(cur + i));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), vi),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(c, zero), va));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), vi),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(c, zero), va));
+        _mm_storeu_si128((__m128i *)(bg + i),
+                         _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+    background_row_scalar(bg + i, cur + i, n - i, alpha);
+}
+
+static const motion_kernels_t sse2_kernels = {
+    .name = "sse2",
+    .accumulate_row = accumulate_row_sse2,
+    .reduce_row = reduce_row_sse2,
+    .hblur_row = hblur_row_sse2,
+    .column_update = column_update_sse2,
+    .column_average = column_average_sse2,
+    .diff_row = diff_row_sse2,
+    .background_row = background_row_sse2,
+};
+
+TARGET_AVX2 static void accumulate_row_avx2(const uint8_t *src, uint16_t *acc, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src + i)));
+        __m256i a = _mm256_loadu_si256((const __m256i *)(acc + i));
+        _mm256_storeu_si256((__m256i *)(acc + i), _mm256_add_epi16(a, v));
+    }
+    accumulate_row_scalar(src + i, acc + i, n - i);
+}
+
+TARGET_AVX2 static void hblur_row_avx2(const uint8_t *src, uint8_t *dst, int n, int radius) {
+    if (radius <= 0 || n <= 2 * radius) {
+        hblur_row_scalar(src, dst, n, radius);
+        return;
+    }
+
+    const __m256i recip = _mm256_set1_epi16((short)reciprocal(2 * radius + 1));
+    int x = radius;
+    for (; x + 16 <= n - radius; x += 16) {
+        __m256i sum = _mm256_setzero_si256();
+        for (int d = -radius; d <= radius; d++) {
+            sum = _mm256_add_epi16(sum, _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src + x + d))));
+        }
+        sum = _mm256_mulhi_epu16(sum, recip);
+        _mm_storeu_si128((__m128i *)(dst + x),
+                         _mm_packus_epi16(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)));
+    }
+    hblur_interior_scalar(src, dst, x, n - radius, radius);
+    hblur_edges(src, dst, n, radius);
+}
+
+TARGET_AVX2 static void column_update_avx2(uint16_t *colsum, const uint8_t *add, const uint8_t *sub, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(add + i)));
+        __m256i vs = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(sub + i)));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(colsum + i));
+        _mm256_storeu_si256((__m256i *)(colsum + i), _mm256_sub_epi16(_mm256_add_epi16(c, va), vs));
+    }
+    column_update_scalar(colsum + i, add + i, sub + i, n - i);
+}
+
+TARGET_AVX2 static void column_average_avx2(const uint16_t *colsum, uint8_t *dst, int n, int count) {
+    // A single row needs no division
+    const int direct = (count == 1);
+    const __m256i recip = _mm256_set1_epi16((short)reciprocal(direct ? 2 : count));
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i c0 = _mm256_loadu_si256((const __m256i *)(colsum + i));
+        __m256i c1 = _mm256_loadu_si256((const __m256i *)(colsum + i + 16));
+        if (!direct) {
+            c0 = _mm256_mulhi_epu16(c0, recip);
+            c1 = _mm256_mulhi_epu16(c1, recip);
+        }
+        // packus works per 128-bit lane, restore the element order afterwards
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(c0, c1), 0xD8);
+        _mm256_storeu_si256((__m256i *)(dst + i), packed);
+    }
+    column_average_scalar(colsum + i, dst + i, n - i, count);
+}
+
+TARGET_AVX2 static void diff_row_avx2(const uint8_t *cur, const uint8_t *prev, const uint8_t *bg, int n,
+                                      int threshold, uint32_t *changed, uint32_t *total) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi8(1);
+    const __m256i limit = _mm256_set1_epi8((char)(threshold + 1));
+    __m256i count_acc = _mm256_setzero_si256();
+    __m256i total_acc = _mm256_setzero_si256();
+    int i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(cur + i));
+        __m256i p = _mm256_loadu_si256((const __m256i *)(prev + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(bg + i));
+        __m256i dp = _mm256_or_si256(_mm256_subs_epu8(c, p), _mm256_subs_epu8(p, c));
+        __m256i db = _mm256_or_si256(_mm256_subs_epu8(c, b), _mm256_subs_epu8(b, c));
+        __m256i d = _mm256_max_epu8(dp, db);
+        __m256i mask = _mm256_cmpeq_epi8(_mm256_max_epu8(d, limit), d);
+        count_acc = _mm256_add_epi64(count_acc, _mm256_sad_epu8(_mm256_and_si256(mask, ones), zero));
+        total_acc = _mm256_add_epi64(total_acc, _mm256_sad_epu8(_mm256_and_si256(mask, d), zero));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, count_acc);
+    *changed += (uint32_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    _mm256_storeu_si256((__m256i *)lanes, total_acc);
+    *total += (uint32_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    diff_row_scalar(cur + i, prev + i, bg + i, n - i, threshold, changed, total);
+}
+
+TARGET_AVX2 static void background_row_avx2(uint8_t *bg, const uint8_t *cur, int n, int alpha) {
+    const __m256i va = _mm256_set1_epi16((short)alpha);
+    const __m256i vi = _mm256_set1_epi16((short)(256 - alpha));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(bg + i)));
+        __m256i c = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(cur + i)));
+        __m256i v = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(b, vi),
+                                                       _mm256_mullo_epi16(c, va)), 8);
+        __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storeu_si128((__m128i *)(bg + i), packed);
+    }
+    background_row_scalar(bg + i, cur + i, n - i, alpha);
+}
+
+static const motion_kernels_t avx2_kernels = {
+    .name = "avx2",
+    .accumulate_row = accumulate_row_avx2,
+    .reduce_row = reduce_row_sse2,
+    .hblur_row = hblur_row_sse2,
+    .column_update = column_update_avx2,
+    .column_average = column_average_avx2,
+    .diff_row = diff_row_avx2,
+    .background_row = background_row_avx2,
+};
+
+#endif /* MOTION_KERNELS_X86 */
+
+/* ---------------------------------------------------------------------------
+ * NEON kernels
+ * ------------------------------------------------------------------------ */
+
+#ifdef MOTION_KERNELS_NEON
+
+static void accumulate_row_neon(const uint8_t *src, uint16_t *acc, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        vst1q_u16(acc + i, vaddw_u8(vld1q_u16(acc + i), vget_low_u8(v)));
+        vst1q_u16(acc + i + 8, vaddw_u8(vld1q_u16(acc + i + 8), vget_high_u8(v)));
+    }
+    accumulate_row_scalar(src + i, acc + i, n - i);
+}
+
+static void reduce_row_neon(const uint16_t *acc, uint8_t *dst, int out_width, int factor) {
+    if (factor != 2) {
+        reduce_row_scalar(acc, dst, out_width, factor);
+        return;
+    }
+
+    int x = 0;
+    for (; x + 8 <= out_width; x += 8) {
+        uint16x8_t a = vld1q_u16(acc + 2 * x);
+        uint16x8_t b = vld1q_u16(acc + 2 * x + 8);
+        uint16x8_t s = vcombine_u16(vpadd_u16(vget_low_u16(a), vget_high_u16(a)),
+                                    vpadd_u16(vget_low_u16(b), vget_high_u16(b)));
+        vst1_u8(dst + x, vshrn_n_u16(s, 2));
+    }
+    reduce_row_scalar(acc + 2 * x, dst + x, out_width - x, factor);
+}
+
+static void hblur_row_neon(const uint8_t *src, uint8_t *dst, int n, int radius) {
+    if (radius <= 0 || n <= 2 * radius) {
+        hblur_row_scalar(src, dst, n, radius);
+        return;
+    }
+
+    const uint16x4_t recip = vdup_n_u16((uint16_t)reciprocal(2 * radius + 1));
+    int x = radius;
+    for (; x + 8 <= n - radius; x += 8) {
+        uint16x8_t sum = vdupq_n_u16(0);
+        for (int d = -radius; d <= radius; d++) {
+            sum = vaddw_u8(sum, vld1_u8(src + x + d));
+        }
+        uint16x4_t lo = vshrn_n_u32(vmull_u16(vget_low_u16(sum), recip), 16);
+        uint16x4_t hi = vshrn_n_u32(vmull_u16(vget_high_u16(sum), recip), 16);
+        vst1_u8(dst + x, vmovn_u16(vcombine_u16(lo, hi)));
+    }
+    hblur_interior_scalar(src, dst, x, n - radius, radius);
+    hblur_edges(src, dst, n, radius);
+}
+
+static void column_update_neon(uint16_t *colsum, const uint8_t *add, const uint8_t *sub, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t va = vld1q_u8(add + i);
+        uint8x16_t vs = vld1q_u8(sub + i);
+        uint16x8_t c0 = vsubw_u8(vaddw_u8(vld1q_u16(colsum + i), vget_low_u8(va)), vget_low_u8(vs));
+        uint16x8_t c1 = vsubw_u8(vaddw_u8(vld1q_u16(colsum + i + 8), vget_high_u8(va)), vget_high_u8(vs));
+        vst1q_u16(colsum + i, c0);
+        vst1q_u16(colsum + i + 8, c1);
+    }
+    column_update_scalar(colsum + i, add + i, sub + i, n - i);
+}
+
+static void column_average_neon(const uint16_t *colsum, uint8_t *dst, int n, int count) {
+    int i = 0;
+    if (count == 1) {
+        for (; i + 8 <= n; i += 8) {
+            vst1_u8(dst + i, vmovn_u16(vld1q_u16(colsum + i)));
+        }
+    } else {
+        const uint16x4_t recip = vdup_n_u16((uint16_t)reciprocal(count));
+        for (; i + 8 <= n; i += 8) {
+            uint16x8_t c = vld1q_u16(colsum + i);
+            uint16x4_t lo = vshrn_n_u32(vmull_u16(vget_low_u16(c), recip), 16);
+            uint16x4_t hi = vshrn_n_u32(vmull_u16(vget_high_u16(c), recip), 16);
+            vst1_u8(dst + i, vmovn_u16(vcombine_u16(lo, hi)));
+        }
+    }
+    column_average_scalar(colsum + i, dst + i, n - i, count);
+}
+
+static void diff_row_neon(const uint8_t *cur, const uint8_t *prev, const uint8_t *bg, int n,
+                          int threshold, uint32_t *changed, uint32_t *total) {
+    const uint8x16_t limit = vdupq_n_u8((uint8_t)threshold);
+    const uint8x16_t ones = vdupq_n_u8(1);
+    uint32x4_t count_acc = vdupq_n_u32(0);
+    uint32x4_t total_acc = vdupq_n_u32(0);
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t c = vld1q_u8(cur + i);
+        uint8x16_t d = vmaxq_u8(vabdq_u8(c, vld1q_u8(prev + i)), vabdq_u8(c, vld1q_u8(bg + i)));
+        uint8x16_t mask = vcgtq_u8(d, limit);
+        count_acc = vpadalq_u16(count_acc, vpaddlq_u8(vandq_u8(mask, ones)));
+        total_acc = vpadalq_u16(total_acc, vpaddlq_u8(vandq_u8(mask, d)));
+    }
+
+    uint32_t lanes[4];
+    vst1q_u32(lanes, count_acc);
+    *changed += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    vst1q_u32(lanes, total_acc);
+    *total += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    diff_row_scalar(cur + i, prev + i, bg + i, n - i, threshold, changed, total);
+}
+
+static void background_row_neon(uint8_t *bg, const uint8_t *cur, int n, int alpha) {
+    const uint16_t inv_alpha = (uint16_t)(256 - alpha);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t v = vmulq_n_u16(vmovl_u8(vld1_u8(bg + i)), inv_alpha);
+        v = vmlaq_n_u16(v, vmovl_u8(vld1_u8(cur + i)), (uint16_t)alpha);
+        vst1_u8(bg + i, vshrn_n_u16(v, 8));
+    }
+    background_row_scalar(bg + i, cur + i, n - i, alpha);
+}
+
+static const motion_kernels_t neon_kernels = {
+    .name = "neon",
+    .accumulate_row = accumulate_row_neon,
+    .reduce_row = reduce_row_neon,
+    .hblur_row = hblur_row_neon,
+    .column_update = column_update_neon,
+    .column_average = column_average_neon,
+    .diff_row = diff_row_neon,
+    .background_row = background_row_neon,
+};
+
+#endif /* MOTION_KERNELS_NEON */
+
+/* ---------------------------------------------------------------------------
+ * Kernel selection
+ * ------------------------------------------------------------------------ */
+
+static const motion_kernels_t *selected_kernels = &scalar_kernels;
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+static void select_kernels(void) {
+#ifdef MOTION_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        selected_kernels = &avx2_kernels;
+    } else if (__builtin_cpu_supports("sse2")) {
+        selected_kernels = &sse2_kernels;
+    }
+#elif defined(MOTION_KERNELS_NEON)
+    selected_kernels = &neon_kernels;
+#endif
+
+    // Allow forcing the scalar path to compare results
+    const char *override = getenv("LIGHTNVR_MOTION_KERNELS");
+    if (override && strcmp(override, "scalar") == 0) {
+        selected_kernels = &scalar_kernels;
+    }
+
+    log_info("Motion detection using %s kernels", selected_kernels->name);
+}
+
+const motion_kernels_t *motion_kernels_get(void) {
+    pthread_once(&kernels_once, select_kernels);
+    return selected_kernels;
+}
+
+/* ---------------------------------------------------------------------------
+ * Fused pass
+ * ------------------------------------------------------------------------ */
+
+/**
+ * Scratch layout: luma row, downscale accumulator, blur ring, column sums,
+ * downscaled row and a row of zeros
+ */
+typedef struct {
+    uint8_t *luma;
+    uint16_t *acc;
+    uint8_t *ring;
+    uint16_t *colsum;
+    uint8_t *row;
+    uint8_t *zero;
+    int ring_rows;
+} scratch_t;
+
+static size_t layout_scratch(uint8_t *base, int src_width, int width, int blur_radius, scratch_t *s) {
+    const int ring_rows = 2 * blur_radius + 2;
+    size_t offset = 0;
+
+    if (s) s->luma = base + offset;
+    offset += ALIGN_UP((size_t)src_width);
+    if (s) s->acc = (uint16_t *)(base + offset);
+    offset += ALIGN_UP((size_t)src_width * sizeof(uint16_t));
+    if (s) s->ring = base + offset;
+    offset += ALIGN_UP((size_t)ring_rows * width);
+    if (s) s->colsum = (uint16_t *)(base + offset);
+    offset += ALIGN_UP((size_t)width * sizeof(uint16_t));
+    if (s) s->row = base + offset;
+    offset += ALIGN_UP((size_t)width);
+    if (s) s->zero = base + offset;
+    offset += ALIGN_UP((size_t)width);
+    if (s) s->ring_rows = ring_rows;
+
+    return offset;
+}
+
+size_t motion_scratch_size(int src_width, int width, int blur_radius) {
+    return layout_scratch(NULL, src_width, width, blur_radius, NULL);
+}
+
+/**
+ * Convert a packed RGB row to luma with 8-bit fixed-point coefficients
+ */
+static void luma_rgb_row(const uint8_t *rgb, uint8_t *dst, int n) {
+    const int r_coeff = (int)(0.299f * 256);
+    const int g_coeff = (int)(0.587f * 256);
+    const int b_coeff = (int)(0.114f * 256);
+
+    for (int i = 0; i < n; i++) {
+        dst[i] = (uint8_t)((r_coeff * rgb[0] + g_coeff * rgb[1] + b_coeff * rgb[2]) >> 8);
+        rgb += 3;
+    }
+}
+
+/**
+ * Get a luma row of the source frame
+ */
+static const uint8_t *source_row(const motion_pass_t *p, const scratch_t *s, int y) {
+    const uint8_t *row = p->src + (size_t)y * p->src_stride;
+    if (p->channels == 1) {
+        return row;
+    }
+    luma_rgb_row(row, s->luma, p->src_width);
+    return s->luma;
+}
+
+/**
+ * Build processing row y (downscaled and horizontally blurred) into the ring
+ */
+static void produce_row(const motion_kernels_t *k, const motion_pass_t *p, const scratch_t *s, int y) {
+    const uint8_t *row;
+
+    if (p->factor <= 1) {
+        row = source_row(p, s, y);
+    } else {
+        const int span = p->width * p->factor;
+        memset(s->acc, 0, span * sizeof(uint16_t));
+        for (int dy = 0; dy < p->factor; dy++) {
+            k->accumulate_row(source_row(p, s, y * p->factor + dy), s->acc, span);
+        }
+        k->reduce_row(s->acc, s->row, p->width, p->factor);
+        row = s->row;
+    }
+
+    k->hblur_row(row, s->ring + (size_t)(y % s->ring_rows) * p->width, p->width, p->blur_radius);
+}
+
+void motion_fused_pass(const motion_kernels_t *k, const motion_pass_t *p) {
+    scratch_t s;
+    layout_scratch(p->scratch, p->src_width, p->width, p->blur_radius, &s);
+
+    const int w = p->width;
+    const int h = p->height;
+    const int r = p->blur_radius;
+    const int cell_width = w / p->grid_size;
+    const int cell_height = h / p->grid_size;
+    const int grid_rows = cell_height * p->grid_size;
+
+    memset(s.colsum, 0, w * sizeof(uint16_t));
+    memset(s.zero, 0, w);
+
+    // Prime the vertical window with rows 0..r
+    for (int y = 0; y <= r && y < h; y++) {
+        produce_row(k, p, &s, y);
+        k->column_update(s.colsum, s.ring + (size_t)(y % s.ring_rows) * w, s.zero, w);
+    }
+
+    for (int y = 0; y < h; y++) {
+        if (y > 0) {
+            const int enter = y + r;
+            const int leave = y - r - 1;
+            const uint8_t *add = s.zero;
+            const uint8_t *sub = s.zero;
+
+            if (enter < h) {
+                produce_row(k, p, &s, enter);
+                add = s.ring + (size_t)(enter % s.ring_rows) * w;
+            }
+            if (leave >= 0) {
+                sub = s.ring + (size_t)(leave % s.ring_rows) * w;
+            }
+            if (add != s.zero || sub != s.zero) {
+                k->column_update(s.colsum, add, sub, w);
+            }
+        }
+
+        const int top = (y - r > 0) ? y - r : 0;
+        const int bottom = (y + r < h - 1) ? y + r : h - 1;
+        uint8_t *out = p->out + (size_t)y * w;
+        uint8_t *bg = p->background + (size_t)y * w;
+
+        k->column_average(s.colsum, out, w, bottom - top + 1);
+
+        if (!p->prev) {
+            memcpy(bg, out, w);
+            continue;
+        }
+
+        // Differences above 255 are impossible, so nothing can count as motion
+        if (y < grid_rows && p->threshold < 255) {
+            const uint8_t *prev = p->prev + (size_t)y * w;
+            const int cell_row = (y / cell_height) * p->grid_size;
+            for (int gx = 0; gx < p->grid_size; gx++) {
+                const int x = gx * cell_width;
+                k->diff_row(out + x, prev + x, bg + x, cell_width, p->threshold,
+                            &p->cell_changed[cell_row + gx], &p->cell_total[cell_row + gx]);
+            }
+        }
+
+        k->background_row(bg, out, w, p->alpha);
+    }
+}
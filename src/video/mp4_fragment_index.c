@@ -0,0 +1,403 @@
+/**
+ * MP4 Fragment Index
+ *
+ * Walks the top-level boxes of a fragmented MP4 file. The video track and its
+ * timescale come from moov, and each moof gives the decode time and the
+ * sample durations of its video run.
+ */
+
+#define _XOPEN_SOURCE 700
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "video/mp4_fragment_index.h"
+#include "core/logger.h"
+
+#define BOX_TYPE(a, b, c, d) (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d))
+
+// Largest moov and moof boxes read into memory
+#define MAX_MOOV_SIZE (8 * 1024 * 1024)
+#define MAX_MOOF_SIZE (1024 * 1024)
+
+// Track extends entries kept while reading moov
+#define MAX_TRACKS 8
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    uint32_t type;
+} box_t;
+
+typedef struct {
+    uint32_t track_id;
+    uint32_t timescale;
+    uint32_t default_duration;      // From trex, used when a fragment gives none
+} video_track_t;
+
+static uint32_t read_u32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint64_t read_u64(const uint8_t *p) {
+    return ((uint64_t)read_u32(p) << 32) | read_u32(p + 4);
+}
+
+/**
+ * Get the next child box from a buffer
+ */
+static bool next_box(const uint8_t **p, const uint8_t *end, box_t *box) {
+    if (end - *p < 8) {
+        return false;
+    }
+
+    uint64_t size = read_u32(*p);
+    size_t header = 8;
+    box->type = read_u32(*p + 4);
+
+    if (size == 1) {
+        if (end - *p < 16) {
+            return false;
+        }
+        size = read_u64(*p + 8);
+        header = 16;
+    } else if (size == 0) {
+        size = (uint64_t)(end - *p);
+    }
+
+    if (size < header || size > (uint64_t)(end - *p)) {
+        return false;
+    }
+
+    box->data = *p + header;
+    box->size = (size_t)size - header;
+    *p += size;
+    return true;
+}
+
+/**
+ * Read the ID, timescale and handler of a trak box
+ */
+static void parse_trak(const box_t *trak, uint32_t *track_id, uint32_t *timescale, bool *is_video) {
+    const uint8_t *p = trak->data;
+    const uint8_t *end = trak->data + trak->size;
+    box_t box;
+
+    while (next_box(&p, end, &box)) {
+        if (box.type == BOX_TYPE('t', 'k', 'h', 'd') && box.size >= 24) {
+            // Creation and modification times are 64-bit in version 1
+            *track_id = read_u32(box.data + (box.data[0] == 1 ? 20 : 12));
+        } else if (box.type == BOX_TYPE('m', 'd', 'i', 'a')) {
+            const uint8_t *q = box.data;
+            const uint8_t *mdia_end = box.data + box.size;
+            box_t child;
+
+            while (next_box(&q, mdia_end, &child)) {
+                if (child.type == BOX_TYPE('m', 'd', 'h', 'd') && child.size >= 24) {
+                    *timescale = read_u32(child.data + (child.data[0] == 1 ? 20 : 12));
+                } else if (child.type == BOX_TYPE('h', 'd', 'l', 'r') && child.size >= 12) {
+                    *is_video = read_u32(child.data + 8) == BOX_TYPE('v', 'i', 'd', 'e');
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Find the first video track of a moov box
+ */
+static int parse_moov(const uint8_t *data, size_t size, video_track_t *video) {
+    const uint8_t *p = data;
+    const uint8_t *end = data + size;
+    box_t box;
+
+    uint32_t trex_ids[MAX_TRACKS];
+    uint32_t trex_durations[MAX_TRACKS];
+    int trex_count = 0;
+
+    memset(video, 0, sizeof(*video));
+
+    while (next_box(&p, end, &box)) {
+        if (box.type == BOX_TYPE('t', 'r', 'a', 'k') && video->track_id == 0) {
+            uint32_t track_id = 0;
+            uint32_t timescale = 0;
+            bool is_video = false;
+            parse_trak(&box, &track_id, &timescale, &is_video);
+            if (is_video && track_id != 0 && timescale != 0) {
+                video->track_id = track_id;
+                video->timescale = timescale;
+            }
+        } else if (box.type == BOX_TYPE('m', 'v', 'e', 'x')) {
+            const uint8_t *q = box.data;
+            const uint8_t *mvex_end = box.data + box.size;
+            box_t child;
+
+            while (next_box(&q, mvex_end, &child)) {
+                if (child.type == BOX_TYPE('t', 'r', 'e', 'x') && child.size >= 24 && trex_count < MAX_TRACKS) {
+                    trex_ids[trex_count] = read_u32(child.data + 4);
+                    trex_durations[trex_count] = read_u32(child.data + 12);
+                    trex_count++;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < trex_count; i++) {
+        if (trex_ids[i] == video->track_id) {
+            video->default_duration = trex_durations[i];
+        }
+    }
+
+    return video->track_id != 0 ? 0 : -1;
+}
+
+/**
+ * Read the decode time and the duration of the video run of a moof box
+ */
+static void parse_moof(const uint8_t *data, size_t size, const video_track_t *video,
+                       uint64_t *base_time, uint64_t *duration, bool *has_time) {
+    const uint8_t *p = data;
+    const uint8_t *end = data + size;
+    box_t traf;
+
+    *base_time = 0;
+    *duration = 0;
+    *has_time = false;
+
+    while (next_box(&p, end, &traf)) {
+        if (traf.type != BOX_TYPE('t', 'r', 'a', 'f')) {
+            continue;
+        }
+
+        const uint8_t *q = traf.data;
+        const uint8_t *traf_end = traf.data + traf.size;
+        box_t box;
+        bool is_video = false;
+        uint32_t default_duration = video->default_duration;
+
+        // tfhd comes first in a traf, then tfdt and the runs
+        while (next_box(&q, traf_end, &box)) {
+            if (box.type == BOX_TYPE('t', 'f', 'h', 'd') && box.size >= 8) {
+                uint32_t flags = read_u32(box.data) & 0xffffff;
+                is_video = read_u32(box.data + 4) == video->track_id;
+
+                size_t offset = 8;
+                offset += (flags & 0x01) ? 8 : 0;   // base-data-offset
+                offset += (flags & 0x02) ? 4 : 0;   // sample-description-index
+                if ((flags & 0x08) && box.size >= offset + 4) {
+                    default_duration = read_u32(box.data + offset);
+                }
+            } else if (!is_video) {
+                continue;
+            } else if (box.type == BOX_TYPE('t', 'f', 'd', 't') && box.size >= 8) {
+                if (box.data[0] == 1 && box.size >= 12) {
+                    *base_time = read_u64(box.data + 4);
+                } else {
+                    *base_time = read_u32(box.data + 4);
+                }
+                *has_time = true;
+            } else if (box.type == BOX_TYPE('t', 'r', 'u', 'n') && box.size >= 8) {
+                uint32_t flags = read_u32(box.data) & 0xffffff;
+                uint32_t sample_count = read_u32(box.data + 4);
+
+                size_t offset = 8;
+                offset += (flags & 0x01) ? 4 : 0;   // data-offset
+                offset += (flags & 0x04) ? 4 : 0;   // first-sample-flags
+
+                if (!(flags & 0x100)) {
+                    *duration += (uint64_t)sample_count * default_duration;
+                    continue;
+                }
+
+                // Per-sample fields: duration, size, flags, composition offset
+                size_t stride = 4 * (size_t)(((flags >> 8) & 1) + ((flags >> 9) & 1) +
+                                             ((flags >> 10) & 1) + ((flags >> 11) & 1));
+                for (uint32_t i = 0; i < sample_count && offset + 4 <= box.size; i++) {
+                    *duration += read_u32(box.data + offset);
+                    offset += stride;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Read a whole box body at an offset
+ */
+static uint8_t *read_box_body(int fd, uint64_t offset, uint64_t length, size_t max_length) {
+    if (length > max_length) {
+        return NULL;
+    }
+
+    uint8_t *data = malloc(length > 0 ? (size_t)length : 1);
+    if (!data) {
+        return NULL;
+    }
+
+    if (pread(fd, data, (size_t)length, (off_t)offset) != (ssize_t)length) {
+        free(data);
+        return NULL;
+    }
+
+    return data;
+}
+
+int mp4_fragment_index_load(const char *path, mp4_fragment_index_t *index) {
+    if (!path || !index) {
+        return -1;
+    }
+
+    memset(index, 0, sizeof(*index));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        log_error("Failed to open %s for indexing", path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    uint64_t file_size = (uint64_t)st.st_size;
+
+    video_track_t video = {0};
+    bool have_moov = false;
+    uint64_t *base_times = NULL;
+    int capacity = 0;
+    int result = 0;
+
+    uint64_t pos = 0;
+    while (pos + 8 <= file_size) {
+        uint8_t header[16];
+        ssize_t header_read = pread(fd, header, sizeof(header), (off_t)pos);
+        if (header_read < 8) {
+            break;
+        }
+
+        uint64_t size = read_u32(header);
+        uint64_t header_size = 8;
+        uint32_t type = read_u32(header + 4);
+        if (size == 1) {
+            if (header_read < 16) {
+                break;
+            }
+            size = read_u64(header + 8);
+            header_size = 16;
+        } else if (size == 0) {
+            size = file_size - pos;
+        }
+
+        // A truncated last box ends the file
+        if (size < header_size || pos + size > file_size) {
+            break;
+        }
+
+        if (type == BOX_TYPE('m', 'o', 'o', 'v')) {
+            uint8_t *body = read_box_body(fd, pos + header_size, size - header_size, MAX_MOOV_SIZE);
+            have_moov = body && parse_moov(body, (size_t)(size - header_size), &video) == 0;
+            free(body);
+            if (!have_moov) {
+                result = -1;
+                break;
+            }
+        } else if (type == BOX_TYPE('m', 'o', 'o', 'f')) {
+            if (!have_moov) {
+                result = -1;
+                break;
+            }
+
+            uint8_t *body = read_box_body(fd, pos + header_size, size - header_size, MAX_MOOF_SIZE);
+            if (!body) {
+                result = -1;
+                break;
+            }
+
+            uint64_t base_time, duration;
+            bool has_time;
+            parse_moof(body, (size_t)(size - header_size), &video, &base_time, &duration, &has_time);
+            free(body);
+
+            if (index->count == capacity) {
+                int new_capacity = capacity > 0 ? capacity * 2 : 256;
+                mp4_fragment_t *fragments = realloc(index->fragments, new_capacity * sizeof(mp4_fragment_t));
+                uint64_t *times = realloc(base_times, new_capacity * sizeof(uint64_t));
+                if (fragments) {
+                    index->fragments = fragments;
+                }
+                if (times) {
+                    base_times = times;
+                }
+                if (!fragments || !times) {
+                    result = -1;
+                    break;
+                }
+                capacity = new_capacity;
+            }
+
+            if (index->count == 0) {
+                index->init_length = pos;
+            }
+
+            mp4_fragment_t *fragment = &index->fragments[index->count];
+            fragment->offset = pos;
+            fragment->length = size;
+            fragment->duration = (double)duration / video.timescale;
+            base_times[index->count] = has_time ? base_time : 0;
+            if (!has_time && index->count > 0) {
+                // Without tfdt, the fragment follows the previous one
+                const mp4_fragment_t *previous = &index->fragments[index->count - 1];
+                base_times[index->count] = base_times[index->count - 1] +
+                                           (uint64_t)(previous->duration * video.timescale);
+            }
+            index->count++;
+        } else if (type == BOX_TYPE('m', 'd', 'a', 't') && index->count > 0) {
+            // Media data of the last fragment
+            mp4_fragment_t *fragment = &index->fragments[index->count - 1];
+            fragment->length = pos + size - fragment->offset;
+        }
+
+        pos += size;
+    }
+
+    close(fd);
+
+    if (result == 0 && index->count == 0) {
+        result = -1;
+    }
+
+    if (result == 0) {
+        for (int i = 0; i < index->count; i++) {
+            mp4_fragment_t *fragment = &index->fragments[i];
+            fragment->start = (double)(int64_t)(base_times[i] - base_times[0]) / video.timescale;
+
+            // Runs without durations span until the next fragment
+            if (fragment->duration <= 0 && i + 1 < index->count) {
+                fragment->duration = (double)(int64_t)(base_times[i + 1] - base_times[i]) / video.timescale;
+            }
+        }
+    } else {
+        mp4_fragment_index_free(index);
+    }
+
+    free(base_times);
+    return result;
+}
+
+void mp4_fragment_index_free(mp4_fragment_index_t *index) {
+    if (!index) {
+        return;
+    }
+
+    free(index->fragments);
+    index->fragments = NULL;
+    index->count = 0;
+    index->init_length = 0;
+}
@@ -24,6 +24,7 @@
 #include <pthread.h>
 
 #include "database/database_manager.h"
+#include "database/db_recordings.h"
 #include "core/config.h"
 #include "core/logger.h"
 #include "video/stream_manager.h"
@@ -105,6 +106,31 @@ void mp4_writer_set_segment_duration(mp4_writer_t *writer, int segment_duration)
              segment_duration, writer->stream_name ? writer->stream_name : "unknown");
 }
 
+/**
+ * Get the database ID of the current recording
+ */
+uint64_t mp4_writer_get_recording_id(mp4_writer_t *writer) {
+    if (!writer) {
+        return 0;
+    }
+
+    if (writer->pending_recording) {
+        uint64_t recording_id = 0;
+        int result = db_write_future_wait(writer->pending_recording, &recording_id);
+        writer->pending_recording = NULL;
+
+        if (result == 0) {
+            writer->current_recording_id = recording_id;
+            log_info("Added recording to database with ID: %llu for file: %s",
+                    (unsigned long long)recording_id, writer->output_path);
+        } else {
+            log_error("Failed to add recording metadata for stream %s", writer->stream_name);
+        }
+    }
+
+    return writer->current_recording_id;
+}
+
 /**
  * Close the MP4 writer and release resources
  */
@@ -120,7 +146,7 @@ void mp4_writer_close(mp4_writer_t *writer) {
              writer->output_path ? writer->output_path : "unknown");
 
     //  First, mark the recording as complete in the database if needed
-    if (writer->current_recording_id > 0) {
+    if (mp4_writer_get_recording_id(writer) > 0) {
         // Get the file size before marking as complete
         struct stat st;
         uint64_t size_bytes = 0;
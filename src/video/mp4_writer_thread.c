@@ -30,14 +30,121 @@
 #include "video/mp4_writer_internal.h"
 #include "video/mp4_writer_thread.h"
 #include "video/mp4_segment_recorder.h"
+#include "video/packet_fanout.h"
 #include "database/database_manager.h"
 #include "database/db_recordings.h"
 
 
+// How long a single read from the shared ingest may block, in milliseconds
+#define SHARED_READ_TIMEOUT_MS 1000
+
+// How long to wait for the shared ingest to publish stream parameters, in milliseconds
+#define SHARED_STREAMS_TIMEOUT_MS 5000
+
+// How often the stream configuration is re-read from the database, in seconds
+#define CONFIG_REFRESH_INTERVAL 10
+
+/**
+ * Segment callback: register the new file in the database
+ */
+static void on_segment_open(const char *path, time_t start_time, void *user_data) {
+    mp4_writer_t *writer = (mp4_writer_t *)user_data;
+
+    recording_metadata_t metadata;
+    memset(&metadata, 0, sizeof(recording_metadata_t));
+
+    strncpy(metadata.stream_name, writer->stream_name, sizeof(metadata.stream_name) - 1);
+    strncpy(metadata.file_path, path, sizeof(metadata.file_path) - 1);
+    metadata.start_time = start_time;
+    metadata.end_time = 0; // Will be updated when the segment is closed
+    metadata.size_bytes = 0;
+    metadata.is_complete = false;
+
+    // Queue the insert instead of waiting for its commit, which would stall the
+    // packet loop at the keyframe starting the file; the ID is picked up on close
+    db_write_future_release(writer->pending_recording);
+    writer->pending_recording = NULL;
+    if (add_recording_metadata_async(&metadata, &writer->pending_recording) != 0) {
+        log_error("Failed to add recording metadata for stream %s", writer->stream_name);
+    }
+
+    strncpy(writer->output_path, path, MAX_PATH_LENGTH - 1);
+    writer->output_path[MAX_PATH_LENGTH - 1] = '\0';
+    writer->current_recording_id = 0;
+    writer->last_rotation_time = start_time;
+}
+
+/**
+ * Segment callback: mark the finished file as complete
+ */
+static void on_segment_close(const char *path, time_t start_time, time_t end_time, void *user_data) {
+    mp4_writer_t *writer = (mp4_writer_t *)user_data;
+    (void)start_time;
+
+    // The insert has normally committed long before the segment ends; waiting
+    // here only happens when the database fell a whole segment behind
+    uint64_t recording_id = mp4_writer_get_recording_id(writer);
+    if (recording_id == 0) {
+        return;
+    }
+
+    struct stat st;
+    uint64_t size_bytes = 0;
+    if (stat(path, &st) == 0) {
+        size_bytes = st.st_size;
+    } else {
+        log_warn("Failed to get file size for %s: %s", path, strerror(errno));
+    }
+
+    if (update_recording_metadata_async(recording_id, end_time, size_bytes, true, NULL) != 0) {
+        log_error("Failed to queue completion of recording (ID: %llu) for stream %s",
+                 (unsigned long long)recording_id, writer->stream_name);
+    } else {
+        log_info("Marked recording (ID: %llu) as complete for stream %s (size: %llu bytes)",
+                (unsigned long long)recording_id, writer->stream_name,
+                (unsigned long long)size_bytes);
+    }
+
+    writer->current_recording_id = 0;
+}
+
+/**
+ * Open a dedicated connection to the camera
+ */
+static int open_dedicated_input(const char *rtsp_url, AVFormatContext **input_ctx) {
+    AVDictionary *opts = NULL;
+
+    // Set up RTSP options for low latency
+    av_dict_set(&opts, "rtsp_transport", "tcp", 0);  // Use TCP for RTSP (more reliable than UDP)
+    av_dict_set(&opts, "fflags", "nobuffer", 0);     // Reduce buffering
+    av_dict_set(&opts, "flags", "low_delay", 0);     // Low delay mode
+    av_dict_set(&opts, "max_delay", "500000", 0);    // Maximum delay of 500ms
+    av_dict_set(&opts, "stimeout", "5000000", 0);    // Socket timeout in microseconds (5 seconds)
+
+    int ret = avformat_open_input(input_ctx, rtsp_url, NULL, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        char error_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+        av_strerror(ret, error_buf, AV_ERROR_MAX_STRING_SIZE);
+        log_error("Failed to open input: %d (%s)", ret, error_buf);
+        *input_ctx = NULL;
+        return ret;
+    }
+
+    ret = avformat_find_stream_info(*input_ctx, NULL);
+    if (ret < 0) {
+        log_error("Failed to find stream info: %d", ret);
+        avformat_close_input(input_ctx);
+        return ret;
+    }
+
+    return 0;
+}
+
 /**
  * RTSP stream reading thread function
- * This function maintains a single RTSP connection across multiple segments
- * and handles self-management including retries and shutdown
+ * This function keeps a single input open for the life of the recording and
+ * feeds every packet to a segmenter that rolls files on keyframes
  */
 static void *mp4_writer_rtsp_thread(void *arg) {
     mp4_writer_thread_t *thread_ctx = (mp4_writer_thread_t *)arg;
@@ -48,21 +155,14 @@ static void *mp4_writer_rtsp_thread(void *arg) {
     // Set running flag at start of thread
     thread_ctx->running = 1;
 
-    // Create a local copy of needed values to prevent use-after-free
-    char rtsp_url[MAX_PATH_LENGTH];
-    strncpy(rtsp_url, thread_ctx->rtsp_url, sizeof(rtsp_url) - 1);
-    rtsp_url[sizeof(rtsp_url) - 1] = '\0';
-
-    int segment_duration = thread_ctx->segment_duration;
     mp4_writer_t *writer = thread_ctx->writer;
 
     AVFormatContext *input_ctx = NULL;
     AVPacket *pkt = NULL;
-    int video_stream_idx = -1;
-    int audio_stream_idx = -1;
+    mp4_segmenter_t *segmenter = NULL;
+    bool input_ready = false;
+    time_t last_config_check = 0;
     int ret;
-    time_t start_time = time(NULL);  // Record when we started
-    segment_info_t segment_info = {0};  // Initialize segment info for timestamp continuity and keyframe handling
 
     // Initialize self-management fields
     thread_ctx->retry_count = 0;
@@ -70,8 +170,8 @@ static void *mp4_writer_rtsp_thread(void *arg) {
 
     // Make a local copy of the stream name for thread safety
     char stream_name[MAX_STREAM_NAME];
-    if (thread_ctx->writer && thread_ctx->writer->stream_name[0] != '\0') {
-        strncpy(stream_name, thread_ctx->writer->stream_name, MAX_STREAM_NAME - 1);
+    if (writer->stream_name[0] != '\0') {
+        strncpy(stream_name, writer->stream_name, MAX_STREAM_NAME - 1);
         stream_name[MAX_STREAM_NAME - 1] = '\0';
     } else {
         strncpy(stream_name, "unknown", MAX_STREAM_NAME - 1);
@@ -79,373 +179,209 @@ static void *mp4_writer_rtsp_thread(void *arg) {
 
     log_info("Starting RTSP reading thread for stream %s", stream_name);
 
-    // Add initial recording metadata to the database
-    if (thread_ctx->writer && thread_ctx->writer->output_path[0] != '\0') {
-        recording_metadata_t metadata;
-        memset(&metadata, 0, sizeof(recording_metadata_t));
-
-        // Fill in the metadata
-        strncpy(metadata.stream_name, stream_name, sizeof(metadata.stream_name) - 1);
-        strncpy(metadata.file_path, thread_ctx->writer->output_path, sizeof(metadata.file_path) - 1);
-        metadata.start_time = start_time;
-        metadata.end_time = 0; // Will be updated when recording ends
-        metadata.size_bytes = 0; // Will be updated as recording grows
-        metadata.is_complete = false;
-
-        // Add recording to database
-        uint64_t recording_id = add_recording_metadata(&metadata);
-        if (recording_id == 0) {
-            log_error("Failed to add initial recording metadata for stream %s", stream_name);
-        } else {
-            log_info("Added initial recording to database with ID: %llu for file: %s",
-                    (unsigned long long)recording_id, thread_ctx->writer->output_path);
+    // Share the stream's ingest with HLS and detection instead of opening another connection
+    packet_fanout_t *fanout = NULL;
+    packet_fanout_reader_t *fanout_reader = NULL;
+    if (packet_fanout_is_enabled()) {
+        fanout = packet_fanout_acquire(stream_name);
+        if (fanout) {
+            fanout_reader = packet_fanout_subscribe(fanout, "mp4", PACKET_FANOUT_POLICY_CATCH_UP);
+            if (!fanout_reader) {
+                packet_fanout_release(fanout);
+                fanout = NULL;
+            }
+        }
 
-            // Store the recording ID in the writer for later update
-            thread_ctx->writer->current_recording_id = recording_id;
+        if (!fanout_reader) {
+            log_warn("Could not use shared ingest for stream %s, recording from a dedicated connection",
+                    stream_name);
         }
     }
 
-    // Check if we're still running (might have been stopped during initialization)
-    if (!thread_ctx->running || thread_ctx->shutdown_requested) {
-        log_info("RTSP reading thread for %s exiting early due to shutdown", stream_name);
-        return NULL;
+    mp4_segmenter_callbacks_t callbacks = {
+        .on_segment_open = on_segment_open,
+        .on_segment_close = on_segment_close,
+        .user_data = writer
+    };
+    segmenter = mp4_segmenter_create(stream_name, writer->output_dir, writer->segment_duration,
+                                     writer->has_audio, &callbacks);
+    pkt = av_packet_alloc();
+    if (!segmenter || !pkt) {
+        log_error("Failed to set up recording for stream %s", stream_name);
+        goto cleanup;
     }
 
-    // Initialize segment info
-    segment_info.segment_index = 0;
-    segment_info.has_audio = false;
-    segment_info.last_frame_was_key = false;
-
-    log_info("Initialized segment info: index=%d, has_audio=%d, last_frame_was_key=%d",
-            segment_info.segment_index, segment_info.has_audio, segment_info.last_frame_was_key);
-
-    // Main loop to record segments
+    // Main loop: one input, many files
     while (thread_ctx->running && !thread_ctx->shutdown_requested) {
         // Check if shutdown has been initiated
         if (is_shutdown_initiated()) {
             log_info("RTSP reading thread for %s stopping due to system shutdown", stream_name);
-            thread_ctx->running = 0;
             break;
         }
 
-        // Get current time
         time_t current_time = time(NULL);
 
-        // Fetch the latest stream configuration from the database
-        stream_config_t db_stream_config;
-        int db_config_result = get_stream_config_by_name(stream_name, &db_stream_config);
-
-        // Define segment_duration variable outside the if block
-        int segment_duration = thread_ctx->writer->segment_duration;
+        // Pick up segment duration and audio changes from the database
+        if (current_time - last_config_check >= CONFIG_REFRESH_INTERVAL) {
+            last_config_check = current_time;
 
-        // Update configuration from database if available
-        if (db_config_result == 0) {
-            // Update segment duration if available
-            if (db_stream_config.segment_duration > 0) {
-                segment_duration = db_stream_config.segment_duration;
-
-                // Update the writer's segment duration if it has changed
-                if (thread_ctx->writer->segment_duration != segment_duration) {
+            stream_config_t db_stream_config;
+            if (get_stream_config_by_name(stream_name, &db_stream_config) == 0) {
+                if (db_stream_config.segment_duration > 0 &&
+                    writer->segment_duration != db_stream_config.segment_duration) {
                     log_info("Updating segment duration for stream %s from %d to %d seconds (from database)",
-                            stream_name, thread_ctx->writer->segment_duration, segment_duration);
-                    thread_ctx->writer->segment_duration = segment_duration;
+                            stream_name, writer->segment_duration, db_stream_config.segment_duration);
+                    writer->segment_duration = db_stream_config.segment_duration;
+                    mp4_segmenter_set_duration(segmenter, writer->segment_duration);
                 }
-            }
 
-            // Update audio recording setting if it has changed
-            int has_audio = db_stream_config.record_audio ? 1 : 0;
-            if (thread_ctx->writer->has_audio != has_audio) {
-                log_info("Updating audio recording setting for stream %s from %s to %s (from database)",
-                        stream_name,
-                        thread_ctx->writer->has_audio ? "enabled" : "disabled",
-                        has_audio ? "enabled" : "disabled");
-                thread_ctx->writer->has_audio = has_audio;
+                int has_audio = db_stream_config.record_audio ? 1 : 0;
+                if (writer->has_audio != has_audio) {
+                    log_info("Updating audio recording setting for stream %s from %s to %s (from database)",
+                            stream_name,
+                            writer->has_audio ? "enabled" : "disabled",
+                            has_audio ? "enabled" : "disabled");
+                    writer->has_audio = has_audio;
+                    mp4_segmenter_set_audio(segmenter, has_audio);
+                }
             }
         }
 
-        // Check if it's time to create a new segment based on segment duration
-        // Force segment rotation every segment_duration seconds
-        if (segment_duration > 0) {
-            time_t elapsed_time = current_time - thread_ctx->writer->last_rotation_time;
-            if (elapsed_time >= segment_duration) {
-                log_info("Time to create new segment for stream %s (elapsed time: %ld seconds, segment duration: %d seconds)",
-                         stream_name, (long)elapsed_time, segment_duration);
-
-                // Create timestamp for new MP4 filename
-                char timestamp_str[32];
-                struct tm *tm_info = localtime(&current_time);
-                strftime(timestamp_str, sizeof(timestamp_str), "%Y%m%d_%H%M%S", tm_info);
-
-                // Create new output path
-                char new_path[MAX_PATH_LENGTH];
-                snprintf(new_path, MAX_PATH_LENGTH, "%s/recording_%s.mp4",
-                         thread_ctx->writer->output_dir, timestamp_str);
-
-                // Get the current output path before closing
-                char current_path[MAX_PATH_LENGTH];
-                strncpy(current_path, thread_ctx->writer->output_path, MAX_PATH_LENGTH - 1);
-                current_path[MAX_PATH_LENGTH - 1] = '\0';
-
-                // Create recording metadata for the new file
-                recording_metadata_t metadata;
-                memset(&metadata, 0, sizeof(recording_metadata_t));
-
-                // Fill in the metadata
-                strncpy(metadata.stream_name, stream_name, sizeof(metadata.stream_name) - 1);
-                strncpy(metadata.file_path, new_path, sizeof(metadata.file_path) - 1);
-                metadata.start_time = current_time;
-                metadata.end_time = 0; // Will be updated when recording ends
-                metadata.size_bytes = 0; // Will be updated as recording grows
-                metadata.is_complete = false;
-
-                // Add recording to database for the new file
-                uint64_t new_recording_id = add_recording_metadata(&metadata);
-                if (new_recording_id == 0) {
-                    log_error("Failed to add recording metadata for stream %s during rotation", stream_name);
-                } else {
-                    log_info("Added new recording to database with ID: %llu for rotated file: %s",
-                            (unsigned long long)new_recording_id, new_path);
+        // (Re)open the input; this only happens at startup and after errors
+        if (!input_ready) {
+            const AVStream *video = NULL;
+            const AVStream *audio = NULL;
+
+            if (fanout_reader) {
+                ret = packet_fanout_wait_for_streams(fanout_reader, SHARED_STREAMS_TIMEOUT_MS);
+                if (ret == AVERROR(EAGAIN)) {
+                    continue;
+                } else if (ret < 0) {
+                    log_info("Shared ingest for stream %s closed", stream_name);
+                    break;
                 }
-
-                // Mark the previous recording as complete
-                if (thread_ctx->writer->current_recording_id > 0) {
-                    // Get the file size before marking as complete
-                    struct stat st;
-                    uint64_t size_bytes = 0;
-
-                    if (stat(current_path, &st) == 0) {
-                        size_bytes = st.st_size;
-                        log_info("File size for %s: %llu bytes",
-                                current_path, (unsigned long long)size_bytes);
-
-                        // Mark the recording as complete with the correct file size
-                        update_recording_metadata(thread_ctx->writer->current_recording_id, current_time, size_bytes, true);
-                        log_info("Marked previous recording (ID: %llu) as complete for stream %s (size: %llu bytes)",
-                                (unsigned long long)thread_ctx->writer->current_recording_id, stream_name, (unsigned long long)size_bytes);
-                    } else {
-                        log_warn("Failed to get file size for %s: %s",
-                                current_path, strerror(errno));
-
-                        // Still mark the recording as complete, but with size 0
-                        update_recording_metadata(thread_ctx->writer->current_recording_id, current_time, 0, true);
-                        log_info("Marked previous recording (ID: %llu) as complete for stream %s (size unknown)",
-                                (unsigned long long)thread_ctx->writer->current_recording_id, stream_name);
+                video = packet_fanout_get_stream(fanout_reader, AVMEDIA_TYPE_VIDEO);
+                audio = packet_fanout_get_stream(fanout_reader, AVMEDIA_TYPE_AUDIO);
+            } else if (open_dedicated_input(thread_ctx->rtsp_url, &input_ctx) == 0) {
+                for (unsigned int i = 0; i < input_ctx->nb_streams; i++) {
+                    const AVStream *stream = input_ctx->streams[i];
+                    if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && !video) {
+                        video = stream;
+                    } else if (stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && !audio) {
+                        audio = stream;
                     }
                 }
+            }
 
-                // Update the output path
-                strncpy(thread_ctx->writer->output_path, new_path, MAX_PATH_LENGTH - 1);
-                thread_ctx->writer->output_path[MAX_PATH_LENGTH - 1] = '\0';
-
-                // Store the new recording ID in the writer for later update
-                if (new_recording_id > 0) {
-                    thread_ctx->writer->current_recording_id = new_recording_id;
+            if (!video || mp4_segmenter_set_input(segmenter, video, audio) < 0) {
+                if (input_ctx) {
+                    log_error("No usable video stream found for stream %s", stream_name);
+                    avformat_close_input(&input_ctx);
                 }
-
-                // Update rotation time
-                thread_ctx->writer->last_rotation_time = current_time;
+                goto retry;
             }
-        }
 
-        // Record a segment using the record_segment function
-        log_info("Recording segment for stream %s to %s", stream_name, thread_ctx->writer->output_path);
+            input_ready = true;
+        }
 
-        // Use the segment duration from the database or writer
-        if (segment_duration > 0) {
-            log_info("Using segment duration: %d seconds (from %s)",
-                    segment_duration,
-                    (db_config_result == 0 && db_stream_config.segment_duration > 0) ? "database" : "writer context");
+        // Read the next packet
+        if (fanout_reader) {
+            ret = packet_fanout_read(fanout_reader, pkt, SHARED_READ_TIMEOUT_MS);
+            if (ret == AVERROR(EAGAIN)) {
+                continue;
+            } else if (ret == AVERROR_EOF) {
+                log_info("Shared ingest for stream %s closed", stream_name);
+                break;
+            }
         } else {
-            segment_duration = 30;
-            log_info("No segment duration configured, using default: %d seconds", segment_duration);
+            ret = av_read_frame(input_ctx, pkt);
+            if (ret == AVERROR(EAGAIN)) {
+                av_usleep(10000);  // Sleep 10ms to avoid busy waiting
+                continue;
+            }
         }
 
-        // Variables for retry mechanism and resource management
-        // CRITICAL FIX: These static variables should be initialized at the beginning of each call
-        // to prevent using uninitialized values during shutdown
-        static int segment_retry_count = 0;
-        static time_t last_segment_retry_time = 0;
-        static int segment_count = 0;
-
-        // Initialize static variables at the beginning of each segment recording
-        // This ensures they have valid values even during shutdown
-        segment_retry_count = 0;
-        last_segment_retry_time = 0;
-        // Don't reset segment_count as it's used for logging purposes
-
-        // Increment segment count and log it periodically to track memory usage
-        segment_count++;
-        if (segment_count % 10 == 0) {
-            log_info("Stream %s has processed %d segments since startup", stream_name, segment_count);
-
-            // Force a complete FFmpeg resource reset every 10 segments to prevent memory growth
-            if (segment_count % 10 == 0) {
-                log_info("Performing complete FFmpeg resource reset for stream %s after %d segments",
-                        stream_name, segment_count);
-
-                // MEMORY LEAK FIX: Ensure all FFmpeg resources are properly freed
-                // This is the most aggressive approach to prevent memory growth
-
-                // 1. Free the packet if it exists
-                if (pkt) {
-                    av_packet_unref(pkt);
-                    av_packet_free(&pkt);
-                    pkt = NULL;
-                }
-
-                // 2. Close the input context if it exists
-                if (input_ctx) {
-                    // Flush all buffers before closing
-                    if (input_ctx->pb) {
-                        avio_flush(input_ctx->pb);
-                    }
-
-                    // Close the input context - this will free all associated resources
-                    // Let FFmpeg handle its own memory management
-                    avformat_close_input(&input_ctx);
-                    input_ctx = NULL;
-                }
-
-                // 3. Allocate a new packet
-                pkt = av_packet_alloc();
-                if (!pkt) {
-                    log_error("Failed to allocate packet during FFmpeg resource reset");
-                    // Continue anyway, the next iteration will try again
-                }
+        if (ret < 0) {
+            char error_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+            av_strerror(ret, error_buf, AV_ERROR_MAX_STRING_SIZE);
+            log_error("Error reading from stream %s: %s, reconnecting", stream_name, error_buf);
 
-                // Log that we've reset all FFmpeg resources
-                log_info("Successfully reset all FFmpeg resources for stream %s", stream_name);
+            if (input_ctx) {
+                avformat_close_input(&input_ctx);
             }
+            input_ready = false;
+            goto retry;
         }
 
-        // Record the segment with timestamp continuity and keyframe handling
-        // BUGFIX: Removed duplicate loop that was causing segments to be double the intended length
-        log_info("Starting segment recording with info: index=%d, has_audio=%d, last_frame_was_key=%d",
-                segment_info.segment_index, segment_info.has_audio, segment_info.last_frame_was_key);
-
-        // MEMORY LEAK FIX: Ensure we don't have any lingering input context before recording
-        // This is a safety measure to prevent resource leaks
-        if (input_ctx) {
-            avformat_close_input(&input_ctx);
-            input_ctx = NULL;
-            log_debug("Closed existing input context before recording new segment");
+        // The shared ingest reconnected; hand the new parameters to the segmenter
+        if (fanout_reader && packet_fanout_streams_changed(fanout_reader)) {
+            const AVStream *video = packet_fanout_get_stream(fanout_reader, AVMEDIA_TYPE_VIDEO);
+            if (video) {
+                mp4_segmenter_set_input(segmenter, video,
+                                        packet_fanout_get_stream(fanout_reader, AVMEDIA_TYPE_AUDIO));
+            }
         }
 
-        ret = record_segment(thread_ctx->rtsp_url, thread_ctx->writer->output_path,
-                           segment_duration, thread_ctx->writer->has_audio);
-
-        log_info("Finished segment recording with info: index=%d, has_audio=%d, last_frame_was_key=%d",
-                segment_info.segment_index, segment_info.has_audio, segment_info.last_frame_was_key);
-
+        ret = mp4_segmenter_write_packet(segmenter, pkt);
+        av_packet_unref(pkt);
         if (ret < 0) {
-            log_error("Failed to record segment for stream %s (error: %d), implementing retry strategy...",
-                     stream_name, ret);
+            // The segmenter opens a fresh file on the next keyframe
+            mp4_segmenter_finish(segmenter);
+            continue;
+        }
 
-            // Check if input_ctx is NULL after a failed record_segment call
-            // This can happen if the connection failed and avformat_open_input failed
-            if (input_ctx == NULL) {
-                log_warn("Input context is NULL after record_segment failure for stream %s", stream_name);
-            }
+        // Update the last packet time for activity tracking
+        writer->last_packet_time = current_time;
+
+        if (thread_ctx->retry_count > 0) {
+            log_info("Recording resumed for %s after %d retries", stream_name, thread_ctx->retry_count);
+            thread_ctx->retry_count = 0;
+        }
+        continue;
 
-            // Calculate backoff time based on retry count (exponential backoff with max of 30 seconds)
-            int backoff_seconds = 1 << (thread_ctx->retry_count > 4 ? 4 : thread_ctx->retry_count); // 1, 2, 4, 8, 16, 16, ...
-            if (backoff_seconds > 30) backoff_seconds = 30;
+    retry:
+        {
+            // Exponential backoff with a maximum of 16 seconds
+            int backoff_seconds = 1 << (thread_ctx->retry_count > 4 ? 4 : thread_ctx->retry_count);
 
-            // Record the retry attempt
             thread_ctx->retry_count++;
             thread_ctx->last_retry_time = time(NULL);
 
-            // If input context was closed, set it to NULL so it will be reopened
-            if (!input_ctx) {
-                log_info("Input context was closed, will reopen on next attempt");
-            }
-
-            // If we've had too many consecutive failures, try more aggressive recovery
-            if (thread_ctx->retry_count > 5) {
-                log_warn("Multiple segment recording failures for %s (%d retries), attempting aggressive recovery",
-                        stream_name, thread_ctx->retry_count);
-
-                // Force input context to be recreated
-                if (input_ctx) {
-                    avformat_close_input(&input_ctx);
-                    input_ctx = NULL;
-                    log_info("Forcibly closed input context to ensure fresh connection on next attempt");
-                }
-
-                // Sleep longer for aggressive recovery
-                backoff_seconds = 5;
-            }
-
-            log_info("Waiting %d seconds before retrying segment recording for %s (retry #%d)",
+            log_info("Waiting %d seconds before reconnecting stream %s (retry #%d)",
                     backoff_seconds, stream_name, thread_ctx->retry_count);
 
-            // Wait before trying again
-            av_usleep(backoff_seconds * 1000000);  // Convert to microseconds
-
-            // Continue the loop to retry
-            continue;
-        } else {
-            // Reset retry count on success
-            if (thread_ctx->retry_count > 0) {
-                log_info("Successfully recorded segment for %s after %d retries",
-                        stream_name, thread_ctx->retry_count);
-                thread_ctx->retry_count = 0;
-            }
-        }
-
-        // Update the last packet time for activity tracking
-        thread_ctx->writer->last_packet_time = time(NULL);
-
-        // Update the recording metadata with the current file size
-        if (thread_ctx->writer->current_recording_id > 0) {
-            struct stat st;
-            if (stat(thread_ctx->writer->output_path, &st) == 0) {
-                uint64_t size_bytes = st.st_size;
-                // Update size but don't mark as complete yet
-                update_recording_metadata(thread_ctx->writer->current_recording_id, 0, size_bytes, false);
-                log_debug("Updated recording metadata for ID: %llu, size: %llu bytes",
-                        (unsigned long long)thread_ctx->writer->current_recording_id,
-                        (unsigned long long)size_bytes);
+            for (int i = 0; i < backoff_seconds * 10 && !thread_ctx->shutdown_requested &&
+                            !is_shutdown_initiated(); i++) {
+                av_usleep(100000);
             }
         }
     }
 
-    // MEMORY LEAK FIX: Aggressive cleanup of all FFmpeg resources
-    log_info("Performing aggressive cleanup of all FFmpeg resources for stream %s", stream_name);
+cleanup:
+    // Finalize the last file before letting go of the input
+    if (segmenter) {
+        mp4_segmenter_destroy(segmenter);
+        segmenter = NULL;
+    }
 
-    // 1. Clean up packet resources
     if (pkt) {
-        // Make a local copy of the packet pointer and NULL out the original
-        // to prevent double-free if another thread accesses it
-        AVPacket *pkt_to_free = pkt;
-        pkt = NULL;
-
-        // Now safely free the packet - first unref then free to prevent memory leaks
-        av_packet_unref(pkt_to_free);
-        av_packet_free(&pkt_to_free);
-        log_debug("Freed packet resources");
+        av_packet_free(&pkt);
     }
 
-    // 2. CRITICAL FIX: Always ensure input_ctx is properly closed to prevent memory leaks
     if (input_ctx) {
-        // Make a local copy of the context pointer and NULL out the original
-        AVFormatContext *ctx_to_close = input_ctx;
-        input_ctx = NULL;
-
-        // Flush all buffers before closing
-        if (ctx_to_close->pb) {
-            avio_flush(ctx_to_close->pb);
-            log_debug("Flushed input context buffers");
-        }
-
-        avformat_close_input(&ctx_to_close);
-
-        // Log that we've closed the input context to help with debugging
-        log_info("Closed input context for stream %s to prevent memory leaks", stream_name);
+        avformat_close_input(&input_ctx);
+        log_info("Closed input context for stream %s", stream_name);
     }
 
-    // Log that we've completed cleanup
-    log_info("Completed cleanup of FFmpeg resources for stream %s", stream_name);
+    // Leave the shared ingest
+    if (fanout_reader) {
+        packet_fanout_unsubscribe(fanout_reader);
+        fanout_reader = NULL;
+    }
+    if (fanout) {
+        packet_fanout_release(fanout);
+        fanout = NULL;
+    }
 
     log_info("RTSP reading thread for stream %s exited", stream_name);
     return NULL;
@@ -0,0 +1,893 @@
+/**
+ * Packet Fan-out Implementation
+ *
+ * One stream reader per stream publishes packets into a fixed-size ring of
+ * refcounted AVPackets. The producer only ever touches the slot it is
+ * writing, never waits for a consumer, and advances an atomic write sequence.
+ * Each subscriber keeps its own cursor into the ring and takes an extra
+ * reference on the packet it reads, so a slow consumer can be lapped without
+ * affecting the producer or any other consumer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <errno.h>
+
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/time.h>
+
+#include "core/logger.h"
+#include "core/config.h"
+#include "core/metrics.h"
+#include "video/streams.h"
+#include "video/stream_reader.h"
+#include "video/packet_fanout.h"
+#include "video/go2rtc/go2rtc_integration.h"
+
+// Index of the media types tracked by the fan-out
+#define FANOUT_MEDIA_VIDEO 0
+#define FANOUT_MEDIA_AUDIO 1
+#define FANOUT_MEDIA_COUNT 2
+
+// Sequence value used for "no keyframe published yet" and empty slots
+#define FANOUT_SEQ_NONE UINT64_MAX
+
+// Minimum time between attempts to restart a failed ingest
+#define FANOUT_RESTART_INTERVAL_SEC 2
+
+typedef struct {
+    pthread_mutex_t lock;       // Held only while referencing the packet
+    AVPacket *pkt;
+    uint64_t seq;
+    int media;                  // FANOUT_MEDIA_VIDEO or FANOUT_MEDIA_AUDIO
+    int keyframe;
+    unsigned int generation;    // Stream parameter generation at publish time
+} fanout_slot_t;
+
+struct packet_fanout {
+    char stream_name[MAX_STREAM_NAME];
+    char url[MAX_URL_LENGTH];
+    int protocol;
+    int refcount;               // Protected by fanouts_mutex
+
+    // Ring
+    fanout_slot_t *slots;
+    uint64_t capacity;
+    atomic_uint_fast64_t write_seq;
+    atomic_uint_fast64_t last_keyframe_seq;
+    atomic_int closed;
+
+    // Subscriber wake-up
+    pthread_mutex_t wait_mutex;
+    pthread_cond_t wait_cond;
+    atomic_int waiters;
+
+    // Stream parameters published by the ingest
+    pthread_mutex_t info_mutex;
+    AVCodecParameters *params[FANOUT_MEDIA_COUNT];
+    AVRational time_base[FANOUT_MEDIA_COUNT];
+    AVRational frame_rate;
+    unsigned int source_generation[FANOUT_MEDIA_COUNT];  // Input generation the parameters came from, 0 if none
+    atomic_uint generation;                              // 0 until video parameters are known
+
+    // Ingest
+    pthread_mutex_t ingest_mutex;
+    stream_reader_ctx_t *reader;
+    time_t last_restart;
+    packet_fanout_reader_t *readers[PACKET_FANOUT_MAX_READERS];
+
+    // Metrics, updated by the ingest thread
+    metrics_counter_t packets_in;
+    metrics_counter_t bytes_in;
+    metrics_counter_t reconnects;
+    metrics_histogram_t keyframe_interval;
+    uint64_t last_keyframe_us;
+};
+
+struct packet_fanout_reader {
+    packet_fanout_t *fanout;
+    char name[32];
+    packet_fanout_policy_t policy;
+    uint64_t cursor;
+    int need_keyframe;
+
+    // Private view of the ingest streams
+    AVFormatContext *streams_ctx;
+    int stream_idx[FANOUT_MEDIA_COUNT];
+    unsigned int generation;
+    bool streams_changed;
+
+    // Statistics
+    uint64_t packets_read;
+    uint64_t packets_dropped;
+    uint64_t resyncs;
+    metrics_counter_t dropped_metric;
+};
+
+// Registry of active fan-outs, one per stream
+static packet_fanout_t *fanouts[MAX_STREAMS];
+static pthread_mutex_t fanouts_mutex = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int fanout_system_shutdown = 0;
+
+/**
+ * Publish new stream parameters when the ingest (re)connects
+ */
+static void fanout_update_stream_info(packet_fanout_t *fanout, int media, const AVStream *stream,
+                                      unsigned int input_generation) {
+    pthread_mutex_lock(&fanout->info_mutex);
+
+    if (!fanout->params[media]) {
+        fanout->params[media] = avcodec_parameters_alloc();
+    }
+
+    if (fanout->params[media] &&
+        avcodec_parameters_copy(fanout->params[media], stream->codecpar) >= 0) {
+        fanout->time_base[media] = stream->time_base;
+        if (media == FANOUT_MEDIA_VIDEO) {
+            fanout->frame_rate = stream->avg_frame_rate;
+        }
+        fanout->source_generation[media] = input_generation;
+
+        // Generation 0 means "no video yet"; audio alone does not make the streams usable
+        if (fanout->params[FANOUT_MEDIA_VIDEO]) {
+            unsigned int gen = atomic_load(&fanout->generation) + 1;
+            if (gen == 0) gen = 1;
+            atomic_store(&fanout->generation, gen);
+        }
+
+        log_info("Packet fan-out for %s: %s stream parameters updated (codec: %s)",
+                 fanout->stream_name, media == FANOUT_MEDIA_VIDEO ? "video" : "audio",
+                 avcodec_get_name(stream->codecpar->codec_id));
+    } else {
+        log_error("Packet fan-out for %s: failed to copy %s stream parameters",
+                  fanout->stream_name, media == FANOUT_MEDIA_VIDEO ? "video" : "audio");
+    }
+
+    pthread_mutex_unlock(&fanout->info_mutex);
+}
+
+static void fanout_wake_readers(packet_fanout_t *fanout) {
+    if (atomic_load(&fanout->waiters) > 0) {
+        pthread_mutex_lock(&fanout->wait_mutex);
+        pthread_cond_broadcast(&fanout->wait_cond);
+        pthread_mutex_unlock(&fanout->wait_mutex);
+    }
+}
+
+/**
+ * Packet callback installed on the stream reader
+ * Runs on the stream reader thread for every video and audio packet.
+ */
+static int fanout_packet_callback(const AVPacket *pkt, const AVStream *stream, unsigned int input_generation,
+                                  void *user_data) {
+    packet_fanout_t *fanout = (packet_fanout_t *)user_data;
+    if (!fanout || !pkt || !stream || !stream->codecpar || atomic_load(&fanout->closed)) {
+        return 0;
+    }
+
+    int media;
+    if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+        media = FANOUT_MEDIA_VIDEO;
+    } else if (stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
+        media = FANOUT_MEDIA_AUDIO;
+    } else {
+        return 0;
+    }
+
+    if (input_generation != fanout->source_generation[media]) {
+        // A new input generation after the first one means the ingest reconnected
+        if (media == FANOUT_MEDIA_VIDEO && fanout->source_generation[media]) {
+            metrics_counter_add(fanout->reconnects, 1);
+        }
+        fanout_update_stream_info(fanout, media, stream, input_generation);
+    }
+
+    uint64_t seq = atomic_load(&fanout->write_seq);
+    fanout_slot_t *slot = &fanout->slots[seq % fanout->capacity];
+    int keyframe = (media == FANOUT_MEDIA_VIDEO && (pkt->flags & AV_PKT_FLAG_KEY)) ? 1 : 0;
+
+    pthread_mutex_lock(&slot->lock);
+    av_packet_unref(slot->pkt);
+    int ret = av_packet_ref(slot->pkt, pkt);
+    slot->seq = ret < 0 ? FANOUT_SEQ_NONE : seq;
+    slot->media = media;
+    slot->keyframe = keyframe;
+    slot->generation = atomic_load(&fanout->generation);
+    pthread_mutex_unlock(&slot->lock);
+
+    if (ret < 0) {
+        log_error("Packet fan-out for %s: failed to reference packet: %d", fanout->stream_name, ret);
+        return ret;
+    }
+
+    if (keyframe) {
+        atomic_store(&fanout->last_keyframe_seq, seq);
+
+        uint64_t now_us = metrics_now_us();
+        if (fanout->last_keyframe_us) {
+            metrics_histogram_observe(fanout->keyframe_interval, now_us - fanout->last_keyframe_us);
+        }
+        fanout->last_keyframe_us = now_us;
+    }
+    atomic_store(&fanout->write_seq, seq + 1);
+
+    metrics_counter_add(fanout->packets_in, 1);
+    metrics_counter_add(fanout->bytes_in, (uint64_t)pkt->size);
+
+    fanout_wake_readers(fanout);
+    return 0;
+}
+
+/**
+ * Resolve the ingest source of a stream from its configuration
+ * Streams restreamed through go2rtc are read from go2rtc, like the HLS writer does.
+ */
+static int fanout_resolve_source(const char *stream_name, char *url, size_t url_size, int *protocol) {
+    stream_handle_t stream = get_stream_by_name(stream_name);
+    if (!stream) {
+        log_error("Stream %s not found for packet fan-out", stream_name);
+        return -1;
+    }
+
+    stream_config_t config;
+    if (get_stream_config(stream, &config) != 0) {
+        log_error("Failed to get config for stream %s for packet fan-out", stream_name);
+        return -1;
+    }
+
+    strncpy(url, config.url, url_size - 1);
+    url[url_size - 1] = '\0';
+    *protocol = config.protocol;
+
+    if (go2rtc_integration_is_using_go2rtc_for_hls(stream_name)) {
+        if (!go2rtc_get_rtsp_url(stream_name, url, url_size)) {
+            log_warn("Failed to get go2rtc RTSP URL for stream %s, using configured URL", stream_name);
+            strncpy(url, config.url, url_size - 1);
+            url[url_size - 1] = '\0';
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Start (or restart) the stream reader feeding this fan-out
+ * The source is resolved again on every start, so a restart follows a
+ * configuration change or go2rtc becoming available.
+ * Must be called with ingest_mutex held.
+ */
+static int fanout_start_ingest_locked(packet_fanout_t *fanout) {
+    if (fanout->reader) {
+        stop_stream_reader(fanout->reader);
+        fanout->reader = NULL;
+    }
+
+    if (fanout_resolve_source(fanout->stream_name, fanout->url, sizeof(fanout->url), &fanout->protocol) != 0) {
+        fanout->last_restart = time(NULL);
+        return -1;
+    }
+
+    fanout->last_restart = time(NULL);
+    fanout->reader = start_stream_reader_with_url(fanout->stream_name, fanout->url, fanout->protocol,
+                                                  1, fanout_packet_callback, fanout);
+    if (!fanout->reader) {
+        log_error("Packet fan-out for %s: failed to start stream reader", fanout->stream_name);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Restart the ingest if its stream reader gave up (e.g. camera offline)
+ */
+static void fanout_check_ingest(packet_fanout_t *fanout) {
+    if (atomic_load(&fanout->closed) || atomic_load(&fanout_system_shutdown)) {
+        return;
+    }
+
+    pthread_mutex_lock(&fanout->ingest_mutex);
+    time_t now = time(NULL);
+    if ((!fanout->reader || !fanout->reader->running) &&
+        now - fanout->last_restart >= FANOUT_RESTART_INTERVAL_SEC) {
+        log_warn("Packet fan-out for %s: ingest is not running, restarting it", fanout->stream_name);
+        fanout_start_ingest_locked(fanout);
+    }
+    pthread_mutex_unlock(&fanout->ingest_mutex);
+}
+
+static void fanout_free(packet_fanout_t *fanout) {
+    if (!fanout) {
+        return;
+    }
+
+    if (fanout->slots) {
+        for (uint64_t i = 0; i < fanout->capacity; i++) {
+            av_packet_free(&fanout->slots[i].pkt);
+            pthread_mutex_destroy(&fanout->slots[i].lock);
+        }
+        free(fanout->slots);
+    }
+
+    for (int i = 0; i < FANOUT_MEDIA_COUNT; i++) {
+        avcodec_parameters_free(&fanout->params[i]);
+    }
+
+    pthread_mutex_destroy(&fanout->wait_mutex);
+    pthread_cond_destroy(&fanout->wait_cond);
+    pthread_mutex_destroy(&fanout->info_mutex);
+    pthread_mutex_destroy(&fanout->ingest_mutex);
+    free(fanout);
+}
+
+static packet_fanout_t *fanout_create(const char *stream_name) {
+    packet_fanout_t *fanout = calloc(1, sizeof(packet_fanout_t));
+    if (!fanout) {
+        log_error("Memory allocation failed for packet fan-out");
+        return NULL;
+    }
+
+    strncpy(fanout->stream_name, stream_name, MAX_STREAM_NAME - 1);
+    fanout->refcount = 1;
+
+    pthread_mutex_init(&fanout->wait_mutex, NULL);
+    pthread_cond_init(&fanout->wait_cond, NULL);
+    pthread_mutex_init(&fanout->info_mutex, NULL);
+    pthread_mutex_init(&fanout->ingest_mutex, NULL);
+
+    fanout->capacity = PACKET_FANOUT_DEFAULT_CAPACITY;
+    fanout->slots = calloc(fanout->capacity, sizeof(fanout_slot_t));
+    if (!fanout->slots) {
+        log_error("Memory allocation failed for packet fan-out ring");
+        fanout_free(fanout);
+        return NULL;
+    }
+
+    for (uint64_t i = 0; i < fanout->capacity; i++) {
+        pthread_mutex_init(&fanout->slots[i].lock, NULL);
+        fanout->slots[i].seq = FANOUT_SEQ_NONE;
+        fanout->slots[i].pkt = av_packet_alloc();
+        if (!fanout->slots[i].pkt) {
+            log_error("Failed to allocate packet for fan-out ring");
+            fanout->capacity = i + 1;
+            fanout_free(fanout);
+            return NULL;
+        }
+    }
+
+    atomic_store(&fanout->write_seq, 0);
+    atomic_store(&fanout->last_keyframe_seq, FANOUT_SEQ_NONE);
+    atomic_store(&fanout->closed, 0);
+    atomic_store(&fanout->waiters, 0);
+    atomic_store(&fanout->generation, 0);
+
+    char labels[128] = "";
+    metrics_label(labels, sizeof(labels), "stream", stream_name);
+    fanout->packets_in = metrics_counter("lightnvr_stream_packets_total",
+                                         "Packets received from the camera", labels);
+    fanout->bytes_in = metrics_counter("lightnvr_stream_bytes_total",
+                                       "Bytes of packets received from the camera", labels);
+    fanout->reconnects = metrics_counter("lightnvr_stream_reconnects_total",
+                                         "Times the camera connection was re-established", labels);
+    fanout->keyframe_interval = metrics_histogram("lightnvr_stream_keyframe_interval_seconds",
+                                                  "Time between two video keyframes", labels);
+
+    return fanout;
+}
+
+/**
+ * Acquire the shared fan-out for a stream, starting the ingest if needed
+ */
+packet_fanout_t *packet_fanout_acquire(const char *stream_name) {
+    if (!stream_name || atomic_load(&fanout_system_shutdown)) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&fanouts_mutex);
+
+    int free_slot = -1;
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (fanouts[i] && strcmp(fanouts[i]->stream_name, stream_name) == 0) {
+            packet_fanout_t *existing = fanouts[i];
+            existing->refcount++;
+            pthread_mutex_unlock(&fanouts_mutex);
+
+            log_debug("Packet fan-out for %s acquired (refcount: %d)", stream_name, existing->refcount);
+            return existing;
+        }
+        if (!fanouts[i] && free_slot == -1) {
+            free_slot = i;
+        }
+    }
+
+    if (free_slot == -1) {
+        pthread_mutex_unlock(&fanouts_mutex);
+        log_error("No slot available for packet fan-out of stream %s", stream_name);
+        return NULL;
+    }
+
+    packet_fanout_t *fanout = fanout_create(stream_name);
+    if (!fanout) {
+        pthread_mutex_unlock(&fanouts_mutex);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&fanout->ingest_mutex);
+    int ret = fanout_start_ingest_locked(fanout);
+    pthread_mutex_unlock(&fanout->ingest_mutex);
+
+    if (ret != 0) {
+        pthread_mutex_unlock(&fanouts_mutex);
+        fanout_free(fanout);
+        return NULL;
+    }
+
+    fanouts[free_slot] = fanout;
+    pthread_mutex_unlock(&fanouts_mutex);
+
+    log_info("Started shared ingest for stream %s", stream_name);
+    return fanout;
+}
+
+/**
+ * Release a reference obtained with packet_fanout_acquire()
+ */
+void packet_fanout_release(packet_fanout_t *fanout) {
+    if (!fanout) {
+        return;
+    }
+
+    pthread_mutex_lock(&fanouts_mutex);
+    if (--fanout->refcount > 0) {
+        log_debug("Packet fan-out for %s released (refcount: %d)", fanout->stream_name, fanout->refcount);
+        pthread_mutex_unlock(&fanouts_mutex);
+        return;
+    }
+
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (fanouts[i] == fanout) {
+            fanouts[i] = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&fanouts_mutex);
+
+    atomic_store(&fanout->closed, 1);
+    pthread_mutex_lock(&fanout->wait_mutex);
+    pthread_cond_broadcast(&fanout->wait_cond);
+    pthread_mutex_unlock(&fanout->wait_mutex);
+
+    pthread_mutex_lock(&fanout->ingest_mutex);
+    if (fanout->reader) {
+        stop_stream_reader(fanout->reader);
+        fanout->reader = NULL;
+    }
+    pthread_mutex_unlock(&fanout->ingest_mutex);
+
+    log_info("Stopped shared ingest for stream %s", fanout->stream_name);
+    fanout_free(fanout);
+}
+
+/**
+ * Subscribe to a fan-out
+ */
+packet_fanout_reader_t *packet_fanout_subscribe(packet_fanout_t *fanout, const char *name,
+                                                packet_fanout_policy_t policy) {
+    if (!fanout) {
+        return NULL;
+    }
+
+    packet_fanout_reader_t *reader = calloc(1, sizeof(packet_fanout_reader_t));
+    if (!reader) {
+        log_error("Memory allocation failed for packet fan-out reader");
+        return NULL;
+    }
+
+    reader->fanout = fanout;
+    strncpy(reader->name, name ? name : "consumer", sizeof(reader->name) - 1);
+    reader->policy = policy;
+    reader->stream_idx[FANOUT_MEDIA_VIDEO] = -1;
+    reader->stream_idx[FANOUT_MEDIA_AUDIO] = -1;
+
+    char labels[128] = "";
+    metrics_label(labels, sizeof(labels), "stream", fanout->stream_name);
+    metrics_label(labels, sizeof(labels), "consumer", reader->name);
+    reader->dropped_metric = metrics_counter("lightnvr_stream_packets_dropped_total",
+                                             "Packets skipped by a consumer that fell behind", labels);
+
+    // Start at the current GOP when one is still in the ring, otherwise at the
+    // next keyframe, so the first packet a consumer sees is always decodable
+    uint64_t head = atomic_load(&fanout->write_seq);
+    uint64_t last_kf = atomic_load(&fanout->last_keyframe_seq);
+    uint64_t oldest = head > fanout->capacity ? head - fanout->capacity : 0;
+    reader->cursor = (last_kf != FANOUT_SEQ_NONE && last_kf >= oldest) ? last_kf : head;
+    reader->need_keyframe = 1;
+
+    pthread_mutex_lock(&fanout->ingest_mutex);
+    int slot = -1;
+    for (int i = 0; i < PACKET_FANOUT_MAX_READERS; i++) {
+        if (!fanout->readers[i]) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot >= 0) {
+        fanout->readers[slot] = reader;
+    }
+    pthread_mutex_unlock(&fanout->ingest_mutex);
+
+    if (slot < 0) {
+        log_error("Too many subscribers for packet fan-out of stream %s", fanout->stream_name);
+        free(reader);
+        return NULL;
+    }
+
+    log_info("Consumer %s subscribed to packet fan-out for stream %s", reader->name, fanout->stream_name);
+    return reader;
+}
+
+/**
+ * Unsubscribe and free a reader
+ */
+void packet_fanout_unsubscribe(packet_fanout_reader_t *reader) {
+    if (!reader) {
+        return;
+    }
+
+    packet_fanout_t *fanout = reader->fanout;
+    pthread_mutex_lock(&fanout->ingest_mutex);
+    for (int i = 0; i < PACKET_FANOUT_MAX_READERS; i++) {
+        if (fanout->readers[i] == reader) {
+            fanout->readers[i] = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&fanout->ingest_mutex);
+
+    log_info("Consumer %s unsubscribed from packet fan-out for stream %s "
+             "(read: %llu, dropped: %llu, resyncs: %llu)",
+             reader->name, fanout->stream_name,
+             (unsigned long long)reader->packets_read,
+             (unsigned long long)reader->packets_dropped,
+             (unsigned long long)reader->resyncs);
+
+    if (reader->streams_ctx) {
+        avformat_free_context(reader->streams_ctx);
+    }
+    free(reader);
+}
+
+/**
+ * Copy the published stream parameters into the reader's private streams
+ * Existing AVStream objects are updated in place so pointers handed out
+ * earlier stay valid.
+ */
+static int fanout_reader_refresh_streams(packet_fanout_reader_t *reader) {
+    packet_fanout_t *fanout = reader->fanout;
+    int ret = 0;
+
+    pthread_mutex_lock(&fanout->info_mutex);
+
+    if (!fanout->params[FANOUT_MEDIA_VIDEO]) {
+        pthread_mutex_unlock(&fanout->info_mutex);
+        return AVERROR(EAGAIN);
+    }
+
+    if (!reader->streams_ctx) {
+        reader->streams_ctx = avformat_alloc_context();
+        if (!reader->streams_ctx) {
+            pthread_mutex_unlock(&fanout->info_mutex);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    for (int media = 0; media < FANOUT_MEDIA_COUNT; media++) {
+        if (!fanout->params[media]) {
+            continue;
+        }
+
+        AVStream *st = NULL;
+        if (reader->stream_idx[media] >= 0) {
+            st = reader->streams_ctx->streams[reader->stream_idx[media]];
+        } else {
+            st = avformat_new_stream(reader->streams_ctx, NULL);
+            if (!st) {
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+            reader->stream_idx[media] = st->index;
+        }
+
+        ret = avcodec_parameters_copy(st->codecpar, fanout->params[media]);
+        if (ret < 0) {
+            break;
+        }
+        st->time_base = fanout->time_base[media];
+        if (media == FANOUT_MEDIA_VIDEO) {
+            st->avg_frame_rate = fanout->frame_rate;
+            st->r_frame_rate = fanout->frame_rate;
+        }
+    }
+
+    unsigned int gen = atomic_load(&fanout->generation);
+    pthread_mutex_unlock(&fanout->info_mutex);
+
+    if (ret >= 0) {
+        if (reader->generation != 0) {
+            reader->streams_changed = true;
+        }
+        reader->generation = gen;
+    }
+
+    return ret;
+}
+
+static void fanout_deadline(struct timespec *ts, int timeout_ms) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * Wait until the write sequence moves past seen_seq or the deadline expires
+ *
+ * @return 0 if new data may be available, ETIMEDOUT otherwise
+ */
+static int fanout_wait(packet_fanout_t *fanout, uint64_t seen_seq, const struct timespec *deadline) {
+    int rc = 0;
+
+    pthread_mutex_lock(&fanout->wait_mutex);
+    atomic_fetch_add(&fanout->waiters, 1);
+    while (atomic_load(&fanout->write_seq) == seen_seq && !atomic_load(&fanout->closed) && rc == 0) {
+        rc = pthread_cond_timedwait(&fanout->wait_cond, &fanout->wait_mutex, deadline);
+    }
+    atomic_fetch_sub(&fanout->waiters, 1);
+    pthread_mutex_unlock(&fanout->wait_mutex);
+
+    return rc == ETIMEDOUT ? ETIMEDOUT : 0;
+}
+
+/**
+ * Wait until the ingest has published stream parameters
+ */
+int packet_fanout_wait_for_streams(packet_fanout_reader_t *reader, int timeout_ms) {
+    if (!reader) {
+        return AVERROR(EINVAL);
+    }
+
+    packet_fanout_t *fanout = reader->fanout;
+    struct timespec deadline;
+    fanout_deadline(&deadline, timeout_ms);
+
+    while (atomic_load(&fanout->generation) == 0) {
+        if (atomic_load(&fanout->closed)) {
+            return AVERROR_EOF;
+        }
+        if (fanout_wait(fanout, atomic_load(&fanout->write_seq), &deadline) == ETIMEDOUT) {
+            fanout_check_ingest(fanout);
+            return AVERROR(EAGAIN);
+        }
+    }
+
+    if (reader->generation != atomic_load(&fanout->generation)) {
+        return fanout_reader_refresh_streams(reader);
+    }
+    return 0;
+}
+
+/**
+ * Move a reader forward if it fell behind, according to its policy
+ */
+static void fanout_apply_backpressure(packet_fanout_reader_t *reader, uint64_t head) {
+    packet_fanout_t *fanout = reader->fanout;
+    uint64_t oldest = head > fanout->capacity ? head - fanout->capacity : 0;
+    uint64_t last_kf = atomic_load(&fanout->last_keyframe_seq);
+    bool kf_available = last_kf != FANOUT_SEQ_NONE && last_kf >= oldest && last_kf < head;
+    uint64_t target = reader->cursor;
+
+    if (reader->cursor < oldest) {
+        // Lapped: the packets at the cursor have already been overwritten
+        target = kf_available ? last_kf : oldest;
+    } else if (reader->policy == PACKET_FANOUT_POLICY_LATEST && kf_available && last_kf > reader->cursor) {
+        // A newer GOP is available, skip straight to it
+        target = last_kf;
+    }
+
+    if (target != reader->cursor) {
+        reader->packets_dropped += target - reader->cursor;
+        metrics_counter_add(reader->dropped_metric, target - reader->cursor);
+        reader->resyncs++;
+        reader->cursor = target;
+        reader->need_keyframe = 1;
+        if (reader->policy == PACKET_FANOUT_POLICY_CATCH_UP) {
+            log_warn("Consumer %s fell behind on stream %s, resynced to keyframe (dropped: %llu)",
+                     reader->name, fanout->stream_name, (unsigned long long)reader->packets_dropped);
+        }
+    }
+}
+
+/**
+ * Read the next packet for this subscriber
+ */
+int packet_fanout_read(packet_fanout_reader_t *reader, AVPacket *pkt, int timeout_ms) {
+    if (!reader || !pkt) {
+        return AVERROR(EINVAL);
+    }
+
+    packet_fanout_t *fanout = reader->fanout;
+    struct timespec deadline;
+    fanout_deadline(&deadline, timeout_ms);
+
+    while (1) {
+        if (atomic_load(&fanout->closed)) {
+            return AVERROR_EOF;
+        }
+
+        uint64_t head = atomic_load(&fanout->write_seq);
+        if (reader->cursor >= head) {
+            if (fanout_wait(fanout, head, &deadline) == ETIMEDOUT) {
+                fanout_check_ingest(fanout);
+                return AVERROR(EAGAIN);
+            }
+            continue;
+        }
+
+        fanout_apply_backpressure(reader, head);
+
+        fanout_slot_t *slot = &fanout->slots[reader->cursor % fanout->capacity];
+        pthread_mutex_lock(&slot->lock);
+
+        if (slot->seq != reader->cursor) {
+            // Overwritten between the backpressure check and the lock; the
+            // next pass sees the reader as lapped and resyncs it
+            pthread_mutex_unlock(&slot->lock);
+            continue;
+        }
+
+        int media = slot->media;
+        int keyframe = slot->keyframe;
+        unsigned int generation = slot->generation;
+
+        if (reader->need_keyframe && !keyframe) {
+            pthread_mutex_unlock(&slot->lock);
+            reader->cursor++;
+            reader->packets_dropped++;
+            metrics_counter_add(reader->dropped_metric, 1);
+            continue;
+        }
+
+        int ret = av_packet_ref(pkt, slot->pkt);
+        pthread_mutex_unlock(&slot->lock);
+        reader->cursor++;
+
+        if (ret < 0) {
+            return ret;
+        }
+
+        if (generation != 0 && generation != reader->generation) {
+            ret = fanout_reader_refresh_streams(reader);
+            if (ret < 0) {
+                av_packet_unref(pkt);
+                return ret;
+            }
+        }
+
+        if (reader->stream_idx[media] < 0) {
+            // Parameters for this media type are not known to the reader yet
+            av_packet_unref(pkt);
+            continue;
+        }
+
+        pkt->stream_index = reader->stream_idx[media];
+        reader->need_keyframe = 0;
+        reader->packets_read++;
+        return 0;
+    }
+}
+
+/**
+ * Get the reader's view of an input stream
+ */
+const AVStream *packet_fanout_get_stream(packet_fanout_reader_t *reader, enum AVMediaType type) {
+    if (!reader || !reader->streams_ctx) {
+        return NULL;
+    }
+
+    int media;
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        media = FANOUT_MEDIA_VIDEO;
+    } else if (type == AVMEDIA_TYPE_AUDIO) {
+        media = FANOUT_MEDIA_AUDIO;
+    } else {
+        return NULL;
+    }
+
+    if (reader->stream_idx[media] < 0) {
+        return NULL;
+    }
+    return reader->streams_ctx->streams[reader->stream_idx[media]];
+}
+
+/**
+ * Get the reader's private format context
+ */
+AVFormatContext *packet_fanout_get_format_context(packet_fanout_reader_t *reader) {
+    return reader ? reader->streams_ctx : NULL;
+}
+
+/**
+ * Check and clear the "stream parameters changed" flag of a reader
+ */
+bool packet_fanout_streams_changed(packet_fanout_reader_t *reader) {
+    if (!reader) {
+        return false;
+    }
+
+    bool changed = reader->streams_changed;
+    reader->streams_changed = false;
+    return changed;
+}
+
+/**
+ * Get statistics for a reader
+ */
+void packet_fanout_get_reader_stats(packet_fanout_reader_t *reader, packet_fanout_reader_stats_t *stats) {
+    if (!reader || !stats) {
+        return;
+    }
+
+    uint64_t head = atomic_load(&reader->fanout->write_seq);
+    stats->packets_read = reader->packets_read;
+    stats->packets_dropped = reader->packets_dropped;
+    stats->resyncs = reader->resyncs;
+    stats->lag = head > reader->cursor ? head - reader->cursor : 0;
+}
+
+/**
+ * Check whether shared ingest is enabled in the global configuration
+ */
+bool packet_fanout_is_enabled(void) {
+    extern config_t g_config;
+    return g_config.shared_ingest && !atomic_load(&fanout_system_shutdown);
+}
+
+/**
+ * Stop every shared ingest and wake all subscribers
+ */
+void shutdown_packet_fanout_system(void) {
+    log_info("Shutting down packet fan-out system...");
+    atomic_store(&fanout_system_shutdown, 1);
+
+    pthread_mutex_lock(&fanouts_mutex);
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        packet_fanout_t *fanout = fanouts[i];
+        if (!fanout) {
+            continue;
+        }
+
+        atomic_store(&fanout->closed, 1);
+        pthread_mutex_lock(&fanout->wait_mutex);
+        pthread_cond_broadcast(&fanout->wait_cond);
+        pthread_mutex_unlock(&fanout->wait_mutex);
+
+        // The fan-out itself is freed by the last packet_fanout_release()
+        pthread_mutex_lock(&fanout->ingest_mutex);
+        if (fanout->reader) {
+            stop_stream_reader(fanout->reader);
+            fanout->reader = NULL;
+        }
+        pthread_mutex_unlock(&fanout->ingest_mutex);
+    }
+    pthread_mutex_unlock(&fanouts_mutex);
+
+    log_info("Packet fan-out system shut down");
+}
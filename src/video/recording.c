@@ -16,6 +16,7 @@
 #include "video/streams.h"
 #include "video/mp4_writer.h"
 #include "database/database_manager.h"
+#include "database/db_recording_index.h"
 
 // We no longer maintain a separate array of MP4 writers here
 // Instead, we use the functions from mp4_recording.c
@@ -198,9 +199,9 @@ void update_recording(const char *stream_name) {
                 }
             }
             
-            // Update recording metadata
+            // Update recording metadata, progress updates do not wait for the commit
             time_t current_time = time(NULL);
-            update_recording_metadata(recording_id, current_time, total_size, false);
+            update_recording_metadata_async(recording_id, current_time, total_size, false, NULL);
             
             log_debug("Updated recording %llu for stream %s, size: %llu bytes", 
                     (unsigned long long)recording_id, stream_name, (unsigned long long)total_size);
@@ -321,147 +322,32 @@ int find_mp4_recording(const char *stream_name, time_t timestamp, char *mp4_path
         return -1;
     }
 
-    // Get global config for storage paths
-    config_t *global_config = get_streaming_config();
-    char base_path[256];
-
-    // Try different possible locations for the MP4 file
-
-    // 1. Try main recordings directory with stream subdirectory
-    snprintf(base_path, sizeof(base_path), "%s/recordings/%s",
-            global_config->storage_path, stream_name);
-
-    // Format timestamp for pattern matching
-    char timestamp_str[32];
-    struct tm *tm_info = localtime(&timestamp);
-    strftime(timestamp_str, sizeof(timestamp_str), "%Y%m%d_%H%M", tm_info);
-
-    // Log what we're looking for
-    log_info("Looking for MP4 recording for stream '%s' with timestamp around %s in %s",
-            stream_name, timestamp_str, base_path);
-
-    // Use system command to find matching files
-    char find_cmd[512];
-    snprintf(find_cmd, sizeof(find_cmd),
-            "find %s -type f -name \"recording_%s*.mp4\" | sort",
-            base_path, timestamp_str);
-
-    FILE *cmd_pipe = popen(find_cmd, "r");
-    if (!cmd_pipe) {
-        log_error("Failed to execute find command: %s", find_cmd);
-
-        // Try fallback with ls and grep
-        snprintf(find_cmd, sizeof(find_cmd),
-                "ls -1 %s/recording_%s*.mp4 2>/dev/null | head -1",
-                base_path, timestamp_str);
-
-        cmd_pipe = popen(find_cmd, "r");
-        if (!cmd_pipe) {
-            log_error("Failed to execute fallback find command");
-            return -1;
-        }
+    char found_path[MAX_PATH_LENGTH];
+    int ret = recording_index_find(stream_name, timestamp, found_path, sizeof(found_path));
+    if (ret < 0) {
+        log_error("Failed to look up recordings for stream '%s'", stream_name);
+        return -1;
     }
 
-    char found_path[256] = {0};
-    if (fgets(found_path, sizeof(found_path), cmd_pipe)) {
-        // Remove trailing newline
-        size_t len = strlen(found_path);
-        if (len > 0 && found_path[len-1] == '\n') {
-            found_path[len-1] = '\0';
-        }
-
-        // Check if file exists and has content
-        struct stat st;
-        if (stat(found_path, &st) == 0 && st.st_size > 0) {
-            log_info("Found MP4 file: %s (%lld bytes)",
-                    found_path, (long long)st.st_size);
-
-            strncpy(mp4_path, found_path, path_size - 1);
-            mp4_path[path_size - 1] = '\0';
-            pclose(cmd_pipe);
-            return 1;
-        }
+    if (ret == 0) {
+        log_debug("No MP4 recording found for stream '%s' at %lld",
+                 stream_name, (long long)timestamp);
+        return 0;
     }
 
-    pclose(cmd_pipe);
-
-    // 2. Try alternative location if MP4 direct storage is configured
-    if (global_config->record_mp4_directly && global_config->mp4_storage_path[0] != '\0') {
-        snprintf(base_path, sizeof(base_path), "%s/%s",
-                global_config->mp4_storage_path, stream_name);
-
-        log_info("Looking in alternative MP4 location: %s", base_path);
-
-        // Same approach with alternative path
-        snprintf(find_cmd, sizeof(find_cmd),
-                "find %s -type f -name \"recording_%s*.mp4\" | sort",
-                base_path, timestamp_str);
-
-        cmd_pipe = popen(find_cmd, "r");
-        if (cmd_pipe) {
-            if (fgets(found_path, sizeof(found_path), cmd_pipe)) {
-                // Remove trailing newline
-                size_t len = strlen(found_path);
-                if (len > 0 && found_path[len-1] == '\n') {
-                    found_path[len-1] = '\0';
-                }
-
-                // Check if file exists and has content
-                struct stat st;
-                if (stat(found_path, &st) == 0 && st.st_size > 0) {
-                    log_info("Found MP4 file in alternative location: %s (%lld bytes)",
-                            found_path, (long long)st.st_size);
-
-                    strncpy(mp4_path, found_path, path_size - 1);
-                    mp4_path[path_size - 1] = '\0';
-                    pclose(cmd_pipe);
-                    return 1;
-                }
-            }
-            pclose(cmd_pipe);
-        }
+    // Check if file exists and has content
+    struct stat st;
+    if (stat(found_path, &st) != 0 || st.st_size == 0) {
+        log_warn("Indexed MP4 recording for stream '%s' is missing or empty: %s",
+                stream_name, found_path);
+        return 0;
     }
 
-    // 3. Try less restrictive search in case the timestamp format is different
-    // This will look for any MP4 with the stream name in various directories
-
-    // Try in the HLS directory itself (sometimes MP4s are stored alongside HLS files)
-    snprintf(base_path, sizeof(base_path), "%s/hls/%s",
-            global_config->storage_path, stream_name);
-
-    log_info("Looking in HLS directory: %s", base_path);
+    log_debug("Found MP4 file: %s (%lld bytes)", found_path, (long long)st.st_size);
 
-    snprintf(find_cmd, sizeof(find_cmd),
-            "find %s -type f -name \"*.mp4\" | sort", base_path);
-
-    cmd_pipe = popen(find_cmd, "r");
-    if (cmd_pipe) {
-        if (fgets(found_path, sizeof(found_path), cmd_pipe)) {
-            // Remove trailing newline
-            size_t len = strlen(found_path);
-            if (len > 0 && found_path[len-1] == '\n') {
-                found_path[len-1] = '\0';
-            }
-
-            // Check if file exists and has content
-            struct stat st;
-            if (stat(found_path, &st) == 0 && st.st_size > 0) {
-                log_info("Found MP4 file in HLS directory: %s (%lld bytes)",
-                        found_path, (long long)st.st_size);
-
-                strncpy(mp4_path, found_path, path_size - 1);
-                mp4_path[path_size - 1] = '\0';
-                pclose(cmd_pipe);
-                return 1;
-            }
-        }
-        pclose(cmd_pipe);
-    }
-
-    // No MP4 file found
-    log_warn("No matching MP4 recording found for stream '%s' with timestamp around %s",
-            stream_name, timestamp_str);
-    return 0;
+    strncpy(mp4_path, found_path, path_size - 1);
+    mp4_path[path_size - 1] = '\0';
+    return 1;
 }
 
 // This function is now defined in mp4_recording.c
@@ -19,6 +19,7 @@
 #include "video/detection_result.h"
 #include "video/detection_model.h"
 #include "video/sod_detection.h"
+#include "video/inference_scheduler.h"
 #include "sod/sod.h"
 
 // SOD library function pointers for dynamic loading
@@ -42,8 +43,9 @@ static bool sod_available = false;
 
 // SOD model structure
 typedef struct {
-    void *model;                 // SOD model handle
+    void *model;                 // SOD model handle, NULL when shared
     float threshold;             // Detection threshold
+    inference_model_t *shared;   // Shared model run through the batch scheduler
 } sod_model_t;
 
 // SOD box structure (for dynamic loading)
@@ -73,6 +75,7 @@ int init_sod_detection_system(void) {
         // Static linking approach - SOD functions are directly available
         log_info("SOD detection initialized with static linking");
         sod_available = true;
+        init_inference_scheduler();
     return 0;
 #else
     log_error("SOD support is not enabled at compile time");
@@ -91,6 +94,9 @@ void shutdown_sod_detection_system(void) {
     // Add a small delay to allow any in-progress operations to detect the flag change
     usleep(100000); // 100ms
 
+    // Fail frames still waiting for a batch
+    shutdown_inference_scheduler();
+
     log_info("SOD detection system shutdown");
 }
 
@@ -161,6 +167,12 @@ void cleanup_sod_model(detection_model_t model) {
     // Set the model pointer to NULL first to prevent double-free
     m->sod.model = NULL;
 
+    // Shared models are unloaded by their last user
+    if (m->sod.shared) {
+        inference_scheduler_release(m->sod.shared);
+        m->sod.shared = NULL;
+    }
+
     // Only destroy the model if the pointer is valid
     if (sod_model_ptr) {
         if (is_model_already_cleaned(sod_model_ptr)) {
@@ -220,7 +232,12 @@ detection_model_t load_sod_model(const char *model_path, float threshold) {
     }
 
     // First check for exact filename matches
-    if (strcmp(filename, "face_cnn.sod") == 0 ||
+    if (is_quantized_model(model_path)) {
+        // The architecture is stored in the quantized model itself
+        arch = ":q8";
+        log_info("Detected int8 quantized model: %s", filename);
+    }
+    else if (strcmp(filename, "face_cnn.sod") == 0 ||
         strcmp(filename, "face.sod") == 0 ||
         strcmp(filename, "face_detection.sod") == 0) {
         arch = ":face";
@@ -239,9 +256,41 @@ detection_model_t load_sod_model(const char *model_path, float threshold) {
         arch = ":face";
     }
 
+    // Set detection threshold - use same threshold as spec if not specified
+    if (threshold <= 0.0f) {
+        threshold = 0.3f; // Default threshold from spec
+        log_info("Using default threshold of 0.3 for model %s", model_path);
+    }
+
+    // With batching enabled, streams using the same model share one copy of its weights
+    if (is_inference_batching_enabled()) {
+        inference_model_t *shared = inference_scheduler_acquire(model_path, arch, threshold);
+        if (shared) {
+            model_t *model = (model_t *)calloc(1, sizeof(model_t));
+            if (!model) {
+                log_error("Failed to allocate memory for model structure");
+                inference_scheduler_release(shared);
+                return NULL;
+            }
+
+            strncpy(model->type, MODEL_TYPE_SOD, sizeof(model->type) - 1);
+            model->sod.threshold = threshold;
+            model->sod.shared = shared;
+            strncpy(model->path, model_path, MAX_PATH_LENGTH - 1);
+
+            log_info("SOD model loaded: %s with threshold %.2f (batched)", model_path, threshold);
+            return model;
+        }
+        log_warn("Falling back to a private copy of SOD model %s", model_path);
+    }
+
     // Use static linking
     sod_cnn *cnn_model = NULL;
-    rc = sod_cnn_create(&cnn_model, arch, model_path, &err_msg);
+    if (is_quantized_model(model_path)) {
+        rc = sod_cnn_create_quantized(&cnn_model, model_path, 0, &err_msg);
+    } else {
+        rc = sod_cnn_create(&cnn_model, arch, model_path, &err_msg);
+    }
 
     if (rc != 0 || !cnn_model) {  // SOD_OK is 0
         log_error("Failed to load SOD model: %s - %s", model_path, err_msg ? err_msg : "Unknown error");
@@ -251,14 +300,9 @@ detection_model_t load_sod_model(const char *model_path, float threshold) {
     // Store the model pointer
     sod_model = cnn_model;
 
-    // Set detection threshold - use same threshold as spec if not specified
-    if (threshold <= 0.0f) {
-        threshold = 0.3f; // Default threshold from spec
-        log_info("Using default threshold of 0.3 for model %s", model_path);
-    }
-
     // Use static linking
     sod_cnn_config(cnn_model, SOD_CNN_DETECTION_THRESHOLD, threshold);
+    sod_cnn_config(cnn_model, SOD_CNN_NUM_THREADS, g_config.inference_threads);
 
     // Create model structure
     model_t *model = (model_t *)malloc(sizeof(model_t));
@@ -272,6 +316,7 @@ detection_model_t load_sod_model(const char *model_path, float threshold) {
     strncpy(model->type, MODEL_TYPE_SOD, sizeof(model->type) - 1);
     model->sod.model = sod_model;
     model->sod.threshold = threshold;
+    model->sod.shared = NULL;
 
     // Store the model path in the model structure
     strncpy(model->path, model_path, MAX_PATH_LENGTH - 1);
@@ -310,6 +355,12 @@ int detect_with_sod_model(detection_model_t model, const unsigned char *frame_da
         return -1;
     }
 
+    // Shared models are batched with the frames of other streams
+    if (m->sod.shared) {
+        return inference_scheduler_detect(m->sod.shared, frame_data, width, height, channels,
+                                          m->sod.threshold, result);
+    }
+
     // Step 1: Create a SOD image
     log_info("Step 1: Creating SOD image from frame data (dimensions: %dx%d, channels: %d)",
             width, height, channels);
@@ -9,6 +9,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <time.h>
+#include <stdatomic.h>
 
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
@@ -26,6 +27,10 @@
 static stream_reader_ctx_t *reader_contexts[MAX_STREAMS];
 static pthread_mutex_t contexts_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Source of input generations, shared by all readers so that a restarted
+// reader never repeats a generation seen from the previous one
+static atomic_uint input_generation_counter = 0;
+
 // Forward declarations
 static void *stream_reader_thread(void *arg);
 
@@ -78,6 +83,7 @@ static void *stream_reader_thread(void *arg) {
         }
         if (ret == 0) {
             // Successfully opened the stream
+            ctx->input_generation = atomic_fetch_add(&input_generation_counter, 1) + 1;
 
             // Set the UDP flag in the timestamp tracker based on the protocol
             // This ensures proper timestamp handling for UDP streams
@@ -479,6 +485,7 @@ static void *stream_reader_thread(void *arg) {
 
                 // Reset reconnection attempts on successful reconnection
                 reconnect_attempts = 0;
+                ctx->input_generation = atomic_fetch_add(&input_generation_counter, 1) + 1;
 
                 // Set the UDP flag in the timestamp tracker based on the protocol
                 // This ensures proper timestamp handling for UDP streams after reconnection
@@ -588,7 +595,7 @@ static void *stream_reader_thread(void *arg) {
                     ctx->input_ctx->streams[ctx->video_stream_idx] :
                     ctx->input_ctx->streams[ctx->audio_stream_idx];
 
-                ret = callback(pkt, stream, callback_data);
+                ret = callback(pkt, stream, ctx->input_generation, callback_data);
                 if (ret < 0) {
                     log_error("Packet callback failed for %s packet in stream %s: %d",
                              is_video ? "video" : "audio", ctx->config.name, ret);
@@ -721,6 +728,14 @@ void cleanup_stream_reader_backend(void) {
  */
 stream_reader_ctx_t *start_stream_reader(const char *stream_name, int dedicated,
                                         packet_callback_t callback, void *user_data) {
+    return start_stream_reader_with_url(stream_name, NULL, -1, dedicated, callback, user_data);
+}
+
+/**
+ * Start a stream reader on an explicit URL
+ */
+stream_reader_ctx_t *start_stream_reader_with_url(const char *stream_name, const char *url, int protocol,
+                                                 int dedicated, packet_callback_t callback, void *user_data) {
     stream_handle_t stream = get_stream_by_name(stream_name);
     if (!stream) {
         log_error("Stream %s not found for stream reader", stream_name);
@@ -733,6 +748,15 @@ stream_reader_ctx_t *start_stream_reader(const char *stream_name, int dedicated,
         return NULL;
     }
 
+    // Override the ingest source when the caller resolved it (e.g. go2rtc restream)
+    if (url && url[0] != '\0') {
+        strncpy(config.url, url, MAX_URL_LENGTH - 1);
+        config.url[MAX_URL_LENGTH - 1] = '\0';
+    }
+    if (protocol == STREAM_PROTOCOL_TCP || protocol == STREAM_PROTOCOL_UDP) {
+        config.protocol = protocol;
+    }
+
     // For dedicated readers, we don't check if already running
     // For shared readers, we check if already running
     if (!dedicated) {
@@ -826,11 +850,10 @@ int stop_stream_reader(stream_reader_ctx_t *ctx) {
     static pthread_mutex_t stop_mutex = PTHREAD_MUTEX_INITIALIZER;
     pthread_mutex_lock(&stop_mutex);
 
-    //  Check if the reader is already stopped
+    // A reader whose thread already gave up is still registered and still
+    // owns its context, so fall through to join and free it
     if (!ctx->running) {
-        log_warn("Stream reader for %s is already stopped", stream_name);
-        pthread_mutex_unlock(&stop_mutex);
-        return 0;
+        log_info("Stream reader thread for %s already exited, releasing its context", stream_name);
     }
 
     pthread_mutex_lock(&contexts_mutex);
@@ -425,30 +425,10 @@ void mg_handle_batch_delete_recordings(struct mg_connection *c, struct mg_http_m
     // This prevents the client from waiting for the deletion to complete
     mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Batch deletion in progress\"}");
     
-    // Create a thread data structure
-    struct mg_thread_data *data = calloc(1, sizeof(struct mg_thread_data));
-    if (!data) {
-        log_error("Failed to allocate memory for thread data");
-        mg_http_reply(c, 500, "", "Internal Server Error\n");
+    // Queue the work for a worker thread; an error response has been sent if this fails
+    if (!mg_submit_request(c, hm, batch_delete_recordings_task_function, MG_PRIORITY_BULK)) {
         return;
     }
     
-    // Copy the HTTP message
-    data->message = mg_strdup(hm->message);
-    if (data->message.len == 0) {
-        log_error("Failed to duplicate HTTP message");
-        free(data);
-        mg_http_reply(c, 500, "", "Internal Server Error\n");
-        return;
-    }
-    
-    // Set connection ID, manager, and handler function
-    data->conn_id = c->id;
-    data->mgr = c->mgr;
-    data->handler_func = batch_delete_recordings_task_function;
-    
-    // Start thread
-    mg_start_thread(mg_thread_function, data);
-    
     log_info("Batch delete recordings task started in a worker thread");
 }
@@ -286,32 +286,13 @@ void file_operation_handler(struct mg_connection *c, struct mg_http_message *hm)
 void mg_handle_check_recording_file(struct mg_connection *c, struct mg_http_message *hm) {
     log_info("Handling GET /api/recordings/files/check request");
     
-    // Send an immediate response to the client before processing the request
-    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Processing request\"}");
-    
-    // Create a thread data structure
-    struct mg_thread_data *data = calloc(1, sizeof(struct mg_thread_data));
-    if (!data) {
-        log_error("Failed to allocate memory for thread data");
-        mg_http_reply(c, 500, "", "Internal Server Error\n");
+    // Queue the work for a worker thread; an error response has been sent if this fails
+    if (!mg_submit_request(c, hm, file_operation_handler, MG_PRIORITY_NORMAL)) {
         return;
     }
     
-    // Copy the HTTP message
-    data->message = mg_strdup(hm->message);
-    if (data->message.len == 0) {
-        log_error("Failed to duplicate HTTP message");
-        free(data);
-        return;
-    }
-    
-    // Set connection ID, manager, and handler function
-    data->conn_id = c->id;
-    data->mgr = c->mgr;
-    data->handler_func = file_operation_handler;
-    
-    // Start thread
-    mg_start_thread(mg_thread_function, data);
+    // Send an immediate response to the client while the request is processed
+    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Processing request\"}");
     
     log_info("File operation task started in a worker thread");
 }
@@ -322,32 +303,13 @@ void mg_handle_check_recording_file(struct mg_connection *c, struct mg_http_mess
 void mg_handle_delete_recording_file(struct mg_connection *c, struct mg_http_message *hm) {
     log_info("Handling DELETE /api/recordings/files request");
     
-    // Send an immediate response to the client before processing the request
-    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Processing request\"}");
-    
-    // Create a thread data structure
-    struct mg_thread_data *data = calloc(1, sizeof(struct mg_thread_data));
-    if (!data) {
-        log_error("Failed to allocate memory for thread data");
-        mg_http_reply(c, 500, "", "Internal Server Error\n");
+    // Queue the work for a worker thread; an error response has been sent if this fails
+    if (!mg_submit_request(c, hm, file_operation_handler, MG_PRIORITY_BULK)) {
         return;
     }
     
-    // Copy the HTTP message
-    data->message = mg_strdup(hm->message);
-    if (data->message.len == 0) {
-        log_error("Failed to duplicate HTTP message");
-        free(data);
-        return;
-    }
-    
-    // Set connection ID, manager, and handler function
-    data->conn_id = c->id;
-    data->mgr = c->mgr;
-    data->handler_func = file_operation_handler;
-    
-    // Start thread
-    mg_start_thread(mg_thread_function, data);
+    // Send an immediate response to the client while the request is processed
+    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Processing request\"}");
     
     log_info("File operation task started in a worker thread");
 }
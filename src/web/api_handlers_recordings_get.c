@@ -293,7 +293,9 @@ void mg_handle_get_recordings_worker(struct mg_connection *c, struct mg_http_mes
         cJSON_AddStringToObject(recording, "end_time", end_time_str);
         cJSON_AddNumberToObject(recording, "duration", duration);
         cJSON_AddStringToObject(recording, "size", size_str);
-        cJSON_AddBoolToObject(recording, "has_detection", false); // Default to false as it's not in metadata
+        cJSON_AddBoolToObject(recording, "has_detection", recordings[i].detection_count > 0);
+        cJSON_AddNumberToObject(recording, "detection_count", recordings[i].detection_count);
+        cJSON_AddNumberToObject(recording, "max_confidence", recordings[i].max_confidence);
         
         cJSON_AddItemToArray(recordings_array, recording);
     }
@@ -427,7 +429,9 @@ void mg_handle_get_recording_worker(struct mg_connection *c, struct mg_http_mess
     cJSON_AddStringToObject(recording_obj, "end_time", end_time_str);
     cJSON_AddNumberToObject(recording_obj, "duration", duration);
     cJSON_AddStringToObject(recording_obj, "size", size_str);
-    cJSON_AddBoolToObject(recording_obj, "has_detection", false); // Default to false as it's not in metadata
+    cJSON_AddBoolToObject(recording_obj, "has_detection", recording.detection_count > 0);
+    cJSON_AddNumberToObject(recording_obj, "detection_count", recording.detection_count);
+    cJSON_AddNumberToObject(recording_obj, "max_confidence", recording.max_confidence);
     
     // Convert to string
     char *json_str = cJSON_PrintUnformatted(recording_obj);
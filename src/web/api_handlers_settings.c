@@ -13,6 +13,7 @@
 #include "core/config.h"
 #include "database/db_core.h"
 #include "database/db_streams.h"
+#include "storage/storage_manager.h"
 #include "video/stream_manager.h"
 #include "video/hls_streaming.h"
 #include "mongoose.h"
@@ -45,6 +46,7 @@ void mg_handle_get_settings(struct mg_connection *c, struct mg_http_message *hm)
     cJSON_AddStringToObject(settings, "storage_path_hls", g_config.storage_path_hls);
     cJSON_AddNumberToObject(settings, "max_storage_size", g_config.max_storage_size);
     cJSON_AddNumberToObject(settings, "retention_days", g_config.retention_days);
+    cJSON_AddNumberToObject(settings, "detection_retention_days", g_config.detection_retention_days);
     cJSON_AddBoolToObject(settings, "auto_delete_oldest", g_config.auto_delete_oldest);
     cJSON_AddNumberToObject(settings, "max_streams", g_config.max_streams);
     cJSON_AddStringToObject(settings, "log_file", g_config.log_file);
@@ -167,6 +169,16 @@ void mg_handle_post_settings(struct mg_connection *c, struct mg_http_message *hm
         g_config.retention_days = retention_days->valueint;
         settings_changed = true;
         log_info("Updated retention_days: %d", g_config.retention_days);
+        set_retention_days(g_config.retention_days);
+    }
+    
+    // Retention days for recordings without detections
+    cJSON *detection_retention_days = cJSON_GetObjectItem(settings, "detection_retention_days");
+    if (detection_retention_days && cJSON_IsNumber(detection_retention_days)) {
+        g_config.detection_retention_days = detection_retention_days->valueint;
+        settings_changed = true;
+        log_info("Updated detection_retention_days: %d", g_config.detection_retention_days);
+        set_detection_retention_days(g_config.detection_retention_days);
     }
     
     // Auto delete oldest
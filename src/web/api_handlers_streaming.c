@@ -3,15 +3,198 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 #include <sys/stat.h>
 #include "web/mongoose_adapter.h"
 #include "core/logger.h"
 #include "core/config.h"
 #include "web/http_server.h"
 #include "video/streams.h"
+#include "video/hls/hls_ll_writer.h"
+#include "video/hls/hls_memory_store.h"
 
+// Maximum number of LL-HLS requests waiting for a part at the same time
+#define MAX_PARKED_HLS_REQUESTS 64
+
+// Tag in c->data[0] of a connection holding a parked request. WebSocket
+// connections keep 'W' there and their client ID after it, so the two never mix.
+#define PARKED_HLS_TAG '\x01'
+
+// How long a blocking playlist reload or part request may wait
+#define HLS_BLOCKING_TIMEOUT_MS 6000
+
+/**
+ * LL-HLS request waiting for a part or segment to be published
+ *
+ * Requests are parked instead of blocking the event loop and re-dispatched
+ * from MG_EV_POLL. All access happens on the event loop thread.
+ */
+typedef struct {
+    unsigned long conn_id;
+    char stream_name[MAX_STREAM_NAME];
+    int64_t msn;
+    int part;
+    uint64_t deadline;
+    char *message;          // Copy of the raw request, re-parsed when resumed
+    size_t message_len;
+} parked_hls_request_t;
+
+static parked_hls_request_t parked_requests[MAX_PARKED_HLS_REQUESTS];
+
+static void serve_direct_hls_request(struct mg_connection *c, struct mg_http_message *hm, bool allow_block);
+
+/**
+ * Find the parked request of a connection
+ */
+static parked_hls_request_t *find_parked_request(const struct mg_connection *c) {
+    for (int i = 0; i < MAX_PARKED_HLS_REQUESTS; i++) {
+        if (parked_requests[i].message && parked_requests[i].conn_id == c->id) {
+            return &parked_requests[i];
+        }
+    }
+    return NULL;
+}
+
+static void free_parked_request(parked_hls_request_t *req) {
+    free(req->message);
+    memset(req, 0, sizeof(*req));
+}
+
+/**
+ * Park a request until the given part is published
+ *
+ * @return true if parked, false if the caller should answer immediately
+ */
+static bool park_request(struct mg_connection *c, struct mg_http_message *hm,
+                         const char *stream_name, int64_t msn, int part) {
+    for (int i = 0; i < MAX_PARKED_HLS_REQUESTS; i++) {
+        parked_hls_request_t *req = &parked_requests[i];
+        if (req->message) {
+            continue;
+        }
+
+        req->message = malloc(hm->message.len);
+        if (!req->message) {
+            return false;
+        }
+        memcpy(req->message, hm->message.buf, hm->message.len);
+        req->message_len = hm->message.len;
+        req->conn_id = c->id;
+        strncpy(req->stream_name, stream_name, MAX_STREAM_NAME - 1);
+        req->msn = msn;
+        req->part = part;
+        req->deadline = mg_millis() + HLS_BLOCKING_TIMEOUT_MS;
+
+        c->data[0] = PARKED_HLS_TAG;
+        log_debug("Parked LL-HLS request for stream %s until %lld.%d", stream_name, (long long)msn, part);
+        return true;
+    }
+
+    log_warn("Too many parked LL-HLS requests, answering immediately");
+    return false;
+}
+
+/**
+ * Check whether a connection holds a parked LL-HLS request
+ */
+bool mg_is_parked_hls_request(const struct mg_connection *c) {
+    return c->data[0] == PARKED_HLS_TAG;
+}
+
+/**
+ * Resume a parked LL-HLS request once its part is available or it timed out
+ *
+ * Called from MG_EV_POLL for connections for which mg_is_parked_hls_request() is true.
+ */
+void mg_handle_parked_hls_request(struct mg_connection *c) {
+    parked_hls_request_t *req = find_parked_request(c);
+    if (!req) {
+        c->data[0] = 0;
+        return;
+    }
+
+    int available = hls_ll_writer_is_available(req->stream_name, req->msn, req->part);
+    if (available == 0 && mg_millis() < req->deadline) {
+        return;
+    }
+
+    struct mg_http_message hm;
+    char *message = req->message;
+    size_t message_len = req->message_len;
+    req->message = NULL;
+    free_parked_request(req);
+    c->data[0] = 0;
+
+    if (mg_http_parse(message, message_len, &hm) > 0) {
+        serve_direct_hls_request(c, &hm, false);
+    } else {
+        mg_http_reply(c, 500, "", "{\"error\": \"Internal server error\"}\n");
+    }
+    free(message);
+}
+
+/**
+ * Drop the parked request of a closing connection
+ */
+void mg_release_parked_hls_request(struct mg_connection *c) {
+    parked_hls_request_t *req = find_parked_request(c);
+    if (req) {
+        free_parked_request(req);
+    }
+    c->data[0] = 0;
+}
+
+/**
+ * Build the extra response headers for an HLS file
+ */
+static void build_hls_headers(const char *file_name, bool blocking_reload, char *headers, size_t headers_size) {
+    // Determine content type based on file extension
+    const char *content_type_header = "Content-Type: application/octet-stream\r\n";
+    if (strstr(file_name, ".m3u8")) {
+        content_type_header = "Content-Type: application/vnd.apple.mpegurl\r\n";
+    } else if (strstr(file_name, ".ts")) {
+        content_type_header = "Content-Type: video/mp2t\r\n";
+    } else if (strstr(file_name, ".m4s")) {
+        content_type_header = "Content-Type: video/iso.segment\r\n";
+    } else if (strstr(file_name, "init.mp4")) {
+        content_type_header = "Content-Type: video/mp4\r\n";
+    }
+
+    // Use more mobile-friendly cache headers with longer cache times
+    // Different cache settings for different file types
+    const char* cache_control;
+    if (strstr(file_name, ".m3u8") && blocking_reload) {
+        // Blocking reload responses are only valid for this request
+        cache_control = "Cache-Control: no-cache\r\n";
+    } else if (strstr(file_name, ".m3u8")) {
+        // For playlist files, use a shorter cache time to ensure updates are seen
+        cache_control = "Cache-Control: max-age=2\r\n";
+    } else if (strstr(file_name, ".ts") || strstr(file_name, ".m4s")) {
+        // For media segments, use a longer cache time to improve mobile performance
+        cache_control = "Cache-Control: max-age=60\r\n";
+    } else if (strstr(file_name, "init.mp4")) {
+        // For initialization segments, use a longer cache time
+        cache_control = "Cache-Control: max-age=3600\r\n";
+    } else {
+        // Default cache time
+        cache_control = "Cache-Control: max-age=5\r\n";
+    }
+
+    snprintf(headers, headers_size,
+        "%s"
+        "%s"  // Dynamic cache control based on file type
+        "Connection: close\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "Access-Control-Allow-Methods: GET, OPTIONS\r\n"
+        "Access-Control-Allow-Headers: Origin, Content-Type, Accept, Authorization\r\n",
+        content_type_header, cache_control);
+}
 
 void mg_handle_direct_hls_request(struct mg_connection *c, struct mg_http_message *hm) {
+    serve_direct_hls_request(c, hm, true);
+}
+
+static void serve_direct_hls_request(struct mg_connection *c, struct mg_http_message *hm, bool allow_block) {
     if (!c || !hm) {
         log_error("Invalid parameters in mg_handle_direct_hls_request");
         return;
@@ -79,6 +262,57 @@ void mg_handle_direct_hls_request(struct mg_connection *c, struct mg_http_messag
         return;
     }
 
+    // Blocking playlist reload and part requests for low-latency streams
+    int64_t wait_msn = -1;
+    int wait_part = -1;
+    if (strcmp(file_name, "index.m3u8") == 0) {
+        char value[32];
+        if (mg_http_get_var(&hm->query, "_HLS_msn", value, sizeof(value)) > 0) {
+            wait_msn = strtoll(value, NULL, 10);
+            if (mg_http_get_var(&hm->query, "_HLS_part", value, sizeof(value)) > 0) {
+                wait_part = atoi(value);
+            }
+        }
+    } else {
+        long long part_msn;
+        int part_index;
+        if (sscanf(file_name, "segment_%lld.%d.m4s", &part_msn, &part_index) == 2) {
+            wait_msn = part_msn;
+            wait_part = part_index;
+        }
+    }
+
+    if (wait_msn >= 0 && allow_block) {
+        int available = hls_ll_writer_is_available(decoded_stream_name, wait_msn, wait_part);
+
+        // A playlist more than two segments ahead would only time out, reject it at once
+        if (available == HLS_LL_WRITER_TOO_FAR_AHEAD && strcmp(file_name, "index.m3u8") == 0) {
+            mg_http_reply(c, 400, "", "{\"error\": \"_HLS_msn is too far ahead of the playlist\"}\n");
+            return;
+        }
+
+        if (available == 0 && park_request(c, hm, decoded_stream_name, wait_msn, wait_part)) {
+            return;
+        }
+    }
+
+    // Streams kept in RAM are served straight from the segment store
+    if (hls_memory_store_has_stream(decoded_stream_name)) {
+        hls_memory_file_t *file = hls_memory_store_get(decoded_stream_name, file_name);
+        if (!file) {
+            mg_http_reply(c, 404, "", "{\"error\": \"HLS file not found or still being generated by FFmpeg\"}\n");
+            return;
+        }
+
+        char headers[512];
+        build_hls_headers(file_name, wait_msn >= 0, headers, sizeof(headers));
+
+        mg_printf(c, "HTTP/1.1 200 OK\r\n%sContent-Length: %lu\r\n\r\n", headers, (unsigned long)file->size);
+        mg_send(c, file->data, file->size);
+        hls_memory_store_release(file);
+        return;
+    }
+
     // Make local copies of the storage paths to avoid race conditions
     char storage_path[MAX_PATH_LENGTH] = {0};
     char storage_path_hls[MAX_PATH_LENGTH] = {0};
@@ -109,45 +343,8 @@ void mg_handle_direct_hls_request(struct mg_connection *c, struct mg_http_messag
     // Check if file exists
     struct stat st;
     if (stat(hls_file_path, &st) == 0 && S_ISREG(st.st_mode)) {
-        // Determine content type based on file extension
-        const char *content_type_header = "Content-Type: application/octet-stream\r\n";
-        if (strstr(file_name, ".m3u8")) {
-            content_type_header = "Content-Type: application/vnd.apple.mpegurl\r\n";
-        } else if (strstr(file_name, ".ts")) {
-            content_type_header = "Content-Type: video/mp2t\r\n";
-        } else if (strstr(file_name, ".m4s")) {
-            content_type_header = "Content-Type: video/iso.segment\r\n";
-        } else if (strstr(file_name, "init.mp4")) {
-            content_type_header = "Content-Type: video/mp4\r\n";
-        }
-
-        // Use more mobile-friendly cache headers with longer cache times
         char headers[512];
-
-        // Different cache settings for different file types
-        const char* cache_control;
-        if (strstr(file_name, ".m3u8")) {
-            // For playlist files, use a shorter cache time to ensure updates are seen
-            cache_control = "Cache-Control: max-age=2\r\n";
-        } else if (strstr(file_name, ".ts") || strstr(file_name, ".m4s")) {
-            // For media segments, use a longer cache time to improve mobile performance
-            cache_control = "Cache-Control: max-age=60\r\n";
-        } else if (strstr(file_name, "init.mp4")) {
-            // For initialization segments, use a longer cache time
-            cache_control = "Cache-Control: max-age=3600\r\n";
-        } else {
-            // Default cache time
-            cache_control = "Cache-Control: max-age=5\r\n";
-        }
-
-        snprintf(headers, sizeof(headers),
-            "%s"
-            "%s"  // Dynamic cache control based on file type
-            "Connection: close\r\n"
-            "Access-Control-Allow-Origin: *\r\n"
-            "Access-Control-Allow-Methods: GET, OPTIONS\r\n"
-            "Access-Control-Allow-Headers: Origin, Content-Type, Accept, Authorization\r\n",
-            content_type_header, cache_control);
+        build_hls_headers(file_name, wait_msn >= 0, headers, sizeof(headers));
 
         mg_http_serve_file(c, hm, hls_file_path, &(struct mg_http_serve_opts){
             .mime_types = "",
@@ -17,6 +17,20 @@
 #include "video/detection_stream.h"
 #include "database/database_manager.h"
 
+/**
+ * @brief Add the per-stream storage policy of a stream to its JSON object
+ */
+static void add_storage_policy_to_json(cJSON *stream_obj, const char *stream_name) {
+    stream_storage_policy_t policy;
+    if (get_stream_storage_policy(stream_name, &policy) != 0) {
+        memset(&policy, 0, sizeof(policy));
+    }
+
+    cJSON_AddNumberToObject(stream_obj, "retention_days", policy.retention_days);
+    cJSON_AddNumberToObject(stream_obj, "detection_retention_days", policy.detection_retention_days);
+    cJSON_AddNumberToObject(stream_obj, "max_storage_mb", (double)(policy.max_storage_bytes / (1024 * 1024)));
+}
+
 /**
  * @brief Direct handler for GET /api/streams
  */
@@ -78,6 +92,7 @@ void mg_handle_get_streams(struct mg_connection *c, struct mg_http_message *hm)
         cJSON_AddNumberToObject(stream_obj, "protocol", (int)db_streams[i].protocol);
         cJSON_AddBoolToObject(stream_obj, "record_audio", db_streams[i].record_audio);
         cJSON_AddBoolToObject(stream_obj, "isOnvif", db_streams[i].is_onvif);
+        add_storage_policy_to_json(stream_obj, db_streams[i].name);
         
         // Get stream status
         stream_handle_t stream = get_stream_by_name(db_streams[i].name);
@@ -199,6 +214,7 @@ void mg_handle_get_stream(struct mg_connection *c, struct mg_http_message *hm) {
     cJSON_AddNumberToObject(stream_obj, "protocol", (int)config.protocol);
     cJSON_AddBoolToObject(stream_obj, "record_audio", config.record_audio);
     cJSON_AddBoolToObject(stream_obj, "isOnvif", config.is_onvif);
+    add_storage_policy_to_json(stream_obj, config.name);
     
     // Get stream status
     stream_status_t stream_status = get_stream_status(stream);
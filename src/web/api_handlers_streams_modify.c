@@ -25,6 +25,39 @@
 #include "video/go2rtc/go2rtc_integration.h"
 #include "video/go2rtc/go2rtc_api.h"
 
+/**
+ * @brief Read per-stream storage policy fields from a stream JSON object
+ * 
+ * @param stream_json Stream JSON object
+ * @param policy Policy to update, pre-filled with the current values
+ * @return true if any policy field was present
+ */
+static bool parse_storage_policy_json(const cJSON *stream_json, stream_storage_policy_t *policy) {
+    bool found = false;
+
+    cJSON *retention_days = cJSON_GetObjectItem(stream_json, "retention_days");
+    if (retention_days && cJSON_IsNumber(retention_days)) {
+        policy->retention_days = retention_days->valueint > 0 ? retention_days->valueint : 0;
+        found = true;
+    }
+
+    cJSON *detection_retention_days = cJSON_GetObjectItem(stream_json, "detection_retention_days");
+    if (detection_retention_days && cJSON_IsNumber(detection_retention_days)) {
+        policy->detection_retention_days = detection_retention_days->valueint > 0 ?
+                                           detection_retention_days->valueint : 0;
+        found = true;
+    }
+
+    cJSON *max_storage_mb = cJSON_GetObjectItem(stream_json, "max_storage_mb");
+    if (max_storage_mb && cJSON_IsNumber(max_storage_mb)) {
+        policy->max_storage_bytes = max_storage_mb->valuedouble > 0 ?
+                                    (uint64_t)max_storage_mb->valuedouble * 1024 * 1024 : 0;
+        found = true;
+    }
+
+    return found;
+}
+
 /**
  * @brief Direct handler for POST /api/streams
  */
@@ -212,6 +245,10 @@ void mg_handle_post_stream(struct mg_connection *c, struct mg_http_message *hm)
     }
 
     // Clean up JSON
+    stream_storage_policy_t storage_policy;
+    memset(&storage_policy, 0, sizeof(storage_policy));
+    bool has_storage_policy = parse_storage_policy_json(stream_json, &storage_policy);
+
     cJSON_Delete(stream_json);
 
     // Check if stream already exists
@@ -230,6 +267,13 @@ void mg_handle_post_stream(struct mg_connection *c, struct mg_http_message *hm)
         return;
     }
 
+    if (has_storage_policy) {
+        strncpy(storage_policy.stream_name, config.name, sizeof(storage_policy.stream_name) - 1);
+        if (set_stream_storage_policy(&storage_policy) != 0) {
+            log_warn("Failed to save storage policy for stream %s", config.name);
+        }
+    }
+
     // Create stream in memory from the database configuration
     stream_handle_t stream = add_stream(&config);
     if (!stream) {
@@ -620,6 +664,11 @@ void mg_handle_put_stream(struct mg_connection *c, struct mg_http_message *hm) {
         }
     }
 
+    // Storage policy is kept in its own table and applied by the retention pass
+    stream_storage_policy_t storage_policy;
+    get_stream_storage_policy(config.name, &storage_policy);
+    bool has_storage_policy = parse_storage_policy_json(stream_json, &storage_policy);
+
     // Clean up JSON
     cJSON_Delete(stream_json);
 
@@ -640,6 +689,14 @@ void mg_handle_put_stream(struct mg_connection *c, struct mg_http_message *hm) {
         return;
     }
 
+    if (has_storage_policy) {
+        strncpy(storage_policy.stream_name, config.name, sizeof(storage_policy.stream_name) - 1);
+        storage_policy.stream_name[sizeof(storage_policy.stream_name) - 1] = '\0';
+        if (set_stream_storage_policy(&storage_policy) != 0) {
+            log_warn("Failed to save storage policy for stream %s", config.name);
+        }
+    }
+
     // Force update of stream configuration in memory to ensure it matches the database
     // This ensures the stream handle has the latest configuration
 
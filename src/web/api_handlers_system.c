@@ -7,8 +7,7 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <sys/utsname.h>
-#include <sys/sysinfo.h>
-#include <sys/statvfs.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
@@ -21,20 +20,20 @@
 #include "web/api_handlers.h"
 #include "web/mongoose_adapter.h"
 #include "web/api_handlers_system_ws.h"
+#include "web/mongoose_server_multithreading.h"
 #include "core/logger.h"
 #include "core/config.h"
 #include "core/version.h"
 #include "core/shutdown_coordinator.h"
+#include "core/system_metrics.h"
+#include "core/metrics.h"
 #include "video/stream_manager.h"
 #include "database/database_manager.h"
 #include "database/db_streams.h"
-#include "database/db_recordings.h"
+#include "database/db_writer.h"
 #include "storage/storage_manager_streams.h"
 #include "mongoose.h"
 
-// External function from api_handlers_system_go2rtc.c
-extern bool get_go2rtc_memory_usage(unsigned long long *memory_usage);
-
 // External declarations
 extern bool daemon_mode;
 
@@ -60,6 +59,18 @@ void mg_handle_get_system_info(struct mg_connection *c, struct mg_http_message *
     // Add version information
     cJSON_AddStringToObject(info, "version", LIGHTNVR_VERSION_STRING);
 
+    // CPU, memory, uptime and storage come from the metrics collector
+    system_metrics_snapshot_t *metrics = malloc(sizeof(system_metrics_snapshot_t));
+    if (!metrics) {
+        log_error("Failed to allocate memory for system metrics");
+        cJSON_Delete(info);
+        mg_send_json_error(c, 500, "Failed to allocate memory for system metrics");
+        return;
+    }
+    if (system_metrics_get_snapshot(metrics) != 0) {
+        log_debug("No system metrics sampled yet");
+    }
+
     // Get system information
     struct utsname system_info;
     if (uname(&system_info) == 0) {
@@ -67,65 +78,23 @@ void mg_handle_get_system_info(struct mg_connection *c, struct mg_http_message *
         cJSON *cpu = cJSON_CreateObject();
         if (cpu) {
             cJSON_AddStringToObject(cpu, "model", system_info.machine);
-
-            // Get CPU cores
-            int cores = sysconf(_SC_NPROCESSORS_ONLN);
-            cJSON_AddNumberToObject(cpu, "cores", cores);
-
-            // Calculate CPU usage (simplified)
-            double cpu_usage = 0.0;
-            FILE *fp = fopen("/proc/stat", "r");
-            if (fp) {
-                unsigned long user, nice, system, idle, iowait, irq, softirq;
-                if (fscanf(fp, "cpu %lu %lu %lu %lu %lu %lu %lu",
-                          &user, &nice, &system, &idle, &iowait, &irq, &softirq) == 7) {
-                    unsigned long total = user + nice + system + idle + iowait + irq + softirq;
-                    unsigned long active = user + nice + system + irq + softirq;
-                    cpu_usage = (double)active / (double)total * 100.0;
-                }
-                fclose(fp);
-            }
-            cJSON_AddNumberToObject(cpu, "usage", cpu_usage);
+            cJSON_AddNumberToObject(cpu, "cores", metrics->cpu_cores > 0 ? metrics->cpu_cores : sysconf(_SC_NPROCESSORS_ONLN));
+            cJSON_AddNumberToObject(cpu, "usage", metrics->cpu_usage);
+            cJSON_AddNumberToObject(cpu, "processUsage", metrics->process_cpu_usage);
 
             // Add CPU object to info
             cJSON_AddItemToObject(info, "cpu", cpu);
         }
     }
 
-    // Get system-wide memory information first
-    struct sysinfo sys_info;
-    unsigned long long system_total = 0;
-    unsigned long long system_free = 0;
-    unsigned long long system_used = 0;
-
-    if (sysinfo(&sys_info) == 0) {
-        // Calculate memory values in bytes
-        system_total = sys_info.totalram * sys_info.mem_unit;
-        system_free = sys_info.freeram * sys_info.mem_unit;
-        system_used = system_total - system_free;
-    }
+    unsigned long long system_total = metrics->memory_total;
+    unsigned long long system_free = metrics->memory_free;
+    unsigned long long system_used = system_total > system_free ? system_total - system_free : 0;
 
     // Get memory information for the LightNVR process
     cJSON *memory = cJSON_CreateObject();
     if (memory) {
-        // Get process memory usage using /proc/self/status
-        FILE *fp = fopen("/proc/self/status", "r");
-        unsigned long vm_rss = 0;
-
-        if (fp) {
-            char line[256];
-            while (fgets(line, sizeof(line), fp)) {
-                if (strncmp(line, "VmRSS:", 6) == 0) {
-                    // VmRSS is in kB - actual physical memory used
-                    sscanf(line + 6, "%lu", &vm_rss);
-                    break;
-                }
-            }
-            fclose(fp);
-        }
-
-        // Convert kB to bytes
-        unsigned long long used = vm_rss * 1024;
+        unsigned long long used = metrics->process_rss;
 
         // Use the system total memory as the total for LightNVR as well
         // This makes it simpler to understand the memory usage
@@ -145,14 +114,7 @@ void mg_handle_get_system_info(struct mg_connection *c, struct mg_http_message *
     // Get memory information for the go2rtc process
     cJSON *go2rtc_memory = cJSON_CreateObject();
     if (go2rtc_memory) {
-        unsigned long long go2rtc_used = 0;
-
-        // Try to get go2rtc memory usage
-        if (get_go2rtc_memory_usage(&go2rtc_used)) {
-            log_debug("go2rtc memory usage: %llu bytes", go2rtc_used);
-        } else {
-            log_warn("Failed to get go2rtc memory usage, using 0");
-        }
+        unsigned long long go2rtc_used = metrics->go2rtc_rss;
 
         // Use the system total memory as the total for go2rtc as well
         unsigned long long total = system_total;
@@ -179,78 +141,23 @@ void mg_handle_get_system_info(struct mg_connection *c, struct mg_http_message *
         cJSON_AddItemToObject(info, "systemMemory", system_memory);
     }
 
-    // Get uptime of the LightNVR process
-    // Use /proc/self/stat to get process start time
-    FILE *stat_file = fopen("/proc/self/stat", "r");
-    if (stat_file) {
-        // Fields in /proc/self/stat
-        char comm[256];
-        char state;
-        int ppid, pgrp, session, tty_nr, tpgid;
-        unsigned long flags, minflt, cminflt, majflt, cmajflt, utime, stime;
-        long cutime, cstime, priority, nice, num_threads, itrealvalue;
-        unsigned long long starttime;
-
-        // Read the stat file
-        fscanf(stat_file, "%*d %s %c %d %d %d %d %d %lu %lu %lu %lu %lu %lu %lu %ld %ld %ld %ld %ld %ld %llu",
-               comm, &state, &ppid, &pgrp, &session, &tty_nr, &tpgid,
-               &flags, &minflt, &cminflt, &majflt, &cmajflt, &utime, &stime,
-               &cutime, &cstime, &priority, &nice, &num_threads, &itrealvalue, &starttime);
-        fclose(stat_file);
-
-        // Get system uptime
-        FILE *uptime_file = fopen("/proc/uptime", "r");
-        double system_uptime = 0;
-        if (uptime_file) {
-            fscanf(uptime_file, "%lf", &system_uptime);
-            fclose(uptime_file);
-        }
-
-        // Calculate process uptime in seconds
-        // starttime is in clock ticks since system boot
-        // Convert to seconds by dividing by sysconf(_SC_CLK_TCK)
-        long clock_ticks = sysconf(_SC_CLK_TCK);
-        double process_uptime = system_uptime - ((double)starttime / clock_ticks);
-
-        // Add process uptime to info
-        cJSON_AddNumberToObject(info, "uptime", process_uptime);
-    } else {
-        // Fallback to system uptime if process uptime can't be determined
-        struct sysinfo sys_info;
-        if (sysinfo(&sys_info) == 0) {
-            cJSON_AddNumberToObject(info, "uptime", sys_info.uptime);
-        }
-    }
+    // Uptime of the LightNVR process
+    cJSON_AddNumberToObject(info, "uptime", metrics->process_uptime);
 
     // Get disk information for the configured storage path
-    struct statvfs disk_info;
-    if (statvfs(g_config.storage_path, &disk_info) == 0) {
+    if (metrics->storage_valid) {
         // Create disk object for LightNVR storage
         cJSON *disk = cJSON_CreateObject();
         if (disk) {
-            // Calculate disk values in bytes for consistency
-            unsigned long long total = disk_info.f_blocks * disk_info.f_frsize;
-            unsigned long long free = disk_info.f_bfree * disk_info.f_frsize;
-
-            // Get actual usage of the storage directory
-            unsigned long long used = 0;
-            char command[512];
-            snprintf(command, sizeof(command), "du -sb %s 2>/dev/null | cut -f1", g_config.storage_path);
-            FILE *fp = popen(command, "r");
-            if (fp) {
-                if (fscanf(fp, "%llu", &used) != 1) {
-                    // If du command fails, fall back to statvfs calculation
-                    used = (disk_info.f_blocks - disk_info.f_bfree) * disk_info.f_frsize;
-                }
-                pclose(fp);
-            } else {
-                // Fallback if popen fails
-                used = (disk_info.f_blocks - disk_info.f_bfree) * disk_info.f_frsize;
+            // Usage of the storage directory is the size of the recordings in it
+            unsigned long long used = metrics->recording_bytes;
+            if (used == 0 && metrics->storage_total > metrics->storage_free) {
+                used = metrics->storage_total - metrics->storage_free;
             }
 
-            cJSON_AddNumberToObject(disk, "total", total);
+            cJSON_AddNumberToObject(disk, "total", metrics->storage_total);
             cJSON_AddNumberToObject(disk, "used", used);
-            cJSON_AddNumberToObject(disk, "free", free);
+            cJSON_AddNumberToObject(disk, "free", metrics->storage_free);
 
             // Add disk object to info
             cJSON_AddItemToObject(info, "disk", disk);
@@ -259,17 +166,12 @@ void mg_handle_get_system_info(struct mg_connection *c, struct mg_http_message *
         // Create system-wide disk object
         cJSON *system_disk = cJSON_CreateObject();
         if (system_disk) {
-            // Get system-wide disk information
-            struct statvfs root_disk_info;
-            if (statvfs("/", &root_disk_info) == 0) {
-                unsigned long long total = root_disk_info.f_blocks * root_disk_info.f_frsize;
-                unsigned long long free = root_disk_info.f_bfree * root_disk_info.f_frsize;
-                unsigned long long used = total - free;
-
-                cJSON_AddNumberToObject(system_disk, "total", total);
-                cJSON_AddNumberToObject(system_disk, "used", used);
-                cJSON_AddNumberToObject(system_disk, "free", free);
-            }
+            unsigned long long total = metrics->root_total;
+            unsigned long long free = metrics->root_free;
+
+            cJSON_AddNumberToObject(system_disk, "total", total);
+            cJSON_AddNumberToObject(system_disk, "used", total > free ? total - free : 0);
+            cJSON_AddNumberToObject(system_disk, "free", free);
 
             // Add system disk object to info
             cJSON_AddItemToObject(info, "systemDisk", system_disk);
@@ -450,82 +352,31 @@ void mg_handle_get_system_info(struct mg_connection *c, struct mg_http_message *
     // Create recordings object
     cJSON *recordings = cJSON_CreateObject();
     if (recordings) {
-        // Get recordings count from database using the db_recordings function
-        int recording_count = 0;
-
-        // Use the get_recording_count function from db_recordings.h
-        // Parameters: start_time, end_time, stream_name, has_detection
-        // Pass 0 for start_time and end_time to get all recordings
-        // Pass NULL for stream_name to get recordings from all streams
-        // Pass 0 for has_detection to get all recordings regardless of detection status
-        recording_count = get_recording_count(0, 0, NULL, 0);
-        if (recording_count < 0) {
-            recording_count = 0; // Reset if query fails
-            log_error("Failed to get recording count from database");
-        }
-
-        // Get recordings size from storage directory
-        unsigned long long recording_size = 0;
-
-        // Check if we have a recordings directory
-        char recordings_dir[512];
-        snprintf(recordings_dir, sizeof(recordings_dir), "%s/", g_config.storage_path);
-
-        struct stat st;
-        if (stat(recordings_dir, &st) == 0 && S_ISDIR(st.st_mode)) {
-            // Get size of recordings directory using du command
-            char command[512];
-            snprintf(command, sizeof(command), "du -sb %s 2>/dev/null | cut -f1", recordings_dir);
-            log_debug("Executing command: %s", command);
-
-            FILE *fp = popen(command, "r");
-            if (fp) {
-                if (fscanf(fp, "%llu", &recording_size) != 1) {
-                    log_error("Failed to parse du command output");
-                    recording_size = 0;
-                } else {
-                    log_debug("Recordings size from du command: %llu bytes", recording_size);
-                }
-                pclose(fp);
-            } else {
-                log_error("Failed to execute du command");
-            }
-
-            // If du command failed, try to get size using stat
-            if (recording_size == 0) {
-                log_debug("Trying to get recordings size using stat");
-
-                // Use a different approach - recursively list all files and sum their sizes
-                char find_command[512];
-                snprintf(find_command, sizeof(find_command),
-                        "find %s -type f -name \"*.mp4\" -exec stat -c %%s {} \\; | awk '{sum+=$1} END {print sum}'",
-                        recordings_dir);
-                log_debug("Executing command: %s", find_command);
-
-                FILE *find_fp = popen(find_command, "r");
-                if (find_fp) {
-                    if (fscanf(find_fp, "%llu", &recording_size) != 1) {
-                        log_error("Failed to parse find command output");
-                        recording_size = 0;
-                    } else {
-                        log_debug("Recordings size from find command: %llu bytes", recording_size);
-                    }
-                    pclose(find_fp);
-                } else {
-                    log_error("Failed to execute find command");
-                }
-            }
-        }
-
-        cJSON_AddNumberToObject(recordings, "count", recording_count);
-        cJSON_AddNumberToObject(recordings, "size", recording_size);
+        cJSON_AddNumberToObject(recordings, "count", metrics->recording_count);
+        cJSON_AddNumberToObject(recordings, "size", metrics->recording_bytes);
 
         // Add recordings object to info
         cJSON_AddItemToObject(info, "recordings", recordings);
     }
 
     // Add stream storage usage information
-    add_stream_storage_usage_to_json(info);
+    cJSON *stream_storage = cJSON_CreateArray();
+    if (stream_storage) {
+        for (int i = 0; i < metrics->stream_count; i++) {
+            cJSON *stream_obj = cJSON_CreateObject();
+            if (stream_obj) {
+                cJSON_AddStringToObject(stream_obj, "name", metrics->streams[i].name);
+                cJSON_AddNumberToObject(stream_obj, "size", metrics->streams[i].size_bytes);
+                cJSON_AddNumberToObject(stream_obj, "count", metrics->streams[i].recording_count);
+                cJSON_AddNumberToObject(stream_obj, "quota", metrics->streams[i].quota_bytes);
+
+                cJSON_AddItemToArray(stream_storage, stream_obj);
+            }
+        }
+        cJSON_AddItemToObject(info, "streamStorage", stream_storage);
+    }
+
+    free(metrics);
 
     // Convert to string
     char *json_str = cJSON_PrintUnformatted(info);
@@ -883,3 +734,160 @@ void mg_handle_get_system_status(struct mg_connection *c, struct mg_http_message
 
     log_info("Successfully handled GET /api/system/status request");
 }
+
+/**
+ * @brief Direct handler for GET /api/system/workers
+ */
+void mg_handle_get_system_workers(struct mg_connection *c, struct mg_http_message *hm) {
+    (void)hm;
+
+    mg_worker_pool_stats_t stats;
+    mg_worker_pool_get_stats(&stats);
+
+    cJSON *workers = cJSON_CreateObject();
+    if (!workers) {
+        log_error("Failed to create workers JSON object");
+        mg_send_json_error(c, 500, "Failed to create workers JSON");
+        return;
+    }
+
+    cJSON_AddNumberToObject(workers, "workers", stats.workers);
+    cJSON_AddNumberToObject(workers, "busyWorkers", stats.busy_workers);
+    cJSON_AddNumberToObject(workers, "queueCapacity", stats.queue_capacity);
+
+    cJSON *classes = cJSON_CreateObject();
+    for (int i = 0; i < MG_PRIORITY_COUNT; i++) {
+        cJSON *cls = cJSON_CreateObject();
+        cJSON_AddNumberToObject(cls, "queueDepth", stats.queue_depth[i]);
+        cJSON_AddNumberToObject(cls, "submitted", (double)stats.submitted[i]);
+        cJSON_AddNumberToObject(cls, "rejected", (double)stats.rejected[i]);
+        cJSON_AddNumberToObject(cls, "completed", (double)stats.completed[i]);
+        cJSON_AddNumberToObject(cls, "avgWaitMs", stats.completed[i] > 0 ?
+                                (double)stats.total_wait_us[i] / 1000.0 / (double)stats.completed[i] : 0.0);
+        cJSON_AddNumberToObject(cls, "maxWaitMs", (double)stats.max_wait_us[i] / 1000.0);
+        cJSON_AddNumberToObject(cls, "avgRunMs", stats.completed[i] > 0 ?
+                                (double)stats.total_run_us[i] / 1000.0 / (double)stats.completed[i] : 0.0);
+        cJSON_AddItemToObject(classes, mg_priority_name((mg_request_priority_t)i), cls);
+    }
+    cJSON_AddItemToObject(workers, "classes", classes);
+
+    char *json_str = cJSON_PrintUnformatted(workers);
+    cJSON_Delete(workers);
+    if (!json_str) {
+        log_error("Failed to convert workers JSON to string");
+        mg_send_json_error(c, 500, "Failed to convert workers JSON to string");
+        return;
+    }
+
+    mg_send_json_response(c, 200, json_str);
+    free(json_str);
+}
+
+/**
+ * Append an unlabeled sample with its HELP and TYPE lines
+ */
+static int metrics_append_value(metrics_buffer_t *buf, const char *name, const char *help,
+                                const char *type, double value) {
+    if (metrics_buffer_family(buf, name, help, type) != 0) {
+        return -1;
+    }
+    return metrics_buffer_printf(buf, "%s %.17g\n", name, value);
+}
+
+/**
+ * Append the values that are read when scraped rather than updated in place
+ */
+static int metrics_append_scrape_values(metrics_buffer_t *buf) {
+    int rc = 0;
+
+    mg_worker_pool_stats_t stats;
+    mg_worker_pool_get_stats(&stats);
+    rc |= metrics_append_value(buf, "lightnvr_http_workers", "API worker threads", "gauge", stats.workers);
+    rc |= metrics_append_value(buf, "lightnvr_http_busy_workers", "API workers running a handler", "gauge",
+                               stats.busy_workers);
+    rc |= metrics_buffer_family(buf, "lightnvr_http_queue_depth", "API requests waiting for a worker", "gauge");
+    for (int i = 0; i < MG_PRIORITY_COUNT; i++) {
+        rc |= metrics_buffer_printf(buf, "lightnvr_http_queue_depth{priority=\"%s\"} %d\n",
+                                    mg_priority_name((mg_request_priority_t)i), stats.queue_depth[i]);
+    }
+    rc |= metrics_buffer_family(buf, "lightnvr_http_rejected_total", "API requests turned away with 503",
+                                "counter");
+    for (int i = 0; i < MG_PRIORITY_COUNT; i++) {
+        rc |= metrics_buffer_printf(buf, "lightnvr_http_rejected_total{priority=\"%s\"} %llu\n",
+                                    mg_priority_name((mg_request_priority_t)i),
+                                    (unsigned long long)stats.rejected[i]);
+    }
+
+    uint64_t commits = 0;
+    uint64_t writes = 0;
+    int queued = 0;
+    db_writer_get_stats(&commits, &writes, &queued);
+    rc |= metrics_append_value(buf, "lightnvr_db_commits_total", "Write transactions committed", "counter",
+                               (double)commits);
+    rc |= metrics_append_value(buf, "lightnvr_db_writes_total", "Writes committed", "counter", (double)writes);
+    rc |= metrics_append_value(buf, "lightnvr_db_write_queue_depth", "Writes waiting for the writer thread",
+                               "gauge", queued);
+
+    rc |= metrics_append_value(buf, "lightnvr_log_dropped_total", "Log messages dropped by the async logger",
+                               "counter", (double)get_log_dropped_count());
+
+    system_metrics_snapshot_t *snap = malloc(sizeof(system_metrics_snapshot_t));
+    if (!snap) {
+        return -1;
+    }
+    if (system_metrics_get_snapshot(snap) == 0) {
+        rc |= metrics_append_value(buf, "lightnvr_cpu_usage_percent", "System CPU usage", "gauge",
+                                   snap->cpu_usage);
+        rc |= metrics_append_value(buf, "lightnvr_process_cpu_percent", "LightNVR share of one core", "gauge",
+                                   snap->process_cpu_usage);
+        rc |= metrics_append_value(buf, "lightnvr_process_resident_bytes", "LightNVR resident memory", "gauge",
+                                   (double)snap->process_rss);
+        rc |= metrics_append_value(buf, "lightnvr_go2rtc_resident_bytes", "go2rtc resident memory", "gauge",
+                                   (double)snap->go2rtc_rss);
+        rc |= metrics_append_value(buf, "lightnvr_memory_total_bytes", "System memory", "gauge",
+                                   (double)snap->memory_total);
+        rc |= metrics_append_value(buf, "lightnvr_memory_free_bytes", "Free system memory", "gauge",
+                                   (double)snap->memory_free);
+        rc |= metrics_append_value(buf, "lightnvr_uptime_seconds", "Time since LightNVR started", "gauge",
+                                   snap->process_uptime);
+        if (snap->storage_valid) {
+            rc |= metrics_append_value(buf, "lightnvr_storage_total_bytes", "Size of the storage filesystem",
+                                       "gauge", (double)snap->storage_total);
+            rc |= metrics_append_value(buf, "lightnvr_storage_free_bytes", "Free space on the storage filesystem",
+                                       "gauge", (double)snap->storage_free);
+        }
+        rc |= metrics_append_value(buf, "lightnvr_recordings", "Number of recordings", "gauge",
+                                   (double)snap->recording_count);
+
+        rc |= metrics_buffer_family(buf, "lightnvr_recording_bytes", "Bytes of recordings per stream", "gauge");
+        for (int i = 0; i < snap->stream_count; i++) {
+            char labels[128] = "";
+            metrics_label(labels, sizeof(labels), "stream", snap->streams[i].name);
+            rc |= metrics_buffer_printf(buf, "lightnvr_recording_bytes{%s} %llu\n", labels,
+                                        (unsigned long long)snap->streams[i].size_bytes);
+        }
+    }
+    free(snap);
+
+    return rc != 0 ? -1 : 0;
+}
+
+/**
+ * @brief Direct handler for GET /metrics
+ */
+void mg_handle_get_metrics(struct mg_connection *c, struct mg_http_message *hm) {
+    (void)hm;
+
+    metrics_buffer_t buf = {0};
+    if (metrics_render(&buf) != 0 || metrics_append_scrape_values(&buf) != 0) {
+        log_error("Failed to render metrics");
+        metrics_buffer_free(&buf);
+        mg_http_reply(c, 500, "Content-Type: text/plain\r\n", "Failed to render metrics\n");
+        return;
+    }
+
+    mg_http_reply(c, 200, "Content-Type: text/plain; version=0.0.4\r\n"
+                          "Cache-Control: no-cache, no-store, must-revalidate\r\n",
+                  "%.*s", (int)buf.len, buf.data);
+    metrics_buffer_free(&buf);
+}
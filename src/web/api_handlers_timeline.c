@@ -9,7 +9,7 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <time.h>
-#include <pthread.h>
+#include <math.h>
 
 #include "web/api_handlers_timeline.h"
 #include "web/api_handlers.h"
@@ -19,20 +19,31 @@
 #include "mongoose.h"
 #include "database/database_manager.h"
 #include "database/db_recordings.h"
+#include "database/db_timeline_rollups.h"
+#include "video/mp4_fragment_index.h"
+#include "web/timeline_manifest_cache.h"
 
 // Forward declarations for Mongoose API handlers
 void mg_handle_get_timeline_segments(struct mg_connection *c, struct mg_http_message *hm);
 void mg_handle_timeline_manifest(struct mg_connection *c, struct mg_http_message *hm);
 void mg_handle_timeline_playback(struct mg_connection *c, struct mg_http_message *hm);
+void mg_handle_get_timeline_heatmap(struct mg_connection *c, struct mg_http_message *hm);
 
 // Maximum number of segments to return in a single request
 #define MAX_TIMELINE_SEGMENTS 1000
 
+// Maximum number of heatmap buckets, and of label counts across them, in a single request
+#define MAX_HEATMAP_BUCKETS 1440
+#define MAX_HEATMAP_LABELS (MAX_HEATMAP_BUCKETS * 8)
+
 // Maximum number of segments in a manifest
 #define MAX_MANIFEST_SEGMENTS 100
 
-// Mutex for manifest creation
-static pthread_mutex_t manifest_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Target duration of a manifest entry, made of whole fragments
+#define TIMELINE_MANIFEST_PART_DURATION 6.0
+
+// Granularity of the default manifest range, so requests without bounds share cache entries
+#define TIMELINE_MANIFEST_DEFAULT_RANGE_STEP 60
 
 /**
  * Get timeline segments for a specific stream and time range
@@ -69,7 +80,7 @@ int get_timeline_segments(const char *stream_name, time_t start_time, time_t end
         segments[i].start_time = recordings[i].start_time;
         segments[i].end_time = recordings[i].end_time;
         segments[i].size_bytes = recordings[i].size_bytes;
-        segments[i].has_detection = false; // Default to false, could be updated with detection info
+        segments[i].has_detection = recordings[i].detection_count > 0;
     }
     
     // Free recordings
@@ -352,55 +363,165 @@ void mg_handle_get_timeline_segments(struct mg_connection *c, struct mg_http_mes
     log_info("Successfully handled GET /api/timeline/segments request");
 }
 
+/**
+ * Parse a heatmap time parameter, either Unix seconds or an ISO 8601 local time
+ */
+static time_t parse_heatmap_time(const char *value, time_t fallback) {
+    if (value[0] == '\0') {
+        return fallback;
+    }
+
+    char *end = NULL;
+    long long seconds = strtoll(value, &end, 10);
+    if (end != value && *end == '\0') {
+        return (time_t)seconds;
+    }
+
+    struct tm tm = {0};
+    if (strptime(value, "%Y-%m-%dT%H:%M:%S", &tm) != NULL ||
+        strptime(value, "%Y-%m-%d", &tm) != NULL) {
+        tm.tm_isdst = -1;
+        return mktime(&tm);
+    }
+
+    log_error("Failed to parse heatmap time: %s", value);
+    return fallback;
+}
 
 /**
- * Create a playback manifest for a sequence of recordings
+ * @brief Handler for GET /api/timeline/heatmap
  */
-int create_timeline_manifest(const timeline_segment_t *segments, int segment_count,
-                            time_t start_time, char *manifest_path) {
-    if (!segments || segment_count <= 0 || !manifest_path) {
-        log_error("Invalid parameters for create_timeline_manifest");
-        return -1;
+void mg_handle_get_timeline_heatmap(struct mg_connection *c, struct mg_http_message *hm) {
+    char stream_name[MAX_STREAM_NAME] = {0};
+    char from_str[64] = {0};
+    char to_str[64] = {0};
+    char resolution_str[16] = {0};
+
+    mg_http_get_var(&hm->query, "stream", stream_name, sizeof(stream_name));
+    mg_http_get_var(&hm->query, "from", from_str, sizeof(from_str));
+    mg_http_get_var(&hm->query, "to", to_str, sizeof(to_str));
+    mg_http_get_var(&hm->query, "resolution", resolution_str, sizeof(resolution_str));
+
+    // Default to the last 24 hours
+    time_t now = time(NULL);
+    time_t end_time = parse_heatmap_time(to_str, now);
+    time_t start_time = parse_heatmap_time(from_str, end_time - 24 * 60 * 60);
+    if (end_time <= start_time) {
+        mg_send_json_error(c, 400, "Invalid time range");
+        return;
     }
-    
-    // Limit the number of segments
-    if (segment_count > MAX_MANIFEST_SEGMENTS) {
-        log_warn("Limiting manifest to %d segments (requested %d)", MAX_MANIFEST_SEGMENTS, segment_count);
-        segment_count = MAX_MANIFEST_SEGMENTS;
+
+    // Without a resolution, use the finest one that fits
+    int resolution = 0;
+    if (resolution_str[0] != '\0' && strcmp(resolution_str, "auto") != 0) {
+        resolution = timeline_rollup_parse_resolution(resolution_str);
+        if (resolution < 0) {
+            mg_send_json_error(c, 400, "Invalid resolution, expected 1m, 15m, 1h or 1d");
+            return;
+        }
     }
-    
-    // Create a temporary directory for the manifest
-    char temp_dir[MAX_PATH_LENGTH];
-    snprintf(temp_dir, sizeof(temp_dir), "%s/timeline_manifests", g_config.storage_path);
-    
-    // Create directory if it doesn't exist
-    struct stat st = {0};
-    if (stat(temp_dir, &st) == -1) {
-        mkdir(temp_dir, 0755);
+
+    // Switch to a coarser resolution rather than return too many buckets
+    while (resolution < TIMELINE_ROLLUP_RESOLUTIONS - 1 &&
+           (end_time - start_time) / timeline_rollup_resolution(resolution) > MAX_HEATMAP_BUCKETS) {
+        resolution++;
     }
-    
-    // Generate a unique manifest filename
-    char manifest_filename[MAX_PATH_LENGTH];
-    snprintf(manifest_filename, sizeof(manifest_filename), "%s/manifest_%ld_%s_%ld.m3u8",
-            temp_dir, (long)time(NULL), segments[0].stream_name, (long)start_time);
-    
-    // Lock mutex for manifest creation
-    pthread_mutex_lock(&manifest_mutex);
-    
-    // Create manifest file
-    FILE *manifest = fopen(manifest_filename, "w");
-    if (!manifest) {
-        log_error("Failed to create manifest file: %s", manifest_filename);
-        pthread_mutex_unlock(&manifest_mutex);
-        return -1;
+
+    const char *stream = stream_name[0] != '\0' ? stream_name : NULL;
+
+    timeline_heatmap_bucket_t *buckets = malloc(MAX_HEATMAP_BUCKETS * sizeof(timeline_heatmap_bucket_t));
+    timeline_heatmap_label_t *labels = malloc(MAX_HEATMAP_LABELS * sizeof(timeline_heatmap_label_t));
+    if (!buckets || !labels) {
+        log_error("Failed to allocate memory for timeline heatmap");
+        free(buckets);
+        free(labels);
+        mg_send_json_error(c, 500, "Failed to allocate memory for timeline heatmap");
+        return;
     }
-    
-    // Write manifest header
-    fprintf(manifest, "#EXTM3U\n");
-    fprintf(manifest, "#EXT-X-VERSION:3\n");
-    fprintf(manifest, "#EXT-X-MEDIA-SEQUENCE:0\n");
-    fprintf(manifest, "#EXT-X-ALLOW-CACHE:YES\n");
-    
+
+    int bucket_count = get_timeline_heatmap(stream, start_time, end_time, resolution,
+                                            buckets, MAX_HEATMAP_BUCKETS);
+    int label_count = get_timeline_heatmap_labels(stream, start_time, end_time, resolution,
+                                                  labels, MAX_HEATMAP_LABELS);
+    if (bucket_count < 0 || label_count < 0) {
+        free(buckets);
+        free(labels);
+        mg_send_json_error(c, 500, "Failed to get timeline heatmap");
+        return;
+    }
+
+    cJSON *response = cJSON_CreateObject();
+    cJSON *buckets_array = cJSON_CreateArray();
+    if (!response || !buckets_array) {
+        log_error("Failed to create heatmap JSON");
+        cJSON_Delete(response);
+        cJSON_Delete(buckets_array);
+        free(buckets);
+        free(labels);
+        mg_send_json_error(c, 500, "Failed to create response JSON");
+        return;
+    }
+
+    if (stream) {
+        cJSON_AddStringToObject(response, "stream", stream);
+    }
+    cJSON_AddNumberToObject(response, "from", (double)start_time);
+    cJSON_AddNumberToObject(response, "to", (double)end_time);
+    cJSON_AddNumberToObject(response, "resolution", timeline_rollup_resolution(resolution));
+    cJSON_AddItemToObject(response, "buckets", buckets_array);
+
+    // Both lists are ordered by bucket start time
+    int next_label = 0;
+    for (int i = 0; i < bucket_count; i++) {
+        cJSON *bucket = cJSON_CreateObject();
+        if (!bucket) {
+            break;
+        }
+
+        cJSON_AddNumberToObject(bucket, "start", (double)buckets[i].start);
+        cJSON_AddNumberToObject(bucket, "coverage", buckets[i].coverage);
+        cJSON_AddNumberToObject(bucket, "motion", buckets[i].motion_count);
+        cJSON_AddNumberToObject(bucket, "detections", buckets[i].detection_count);
+
+        cJSON *bucket_labels = cJSON_CreateObject();
+        while (next_label < label_count && labels[next_label].start < buckets[i].start) {
+            next_label++;
+        }
+        while (next_label < label_count && labels[next_label].start == buckets[i].start) {
+            if (bucket_labels) {
+                cJSON_AddNumberToObject(bucket_labels, labels[next_label].label, labels[next_label].count);
+            }
+            next_label++;
+        }
+        if (bucket_labels) {
+            cJSON_AddItemToObject(bucket, "labels", bucket_labels);
+        }
+
+        cJSON_AddItemToArray(buckets_array, bucket);
+    }
+
+    free(buckets);
+    free(labels);
+
+    char *json_str = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+    if (!json_str) {
+        log_error("Failed to convert response JSON to string");
+        mg_send_json_error(c, 500, "Failed to convert response JSON to string");
+        return;
+    }
+
+    mg_send_json_response(c, 200, json_str);
+    free(json_str);
+}
+
+
+/**
+ * Write a manifest that plays the whole timeline as one entry, for recordings
+ * that cannot be split into byte ranges
+ */
+static void write_whole_timeline_manifest(FILE *manifest, const timeline_segment_t *segments,
+                                          int segment_count, time_t start_time) {
     // Find the maximum segment duration for EXT-X-TARGETDURATION
     double max_duration = 0;
     for (int i = 0; i < segment_count; i++) {
@@ -409,55 +530,186 @@ int create_timeline_manifest(const timeline_segment_t *segments, int segment_cou
             max_duration = duration;
         }
     }
+
+    fprintf(manifest, "#EXTM3U\n");
+    fprintf(manifest, "#EXT-X-VERSION:3\n");
+    fprintf(manifest, "#EXT-X-MEDIA-SEQUENCE:0\n");
+    fprintf(manifest, "#EXT-X-ALLOW-CACHE:YES\n");
     // Round up to the nearest integer and add a small buffer
-    int target_duration = (int)max_duration + 1;
-    fprintf(manifest, "#EXT-X-TARGETDURATION:%d\n", target_duration);
-    
-    // Find the segment that contains the start time
-    int start_segment_index = -1;
+    fprintf(manifest, "#EXT-X-TARGETDURATION:%d\n", (int)max_duration + 1);
+
+    // Create a single segment for the entire timeline
+    // This simplifies playback and avoids issues with segment transitions
+    fprintf(manifest, "#EXTINF:%.6f,\n", max_duration);
+    fprintf(manifest, "/api/timeline/play?stream=%s&start=%ld\n",
+            segments[0].stream_name, (long)start_time);
+    fprintf(manifest, "#EXT-X-ENDLIST\n");
+}
+
+/**
+ * First fragment of a recording and the number of fragments in each playlist
+ * entry, grouping whole fragments up to TIMELINE_MANIFEST_PART_DURATION
+ */
+static int plan_recording_parts(const timeline_segment_t *segment, const mp4_fragment_index_t *index,
+                                time_t start_time, int *first, double *max_duration) {
+    // Skip the fragments that end before the requested start
+    *first = 0;
+    while (*first < index->count - 1 &&
+           segment->start_time + index->fragments[*first].start + index->fragments[*first].duration
+               <= (double)start_time) {
+        (*first)++;
+    }
+
+    int parts = 0;
+    double duration = 0;
+    for (int i = *first; i < index->count; i++) {
+        duration += index->fragments[i].duration;
+        if (duration >= TIMELINE_MANIFEST_PART_DURATION || i == index->count - 1) {
+            if (duration > *max_duration) {
+                *max_duration = duration;
+            }
+            duration = 0;
+            parts++;
+        }
+    }
+
+    return parts;
+}
+
+/**
+ * Create a playback manifest for a sequence of recordings
+ */
+timeline_manifest_t *create_timeline_manifest(const timeline_segment_t *segments, int segment_count,
+                                              time_t start_time) {
+    if (!segments || segment_count <= 0) {
+        log_error("Invalid parameters for create_timeline_manifest");
+        return NULL;
+    }
+
+    // Start with the segment that contains the start time, or the first one after it
+    int start_segment_index = 0;
     for (int i = 0; i < segment_count; i++) {
-        if (start_time >= segments[i].start_time && start_time <= segments[i].end_time) {
+        if (start_time <= segments[i].end_time) {
             start_segment_index = i;
             break;
         }
     }
-    
-    // If no segment contains the start time, use the first segment after the start time
-    if (start_segment_index == -1) {
+    segments += start_segment_index;
+    segment_count -= start_segment_index;
+
+    // Limit the number of segments
+    if (segment_count > MAX_MANIFEST_SEGMENTS) {
+        log_warn("Limiting manifest to %d segments (requested %d)", MAX_MANIFEST_SEGMENTS, segment_count);
+        segment_count = MAX_MANIFEST_SEGMENTS;
+    }
+
+    mp4_fragment_index_t *indexes = calloc(segment_count, sizeof(mp4_fragment_index_t));
+    int *first_fragments = calloc(segment_count, sizeof(int));
+    if (!indexes || !first_fragments) {
+        log_error("Failed to allocate memory for recording indexes");
+        free(indexes);
+        free(first_fragments);
+        return NULL;
+    }
+
+    // Every recording needs a fragment index to be listed as byte ranges
+    bool byte_ranges = true;
+    double max_duration = 0;
+    for (int i = 0; i < segment_count && byte_ranges; i++) {
+        if (mp4_fragment_index_load(segments[i].file_path, &indexes[i]) != 0) {
+            log_info("Recording %s is not fragmented, serving the timeline as a whole",
+                     segments[i].file_path);
+            byte_ranges = false;
+            break;
+        }
+        plan_recording_parts(&segments[i], &indexes[i], i == 0 ? start_time : 0,
+                             &first_fragments[i], &max_duration);
+    }
+
+    char *buffer = NULL;
+    size_t size = 0;
+    FILE *manifest = open_memstream(&buffer, &size);
+    if (!manifest) {
+        log_error("Failed to create manifest buffer");
         for (int i = 0; i < segment_count; i++) {
-            if (start_time < segments[i].start_time) {
-                start_segment_index = i;
-                break;
-            }
+            mp4_fragment_index_free(&indexes[i]);
         }
+        free(indexes);
+        free(first_fragments);
+        return NULL;
     }
-    
-    // If still no segment found, use the first segment
-    if (start_segment_index == -1 && segment_count > 0) {
-        start_segment_index = 0;
+
+    if (!byte_ranges) {
+        write_whole_timeline_manifest(manifest, segments, segment_count, start_time);
+    } else {
+        fprintf(manifest, "#EXTM3U\n");
+        fprintf(manifest, "#EXT-X-VERSION:7\n");
+        fprintf(manifest, "#EXT-X-PLAYLIST-TYPE:VOD\n");
+        fprintf(manifest, "#EXT-X-INDEPENDENT-SEGMENTS\n");
+        fprintf(manifest, "#EXT-X-TARGETDURATION:%d\n", (int)ceil(max_duration));
+        fprintf(manifest, "#EXT-X-MEDIA-SEQUENCE:0\n");
+
+        for (int i = 0; i < segment_count; i++) {
+            const mp4_fragment_index_t *index = &indexes[i];
+            unsigned long long id = (unsigned long long)segments[i].id;
+            int fragment = first_fragments[i];
+
+            // Each recording has its own initialization section and timestamps
+            if (i > 0) {
+                fprintf(manifest, "#EXT-X-DISCONTINUITY\n");
+            }
+            fprintf(manifest, "#EXT-X-MAP:URI=\"/api/recordings/play/%llu\",BYTERANGE=\"%llu@0\"\n",
+                    id, (unsigned long long)index->init_length);
+
+            // Wall-clock time of the first entry, for mapping the player position to the timeline
+            double first_time = segments[i].start_time + index->fragments[fragment].start;
+            time_t first_seconds = (time_t)first_time;
+            struct tm tm_utc;
+            char date_time[32];
+            gmtime_r(&first_seconds, &tm_utc);
+            strftime(date_time, sizeof(date_time), "%Y-%m-%dT%H:%M:%S", &tm_utc);
+            fprintf(manifest, "#EXT-X-PROGRAM-DATE-TIME:%s.%03dZ\n", date_time,
+                    (int)((first_time - (double)first_seconds) * 1000));
+
+            while (fragment < index->count) {
+                uint64_t offset = index->fragments[fragment].offset;
+                uint64_t length = 0;
+                double duration = 0;
+                while (fragment < index->count) {
+                    length += index->fragments[fragment].length;
+                    duration += index->fragments[fragment].duration;
+                    fragment++;
+                    if (duration >= TIMELINE_MANIFEST_PART_DURATION) {
+                        break;
+                    }
+                }
+
+                fprintf(manifest, "#EXTINF:%.6f,\n", duration);
+                fprintf(manifest, "#EXT-X-BYTERANGE:%llu@%llu\n",
+                        (unsigned long long)length, (unsigned long long)offset);
+                fprintf(manifest, "/api/recordings/play/%llu\n", id);
+            }
+        }
+
+        fprintf(manifest, "#EXT-X-ENDLIST\n");
     }
-    
-    // Create a single segment for the entire timeline
-    // This simplifies playback and avoids issues with segment transitions
-    fprintf(manifest, "#EXTINF:%.6f,\n", max_duration);
-    fprintf(manifest, "/api/timeline/play?stream=%s&start=%ld\n", 
-            segments[0].stream_name, (long)start_time);
-    
-    // Write manifest end
-    fprintf(manifest, "#EXT-X-ENDLIST\n");
-    
-    // Close manifest file
+
     fclose(manifest);
-    
-    // Copy manifest path to output
-    strncpy(manifest_path, manifest_filename, MAX_PATH_LENGTH - 1);
-    manifest_path[MAX_PATH_LENGTH - 1] = '\0';
-    
-    pthread_mutex_unlock(&manifest_mutex);
-    
-    log_info("Created timeline manifest: %s", manifest_filename);
-    
-    return 0;
+
+    for (int i = 0; i < segment_count; i++) {
+        mp4_fragment_index_free(&indexes[i]);
+    }
+    free(indexes);
+    free(first_fragments);
+
+    timeline_manifest_t *result = buffer ? timeline_manifest_create(buffer, size) : NULL;
+    free(buffer);
+
+    if (result) {
+        log_info("Created timeline manifest for %s (%zu bytes, %d recordings%s)", segments[0].stream_name,
+                 result->size, segment_count, byte_ranges ? ", byte ranges" : "");
+    }
+    return result;
 }
 
 /**
@@ -542,8 +794,9 @@ void mg_handle_timeline_manifest(struct mg_connection *c, struct mg_http_message
             log_error("Failed to parse start time string: %s", decoded_start_time);
         }
     } else {
-        // Default to 24 hours ago
+        // Default to 24 hours ago, rounded down to the range step
         start_time = time(NULL) - (24 * 60 * 60);
+        start_time -= start_time % TIMELINE_MANIFEST_DEFAULT_RANGE_STEP;
     }
     
     if (end_time_str[0] != '\0') {
@@ -584,52 +837,50 @@ void mg_handle_timeline_manifest(struct mg_connection *c, struct mg_http_message
             log_error("Failed to parse end time string: %s", decoded_end_time);
         }
     } else {
-        // Default to now
+        // Default to now, rounded up to the range step. Nothing can have started
+        // since now without changing the version of the stream's recordings, so
+        // the rounded range lists the same recordings
         end_time = time(NULL);
+        end_time += TIMELINE_MANIFEST_DEFAULT_RANGE_STEP - end_time % TIMELINE_MANIFEST_DEFAULT_RANGE_STEP;
     }
     
-    // Get timeline segments
-    timeline_segment_t *segments = (timeline_segment_t *)malloc(MAX_TIMELINE_SEGMENTS * sizeof(timeline_segment_t));
-    if (!segments) {
-        log_error("Failed to allocate memory for timeline segments");
-        mg_send_json_error(c, 500, "Failed to allocate memory for timeline segments");
-        return;
-    }
-    
-    int count = get_timeline_segments(stream_name, start_time, end_time, segments, MAX_TIMELINE_SEGMENTS);
-    
-    if (count <= 0) {
-        log_error("No timeline segments found for stream %s", stream_name);
-        free(segments);
-        mg_send_json_error(c, 404, "No recordings found for the specified time range");
-        return;
-    }
-    
-    // Create manifest
-    char manifest_path[MAX_PATH_LENGTH];
-    if (create_timeline_manifest(segments, count, start_time, manifest_path) != 0) {
-        log_error("Failed to create timeline manifest");
+    // Manifest of this range for the current set of the stream's recordings
+    uint64_t version = get_stream_recording_generation(stream_name);
+    timeline_manifest_t *manifest = timeline_manifest_cache_get(stream_name, start_time, end_time, version);
+    if (!manifest) {
+        // Get timeline segments
+        timeline_segment_t *segments = (timeline_segment_t *)malloc(MAX_TIMELINE_SEGMENTS * sizeof(timeline_segment_t));
+        if (!segments) {
+            log_error("Failed to allocate memory for timeline segments");
+            mg_send_json_error(c, 500, "Failed to allocate memory for timeline segments");
+            return;
+        }
+        
+        int count = get_timeline_segments(stream_name, start_time, end_time, segments, MAX_TIMELINE_SEGMENTS);
+        
+        if (count <= 0) {
+            log_error("No timeline segments found for stream %s", stream_name);
+            free(segments);
+            mg_send_json_error(c, 404, "No recordings found for the specified time range");
+            return;
+        }
+        
+        manifest = create_timeline_manifest(segments, count, start_time);
         free(segments);
-        mg_send_json_error(c, 500, "Failed to create timeline manifest");
-        return;
+        if (!manifest) {
+            log_error("Failed to create timeline manifest");
+            mg_send_json_error(c, 500, "Failed to create timeline manifest");
+            return;
+        }
+        timeline_manifest_cache_put(stream_name, start_time, end_time, version, manifest);
     }
     
-    // Free segments
-    free(segments);
-    
-    // Use Mongoose's built-in file serving capabilities
-    // This is more stable and handles all the HTTP headers properly
-    struct mg_http_serve_opts opts = {
-        .mime_types = "m3u8=application/vnd.apple.mpegurl",
-        .extra_headers = "Connection: close\r\nCache-Control: no-cache\r\n"
-    };
-    
-    log_info("Serving manifest file using mg_http_serve_file: %s", manifest_path);
-    mg_http_serve_file(c, hm, manifest_path, &opts);
-    
-    // Schedule manifest file for deletion after a while
-    // In a real implementation, you might want to keep it around for a bit
-    // and implement a cleanup mechanism
+    mg_printf(c, "HTTP/1.1 200 OK\r\n"
+                 "Content-Type: application/vnd.apple.mpegurl\r\n"
+                 "Cache-Control: no-cache\r\n"
+                 "Content-Length: %lu\r\n\r\n", (unsigned long)manifest->size);
+    mg_send(c, manifest->data, manifest->size);
+    timeline_manifest_release(manifest);
     
     log_info("Successfully handled GET /api/timeline/manifest request");
 }
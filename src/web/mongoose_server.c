@@ -36,12 +36,16 @@
 void mg_handle_get_timeline_segments(struct mg_connection *c, struct mg_http_message *hm);
 void mg_handle_timeline_manifest(struct mg_connection *c, struct mg_http_message *hm);
 void mg_handle_timeline_playback(struct mg_connection *c, struct mg_http_message *hm);
+void mg_handle_get_timeline_heatmap(struct mg_connection *c, struct mg_http_message *hm);
 
 // Forward declarations for HLS API handlers
 void mg_handle_hls_master_playlist(struct mg_connection *c, struct mg_http_message *hm);
 void mg_handle_hls_media_playlist(struct mg_connection *c, struct mg_http_message *hm);
 void mg_handle_hls_segment(struct mg_connection *c, struct mg_http_message *hm);
 void mg_handle_direct_hls_request(struct mg_connection *c, struct mg_http_message *hm);
+bool mg_is_parked_hls_request(const struct mg_connection *c);
+void mg_handle_parked_hls_request(struct mg_connection *c);
+void mg_release_parked_hls_request(struct mg_connection *c);
 
 // Default initial handler capacity
 #define INITIAL_HANDLER_CAPACITY 32
@@ -55,6 +59,7 @@ typedef struct {
     const char *uri;        // URI pattern
     mg_api_handler_t handler; // Handler function
     bool no_auto_threading;  // If true, don't automatically thread this handler
+    mg_request_priority_t priority; // Worker queue priority class
 } mg_api_route_t;
 
 // Forward declarations
@@ -80,80 +85,83 @@ void mg_handle_websocket_close(struct mg_connection *c);
 // API routes table
 static const mg_api_route_t s_api_routes[] = {
     // Auth API
-    {"POST", "/api/auth/login", mg_handle_auth_login, false},
-    {"POST", "/api/auth/logout", mg_handle_auth_logout, false},
-    {"GET", "/api/auth/verify", mg_handle_auth_verify, false},
+    {"POST", "/api/auth/login", mg_handle_auth_login, false, MG_PRIORITY_NORMAL},
+    {"POST", "/api/auth/logout", mg_handle_auth_logout, false, MG_PRIORITY_NORMAL},
+    {"GET", "/api/auth/verify", mg_handle_auth_verify, false, MG_PRIORITY_LIVE},
 
     // User Management API
-    {"GET", "/api/auth/users", mg_handle_users_list, false},
-    {"GET", "/api/auth/users/#", mg_handle_users_get, false},
-    {"POST", "/api/auth/users", mg_handle_users_create, false},
-    {"PUT", "/api/auth/users/#", mg_handle_users_update, true},  // Already uses threading
-    {"DELETE", "/api/auth/users/#", mg_handle_users_delete, true},  // Already uses threading
-    {"POST", "/api/auth/users/#/api-key", mg_handle_users_generate_api_key, true},  // Already uses threading
+    {"GET", "/api/auth/users", mg_handle_users_list, false, MG_PRIORITY_NORMAL},
+    {"GET", "/api/auth/users/#", mg_handle_users_get, false, MG_PRIORITY_NORMAL},
+    {"POST", "/api/auth/users", mg_handle_users_create, false, MG_PRIORITY_NORMAL},
+    {"PUT", "/api/auth/users/#", mg_handle_users_update, true, MG_PRIORITY_NORMAL},  // Already uses threading
+    {"DELETE", "/api/auth/users/#", mg_handle_users_delete, true, MG_PRIORITY_NORMAL},  // Already uses threading
+    {"POST", "/api/auth/users/#/api-key", mg_handle_users_generate_api_key, true, MG_PRIORITY_NORMAL},  // Already uses threading
 
     // Streams API
-    {"GET", "/api/streams", mg_handle_get_streams, false},
-    {"POST", "/api/streams", mg_handle_post_stream, false},
-    {"POST", "/api/streams/test", mg_handle_test_stream, false},
-    {"GET", "/api/streams/#", mg_handle_get_stream, false},
-    {"PUT", "/api/streams/#", mg_handle_put_stream, false},
-    {"DELETE", "/api/streams/#", mg_handle_delete_stream, false},
+    {"GET", "/api/streams", mg_handle_get_streams, false, MG_PRIORITY_LIVE},
+    {"POST", "/api/streams", mg_handle_post_stream, false, MG_PRIORITY_NORMAL},
+    {"POST", "/api/streams/test", mg_handle_test_stream, false, MG_PRIORITY_NORMAL},
+    {"GET", "/api/streams/#", mg_handle_get_stream, false, MG_PRIORITY_LIVE},
+    {"PUT", "/api/streams/#", mg_handle_put_stream, false, MG_PRIORITY_NORMAL},
+    {"DELETE", "/api/streams/#", mg_handle_delete_stream, false, MG_PRIORITY_NORMAL},
 
     // Settings API
-    {"GET", "/api/settings", mg_handle_get_settings, false},
-    {"POST", "/api/settings", mg_handle_post_settings, false},
+    {"GET", "/api/settings", mg_handle_get_settings, false, MG_PRIORITY_NORMAL},
+    {"POST", "/api/settings", mg_handle_post_settings, false, MG_PRIORITY_NORMAL},
 
     // System API
-    {"GET", "/api/system", mg_handle_get_system_info, false},
-    {"GET", "/api/system/info", mg_handle_get_system_info, false}, // Keep for backward compatibility
-    {"GET", "/api/system/logs", mg_handle_get_system_logs, false},
-    {"POST", "/api/system/restart", mg_handle_post_system_restart, false},
-    {"POST", "/api/system/shutdown", mg_handle_post_system_shutdown, false},
-    {"POST", "/api/system/logs/clear", mg_handle_post_system_logs_clear, false},
-    {"POST", "/api/system/backup", mg_handle_post_system_backup, false},
-    {"GET", "/api/system/status", mg_handle_get_system_status, false},
-    {"GET", "/api/health", mg_handle_get_health, false},
+    {"GET", "/api/system", mg_handle_get_system_info, false, MG_PRIORITY_NORMAL},
+    {"GET", "/api/system/info", mg_handle_get_system_info, false, MG_PRIORITY_NORMAL}, // Keep for backward compatibility
+    {"GET", "/api/system/logs", mg_handle_get_system_logs, false, MG_PRIORITY_BULK},
+    {"POST", "/api/system/restart", mg_handle_post_system_restart, false, MG_PRIORITY_NORMAL},
+    {"POST", "/api/system/shutdown", mg_handle_post_system_shutdown, false, MG_PRIORITY_NORMAL},
+    {"POST", "/api/system/logs/clear", mg_handle_post_system_logs_clear, false, MG_PRIORITY_NORMAL},
+    {"POST", "/api/system/backup", mg_handle_post_system_backup, false, MG_PRIORITY_BULK},
+    {"GET", "/api/system/status", mg_handle_get_system_status, false, MG_PRIORITY_LIVE},
+    {"GET", "/api/health", mg_handle_get_health, false, MG_PRIORITY_LIVE},
+    {"GET", "/api/system/workers", mg_handle_get_system_workers, true, MG_PRIORITY_LIVE},  // Answered even when the pool is saturated
+    {"GET", "/metrics", mg_handle_get_metrics, true, MG_PRIORITY_LIVE},  // Prometheus scrapes must not queue behind API requests
 
     // Recordings API
-    {"GET", "/api/recordings", mg_handle_get_recordings, false},
-    {"GET", "/api/recordings/play/#", mg_handle_play_recording, false},
-    {"GET", "/api/recordings/download/#", mg_handle_download_recording, false},
-    {"GET", "/api/recordings/files/check", mg_handle_check_recording_file, true},  // Already uses threading
-    {"DELETE", "/api/recordings/files", mg_handle_delete_recording_file, true},  // Already uses threading
-    {"GET", "/api/recordings/#", mg_handle_get_recording, false},
-    {"DELETE", "/api/recordings/#", mg_handle_delete_recording, true},  // Already uses threading
-    {"POST", "/api/recordings/batch-delete", mg_handle_batch_delete_recordings, true},  // Already uses threading
-    {"POST", "/api/recordings/batch-delete-ws", mg_handle_batch_delete_recordings_ws, true},  // Already uses threading
-    {"GET", "/api/ws", mg_handle_websocket_upgrade, false},
+    {"GET", "/api/recordings", mg_handle_get_recordings, false, MG_PRIORITY_NORMAL},
+    {"GET", "/api/recordings/play/#", mg_handle_play_recording, false, MG_PRIORITY_NORMAL},
+    {"GET", "/api/recordings/download/#", mg_handle_download_recording, false, MG_PRIORITY_BULK},
+    {"GET", "/api/recordings/files/check", mg_handle_check_recording_file, true, MG_PRIORITY_NORMAL},  // Already uses threading
+    {"DELETE", "/api/recordings/files", mg_handle_delete_recording_file, true, MG_PRIORITY_BULK},  // Already uses threading
+    {"GET", "/api/recordings/#", mg_handle_get_recording, false, MG_PRIORITY_NORMAL},
+    {"DELETE", "/api/recordings/#", mg_handle_delete_recording, true, MG_PRIORITY_NORMAL},  // Already uses threading
+    {"POST", "/api/recordings/batch-delete", mg_handle_batch_delete_recordings, true, MG_PRIORITY_BULK},  // Already uses threading
+    {"POST", "/api/recordings/batch-delete-ws", mg_handle_batch_delete_recordings_ws, true, MG_PRIORITY_BULK},  // Already uses threading
+    {"GET", "/api/ws", mg_handle_websocket_upgrade, false, MG_PRIORITY_NORMAL},
 
     // No direct HLS handlers - handled by static file handler
 
     // go2rtc WebRTC API
-    {"POST", "/api/webrtc", mg_handle_go2rtc_webrtc_offer, false},
-    {"POST", "/api/webrtc/ice", mg_handle_go2rtc_webrtc_ice, false},
-    {"OPTIONS", "/api/webrtc", mg_handle_go2rtc_webrtc_options, false},
-    {"OPTIONS", "/api/webrtc/ice", mg_handle_go2rtc_webrtc_ice_options, false},
+    {"POST", "/api/webrtc", mg_handle_go2rtc_webrtc_offer, false, MG_PRIORITY_LIVE},
+    {"POST", "/api/webrtc/ice", mg_handle_go2rtc_webrtc_ice, false, MG_PRIORITY_LIVE},
+    {"OPTIONS", "/api/webrtc", mg_handle_go2rtc_webrtc_options, false, MG_PRIORITY_LIVE},
+    {"OPTIONS", "/api/webrtc/ice", mg_handle_go2rtc_webrtc_ice_options, false, MG_PRIORITY_LIVE},
 
     // Detection API
-    {"GET", "/api/detection/results/#", mg_handle_get_detection_results, false},
-    {"GET", "/api/detection/models", mg_handle_get_detection_models, false},
+    {"GET", "/api/detection/results/#", mg_handle_get_detection_results, false, MG_PRIORITY_LIVE},
+    {"GET", "/api/detection/models", mg_handle_get_detection_models, false, MG_PRIORITY_NORMAL},
 
     // ONVIF API
-    {"GET", "/api/onvif/discovery/status", mg_handle_get_onvif_discovery_status, false},
-    {"GET", "/api/onvif/devices", mg_handle_get_discovered_onvif_devices, false},
-    {"GET", "/api/onvif/device/profiles", mg_handle_get_onvif_device_profiles, false},
-    {"POST", "/api/onvif/discovery/discover", mg_handle_post_discover_onvif_devices, true},  // Already uses threading
-    {"POST", "/api/onvif/device/add", mg_handle_post_add_onvif_device_as_stream, false},
-    {"POST", "/api/onvif/device/test", mg_handle_post_test_onvif_connection, false},
+    {"GET", "/api/onvif/discovery/status", mg_handle_get_onvif_discovery_status, false, MG_PRIORITY_NORMAL},
+    {"GET", "/api/onvif/devices", mg_handle_get_discovered_onvif_devices, false, MG_PRIORITY_NORMAL},
+    {"GET", "/api/onvif/device/profiles", mg_handle_get_onvif_device_profiles, false, MG_PRIORITY_NORMAL},
+    {"POST", "/api/onvif/discovery/discover", mg_handle_post_discover_onvif_devices, true, MG_PRIORITY_BULK},  // Already uses threading
+    {"POST", "/api/onvif/device/add", mg_handle_post_add_onvif_device_as_stream, false, MG_PRIORITY_NORMAL},
+    {"POST", "/api/onvif/device/test", mg_handle_post_test_onvif_connection, false, MG_PRIORITY_NORMAL},
 
     // Timeline API
-    {"GET", "/api/timeline/segments", mg_handle_get_timeline_segments, false},
-    {"GET", "/api/timeline/manifest", mg_handle_timeline_manifest, false},
-    {"GET", "/api/timeline/play", mg_handle_timeline_playback, false},
+    {"GET", "/api/timeline/segments", mg_handle_get_timeline_segments, false, MG_PRIORITY_NORMAL},
+    {"GET", "/api/timeline/manifest", mg_handle_timeline_manifest, false, MG_PRIORITY_NORMAL},
+    {"GET", "/api/timeline/play", mg_handle_timeline_playback, false, MG_PRIORITY_NORMAL},
+    {"GET", "/api/timeline/heatmap", mg_handle_get_timeline_heatmap, false, MG_PRIORITY_NORMAL},
 
     // End of table marker
-    {NULL, NULL, NULL, false}
+    {NULL, NULL, NULL, false, MG_PRIORITY_NORMAL}
 };
 
 /**
@@ -187,34 +195,15 @@ static bool handle_api_request(struct mg_connection *c, struct mg_http_message *
 
         // Check if this handler should be automatically threaded
         if (use_threading && !s_api_routes[route_index].no_auto_threading) {
-            // Handle in a separate thread using mg_thread_function
+            // Handle in a worker thread using mg_thread_function
             log_info("Handling API request in a worker thread: %s %s", method_buf, uri_buf);
 
-            // Create a thread data structure
-            struct mg_thread_data *data = calloc(1, sizeof(struct mg_thread_data));
-            if (!data) {
-                log_error("Failed to allocate memory for thread data");
-                mg_http_reply(c, 500, "", "Internal Server Error\n");
+            // Queue for the worker pool; an error response has been sent if this fails
+            if (!mg_submit_request(c, hm, s_api_routes[route_index].handler,
+                                   s_api_routes[route_index].priority)) {
                 return true;
             }
 
-            // Copy the HTTP message
-            data->message = mg_strdup(hm->message);
-            if (data->message.len == 0) {
-                log_error("Failed to duplicate HTTP message");
-                free(data);
-                mg_http_reply(c, 500, "", "Internal Server Error\n");
-                return true;
-            }
-
-            // Set connection ID, manager, and handler function
-            data->conn_id = c->id;
-            data->mgr = c->mgr;
-            data->handler_func = s_api_routes[route_index].handler;
-
-            // Start thread
-            mg_start_thread(mg_thread_function, data);
-
             log_info("API request started in a worker thread: %s %s", method_buf, uri_buf);
             return true;
         } else {
@@ -303,9 +292,6 @@ http_server_handle_t http_server_init(const http_server_config_t *config) {
     log_info("Registering WebSocket handlers");
     websocket_register_handlers();
 
-    // We now use the multithreading pattern instead of the API thread pool
-    log_info("Using multithreading pattern for all requests");
-
     http_server_handle_t server = mongoose_server_init(config);
     if (!server) {
         log_error("Failed to initialize Mongoose server");
@@ -348,6 +334,12 @@ http_server_handle_t mongoose_server_init(const http_server_config_t *config) {
     // Initialize wakeup functionality for multithreading
     mg_wakeup_init(server->mgr);
 
+    // Start the API worker pool
+    if (mg_worker_pool_init(config->thread_pool_size > 0 ? config->thread_pool_size : 8,
+                            config->request_queue_size > 0 ? config->request_queue_size : 64) != 0) {
+        log_warn("Failed to start API worker pool, using a thread per request");
+    }
+
     // Allocate handlers array
     server->handlers = calloc(INITIAL_HANDLER_CAPACITY, sizeof(*server->handlers));
     if (!server->handlers) {
@@ -360,8 +352,6 @@ http_server_handle_t mongoose_server_init(const http_server_config_t *config) {
 
     // No mutex needed as we're not tracking statistics
 
-    log_info("Using per-request threading for all requests");
-
     server->handler_capacity = INITIAL_HANDLER_CAPACITY;
     server->handler_count = 0;
     server->running = false;
@@ -539,6 +529,9 @@ void http_server_stop(http_server_handle_t server) {
     // Explicitly poll the manager one more time to process closed connections
     mg_mgr_poll(server->mgr, 0);
 
+    // Workers wake up connections through the manager, so stop them first
+    mg_worker_pool_shutdown();
+
     // Free Mongoose event manager
     mg_mgr_free(server->mgr);
 
@@ -871,8 +864,8 @@ static void mongoose_event_handler(struct mg_connection *c, int ev, void *ev_dat
             // Authentication failed
             log_info("Authentication failed for request: %s", uri);
 
-            // For API requests, return 401 Unauthorized but don't prompt for basic auth
-            if (strncmp(uri, "/api/", 5) == 0) {
+            // For API and metrics requests, return 401 Unauthorized but don't prompt for basic auth
+            if (strncmp(uri, "/api/", 5) == 0 || strcmp(uri, "/metrics") == 0) {
                 mg_printf(c, "HTTP/1.1 401 Unauthorized\r\n");
                 mg_printf(c, "Content-Type: application/json\r\n");
                 mg_printf(c, "Content-Length: 29\r\n");
@@ -907,7 +900,7 @@ static void mongoose_event_handler(struct mg_connection *c, int ev, void *ev_dat
 
         // Check if this is a static asset, HTML file, or HLS request
         is_static_asset = is_static_asset || strstr(uri, ".html") != NULL;
-        bool is_api_request = strncasecmp(uri, "/api/", 5) == 0;
+        bool is_api_request = strncasecmp(uri, "/api/", 5) == 0 || strcmp(uri, "/metrics") == 0;
         bool is_direct_hls = strncasecmp(uri, "/hls/", 5) == 0;
         bool handled = false;
 
@@ -990,6 +983,11 @@ static void mongoose_event_handler(struct mg_connection *c, int ev, void *ev_dat
         // Connection closed
         log_debug("Connection closed");
 
+        // Drop any LL-HLS request still waiting for a part
+        if (mg_is_parked_hls_request(c)) {
+            mg_release_parked_hls_request(c);
+        }
+
         // If this was a WebSocket connection, handle cleanup
         if (c->is_websocket) {
             log_info("WebSocket connection closed");
@@ -1024,7 +1022,10 @@ static void mongoose_event_handler(struct mg_connection *c, int ev, void *ev_dat
         // Connection error
         log_error("Connection error: %s", (char *)ev_data);
     } else if (ev == MG_EV_POLL) {
-        // Poll event - do nothing
+        // Resume LL-HLS requests waiting for a part to be published
+        if (mg_is_parked_hls_request(c)) {
+            mg_handle_parked_hls_request(c);
+        }
     } else if (ev == MG_EV_READ || ev == MG_EV_WRITE) {
         // Read/write events - normal socket operations
         // No need to log these high-frequency events
@@ -40,13 +40,15 @@ int mongoose_server_basic_auth_check(struct mg_http_message *hm, http_server_t *
     // Get Authorization header
     struct mg_str *auth_header = mg_http_get_header(hm, "Authorization");
     
+    // Authorization header built from the auth cookie, local since worker threads authenticate concurrently
+    char cookie_auth_buf[512];
+    struct mg_str cookie_auth_header;
+    
     // If no Authorization header, check for session or auth cookie
     if (auth_header == NULL) {
-        log_info("No Authorization header found for URI: %s, checking for cookies", uri);
+        log_debug("No Authorization header found for URI: %s, checking for cookies", uri);
         struct mg_str *cookie_header = mg_http_get_header(hm, "Cookie");
         if (cookie_header != NULL) {
-            log_info("Cookie header found: %.*s", (int)cookie_header->len, cookie_header->buf);
-            
             // Parse the cookie header manually
             char cookie_str[1024] = {0};
             if (cookie_header->len < sizeof(cookie_str) - 1) {
@@ -69,15 +71,13 @@ int mongoose_server_basic_auth_check(struct mg_http_message *hm, http_server_t *
                         memcpy(session_cookie_value, session_cookie_start, session_cookie_len);
                         session_cookie_value[session_cookie_len] = '\0';
                         
-                        log_info("Found session cookie value: %s", session_cookie_value);
-                        
                         // Validate the session token
                         int64_t user_id;
                         if (db_auth_validate_session(session_cookie_value, &user_id) == 0) {
-                            log_info("Session token validated successfully for user ID: %lld", (long long)user_id);
+                            log_debug("Session token validated successfully for user ID: %lld", (long long)user_id);
                             return 0; // Authentication successful
                         } else {
-                            log_info("Invalid session token: %s", session_cookie_value);
+                            log_info("Invalid session token");
                         }
                     }
                 }
@@ -98,34 +98,23 @@ int mongoose_server_basic_auth_check(struct mg_http_message *hm, http_server_t *
                         memcpy(auth_cookie_value, auth_cookie_start, auth_cookie_len);
                         auth_cookie_value[auth_cookie_len] = '\0';
                         
-                        log_info("Found auth cookie value: %s", auth_cookie_value);
-                        
-                        // Create a temporary buffer for the Authorization header value
-                        char auth_value[512];
-                        snprintf(auth_value, sizeof(auth_value), "Basic %s", auth_cookie_value);
-                        
-                        // Create a static buffer for the header
-                        static char auth_header_buf[512];
-                        strncpy(auth_header_buf, auth_value, sizeof(auth_header_buf) - 1);
-                        auth_header_buf[sizeof(auth_header_buf) - 1] = '\0';
-                        
-                        // Create a static mg_str for the header
-                        static struct mg_str static_auth_header;
-                        static_auth_header.buf = auth_header_buf;
-                        static_auth_header.len = strlen(auth_header_buf);
+                        // Build the Authorization header value
+                        snprintf(cookie_auth_buf, sizeof(cookie_auth_buf), "Basic %s", auth_cookie_value);
+                        cookie_auth_header.buf = cookie_auth_buf;
+                        cookie_auth_header.len = strlen(cookie_auth_buf);
                         
                         // Use the cookie value as the Authorization header
-                        auth_header = &static_auth_header;
-                        log_info("Using auth cookie for authentication: %s", auth_header_buf);
+                        auth_header = &cookie_auth_header;
+                        log_debug("Using auth cookie for authentication");
                     }
                 } else {
-                    log_info("No auth cookie found in cookie string: %s", cookie_str);
+                    log_debug("No auth cookie found in cookie string");
                 }
             } else {
                 log_info("Cookie header too long to process");
             }
         } else {
-            log_info("No Cookie header found");
+            log_debug("No Cookie header found");
         }
         
         // If still no auth header, authentication fails
@@ -162,16 +151,13 @@ int mongoose_server_basic_auth_check(struct mg_http_message *hm, http_server_t *
         }
         
         if (user[0] != '\0') {
-            // First try to authenticate against the database
+            // First try to authenticate against the database, which rejects inactive users
+            // and serves recently verified credentials from the authentication cache
             int64_t user_id;
             if (db_auth_authenticate(user, pass, &user_id) == 0) {
-                // Get the user to check if they're active
-                user_t db_user;
-                if (db_auth_get_user_by_id(user_id, &db_user) == 0 && db_user.is_active) {
-                    log_info("Authentication successful with database credentials for user: %s (ID: %lld)", 
-                            user, (long long)user_id);
-                    return 0; // Authentication successful
-                }
+                log_debug("Authentication successful with database credentials for user: %s (ID: %lld)", 
+                         user, (long long)user_id);
+                return 0; // Authentication successful
             }
             
             // If database authentication fails, check against server config (legacy)
@@ -3,7 +3,9 @@
  * @brief Multithreading support for Mongoose server
  * 
  * This file implements multithreading support for the Mongoose server,
- * allowing it to handle multiple requests in parallel.
+ * allowing it to handle multiple requests in parallel. API requests are
+ * queued by priority class to a fixed pool of worker threads; when the
+ * queue is full for a class the request is answered with 503.
  */
 
 #include <stdio.h>
@@ -11,14 +13,58 @@
 #include <string.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <time.h>
 
 #include "web/mongoose_server.h"
 #include "web/mongoose_server_multithreading.h"
 #include "core/logger.h"
+#include "core/metrics.h"
 #include "core/shutdown_coordinator.h"
 
 // Thread data structure is defined in the header file
 
+// Every Nth dispatch serves the oldest queued request regardless of class,
+// so a steady stream of live requests cannot starve bulk work forever
+#define MG_WORKER_FAIRNESS_INTERVAL 8
+
+// Share of the queue each class may fill, in percent
+static const int s_admission_percent[MG_PRIORITY_COUNT] = {100, 75, 50};
+
+static const char *s_priority_names[MG_PRIORITY_COUNT] = {"live", "normal", "bulk"};
+
+// FIFO of requests of one priority class
+typedef struct {
+  struct mg_thread_data **items;
+  int head;
+  int count;
+} mg_request_queue_t;
+
+static struct {
+  bool running;
+  pthread_t *threads;
+  int num_threads;
+  int capacity;
+  int depth;                    // Requests queued over all classes
+  unsigned int dispatched;      // Dispatch counter for the fairness rule
+  mg_request_queue_t queues[MG_PRIORITY_COUNT];
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  mg_worker_pool_stats_t stats;
+} s_pool = {
+  .mutex = PTHREAD_MUTEX_INITIALIZER,
+  .cond = PTHREAD_COND_INITIALIZER,
+};
+
+// Queue wait and handler run time per priority class
+static metrics_histogram_t s_wait_time[MG_PRIORITY_COUNT];
+static metrics_histogram_t s_run_time[MG_PRIORITY_COUNT];
+
+static uint64_t monotonic_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
 /**
  * @brief Start a thread
  * 
@@ -57,68 +103,386 @@ void *mg_thread_function(void *param) {
   fake_conn.mgr = p->mgr;
   fake_conn.id = p->conn_id;
   
-  // Create HTTP message from the stored message
-  struct mg_http_message hm = {0};
-  if (mg_http_parse((char *)p->message.buf, p->message.len, &hm) > 0) {
-    // Extract URI for logging
-    char uri[256] = {0};
-    if (hm.uri.len > 0) {
-      size_t uri_len = hm.uri.len < sizeof(uri) - 1 ? hm.uri.len : sizeof(uri) - 1;
-      memcpy(uri, hm.uri.buf, uri_len);
-      uri[uri_len] = '\0';
-    }
+  // The request was parsed by the event loop and rebased onto the copy
+  struct mg_http_message *hm = &p->hm;
+
+  // Extract URI for logging
+  char uri[256] = {0};
+  if (hm->uri.len > 0) {
+    size_t uri_len = hm->uri.len < sizeof(uri) - 1 ? hm->uri.len : sizeof(uri) - 1;
+    memcpy(uri, hm->uri.buf, uri_len);
+    uri[uri_len] = '\0';
+  }
+  
+  // Call the handler function if provided
+  if (p->handler_func) {
+    log_debug("Calling handler function for URI: %s", uri);
     
-    // Call the handler function if provided
-    if (p->handler_func) {
-      log_debug("Calling handler function for URI: %s", uri);
-      
-      // Set up a buffer to capture the response
-      fake_conn.send.buf = NULL;
-      fake_conn.send.len = 0;
-      fake_conn.send.size = 0;
-      
-      // Execute the handler function
-      p->handler_func(&fake_conn, &hm);
+    // Set up a buffer to capture the response
+    fake_conn.send.buf = NULL;
+    fake_conn.send.len = 0;
+    fake_conn.send.size = 0;
+    
+    // Execute the handler function
+    p->handler_func(&fake_conn, hm);
+    
+    // Check if the handler sent a response directly
+    if (fake_conn.send.buf && fake_conn.send.len > 0) {
+      // Send the response back to the parent connection
+      log_debug("Handler sent response of length %zu", fake_conn.send.len);
+      mg_wakeup(p->mgr, p->conn_id, fake_conn.send.buf, fake_conn.send.len);
       
-      // Check if the handler sent a response directly
-      if (fake_conn.send.buf && fake_conn.send.len > 0) {
-        // Send the response back to the parent connection
-        log_debug("Handler sent response of length %zu", fake_conn.send.len);
-        mg_wakeup(p->mgr, p->conn_id, fake_conn.send.buf, fake_conn.send.len);
-        
-        // Free the send buffer if it was allocated
-        free((void *)fake_conn.send.buf);
-      } else {
-        // No response was sent, send a default response
-        log_debug("Handler did not send a response, sending default");
-        mg_wakeup(p->mgr, p->conn_id, "Handler completed", 16);
-      }
+      // Free the send buffer if it was allocated
+      free((void *)fake_conn.send.buf);
     } else {
-      // Try to find a handler for this URI
-      log_error("No handler function provided for URI: %s", uri);
-      
-      // Special handling for root path
-      if (strcmp(uri, "/") == 0) {
-        log_info("Root path detected in thread function, sending redirect to static handler");
-        mg_wakeup(p->mgr, p->conn_id, "HTTP/1.1 302 Found\r\nLocation: /index.html\r\nContent-Length: 0\r\n\r\n", 65);
-      } else {
-        mg_wakeup(p->mgr, p->conn_id, "No handler for request", 21);
-      }
+      // No response was sent, send a default response
+      log_debug("Handler did not send a response, sending default");
+      mg_wakeup(p->mgr, p->conn_id, "Handler completed", 16);
     }
   } else {
-    // Failed to parse HTTP message
-    log_error("Failed to parse HTTP message");
-    mg_wakeup(p->mgr, p->conn_id, "Failed to parse request", 22);
+    // Try to find a handler for this URI
+    log_error("No handler function provided for URI: %s", uri);
+    
+    // Special handling for root path
+    if (strcmp(uri, "/") == 0) {
+      log_info("Root path detected in thread function, sending redirect to static handler");
+      mg_wakeup(p->mgr, p->conn_id, "HTTP/1.1 302 Found\r\nLocation: /index.html\r\nContent-Length: 0\r\n\r\n", 65);
+    } else {
+      mg_wakeup(p->mgr, p->conn_id, "No handler for request", 21);
+    }
   }
   
+  log_debug("Worker thread completed for connection ID %lu", p->conn_id);
+  
   // Free resources
   free((void *) p->message.buf);
   free(p);
   
-  log_debug("Worker thread completed for connection ID %lu", p->conn_id);
   return NULL;
 }
 
+/**
+ * @brief Take the next request from the queues
+ * Must be called with the pool mutex held and at least one request queued
+ */
+static struct mg_thread_data *dequeue_request(void) {
+  int selected = -1;
+
+  if (++s_pool.dispatched % MG_WORKER_FAIRNESS_INTERVAL == 0) {
+    // Serve the oldest request of any class
+    for (int i = 0; i < MG_PRIORITY_COUNT; i++) {
+      mg_request_queue_t *q = &s_pool.queues[i];
+      if (q->count > 0 && (selected < 0 ||
+          q->items[q->head]->queued_us < s_pool.queues[selected].items[s_pool.queues[selected].head]->queued_us)) {
+        selected = i;
+      }
+    }
+  } else {
+    for (int i = 0; i < MG_PRIORITY_COUNT; i++) {
+      if (s_pool.queues[i].count > 0) {
+        selected = i;
+        break;
+      }
+    }
+  }
+
+  mg_request_queue_t *q = &s_pool.queues[selected];
+  struct mg_thread_data *data = q->items[q->head];
+  q->head = (q->head + 1) % s_pool.capacity;
+  q->count--;
+  s_pool.depth--;
+
+  return data;
+}
+
+/**
+ * @brief Worker thread main loop
+ */
+static void *mg_worker_thread(void *arg) {
+  (void)arg;
+
+  pthread_mutex_lock(&s_pool.mutex);
+  while (true) {
+    while (s_pool.running && s_pool.depth == 0) {
+      pthread_cond_wait(&s_pool.cond, &s_pool.mutex);
+    }
+    if (!s_pool.running) {
+      break;
+    }
+
+    struct mg_thread_data *data = dequeue_request();
+    mg_request_priority_t priority = data->priority;
+
+    uint64_t start_us = monotonic_us();
+    uint64_t wait_us = start_us - data->queued_us;
+    if (wait_us > s_pool.stats.max_wait_us[priority]) {
+      s_pool.stats.max_wait_us[priority] = wait_us;
+    }
+    s_pool.stats.busy_workers++;
+    pthread_mutex_unlock(&s_pool.mutex);
+
+    // mg_thread_function frees the data
+    mg_thread_function(data);
+
+    uint64_t run_us = monotonic_us() - start_us;
+    metrics_histogram_observe(s_wait_time[priority], wait_us);
+    metrics_histogram_observe(s_run_time[priority], run_us);
+
+    pthread_mutex_lock(&s_pool.mutex);
+    s_pool.stats.busy_workers--;
+    s_pool.stats.completed[priority]++;
+    s_pool.stats.total_wait_us[priority] += wait_us;
+    s_pool.stats.total_run_us[priority] += run_us;
+  }
+  pthread_mutex_unlock(&s_pool.mutex);
+
+  return NULL;
+}
+
+static void free_thread_data(struct mg_thread_data *data) {
+  free((void *) data->message.buf);
+  free(data);
+}
+
+int mg_worker_pool_init(int num_workers, int queue_capacity) {
+  if (num_workers <= 0 || queue_capacity <= 0) {
+    log_error("Invalid worker pool size: %d workers, queue %d", num_workers, queue_capacity);
+    return -1;
+  }
+
+  for (int i = 0; i < MG_PRIORITY_COUNT; i++) {
+    char labels[64] = "";
+    metrics_label(labels, sizeof(labels), "priority", s_priority_names[i]);
+    s_wait_time[i] = metrics_histogram("lightnvr_http_queue_wait_seconds",
+                                       "Time an API request waited for a worker", labels);
+    s_run_time[i] = metrics_histogram("lightnvr_http_handler_seconds",
+                                      "Time an API handler ran", labels);
+  }
+
+  pthread_mutex_lock(&s_pool.mutex);
+
+  if (s_pool.running) {
+    pthread_mutex_unlock(&s_pool.mutex);
+    log_warn("Worker pool is already running");
+    return 0;
+  }
+
+  memset(&s_pool.stats, 0, sizeof(s_pool.stats));
+  memset(s_pool.queues, 0, sizeof(s_pool.queues));
+  for (int i = 0; i < MG_PRIORITY_COUNT; i++) {
+    s_pool.queues[i].items = calloc(queue_capacity, sizeof(struct mg_thread_data *));
+    if (!s_pool.queues[i].items) {
+      log_error("Failed to allocate worker pool queue");
+      for (int j = 0; j < i; j++) {
+        free(s_pool.queues[j].items);
+        s_pool.queues[j].items = NULL;
+      }
+      pthread_mutex_unlock(&s_pool.mutex);
+      return -1;
+    }
+  }
+
+  s_pool.threads = calloc(num_workers, sizeof(pthread_t));
+  if (!s_pool.threads) {
+    log_error("Failed to allocate worker threads");
+    for (int i = 0; i < MG_PRIORITY_COUNT; i++) {
+      free(s_pool.queues[i].items);
+      s_pool.queues[i].items = NULL;
+    }
+    pthread_mutex_unlock(&s_pool.mutex);
+    return -1;
+  }
+
+  s_pool.capacity = queue_capacity;
+  s_pool.depth = 0;
+  s_pool.dispatched = 0;
+  s_pool.num_threads = 0;
+  s_pool.running = true;
+  s_pool.stats.queue_capacity = queue_capacity;
+
+  for (int i = 0; i < num_workers; i++) {
+    if (pthread_create(&s_pool.threads[i], NULL, mg_worker_thread, NULL) != 0) {
+      log_error("Failed to create API worker thread %d", i);
+      break;
+    }
+    s_pool.num_threads++;
+  }
+  s_pool.stats.workers = s_pool.num_threads;
+
+  pthread_mutex_unlock(&s_pool.mutex);
+
+  if (s_pool.num_threads == 0) {
+    mg_worker_pool_shutdown();
+    return -1;
+  }
+
+  log_info("Started %d API worker threads (queue capacity %d)", s_pool.num_threads, queue_capacity);
+  return 0;
+}
+
+void mg_worker_pool_shutdown(void) {
+  pthread_mutex_lock(&s_pool.mutex);
+  if (!s_pool.threads) {
+    pthread_mutex_unlock(&s_pool.mutex);
+    return;
+  }
+  s_pool.running = false;
+  pthread_cond_broadcast(&s_pool.cond);
+  pthread_mutex_unlock(&s_pool.mutex);
+
+  for (int i = 0; i < s_pool.num_threads; i++) {
+    pthread_join(s_pool.threads[i], NULL);
+  }
+
+  pthread_mutex_lock(&s_pool.mutex);
+  int dropped = s_pool.depth;
+  for (int i = 0; i < MG_PRIORITY_COUNT; i++) {
+    mg_request_queue_t *q = &s_pool.queues[i];
+    for (int n = 0; n < q->count; n++) {
+      free_thread_data(q->items[(q->head + n) % s_pool.capacity]);
+    }
+    free(q->items);
+    memset(q, 0, sizeof(*q));
+  }
+  free(s_pool.threads);
+  s_pool.threads = NULL;
+  s_pool.num_threads = 0;
+  s_pool.depth = 0;
+  s_pool.stats.workers = 0;
+  pthread_mutex_unlock(&s_pool.mutex);
+
+  if (dropped > 0) {
+    log_info("Dropped %d queued API requests during shutdown", dropped);
+  }
+  log_info("API worker pool stopped");
+}
+
+bool mg_worker_pool_submit(struct mg_thread_data *data, mg_request_priority_t priority) {
+  if (!data) {
+    return false;
+  }
+
+  if (priority < 0 || priority >= MG_PRIORITY_COUNT) {
+    priority = MG_PRIORITY_NORMAL;
+  }
+  data->priority = priority;
+  data->queued_us = monotonic_us();
+
+  pthread_mutex_lock(&s_pool.mutex);
+
+  if (!s_pool.running) {
+    pthread_mutex_unlock(&s_pool.mutex);
+    // No pool (e.g. tests or during startup), fall back to a thread of its own
+    mg_start_thread(mg_thread_function, data);
+    return true;
+  }
+
+  if (s_pool.depth >= s_pool.capacity * s_admission_percent[priority] / 100) {
+    s_pool.stats.rejected[priority]++;
+    pthread_mutex_unlock(&s_pool.mutex);
+    return false;
+  }
+
+  mg_request_queue_t *q = &s_pool.queues[priority];
+  q->items[(q->head + q->count) % s_pool.capacity] = data;
+  q->count++;
+  s_pool.depth++;
+  s_pool.stats.submitted[priority]++;
+
+  pthread_cond_signal(&s_pool.cond);
+  pthread_mutex_unlock(&s_pool.mutex);
+
+  return true;
+}
+
+/**
+ * @brief Point a string of the original request at the same bytes of its copy
+ */
+static struct mg_str rebase_str(struct mg_str s, const struct mg_str *from, const char *to) {
+  if (s.buf < from->buf || s.buf + s.len > from->buf + from->len) {
+    return (struct mg_str){NULL, 0};
+  }
+  return (struct mg_str){to + (s.buf - from->buf), s.len};
+}
+
+/**
+ * @brief Carry the parsed request over to its copy instead of parsing it again
+ */
+static void rebase_http_message(struct mg_http_message *dst, const struct mg_http_message *src,
+                                const char *copy) {
+  const struct mg_str *from = &src->message;
+
+  *dst = *src;
+  dst->method = rebase_str(src->method, from, copy);
+  dst->uri = rebase_str(src->uri, from, copy);
+  dst->query = rebase_str(src->query, from, copy);
+  dst->proto = rebase_str(src->proto, from, copy);
+  dst->body = rebase_str(src->body, from, copy);
+  dst->head = rebase_str(src->head, from, copy);
+  dst->message = rebase_str(src->message, from, copy);
+  for (int i = 0; i < MG_MAX_HTTP_HEADERS && src->headers[i].name.len > 0; i++) {
+    dst->headers[i].name = rebase_str(src->headers[i].name, from, copy);
+    dst->headers[i].value = rebase_str(src->headers[i].value, from, copy);
+  }
+}
+
+bool mg_submit_request(struct mg_connection *c, struct mg_http_message *hm,
+                       void (*handler_func)(struct mg_connection *c, struct mg_http_message *hm),
+                       mg_request_priority_t priority) {
+  struct mg_thread_data *data = calloc(1, sizeof(struct mg_thread_data));
+  if (!data) {
+    log_error("Failed to allocate memory for thread data");
+    mg_http_reply(c, 500, "", "Internal Server Error\n");
+    return false;
+  }
+
+  // Copy the HTTP message
+  data->message = mg_strdup(hm->message);
+  if (data->message.len == 0) {
+    log_error("Failed to duplicate HTTP message");
+    free(data);
+    mg_http_reply(c, 500, "", "Internal Server Error\n");
+    return false;
+  }
+  rebase_http_message(&data->hm, hm, data->message.buf);
+
+  // Set connection ID, manager, and handler function
+  data->conn_id = c->id;
+  data->mgr = c->mgr;
+  data->handler_func = handler_func;
+
+  if (!mg_worker_pool_submit(data, priority)) {
+    log_warn("API worker queue full, rejecting %s request: %.*s",
+             mg_priority_name(priority), (int)hm->uri.len, hm->uri.buf);
+    free_thread_data(data);
+    mg_http_reply(c, 503, "Content-Type: application/json\r\nRetry-After: 1\r\n",
+                  "{\"error\": \"Server busy, try again later\"}\n");
+    return false;
+  }
+
+  return true;
+}
+
+void mg_worker_pool_get_stats(mg_worker_pool_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+
+  pthread_mutex_lock(&s_pool.mutex);
+  *stats = s_pool.stats;
+  for (int i = 0; i < MG_PRIORITY_COUNT; i++) {
+    stats->queue_depth[i] = s_pool.queues[i].count;
+  }
+  pthread_mutex_unlock(&s_pool.mutex);
+}
+
+const char *mg_priority_name(mg_request_priority_t priority) {
+  if (priority < 0 || priority >= MG_PRIORITY_COUNT) {
+    return "unknown";
+  }
+  return s_priority_names[priority];
+}
+
 /**
  * @brief Handle HTTP request with multithreading
  * 
@@ -140,8 +504,8 @@ bool mg_handle_request_with_threading(struct mg_connection *c,
     // Return false to let the normal request handling continue
     return false;
   } else {
-    // Multithreading path - spawn a thread to handle the request
-    log_debug("Spawning thread to handle request: %.*s", 
+    // Multithreading path - queue the request for a worker thread
+    log_debug("Queueing request for a worker thread: %.*s", 
              (int)hm->uri.len, hm->uri.buf);
     
     // Extract URI for logging
@@ -152,31 +516,8 @@ bool mg_handle_request_with_threading(struct mg_connection *c,
     
     log_debug("Handling request with threading: %s", uri);
     
-    // Allocate thread data
-    struct mg_thread_data *data = 
-        (struct mg_thread_data *) calloc(1, sizeof(*data));
-    
-    if (!data) {
-      log_error("Failed to allocate memory for thread data");
-      mg_http_reply(c, 500, "", "Internal Server Error\n");
-      return true;
-    }
-    
-    // Copy the HTTP message
-    data->message = mg_strdup(hm->message);
-    if (data->message.len == 0) {
-      log_error("Failed to duplicate HTTP message");
-      free(data);
-      mg_http_reply(c, 500, "", "Internal Server Error\n");
-      return true;
-    }
-    
-    // Set connection ID, manager, and handler function
-    data->conn_id = c->id;
-    data->mgr = c->mgr;
-    
-    // Start thread
-    mg_start_thread(mg_thread_function, data);
+    // Queue the request; an error response has been sent if this fails
+    mg_submit_request(c, hm, NULL, MG_PRIORITY_NORMAL);
     
     return true;
   }
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "web/timeline_manifest_cache.h"
+#include "core/config.h"
+#include "core/logger.h"
+
+typedef struct {
+    char stream_name[MAX_STREAM_NAME];
+    time_t start_time;
+    time_t end_time;
+    uint64_t version;
+    uint64_t last_used;
+    timeline_manifest_t *manifest;      // NULL for a free slot
+} manifest_cache_entry_t;
+
+static manifest_cache_entry_t cache[TIMELINE_MANIFEST_CACHE_SIZE];
+static uint64_t use_counter = 0;
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+timeline_manifest_t *timeline_manifest_create(const char *data, size_t size) {
+    timeline_manifest_t *manifest = malloc(sizeof(timeline_manifest_t) + size + 1);
+    if (!manifest) {
+        log_error("Failed to allocate memory for timeline manifest");
+        return NULL;
+    }
+
+    atomic_init(&manifest->refcount, 1);
+    manifest->size = size;
+    memcpy(manifest->data, data, size);
+    manifest->data[size] = '\0';
+    return manifest;
+}
+
+void timeline_manifest_release(timeline_manifest_t *manifest) {
+    if (manifest && atomic_fetch_sub(&manifest->refcount, 1) == 1) {
+        free(manifest);
+    }
+}
+
+static bool entry_matches(const manifest_cache_entry_t *entry, const char *stream_name,
+                          time_t start_time, time_t end_time, uint64_t version) {
+    return entry->manifest && entry->version == version && entry->start_time == start_time &&
+           entry->end_time == end_time && strcmp(entry->stream_name, stream_name) == 0;
+}
+
+timeline_manifest_t *timeline_manifest_cache_get(const char *stream_name, time_t start_time,
+                                                 time_t end_time, uint64_t version) {
+    if (!stream_name) {
+        return NULL;
+    }
+
+    timeline_manifest_t *manifest = NULL;
+
+    pthread_mutex_lock(&cache_mutex);
+    for (int i = 0; i < TIMELINE_MANIFEST_CACHE_SIZE; i++) {
+        if (entry_matches(&cache[i], stream_name, start_time, end_time, version)) {
+            cache[i].last_used = ++use_counter;
+            manifest = cache[i].manifest;
+            atomic_fetch_add(&manifest->refcount, 1);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache_mutex);
+
+    return manifest;
+}
+
+void timeline_manifest_cache_put(const char *stream_name, time_t start_time, time_t end_time,
+                                 uint64_t version, timeline_manifest_t *manifest) {
+    if (!stream_name || !manifest || manifest->size > TIMELINE_MANIFEST_CACHE_MAX_SIZE) {
+        return;
+    }
+
+    timeline_manifest_t *evicted = NULL;
+
+    pthread_mutex_lock(&cache_mutex);
+
+    // Replace a concurrent build of the same manifest, else the least recently used slot
+    int slot = 0;
+    for (int i = 0; i < TIMELINE_MANIFEST_CACHE_SIZE; i++) {
+        if (entry_matches(&cache[i], stream_name, start_time, end_time, version)) {
+            slot = i;
+            break;
+        }
+        if (!cache[i].manifest || (cache[slot].manifest && cache[i].last_used < cache[slot].last_used)) {
+            slot = i;
+        }
+    }
+
+    manifest_cache_entry_t *entry = &cache[slot];
+    evicted = entry->manifest;
+
+    strncpy(entry->stream_name, stream_name, sizeof(entry->stream_name) - 1);
+    entry->stream_name[sizeof(entry->stream_name) - 1] = '\0';
+    entry->start_time = start_time;
+    entry->end_time = end_time;
+    entry->version = version;
+    entry->last_used = ++use_counter;
+    entry->manifest = manifest;
+    atomic_fetch_add(&manifest->refcount, 1);
+
+    pthread_mutex_unlock(&cache_mutex);
+
+    timeline_manifest_release(evicted);
+}
+
+void timeline_manifest_cache_clear(void) {
+    pthread_mutex_lock(&cache_mutex);
+    for (int i = 0; i < TIMELINE_MANIFEST_CACHE_SIZE; i++) {
+        timeline_manifest_release(cache[i].manifest);
+        cache[i].manifest = NULL;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+}
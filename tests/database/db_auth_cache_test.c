@@ -0,0 +1,144 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "database/db_auth_cache.h"
+#include "core/config.h"
+#include "core/logger.h"
+
+#include "test_utils.h"
+
+// The cache reads its TTL from the global configuration
+config_t g_config;
+
+static void store_session(const char *token, int64_t user_id, time_t expires_at) {
+    auth_cache_store_session(token, user_id, expires_at, auth_cache_generation());
+}
+
+static bool session_cached(const char *token, int64_t expected_user_id) {
+    int64_t user_id = -1;
+    return auth_cache_lookup_session(token, &user_id) && user_id == expected_user_id;
+}
+
+static bool credentials_cached(const char *username, const char *password, int64_t expected_user_id) {
+    int64_t user_id = -1;
+    return auth_cache_lookup_credentials(username, password, &user_id) && user_id == expected_user_id;
+}
+
+// Sessions are found until invalidated, one by one or per user
+static int test_sessions(void) {
+    time_t expires = time(NULL) + 3600;
+
+    store_session("token-a", 1, expires);
+    store_session("token-b", 1, expires);
+    store_session("token-c", 2, expires);
+
+    CHECK(session_cached("token-a", 1), "stored session not found");
+    CHECK(session_cached("token-c", 2), "stored session not found");
+    CHECK(!session_cached("token-unknown", 0), "unknown session found");
+
+    auth_cache_invalidate_session("token-a");
+    CHECK(!session_cached("token-a", 1), "invalidated session still found");
+    CHECK(session_cached("token-b", 1), "other session of the user lost");
+
+    auth_cache_invalidate_user_sessions(1);
+    CHECK(!session_cached("token-b", 1), "session of an invalidated user still found");
+    CHECK(session_cached("token-c", 2), "session of another user lost");
+
+    // Sessions expiring before the TTL are only kept until they expire
+    store_session("token-expired", 3, time(NULL) - 1);
+    CHECK(!session_cached("token-expired", 3), "expired session found");
+
+    auth_cache_clear();
+    CHECK(!session_cached("token-c", 2), "session found after clear");
+
+    printf("Sessions: lookups follow invalidation and expiry\n");
+    return 0;
+}
+
+// Credentials only match the exact pair, until the user changes
+static int test_credentials(void) {
+    auth_cache_store_credentials("alice", "secret", 10, auth_cache_generation());
+    auth_cache_store_credentials("bob", "hunter2", 11, auth_cache_generation());
+
+    CHECK(credentials_cached("alice", "secret", 10), "stored credentials not found");
+    CHECK(!credentials_cached("alice", "wrong", 10), "wrong password accepted");
+    CHECK(!credentials_cached("alice", "hunter2", 10), "password of another user accepted");
+    CHECK(!credentials_cached("carol", "secret", 10), "unknown user accepted");
+
+    // A new password replaces the cached one
+    auth_cache_store_credentials("alice", "changed", 10, auth_cache_generation());
+    CHECK(credentials_cached("alice", "changed", 10), "new password not found");
+    CHECK(!credentials_cached("alice", "secret", 10), "previous password still accepted");
+
+    auth_cache_invalidate_user_credentials(10);
+    CHECK(!credentials_cached("alice", "changed", 10), "credentials of an invalidated user still found");
+    CHECK(credentials_cached("bob", "hunter2", 11), "credentials of another user lost");
+
+    auth_cache_clear();
+    printf("Credentials: only the exact pair matches\n");
+    return 0;
+}
+
+// A validation that raced with an invalidation is not stored
+static int test_stale_generation(void) {
+    uint64_t generation = auth_cache_generation();
+
+    // The row changes while the validation queries the database
+    auth_cache_invalidate_user_sessions(20);
+    auth_cache_invalidate_user_credentials(20);
+
+    auth_cache_store_session("token-stale", 20, time(NULL) + 3600, generation);
+    auth_cache_store_credentials("dave", "secret", 20, generation);
+
+    CHECK(!session_cached("token-stale", 20), "session stored with a stale generation");
+    CHECK(!credentials_cached("dave", "secret", 20), "credentials stored with a stale generation");
+
+    printf("Stale generation: racing validations not stored\n");
+    return 0;
+}
+
+// Entries live for the configured TTL, 0 disables the cache
+static int test_ttl(void) {
+    g_config.web_auth_cache_ttl = 1;
+    store_session("token-ttl", 30, time(NULL) + 3600);
+    CHECK(session_cached("token-ttl", 30), "session not found within the TTL");
+    sleep(2);
+    CHECK(!session_cached("token-ttl", 30), "session found after the TTL");
+
+    g_config.web_auth_cache_ttl = 0;
+    store_session("token-disabled", 31, time(NULL) + 3600);
+    auth_cache_store_credentials("erin", "secret", 31, auth_cache_generation());
+    CHECK(!session_cached("token-disabled", 31), "session cached with the cache disabled");
+    CHECK(!credentials_cached("erin", "secret", 31), "credentials cached with the cache disabled");
+
+    printf("TTL: entries expire and a TTL of 0 disables the cache\n");
+    return 0;
+}
+
+// Main test function
+int main(void) {
+    // Initialize logger
+    init_logger();
+
+    printf("=== Authentication Cache Test ===\n");
+
+    memset(&g_config, 0, sizeof(g_config));
+    g_config.web_auth_cache_ttl = 60;
+
+    int failed = 0;
+    RUN_TEST(failed, "Sessions", test_sessions());
+    RUN_TEST(failed, "Credentials", test_credentials());
+    RUN_TEST(failed, "Stale generation", test_stale_generation());
+    RUN_TEST(failed, "TTL", test_ttl());
+
+    return test_summary(failed);
+}
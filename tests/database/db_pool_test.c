@@ -0,0 +1,193 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sqlite3.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "database/db_core.h"
+#include "database/db_pool.h"
+#include "core/logger.h"
+
+#include "test_utils.h"
+
+// Test database path
+#define TEST_DB_PATH "/tmp/test_db_pool.sqlite"
+
+#define TEST_READERS 2
+
+// Reader borrowed by the blocking thread
+static sqlite3 *_Atomic borrowed_reader;
+
+static void *acquire_thread_func(void *arg) {
+    (void)arg;
+    sqlite3 *conn = db_acquire_reader();
+    atomic_store(&borrowed_reader, conn);
+    return NULL;
+}
+
+static int count_rows(sqlite3 *conn) {
+    sqlite3_stmt *stmt;
+    int count = -1;
+
+    if (db_prepare_cached(conn, "SELECT COUNT(*) FROM pool_test;", &stmt) != SQLITE_OK) {
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        count = sqlite3_column_int(stmt, 0);
+    }
+    db_release_statement(stmt);
+
+    return count;
+}
+
+static int writer_exec(const char *sql) {
+    pthread_mutex_lock(get_db_mutex());
+    int rc = sqlite3_exec(get_db_handle(), sql, NULL, NULL, NULL);
+    pthread_mutex_unlock(get_db_mutex());
+    return rc;
+}
+
+// Every reader is handed to one borrower at a time, the next borrower waits
+static int test_borrowing(void) {
+    sqlite3 *first = db_acquire_reader();
+    sqlite3 *second = db_acquire_reader();
+
+    CHECK(first && second, "could not borrow %d readers", TEST_READERS);
+    CHECK(first != second, "the same reader was borrowed twice");
+    CHECK(first != get_db_handle() && second != get_db_handle(), "the writer connection was lent as a reader");
+
+    pthread_t thread;
+    atomic_store(&borrowed_reader, NULL);
+    CHECK(pthread_create(&thread, NULL, acquire_thread_func, NULL) == 0, "could not start thread");
+
+    usleep(200000);
+    bool blocked = atomic_load(&borrowed_reader) == NULL;
+
+    db_release_reader(first);
+    pthread_join(thread, NULL);
+    sqlite3 *third = atomic_load(&borrowed_reader);
+
+    CHECK(blocked, "borrower did not wait with every reader taken");
+    CHECK(third == first, "released reader was not handed to the waiting borrower");
+
+    db_release_reader(third);
+    db_release_reader(second);
+
+    printf("Borrowing: readers are exclusive, borrowers wait for a free one\n");
+    return 0;
+}
+
+// Readers see committed rows only and cannot write
+static int test_isolation(void) {
+    CHECK(writer_exec("CREATE TABLE pool_test (id INTEGER PRIMARY KEY);") == SQLITE_OK, "could not create table");
+
+    sqlite3 *reader = db_acquire_reader();
+    CHECK(reader, "could not borrow a reader");
+
+    // Keep the writer transaction open while the reader looks
+    pthread_mutex_lock(get_db_mutex());
+    sqlite3_exec(get_db_handle(), "BEGIN; INSERT INTO pool_test (id) VALUES (1);", NULL, NULL, NULL);
+    int during = count_rows(reader);
+    sqlite3_exec(get_db_handle(), "COMMIT;", NULL, NULL, NULL);
+    pthread_mutex_unlock(get_db_mutex());
+    int after = count_rows(reader);
+
+    int write_rc = sqlite3_exec(reader, "INSERT INTO pool_test (id) VALUES (2);", NULL, NULL, NULL);
+
+    db_release_reader(reader);
+
+    CHECK(during == 0, "reader saw %d uncommitted rows", during);
+    CHECK(after == 1, "reader saw %d rows after commit, expected 1", after);
+    CHECK(write_rc != SQLITE_OK, "write through a reader succeeded");
+
+    printf("Isolation: readers see committed rows only and are read-only\n");
+    return 0;
+}
+
+// Statements stay prepared on their connection and come back reset
+static int test_statement_cache(void) {
+    sqlite3 *reader = db_acquire_reader();
+    CHECK(reader, "could not borrow a reader");
+
+    const char *sql = "SELECT id FROM pool_test WHERE id = ?;";
+    sqlite3_stmt *first = NULL;
+    sqlite3_stmt *second = NULL;
+    int rc = db_prepare_cached(reader, sql, &first);
+    int found = 0;
+    if (rc == SQLITE_OK) {
+        sqlite3_bind_int(first, 1, 1);
+        found = sqlite3_step(first) == SQLITE_ROW;
+        db_release_statement(first);
+        rc = db_prepare_cached(reader, sql, &second);
+    }
+    int found_unbound = 1;
+    if (rc == SQLITE_OK) {
+        // Bindings were cleared on release, NULL matches nothing
+        found_unbound = sqlite3_step(second) == SQLITE_ROW;
+        db_release_statement(second);
+    }
+
+    db_release_reader(reader);
+
+    CHECK(rc == SQLITE_OK, "could not prepare cached statement");
+    CHECK(found, "cached statement did not find the row");
+    CHECK(first == second, "statement was prepared again instead of reused");
+    CHECK(!found_unbound, "bindings survived the release of the statement");
+
+    printf("Statement cache: statements reused with bindings cleared\n");
+    return 0;
+}
+
+// Without readers, reads go to the writer connection
+static int test_disabled_pool(void) {
+    shutdown_database();
+    db_pool_set_reader_count(0);
+    CHECK(init_database(TEST_DB_PATH) == 0, "could not reopen database");
+
+    sqlite3 *conn = db_acquire_reader();
+    bool is_writer = conn == get_db_handle();
+    int count = conn ? count_rows(conn) : -1;
+    if (conn) {
+        db_release_reader(conn);
+    }
+
+    CHECK(is_writer, "reads did not go to the writer connection");
+    CHECK(count == 1, "writer connection counted %d rows, expected 1", count);
+
+    printf("Disabled pool: reads use the writer connection\n");
+    return 0;
+}
+
+// Main test function
+int main(void) {
+    // Initialize logger
+    init_logger();
+
+    printf("=== Database Reader Pool Test ===\n");
+
+    unlink(TEST_DB_PATH);
+    db_pool_set_reader_count(TEST_READERS);
+
+    if (init_database(TEST_DB_PATH) != 0) {
+        printf("Test failed: Could not initialize database\n");
+        return 1;
+    }
+
+    int failed = 0;
+    RUN_TEST(failed, "Borrowing", test_borrowing());
+    RUN_TEST(failed, "Isolation", test_isolation());
+    RUN_TEST_IF_PASSED(failed, "Statement cache", test_statement_cache());
+    RUN_TEST_IF_PASSED(failed, "Disabled pool", test_disabled_pool());
+
+    shutdown_database();
+    unlink(TEST_DB_PATH);
+
+    return test_summary(failed);
+}
@@ -0,0 +1,138 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sqlite3.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "database/db_core.h"
+#include "database/db_recordings.h"
+#include "database/db_recording_index.h"
+#include "core/logger.h"
+
+#include "test_utils.h"
+
+// Test database path
+#define TEST_DB_PATH "/tmp/test_db_recording_index.sqlite"
+
+// Check that a lookup finds the expected file, or nothing when expected is NULL
+#define CHECK_FIND(stream, timestamp, expected) do { \
+    char found_path[256] = {0}; \
+    int found = recording_index_find(stream, timestamp, found_path, sizeof(found_path)); \
+    if (expected) { \
+        CHECK(found == 1 && strcmp(found_path, expected ? expected : "") == 0, \
+              "%s at %ld: expected %s, got %s", stream, (long)(timestamp), \
+              expected ? expected : "", found == 1 ? found_path : "nothing"); \
+    } else { \
+        CHECK(found == 0, "%s at %ld: expected nothing, got %s", stream, (long)(timestamp), \
+              found == 1 ? found_path : "an error"); \
+    } \
+} while (0)
+
+static const char *const NONE = NULL;
+
+static uint64_t add_recording(const char *stream, const char *path, time_t start, time_t end) {
+    recording_metadata_t metadata;
+    memset(&metadata, 0, sizeof(metadata));
+
+    strncpy(metadata.stream_name, stream, sizeof(metadata.stream_name) - 1);
+    strncpy(metadata.file_path, path, sizeof(metadata.file_path) - 1);
+    metadata.start_time = start;
+    metadata.end_time = end;
+    metadata.size_bytes = 1024;
+    strncpy(metadata.codec, "h264", sizeof(metadata.codec) - 1);
+    metadata.is_complete = end != 0;
+
+    return add_recording_metadata(&metadata);
+}
+
+// Lookups of recordings loaded from the database and reported afterwards
+static int test_lookup(void) {
+    CHECK(add_recording("cam1", "/rec/cam1/a.mp4", 1000, 1100) != 0, "could not add recording");
+    uint64_t b = add_recording("cam1", "/rec/cam1/b.mp4", 1200, 1300);
+    CHECK(b != 0, "could not add recording");
+
+    // First lookup loads the stream from the database
+    CHECK_FIND("cam1", 1000, "/rec/cam1/a.mp4");
+    CHECK_FIND("cam1", 1050, "/rec/cam1/a.mp4");
+    CHECK_FIND("cam1", 1100, "/rec/cam1/a.mp4");
+    CHECK_FIND("cam1", 1150, "/rec/cam1/b.mp4");
+    CHECK_FIND("cam1", 1130, NONE);
+    CHECK_FIND("cam1", 500, NONE);
+    CHECK_FIND("cam1", 1350, NONE);
+
+    // Recordings added to a loaded stream are reported to the index
+    uint64_t c = add_recording("cam1", "/rec/cam1/c.mp4", 1500, 0);
+    CHECK(c != 0, "could not add recording");
+    CHECK_FIND("cam1", 1450, "/rec/cam1/c.mp4");
+    CHECK_FIND("cam1", 1400, NONE);
+    CHECK_FIND("cam1", 5000, "/rec/cam1/c.mp4");
+
+    // Finishing the ongoing recording bounds it
+    CHECK(update_recording_metadata(c, 1600, 2048, true) == 0, "could not update recording");
+    CHECK_FIND("cam1", 1600, "/rec/cam1/c.mp4");
+    CHECK_FIND("cam1", 5000, NONE);
+
+    // Streams are indexed separately
+    CHECK(add_recording("cam2", "/rec/cam2/a.mp4", 1000, 1100) != 0, "could not add recording");
+    CHECK_FIND("cam2", 1050, "/rec/cam2/a.mp4");
+    CHECK_FIND("cam2", 1250, NONE);
+    CHECK_FIND("cam3", 1050, NONE);
+
+    // Deleted recordings are no longer found
+    CHECK(delete_recording_metadata(b) == 0, "could not delete recording");
+    CHECK_FIND("cam1", 1250, NONE);
+    CHECK_FIND("cam1", 1050, "/rec/cam1/a.mp4");
+
+    printf("Lookup: intervals, ongoing recordings and the match window resolved\n");
+    return 0;
+}
+
+// Rows changed behind the index are picked up after an invalidation
+static int test_invalidate(void) {
+    pthread_mutex_lock(get_db_mutex());
+    int rc = sqlite3_exec(get_db_handle(),
+                          "INSERT INTO recordings (stream_name, file_path, start_time, end_time, size_bytes, "
+                          "is_complete) VALUES ('cam1', '/rec/cam1/d.mp4', 3000, 3100, 1024, 1);",
+                          NULL, NULL, NULL);
+    pthread_mutex_unlock(get_db_mutex());
+    CHECK(rc == SQLITE_OK, "could not insert recording");
+
+    CHECK_FIND("cam1", 3050, NONE);
+    recording_index_invalidate();
+    CHECK_FIND("cam1", 3050, "/rec/cam1/d.mp4");
+    CHECK_FIND("cam1", 1050, "/rec/cam1/a.mp4");
+
+    printf("Invalidate: streams reloaded from the database\n");
+    return 0;
+}
+
+// Main test function
+int main(void) {
+    // Initialize logger
+    init_logger();
+
+    printf("=== Recording Index Test ===\n");
+
+    unlink(TEST_DB_PATH);
+
+    if (init_database(TEST_DB_PATH) != 0) {
+        printf("Test failed: Could not initialize database\n");
+        return 1;
+    }
+
+    int failed = 0;
+    RUN_TEST(failed, "Lookup", test_lookup());
+    RUN_TEST_IF_PASSED(failed, "Invalidate", test_invalidate());
+
+    recording_index_cleanup();
+    shutdown_database();
+    unlink(TEST_DB_PATH);
+
+    return test_summary(failed);
+}
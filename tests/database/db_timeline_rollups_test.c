@@ -0,0 +1,285 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sqlite3.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "database/db_core.h"
+#include "database/db_recordings.h"
+#include "database/db_timeline_rollups.h"
+#include "core/logger.h"
+
+#include "test_utils.h"
+
+// Test database path
+#define TEST_DB_PATH "/tmp/test_db_timeline_rollups.sqlite"
+
+// 2024-03-10, the day New York switches to daylight saving time
+#define DST_DAY_START 1710046800    // 00:00 EST
+#define DST_DAY_END 1710129600      // 00:00 EDT the next day
+
+static int add_coverage(const char *stream, time_t start, time_t end, int sign) {
+    pthread_mutex_lock(get_db_mutex());
+    int rc = timeline_rollup_add_coverage(get_db_handle(), stream, start, end, sign);
+    pthread_mutex_unlock(get_db_mutex());
+    return rc;
+}
+
+/**
+ * Sum a column of the rollups of a stream at one bucket length
+ *
+ * @param resolution Resolution index, -1 for all of them
+ */
+static long long sum_rollups(const char *stream, const char *column, int resolution) {
+    char sql[256];
+    sqlite3_stmt *stmt;
+    long long sum = -1;
+
+    snprintf(sql, sizeof(sql), "SELECT COALESCE(SUM(%s), 0) FROM timeline_rollups "
+             "WHERE stream_name = ?1 AND (?2 < 0 OR resolution = ?2);", column);
+
+    pthread_mutex_lock(get_db_mutex());
+    if (sqlite3_prepare_v2(get_db_handle(), sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, stream, -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, resolution < 0 ? -1 : timeline_rollup_resolution(resolution));
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            sum = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    pthread_mutex_unlock(get_db_mutex());
+
+    return sum;
+}
+
+// Subtracting a range undoes adding it, at every bucket length
+static int test_coverage_symmetry(void) {
+    static const time_t ranges[][2] = {
+        {10, 50},                   // Inside one minute
+        {50, 250},                  // Across minutes
+        {3500, 3700},               // Across an hour
+        {86000, 90000},             // Across a day
+        {100, 2 * 86400 + 100},     // Several days
+    };
+    const int range_count = sizeof(ranges) / sizeof(ranges[0]);
+
+    for (int r = 0; r < range_count; r++) {
+        time_t start = ranges[r][0];
+        time_t end = ranges[r][1];
+
+        CHECK(add_coverage("sym", start, end, 1) == 0, "could not add %ld-%ld", (long)start, (long)end);
+        for (int i = 0; i < TIMELINE_ROLLUP_RESOLUTIONS; i++) {
+            long long sum = sum_rollups("sym", "coverage", i);
+            CHECK(sum == end - start, "%ld-%ld at %ds: coverage %lld, expected %ld",
+                  (long)start, (long)end, timeline_rollup_resolution(i), sum, (long)(end - start));
+        }
+
+        CHECK(add_coverage("sym", start, end, -1) == 0, "could not subtract %ld-%ld", (long)start, (long)end);
+        CHECK(sum_rollups("sym", "1", -1) == 0, "rows left after subtracting %ld-%ld", (long)start, (long)end);
+    }
+
+    // Overlapping ranges: removing one leaves the other intact
+    CHECK(add_coverage("sym", 1000, 5000, 1) == 0, "could not add range");
+    CHECK(add_coverage("sym", 3000, 9000, 1) == 0, "could not add range");
+    CHECK(add_coverage("sym", 1000, 5000, -1) == 0, "could not subtract range");
+    for (int i = 0; i < TIMELINE_ROLLUP_RESOLUTIONS; i++) {
+        long long sum = sum_rollups("sym", "coverage", i);
+        CHECK(sum == 6000, "overlap at %ds: coverage %lld, expected 6000", timeline_rollup_resolution(i), sum);
+    }
+    CHECK(add_coverage("sym", 3000, 9000, -1) == 0, "could not subtract range");
+    CHECK(sum_rollups("sym", "1", -1) == 0, "rows left after subtracting overlapping ranges");
+
+    printf("Coverage symmetry: %d ranges added and subtracted without residue\n", range_count);
+    return 0;
+}
+
+// Finalizing a recording adds its coverage, deleting it takes it away
+static int test_recording_lifecycle(void) {
+    recording_metadata_t metadata;
+    memset(&metadata, 0, sizeof(metadata));
+    strncpy(metadata.stream_name, "rec", sizeof(metadata.stream_name) - 1);
+    strncpy(metadata.file_path, "/rec/rec/a.mp4", sizeof(metadata.file_path) - 1);
+    metadata.start_time = 3590;
+
+    uint64_t id = add_recording_metadata(&metadata);
+    CHECK(id != 0, "could not add recording");
+    CHECK(update_recording_metadata(id, 3750, 1024, true) == 0, "could not finalize recording");
+
+    timeline_heatmap_bucket_t buckets[8];
+    int count = get_timeline_heatmap("rec", 3500, 3800, 0, buckets, 8);
+    CHECK(count == 4, "expected 4 minute buckets, got %d", count);
+    CHECK(buckets[0].start == 3540 && buckets[0].coverage == 10, "first bucket %ld covers %d",
+          (long)buckets[0].start, buckets[0].coverage);
+    CHECK(buckets[1].start == 3600 && buckets[1].coverage == 60, "second bucket %ld covers %d",
+          (long)buckets[1].start, buckets[1].coverage);
+    CHECK(buckets[2].start == 3660 && buckets[2].coverage == 60, "third bucket %ld covers %d",
+          (long)buckets[2].start, buckets[2].coverage);
+    CHECK(buckets[3].start == 3720 && buckets[3].coverage == 30, "fourth bucket %ld covers %d",
+          (long)buckets[3].start, buckets[3].coverage);
+
+    // Finalizing again replaces the range instead of adding to it
+    CHECK(update_recording_metadata(id, 3760, 2048, true) == 0, "could not finalize recording again");
+    CHECK(sum_rollups("rec", "coverage", 0) == 170, "coverage %lld after refinalizing, expected 170",
+          sum_rollups("rec", "coverage", 0));
+
+    CHECK(delete_recording_metadata(id) == 0, "could not delete recording");
+    CHECK(sum_rollups("rec", "1", -1) == 0, "rows left after deleting the recording");
+
+    printf("Recording lifecycle: coverage follows finalize and delete\n");
+    return 0;
+}
+
+// Adding, finalizing and deleting recordings changes the version of their stream only
+static int test_stream_generations(void) {
+    uint64_t other = get_stream_recording_generation("other");
+    uint64_t version = get_stream_recording_generation("gen");
+
+    recording_metadata_t metadata;
+    memset(&metadata, 0, sizeof(metadata));
+    strncpy(metadata.stream_name, "gen", sizeof(metadata.stream_name) - 1);
+    strncpy(metadata.file_path, "/rec/gen/a.mp4", sizeof(metadata.file_path) - 1);
+    metadata.start_time = 7200;
+
+    uint64_t id = add_recording_metadata(&metadata);
+    CHECK(id != 0, "could not add recording");
+    uint64_t added = get_stream_recording_generation("gen");
+    CHECK(added != version, "version unchanged by adding a recording");
+
+    CHECK(update_recording_metadata(id, 7260, 1024, true) == 0, "could not finalize recording");
+    uint64_t finalized = get_stream_recording_generation("gen");
+    CHECK(finalized != added, "version unchanged by finalizing a recording");
+
+    CHECK(delete_recording_metadata(id) == 0, "could not delete recording");
+    CHECK(get_stream_recording_generation("gen") != finalized, "version unchanged by deleting a recording");
+
+    CHECK(get_stream_recording_generation("other") == other, "version of another stream changed");
+
+    printf("Stream generations: only the changed stream gets a new version\n");
+    return 0;
+}
+
+// Motion is counted apart from object detections
+static int test_detections(void) {
+    detection_t first[3];
+    detection_t second[1];
+    memset(first, 0, sizeof(first));
+    memset(second, 0, sizeof(second));
+    strncpy(first[0].label, "person", MAX_LABEL_LENGTH - 1);
+    strncpy(first[1].label, "person", MAX_LABEL_LENGTH - 1);
+    strncpy(first[2].label, TIMELINE_ROLLUP_MOTION_LABEL, MAX_LABEL_LENGTH - 1);
+    strncpy(second[0].label, "car", MAX_LABEL_LENGTH - 1);
+
+    pthread_mutex_lock(get_db_mutex());
+    int rc = timeline_rollup_add_detections(get_db_handle(), "det", 3605, first, 3);
+    if (rc == 0) {
+        rc = timeline_rollup_add_detections(get_db_handle(), "det", 3670, second, 1);
+    }
+    pthread_mutex_unlock(get_db_mutex());
+    CHECK(rc == 0, "could not add detections");
+
+    timeline_heatmap_bucket_t buckets[8];
+    int count = get_timeline_heatmap("det", 3500, 3800, 0, buckets, 8);
+    CHECK(count == 2, "expected 2 minute buckets, got %d", count);
+    CHECK(buckets[0].start == 3600 && buckets[0].motion_count == 1 && buckets[0].detection_count == 2,
+          "bucket %ld has %d motion and %d detections", (long)buckets[0].start,
+          buckets[0].motion_count, buckets[0].detection_count);
+    CHECK(buckets[1].start == 3660 && buckets[1].motion_count == 0 && buckets[1].detection_count == 1,
+          "bucket %ld has %d motion and %d detections", (long)buckets[1].start,
+          buckets[1].motion_count, buckets[1].detection_count);
+
+    count = get_timeline_heatmap("det", 0, 86400, 2, buckets, 8);
+    CHECK(count == 1 && buckets[0].start == 3600 && buckets[0].detection_count == 3,
+          "hour bucket has %d detections", count == 1 ? buckets[0].detection_count : -1);
+
+    timeline_heatmap_label_t labels[8];
+    count = get_timeline_heatmap_labels("det", 3500, 3800, 0, labels, 8);
+    int person = 0, car = 0;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(labels[i].label, "person") == 0 && labels[i].start == 3600) person = labels[i].count;
+        if (strcmp(labels[i].label, "car") == 0 && labels[i].start == 3660) car = labels[i].count;
+    }
+    CHECK(person == 2 && car == 1, "label counts person %d, car %d", person, car);
+
+    printf("Detections: motion and labels counted per bucket\n");
+    return 0;
+}
+
+static int check_day_buckets(const char *zone, const time_t *starts, const int *coverage, int expected) {
+    timeline_heatmap_bucket_t buckets[8];
+    int count = get_timeline_heatmap("day", DST_DAY_START - 86400, DST_DAY_END + 86400, 3, buckets, 8);
+
+    CHECK(count == expected, "%s: expected %d day buckets, got %d", zone, expected, count);
+    for (int i = 0; i < count; i++) {
+        CHECK(buckets[i].start == starts[i] && buckets[i].coverage == coverage[i],
+              "%s: day bucket %ld covers %d, expected %ld covering %d", zone,
+              (long)buckets[i].start, buckets[i].coverage, (long)starts[i], coverage[i]);
+    }
+    return 0;
+}
+
+// Day buckets run from local midnight, and follow a change of zone
+static int test_local_days(void) {
+    recording_metadata_t metadata;
+    memset(&metadata, 0, sizeof(metadata));
+    strncpy(metadata.stream_name, "day", sizeof(metadata.stream_name) - 1);
+    strncpy(metadata.file_path, "/rec/day/a.mp4", sizeof(metadata.file_path) - 1);
+    metadata.start_time = DST_DAY_START;
+
+    uint64_t id = add_recording_metadata(&metadata);
+    CHECK(id != 0, "could not add recording");
+    CHECK(update_recording_metadata(id, DST_DAY_END, 1024, true) == 0, "could not finalize recording");
+
+    // In UTC the local day of New York spans two days
+    const time_t utc_starts[] = {1710028800, 1710115200};
+    const int utc_coverage[] = {68400, 14400};
+    CHECK(check_day_buckets("UTC", utc_starts, utc_coverage, 2) == 0, "UTC day buckets");
+
+    // Reopening in another zone realigns the buckets, the DST day is 23 hours long
+    shutdown_database();
+    setenv("TZ", "America/New_York", 1);
+    tzset();
+    CHECK(init_database(TEST_DB_PATH) == 0, "could not reopen database");
+
+    const time_t local_starts[] = {DST_DAY_START};
+    const int local_coverage[] = {DST_DAY_END - DST_DAY_START};
+    CHECK(check_day_buckets("America/New_York", local_starts, local_coverage, 1) == 0, "local day buckets");
+
+    printf("Local days: day buckets aligned with local midnight\n");
+    return 0;
+}
+
+// Main test function
+int main(void) {
+    // Initialize logger
+    init_logger();
+
+    printf("=== Timeline Rollups Test ===\n");
+
+    setenv("TZ", "UTC", 1);
+    tzset();
+    unlink(TEST_DB_PATH);
+
+    if (init_database(TEST_DB_PATH) != 0) {
+        printf("Test failed: Could not initialize database\n");
+        return 1;
+    }
+
+    int failed = 0;
+    RUN_TEST(failed, "Coverage symmetry", test_coverage_symmetry());
+    RUN_TEST(failed, "Recording lifecycle", test_recording_lifecycle());
+    RUN_TEST(failed, "Stream generations", test_stream_generations());
+    RUN_TEST(failed, "Detections", test_detections());
+    RUN_TEST(failed, "Local days", test_local_days());
+
+    shutdown_database();
+    unlink(TEST_DB_PATH);
+
+    return test_summary(failed);
+}
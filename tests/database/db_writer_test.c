@@ -0,0 +1,247 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sqlite3.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "database/db_core.h"
+#include "database/db_writer.h"
+#include "core/logger.h"
+
+#include "test_utils.h"
+
+// Test database path
+#define TEST_DB_PATH "/tmp/test_db_writer.sqlite"
+
+// Writes queued before the one that is waited for
+#define GROUP_WRITES 50
+
+// Commit interval the writer is configured with
+#define COMMIT_INTERVAL_MS 1000
+
+// A row to insert, optionally failing after the insert
+typedef struct {
+    int id;
+    int fail_after_insert;
+} test_write_t;
+
+// Callback counters, the callbacks run on the writer thread
+static atomic_int committed_count;
+static atomic_int freed_count;
+
+static int insert_row(sqlite3 *db, void *arg, uint64_t *row_id) {
+    test_write_t *w = arg;
+    char sql[128];
+
+    snprintf(sql, sizeof(sql), "INSERT INTO writer_test (id, value) VALUES (%d, 'row %d');", w->id, w->id);
+    if (sqlite3_exec(db, sql, NULL, NULL, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    *row_id = (uint64_t)sqlite3_last_insert_rowid(db);
+
+    return w->fail_after_insert ? -1 : 0;
+}
+
+static void row_committed(void *arg, uint64_t row_id) {
+    (void)arg;
+    (void)row_id;
+    atomic_fetch_add(&committed_count, 1);
+}
+
+static void free_row(void *arg) {
+    free(arg);
+    atomic_fetch_add(&freed_count, 1);
+}
+
+static const db_write_ops_t insert_ops = {
+    .execute = insert_row,
+    .committed = row_committed,
+    .free_arg = free_row,
+};
+
+static int submit_row(int id, int fail_after_insert, db_write_future_t **future) {
+    test_write_t *w = calloc(1, sizeof(test_write_t));
+    if (!w) {
+        return -1;
+    }
+    w->id = id;
+    w->fail_after_insert = fail_after_insert;
+
+    return db_writer_submit(&insert_ops, w, future);
+}
+
+// Arguments are released after the futures complete, give the writer a moment
+static int wait_for_frees(int expected) {
+    for (int i = 0; i < 100 && atomic_load(&freed_count) < expected; i++) {
+        usleep(10000);
+    }
+    return atomic_load(&freed_count);
+}
+
+static int row_exists(int id) {
+    sqlite3_stmt *stmt;
+    int found = 0;
+
+    pthread_mutex_lock(get_db_mutex());
+    if (sqlite3_prepare_v2(get_db_handle(), "SELECT 1 FROM writer_test WHERE id = ?;", -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, id);
+        found = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+    pthread_mutex_unlock(get_db_mutex());
+
+    return found;
+}
+
+// Writes queued without waiting share the commit of the next waited write
+static int test_group_commit(void) {
+    uint64_t commits_before, writes_before, commits_after, writes_after;
+    db_write_future_t *future = NULL;
+    uint64_t row_id = 0;
+
+    atomic_store(&committed_count, 0);
+    atomic_store(&freed_count, 0);
+    db_writer_get_stats(&commits_before, &writes_before, NULL);
+
+    for (int i = 0; i < GROUP_WRITES; i++) {
+        CHECK(submit_row(1000 + i, 0, NULL) == 0, "submit of write %d failed", i);
+    }
+    CHECK(submit_row(1000 + GROUP_WRITES, 0, &future) == 0, "submit of waited write failed");
+    CHECK(db_write_future_wait(future, &row_id) == 0, "waited write was not committed");
+    CHECK(row_id == 1000 + GROUP_WRITES, "row ID %llu not passed to the future", (unsigned long long)row_id);
+
+    db_writer_get_stats(&commits_after, &writes_after, NULL);
+    CHECK(writes_after - writes_before == GROUP_WRITES + 1, "expected %d writes, counted %llu",
+          GROUP_WRITES + 1, (unsigned long long)(writes_after - writes_before));
+    CHECK(commits_after - commits_before <= 2, "%d writes took %llu commits",
+          GROUP_WRITES + 1, (unsigned long long)(commits_after - commits_before));
+    CHECK(atomic_load(&committed_count) == GROUP_WRITES + 1, "committed callback ran %d times",
+          atomic_load(&committed_count));
+    CHECK(wait_for_frees(GROUP_WRITES + 1) == GROUP_WRITES + 1, "free callback ran %d times",
+          atomic_load(&freed_count));
+
+    for (int i = 0; i <= GROUP_WRITES; i++) {
+        CHECK(row_exists(1000 + i), "row %d missing after commit", 1000 + i);
+    }
+
+    printf("Group commit: %d writes in %llu commits\n", GROUP_WRITES + 1,
+           (unsigned long long)(commits_after - commits_before));
+    return 0;
+}
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Keeping a future does not commit early, only blocking on it does
+static int test_held_future(void) {
+    uint64_t commits_before, writes_before, commits_after, writes_after;
+    db_write_future_t *held = NULL;
+
+    atomic_store(&freed_count, 0);
+    db_writer_get_stats(&commits_before, &writes_before, NULL);
+
+    CHECK(submit_row(3000, 0, &held) == 0, "submit of held write failed");
+    // Another write arrives well within the commit interval
+    usleep(100000);
+    CHECK(submit_row(3001, 0, NULL) == 0, "submit of second write failed");
+
+    int64_t start = now_ms();
+    int result = db_write_future_wait(held, NULL);
+    int64_t elapsed = now_ms() - start;
+
+    db_writer_get_stats(&commits_after, &writes_after, NULL);
+    CHECK(result == 0, "held write was not committed");
+    CHECK(writes_after - writes_before == 2, "expected 2 writes, counted %llu",
+          (unsigned long long)(writes_after - writes_before));
+    CHECK(commits_after - commits_before == 1, "held and second write took %llu commits",
+          (unsigned long long)(commits_after - commits_before));
+    CHECK(elapsed < COMMIT_INTERVAL_MS - 300, "waiting took %lld ms, the interval was not cut short",
+          (long long)elapsed);
+    CHECK(row_exists(3000) && row_exists(3001), "rows missing after commit");
+    CHECK(wait_for_frees(2) == 2, "free callback ran %d times", atomic_load(&freed_count));
+
+    printf("Held future: shared the commit, waiting committed after %lld ms\n", (long long)elapsed);
+    return 0;
+}
+
+// A failing write is rolled back alone, the rest of its batch commits
+static int test_rollback(void) {
+    db_write_future_t *first = NULL, *duplicate = NULL, *aborted = NULL, *last = NULL;
+    int rc = 0;
+
+    atomic_store(&committed_count, 0);
+    atomic_store(&freed_count, 0);
+
+    // Hold the writer back so the failing writes share a transaction with the last one
+    pthread_mutex_lock(get_db_mutex());
+    rc |= submit_row(2000, 0, &first);
+    rc |= submit_row(2000, 0, &duplicate);
+    rc |= submit_row(2001, 1, &aborted);
+    rc |= submit_row(2002, 0, &last);
+    pthread_mutex_unlock(get_db_mutex());
+    CHECK(rc == 0 && first && duplicate && aborted && last, "submit failed");
+
+    CHECK(db_write_future_wait(first, NULL) == 0, "write before the failures was not committed");
+    CHECK(db_write_future_wait(duplicate, NULL) != 0, "duplicate key write reported success");
+    CHECK(db_write_future_wait(aborted, NULL) != 0, "failed write reported success");
+    CHECK(db_write_future_wait(last, NULL) == 0, "write after the failures was not committed");
+
+    CHECK(row_exists(2000), "row of the first write missing");
+    CHECK(!row_exists(2001), "insert of the failed write was not rolled back");
+    CHECK(row_exists(2002), "row of the last write missing");
+    CHECK(atomic_load(&committed_count) == 2, "committed callback ran %d times, expected 2",
+          atomic_load(&committed_count));
+    CHECK(wait_for_frees(4) == 4, "free callback ran %d times, expected 4", atomic_load(&freed_count));
+
+    printf("Rollback: failed writes rolled back alone\n");
+    return 0;
+}
+
+// Main test function
+int main(void) {
+    // Initialize logger
+    init_logger();
+
+    printf("=== Database Writer Test ===\n");
+
+    unlink(TEST_DB_PATH);
+
+    // A long interval, so only a waited write ends the batch
+    db_writer_configure(COMMIT_INTERVAL_MS, 256, "normal");
+
+    if (init_database(TEST_DB_PATH) != 0) {
+        printf("Test failed: Could not initialize database\n");
+        return 1;
+    }
+
+    pthread_mutex_lock(get_db_mutex());
+    int rc = sqlite3_exec(get_db_handle(), "CREATE TABLE writer_test (id INTEGER PRIMARY KEY, value TEXT);",
+                          NULL, NULL, NULL);
+    pthread_mutex_unlock(get_db_mutex());
+    if (rc != SQLITE_OK) {
+        printf("Test failed: Could not create test table\n");
+        shutdown_database();
+        return 1;
+    }
+
+    int failed = 0;
+    RUN_TEST(failed, "Group commit", test_group_commit());
+    RUN_TEST(failed, "Held future", test_held_future());
+    RUN_TEST(failed, "Rollback", test_rollback());
+
+    shutdown_database();
+    unlink(TEST_DB_PATH);
+
+    return test_summary(failed);
+}
@@ -0,0 +1,400 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "core/config.h"
+#include "core/logger.h"
+#include "core/shutdown_coordinator.h"
+#include "video/api_detection.h"
+#include "video/detection_result.h"
+#include "database/db_detections.h"
+
+#include "test_utils.h"
+
+// Request timeout the test build of api_detection.c is compiled with
+#ifndef API_DETECTION_TIMEOUT_MS
+#define API_DETECTION_TIMEOUT_MS 1000
+#endif
+
+#define TEST_WIDTH 64
+#define TEST_HEIGHT 48
+
+config_t g_config;
+
+static const char DETECTION_RESPONSE[] =
+    "{\"detections\":[{\"label\":\"person\",\"confidence\":0.9,"
+    "\"bounding_box\":{\"x_min\":0.1,\"y_min\":0.2,\"x_max\":0.5,\"y_max\":0.8}}]}";
+
+// Detections handed to the database
+static atomic_int stored_count;
+
+bool is_shutdown_initiated(void) {
+    return false;
+}
+
+int store_detections_in_db_async(const char *stream_name, const detection_result_t *result, time_t timestamp,
+                                 db_write_future_t **future) {
+    (void)stream_name;
+    (void)result;
+    (void)timestamp;
+    if (future) {
+        *future = NULL;
+    }
+    atomic_fetch_add(&stored_count, 1);
+    return 0;
+}
+
+/*
+ * Mock detection server
+ *
+ * Requests to /detect are answered at once. Requests to /hang are held until
+ * the test releases them or the client gives up.
+ */
+static int server_fd = -1;
+static int server_port;
+static pthread_t server_thread;
+static atomic_bool server_running;
+static atomic_bool release_hung;
+static atomic_int requests_received;
+static atomic_int requests_hanging;
+static atomic_int connections_open;
+
+static void send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+/**
+ * Read one request, headers and body
+ *
+ * @return true with the request path in path, false if the client went away
+ */
+static bool read_request(int fd, char path[256]) {
+    char buf[16384];
+    size_t len = 0;
+    char *body = NULL;
+
+    while (!body) {
+        if (len == sizeof(buf) - 1) {
+            return false;
+        }
+        ssize_t n = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+        if (n <= 0) {
+            return false;
+        }
+        len += (size_t)n;
+        buf[len] = '\0';
+        body = strstr(buf, "\r\n\r\n");
+    }
+    body += 4;
+
+    if (sscanf(buf, "%*s %255s", path) != 1) {
+        return false;
+    }
+    char *query = strchr(path, '?');
+    if (query) {
+        *query = '\0';
+    }
+
+    long content_length = 0;
+    const char *header = strcasestr(buf, "\r\ncontent-length:");
+    if (header) {
+        content_length = strtol(header + 17, NULL, 10);
+    }
+    if (strcasestr(buf, "\r\nexpect: 100-continue")) {
+        static const char cont[] = "HTTP/1.1 100 Continue\r\n\r\n";
+        send_all(fd, cont, sizeof(cont) - 1);
+    }
+
+    // Drain the multipart body
+    long remaining = content_length - (long)(len - (size_t)(body - buf));
+    while (remaining > 0) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            return false;
+        }
+        remaining -= n;
+    }
+
+    return true;
+}
+
+/**
+ * Hold a request until released
+ *
+ * @return true if released, false if the client closed the connection
+ */
+static bool hang(int fd) {
+    atomic_fetch_add(&requests_hanging, 1);
+    bool released = false;
+    while (!released) {
+        released = atomic_load(&release_hung);
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        char c;
+        if (!released && poll(&pfd, 1, 20) > 0 && recv(fd, &c, 1, MSG_PEEK) <= 0) {
+            break;
+        }
+    }
+    atomic_fetch_sub(&requests_hanging, 1);
+    return released;
+}
+
+static void *connection_thread_func(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char path[256];
+
+    if (read_request(fd, path)) {
+        atomic_fetch_add(&requests_received, 1);
+        if (strcmp(path, "/hang") != 0 || hang(fd)) {
+            char response[512];
+            int len = snprintf(response, sizeof(response),
+                               "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                               "Content-Length: %zu\r\nConnection: close\r\n\r\n%s",
+                               sizeof(DETECTION_RESPONSE) - 1, DETECTION_RESPONSE);
+            send_all(fd, response, (size_t)len);
+        }
+    }
+
+    close(fd);
+    atomic_fetch_sub(&connections_open, 1);
+    return NULL;
+}
+
+static void *server_thread_func(void *arg) {
+    (void)arg;
+    while (atomic_load(&server_running)) {
+        struct pollfd pfd = {.fd = server_fd, .events = POLLIN};
+        if (poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+        int fd = accept(server_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+
+        pthread_t thread;
+        atomic_fetch_add(&connections_open, 1);
+        if (pthread_create(&thread, NULL, connection_thread_func, (void *)(intptr_t)fd) != 0) {
+            close(fd);
+            atomic_fetch_sub(&connections_open, 1);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+static int start_server(void) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+
+    server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_fd < 0) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(server_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server_fd, 16) != 0 ||
+        getsockname(server_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        close(server_fd);
+        return -1;
+    }
+    server_port = ntohs(addr.sin_port);
+
+    atomic_store(&server_running, true);
+    if (pthread_create(&server_thread, NULL, server_thread_func, NULL) != 0) {
+        close(server_fd);
+        return -1;
+    }
+    return 0;
+}
+
+static void stop_server(void) {
+    atomic_store(&release_hung, true);
+    atomic_store(&server_running, false);
+    pthread_join(server_thread, NULL);
+    close(server_fd);
+
+    // Let the connection threads finish
+    for (int i = 0; i < 100 && atomic_load(&connections_open) > 0; i++) {
+        usleep(20000);
+    }
+}
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool wait_for_hanging(int count) {
+    for (int i = 0; i < 250; i++) {
+        if (atomic_load(&requests_hanging) >= count) {
+            return true;
+        }
+        usleep(20000);
+    }
+    return false;
+}
+
+static unsigned char frame[TEST_WIDTH * TEST_HEIGHT * 3];
+
+static int detect(const char *path, const char *stream_name, detection_result_t *result) {
+    char url[128];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d%s", server_port, path);
+    return detect_objects_api(url, frame, TEST_WIDTH, TEST_HEIGHT, 3, result, stream_name);
+}
+
+// A request to the stream cap test's hanging endpoint
+typedef struct {
+    const char *stream_name;
+    int ret;
+    pthread_t thread;
+} hung_call_t;
+
+static void *hung_call_thread_func(void *arg) {
+    hung_call_t *call = arg;
+    detection_result_t result;
+    call->ret = detect("/hang", call->stream_name, &result);
+    return NULL;
+}
+
+// Detections in the JSON response are returned and stored
+static int test_detection(void) {
+    detection_result_t result;
+    int stored_before = atomic_load(&stored_count);
+
+    int ret = detect("/detect", "cam1", &result);
+
+    CHECK(ret == 0, "detection failed");
+    CHECK(result.count == 1, "%d detections, expected 1", result.count);
+    CHECK(strcmp(result.detections[0].label, "person") == 0, "label %s, expected person",
+          result.detections[0].label);
+    CHECK(fabsf(result.detections[0].confidence - 0.9f) < 1e-4f, "wrong confidence");
+    CHECK(fabsf(result.detections[0].x - 0.1f) < 1e-4f && fabsf(result.detections[0].y - 0.2f) < 1e-4f,
+          "wrong box origin");
+    CHECK(fabsf(result.detections[0].width - 0.4f) < 1e-4f && fabsf(result.detections[0].height - 0.6f) < 1e-4f,
+          "wrong box size");
+    CHECK(atomic_load(&stored_count) == stored_before + 1, "detections were not stored");
+
+    printf("Detection: response parsed and stored\n");
+    return 0;
+}
+
+// A server that never answers fails the request after the timeout
+static int test_timeout(void) {
+    detection_result_t result;
+    atomic_store(&release_hung, false);
+
+    int64_t start = now_ms();
+    int ret = detect("/hang", "cam2", &result);
+    int64_t elapsed = now_ms() - start;
+
+    CHECK(ret == -1, "request to a silent server succeeded");
+    CHECK(elapsed >= API_DETECTION_TIMEOUT_MS - 100, "request gave up after %lld ms", (long long)elapsed);
+    CHECK(elapsed < API_DETECTION_TIMEOUT_MS + 2000, "request took %lld ms to time out", (long long)elapsed);
+    CHECK(result.count == 0, "timed out request returned detections");
+
+    printf("Timeout: silent server fails the request after %lld ms\n", (long long)elapsed);
+    return 0;
+}
+
+// A stream with every request in flight skips frames, other streams proceed
+static int test_inflight_cap(void) {
+    detection_result_t result;
+    hung_call_t calls[2] = {{.stream_name = "cam3"}, {.stream_name = "cam3"}};
+    atomic_store(&release_hung, false);
+
+    for (int i = 0; i < 2; i++) {
+        CHECK(pthread_create(&calls[i].thread, NULL, hung_call_thread_func, &calls[i]) == 0,
+              "could not start thread");
+    }
+    bool both_hanging = wait_for_hanging(2);
+
+    int received_before = atomic_load(&requests_received);
+    int64_t start = now_ms();
+    int capped_ret = detect("/detect", "cam3", &result);
+    int64_t capped_elapsed = now_ms() - start;
+    int capped_requests = atomic_load(&requests_received) - received_before;
+
+    // The dispatcher serves other streams while cam3's requests hang
+    int other_ret = detect("/detect", "cam4", &result);
+    int other_count = result.count;
+
+    atomic_store(&release_hung, true);
+    for (int i = 0; i < 2; i++) {
+        pthread_join(calls[i].thread, NULL);
+    }
+
+    // Completed requests free their slots
+    int after_ret = detect("/detect", "cam3", &result);
+
+    CHECK(both_hanging, "requests did not reach the server");
+    CHECK(capped_ret == -1, "third request of a stream was not skipped");
+    CHECK(capped_requests == 0, "skipped request reached the server");
+    CHECK(capped_elapsed < 500, "skipped request took %lld ms", (long long)capped_elapsed);
+    CHECK(other_ret == 0 && other_count == 1, "request of another stream did not complete");
+    CHECK(calls[0].ret == 0 && calls[1].ret == 0, "released requests failed");
+    CHECK(after_ret == 0, "stream still capped after its requests completed");
+
+    printf("In-flight cap: third request skipped, other streams unaffected\n");
+    return 0;
+}
+
+// Main test function
+int main(void) {
+    // Initialize logger
+    init_logger();
+
+    printf("=== API Detection Test ===\n");
+
+    memset(&g_config, 0, sizeof(g_config));
+    for (size_t i = 0; i < sizeof(frame); i++) {
+        frame[i] = (unsigned char)(i * 7);
+    }
+
+    if (start_server() != 0) {
+        printf("Test failed: Could not start mock server\n");
+        return 1;
+    }
+    if (init_api_detection_system() != 0) {
+        printf("Test failed: Could not initialize API detection\n");
+        stop_server();
+        return 1;
+    }
+
+    int failed = 0;
+    RUN_TEST(failed, "Detection", test_detection());
+    RUN_TEST(failed, "Timeout", test_timeout());
+    RUN_TEST(failed, "In-flight cap", test_inflight_cap());
+
+    shutdown_api_detection_system();
+    stop_server();
+
+    return test_summary(failed);
+}
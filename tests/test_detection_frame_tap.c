@@ -0,0 +1,133 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "core/config.h"
+#include "core/logger.h"
+#include "video/stream_manager.h"
+#include "video/stream_reader.h"
+#include "video/packet_fanout.h"
+#include "video/detection_frame_tap.h"
+#include "video/go2rtc/go2rtc_integration.h"
+
+#include "test_utils.h"
+
+#define TEST_STREAM "frame_tap_test"
+
+config_t g_config;
+
+// Ingest replaced by the test, only counts the camera sessions that would be opened
+static stream_reader_ctx_t test_reader;
+static int ingest_starts;
+static int ingest_stops;
+
+stream_reader_ctx_t *start_stream_reader_with_url(const char *stream_name, const char *url, int protocol,
+                                                 int dedicated, packet_callback_t callback, void *user_data) {
+    (void)stream_name;
+    (void)url;
+    (void)protocol;
+    (void)dedicated;
+    (void)callback;
+    (void)user_data;
+    test_reader.running = 1;
+    ingest_starts++;
+    return &test_reader;
+}
+
+int stop_stream_reader(stream_reader_ctx_t *ctx) {
+    ctx->running = 0;
+    ingest_stops++;
+    return 0;
+}
+
+stream_handle_t get_stream_by_name(const char *name) {
+    static int handle;
+    return strcmp(name, TEST_STREAM) == 0 ? (stream_handle_t)&handle : NULL;
+}
+
+int get_stream_config(stream_handle_t handle, stream_config_t *config) {
+    (void)handle;
+    memset(config, 0, sizeof(*config));
+    strncpy(config->name, TEST_STREAM, sizeof(config->name) - 1);
+    strncpy(config->url, "rtsp://camera.invalid/stream", sizeof(config->url) - 1);
+    return 0;
+}
+
+bool go2rtc_integration_is_using_go2rtc_for_hls(const char *stream_name) {
+    (void)stream_name;
+    return false;
+}
+
+bool go2rtc_get_rtsp_url(const char *stream_name, char *url, size_t url_size) {
+    (void)stream_name;
+    (void)url;
+    (void)url_size;
+    return false;
+}
+
+/**
+ * Wait up to a second for the tap thread to open the ingest
+ */
+static void wait_for_ingest(void) {
+    for (int i = 0; i < 100 && ingest_starts == 0; i++) {
+        usleep(10000);
+    }
+}
+
+// Without shared ingest the tap must not open a camera session of its own
+static int test_shared_ingest_disabled(void) {
+    g_config.shared_ingest = false;
+
+    detection_frame_tap_t *tap = detection_frame_tap_start(TEST_STREAM, DETECTION_FRAME_TAP_KEYFRAMES_ONLY, 0, 1, 3);
+    if (tap) {
+        wait_for_ingest();
+        detection_frame_tap_stop(tap);
+    }
+
+    CHECK(tap == NULL, "tap started with shared ingest disabled");
+    CHECK(ingest_starts == 0, "tap opened %d camera sessions", ingest_starts);
+
+    printf("Shared ingest disabled: tap refused to start\n");
+    return 0;
+}
+
+// With shared ingest the tap attaches to the stream's one ingest and lets go of it on stop
+static int test_shared_ingest_enabled(void) {
+    g_config.shared_ingest = true;
+
+    detection_frame_tap_t *tap = detection_frame_tap_start(TEST_STREAM, DETECTION_FRAME_TAP_KEYFRAMES_ONLY, 0, 1, 3);
+    CHECK(tap, "tap did not start with shared ingest enabled");
+
+    wait_for_ingest();
+    bool running = detection_frame_tap_is_running(tap);
+    int starts = ingest_starts;
+    detection_frame_tap_stop(tap);
+
+    CHECK(running, "tap stopped on its own");
+    CHECK(starts == 1, "ingest started %d times, expected 1", starts);
+    CHECK(ingest_stops == 1, "ingest not stopped with the tap");
+
+    printf("Shared ingest enabled: tap attached to the shared ingest\n");
+    return 0;
+}
+
+int main(void) {
+    // Initialize logger
+    init_logger();
+
+    printf("=== Detection Frame Tap Test ===\n");
+
+    memset(&g_config, 0, sizeof(g_config));
+
+    int failed = 0;
+    RUN_TEST(failed, "Shared ingest disabled", test_shared_ingest_disabled());
+    RUN_TEST_IF_PASSED(failed, "Shared ingest enabled", test_shared_ingest_enabled());
+
+    return test_summary(failed);
+}
@@ -0,0 +1,272 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+
+#include "core/config.h"
+#include "core/logger.h"
+#include "video/mp4_segment_recorder.h"
+
+#include "test_utils.h"
+
+// Test output directory
+#define TEST_OUTPUT_DIR "/tmp/test_mp4_segmenter"
+
+#define TEST_STREAM "segmenter_test"
+#define TEST_DURATION 2
+#define TEST_GOP 10
+#define TEST_FRAME_TICKS 9000
+#define MAX_SEGMENTS 16
+
+config_t g_config;
+
+// Segment notifications, in the order received
+typedef struct {
+    char path[MAX_PATH_LENGTH];
+    time_t start_time;
+    time_t end_time;
+} segment_event_t;
+
+static segment_event_t opened[MAX_SEGMENTS];
+static segment_event_t closed[MAX_SEGMENTS];
+static int open_count;
+static int close_count;
+
+static void on_segment_open(const char *path, time_t start_time, void *user_data) {
+    (void)user_data;
+    if (open_count < MAX_SEGMENTS) {
+        strncpy(opened[open_count].path, path, sizeof(opened[open_count].path) - 1);
+        opened[open_count].start_time = start_time;
+    }
+    open_count++;
+}
+
+static void on_segment_close(const char *path, time_t start_time, time_t end_time, void *user_data) {
+    (void)user_data;
+    if (close_count < MAX_SEGMENTS) {
+        strncpy(closed[close_count].path, path, sizeof(closed[close_count].path) - 1);
+        closed[close_count].start_time = start_time;
+        closed[close_count].end_time = end_time;
+    }
+    close_count++;
+}
+
+// Simulated camera input
+static AVFormatContext *input_ctx;
+static int64_t next_pts;
+
+/**
+ * (Re)connect the simulated camera, timestamps start over at 0
+ */
+static AVStream *connect_input(int width) {
+    if (input_ctx) {
+        avformat_free_context(input_ctx);
+    }
+
+    input_ctx = avformat_alloc_context();
+    AVStream *st = input_ctx ? avformat_new_stream(input_ctx, NULL) : NULL;
+    if (!st) {
+        return NULL;
+    }
+
+    st->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+    st->codecpar->codec_id = AV_CODEC_ID_H264;
+    st->codecpar->width = width;
+    st->codecpar->height = width * 9 / 16;
+    st->time_base = (AVRational){1, 90000};
+    st->avg_frame_rate = (AVRational){10, 1};
+    next_pts = 0;
+
+    return st;
+}
+
+/**
+ * Write video packets at 10 fps, a keyframe every TEST_GOP packets
+ */
+static int write_frames(mp4_segmenter_t *seg, int count) {
+    for (int i = 0; i < count; i++) {
+        AVPacket *pkt = av_packet_alloc();
+        if (!pkt || av_new_packet(pkt, 64) < 0) {
+            av_packet_free(&pkt);
+            return -1;
+        }
+
+        pkt->pts = pkt->dts = next_pts;
+        pkt->flags = (next_pts / TEST_FRAME_TICKS) % TEST_GOP == 0 ? AV_PKT_FLAG_KEY : 0;
+        pkt->stream_index = 0;
+        next_pts += TEST_FRAME_TICKS;
+
+        int ret = mp4_segmenter_write_packet(seg, pkt);
+        av_packet_free(&pkt);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static void reset_events(void) {
+    memset(opened, 0, sizeof(opened));
+    memset(closed, 0, sizeof(closed));
+    open_count = 0;
+    close_count = 0;
+}
+
+// Every file was closed in order and exists on disk
+//
+// Without reconnects, every file also ends where the next one starts. A reconnect
+// re-anchors the timeline to the current wall-clock time, which the test feeds
+// much faster than real time.
+static int check_files(bool contiguous) {
+    for (int i = 0; i < close_count && i < MAX_SEGMENTS; i++) {
+        struct stat st;
+        CHECK(strcmp(closed[i].path, opened[i].path) == 0, "file %d closed out of order", i);
+        CHECK(closed[i].start_time == opened[i].start_time, "file %d start time changed on close", i);
+        CHECK(closed[i].end_time >= closed[i].start_time, "file %d ends before it starts", i);
+        CHECK(stat(closed[i].path, &st) == 0 && st.st_size > 0, "file %s missing or empty", closed[i].path);
+        if (i + 1 < open_count) {
+            CHECK(!contiguous || closed[i].end_time == opened[i + 1].start_time,
+                  "file %d ends at %ld, next starts at %ld", i,
+                  (long)closed[i].end_time, (long)opened[i + 1].start_time);
+            CHECK(strcmp(closed[i].path, opened[i + 1].path) != 0, "file %d overwritten by the next one", i);
+        }
+    }
+    return 0;
+}
+
+// Files roll over on the first keyframe past the segment duration
+static int test_rollover(void) {
+    reset_events();
+    mp4_segmenter_callbacks_t callbacks = {on_segment_open, on_segment_close, NULL};
+    mp4_segmenter_t *seg = mp4_segmenter_create(TEST_STREAM, TEST_OUTPUT_DIR, TEST_DURATION, 0, &callbacks);
+    CHECK(seg, "could not create segmenter");
+
+    AVStream *video = connect_input(1280);
+    int ret = video ? mp4_segmenter_set_input(seg, video, NULL) : -1;
+    if (ret == 0) {
+        // Keyframes at 0..4 seconds, rollovers at 2 and 4
+        ret = write_frames(seg, 5 * TEST_GOP);
+    }
+    int opens_before_finish = open_count;
+    int closes_before_finish = close_count;
+    mp4_segmenter_destroy(seg);
+
+    CHECK(ret == 0, "could not write packets: %d", ret);
+    CHECK(opens_before_finish == 3, "%d files opened, expected 3", opens_before_finish);
+    CHECK(closes_before_finish == 2, "%d files closed before finish, expected 2", closes_before_finish);
+    CHECK(close_count == 3, "last file not closed on destroy");
+    CHECK(closed[0].end_time - closed[0].start_time == TEST_DURATION, "first file lasted %ld seconds",
+          (long)(closed[0].end_time - closed[0].start_time));
+    if (check_files(true) != 0) {
+        return -1;
+    }
+
+    printf("Rollover: files split on keyframes at the segment duration\n");
+    return 0;
+}
+
+// A compatible input keeps the file open, an incompatible one closes it at once
+static int test_input_change(void) {
+    reset_events();
+    mp4_segmenter_callbacks_t callbacks = {on_segment_open, on_segment_close, NULL};
+    mp4_segmenter_t *seg = mp4_segmenter_create(TEST_STREAM, TEST_OUTPUT_DIR, 10, 0, &callbacks);
+    CHECK(seg, "could not create segmenter");
+
+    AVStream *video = connect_input(1280);
+    int ret = video ? mp4_segmenter_set_input(seg, video, NULL) : -1;
+    if (ret == 0) {
+        ret = write_frames(seg, 2 * TEST_GOP);
+    }
+
+    // Reconnect with the same parameters, timestamps restart at 0
+    int closes_after_compatible = -1;
+    if (ret == 0) {
+        video = connect_input(1280);
+        ret = video ? mp4_segmenter_set_input(seg, video, NULL) : -1;
+        closes_after_compatible = close_count;
+    }
+    if (ret == 0) {
+        ret = write_frames(seg, 2 * TEST_GOP);
+    }
+    int opens_after_compatible = open_count;
+
+    // Reconnect with a new resolution
+    int closes_after_incompatible = -1;
+    if (ret == 0) {
+        video = connect_input(1920);
+        ret = video ? mp4_segmenter_set_input(seg, video, NULL) : -1;
+        closes_after_incompatible = close_count;
+    }
+    if (ret == 0) {
+        ret = write_frames(seg, TEST_GOP);
+    }
+    int opens_after_incompatible = open_count;
+
+    if (ret == 0) {
+        ret = mp4_segmenter_finish(seg);
+    }
+    int closes_after_finish = close_count;
+    mp4_segmenter_destroy(seg);
+
+    CHECK(ret == 0, "could not write packets: %d", ret);
+    CHECK(closes_after_compatible == 0, "compatible input closed the file");
+    CHECK(opens_after_compatible == 1, "compatible input opened %d files, expected 1", opens_after_compatible);
+    CHECK(closes_after_incompatible == 1, "incompatible input did not close the file");
+    CHECK(opens_after_incompatible == 2, "incompatible input opened %d files, expected 2", opens_after_incompatible);
+    CHECK(closes_after_finish == 2, "finish did not close the last file");
+    CHECK(close_count == 2, "destroy closed an already finished file");
+
+    if (check_files(false) != 0) {
+        return -1;
+    }
+
+    printf("Input change: compatible inputs appended, incompatible ones start a new file\n");
+    return 0;
+}
+
+static void remove_output_dir(void) {
+    char command[256];
+    snprintf(command, sizeof(command), "rm -rf %s", TEST_OUTPUT_DIR);
+    if (system(command) != 0) {
+        printf("Warning: could not remove %s\n", TEST_OUTPUT_DIR);
+    }
+}
+
+// Main test function
+int main(void) {
+    // Initialize logger
+    init_logger();
+
+    printf("=== MP4 Segmenter Test ===\n");
+
+    remove_output_dir();
+    if (mkdir(TEST_OUTPUT_DIR, 0755) != 0) {
+        printf("Test failed: Could not create %s\n", TEST_OUTPUT_DIR);
+        return 1;
+    }
+
+    mp4_segment_recorder_init();
+
+    int failed = 0;
+    RUN_TEST(failed, "Rollover", test_rollover());
+    RUN_TEST(failed, "Input change", test_input_change());
+
+    mp4_segment_recorder_cleanup();
+    if (input_ctx) {
+        avformat_free_context(input_ctx);
+    }
+    remove_output_dir();
+
+    return test_summary(failed);
+}
@@ -0,0 +1,361 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+
+#include "core/config.h"
+#include "core/logger.h"
+#include "video/stream_manager.h"
+#include "video/stream_reader.h"
+#include "video/packet_fanout.h"
+#include "video/go2rtc/go2rtc_integration.h"
+
+#include "test_utils.h"
+
+#define TEST_STREAM "fanout_test"
+#define TEST_GOP 10
+
+config_t g_config;
+
+// Ingest replaced by the test: packets are published by calling the callback directly
+static stream_reader_ctx_t test_reader;
+static packet_callback_t ingest_callback;
+static void *ingest_user_data;
+static int ingest_starts;
+static int ingest_stops;
+
+static AVFormatContext *input_ctx;
+static unsigned int input_generation;
+static int64_t next_pts;
+
+stream_reader_ctx_t *start_stream_reader_with_url(const char *stream_name, const char *url, int protocol,
+                                                 int dedicated, packet_callback_t callback, void *user_data) {
+    (void)stream_name;
+    (void)url;
+    (void)protocol;
+    (void)dedicated;
+    ingest_callback = callback;
+    ingest_user_data = user_data;
+    test_reader.running = 1;
+    ingest_starts++;
+    return &test_reader;
+}
+
+int stop_stream_reader(stream_reader_ctx_t *ctx) {
+    ctx->running = 0;
+    ingest_callback = NULL;
+    ingest_stops++;
+    return 0;
+}
+
+stream_handle_t get_stream_by_name(const char *name) {
+    static int handle;
+    return strcmp(name, TEST_STREAM) == 0 ? (stream_handle_t)&handle : NULL;
+}
+
+int get_stream_config(stream_handle_t handle, stream_config_t *config) {
+    (void)handle;
+    memset(config, 0, sizeof(*config));
+    strncpy(config->name, TEST_STREAM, sizeof(config->name) - 1);
+    strncpy(config->url, "rtsp://camera.invalid/stream", sizeof(config->url) - 1);
+    return 0;
+}
+
+bool go2rtc_integration_is_using_go2rtc_for_hls(const char *stream_name) {
+    (void)stream_name;
+    return false;
+}
+
+bool go2rtc_get_rtsp_url(const char *stream_name, char *url, size_t url_size) {
+    (void)stream_name;
+    (void)url;
+    (void)url_size;
+    return false;
+}
+
+/**
+ * (Re)connect the simulated camera with a new video resolution
+ */
+static int connect_input(int width) {
+    if (input_ctx) {
+        avformat_free_context(input_ctx);
+    }
+
+    input_ctx = avformat_alloc_context();
+    AVStream *st = input_ctx ? avformat_new_stream(input_ctx, NULL) : NULL;
+    if (!st) {
+        return -1;
+    }
+
+    st->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+    st->codecpar->codec_id = AV_CODEC_ID_H264;
+    st->codecpar->width = width;
+    st->codecpar->height = width * 9 / 16;
+    st->time_base = (AVRational){1, 90000};
+    st->avg_frame_rate = (AVRational){10, 1};
+    input_generation++;
+
+    return 0;
+}
+
+/**
+ * Publish video packets, a keyframe every TEST_GOP packets counted from the first
+ *
+ * @param first_keyframe Whether the first packet is a keyframe
+ * @return PTS of the last keyframe published, -1 if none
+ */
+static int64_t publish(int count, bool first_keyframe) {
+    int64_t last_keyframe_pts = -1;
+
+    for (int i = 0; i < count; i++) {
+        AVPacket *pkt = av_packet_alloc();
+        if (!pkt || av_new_packet(pkt, 64) < 0) {
+            av_packet_free(&pkt);
+            return -1;
+        }
+
+        bool keyframe = first_keyframe ? i % TEST_GOP == 0 : (i + 1) % TEST_GOP == 0;
+        pkt->pts = pkt->dts = next_pts;
+        pkt->flags = keyframe ? AV_PKT_FLAG_KEY : 0;
+        next_pts += 9000;
+        if (keyframe) {
+            last_keyframe_pts = pkt->pts;
+        }
+
+        if (ingest_callback) {
+            ingest_callback(pkt, input_ctx->streams[0], input_generation, ingest_user_data);
+        }
+        av_packet_free(&pkt);
+    }
+
+    return last_keyframe_pts;
+}
+
+/**
+ * Read everything available
+ *
+ * @return Number of packets read
+ */
+static int drain(packet_fanout_reader_t *reader) {
+    AVPacket *pkt = av_packet_alloc();
+    int count = 0;
+
+    while (packet_fanout_read(reader, pkt, 0) == 0) {
+        av_packet_unref(pkt);
+        count++;
+    }
+    av_packet_free(&pkt);
+
+    return count;
+}
+
+static void *delayed_publish_thread(void *arg) {
+    (void)arg;
+    usleep(100000);
+    publish(1, true);
+    return NULL;
+}
+
+// One ingest is shared by every consumer of a stream
+static int test_shared_ingest(packet_fanout_t **fanout) {
+    packet_fanout_t *first = packet_fanout_acquire(TEST_STREAM);
+    packet_fanout_t *second = packet_fanout_acquire(TEST_STREAM);
+
+    CHECK(first && first == second, "consumers of one stream got different fan-outs");
+    CHECK(ingest_starts == 1, "ingest started %d times", ingest_starts);
+    CHECK(packet_fanout_acquire("unknown") == NULL, "fan-out created for an unknown stream");
+
+    packet_fanout_release(second);
+    CHECK(ingest_stops == 0, "ingest stopped while still referenced");
+
+    *fanout = first;
+    printf("Shared ingest: one stream reader for every consumer\n");
+    return 0;
+}
+
+// The first packet of a subscriber is a keyframe, and a blocked read wakes up on publish
+static int test_first_keyframe(packet_fanout_reader_t *reader) {
+    AVPacket *pkt = av_packet_alloc();
+    CHECK(pkt, "could not allocate packet");
+
+    CHECK(packet_fanout_wait_for_streams(reader, 10) == AVERROR(EAGAIN), "streams available before any packet");
+
+    // Joined mid-GOP: the packets before the first keyframe are skipped
+    int64_t keyframe_pts = publish(TEST_GOP, false);
+    CHECK(packet_fanout_wait_for_streams(reader, 10) == 0, "streams not available after publishing");
+
+    int ret = packet_fanout_read(reader, pkt, 0);
+    CHECK(ret == 0, "read failed: %d", ret);
+    CHECK((pkt->flags & AV_PKT_FLAG_KEY) && pkt->pts == keyframe_pts,
+          "first packet is not the keyframe (pts %lld)", (long long)pkt->pts);
+    av_packet_unref(pkt);
+
+    const AVStream *st = packet_fanout_get_stream(reader, AVMEDIA_TYPE_VIDEO);
+    CHECK(st && st->codecpar->width == 640, "reader streams do not match the ingest");
+    CHECK(!packet_fanout_streams_changed(reader), "first streams reported as a change");
+    CHECK(packet_fanout_read(reader, pkt, 0) == AVERROR(EAGAIN), "read returned a packet that was not published");
+
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, delayed_publish_thread, NULL) == 0, "could not start thread");
+    ret = packet_fanout_read(reader, pkt, 2000);
+    pthread_join(thread, NULL);
+    CHECK(ret == 0, "blocked read not woken by a publish: %d", ret);
+    av_packet_unref(pkt);
+
+    av_packet_free(&pkt);
+    printf("First keyframe: subscribers start decodable and wake on publish\n");
+    return 0;
+}
+
+// A lapped catch-up reader resyncs on the newest keyframe still in the ring
+static int test_lapping(packet_fanout_reader_t *reader) {
+    packet_fanout_reader_stats_t before, after;
+    packet_fanout_get_reader_stats(reader, &before);
+
+    // Overrun the ring, the reader resumes at the last keyframe published
+    int count = PACKET_FANOUT_DEFAULT_CAPACITY + 95;
+    int last_keyframe = (count - 1) / TEST_GOP * TEST_GOP;
+    int64_t keyframe_pts = publish(count, true);
+
+    AVPacket *pkt = av_packet_alloc();
+    int ret = packet_fanout_read(reader, pkt, 0);
+    bool keyframe = pkt->flags & AV_PKT_FLAG_KEY;
+    int64_t pts = pkt->pts;
+    av_packet_unref(pkt);
+    av_packet_free(&pkt);
+
+    CHECK(ret == 0, "read after lapping failed: %d", ret);
+    CHECK(keyframe && pts == keyframe_pts, "lapped reader resumed at pts %lld, not the newest keyframe %lld",
+          (long long)pts, (long long)keyframe_pts);
+
+    packet_fanout_get_reader_stats(reader, &after);
+    CHECK(after.resyncs == before.resyncs + 1, "%llu resyncs after lapping",
+          (unsigned long long)(after.resyncs - before.resyncs));
+    CHECK(after.packets_dropped - before.packets_dropped == (uint64_t)last_keyframe,
+          "%llu packets dropped, expected %d",
+          (unsigned long long)(after.packets_dropped - before.packets_dropped), last_keyframe);
+
+    int rest = drain(reader);
+    packet_fanout_get_reader_stats(reader, &after);
+    CHECK(rest == count - 1 - last_keyframe && after.lag == 0, "read %d more packets with a lag of %llu", rest,
+          (unsigned long long)after.lag);
+
+    printf("Lapping: resynced on the newest keyframe, %llu packets dropped\n",
+           (unsigned long long)(after.packets_dropped - before.packets_dropped));
+    return 0;
+}
+
+// A latest reader jumps to the newest GOP, a catch-up reader reads everything
+static int test_latest_policy(packet_fanout_reader_t *catch_up, packet_fanout_reader_t *latest) {
+    drain(catch_up);
+    drain(latest);
+
+    int64_t keyframe_pts = publish(2 * TEST_GOP + 5, true);
+
+    AVPacket *pkt = av_packet_alloc();
+    int ret = packet_fanout_read(latest, pkt, 0);
+    int64_t latest_pts = pkt->pts;
+    av_packet_unref(pkt);
+    av_packet_free(&pkt);
+
+    CHECK(ret == 0 && latest_pts == keyframe_pts, "latest reader at pts %lld, expected the newest keyframe %lld",
+          (long long)latest_pts, (long long)keyframe_pts);
+    CHECK(drain(latest) == 4, "latest reader did not continue from the newest keyframe");
+    CHECK(drain(catch_up) == 2 * TEST_GOP + 5, "catch-up reader skipped packets within the ring");
+
+    printf("Latest policy: jumped to the newest GOP\n");
+    return 0;
+}
+
+// A reconnect with new parameters is reported and updates the reader's streams in place
+static int test_reconnect(packet_fanout_reader_t *reader) {
+    drain(reader);
+    const AVStream *before = packet_fanout_get_stream(reader, AVMEDIA_TYPE_VIDEO);
+
+    CHECK(connect_input(1280) == 0, "could not reconnect input");
+    int64_t keyframe_pts = publish(TEST_GOP, true);
+
+    AVPacket *pkt = av_packet_alloc();
+    int ret = packet_fanout_read(reader, pkt, 0);
+    int64_t pts = pkt->pts;
+    av_packet_unref(pkt);
+    av_packet_free(&pkt);
+
+    CHECK(ret == 0 && pts == keyframe_pts, "read after reconnect failed: %d", ret);
+    CHECK(packet_fanout_streams_changed(reader), "reconnect not reported");
+    CHECK(!packet_fanout_streams_changed(reader), "change reported twice");
+
+    const AVStream *after = packet_fanout_get_stream(reader, AVMEDIA_TYPE_VIDEO);
+    CHECK(after == before, "stream was replaced instead of updated in place");
+    CHECK(after->codecpar->width == 1280, "stream width %d after reconnect", after->codecpar->width);
+
+    drain(reader);
+    printf("Reconnect: new parameters reported and applied\n");
+    return 0;
+}
+
+// Shutdown ends every read with EOF
+static int test_shutdown(packet_fanout_reader_t *reader) {
+    shutdown_packet_fanout_system();
+
+    AVPacket *pkt = av_packet_alloc();
+    int ret = packet_fanout_read(reader, pkt, 1000);
+    av_packet_free(&pkt);
+
+    CHECK(ret == AVERROR_EOF, "read after shutdown returned %d", ret);
+    CHECK(ingest_stops == 1, "ingest stopped %d times", ingest_stops);
+    CHECK(packet_fanout_acquire(TEST_STREAM) == NULL, "fan-out acquired after shutdown");
+
+    printf("Shutdown: readers see the end of the stream\n");
+    return 0;
+}
+
+int main(void) {
+    // Initialize logger
+    init_logger();
+
+    printf("=== Packet Fan-out Test ===\n");
+
+    memset(&g_config, 0, sizeof(g_config));
+    if (connect_input(640) != 0) {
+        printf("Test failed: Could not create input stream\n");
+        return 1;
+    }
+
+    packet_fanout_t *fanout = NULL;
+    if (test_shared_ingest(&fanout) != 0) {
+        printf("Test failed: Shared ingest\n");
+        return 1;
+    }
+
+    packet_fanout_reader_t *catch_up = packet_fanout_subscribe(fanout, "catch_up", PACKET_FANOUT_POLICY_CATCH_UP);
+    packet_fanout_reader_t *latest = packet_fanout_subscribe(fanout, "latest", PACKET_FANOUT_POLICY_LATEST);
+    if (!catch_up || !latest) {
+        printf("Test failed: Could not subscribe\n");
+        return 1;
+    }
+
+    int failed = 0;
+    RUN_TEST(failed, "First keyframe", test_first_keyframe(catch_up));
+    RUN_TEST_IF_PASSED(failed, "Lapping", test_lapping(catch_up));
+    RUN_TEST_IF_PASSED(failed, "Latest policy", test_latest_policy(catch_up, latest));
+    RUN_TEST_IF_PASSED(failed, "Reconnect", test_reconnect(catch_up));
+    RUN_TEST_IF_PASSED(failed, "Shutdown", test_shutdown(catch_up));
+
+    packet_fanout_unsubscribe(latest);
+    packet_fanout_unsubscribe(catch_up);
+    packet_fanout_release(fanout);
+    avformat_free_context(input_ctx);
+
+    return test_summary(failed);
+}
@@ -0,0 +1,138 @@
+/**
+ * Micro-benchmark and check of the SOD convolution path
+ *
+ * Runs convolutional layers of typical detector shapes through the blocked
+ * GEMM / im2col-free path of sod.c and through the original im2col plus
+ * triple loop GEMM, compares the outputs and prints the timings.
+ *
+ * Usage: ./test_sod_gemm [threads] [iterations]
+ *
+ * Returns non-zero if any output differs beyond the tolerance.
+ */
+
+// The static functions of the library are needed, so it is built in
+#include "../src/sod/sod.c"
+
+#include <time.h>
+
+#define TOLERANCE 1e-4f
+
+typedef struct {
+    const char *name;
+    int h, w, c, n, size, stride, pad;
+} conv_shape_t;
+
+static const conv_shape_t shapes[] = {
+    { "3x3 first layer",   208, 208,   3,  16, 3, 1, 1 },
+    { "3x3 early",         104, 104,  16,  32, 3, 1, 1 },
+    { "3x3 middle",         26,  26, 128, 256, 3, 1, 1 },
+    { "3x3 deep",           13,  13, 512, 512, 3, 1, 1 },
+    { "1x1 bottleneck",     26,  26, 256, 128, 1, 1, 0 },
+    { "1x1 detection head", 13,  13, 512, 125, 1, 1, 0 },
+    { "3x3 stride 2",       52,  52,  64, 128, 3, 2, 1 },
+    { "5x5 odd width",      37,  29,  24,  40, 5, 1, 2 },
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * The convolution as it was computed before the blocked GEMM
+ */
+static void reference_convolution(const convolutional_layer *l, float *input, float *workspace, float *output) {
+    int out_h = convolutional_out_height((*l));
+    int out_w = convolutional_out_width((*l));
+    int m = l->n;
+    int k = l->size * l->size * l->c;
+    int n = out_h * out_w;
+
+    memset(output, 0, (size_t)m * n * sizeof(float));
+    im2col_cpu(input, l->c, l->h, l->w, l->size, l->stride, l->pad, workspace);
+    for (int i = 0; i < m; i++) {
+        for (int kk = 0; kk < k; kk++) {
+            float a = l->weights[i * k + kk];
+            for (int j = 0; j < n; j++) {
+                output[i * n + j] += a * workspace[kk * n + j];
+            }
+        }
+    }
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            output[i * n + j] = activate(output[i * n + j] + l->biases[i], l->activation);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 1;
+    int iterations = argc > 2 ? atoi(argv[2]) : 3;
+    int failures = 0;
+
+    if (sod_pool_set_threads(threads) != SOD_OK) {
+        printf("Failed to start %d threads\n", threads);
+        return 1;
+    }
+    srand(1);
+
+    printf("%-20s %10s %10s %8s %12s\n", "layer", "old ms", "new ms", "speedup", "max rel err");
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        const conv_shape_t *shape = &shapes[s];
+        convolutional_layer l = make_convolutional_layer(1, shape->h, shape->w, shape->c, shape->n,
+                                                         shape->size, shape->stride, shape->pad,
+                                                         LEAKY, 0, 0, 0, 0);
+        for (int i = 0; i < shape->n; i++) {
+            l.biases[i] = rand_uniform(-1, 1);
+        }
+
+        float *input = malloc((size_t)l.inputs * sizeof(float));
+        float *workspace = malloc(l.workspace_size);
+        float *expected = malloc((size_t)l.outputs * sizeof(float));
+        for (int i = 0; i < l.inputs; i++) {
+            input[i] = rand_uniform(0, 1);
+        }
+
+        network_state state;
+        memset(&state, 0, sizeof(state));
+        state.input = input;
+        state.workspace = workspace;
+
+        double t0 = now_seconds();
+        for (int it = 0; it < iterations; it++) {
+            reference_convolution(&l, input, workspace, expected);
+        }
+        double old_ms = (now_seconds() - t0) * 1000.0 / iterations;
+
+        t0 = now_seconds();
+        for (int it = 0; it < iterations; it++) {
+            forward_convolutional_layer(l, state);
+        }
+        double new_ms = (now_seconds() - t0) * 1000.0 / iterations;
+
+        float max_err = 0;
+        for (int i = 0; i < l.outputs; i++) {
+            float scale = fabsf(expected[i]) > 1.0f ? fabsf(expected[i]) : 1.0f;
+            float err = fabsf(l.output[i] - expected[i]) / scale;
+            if (err > max_err || err != err) {
+                max_err = err;
+            }
+        }
+
+        int ok = max_err <= TOLERANCE;
+        printf("%-20s %10.2f %10.2f %7.2fx %12.2e%s\n", shape->name, old_ms, new_ms,
+               old_ms / new_ms, max_err, ok ? "" : "  FAILED");
+        if (!ok) {
+            failures++;
+        }
+
+        free(input);
+        free(workspace);
+        free(expected);
+        free_layer(&l, 0);
+    }
+
+    sod_pool_set_threads(1);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,51 @@
+#ifndef LIGHTNVR_TEST_UTILS_H
+#define LIGHTNVR_TEST_UTILS_H
+
+#include <stdio.h>
+
+/**
+ * Fail the current test function with a message when a condition does not hold
+ *
+ * Test functions return 0 on success and -1 on failure.
+ */
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAILED: "); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        return -1; \
+    } \
+} while (0)
+
+/**
+ * Run a test function call and record its failure
+ */
+#define RUN_TEST(failed, name, call) do { \
+    if ((call) != 0) { \
+        printf("Test failed: %s\n", name); \
+        (failed) = 1; \
+    } \
+} while (0)
+
+/**
+ * Run a test that builds on the state left by the previous ones, only if they passed
+ */
+#define RUN_TEST_IF_PASSED(failed, name, call) do { \
+    if (!(failed)) { \
+        RUN_TEST(failed, name, call); \
+    } \
+} while (0)
+
+/**
+ * Print the result of the test program
+ *
+ * @return Exit status for main
+ */
+static inline int test_summary(int failed) {
+    if (!failed) {
+        printf("\n=== All tests passed successfully ===\n");
+    }
+    return failed;
+}
+
+#endif /* LIGHTNVR_TEST_UTILS_H */